@@ -0,0 +1,143 @@
+/*
+ * Integer color math for LED effects.
+ *
+ * Every kernel is a table lookup or a multiply and a shift, no divisions, so the
+ * cost of a frame does not depend on the colors in it. Hue is 8 bit, 256 steps
+ * around the wheel. Blend fractions run from 0 (all a) to LED_COLOR_FRAC_ONE (all b).
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_COLOR_FRAC_ONE      256     /*!< blend fraction that gives the second color exactly */
+#define LED_COLOR_PALETTE_SIZE  256
+
+typedef struct {
+    uint8_t r;
+    uint8_t g;
+    uint8_t b;
+} led_rgb_t;
+
+/**
+ * @brief Gradient stop, the color at one palette index
+ */
+typedef struct {
+    uint8_t pos;
+    led_rgb_t rgb;
+} led_color_stop_t;
+
+/**
+ * @brief Precomputed gradient, one color per 8-bit index
+ */
+typedef struct {
+    led_rgb_t rgb[LED_COLOR_PALETTE_SIZE];
+} led_color_palette_t;
+
+/**
+ * @brief Fully saturated, full value color for every hue
+ */
+extern const uint8_t led_color_wheel_lut[256][3];
+
+/**
+ * @brief c * level / 255, exact at level 0 and 255
+ */
+static inline uint8_t led_color_scale8(uint8_t c, uint8_t level)
+{
+    return (uint8_t)((c * (level + 1)) >> 8);
+}
+
+/**
+ * @brief a + (b - a) * frac / 256, frac 0..LED_COLOR_FRAC_ONE
+ */
+static inline uint8_t led_color_lerp8(uint8_t a, uint8_t b, uint16_t frac)
+{
+    return (uint8_t)(a + (((int32_t)b - a) * (int32_t)frac >> 8));
+}
+
+static inline led_rgb_t led_color_rgb(uint8_t r, uint8_t g, uint8_t b)
+{
+    led_rgb_t c = { r, g, b };
+    return c;
+}
+
+static inline led_rgb_t led_color_scale(led_rgb_t c, uint8_t level)
+{
+    return led_color_rgb(led_color_scale8(c.r, level), led_color_scale8(c.g, level), led_color_scale8(c.b, level));
+}
+
+static inline led_rgb_t led_color_blend(led_rgb_t a, led_rgb_t b, uint16_t frac)
+{
+    return led_color_rgb(led_color_lerp8(a.r, b.r, frac), led_color_lerp8(a.g, b.g, frac), led_color_lerp8(a.b, b.b, frac));
+}
+
+/**
+ * @brief Color of a hue at full saturation and value
+ */
+static inline led_rgb_t led_color_wheel(uint8_t hue)
+{
+    const uint8_t *c = led_color_wheel_lut[hue];
+    return led_color_rgb(c[0], c[1], c[2]);
+}
+
+/**
+ * @brief HSV to RGB: the wheel color is mixed towards white by 255 - sat, then scaled by val
+ */
+static inline led_rgb_t led_color_hsv(uint8_t hue, uint8_t sat, uint8_t val)
+{
+    const uint8_t *c = led_color_wheel_lut[hue];
+    return led_color_rgb(led_color_scale8(255 - led_color_scale8(255 - c[0], sat), val),
+                         led_color_scale8(255 - led_color_scale8(255 - c[1], sat), val),
+                         led_color_scale8(255 - led_color_scale8(255 - c[2], sat), val));
+}
+
+static inline led_rgb_t led_color_palette_at(const led_color_palette_t *palette, uint8_t index)
+{
+    return palette->rgb[index];
+}
+
+/**
+ * @brief Blend two packed RGB buffers into a third, e.g. for led_strip_set_pixels()
+ *
+ * @param dst destination, may be the same as a or b
+ * @param a colors at frac 0
+ * @param b colors at frac LED_COLOR_FRAC_ONE
+ * @param len length of each buffer in bytes
+ * @param frac blend fraction
+ */
+void led_color_blend_buf(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t len, uint16_t frac);
+
+/**
+ * @brief Scale a packed RGB buffer in place
+ */
+void led_color_scale_buf(uint8_t *buf, size_t len, uint8_t level);
+
+/**
+ * @brief Fill a packed RGB buffer with a rainbow, hue advancing by hue_step per pixel
+ */
+void led_color_fill_rainbow(uint8_t *rgb, uint32_t count, uint8_t hue, uint8_t hue_step);
+
+/**
+ * @brief Precompute a gradient through the given stops, once, outside of the render loop
+ *
+ * Indexes before the first stop take its color, after the last stop the color of the last one.
+ *
+ * @param palette destination
+ * @param stops stops in ascending position
+ * @param count number of stops
+ * @return
+ *      - ESP_OK: palette filled
+ *      - ESP_ERR_INVALID_ARG: no stops or positions not ascending
+ */
+esp_err_t led_color_palette_init(led_color_palette_t *palette, const led_color_stop_t *stops, size_t count);
+
+#ifdef __cplusplus
+}
+#endif
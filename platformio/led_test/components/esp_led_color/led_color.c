@@ -0,0 +1,75 @@
+/*
+ * Integer color math for LED effects.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "led_color.h"
+
+/*
+ * Hue h covers sector h * 6 / 256 of the wheel, the low byte of h * 6 is the ramp
+ * inside the sector: red -> yellow -> green -> cyan -> blue -> magenta -> red.
+ */
+#define WHEEL_S(h) (((h) * 6) >> 8)
+#define WHEEL_F(h) (((h) * 6) & 0xFF)
+#define WHEEL_R(h) (WHEEL_S(h) == 0 || WHEEL_S(h) == 5 ? 255 : WHEEL_S(h) == 1 ? 255 - WHEEL_F(h) : WHEEL_S(h) == 4 ? WHEEL_F(h) : 0)
+#define WHEEL_G(h) (WHEEL_S(h) == 1 || WHEEL_S(h) == 2 ? 255 : WHEEL_S(h) == 0 ? WHEEL_F(h) : WHEEL_S(h) == 3 ? 255 - WHEEL_F(h) : 0)
+#define WHEEL_B(h) (WHEEL_S(h) == 3 || WHEEL_S(h) == 4 ? 255 : WHEEL_S(h) == 2 ? WHEEL_F(h) : WHEEL_S(h) == 5 ? 255 - WHEEL_F(h) : 0)
+#define WHEEL_E1(h) { WHEEL_R(h), WHEEL_G(h), WHEEL_B(h) }
+#define WHEEL_E4(h) WHEEL_E1(h), WHEEL_E1((h) + 1), WHEEL_E1((h) + 2), WHEEL_E1((h) + 3)
+#define WHEEL_E16(h) WHEEL_E4(h), WHEEL_E4((h) + 4), WHEEL_E4((h) + 8), WHEEL_E4((h) + 12)
+#define WHEEL_E64(h) WHEEL_E16(h), WHEEL_E16((h) + 16), WHEEL_E16((h) + 32), WHEEL_E16((h) + 48)
+
+const uint8_t led_color_wheel_lut[256][3] = {
+    WHEEL_E64(0), WHEEL_E64(64), WHEEL_E64(128), WHEEL_E64(192),
+};
+
+void led_color_blend_buf(uint8_t *dst, const uint8_t *a, const uint8_t *b, size_t len, uint16_t frac)
+{
+    for (size_t i = 0; i < len; i++) {
+        dst[i] = led_color_lerp8(a[i], b[i], frac);
+    }
+}
+
+void led_color_scale_buf(uint8_t *buf, size_t len, uint8_t level)
+{
+    for (size_t i = 0; i < len; i++) {
+        buf[i] = led_color_scale8(buf[i], level);
+    }
+}
+
+void led_color_fill_rainbow(uint8_t *rgb, uint32_t count, uint8_t hue, uint8_t hue_step)
+{
+    for (uint32_t i = 0; i < count; i++, rgb += 3, hue += hue_step) {
+        rgb[0] = led_color_wheel_lut[hue][0];
+        rgb[1] = led_color_wheel_lut[hue][1];
+        rgb[2] = led_color_wheel_lut[hue][2];
+    }
+}
+
+esp_err_t led_color_palette_init(led_color_palette_t *palette, const led_color_stop_t *stops, size_t count)
+{
+    if (palette == NULL || stops == NULL || count == 0) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    for (size_t i = 1; i < count; i++) {
+        if (stops[i].pos <= stops[i - 1].pos) {
+            return ESP_ERR_INVALID_ARG;
+        }
+    }
+    // the only divisions, one per entry at init time
+    size_t seg = 0;
+    for (uint32_t i = 0; i < LED_COLOR_PALETTE_SIZE; i++) {
+        while (seg + 1 < count && i >= stops[seg + 1].pos) {
+            seg++;
+        }
+        if (i <= stops[0].pos || seg + 1 == count) {
+            palette->rgb[i] = stops[i <= stops[0].pos ? 0 : seg].rgb;
+            continue;
+        }
+        const led_color_stop_t *a = &stops[seg];
+        const led_color_stop_t *b = &stops[seg + 1];
+        uint16_t frac = (uint16_t)((i - a->pos) * LED_COLOR_FRAC_ONE / (b->pos - a->pos));
+        palette->rgb[i] = led_color_blend(a->rgb, b->rgb, frac);
+    }
+    return ESP_OK;
+}
@@ -2,6 +2,7 @@
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "led_strip.h"
+#include "led_color.h"
 #include "driver/gpio.h"
 
 #define NEOPIXEL_GPIO 8
@@ -25,39 +26,11 @@ void app_main(void)
     };
     led_strip_new_rmt_device(&strip_config, &rmt_config, &strip);
 
-    uint8_t r, g, b;
     while (1) {
-        // Cycle through the color wheel (0-255)
+        // Cycle through the color wheel (0-255), a table lookup per frame
         for (int i = 0; i < 256; i++) {
-            // Simple HSV to RGB conversion for smooth color cycling
-            uint8_t region = i / 43;
-            uint8_t remainder = (i - (region * 43)) * 6;
-
-            uint8_t p = 0;
-            uint8_t q = 255 - remainder;
-            uint8_t t = remainder;
-
-            switch (region) {
-                case 0:
-                    r = 255; g = t; b = p;
-                    break;
-                case 1:
-                    r = q; g = 255; b = p;
-                    break;
-                case 2:
-                    r = p; g = 255; b = t;
-                    break;
-                case 3:
-                    r = p; g = q; b = 255;
-                    break;
-                case 4:
-                    r = t; g = p; b = 255;
-                    break;
-                default:
-                    r = 255; g = p; b = q;
-                    break;
-            }
-            led_strip_set_pixel(strip, 0, r, g, b);
+            led_rgb_t c = led_color_wheel(i);
+            led_strip_set_pixel(strip, 0, c.r, c.g, c.b);
             led_strip_refresh(strip);
             vTaskDelay(pdMS_TO_TICKS(20));
         }
@@ -0,0 +1,13 @@
+/*
+ * Host stand-in for the ESP-IDF error codes used by component headers in the benchmarks.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+typedef int esp_err_t;
+
+#define ESP_OK              0
+#define ESP_FAIL            -1
+#define ESP_ERR_NO_MEM      0x101
+#define ESP_ERR_INVALID_ARG 0x102
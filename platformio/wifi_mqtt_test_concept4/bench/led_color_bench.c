@@ -0,0 +1,145 @@
+/*
+ * Host benchmark of the integer color math (components/esp_led_color)
+ *
+ * Compares the per-frame HSV conversion led_test used, with a division and a switch
+ * per pixel, against the hue wheel table and led_color_hsv(). The table is checked
+ * against a float HSV reference first, the CAQI palette against the switch it replaced.
+ *
+ * Build and run from the project folder:
+ *     gcc -O2 -Icomponents/esp_led_color/include -Ibench/host bench/led_color_bench.c components/esp_led_color/led_color.c -o /tmp/led_color_bench -lm
+ *     /tmp/led_color_bench
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include "led_color.h"
+
+#define PIXELS  300
+#define FRAMES  20000
+
+static uint8_t frame[PIXELS * 3];
+
+// led_test/src/main.c before the color library
+static void hsv_divide(uint8_t i, uint8_t *r, uint8_t *g, uint8_t *b)
+{
+    volatile uint8_t div = 43;  // a real division, gcc turns a constant one into a multiply
+    uint8_t region = i / div;
+    uint8_t remainder = (i - (region * 43)) * 6;
+    uint8_t p = 0, q = 255 - remainder, t = remainder;
+    switch (region) {
+    case 0: *r = 255; *g = t; *b = p; break;
+    case 1: *r = q; *g = 255; *b = p; break;
+    case 2: *r = p; *g = 255; *b = t; break;
+    case 3: *r = p; *g = q; *b = 255; break;
+    case 4: *r = t; *g = p; *b = 255; break;
+    default: *r = 255; *g = p; *b = q; break;
+    }
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static int ref_channel(double h, int shift)
+{
+    // distance of hue h (0..6) from the channel peak, red 0, green 2, blue 4
+    double d = fmod(h - shift + 6.0, 6.0);
+    d = d > 3.0 ? 6.0 - d : d;
+    double v = d <= 1.0 ? 1.0 : d >= 2.0 ? 0.0 : 2.0 - d;
+    return (int)lround(v * 255.0);
+}
+
+static void verify(void)
+{
+    for (int h = 0; h < 256; h++) {
+        double hh = h * 6.0 / 256.0;
+        int ref[3] = { ref_channel(hh, 0), ref_channel(hh, 2), ref_channel(hh, 4) };
+        for (int c = 0; c < 3; c++) {
+            if (abs(led_color_wheel_lut[h][c] - ref[c]) > 1) {
+                fprintf(stderr, "MISMATCH: wheel hue %d channel %d: %d vs %d\n", h, c, led_color_wheel_lut[h][c], ref[c]);
+                exit(1);
+            }
+        }
+        led_rgb_t full = led_color_hsv(h, 255, 255);
+        led_rgb_t grey = led_color_hsv(h, 0, 128);
+        if (full.r != led_color_wheel_lut[h][0] || full.g != led_color_wheel_lut[h][1] || full.b != led_color_wheel_lut[h][2]
+            || grey.r != 128 || grey.g != 128 || grey.b != 128) {
+            fprintf(stderr, "MISMATCH: hsv at hue %d\n", h);
+            exit(1);
+        }
+    }
+
+    static const uint8_t caqi_switch[6][3] = {
+        { 0, 0, 255 }, { 0, 255, 0 }, { 255, 255, 0 }, { 255, 165, 0 }, { 128, 0, 128 }, { 255, 0, 0 },
+    };
+    static const led_color_stop_t stops[] = {
+        { 0, { 0, 255, 0 } }, { 64, { 255, 255, 0 } }, { 128, { 255, 165, 0 } }, { 192, { 128, 0, 128 } }, { 255, { 255, 0, 0 } },
+    };
+    led_color_palette_t palette;
+    if (led_color_palette_init(&palette, stops, 5) != ESP_OK) {
+        fprintf(stderr, "MISMATCH: palette init failed\n");
+        exit(1);
+    }
+    for (int caqi = 1; caqi <= 5; caqi++) {
+        int index = (caqi - 1) * 64;
+        led_rgb_t c = led_color_palette_at(&palette, index > 255 ? 255 : index);
+        if (c.r != caqi_switch[caqi][0] || c.g != caqi_switch[caqi][1] || c.b != caqi_switch[caqi][2]) {
+            fprintf(stderr, "MISMATCH: CAQI %d\n", caqi);
+            exit(1);
+        }
+    }
+    printf("wheel within 1 of float HSV, hsv() consistent, CAQI palette matches the switch\n");
+}
+
+int main(void)
+{
+    verify();
+
+    double t0 = now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        for (int i = 0; i < PIXELS; i++) {
+            hsv_divide((uint8_t)(f + i), &frame[i * 3], &frame[i * 3 + 1], &frame[i * 3 + 2]);
+        }
+    }
+    double divide = (now_ns() - t0) / FRAMES;
+    unsigned sink = frame[7];
+
+    t0 = now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        led_color_fill_rainbow(frame, PIXELS, (uint8_t)f, 1);
+    }
+    double wheel = (now_ns() - t0) / FRAMES;
+    sink += frame[7];
+
+    t0 = now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        for (int i = 0; i < PIXELS; i++) {
+            led_rgb_t c = led_color_hsv((uint8_t)(f + i), 200, 128);
+            frame[i * 3] = c.r;
+            frame[i * 3 + 1] = c.g;
+            frame[i * 3 + 2] = c.b;
+        }
+    }
+    double hsv = (now_ns() - t0) / FRAMES;
+    sink += frame[7];
+
+    t0 = now_ns();
+    for (int f = 0; f < FRAMES; f++) {
+        led_color_scale_buf(frame, sizeof(frame), 250);
+    }
+    double scale = (now_ns() - t0) / FRAMES;
+    sink += frame[7];
+
+    printf("%d pixels per frame, ns per frame\n", PIXELS);
+    printf("hue, divide + switch   : %8.0f\n", divide);
+    printf("hue, wheel table       : %8.0f  (%.1fx)\n", wheel, divide / wheel);
+    printf("hsv, table + scale8    : %8.0f\n", hsv);
+    printf("scale_buf              : %8.0f\n", scale);
+    return sink == 12345;
+}
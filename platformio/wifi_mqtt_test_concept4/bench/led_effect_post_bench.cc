@@ -0,0 +1,149 @@
+/*
+ * Host benchmark of the LED effect engine command queue (esp-builtin-led/LedCommandQueue.h)
+ *
+ * Measures what a BuiltinLed call costs the caller: one lock-free push of a
+ * LedCommand, against the same ring behind a std::mutex. Four producer threads
+ * then push tagged commands while one consumer drains, every command has to come
+ * out exactly once and in order per producer before anything is timed.
+ *
+ * Build and run from the project folder:
+ *     g++ -O2 -std=c++17 -pthread -Icomponents/esp-builtin-led bench/led_effect_post_bench.cc -o /tmp/led_effect_post_bench
+ *     /tmp/led_effect_post_bench
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <thread>
+#include <vector>
+#include "LedCommandQueue.h"
+
+#define ROUNDS          2000000
+#define PRODUCERS       4
+#define PER_PRODUCER    200000
+
+struct Command {
+    uint8_t effect;
+    uint8_t r, g, b;
+    uint8_t brightness;
+    int32_t times;
+    uint32_t period_ms;
+};
+
+// the same ring, serialized by a mutex the way the blink task state was guarded
+template <typename T, size_t N>
+class LockedQueue {
+public:
+    bool Push(const T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (head_ - tail_ == N) {
+            return false;
+        }
+        items_[head_++ & (N - 1)] = item;
+        return true;
+    }
+    bool Pop(T& item) {
+        std::lock_guard<std::mutex> lock(mutex_);
+        if (head_ == tail_) {
+            return false;
+        }
+        item = items_[tail_++ & (N - 1)];
+        return true;
+    }
+
+private:
+    std::mutex mutex_;
+    T items_[N];
+    uint32_t head_ = 0, tail_ = 0;
+};
+
+static double now_ns(void)
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// push latency with the consumer keeping up, one pop per frame of 8 pushes like a burst of status changes
+template <typename Q>
+static double bench_push(Q &q)
+{
+    Command cmd = {1, 10, 20, 30, 0, -1, 500};
+    Command out;
+    uint32_t sink = 0;
+    double best = 1e30;
+    for (int rep = 0; rep < 5; rep++) {
+        double t0 = now_ns();
+        for (int i = 0; i < ROUNDS; i += 8) {
+            for (int j = 0; j < 8; j++) {
+                cmd.times = i + j;
+                q.Push(cmd);
+            }
+            double t_pause = now_ns();
+            while (q.Pop(out)) {
+                sink += out.times;
+            }
+            t0 += now_ns() - t_pause;
+        }
+        double ns = (now_ns() - t0) / ROUNDS;
+        best = ns < best ? ns : best;
+    }
+    if (sink == 42) {
+        puts("");
+    }
+    return best;
+}
+
+static void verify_mpsc(void)
+{
+    static LedCommandQueue<Command, 8> q;
+    std::vector<std::thread> producers;
+    for (int p = 0; p < PRODUCERS; p++) {
+        producers.emplace_back([&, p] {
+            for (int i = 0; i < PER_PRODUCER; i++) {
+                Command cmd = {(uint8_t)p, 0, 0, 0, 0, i, 0};
+                while (!q.Push(cmd)) {
+                    std::this_thread::yield();
+                }
+            }
+        });
+    }
+    int next[PRODUCERS] = {0};
+    int total = 0;
+    Command cmd;
+    while (total < PRODUCERS * PER_PRODUCER) {
+        if (!q.Pop(cmd)) {
+            std::this_thread::yield();
+            continue;
+        }
+        if (cmd.effect >= PRODUCERS || cmd.times != next[cmd.effect]) {
+            fprintf(stderr, "MISMATCH: producer %u sent %ld, expected %d\n", cmd.effect, (long)cmd.times,
+                    cmd.effect < PRODUCERS ? next[cmd.effect] : -1);
+            exit(1);
+        }
+        next[cmd.effect]++;
+        total++;
+    }
+    for (auto &t : producers) {
+        t.join();
+    }
+    if (q.Pop(cmd)) {
+        fprintf(stderr, "MISMATCH: queue not empty after all commands\n");
+        exit(1);
+    }
+    printf("%d producers x %d commands delivered once and in order\n", PRODUCERS, PER_PRODUCER);
+}
+
+int main(void)
+{
+    verify_mpsc();
+
+    static LedCommandQueue<Command, 8> lockfree;
+    static LockedQueue<Command, 8> locked;
+    double lf = bench_push(lockfree);
+    double lk = bench_push(locked);
+    printf("push, lock-free ring : %6.1f ns\n", lf);
+    printf("push, mutex ring     : %6.1f ns\n", lk);
+    return 0;
+}
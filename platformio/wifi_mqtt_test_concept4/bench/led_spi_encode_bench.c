@@ -0,0 +1,139 @@
+/*
+ * Host benchmark of the SPI LED strip encoder (components/espressif__led_strip).
+ *
+ * Compares the original bit-by-bit encoder against the 256 entry table, per pixel
+ * and through the bulk path of led_strip_set_pixels(), and checks both produce the
+ * same SPI bytes for every color value.
+ *
+ * Build and run:
+ *     gcc -O2 -Icomponents/espressif__led_strip/src bench/led_spi_encode_bench.c -o /tmp/led_spi_bench
+ *     /tmp/led_spi_bench
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "led_strip_spi_lut.h"
+
+#define BIT(n) (1U << (n))
+#define BYTES_PER_PIXEL 3
+#define MIN_SECONDS 0.2
+
+// encoder as it was before the table, expects a zeroed buf
+static void legacy_spi_bit(uint8_t data, uint8_t *buf)
+{
+    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
+    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
+    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
+    *(buf + 1) |= BIT(0);
+    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
+    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
+    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
+    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
+    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
+}
+
+// led_strip_spi_set_pixel() before the table
+static void legacy_set_pixel(uint8_t *pixel_buf, uint32_t index, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint32_t start = index * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE;
+    memset(pixel_buf + start, 0, BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE);
+    legacy_spi_bit(green, &pixel_buf[start]);
+    legacy_spi_bit(red, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
+    legacy_spi_bit(blue, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+}
+
+// led_strip_spi_set_pixel() with the table
+static void lut_set_pixel(uint8_t *pixel_buf, uint32_t index, uint8_t red, uint8_t green, uint8_t blue)
+{
+    uint32_t start = index * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE;
+    led_strip_spi_encode(green, &pixel_buf[start]);
+    led_strip_spi_encode(red, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
+    led_strip_spi_encode(blue, &pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+}
+
+static double now(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec + ts.tv_nsec * 1e-9;
+}
+
+static volatile uint8_t sink;
+
+typedef void (*frame_fn)(uint8_t *buf, const uint8_t *rgb, uint32_t count);
+
+static void frame_legacy(uint8_t *buf, const uint8_t *rgb, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        legacy_set_pixel(buf, i, rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+    }
+}
+
+static void frame_lut(uint8_t *buf, const uint8_t *rgb, uint32_t count)
+{
+    for (uint32_t i = 0; i < count; i++) {
+        lut_set_pixel(buf, i, rgb[i * 3], rgb[i * 3 + 1], rgb[i * 3 + 2]);
+    }
+}
+
+static void frame_bulk(uint8_t *buf, const uint8_t *rgb, uint32_t count)
+{
+    led_strip_spi_encode_pixels(buf, rgb, count, BYTES_PER_PIXEL);
+}
+
+static double pixels_per_second(frame_fn fn, uint8_t *buf, const uint8_t *rgb, uint32_t count)
+{
+    uint64_t pixels = 0;
+    double start = now(), elapsed;
+    do {
+        for (int i = 0; i < 64; i++) {
+            fn(buf, rgb, count);
+            sink ^= buf[count];
+        }
+        pixels += 64ULL * count;
+        elapsed = now() - start;
+    } while (elapsed < MIN_SECONDS);
+    return pixels / elapsed;
+}
+
+int main(void)
+{
+    for (int v = 0; v < 256; v++) {
+        uint8_t a[SPI_BYTES_PER_COLOR_BYTE] = {0}, b[SPI_BYTES_PER_COLOR_BYTE];
+        legacy_spi_bit(v, a);
+        led_strip_spi_encode(v, b);
+        if (memcmp(a, b, sizeof(a)) != 0) {
+            printf("table mismatch at 0x%02x\n", v);
+            return 1;
+        }
+    }
+
+    static const uint32_t lengths[] = {1, 60, 300, 1000};
+    printf("%8s %14s %14s %14s %8s\n", "pixels", "legacy px/s", "lut px/s", "bulk px/s", "speedup");
+    for (size_t l = 0; l < sizeof(lengths) / sizeof(lengths[0]); l++) {
+        uint32_t count = lengths[l];
+        uint8_t *rgb = malloc(count * 3);
+        uint8_t *buf = malloc(count * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE + 1);
+        uint8_t *ref = malloc(count * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE + 1);
+        for (uint32_t i = 0; i < count * 3; i++) {
+            rgb[i] = rand();
+        }
+        frame_legacy(ref, rgb, count);
+        frame_bulk(buf, rgb, count);
+        if (memcmp(ref, buf, count * BYTES_PER_PIXEL * SPI_BYTES_PER_COLOR_BYTE) != 0) {
+            printf("bulk output differs for %u pixels\n", (unsigned)count);
+            return 1;
+        }
+        double legacy = pixels_per_second(frame_legacy, buf, rgb, count);
+        double lut = pixels_per_second(frame_lut, buf, rgb, count);
+        double bulk = pixels_per_second(frame_bulk, buf, rgb, count);
+        printf("%8u %14.0f %14.0f %14.0f %7.1fx\n", (unsigned)count, legacy, lut, bulk, bulk / legacy);
+        free(rgb);
+        free(buf);
+        free(ref);
+    }
+    return 0;
+}
@@ -0,0 +1,290 @@
+/*
+ * Loopback run of the link probe core (components/esp_link_probe) on a Linux host
+ *
+ * First the histogram percentiles are checked against the exact ones of a synthetic
+ * RTT series. Then probes go over 127.0.0.1 to a reflector thread that drops, delays
+ * past the timeout and duplicates probes on a fixed pattern, and the counters have to
+ * match that pattern exactly. Last the cost of one probe in the core is timed.
+ *
+ * With a host and port the probes go to an external reflector instead, e.g. the
+ * gateway side in tools/link_probe.py, and only the #PROBE line is printed.
+ *
+ * Build and run from the project folder:
+ *     gcc -O2 -pthread -Icomponents/esp_link_probe/include -Ibench/host bench/link_probe_loopback.c components/esp_link_probe/link_probe.c -o /tmp/link_probe_loopback
+ *     /tmp/link_probe_loopback
+ *     python3 tools/link_probe.py reflect --port 8084 & /tmp/link_probe_loopback 127.0.0.1 8084
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include "link_probe.h"
+
+#define PROBES          600
+#define INTERVAL_US     3000        // the window of 32 probes spans the delay
+#define TIMEOUT_US      30000
+#define DELAY_US        50000       // delayed answers arrive after the timeout
+#define HELD_MAX        64
+
+#define DROPPED(seq)    ((seq) % 10 == 9)
+#define DELAYED(seq)    (!DROPPED(seq) && (seq) % 7 == 3)
+#define DOUBLED(seq)    (!DROPPED(seq) && !DELAYED(seq) && (seq) % 13 == 5)
+
+static int64_t now_us(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000LL + ts.tv_nsec / 1000;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fail(const char *what, long got, long expected)
+{
+    fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    exit(1);
+}
+
+static int cmp_u32(const void *a, const void *b)
+{
+    uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+    return x < y ? -1 : x > y;
+}
+
+// feed RTTs straight into the core with a made up clock, no sockets
+static void verify_percentiles(void)
+{
+    enum { N = 5000 };
+    static uint32_t rtts[N];
+    static link_probe_t p;
+    link_probe_init(&p, 2000000);
+    srand(1);
+    int64_t t = 1000000;
+    for (int i = 0; i < N; i++) {
+        // mostly a few ms, with a long tail like a busy WiFi link
+        uint32_t rtt = 2000 + rand() % 3000;
+        rtt = i % 20 == 0 ? rtt * 40 : rtt;
+        rtt = i % 97 == 0 ? (uint32_t)rand() % 64 : rtt;
+        rtts[i] = rtt;
+        uint8_t buf[LINK_PROBE_SIZE];
+        link_probe_make(&p, t, buf, sizeof(buf));
+        if (link_probe_reply(&p, buf, sizeof(buf), t + rtt) != LINK_PROBE_ANSWER) {
+            fail("synthetic answer", i, -1);
+        }
+        t += 10000;
+    }
+    qsort(rtts, N, sizeof(rtts[0]), cmp_u32);
+    static const uint32_t permille[] = { 10, 500, 900, 950, 990, 1000 };
+    for (size_t i = 0; i < sizeof(permille) / sizeof(permille[0]); i++) {
+        uint32_t exact = rtts[(N * permille[i] + 999) / 1000 - 1];
+        uint32_t got = link_probe_percentile(&p, permille[i]);
+        // the bucket holding the exact value reports its upper edge, at most a quarter above
+        if (got < exact || got > exact + exact / 4 + 16) {
+            fail("percentile", got, exact);
+        }
+    }
+    if (p.rtt_min_us != rtts[0] || p.rtt_max_us != rtts[N - 1] || p.received != N || p.lost != 0) {
+        fail("synthetic min", p.rtt_min_us, rtts[0]);
+    }
+    printf("percentiles within one bucket of the exact values\n");
+}
+
+struct held {
+    int64_t due;
+    struct sockaddr_in to;
+    uint8_t buf[LINK_PROBE_SIZE];
+};
+
+static int s_reflector;
+static volatile int s_stop;
+
+// reflects every probe unchanged, except for the impairments of DROPPED/DELAYED/DOUBLED
+static void *reflector(void *arg)
+{
+    (void)arg;
+    static struct held held[HELD_MAX];
+    int nheld = 0;
+    while (!s_stop) {
+        struct pollfd pfd = { .fd = s_reflector, .events = POLLIN };
+        poll(&pfd, 1, 1);
+        int64_t now = now_us();
+        for (int i = 0; i < nheld; i++) {
+            if (held[i].due <= now) {
+                sendto(s_reflector, held[i].buf, LINK_PROBE_SIZE, 0, (struct sockaddr *)&held[i].to, sizeof(held[i].to));
+                held[i--] = held[--nheld];
+            }
+        }
+        if (!(pfd.revents & POLLIN)) {
+            continue;
+        }
+        struct held h;
+        socklen_t len = sizeof(h.to);
+        int n = recvfrom(s_reflector, h.buf, sizeof(h.buf), 0, (struct sockaddr *)&h.to, &len);
+        if (n != LINK_PROBE_SIZE) {
+            continue;
+        }
+        uint32_t seq;
+        memcpy(&seq, h.buf + 4, sizeof(seq));
+        if (DROPPED(seq)) {
+            continue;
+        }
+        if (DELAYED(seq) && nheld < HELD_MAX) {
+            h.due = now + DELAY_US;
+            held[nheld++] = h;
+            continue;
+        }
+        sendto(s_reflector, h.buf, n, 0, (struct sockaddr *)&h.to, len);
+        if (DOUBLED(seq)) {
+            sendto(s_reflector, h.buf, n, 0, (struct sockaddr *)&h.to, len);
+        }
+    }
+    return NULL;
+}
+
+// the loop of link_probe_task.c with POSIX calls
+static void run(link_probe_t *p, int sock, const struct sockaddr_in *dest, int probes, int64_t interval, int64_t drain)
+{
+    uint8_t buf[64];
+    int64_t next = now_us();
+    int64_t end = next + probes * interval + drain;
+    int sent = 0;
+    for (;;) {
+        int64_t now = now_us();
+        if (now >= end) {
+            break;
+        }
+        if (sent < probes && now >= next) {
+            size_t len = link_probe_make(p, now, buf, sizeof(buf));
+            sendto(sock, buf, len, 0, (const struct sockaddr *)dest, sizeof(*dest));
+            sent++;
+            next += interval;
+        }
+        link_probe_expire(p, now);
+        int64_t wait = (sent < probes ? next : end) - now_us();
+        struct pollfd pfd = { .fd = sock, .events = POLLIN };
+        if (wait > 0 && poll(&pfd, 1, (int)((wait + 999) / 1000)) > 0) {
+            int n = recv(sock, buf, sizeof(buf), 0);
+            if (n > 0) {
+                link_probe_reply(p, buf, n, now_us());
+            }
+        }
+    }
+    link_probe_expire(p, now_us());
+}
+
+static int client_socket(void)
+{
+    int sock = socket(AF_INET, SOCK_DGRAM, 0);
+    if (sock < 0) {
+        perror("socket");
+        exit(1);
+    }
+    return sock;
+}
+
+static void verify_loopback(void)
+{
+    s_reflector = client_socket();
+    struct sockaddr_in addr = { .sin_family = AF_INET, .sin_addr.s_addr = htonl(INADDR_LOOPBACK) };
+    socklen_t len = sizeof(addr);
+    if (bind(s_reflector, (struct sockaddr *)&addr, sizeof(addr)) < 0 ||
+        getsockname(s_reflector, (struct sockaddr *)&addr, &len) < 0) {
+        perror("reflector");
+        exit(1);
+    }
+    pthread_t thread;
+    pthread_create(&thread, NULL, reflector, NULL);
+
+    static link_probe_t p;
+    link_probe_init(&p, TIMEOUT_US);
+    int sock = client_socket();
+    run(&p, sock, &addr, PROBES, INTERVAL_US, DELAY_US + 20000);
+    s_stop = 1;
+    pthread_join(thread, NULL);
+    close(sock);
+    close(s_reflector);
+
+    long dropped = 0, delayed = 0, doubled = 0;
+    for (uint32_t seq = 0; seq < PROBES; seq++) {
+        dropped += DROPPED(seq);
+        delayed += DELAYED(seq);
+        doubled += DOUBLED(seq);
+    }
+    if (p.sent != PROBES) {
+        fail("sent", p.sent, PROBES);
+    }
+    if (p.received != PROBES - dropped - delayed) {
+        fail("received", p.received, PROBES - dropped - delayed);
+    }
+    if (p.lost != dropped + delayed) {
+        fail("lost", p.lost, dropped + delayed);
+    }
+    if (p.late != delayed) {
+        fail("late", p.late, delayed);
+    }
+    if (p.duplicate != doubled) {
+        fail("duplicate", p.duplicate, doubled);
+    }
+    if (p.rtt_max_us > TIMEOUT_US || link_probe_percentile(&p, 500) > link_probe_percentile(&p, 990)) {
+        fail("rtt max", p.rtt_max_us, TIMEOUT_US);
+    }
+    char line[LINK_PROBE_LINE_MAX];
+    link_probe_format(&p, line, sizeof(line));
+    printf("%d probes over loopback, %ld dropped, %ld late, %ld doubled accounted exactly\n%s",
+           PROBES, dropped, delayed, doubled, line);
+}
+
+static void bench_core(void)
+{
+    enum { N = 2000000 };
+    static link_probe_t p;
+    link_probe_init(&p, TIMEOUT_US);
+    uint8_t buf[LINK_PROBE_SIZE];
+    double t0 = now_ns();
+    for (int i = 0; i < N; i++) {
+        int64_t t = 1000000 + (int64_t)i * 1000;
+        link_probe_make(&p, t, buf, sizeof(buf));
+        link_probe_reply(&p, buf, sizeof(buf), t + 300 + (i & 1023));
+        link_probe_expire(&p, t + 400);
+    }
+    double ns = (now_ns() - t0) / N;
+    if (p.received != N) {
+        fail("bench received", p.received, N);
+    }
+    printf("make + reply + expire  : %6.1f ns per probe\n", ns);
+}
+
+int main(int argc, char **argv)
+{
+    if (argc == 3) {
+        struct sockaddr_in dest = { .sin_family = AF_INET, .sin_port = htons((uint16_t)atoi(argv[2])) };
+        if (inet_pton(AF_INET, argv[1], &dest.sin_addr) != 1) {
+            fprintf(stderr, "usage: %s [ipv4 port]\n", argv[0]);
+            return 2;
+        }
+        static link_probe_t p;
+        link_probe_init(&p, TIMEOUT_US);
+        run(&p, client_socket(), &dest, 200, 5000, TIMEOUT_US);
+        char line[LINK_PROBE_LINE_MAX];
+        link_probe_format(&p, line, sizeof(line));
+        fputs(line, stdout);
+        return p.received ? 0 : 1;
+    }
+    verify_percentiles();
+    verify_loopback();
+    bench_core();
+    return 0;
+}
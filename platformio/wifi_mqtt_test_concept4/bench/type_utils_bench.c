@@ -0,0 +1,271 @@
+/*
+ * Host benchmark of the type utilities (components/esp_type_utils)
+ *
+ * Compares the nibble table binary formatting and the bswap based byte order
+ * conversions against the bit and byte at a time versions they replaced, and the
+ * array converters against a loop over the single value functions. Every output is
+ * checked against the old versions first.
+ *
+ * Build and run from the project folder:
+ *     gcc -O2 -Icomponents/esp_type_utils/include -Ibench/host bench/type_utils_bench.c components/esp_type_utils/type_utils.c -o /tmp/type_utils_bench
+ *     /tmp/type_utils_bench
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "type_utils.h"
+
+#define ROUNDS      2000000
+#define SAMPLES     256
+#define BLOCKS      20000
+
+esp_err_t esp_efuse_mac_get_default(uint8_t *mac)
+{
+    memset(mac, 0, 6);
+    return ESP_OK;
+}
+
+// type_utils.c 1.2.5, out of line like the library calls they are compared with
+__attribute__((noinline)) static const char* old_uint32_to_binary(const uint32_t value) {
+    static bin32_char_buffer_t buffer;
+    buffer[32] = '\0';
+    uint32_t n = value;
+
+    for (int i = 31; i >= 0; --i) {
+        buffer[i] = '0' + (n & 1); // '0' or '1'
+        n >>= 1; // shift to the next bit
+    }
+
+    return buffer;
+}
+
+__attribute__((noinline)) static const char* old_int64_to_binary(const int64_t value) {
+    static bin64_char_buffer_t buffer;
+    buffer[64] = '\0';
+    int64_t n = value;
+
+    for (int i = 63; i >= 0; --i) {
+        buffer[i] = '0' + (n & 1); // '0' or '1'
+        n >>= 1; // shift to the next bit
+    }
+
+    return buffer;
+}
+
+__attribute__((noinline)) static uint32_t old_bytes_to_uint32(const uint8_t* bytes, const bool little_endian) {
+    if(little_endian == true) {
+        return  (uint32_t)bytes[0] | 
+                ((uint32_t)bytes[1] << 8) | 
+                ((uint32_t)bytes[2] << 16) | 
+                ((uint32_t)bytes[3] << 24);
+    } else {
+        return  ((uint32_t)bytes[0] << 24) | 
+                ((uint32_t)bytes[1] << 16) | 
+                ((uint32_t)bytes[2] << 8) | 
+                (uint32_t)bytes[3];
+    }
+}
+
+__attribute__((noinline)) static void old_int16_to_bytes(const int16_t value, uint8_t* bytes, const bool little_endian) {
+    if(little_endian == true) {
+        bytes[0] = (uint8_t)(value & 0xff);        // lsb
+        bytes[1] = (uint8_t)((value >> 8) & 0xff); // msb
+    } else {
+        bytes[0] = (uint8_t)((value >> 8) & 0xff); // msb
+        bytes[1] = (uint8_t)(value & 0xff);        // lsb
+    }
+}
+
+__attribute__((noinline)) static int16_t old_bytes_to_int16(const uint8_t* bytes, const bool little_endian) {
+    if(little_endian == true) {
+        return  (int16_t)(bytes[0] | 
+                ((int16_t)bytes[1] << 8));
+    } else {
+        return  (int16_t)(((int16_t)bytes[0] << 8) | bytes[1]);
+    }
+}
+
+static uint64_t rng_state = 0x9e3779b97f4a7c15ULL;
+
+static uint64_t next_random(void)
+{
+    rng_state ^= rng_state << 13;
+    rng_state ^= rng_state >> 7;
+    rng_state ^= rng_state << 17;
+    return rng_state;
+}
+
+static double now_ns(void)
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1e9 + ts.tv_nsec;
+}
+
+static void fail(const char *what, unsigned long long value)
+{
+    fprintf(stderr, "MISMATCH: %s for 0x%llx\n", what, value);
+    exit(1);
+}
+
+static void verify(void)
+{
+    bin8_char_buffer_t b8;
+    bin16_char_buffer_t b16;
+    bin32_char_buffer_t b32;
+    bin64_char_buffer_t b64;
+    char ref[65];
+
+    for (int i = 0; i < 100000; i++) {
+        uint64_t v = next_random();
+        if (i < 4) {
+            v = i == 0 ? 0 : i == 1 ? ~0ULL : i == 2 ? 1ULL << 63 : 1;
+        }
+        strcpy(ref, old_int64_to_binary((int64_t)v));
+        if (strcmp(int64_to_binary_r((int64_t)v, b64), ref) || strcmp(uint64_to_binary(v), ref)) {
+            fail("64-bit binary", v);
+        }
+        if (strcmp(uint32_to_binary_r((uint32_t)v, b32), ref + 32) || strcmp(int32_to_binary((int32_t)v), ref + 32)) {
+            fail("32-bit binary", v);
+        }
+        if (strcmp(uint16_to_binary_r((uint16_t)v, b16), ref + 48) || strcmp(int16_to_binary_r((int16_t)v, b16), ref + 48)) {
+            fail("16-bit binary", v);
+        }
+        if (strcmp(uint8_to_binary_r((uint8_t)v, b8), ref + 56) || strcmp(int8_to_binary((int8_t)v), ref + 56)) {
+            fail("8-bit binary", v);
+        }
+
+        uint8_t bytes[8], old[8];
+        for (int le = 0; le < 2; le++) {
+            for (int k = 0; k < 8; k++) {
+                bytes[k] = (uint8_t)(v >> (8 * k));
+            }
+            if (bytes_to_uint32(bytes, le) != old_bytes_to_uint32(bytes, le)
+                || bytes_to_int32(bytes, le) != (int32_t)old_bytes_to_uint32(bytes, le)
+                || bytes_to_int16(bytes, le) != old_bytes_to_int16(bytes, le)) {
+                fail("bytes to value", v);
+            }
+            uint64_t v64 = bytes_to_uint64(bytes, le);
+            uint64_t r64 = le ? v : __builtin_bswap64(v);
+            if (v64 != r64 || (uint64_t)bytes_to_int64(bytes, le) != r64) {
+                fail("bytes to 64-bit value", v);
+            }
+            int16_to_bytes((int16_t)v, bytes, le);
+            old_int16_to_bytes((int16_t)v, old, le);
+            uint64_to_bytes(v, bytes + 2, le);
+            if (memcmp(bytes, old, 2) || bytes_to_uint64(bytes + 2, le) != v) {
+                fail("value to bytes", v);
+            }
+        }
+    }
+
+    int16_t samples[SAMPLES], back[SAMPLES];
+    float floats[SAMPLES], floats_back[SAMPLES];
+    uint8_t wire[SAMPLES * 4], ref_wire[SAMPLES * 4];
+    for (int i = 0; i < SAMPLES; i++) {
+        samples[i] = (int16_t)next_random();
+        floats[i] = (float)(int32_t)next_random() / 1024.0f;
+    }
+    for (int le = 0; le < 2; le++) {
+        int16_array_to_bytes(samples, wire, SAMPLES, le);
+        for (int i = 0; i < SAMPLES; i++) {
+            old_int16_to_bytes(samples[i], ref_wire + 2 * i, le);
+        }
+        bytes_to_int16_array(wire, back, SAMPLES, le);
+        if (memcmp(wire, ref_wire, SAMPLES * 2) || memcmp(back, samples, sizeof(samples))) {
+            fail("int16 array", le);
+        }
+        float_array_to_bytes(floats, wire, SAMPLES, le);
+        for (int i = 0; i < SAMPLES; i++) {
+            float_to_bytes(floats[i], ref_wire + 4 * i, le);
+        }
+        bytes_to_float_array(wire, floats_back, SAMPLES, le);
+        if (memcmp(wire, ref_wire, SAMPLES * 4) || memcmp(floats_back, floats, sizeof(floats))) {
+            fail("float array", le);
+        }
+    }
+    printf("binary strings, byte order and array conversions match the 1.2.5 versions\n");
+}
+
+int main(void)
+{
+    verify();
+
+    static uint32_t values[1024];
+    for (int i = 0; i < 1024; i++) {
+        values[i] = (uint32_t)next_random();
+    }
+    unsigned sink = 0;
+    bin32_char_buffer_t b32;
+
+    double t0 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink += (unsigned)old_uint32_to_binary(values[i & 1023])[i & 31];
+    }
+    double bin_old = (now_ns() - t0) / ROUNDS;
+
+    t0 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink += (unsigned)uint32_to_binary_r(values[i & 1023], b32)[i & 31];
+    }
+    double bin_new = (now_ns() - t0) / ROUNDS;
+
+    // big endian, the order of the sensors and the network
+    const uint8_t *bytes = (const uint8_t *)values;
+    t0 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink += old_bytes_to_uint32(bytes + (i & 4091), false);
+    }
+    double load_old = (now_ns() - t0) / ROUNDS;
+
+    t0 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink += bytes_to_uint32(bytes + (i & 4091), false);
+    }
+    double load_new = (now_ns() - t0) / ROUNDS;
+
+    t0 = now_ns();
+    for (int i = 0; i < ROUNDS; i++) {
+        sink += bytes_to_uint32_be(bytes + (i & 4091));
+    }
+    double load_inline = (now_ns() - t0) / ROUNDS;
+
+    static int16_t samples[SAMPLES];
+    static uint8_t wire[SAMPLES * 2];
+    memcpy(samples, values, sizeof(samples));
+    t0 = now_ns();
+    for (int b = 0; b < BLOCKS; b++) {
+        samples[0] = (int16_t)b;
+        for (int i = 0; i < SAMPLES; i++) {
+            old_int16_to_bytes(samples[i], wire + 2 * i, false);
+        }
+        sink += wire[b & (sizeof(wire) - 1)];
+    }
+    double block_old = (now_ns() - t0) / BLOCKS;
+
+    t0 = now_ns();
+    for (int b = 0; b < BLOCKS; b++) {
+        samples[0] = (int16_t)b;
+        int16_array_to_bytes(samples, wire, SAMPLES, false);
+        sink += wire[b & (sizeof(wire) - 1)];
+    }
+    double block_new = (now_ns() - t0) / BLOCKS;
+
+    t0 = now_ns();
+    for (int b = 0; b < BLOCKS; b++) {
+        samples[0] = (int16_t)b;
+        int16_array_to_bytes(samples, wire, SAMPLES, true);
+        sink += wire[b & (sizeof(wire) - 1)];
+    }
+    double block_native = (now_ns() - t0) / BLOCKS;
+
+    printf("uint32 to binary string, ns : %6.1f old  %6.1f nibble table (%.1fx)\n", bin_old, bin_new, bin_old / bin_new);
+    printf("bytes to uint32 (BE), ns    : %6.1f old  %6.1f bswap (%.1fx), %.1f inline _be\n", load_old, load_new,
+           load_old / load_new, load_inline);
+    printf("%d int16 to BE bytes, ns   : %6.0f loop %6.0f array (%.1fx), %.0f in host order\n", SAMPLES,
+           block_old, block_new, block_old / block_new, block_native);
+    return sink == 12345;
+}
@@ -23,6 +23,7 @@
 #include "esp_check.h"
 
 #include "aht20_reg.h"
+#include "aht20_regs.h"
 /* Config --------------------------------------------------------------------*/
 
 /* Macro ---------------------------------------------------------------------*/
@@ -33,48 +34,23 @@
 
 const static char *TAG = "AHT20";
 /* Functions -----------------------------------------------------------------*/
-static uint8_t aht20_calc_crc(uint8_t *data, uint8_t len);
 
 /* Functions Prototypes ------------------------------------------------------*/
-static uint8_t aht20_calc_crc(uint8_t *data, uint8_t len)
-{
-    uint8_t i;
-    uint8_t byte;
-    uint8_t crc = 0xFF;
-
-    for (byte = 0; byte < len; byte++) {
-        crc ^= data[byte];
-        for (i = 8; i > 0; --i) {
-            if ((crc & 0x80) != 0) {
-                crc = (crc << 1) ^ 0x31;
-            } else {
-                crc = crc << 1;
-            }
-        }
-    }
-
-    return crc;
-}
 
-esp_err_t aht20_read_float( aht20_dev_handle_t handle,
-                            float *temperature,
-                            float *humidity)
+/* trigger a measurement and poll the frame until it is done, the whole frame is read
+   on every poll so the first idle one already carries the measurement */
+static esp_err_t aht20_measure(aht20_dev_handle_t handle, aht20_regs_frame_t *frame)
 {
-    uint8_t status;
-    uint8_t buf[7];
-    uint32_t raw_data;
+    uint8_t cmd[3] = { AHT20_START_MEASURMENT_CMD, 0x33, 0x00 };
     uint8_t timeout = 0;
-    
+
     ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "invalid device handle pointer");
-    
-    buf[0] = AHT20_START_MEASURMENT_CMD;
-    buf[1] = 0x33;
-    buf[2] = 0x00;
-    ESP_RETURN_ON_ERROR(i2c_master_transmit(handle->i2c_dev, buf, 3, handle->i2c_timeout), TAG, "");
-    
+
+    ESP_RETURN_ON_ERROR(i2c_master_transmit(handle->i2c_dev, cmd, 3, handle->i2c_timeout), TAG, "");
+
     while (1) {
-        ESP_RETURN_ON_ERROR(i2c_master_receive(handle->i2c_dev, &status, 1, handle->i2c_timeout), TAG, "");
-        if ((status & BIT(AT581X_STATUS_BUSY_INDICATION)) == 0) {
+        ESP_RETURN_ON_ERROR(aht20_regs_read_frame(handle->i2c_dev, handle->i2c_timeout, frame), TAG, "");
+        if (!frame->busy) {
             break;
         }
         vTaskDelay(pdMS_TO_TICKS(10));
@@ -83,88 +59,53 @@ esp_err_t aht20_read_float( aht20_dev_handle_t handle,
             return ESP_ERR_NOT_FINISHED;
         }
     }
-    
-    if ((status & BIT(AT581X_STATUS_Calibration_Enable)) &&
-            (status & BIT(AT581X_STATUS_CRC_FLAG)) &&
-            ((status & BIT(AT581X_STATUS_BUSY_INDICATION)) == 0)) {
-        ESP_RETURN_ON_ERROR(i2c_master_receive(handle->i2c_dev, buf, 7, handle->i2c_timeout), TAG, "");
-        ESP_RETURN_ON_ERROR((aht20_calc_crc(buf, 6) != buf[6]), TAG, "crc is error");
-
-        raw_data = buf[1];
-        raw_data = raw_data << 8;
-        raw_data += buf[2];
-        raw_data = raw_data << 8;
-        raw_data += buf[3];
-        raw_data = raw_data >> 4;
-        *humidity = (float)raw_data * 100 / 1048576;
-
-        raw_data = buf[3] & 0x0F;
-        raw_data = raw_data << 8;
-        raw_data += buf[4];
-        raw_data = raw_data << 8;
-        raw_data += buf[5];
-        *temperature = (float)raw_data * 200 / 1048576 - 50;
-        return ESP_OK;
-    } else {
+
+    if (!frame->calibrated || !frame->crc_flag) {
         ESP_LOGI(TAG, "data is not ready");
         return ESP_ERR_NOT_FINISHED;
     }
+    ESP_RETURN_ON_FALSE(frame->crc_ok, ESP_ERR_INVALID_CRC, TAG, "crc is error");
+    return ESP_OK;
+}
+
+esp_err_t aht20_read_float( aht20_dev_handle_t handle,
+                            float *temperature,
+                            float *humidity)
+{
+    aht20_regs_frame_t frame;
+
+    ESP_RETURN_ON_ERROR(aht20_measure(handle, &frame), TAG, "");
+
+    *humidity = (float)frame.humidity_raw * 100 / 1048576;
+    *temperature = (float)frame.temperature_raw * 200 / 1048576 - 50;
+    return ESP_OK;
 }
 
 esp_err_t aht20_read_i16(   aht20_dev_handle_t handle,
                             int16_t *temperature,
                             int16_t *humidity)
 {
-    uint8_t status;
-    uint8_t buf[7];
-    uint32_t raw_data;
-    uint8_t timeout = 0;
-    
-    ESP_RETURN_ON_FALSE(handle, ESP_ERR_INVALID_ARG, TAG, "invalid device handle pointer");
-    
-    buf[0] = AHT20_START_MEASURMENT_CMD;
-    buf[1] = 0x33;
-    buf[2] = 0x00;
-    ESP_RETURN_ON_ERROR(i2c_master_transmit(handle->i2c_dev, buf, 3, handle->i2c_timeout), TAG, "");
-    
-    while (1) {
-        ESP_RETURN_ON_ERROR(i2c_master_receive(handle->i2c_dev, &status, 1, handle->i2c_timeout), TAG, "");
-        if ((status & BIT(AT581X_STATUS_BUSY_INDICATION)) == 0) {
-            break;
-        }
-        vTaskDelay(pdMS_TO_TICKS(10));
-        if (++timeout >= 16) {
-            ESP_LOGE(TAG, "Timeout waiting for IDLE");
-            return ESP_ERR_NOT_FINISHED;
-        }
-    }
-    
-    if ((status & BIT(AT581X_STATUS_Calibration_Enable)) &&
-            (status & BIT(AT581X_STATUS_CRC_FLAG)) &&
-            ((status & BIT(AT581X_STATUS_BUSY_INDICATION)) == 0)) {
-        ESP_RETURN_ON_ERROR(i2c_master_receive(handle->i2c_dev, buf, 7, handle->i2c_timeout), TAG, "");
-        ESP_RETURN_ON_ERROR((aht20_calc_crc(buf, 6) != buf[6]), TAG, "crc is error");
-
-        raw_data = buf[1];
-        raw_data = raw_data << 8;
-        raw_data += buf[2];
-        raw_data = raw_data << 8;
-        raw_data += buf[3];
-        raw_data = raw_data >> 4;
-        *humidity = (raw_data+52)*625>>16;
-
-        raw_data = buf[3] & 0x0F;
-        raw_data = raw_data << 8;
-        raw_data += buf[4];
-        raw_data = raw_data << 8;
-        raw_data += buf[5];
-        *temperature = ((raw_data+26)*625>>15) - 5000;
-        
-        return ESP_OK;
-    } else {
-        ESP_LOGI(TAG, "data is not ready");
-        return ESP_ERR_NOT_FINISHED;
-    }
+    aht20_regs_frame_t frame;
+
+    ESP_RETURN_ON_ERROR(aht20_measure(handle, &frame), TAG, "");
+
+    *humidity = (frame.humidity_raw + 52) * 625 >> 16;
+    *temperature = ((frame.temperature_raw + 26) * 625 >> 15) - 5000;
+    return ESP_OK;
+}
+
+static esp_err_t aht20_attach(const i2c_master_bus_handle_t bus_handle, const i2c_aht20_config_t *i2c_config, aht20_dev_handle_t aht20_dev_handle)
+{
+    i2c_device_config_t i2c_dev_conf = {
+        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
+        .device_address = i2c_config->i2c_config.device_address,
+        .scl_speed_hz = i2c_config->i2c_config.scl_speed_hz,
+        .scl_wait_us = 0,
+        .flags.disable_ack_check = false,
+    };
+    ESP_RETURN_ON_ERROR(i2c_master_bus_add_device(bus_handle, &i2c_dev_conf, &aht20_dev_handle->i2c_dev), TAG, "i2c new bus failed");
+    aht20_dev_handle->i2c_timeout = i2c_config->i2c_timeout;
+    return ESP_OK;
 }
 
 esp_err_t aht20_new_sensor(const i2c_master_bus_handle_t bus_handle, const i2c_aht20_config_t *i2c_config, aht20_dev_handle_t *out_handle)
@@ -182,15 +123,7 @@ esp_err_t aht20_new_sensor(const i2c_master_bus_handle_t bus_handle, const i2c_a
     aht20_dev_handle = calloc(1, sizeof(struct aht20_dev_s));
     ESP_RETURN_ON_FALSE(aht20_dev_handle, ESP_ERR_NO_MEM, TAG, "no memory");
     
-    i2c_device_config_t i2c_dev_conf = {
-        .dev_addr_length = I2C_ADDR_BIT_LEN_7,
-        .device_address = i2c_config->i2c_config.device_address,
-        .scl_speed_hz = i2c_config->i2c_config.scl_speed_hz,
-        .scl_wait_us = 0,
-        .flags.disable_ack_check = false,
-    };
-    ESP_GOTO_ON_ERROR(i2c_master_bus_add_device(bus_handle, &i2c_dev_conf, &aht20_dev_handle->i2c_dev), ERR_EXIT, TAG, "i2c new bus failed");
-    aht20_dev_handle->i2c_timeout = i2c_config->i2c_timeout;
+    ESP_GOTO_ON_ERROR(aht20_attach(bus_handle, i2c_config, aht20_dev_handle), ERR_EXIT, TAG, "attach failed");
     
     *out_handle = aht20_dev_handle;
     ESP_LOGD(TAG, "%s Success.[%p]", __func__, aht20_dev_handle);
@@ -206,14 +139,33 @@ ERR_EXIT:
     return ret;
 }
 
+esp_err_t aht20_new_sensor_static(const i2c_master_bus_handle_t bus_handle, const i2c_aht20_config_t *i2c_config, aht20_dev_t *storage, aht20_dev_handle_t *out_handle)
+{
+    ESP_RETURN_ON_FALSE(bus_handle, ESP_ERR_INVALID_ARG, TAG, "invalid pointer");
+    ESP_RETURN_ON_FALSE(i2c_config, ESP_ERR_INVALID_ARG, TAG, "invalid pointer");
+    ESP_RETURN_ON_FALSE(storage, ESP_ERR_INVALID_ARG, TAG, "invalid pointer");
+    ESP_RETURN_ON_FALSE(out_handle, ESP_ERR_INVALID_ARG, TAG, "invalid pointer");
+    
+    memset(storage, 0, sizeof(*storage));
+    storage->static_storage = true;
+    ESP_RETURN_ON_ERROR(aht20_attach(bus_handle, i2c_config, storage), TAG, "attach failed");
+    
+    *out_handle = storage;
+    ESP_LOGD(TAG, "%s Success.[%p]", __func__, storage);
+    return ESP_OK;
+}
+
 esp_err_t aht20_del_sensor(aht20_dev_handle_t *handle)
 {
     aht20_dev_handle_t aht20_handle = *handle;
     ESP_RETURN_ON_FALSE(aht20_handle, ESP_ERR_INVALID_ARG, TAG, "invalid pointer");
     
     ESP_RETURN_ON_ERROR(i2c_master_bus_rm_device(aht20_handle->i2c_dev), TAG, "i2c rm bus failed");
+    bool static_storage = aht20_handle->static_storage;
     memset(aht20_handle, 0, sizeof(struct aht20_dev_s));
-    free(aht20_handle);
+    if (!static_storage) {
+        free(aht20_handle);
+    }
     *handle = NULL;
     
     ESP_LOGD(TAG, "%s Success.", __func__);
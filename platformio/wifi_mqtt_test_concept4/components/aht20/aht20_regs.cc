@@ -0,0 +1,71 @@
+/*
+ * AHT20 frame map. The sensor has no register pointer, a read returns status,
+ * 20 bit humidity, 20 bit temperature and CRC; the registers below are byte
+ * offsets into that frame. Humidity and temperature share byte 3.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include "aht20_regs.h"
+#include "aht20_reg.h"
+#include "regmap_i2c.h"
+
+namespace {
+
+using regmap::Access;
+using regmap::Burst;
+using regmap::Endian;
+using regmap::Field;
+using regmap::Reg;
+
+using Status        = Reg<0, 1, Endian::kBig, Access::kRead>;
+using HumidityRaw   = Reg<1, 3, Endian::kBig, Access::kRead>;
+using TemperatureRaw = Reg<3, 3, Endian::kBig, Access::kRead>;
+using Crc           = Reg<6, 1, Endian::kBig, Access::kRead>;
+
+using StatusBusy        = Field<Status, AT581X_STATUS_BUSY_INDICATION, 1>;
+using StatusCalibrated  = Field<Status, AT581X_STATUS_Calibration_Enable, 1>;
+using StatusCrcFlag     = Field<Status, AT581X_STATUS_CRC_FLAG, 1>;
+using Humidity          = Field<HumidityRaw, 4, 20>;
+using Temperature       = Field<TemperatureRaw, 0, 20>;
+
+using Frame = Burst<Status, HumidityRaw, TemperatureRaw, Crc>;
+
+static_assert(Frame::kSize == 7, "AHT20 frame map");
+
+uint8_t aht20_calc_crc(const uint8_t *data, uint8_t len)
+{
+    uint8_t crc = 0xFF;
+
+    for (uint8_t byte = 0; byte < len; byte++) {
+        crc ^= data[byte];
+        for (uint8_t i = 8; i > 0; --i) {
+            if ((crc & 0x80) != 0) {
+                crc = (crc << 1) ^ 0x31;
+            } else {
+                crc = crc << 1;
+            }
+        }
+    }
+
+    return crc;
+}
+
+}  // namespace
+
+esp_err_t aht20_regs_read_frame(i2c_master_dev_handle_t dev, int timeout_ms, aht20_regs_frame_t *frame)
+{
+    regmap::I2cBus bus = { dev, timeout_ms };
+    Frame::Buffer rx;
+    esp_err_t ret = regmap::ReadFrame<Frame>(bus, rx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    frame->status = Frame::Get<Status>(rx);
+    frame->busy = Frame::GetField<StatusBusy>(rx) != 0;
+    frame->calibrated = Frame::GetField<StatusCalibrated>(rx) != 0;
+    frame->crc_flag = Frame::GetField<StatusCrcFlag>(rx) != 0;
+    frame->crc_ok = aht20_calc_crc(rx, Frame::Offset<Crc>()) == Frame::Get<Crc>(rx);
+    frame->humidity_raw = Frame::GetField<Humidity>(rx);
+    frame->temperature_raw = Frame::GetField<Temperature>(rx);
+    return ESP_OK;
+}
@@ -0,0 +1,46 @@
+/*
+ * AHT20 measurement frame, decoded from the frame map in aht20_regs.cc.
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief AHT20 7 byte measurement frame
+ */
+typedef struct {
+    uint8_t     status;             /*!< status byte */
+    bool        busy;               /*!< measurement still running, the rest of the frame is stale */
+    bool        calibrated;         /*!< calibration enabled */
+    bool        crc_flag;           /*!< status CRC flag */
+    bool        crc_ok;             /*!< CRC of the frame matches */
+    uint32_t    humidity_raw;       /*!< 20 bit humidity, % * 2^20 / 100 */
+    uint32_t    temperature_raw;    /*!< 20 bit temperature, (T + 50) * 2^20 / 200 */
+} aht20_regs_frame_t;
+
+/**
+ * @brief Read and decode the whole measurement frame in one transaction
+ *
+ * @param[in]  dev I2C device
+ * @param[in]  timeout_ms I2C timeout
+ * @param[out] frame decoded frame
+ *
+ * @return
+ *    - ESP_OK Success
+ *    - Others I2C error
+ */
+esp_err_t aht20_regs_read_frame(i2c_master_dev_handle_t dev, int timeout_ms, aht20_regs_frame_t *frame);
+
+#ifdef __cplusplus
+}
+#endif
@@ -1,25 +1,19 @@
 #include "BuiltinLed.h"
-#include <cstring>
 #include "esp_log.h"
 
 #define TAG "builtin_led"
 
 BuiltinLed::BuiltinLed() {
-    mutex_ = xSemaphoreCreateMutex();
-    blink_event_group_ = xEventGroupCreate();
-    xEventGroupSetBits(blink_event_group_, BLINK_TASK_STOPPED_BIT);
-
     Configure();
+    ESP_ERROR_CHECK(engine_.Start(led_strip_));
     SetGrey();
 }
 
 BuiltinLed::~BuiltinLed() {
-    StopBlinkInternal();
+    engine_.Stop();
     if (led_strip_ != nullptr) {
         led_strip_del(led_strip_);
     }
-    vSemaphoreDelete(mutex_);
-    vEventGroupDelete(blink_event_group_);
 }
 
 BuiltinLed& BuiltinLed::GetInstance() {
@@ -37,29 +31,46 @@ void BuiltinLed::Configure() {
     led_strip_rmt_config_t rmt_config = {};
     rmt_config.resolution_hz = 10 * 1000 * 1000; // 10MHz
 
+#if CONFIG_BUILTIN_LED_STATIC_ALLOC
+    ESP_ERROR_CHECK(led_strip_new_rmt_device_static(&strip_config, &rmt_config, &led_strip_storage_,
+                                                    led_strip_pixels_, sizeof(led_strip_pixels_), &led_strip_));
+#else
     ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &led_strip_));
+#endif
     led_strip_clear(led_strip_);
 }
 
+void BuiltinLed::Post(LedEffect effect, int32_t times, int period_ms) {
+    uint32_t color = color_.load(std::memory_order_relaxed);
+    LedCommand cmd = {};
+    cmd.effect = effect;
+    cmd.r = color >> 16;
+    cmd.g = color >> 8;
+    cmd.b = color;
+    cmd.times = times;
+    cmd.period_ms = period_ms > 0 ? period_ms : 0;
+    engine_.Post(cmd);
+}
+
 void BuiltinLed::SetColor(uint8_t r, uint8_t g, uint8_t b) {
-    r_ = r;
-    g_ = g;
-    b_ = b;
+    color_.store((uint32_t)r << 16 | (uint32_t)g << 8 | b, std::memory_order_relaxed);
+}
+
+void BuiltinLed::SetBrightness(uint8_t brightness) {
+    LedCommand cmd = {};
+    cmd.effect = LedEffect::kBrightness;
+    cmd.brightness = brightness;
+    engine_.Post(cmd);
 }
 
 void BuiltinLed::TurnOn() {
-    StopBlinkInternal();
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-    led_strip_set_pixel(led_strip_, 0, r_, g_, b_);
-    led_strip_refresh(led_strip_);
-    xSemaphoreGive(mutex_);
+    Post(LedEffect::kSolid, 0, 0);
 }
 
 void BuiltinLed::TurnOff() {
-    StopBlinkInternal();
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-    led_strip_clear(led_strip_);
-    xSemaphoreGive(mutex_);
+    LedCommand cmd = {};
+    cmd.effect = LedEffect::kSolid;
+    engine_.Post(cmd);
 }
 
 void BuiltinLed::BlinkOnce() {
@@ -67,53 +78,26 @@ void BuiltinLed::BlinkOnce() {
 }
 
 void BuiltinLed::Blink(int times, int interval_ms) {
-    StartBlinkTask(times, interval_ms);
+    Post(LedEffect::kBlink, times, interval_ms);
 }
 
 void BuiltinLed::StartContinuousBlink(int interval_ms) {
-    StartBlinkTask(BLINK_INFINITE, interval_ms);
-}
-
-void BuiltinLed::StartBlinkTask(int times, int interval_ms) {
-    StopBlinkInternal();
-    xSemaphoreTake(mutex_, portMAX_DELAY);
-    
-    blink_times_ = times;
-    blink_interval_ms_ = interval_ms;
-    should_blink_ = true;
-
-    xEventGroupClearBits(blink_event_group_, BLINK_TASK_STOPPED_BIT);
-    xEventGroupSetBits(blink_event_group_, BLINK_TASK_RUNNING_BIT);
-
-    xTaskCreate([](void* obj) {
-        auto this_ = static_cast<BuiltinLed*>(obj);
-        int count = 0;
-        while (this_->should_blink_ && (this_->blink_times_ == BLINK_INFINITE || count < this_->blink_times_)) {
-            xSemaphoreTake(this_->mutex_, portMAX_DELAY);
-            led_strip_set_pixel(this_->led_strip_, 0, this_->r_, this_->g_, this_->b_);
-            led_strip_refresh(this_->led_strip_);
-            xSemaphoreGive(this_->mutex_);
-
-            vTaskDelay(this_->blink_interval_ms_ / portTICK_PERIOD_MS);
-            if (!this_->should_blink_) break;
-
-            xSemaphoreTake(this_->mutex_, portMAX_DELAY);
-            led_strip_clear(this_->led_strip_);
-            xSemaphoreGive(this_->mutex_);
-
-            vTaskDelay(this_->blink_interval_ms_ / portTICK_PERIOD_MS);
-            if (this_->blink_times_ != BLINK_INFINITE) count++;
-        }
-        this_->blink_task_ = nullptr;
-        xEventGroupClearBits(this_->blink_event_group_, BLINK_TASK_RUNNING_BIT);
-        xEventGroupSetBits(this_->blink_event_group_, BLINK_TASK_STOPPED_BIT);
-        vTaskDelete(NULL);
-    }, "blink", 2048, this, tskIDLE_PRIORITY, &blink_task_);
-
-    xSemaphoreGive(mutex_);
-}
-
-void BuiltinLed::StopBlinkInternal() {
-    should_blink_ = false;
-    xEventGroupWaitBits(blink_event_group_, BLINK_TASK_STOPPED_BIT, pdFALSE, pdTRUE, portMAX_DELAY);
+    Post(LedEffect::kBlink, BLINK_INFINITE, interval_ms);
+}
+
+void BuiltinLed::Pulse(int period_ms) {
+    Post(LedEffect::kPulse, BLINK_INFINITE, period_ms);
+}
+
+void BuiltinLed::FadeIn(int duration_ms) {
+    Post(LedEffect::kFadeIn, 0, duration_ms);
+}
+
+void BuiltinLed::FadeOut(int duration_ms) {
+    Post(LedEffect::kFadeOut, 0, duration_ms);
+}
+
+void BuiltinLed::TransitionTo(uint8_t r, uint8_t g, uint8_t b, int duration_ms) {
+    SetColor(r, g, b);
+    Post(LedEffect::kTransition, 0, duration_ms);
 }
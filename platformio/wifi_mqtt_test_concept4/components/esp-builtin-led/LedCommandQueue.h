@@ -0,0 +1,67 @@
+#ifndef _LED_COMMAND_QUEUE_H_
+#define _LED_COMMAND_QUEUE_H_
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+
+// Bounded multi-producer single-consumer ring. Every slot carries a sequence number,
+// a producer claims a slot with one compare-exchange on the head and publishes it by
+// bumping the slot sequence, so Push() never blocks and never allocates. A full queue
+// rejects the push instead of waiting for the consumer.
+template <typename T, size_t N>
+class LedCommandQueue {
+    static_assert(N >= 2 && (N & (N - 1)) == 0, "capacity must be a power of two");
+
+public:
+    LedCommandQueue() {
+        for (size_t i = 0; i < N; i++) {
+            slots_[i].seq.store(i, std::memory_order_relaxed);
+        }
+    }
+
+    bool Push(const T& item) {
+        uint32_t pos = head_.load(std::memory_order_relaxed);
+        for (;;) {
+            Slot& slot = slots_[pos & (N - 1)];
+            uint32_t seq = slot.seq.load(std::memory_order_acquire);
+            int32_t diff = static_cast<int32_t>(seq - pos);
+            if (diff == 0) {
+                if (head_.compare_exchange_weak(pos, pos + 1, std::memory_order_relaxed)) {
+                    slot.item = item;
+                    slot.seq.store(pos + 1, std::memory_order_release);
+                    return true;
+                }
+            } else if (diff < 0) {
+                return false;
+            } else {
+                pos = head_.load(std::memory_order_relaxed);
+            }
+        }
+    }
+
+    // consumer side, only ever called from one context
+    bool Pop(T& item) {
+        Slot& slot = slots_[tail_ & (N - 1)];
+        uint32_t seq = slot.seq.load(std::memory_order_acquire);
+        if (static_cast<int32_t>(seq - (tail_ + 1)) < 0) {
+            return false;
+        }
+        item = slot.item;
+        slot.seq.store(tail_ + N, std::memory_order_release);
+        tail_++;
+        return true;
+    }
+
+private:
+    struct Slot {
+        std::atomic<uint32_t> seq;
+        T item;
+    };
+
+    Slot slots_[N];
+    std::atomic<uint32_t> head_{0};
+    uint32_t tail_ = 0;
+};
+
+#endif // _LED_COMMAND_QUEUE_H_
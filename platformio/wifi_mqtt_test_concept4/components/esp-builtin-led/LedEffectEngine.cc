@@ -0,0 +1,135 @@
+#include "LedEffectEngine.h"
+#include "esp_log.h"
+#include "led_color.h"
+
+#define TAG "led_effect"
+
+LedEffectEngine::~LedEffectEngine() {
+    Stop();
+}
+
+esp_err_t LedEffectEngine::Start(led_strip_handle_t strip, uint32_t frame_ms) {
+    strip_ = strip;
+    esp_timer_create_args_t args = {};
+    args.callback = OnFrame;
+    args.arg = this;
+    args.dispatch_method = ESP_TIMER_TASK;
+    args.name = "led_effect";
+    args.skip_unhandled_events = true;
+    esp_err_t ret = esp_timer_create(&args, &timer_);
+    if (ret != ESP_OK) {
+        ESP_LOGE(TAG, "create frame timer failed");
+        return ret;
+    }
+    return esp_timer_start_periodic(timer_, frame_ms * 1000ULL);
+}
+
+void LedEffectEngine::Stop() {
+    if (timer_ != nullptr) {
+        esp_timer_stop(timer_);
+        esp_timer_delete(timer_);
+        timer_ = nullptr;
+    }
+}
+
+bool LedEffectEngine::Post(const LedCommand& cmd) {
+    if (!queue_.Push(cmd)) {
+        dropped_.fetch_add(1, std::memory_order_relaxed);
+        return false;
+    }
+    return true;
+}
+
+void LedEffectEngine::OnFrame(void* arg) {
+    static_cast<LedEffectEngine*>(arg)->Tick();
+}
+
+void LedEffectEngine::Tick() {
+    int64_t now_us = esp_timer_get_time();
+    LedCommand cmd;
+    while (queue_.Pop(cmd)) {
+        if (cmd.effect == LedEffect::kBrightness) {
+            ApplyBrightness(cmd.brightness);
+        } else {
+            Begin(cmd, now_us);
+        }
+    }
+
+    Rgb rgb = Render(static_cast<uint32_t>((now_us - start_us_) / 1000));
+    if (!dirty_ && !(rgb != shown_)) {
+        return;
+    }
+    led_strip_set_pixel(strip_, 0, rgb.r, rgb.g, rgb.b);
+    led_strip_refresh_async(strip_);
+    shown_ = rgb;
+    dirty_ = false;
+}
+
+void LedEffectEngine::Begin(const LedCommand& cmd, int64_t now_us) {
+    current_ = cmd;
+    if (current_.period_ms == 0) {
+        current_.period_ms = 1;
+    }
+    from_ = cmd.effect == LedEffect::kFadeIn ? Rgb{0, 0, 0} : shown_;
+    start_us_ = now_us;
+}
+
+LedEffectEngine::Rgb LedEffectEngine::Render(uint32_t t_ms) {
+    const Rgb color = {current_.r, current_.g, current_.b};
+    const Rgb off = {0, 0, 0};
+    const uint32_t period = current_.period_ms;
+
+    switch (current_.effect) {
+    case LedEffect::kBlink: {
+        uint32_t phase = t_ms / period;
+        if (current_.times != LED_EFFECT_FOREVER && phase >= 2 * static_cast<uint32_t>(current_.times)) {
+            current_.effect = LedEffect::kSolid;
+            current_.r = current_.g = current_.b = 0;
+            return off;
+        }
+        return (phase & 1) ? off : color;
+    }
+    case LedEffect::kPulse: {
+        uint32_t half = period / 2 ? period / 2 : 1;
+        uint32_t p = t_ms % period;
+        uint32_t level = p < half ? p * 255 / half : (period - p) * 255 / half;
+        if (level > 255) {
+            level = 255;
+        }
+        return {led_color_scale8(color.r, level), led_color_scale8(color.g, level), led_color_scale8(color.b, level)};
+    }
+    case LedEffect::kFadeIn:
+    case LedEffect::kFadeOut:
+    case LedEffect::kTransition: {
+        const Rgb to = current_.effect == LedEffect::kFadeOut ? off : color;
+        if (t_ms >= period) {
+            // settle on the end color so idle frames cost a queue check and a compare
+            current_.effect = LedEffect::kSolid;
+            current_.r = to.r;
+            current_.g = to.g;
+            current_.b = to.b;
+            return to;
+        }
+        uint32_t w = (t_ms << 8) / period;
+        return {led_color_lerp8(from_.r, to.r, w), led_color_lerp8(from_.g, to.g, w), led_color_lerp8(from_.b, to.b, w)};
+    }
+    case LedEffect::kSolid:
+    default:
+        return color;
+    }
+}
+
+void LedEffectEngine::ApplyBrightness(uint8_t brightness) {
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    led_strip_rmt_correction_t correction = {};
+    correction.gamma = BUILTIN_LED_GAMMA;
+    correction.brightness = brightness;
+    correction.color_order = LED_COLOR_ORDER_GRB;
+    if (led_strip_rmt_set_correction(strip_, &correction) == ESP_OK) {
+        // same pixel value, different output, send it again
+        dirty_ = true;
+    }
+#else
+    ESP_LOGW(TAG, "brightness needs ESP-IDF 5.3 or newer");
+#endif
+}
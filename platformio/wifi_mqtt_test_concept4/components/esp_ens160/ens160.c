@@ -33,6 +33,7 @@
  * MIT Licensed as described in the file LICENSE
  */
 #include "include/ens160.h"
+#include "ens160_regs.h"
 #include <string.h>
 #include <stdio.h>
 #include <math.h>
@@ -44,37 +45,14 @@
 #include <freertos/queue.h>
 
 
+/*
+ * registers of the hand-written helpers below, the rest is the map in ens160_regs.cc
+*/
 #define ENS160_REG_PART_ID_R            UINT8_C(0x00) //!< ens160 I2C part identifier (default id: 0x01, 0x60)
 #define ENS160_REG_OPMODE_RW            UINT8_C(0x10) //!< ens160 I2C operating mode
 #define ENS160_REG_INT_CONFIG_RW        UINT8_C(0x11) //!< ens160 I2C interrupt pin configuration
 #define ENS160_REG_COMMAND_RW           UINT8_C(0x12) //!< ens160 I2C additional system commands
-#define ENS160_REG_TEMP_IN_RW           UINT8_C(0x13) //!< ens160 I2C host ambient temperature information
-#define ENS160_REG_RH_IN_RW             UINT8_C(0x15) //!< ens160 I2C host relative humidity information
 #define ENS160_REG_DEVICE_STATUS_R      UINT8_C(0x20) //!< ens160 I2C operating status
-#define ENS160_REG_DATA_AQI_R           UINT8_C(0x21) //!< ens160 I2C air quality index
-#define ENS160_REG_DATA_TVOC_R          UINT8_C(0x22) //!< ens160 I2C TVOC concentration (ppb)
-#define ENS160_REG_DATA_ETOH_R          UINT8_C(0x22) //!< ens160 I2C ETOH concentration (ppb)
-#define ENS160_REG_DATA_ECO2_R          UINT8_C(0x24) //!< ens160 I2C equivalent CO2 concentration (ppm)
-#define ENS160_REG_DATA_BL_R            UINT8_C(0x28) //!< ens160 I2C baseline information
-#define ENS160_REG_DATA_TEMP_R          UINT8_C(0x30) //!< ens160 I2C temperature used in calculations
-#define ENS160_REG_DATA_RH_R            UINT8_C(0x32) //!< ens160 I2C relative humidity used in calculations
-#define ENS160_REG_DATA_MISR_R          UINT8_C(0x38) //!< ens160 I2C data integrity field
-#define ENS160_REG_GPR_WRITE0_RW        UINT8_C(0x40) //!< ens160 I2C general purpose write0 register
-#define ENS160_REG_GPR_WRITE1_RW        UINT8_C(0x41) //!< ens160 I2C general purpose write1 register
-#define ENS160_REG_GPR_WRITE2_RW        UINT8_C(0x42) //!< ens160 I2C general purpose write2 register
-#define ENS160_REG_GPR_WRITE3_RW        UINT8_C(0x43) //!< ens160 I2C general purpose write3 register
-#define ENS160_REG_GPR_WRITE4_RW        UINT8_C(0x44) //!< ens160 I2C general purpose write4 register
-#define ENS160_REG_GPR_WRITE5_RW        UINT8_C(0x45) //!< ens160 I2C general purpose write5 register
-#define ENS160_REG_GPR_WRITE6_RW        UINT8_C(0x46) //!< ens160 I2C general purpose write6 register
-#define ENS160_REG_GPR_WRITE7_RW        UINT8_C(0x47) //!< ens160 I2C general purpose write7 register
-#define ENS160_REG_GPR_READ0_R          UINT8_C(0x48) //!< ens160 I2C general purpose read0 register
-#define ENS160_REG_GPR_READ1_R          UINT8_C(0x49) //!< ens160 I2C general purpose read1 register
-#define ENS160_REG_GPR_READ2_R          UINT8_C(0x4a) //!< ens160 I2C general purpose read2 register
-#define ENS160_REG_GPR_READ3_R          UINT8_C(0x4b) //!< ens160 I2C general purpose read3 register
-#define ENS160_REG_GPR_READ4_R          UINT8_C(0x4c) //!< ens160 I2C general purpose read4 register
-#define ENS160_REG_GPR_READ5_R          UINT8_C(0x4d) //!< ens160 I2C general purpose read5 register
-#define ENS160_REG_GPR_READ6_R          UINT8_C(0x4e) //!< ens160 I2C general purpose read6 register
-#define ENS160_REG_GPR_READ7_R          UINT8_C(0x4f) //!< ens160 I2C general purpose read7 register
 
 #define ENS160_TEMPERATURE_MAX         (float)(125.0)  //!< ens160 maximum temperature range
 #define ENS160_TEMPERATURE_MIN         (float)(-40.0)  //!< ens160 minimum temperature range
@@ -123,8 +101,8 @@ static const struct ens160_aqi_uba_row_s ens160_aqi_uba_definition_table[ENS160_
 /**
  * @brief Get air quality (uba) index.
  */
-static inline ens160_aqi_uba_indexes_t ens160_get_aqi_uba_index(const ens160_caqi_data_register_t reg) {
-    switch(reg.bits.aqi_uba) {
+static inline ens160_aqi_uba_indexes_t ens160_get_aqi_uba_index(const uint8_t aqi_uba) {
+    switch(aqi_uba) {
         case 1: return ENS160_AQI_UBA_INDEX_1;
         case 2: return ENS160_AQI_UBA_INDEX_2;
         case 3: return ENS160_AQI_UBA_INDEX_3;
@@ -155,46 +133,6 @@ static inline esp_err_t ens160_i2c_write_byte_to(ens160_handle_t handle, const u
     return ESP_OK;
 }
 
-/**
- * @brief ENS160 I2C write halfword to register address transaction.
- * 
- * @param handle ENS160 device handle.
- * @param reg_addr ENS160 register address to write to.
- * @param word ENS160 write transaction input halfword.
- * @return esp_err_t ESP_OK on success.
- */
-static inline esp_err_t ens160_i2c_write_word_to(ens160_handle_t handle, const uint8_t reg_addr, const uint16_t word) {
-    const bit24_uint8_buffer_t tx = { reg_addr, (uint8_t)(word & 0xff), (uint8_t)((word >> 8) & 0xff) };
-
-    /* validate arguments */
-    ESP_ARG_CHECK( handle );
-
-    /* attempt i2c write transaction */
-    ESP_RETURN_ON_ERROR( i2c_master_transmit(handle->i2c_handle, tx, BIT24_UINT8_BUFFER_SIZE, I2C_XFR_TIMEOUT_MS), TAG, "i2c_master_transmit, i2c write failed" );
-                        
-    return ESP_OK;
-}
-
-/**
- * @brief ENS160 I2C read from register address transaction.  This is a write and then read process.
- * 
- * @param handle ENS160 device handle.
- * @param reg_addr ENS160 register address to read from.
- * @param buffer ENS160 read transaction return buffer.
- * @param size Length of buffer to store results from read transaction.
- * @return esp_err_t ESP_OK on success.
- */
-static inline esp_err_t ens160_i2c_read_from(ens160_handle_t handle, const uint8_t reg_addr, uint8_t *buffer, const uint8_t size) {
-    const bit8_uint8_buffer_t tx = { reg_addr };
-
-    /* validate arguments */
-    ESP_ARG_CHECK( handle );
-
-    ESP_RETURN_ON_ERROR( i2c_master_transmit_receive(handle->i2c_handle, tx, BIT8_UINT8_BUFFER_SIZE, buffer, size, I2C_XFR_TIMEOUT_MS), TAG, "ens160_i2c_read_from failed" );
-
-    return ESP_OK;
-}
-
 /**
  * @brief ENS160 I2C read halfword from register address transaction.
  * 
@@ -430,9 +368,8 @@ esp_err_t ens160_get_compensation_registers(ens160_handle_t handle, float *const
     /* validate arguments */
     ESP_ARG_CHECK( handle );
 
-    /* attempt i2c temperature & humidity compensation read transactions */
-    ESP_RETURN_ON_ERROR( ens160_i2c_read_word_from(handle, ENS160_REG_TEMP_IN_RW, &t), TAG, "read temperature compensation register failed" );
-    ESP_RETURN_ON_ERROR( ens160_i2c_read_word_from(handle, ENS160_REG_RH_IN_RW, &h), TAG, "read humidity compensation register failed" );
+    /* attempt i2c temperature & humidity compensation read transaction */
+    ESP_RETURN_ON_ERROR( ens160_regs_read_compensation(handle->i2c_handle, &t, &h), TAG, "read compensation registers failed" );
 
     /* decode temperature & humidity compensation and set handle parameters */
     *temperature = ens160_decode_temperature(t);
@@ -462,9 +399,8 @@ esp_err_t ens160_set_compensation_registers(ens160_handle_t handle, const float
     uint16_t t = ens160_encode_temperature(temperature); 
     uint16_t h = ens160_encode_humidity(humidity);
 
-    /* attempt i2c temperature & humidity compensation write transactions */
-    ESP_RETURN_ON_ERROR( ens160_i2c_write_word_to(handle, ENS160_REG_TEMP_IN_RW, t), TAG, "write temperature compensation register failed" );
-    ESP_RETURN_ON_ERROR( ens160_i2c_write_word_to(handle, ENS160_REG_RH_IN_RW, h), TAG, "write humidity compensation register failed" );
+    /* attempt i2c temperature & humidity compensation write transaction */
+    ESP_RETURN_ON_ERROR( ens160_regs_write_compensation(handle->i2c_handle, t, h), TAG, "write compensation registers failed" );
 
     /* delay before next i2c transaction */
     vTaskDelay(pdMS_TO_TICKS(ENS160_CMD_DELAY_MS));
@@ -485,22 +421,8 @@ esp_err_t ens160_get_part_id_register(ens160_handle_t handle, uint16_t *const re
     return ESP_OK;
 }
 
-esp_err_t ens160_init(i2c_master_bus_handle_t master_handle, const ens160_config_t *ens160_config, ens160_handle_t *ens160_handle) {
-    /* validate arguments */
-    ESP_ARG_CHECK( master_handle && ens160_config );
-
-    /* power-up task delay */
-    vTaskDelay(pdMS_TO_TICKS(ENS160_POWERUP_DELAY_MS));
-
-    /* validate device exists on the master bus */
-    esp_err_t ret = i2c_master_probe(master_handle, ens160_config->i2c_address, I2C_XFR_TIMEOUT_MS);
-    ESP_GOTO_ON_ERROR(ret, err, TAG, "device does not exist at address 0x%02x, ens160 device handle initialization failed", ens160_config->i2c_address);
-
-    /* validate memory availability for handle */
-    ens160_handle_t out_handle;
-    out_handle = (ens160_handle_t)calloc(1, sizeof(*out_handle));
-    ESP_GOTO_ON_FALSE(out_handle, ESP_ERR_NO_MEM, err, TAG, "no memory for i2c ens160 device, init failed");
-
+/* probe the device and bring up a zeroed context, shared by heap and static init */
+static inline esp_err_t ens160_attach(i2c_master_bus_handle_t master_handle, const ens160_config_t *ens160_config, ens160_handle_t out_handle) {
     /* copy configuration */
     out_handle->dev_config = *ens160_config;
 
@@ -512,8 +434,9 @@ esp_err_t ens160_init(i2c_master_bus_handle_t master_handle, const ens160_config
     };
 
     /* validate device handle */
+    esp_err_t ret = ESP_OK;
     if (out_handle->i2c_handle == NULL) {
-        ESP_GOTO_ON_ERROR(i2c_master_bus_add_device(master_handle, &i2c_dev_conf, &out_handle->i2c_handle), err_handle, TAG, "i2c new bus for init failed");
+        ESP_GOTO_ON_ERROR(i2c_master_bus_add_device(master_handle, &i2c_dev_conf, &out_handle->i2c_handle), err, TAG, "i2c new bus for init failed");
     }
 
     /* delay before next i2c transaction */
@@ -525,6 +448,34 @@ esp_err_t ens160_init(i2c_master_bus_handle_t master_handle, const ens160_config
     /* attempt to read part identifier */
     ESP_GOTO_ON_ERROR( ens160_get_part_id_register(out_handle, &out_handle->part_id), err_handle, TAG, "read part identifier register failed" );
 
+    return ESP_OK;
+
+    err_handle:
+        i2c_master_bus_rm_device(out_handle->i2c_handle);
+        out_handle->i2c_handle = NULL;
+    err:
+        return ret;
+}
+
+esp_err_t ens160_init(i2c_master_bus_handle_t master_handle, const ens160_config_t *ens160_config, ens160_handle_t *ens160_handle) {
+    /* validate arguments */
+    ESP_ARG_CHECK( master_handle && ens160_config );
+
+    /* power-up task delay */
+    vTaskDelay(pdMS_TO_TICKS(ENS160_POWERUP_DELAY_MS));
+
+    /* validate device exists on the master bus */
+    esp_err_t ret = i2c_master_probe(master_handle, ens160_config->i2c_address, I2C_XFR_TIMEOUT_MS);
+    ESP_GOTO_ON_ERROR(ret, err, TAG, "device does not exist at address 0x%02x, ens160 device handle initialization failed", ens160_config->i2c_address);
+
+    /* validate memory availability for handle */
+    ens160_handle_t out_handle;
+    out_handle = (ens160_handle_t)calloc(1, sizeof(*out_handle));
+    ESP_GOTO_ON_FALSE(out_handle, ESP_ERR_NO_MEM, err, TAG, "no memory for i2c ens160 device, init failed");
+
+    /* attempt to attach and configure the device */
+    ESP_GOTO_ON_ERROR( ens160_attach(master_handle, ens160_config, out_handle), err_handle, TAG, "attach device for init failed" );
+
     /* set device handle */
     *ens160_handle = out_handle;
 
@@ -534,22 +485,42 @@ esp_err_t ens160_init(i2c_master_bus_handle_t master_handle, const ens160_config
     return ESP_OK;
 
     err_handle:
-        if (out_handle && out_handle->i2c_handle) {
-            i2c_master_bus_rm_device(out_handle->i2c_handle);
-        }
         free(out_handle);
     err:
         return ret;
 }
 
+esp_err_t ens160_init_static(i2c_master_bus_handle_t master_handle, const ens160_config_t *ens160_config, ens160_context_t *ens160_storage, ens160_handle_t *ens160_handle) {
+    /* validate arguments */
+    ESP_ARG_CHECK( master_handle && ens160_config && ens160_storage && ens160_handle );
+
+    /* power-up task delay */
+    vTaskDelay(pdMS_TO_TICKS(ENS160_POWERUP_DELAY_MS));
+
+    /* validate device exists on the master bus */
+    esp_err_t ret = i2c_master_probe(master_handle, ens160_config->i2c_address, I2C_XFR_TIMEOUT_MS);
+    ESP_RETURN_ON_ERROR(ret, TAG, "device does not exist at address 0x%02x, ens160 device handle initialization failed", ens160_config->i2c_address);
+
+    /* caller provided context, never freed by ens160_delete() */
+    memset(ens160_storage, 0, sizeof(*ens160_storage));
+    ens160_storage->static_storage = true;
+
+    /* attempt to attach and configure the device */
+    ESP_RETURN_ON_ERROR( ens160_attach(master_handle, ens160_config, ens160_storage), TAG, "attach device for init failed" );
+
+    /* set device handle */
+    *ens160_handle = ens160_storage;
+
+    /* app-start task delay  */
+    vTaskDelay(pdMS_TO_TICKS(ENS160_APPSTART_DELAY_MS));
+
+    return ESP_OK;
+}
+
 esp_err_t ens160_get_measurement(ens160_handle_t handle, ens160_air_quality_data_t *const data) {
     esp_err_t                       ret             = ESP_OK;
     uint64_t                        start_time      = 0;
-    bool                            data_is_ready   = false;
-    ens160_caqi_data_register_t     caqi_reg;
-    uint16_t                        tvoc_data;
-    uint16_t                        etoh_data;
-    uint16_t                        eco2_data;
+    ens160_regs_data_t              regs;
 
     /* validate arguments */
     ESP_ARG_CHECK( handle );
@@ -557,10 +528,13 @@ esp_err_t ens160_get_measurement(ens160_handle_t handle, ens160_air_quality_data
     /* set start time (us) for timeout monitoring */
     start_time = esp_timer_get_time(); 
 
-    /* attempt to poll until data is available or timeout */
-    do {
-        /* attempt to poll if data is ready or timeout */
-        ESP_GOTO_ON_ERROR( ens160_get_data_status(handle, &data_is_ready), err, TAG, "data ready read for measurement failed." );
+    /* attempt to poll until data is available or timeout, status and data registers are
+       read in one burst so the poll that sees the new data bit already has the data */
+    for (;;) {
+        ESP_GOTO_ON_ERROR( ens160_regs_read_data(handle->i2c_handle, &regs), err, TAG, "read status and data registers for measurement failed" );
+
+        if (regs.new_data == true)
+            break;
 
         /* delay task before next i2c transaction */
         vTaskDelay(pdMS_TO_TICKS(ENS160_DATA_READY_DELAY_MS));
@@ -568,19 +542,13 @@ esp_err_t ens160_get_measurement(ens160_handle_t handle, ens160_air_quality_data
         /* validate timeout condition */
         if (ESP_TIMEOUT_CHECK(start_time, (ENS160_DATA_POLL_TIMEOUT_MS * 1000)))
             return ESP_ERR_TIMEOUT;
-    } while (data_is_ready == false);
-
-    /* attempt i2c data read transactions */
-    ESP_GOTO_ON_ERROR( ens160_i2c_read_byte_from(handle, ENS160_REG_DATA_AQI_R, &caqi_reg.value), err, TAG, "read calculated air quality index data register for measurement failed" );
-    ESP_GOTO_ON_ERROR( ens160_i2c_read_word_from(handle, ENS160_REG_DATA_TVOC_R, &tvoc_data), err, TAG, "read tvoc data register for measurement failed" );
-    ESP_GOTO_ON_ERROR( ens160_i2c_read_word_from(handle, ENS160_REG_DATA_ETOH_R, &etoh_data), err, TAG, "read etoh data register for measurement failed" );
-    ESP_GOTO_ON_ERROR( ens160_i2c_read_word_from(handle, ENS160_REG_DATA_ECO2_R, &eco2_data), err, TAG, "read eco2 data register for measurement failed" );
+    }
 
     /* set air quality fields */
-    data->uba_aqi = ens160_get_aqi_uba_index(caqi_reg);
-    data->tvoc    = tvoc_data;
-    data->etoh    = etoh_data;
-    data->eco2    = eco2_data;
+    data->uba_aqi = ens160_get_aqi_uba_index(regs.aqi_uba);
+    data->tvoc    = regs.tvoc;
+    data->etoh    = regs.etoh;
+    data->eco2    = regs.eco2;
 
     /* delay before next i2c transaction */
     vTaskDelay(pdMS_TO_TICKS(ENS160_CMD_DELAY_MS));
@@ -595,7 +563,7 @@ esp_err_t ens160_get_raw_measurement(ens160_handle_t handle, ens160_air_quality_
     esp_err_t       ret                 = ESP_OK;
     uint64_t        start_time          = 0;
     bool            gpr_data_is_ready   = false;
-    bit64_uint8_buffer_t rx             = { 0 };
+    uint16_t        raw[4];
 
     /* validate arguments */
     ESP_ARG_CHECK( handle );
@@ -616,26 +584,26 @@ esp_err_t ens160_get_raw_measurement(ens160_handle_t handle, ens160_air_quality_
             return ESP_ERR_TIMEOUT;
     } while (gpr_data_is_ready == false);
 
-    /* attempt i2c gpr data read transactions */
-    ESP_GOTO_ON_ERROR( ens160_i2c_read_from(handle, ENS160_REG_GPR_READ0_R, rx, BIT64_UINT8_BUFFER_SIZE), err, TAG, "read resistance signal gpr data registers for raw measurement failed" );
+    /* attempt i2c gpr data read transaction */
+    ESP_GOTO_ON_ERROR( ens160_regs_read_resistances(handle->i2c_handle, raw), err, TAG, "read resistance signal gpr data registers for raw measurement failed" );
 
     /* convert gpr raw resistance and set resistance signals */
-    data->hp0_ri = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[0] | ((uint16_t)rx[1] << 8)));
-    data->hp1_ri = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[2] | ((uint16_t)rx[3] << 8)));
-    data->hp2_ri = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[4] | ((uint16_t)rx[5] << 8)));
-    data->hp3_ri = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[6] | ((uint16_t)rx[7] << 8)));
+    data->hp0_ri = ENS160_CONVERT_RS_RAW2OHMS_F(raw[0]);
+    data->hp1_ri = ENS160_CONVERT_RS_RAW2OHMS_F(raw[1]);
+    data->hp2_ri = ENS160_CONVERT_RS_RAW2OHMS_F(raw[2]);
+    data->hp3_ri = ENS160_CONVERT_RS_RAW2OHMS_F(raw[3]);
 
     /* delay before next i2c transaction */
     vTaskDelay(pdMS_TO_TICKS(ENS160_CMD_DELAY_MS));
 
-    /* attempt i2c baseline data read transactions */
-    ESP_GOTO_ON_ERROR( ens160_i2c_read_from(handle, ENS160_REG_DATA_BL_R, rx, BIT64_UINT8_BUFFER_SIZE), err, TAG, "read baseline resistance data registers for raw measurement failed" );
+    /* attempt i2c baseline data read transaction */
+    ESP_GOTO_ON_ERROR( ens160_regs_read_baselines(handle->i2c_handle, raw), err, TAG, "read baseline resistance data registers for raw measurement failed" );
 
     /* convert baseline raw resistance and set resistance signals */
-    data->hp0_bl = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[0] | ((uint16_t)rx[1] << 8)));
-    data->hp1_bl = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[2] | ((uint16_t)rx[3] << 8)));
-    data->hp2_bl = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[4] | ((uint16_t)rx[5] << 8)));
-    data->hp3_bl = ENS160_CONVERT_RS_RAW2OHMS_F((uint32_t)(rx[6] | ((uint16_t)rx[7] << 8)));
+    data->hp0_bl = ENS160_CONVERT_RS_RAW2OHMS_F(raw[0]);
+    data->hp1_bl = ENS160_CONVERT_RS_RAW2OHMS_F(raw[1]);
+    data->hp2_bl = ENS160_CONVERT_RS_RAW2OHMS_F(raw[2]);
+    data->hp3_bl = ENS160_CONVERT_RS_RAW2OHMS_F(raw[3]);
 
     /* attempt to clear general purpose registers */
     //ESP_GOTO_ON_ERROR( ens160_clear_general_purpose_registers(ens160_handle), err, TAG, "clear general purpose registers failed" );
@@ -845,8 +813,8 @@ esp_err_t ens160_delete(ens160_handle_t handle) {
     /* remove device from master bus */
     ESP_RETURN_ON_ERROR( ens160_remove(handle), TAG, "unable to remove device from i2c master bus, delete handle failed" );
 
-    /* validate handle instance and free handles */
-    if(handle->i2c_handle) {
+    /* validate handle instance and free handles, static contexts belong to the caller */
+    if(handle->i2c_handle && !handle->static_storage) {
         free(handle->i2c_handle);
         free(handle);
     }
@@ -0,0 +1,103 @@
+/*
+ * ENS160 register map, see the ENS160 datasheet section 16.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "ens160_regs.h"
+#include "ens160.h"
+#include "regmap_i2c.h"
+
+namespace {
+
+using regmap::Access;
+using regmap::Burst;
+using regmap::Endian;
+using regmap::Field;
+using regmap::Reg;
+
+using TempIn        = Reg<0x13, 2>;
+using RhIn          = Reg<0x15, 2>;
+using DeviceStatus  = Reg<0x20, 1, Endian::kLittle, Access::kRead>;
+using DataAqi       = Reg<0x21, 1, Endian::kLittle, Access::kRead>;
+using DataTvoc      = Reg<0x22, 2, Endian::kLittle, Access::kRead>;
+using DataEtoh      = Reg<0x22, 2, Endian::kLittle, Access::kRead>;
+using DataEco2      = Reg<0x24, 2, Endian::kLittle, Access::kRead>;
+using DataBl0       = Reg<0x28, 2, Endian::kLittle, Access::kRead>;
+using DataBl1       = Reg<0x2a, 2, Endian::kLittle, Access::kRead>;
+using DataBl2       = Reg<0x2c, 2, Endian::kLittle, Access::kRead>;
+using DataBl3       = Reg<0x2e, 2, Endian::kLittle, Access::kRead>;
+using GprRead0      = Reg<0x48, 2, Endian::kLittle, Access::kRead>;
+using GprRead2      = Reg<0x4a, 2, Endian::kLittle, Access::kRead>;
+using GprRead4      = Reg<0x4c, 2, Endian::kLittle, Access::kRead>;
+using GprRead6      = Reg<0x4e, 2, Endian::kLittle, Access::kRead>;
+
+using StatusNewData = Field<DeviceStatus, 1, 1>;
+using AqiUba        = Field<DataAqi, 0, 3>;
+
+using DataBurst         = Burst<DeviceStatus, DataAqi, DataTvoc, DataEtoh, DataEco2>;
+using CompensationBurst = Burst<TempIn, RhIn>;
+using BaselineBurst     = Burst<DataBl0, DataBl1, DataBl2, DataBl3>;
+using ResistanceBurst   = Burst<GprRead0, GprRead2, GprRead4, GprRead6>;
+
+static_assert(DataBurst::kSize == 6 && CompensationBurst::kWritable, "ENS160 register map");
+
+template <typename B, typename R0, typename R1, typename R2, typename R3>
+esp_err_t read_quad(i2c_master_dev_handle_t dev, uint16_t raw[4]) {
+    regmap::I2cBus bus = { dev, I2C_XFR_TIMEOUT_MS };
+    typename B::Buffer rx;
+    esp_err_t ret = regmap::Read<B>(bus, rx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    raw[0] = B::template Get<R0>(rx);
+    raw[1] = B::template Get<R1>(rx);
+    raw[2] = B::template Get<R2>(rx);
+    raw[3] = B::template Get<R3>(rx);
+    return ESP_OK;
+}
+
+}  // namespace
+
+esp_err_t ens160_regs_read_data(i2c_master_dev_handle_t dev, ens160_regs_data_t *const data) {
+    regmap::I2cBus bus = { dev, I2C_XFR_TIMEOUT_MS };
+    DataBurst::Buffer rx;
+    esp_err_t ret = regmap::Read<DataBurst>(bus, rx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    data->status   = DataBurst::Get<DeviceStatus>(rx);
+    data->new_data = DataBurst::GetField<StatusNewData>(rx) != 0;
+    data->aqi_uba  = DataBurst::GetField<AqiUba>(rx);
+    data->tvoc     = DataBurst::Get<DataTvoc>(rx);
+    data->etoh     = DataBurst::Get<DataEtoh>(rx);
+    data->eco2     = DataBurst::Get<DataEco2>(rx);
+    return ESP_OK;
+}
+
+esp_err_t ens160_regs_read_compensation(i2c_master_dev_handle_t dev, uint16_t *const temperature, uint16_t *const humidity) {
+    regmap::I2cBus bus = { dev, I2C_XFR_TIMEOUT_MS };
+    CompensationBurst::Buffer rx;
+    esp_err_t ret = regmap::Read<CompensationBurst>(bus, rx);
+    if (ret != ESP_OK) {
+        return ret;
+    }
+    *temperature = CompensationBurst::Get<TempIn>(rx);
+    *humidity    = CompensationBurst::Get<RhIn>(rx);
+    return ESP_OK;
+}
+
+esp_err_t ens160_regs_write_compensation(i2c_master_dev_handle_t dev, const uint16_t temperature, const uint16_t humidity) {
+    regmap::I2cBus bus = { dev, I2C_XFR_TIMEOUT_MS };
+    CompensationBurst::Buffer tx;
+    CompensationBurst::Put<TempIn>(tx, temperature);
+    CompensationBurst::Put<RhIn>(tx, humidity);
+    return regmap::Write<CompensationBurst>(bus, tx);
+}
+
+esp_err_t ens160_regs_read_resistances(i2c_master_dev_handle_t dev, uint16_t raw[4]) {
+    return read_quad<ResistanceBurst, GprRead0, GprRead2, GprRead4, GprRead6>(dev, raw);
+}
+
+esp_err_t ens160_regs_read_baselines(i2c_master_dev_handle_t dev, uint16_t raw[4]) {
+    return read_quad<BaselineBurst, DataBl0, DataBl1, DataBl2, DataBl3>(dev, raw);
+}
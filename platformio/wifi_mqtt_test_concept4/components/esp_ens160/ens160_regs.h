@@ -0,0 +1,81 @@
+/*
+ * ENS160 register transactions generated from the register map in ens160_regs.cc.
+ *
+ * Each call is one I2C transaction covering adjacent registers, values come back
+ * decoded in host order.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "driver/i2c_master.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief ENS160 status and data registers (0x20..0x25) decoded.
+ */
+typedef struct ens160_regs_data_s {
+    uint8_t     status;         /*!< DEVICE_STATUS register */
+    bool        new_data;       /*!< DEVICE_STATUS new data bit, the data fields are current */
+    uint8_t     aqi_uba;        /*!< DATA_AQI air quality index per UBA */
+    uint16_t    tvoc;           /*!< DATA_TVOC in ppb */
+    uint16_t    etoh;           /*!< DATA_ETOH in ppb, alias of DATA_TVOC */
+    uint16_t    eco2;           /*!< DATA_ECO2 in ppm */
+} ens160_regs_data_t;
+
+/**
+ * @brief Reads the status and data registers in one burst.
+ * 
+ * @param dev ENS160 I2C device.
+ * @param data Decoded registers.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t ens160_regs_read_data(i2c_master_dev_handle_t dev, ens160_regs_data_t *const data);
+
+/**
+ * @brief Reads the TEMP_IN and RH_IN compensation registers in one burst.
+ * 
+ * @param dev ENS160 I2C device.
+ * @param temperature Encoded temperature, Kelvin * 64.
+ * @param humidity Encoded relative humidity, % * 512.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t ens160_regs_read_compensation(i2c_master_dev_handle_t dev, uint16_t *const temperature, uint16_t *const humidity);
+
+/**
+ * @brief Writes the TEMP_IN and RH_IN compensation registers in one burst.
+ * 
+ * @param dev ENS160 I2C device.
+ * @param temperature Encoded temperature, Kelvin * 64.
+ * @param humidity Encoded relative humidity, % * 512.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t ens160_regs_write_compensation(i2c_master_dev_handle_t dev, const uint16_t temperature, const uint16_t humidity);
+
+/**
+ * @brief Reads the four raw hot plate resistances from GPR_READ0..7 in one burst.
+ * 
+ * @param dev ENS160 I2C device.
+ * @param raw Raw resistances of hot plates 0..3.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t ens160_regs_read_resistances(i2c_master_dev_handle_t dev, uint16_t raw[4]);
+
+/**
+ * @brief Reads the four raw hot plate baselines from DATA_BL in one burst.
+ * 
+ * @param dev ENS160 I2C device.
+ * @param raw Raw baseline resistances of hot plates 0..3.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t ens160_regs_read_baselines(i2c_master_dev_handle_t dev, uint16_t raw[4]);
+
+#ifdef __cplusplus
+}
+#endif
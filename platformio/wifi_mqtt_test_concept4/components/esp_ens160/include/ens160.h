@@ -263,6 +263,7 @@ struct ens160_context_t {
     ens160_config_t                     dev_config;             /*!< ens160 configuration */
     i2c_master_dev_handle_t             i2c_handle;             /*!< ens160 i2c device handle */
     uint16_t                            part_id;                /*!< ens160 part identifier */
+    bool                                static_storage;         /*!< true when the context was provided to ens160_init_static() */
     //i2c_ens160_operating_modes_t            mode;               /*!< ens160 operating mode */
     //float                                   temperature_comp;   /*!< ens160 temperature compensation in degrees Celsius */
     //float                                   humidity_comp;      /*!< ens160 humidity compensation in percentage */
@@ -352,6 +353,17 @@ esp_err_t ens160_get_part_id_register(ens160_handle_t handle, uint16_t *const re
  */
 esp_err_t ens160_init(i2c_master_bus_handle_t master_handle, const ens160_config_t *ens160_config, ens160_handle_t *ens160_handle);
 
+/**
+ * @brief Initializes an ENS160 device onto the I2C master bus without allocating the context.
+ *
+ * @param[in] master_handle I2C master bus handle.
+ * @param[in] ens160_config ENS160 device configuration.
+ * @param[in] ens160_storage Caller provided context, must outlive the handle.
+ * @param[out] ens160_handle ENS160 device handle, points to ens160_storage.
+ * @return esp_err_t ESP_OK on success.
+ */
+esp_err_t ens160_init_static(i2c_master_bus_handle_t master_handle, const ens160_config_t *ens160_config, ens160_context_t *ens160_storage, ens160_handle_t *ens160_handle);
+
 /**
  * @brief Reads calculated air quality measurements from ENS160.
  * 
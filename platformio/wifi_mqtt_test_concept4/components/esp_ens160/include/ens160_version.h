@@ -43,15 +43,15 @@ extern "C" {
 
 #define ENS160_COMPONENT_NAME              "esp_ens160"
 /** Version release date  */
-#define ENS160_FW_VERSION_DATE             "2025-04-02"
+#define ENS160_FW_VERSION_DATE             "2026-10-19"
 /** Major version number (X.x.x) */
 #define ENS160_FW_VERSION_MAJOR            1
 /** Minor version number (x.X.x) */
-#define ENS160_FW_VERSION_MINOR            2
+#define ENS160_FW_VERSION_MINOR            3
 /** Patch version number (x.x.X) */
-#define ENS160_FW_VERSION_PATCH            5
+#define ENS160_FW_VERSION_PATCH            0
 /** Semantic version number (X.X.X-X) */
-#define ENS160_FW_SEMANTIC_VERSION         "1.2.5-1"
+#define ENS160_FW_SEMANTIC_VERSION         "1.3.0-1"
 /** Git version hash */
 #define ENS160_FW_GIT_SHORT_SHA            "82602db"
 
@@ -0,0 +1,81 @@
+/*
+ * Fixed-point forecaster for transmission suppression.
+ *
+ * Keep in sync with tools/forecast.py, every operation here has to give the same
+ * result there: only integer arithmetic, divisions truncate toward zero.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <string.h>
+#include "forecast.h"
+
+// rounds half away from zero, C division truncates
+static inline int64_t forecast_div_round(int64_t num, int64_t den)
+{
+    return (num >= 0 ? num + den / 2 : num - den / 2) / den;
+}
+
+static inline int32_t forecast_clamp(int64_t v, int32_t limit)
+{
+    return v > limit ? limit : v < -limit ? -limit : (int32_t)v;
+}
+
+void forecast_init(forecast_t *f, int32_t tolerance)
+{
+    forecast_reset(f, 0);
+    f->tolerance = tolerance;
+}
+
+void forecast_reset(forecast_t *f, int32_t value)
+{
+    f->last = value;
+    memset(f->diff, 0, sizeof(f->diff));
+    memset(f->coef, 0, sizeof(f->coef));
+    f->coef[0] = FORECAST_COEF_INIT;
+}
+
+int32_t forecast_predict(const forecast_t *f)
+{
+    int64_t acc = 0;
+    for (int i = 0; i < FORECAST_ORDER; i++) {
+        acc += (int64_t)f->coef[i] * f->diff[i];
+    }
+    return forecast_clamp(f->last + forecast_div_round(acc, 1 << FORECAST_Q), INT32_MAX);
+}
+
+bool forecast_exceeds(const forecast_t *f, int32_t actual)
+{
+    int64_t err = (int64_t)actual - forecast_predict(f);
+    return err > f->tolerance || err < -f->tolerance;
+}
+
+static void forecast_push(forecast_t *f, int32_t value)
+{
+    for (int i = FORECAST_ORDER - 1; i > 0; i--) {
+        f->diff[i] = f->diff[i - 1];
+    }
+    f->diff[0] = forecast_clamp((int64_t)value - f->last, INT32_MAX);
+    f->last = value;
+}
+
+void forecast_observe(forecast_t *f, int32_t actual)
+{
+    int64_t err = (int64_t)actual - forecast_predict(f);
+    int64_t energy = 1;
+    for (int i = 0; i < FORECAST_ORDER; i++) {
+        energy += (int64_t)f->diff[i] * f->diff[i];
+    }
+    // NLMS: coef += mu * err * diff / (1 + |diff|^2), in Q14
+    for (int i = 0; i < FORECAST_ORDER; i++) {
+        int64_t step = forecast_div_round(err * f->diff[i] * (1 << (FORECAST_Q - FORECAST_MU_SHIFT)), energy);
+        f->coef[i] = forecast_clamp(f->coef[i] + step, FORECAST_COEF_MAX);
+    }
+    forecast_push(f, actual);
+}
+
+int32_t forecast_skip(forecast_t *f)
+{
+    int32_t value = forecast_predict(f);
+    forecast_push(f, value);
+    return value;
+}
@@ -0,0 +1,71 @@
+/*
+ * Fixed-point forecaster for transmission suppression.
+ *
+ * A per channel AR(2) model on first differences with NLMS coefficient updates,
+ * integer only so that the node and the gateway (tools/forecast.py, bit exact port)
+ * compute the same prediction. Both sides feed the model the reconstructed series:
+ * the transmitted value when there was a transmission, the prediction otherwise.
+ * Coefficients only adapt on transmitted samples, whose error both sides know.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define FORECAST_ORDER      2       /*!< differences the prediction is built from */
+#define FORECAST_Q          14      /*!< coefficients are Q2.14 */
+#define FORECAST_MU_SHIFT   2       /*!< NLMS step size 2^-2 */
+#define FORECAST_COEF_MAX   (2 << FORECAST_Q)   /*!< coefficients are clamped to +-2.0 */
+#define FORECAST_COEF_INIT  (1 << (FORECAST_Q - 1)) /*!< first coefficient after a reset: damped trend 0.5 */
+
+/**
+ * @brief State of one channel, e.g. temperature in 0.01 C
+ */
+typedef struct {
+    int32_t last;                   /*!< last reconstructed value */
+    int32_t diff[FORECAST_ORDER];   /*!< last differences of the reconstructed series, newest first */
+    int32_t coef[FORECAST_ORDER];   /*!< Q2.14 */
+    int32_t tolerance;              /*!< largest error that is not transmitted */
+} forecast_t;
+
+/**
+ * @brief Set up a channel, call forecast_reset() with the first value before stepping
+ */
+void forecast_init(forecast_t *f, int32_t tolerance);
+
+/**
+ * @brief Forget history and coefficients, continue from a known value (keyframe)
+ */
+void forecast_reset(forecast_t *f, int32_t value);
+
+/**
+ * @brief Prediction of the next sample
+ */
+int32_t forecast_predict(const forecast_t *f);
+
+/**
+ * @brief True when the actual value is farther than the tolerance from the prediction
+ */
+bool forecast_exceeds(const forecast_t *f, int32_t actual);
+
+/**
+ * @brief Advance one sample that was transmitted, adapts the coefficients
+ */
+void forecast_observe(forecast_t *f, int32_t actual);
+
+/**
+ * @brief Advance one sample that was not transmitted
+ *
+ * @return the reconstructed value, i.e. the prediction
+ */
+int32_t forecast_skip(forecast_t *f);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,233 @@
+/*
+ * LAN-first gateway discovery.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdbool.h>
+#include <stdio.h>
+#include <string.h>
+#include <sys/param.h>
+#include "esp_log.h"
+#include "esp_random.h"
+#include "esp_timer.h"
+#include "lwip/netdb.h"
+#include "gw_discovery.h"
+
+#define GW_TIMEOUT_US   (CONFIG_GW_DISCOVERY_TIMEOUT_MS * 1000LL)
+
+static const char *TAG = "gw_discovery";
+
+static struct {
+    char host[GW_DISCOVERY_HOST_MAX];
+    int sock;
+    gw_path_t path;
+    struct in_addr addr;
+    int64_t expires_us;
+    uint32_t failures;
+} s_gw = {
+    .sock = -1,
+};
+
+/*
+ * One query to dest and the wait for its answer. Answers to earlier queries that
+ * arrive late carry another nonce and are skipped.
+ *
+ * Returns the round trip in microseconds, -1 when nothing matching came back.
+ */
+static int32_t gw_query(const struct sockaddr_in *dest, struct in_addr *from)
+{
+    char query[GW_DISCOVERY_MSG_SIZE];
+    char answer[GW_DISCOVERY_MSG_SIZE];
+    uint32_t nonce = esp_random();
+    int len = snprintf(query, sizeof(query), GW_DISCOVERY_QUERY " %08lx", (unsigned long)nonce);
+    snprintf(answer, sizeof(answer), GW_DISCOVERY_ANSWER " %08lx", (unsigned long)nonce);
+
+    int64_t start = esp_timer_get_time();
+    if (sendto(s_gw.sock, query, len, 0, (const struct sockaddr *)dest, sizeof(*dest)) < 0) {
+        return -1;
+    }
+    for (;;) {
+        int64_t left = GW_TIMEOUT_US - (esp_timer_get_time() - start);
+        if (left <= 0) {
+            return -1;
+        }
+        struct timeval tv = {
+            .tv_sec = left / 1000000,
+            .tv_usec = left % 1000000,
+        };
+        setsockopt(s_gw.sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+
+        char buf[GW_DISCOVERY_MSG_SIZE];
+        struct sockaddr_in src;
+        socklen_t src_len = sizeof(src);
+        int n = recvfrom(s_gw.sock, buf, sizeof(buf), 0, (struct sockaddr *)&src, &src_len);
+        if (n < 0) {
+            return -1;
+        }
+        if (n == len && memcmp(buf, answer, len) == 0) {
+            if (from) {
+                *from = src.sin_addr;
+            }
+            return (int32_t)(esp_timer_get_time() - start);
+        }
+    }
+}
+
+static bool gw_find_lan(struct in_addr *addr)
+{
+#if CONFIG_GW_DISCOVERY_ENABLE
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_GW_DISCOVERY_PORT),
+        .sin_addr.s_addr = htonl(INADDR_BROADCAST),
+    };
+    for (int i = 0; i < CONFIG_GW_DISCOVERY_ATTEMPTS; i++) {
+        if (gw_query(&dest, addr) >= 0) {
+            return true;
+        }
+    }
+#endif
+    return false;
+}
+
+static bool gw_resolve_fallback(struct in_addr *addr)
+{
+    struct hostent *he = gethostbyname(s_gw.host);
+    if (!he || he->h_addr_list == NULL || he->h_addr_list[0] == NULL) {
+        return false;
+    }
+    memcpy(addr, he->h_addr_list[0], sizeof(*addr));
+    return true;
+}
+
+static void gw_lookup(void)
+{
+    int64_t now = esp_timer_get_time();
+    if (gw_find_lan(&s_gw.addr)) {
+        s_gw.path = GW_PATH_LAN;
+        s_gw.expires_us = now + CONFIG_GW_DISCOVERY_TTL_S * 1000000LL;
+    } else if (gw_resolve_fallback(&s_gw.addr)) {
+        s_gw.path = GW_PATH_DDNS;
+        s_gw.expires_us = now + CONFIG_GW_DISCOVERY_RETRY_S * 1000000LL;
+    } else {
+        // try again on the next send, the sensor loop paces the retries
+        s_gw.path = GW_PATH_NONE;
+        ESP_LOGW(TAG, "no gateway on the LAN and %s did not resolve", s_gw.host);
+        return;
+    }
+    s_gw.failures = 0;
+    ESP_LOGI(TAG, "gateway %s via %s", inet_ntoa(s_gw.addr), gw_discovery_path_name(s_gw.path));
+}
+
+esp_err_t gw_discovery_init(const char *fallback_host)
+{
+    if (fallback_host == NULL || strlen(fallback_host) >= sizeof(s_gw.host)) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    strcpy(s_gw.host, fallback_host);
+    if (s_gw.sock < 0) {
+        s_gw.sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+        if (s_gw.sock < 0) {
+            ESP_LOGE(TAG, "unable to create query socket");
+            return ESP_FAIL;
+        }
+        int on = 1;
+        setsockopt(s_gw.sock, SOL_SOCKET, SO_BROADCAST, &on, sizeof(on));
+    }
+    gw_discovery_invalidate();
+    return ESP_OK;
+}
+
+gw_path_t gw_discovery_get(uint16_t port, struct sockaddr_in *dest)
+{
+    if (s_gw.sock < 0) {
+        return GW_PATH_NONE;
+    }
+    if (s_gw.path == GW_PATH_NONE || esp_timer_get_time() >= s_gw.expires_us) {
+        gw_lookup();
+    }
+    if (s_gw.path != GW_PATH_NONE) {
+        memset(dest, 0, sizeof(*dest));
+        dest->sin_family = AF_INET;
+        dest->sin_port = htons(port);
+        dest->sin_addr = s_gw.addr;
+    }
+    return s_gw.path;
+}
+
+void gw_discovery_report_failure(void)
+{
+    if (s_gw.path != GW_PATH_NONE && ++s_gw.failures >= CONFIG_GW_DISCOVERY_MAX_FAILURES) {
+        ESP_LOGW(TAG, "%lu failed sends to %s, looking up again", (unsigned long)s_gw.failures, inet_ntoa(s_gw.addr));
+        gw_discovery_invalidate();
+    }
+}
+
+void gw_discovery_report_success(void)
+{
+    s_gw.failures = 0;
+}
+
+void gw_discovery_invalidate(void)
+{
+    s_gw.path = GW_PATH_NONE;
+    s_gw.failures = 0;
+}
+
+static void gw_probe(const struct sockaddr_in *dest, uint32_t probes, gw_path_stats_t *stats)
+{
+    uint64_t total = 0;
+    stats->rtt_min_us = UINT32_MAX;
+    for (uint32_t i = 0; i < probes; i++) {
+        int32_t rtt = gw_query(dest, NULL);
+        stats->sent++;
+        if (rtt < 0) {
+            continue;
+        }
+        stats->received++;
+        total += (uint32_t)rtt;
+        stats->rtt_min_us = MIN(stats->rtt_min_us, (uint32_t)rtt);
+        stats->rtt_max_us = MAX(stats->rtt_max_us, (uint32_t)rtt);
+    }
+    if (stats->received) {
+        stats->rtt_avg_us = (uint32_t)(total / stats->received);
+    } else {
+        stats->rtt_min_us = 0;
+    }
+}
+
+esp_err_t gw_discovery_compare(uint32_t probes, gw_path_stats_t *lan, gw_path_stats_t *ddns)
+{
+    if (lan == NULL || ddns == NULL) {
+        return ESP_ERR_INVALID_ARG;
+    }
+    if (s_gw.sock < 0) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    memset(lan, 0, sizeof(*lan));
+    memset(ddns, 0, sizeof(*ddns));
+
+    struct sockaddr_in dest = {
+        .sin_family = AF_INET,
+        .sin_port = htons(CONFIG_GW_DISCOVERY_PORT),
+    };
+    if (gw_find_lan(&dest.sin_addr)) {
+        gw_probe(&dest, probes, lan);
+    }
+    if (gw_resolve_fallback(&dest.sin_addr)) {
+        gw_probe(&dest, probes, ddns);
+    }
+    return ESP_OK;
+}
+
+const char *gw_discovery_path_name(gw_path_t path)
+{
+    switch (path) {
+    case GW_PATH_LAN:
+        return "LAN";
+    case GW_PATH_DDNS:
+        return "DDNS";
+    default:
+        return "none";
+    }
+}
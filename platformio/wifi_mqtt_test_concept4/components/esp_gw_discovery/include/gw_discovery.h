@@ -0,0 +1,114 @@
+/*
+ * LAN-first gateway discovery.
+ *
+ * The node broadcasts a query on CONFIG_GW_DISCOVERY_PORT and sends to whichever
+ * gateway answers, the DDNS name is only resolved when nobody does. The address is
+ * cached, a LAN address for CONFIG_GW_DISCOVERY_TTL_S, the fallback for
+ * CONFIG_GW_DISCOVERY_RETRY_S, so nothing is looked up per datagram.
+ *
+ * Wire format, plain text so the gateway side stays a few lines of Python:
+ *
+ *   query   "GWDISC? <nonce>"   nonce is 8 hex digits
+ *   answer  "GWDISC! <nonce>"   sent back to the source of the query
+ *
+ * Not thread safe, use it from the task that sends the datagrams.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "lwip/sockets.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define GW_DISCOVERY_QUERY      "GWDISC?"
+#define GW_DISCOVERY_ANSWER     "GWDISC!"
+#define GW_DISCOVERY_MSG_SIZE   17      /*!< "GWDISC? 0123abcd" plus terminator */
+#define GW_DISCOVERY_HOST_MAX   64      /*!< longest fallback host name */
+
+/**
+ * @brief Where the cached gateway address came from
+ */
+typedef enum {
+    GW_PATH_NONE = 0,   /*!< no gateway known */
+    GW_PATH_LAN,        /*!< answered a broadcast query */
+    GW_PATH_DDNS,       /*!< fallback host name */
+} gw_path_t;
+
+/**
+ * @brief Round trips of one path, all times in microseconds
+ */
+typedef struct {
+    uint32_t sent;          /*!< queries sent */
+    uint32_t received;      /*!< matching answers within the timeout */
+    uint32_t rtt_min_us;
+    uint32_t rtt_avg_us;
+    uint32_t rtt_max_us;
+} gw_path_stats_t;
+
+/**
+ * @brief Open the query socket, call once the station has an IP
+ *
+ * @param fallback_host: DDNS name used when no gateway answers on the LAN
+ *
+ * @return
+ *      - ESP_OK: Ready, the first gw_discovery_get() does the lookup
+ *      - ESP_ERR_INVALID_ARG: No or too long host name
+ *      - ESP_FAIL: Socket could not be created
+ */
+esp_err_t gw_discovery_init(const char *fallback_host);
+
+/**
+ * @brief Gateway address for a datagram, looked up again only when the cache expired
+ *
+ * @param port: destination port written to dest
+ * @param dest: returned destination, untouched when no gateway is known
+ *
+ * @return path of the address, GW_PATH_NONE when neither the LAN nor the fallback answered
+ */
+gw_path_t gw_discovery_get(uint16_t port, struct sockaddr_in *dest);
+
+/**
+ * @brief Count a failed send, the address is dropped after CONFIG_GW_DISCOVERY_MAX_FAILURES in a row
+ */
+void gw_discovery_report_failure(void);
+
+/**
+ * @brief Count a successful send, resets the failure count
+ */
+void gw_discovery_report_success(void);
+
+/**
+ * @brief Drop the cached address, the next gw_discovery_get() looks up again
+ */
+void gw_discovery_invalidate(void);
+
+/**
+ * @brief Time unicast queries to the LAN gateway and to the fallback host
+ *
+ * Blocks for up to 2 * probes * CONFIG_GW_DISCOVERY_TIMEOUT_MS. A path that could
+ * not be found is reported with sent = 0.
+ *
+ * @param probes: queries per path
+ * @param lan: returned statistics of the LAN path
+ * @param ddns: returned statistics of the DDNS path
+ *
+ * @return
+ *      - ESP_OK: Both paths were tried
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ *      - ESP_ERR_INVALID_STATE: gw_discovery_init() was not called
+ */
+esp_err_t gw_discovery_compare(uint32_t probes, gw_path_stats_t *lan, gw_path_stats_t *ddns);
+
+/**
+ * @brief Short name of a path for logs
+ */
+const char *gw_discovery_path_name(gw_path_t path);
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,141 @@
+/*
+ * Heap allocation watch.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_attr.h"
+#include "esp_heap_caps.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+#include "heap_watch.h"
+
+#ifndef CONFIG_HEAP_WATCH_MAX_TASKS
+#define CONFIG_HEAP_WATCH_MAX_TASKS 1   // hook not installed, the table stays empty
+#endif
+
+typedef struct {
+    TaskHandle_t task;
+    uint32_t allocs;
+    uint32_t bytes;
+    char name[CONFIG_FREERTOS_MAX_TASK_NAME_LEN];
+} heap_watch_task_t;
+
+static const char *TAG = "heap_watch";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static volatile bool s_armed;
+static TaskHandle_t s_strict_task;
+static uint32_t s_strict_allocs;
+static uint32_t s_strict_bytes;
+static uint32_t s_untracked;    // allocations of tasks that did not fit into s_tasks
+static heap_watch_task_t s_tasks[CONFIG_HEAP_WATCH_MAX_TASKS];
+
+#if CONFIG_HEAP_WATCH_ENABLE
+/*
+ * Called by heap_caps for every successful allocation, with the heap lock held.
+ * Must not allocate and stays in IRAM like the heap itself.
+ */
+void IRAM_ATTR esp_heap_trace_alloc_hook(void *ptr, size_t size, uint32_t caps)
+{
+    (void)caps;
+    if (!s_armed || ptr == NULL) {
+        return;
+    }
+    TaskHandle_t task = xTaskGetCurrentTaskHandle();
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    heap_watch_task_t *slot = NULL;
+    for (int i = 0; i < CONFIG_HEAP_WATCH_MAX_TASKS; i++) {
+        if (s_tasks[i].task == task) {
+            slot = &s_tasks[i];
+            break;
+        }
+        if (s_tasks[i].task == NULL) {
+            slot = &s_tasks[i];
+            slot->task = task;
+            strlcpy(slot->name, task ? pcTaskGetName(task) : "(no task)", sizeof(slot->name));
+            break;
+        }
+    }
+    if (slot) {
+        slot->allocs++;
+        slot->bytes += size;
+    } else {
+        s_untracked++;
+    }
+    if (task != NULL && task == s_strict_task) {
+        s_strict_allocs++;
+        s_strict_bytes += size;
+    }
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+#endif
+
+void heap_watch_arm(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    memset(s_tasks, 0, sizeof(s_tasks));
+    s_strict_allocs = 0;
+    s_strict_bytes = 0;
+    s_untracked = 0;
+    s_armed = true;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+void heap_watch_strict_begin(void)
+{
+    s_strict_task = xTaskGetCurrentTaskHandle();
+}
+
+void heap_watch_strict_end(void)
+{
+    s_strict_task = NULL;
+}
+
+uint32_t heap_watch_strict_allocs(void)
+{
+    return s_strict_allocs;
+}
+
+esp_err_t heap_watch_report(void)
+{
+#if !CONFIG_HEAP_WATCH_ENABLE
+    return ESP_ERR_NOT_SUPPORTED;
+#endif
+    if (!s_armed) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    heap_watch_task_t tasks[CONFIG_HEAP_WATCH_MAX_TASKS];
+    uint32_t strict_allocs, strict_bytes, untracked;
+
+    portENTER_CRITICAL(&s_lock);
+    memcpy(tasks, s_tasks, sizeof(tasks));
+    strict_allocs = s_strict_allocs;
+    strict_bytes = s_strict_bytes;
+    untracked = s_untracked;
+    portEXIT_CRITICAL(&s_lock);
+
+    for (int i = 0; i < CONFIG_HEAP_WATCH_MAX_TASKS && tasks[i].task; i++) {
+        printf("#HEAP,task,%s,%lu,%lu\n", tasks[i].name, (unsigned long)tasks[i].allocs, (unsigned long)tasks[i].bytes);
+    }
+    if (untracked) {
+        printf("#HEAP,task,(other),%lu,0\n", (unsigned long)untracked);
+    }
+    printf("#HEAP,strict,%lu,%lu\n", (unsigned long)strict_allocs, (unsigned long)strict_bytes);
+    printf("#HEAP,free,%u,%u,%u\n", (unsigned)heap_caps_get_free_size(MALLOC_CAP_DEFAULT),
+           (unsigned)heap_caps_get_minimum_free_size(MALLOC_CAP_DEFAULT),
+           (unsigned)heap_caps_get_largest_free_block(MALLOC_CAP_DEFAULT));
+
+    if (strict_allocs == 0) {
+        ESP_LOGI(TAG, "no allocation in strict sections since boot");
+    } else {
+        ESP_LOGW(TAG, "%lu allocation(s), %lu bytes in strict sections since boot",
+                 (unsigned long)strict_allocs, (unsigned long)strict_bytes);
+    }
+    return ESP_OK;
+}
@@ -0,0 +1,197 @@
+/*
+ * Link quality probe, portable core.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include "link_probe.h"
+
+#define WINDOW_MASK     (LINK_PROBE_WINDOW - 1)
+
+_Static_assert((LINK_PROBE_WINDOW & WINDOW_MASK) == 0 && LINK_PROBE_WINDOW <= 32,
+               "LINK_PROBE_WINDOW must be a power of two that fits the pending mask");
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    for (int i = 0; i < 4; i++) {
+        p[i] = (uint8_t)(v >> (8 * i));
+    }
+}
+
+static inline uint32_t get_u32(const uint8_t *p)
+{
+    return p[0] | p[1] << 8 | p[2] << 16 | (uint32_t)p[3] << 24;
+}
+
+/*
+ * 16 us linear buckets below 64 us, then every octave split in 4, so a bucket is at
+ * most a quarter of its lower edge wide. Bucket 63 takes everything from 1.8 s up.
+ */
+static uint32_t hist_bucket(uint32_t us)
+{
+    if (us < 64) {
+        return us >> 4;
+    }
+    uint32_t msb = 31 - __builtin_clz(us);
+    uint32_t b = (msb - 5) * 4 + ((us >> (msb - 2)) & 3);
+    return b < LINK_PROBE_HIST_BUCKETS ? b : LINK_PROBE_HIST_BUCKETS - 1;
+}
+
+static uint32_t hist_upper(uint32_t b)
+{
+    if (b < 4) {
+        return (b + 1) * 16 - 1;
+    }
+    uint32_t msb = b / 4 + 5;
+    return ((4 + b % 4 + 1) << (msb - 2)) - 1;
+}
+
+void link_probe_init(link_probe_t *p, uint32_t timeout_us)
+{
+    memset(p, 0, sizeof(*p));
+    p->timeout_us = timeout_us;
+}
+
+size_t link_probe_make(link_probe_t *p, int64_t now_us, uint8_t *buf, size_t size)
+{
+    if (size < LINK_PROBE_SIZE) {
+        return 0;
+    }
+    uint32_t seq = p->next_seq++;
+    uint32_t bit = 1u << (seq & WINDOW_MASK);
+    if (p->pending & bit) {
+        // the window came around before the probe in this slot expired
+        p->lost++;
+    }
+    p->pending |= bit;
+    p->expired &= ~bit;
+    p->sent_at[seq & WINDOW_MASK] = (uint32_t)now_us;
+    p->sent++;
+
+    put_u32(buf, LINK_PROBE_MAGIC);
+    put_u32(buf + 4, seq);
+    put_u32(buf + 8, (uint32_t)now_us);
+    put_u32(buf + 12, (uint32_t)((uint64_t)now_us >> 32));
+    return LINK_PROBE_SIZE;
+}
+
+static void link_probe_account(link_probe_t *p, uint32_t rtt)
+{
+    p->received++;
+    if (p->received == 1) {
+        p->rtt_min_us = rtt;
+        p->srtt_us = rtt;
+        p->rttvar_us = rtt / 2;
+    } else {
+        uint32_t delta = rtt > p->rtt_last_us ? rtt - p->rtt_last_us : p->rtt_last_us - rtt;
+        p->jitter_x16 += delta - (p->jitter_x16 >> 4);
+        uint32_t err = rtt > p->srtt_us ? rtt - p->srtt_us : p->srtt_us - rtt;
+        p->rttvar_us = p->rttvar_us - (p->rttvar_us >> 2) + (err >> 2);
+        p->srtt_us = p->srtt_us - (p->srtt_us >> 3) + (rtt >> 3);
+    }
+    p->rtt_min_us = rtt < p->rtt_min_us ? rtt : p->rtt_min_us;
+    p->rtt_max_us = rtt > p->rtt_max_us ? rtt : p->rtt_max_us;
+    p->rtt_last_us = rtt;
+    p->hist[hist_bucket(rtt)]++;
+}
+
+link_probe_result_t link_probe_reply(link_probe_t *p, const uint8_t *buf, size_t len, int64_t now_us)
+{
+    if (len != LINK_PROBE_SIZE || get_u32(buf) != LINK_PROBE_MAGIC) {
+        return LINK_PROBE_INVALID;
+    }
+    uint32_t seq = get_u32(buf + 4);
+    uint64_t sent_us = get_u32(buf + 8) | (uint64_t)get_u32(buf + 12) << 32;
+    // only probes of the current window can be outstanding, older ones were settled
+    if (p->next_seq - seq - 1 >= LINK_PROBE_WINDOW || (uint64_t)now_us < sent_us) {
+        p->duplicate++;
+        return LINK_PROBE_DUPLICATE;
+    }
+    uint32_t bit = 1u << (seq & WINDOW_MASK);
+    if (p->sent_at[seq & WINDOW_MASK] != (uint32_t)sent_us) {
+        p->duplicate++;
+        return LINK_PROBE_DUPLICATE;
+    }
+    if (p->expired & bit) {
+        // already counted lost by link_probe_expire()
+        p->expired &= ~bit;
+        p->late++;
+        return LINK_PROBE_LATE;
+    }
+    if (!(p->pending & bit)) {
+        p->duplicate++;
+        return LINK_PROBE_DUPLICATE;
+    }
+    p->pending &= ~bit;
+    uint64_t rtt = (uint64_t)now_us - sent_us;
+    if (rtt > p->timeout_us) {
+        p->late++;
+        p->lost++;
+        return LINK_PROBE_LATE;
+    }
+    link_probe_account(p, (uint32_t)rtt);
+    return LINK_PROBE_ANSWER;
+}
+
+void link_probe_expire(link_probe_t *p, int64_t now_us)
+{
+    for (uint32_t pending = p->pending; pending; pending &= pending - 1) {
+        uint32_t slot = __builtin_ctz(pending);
+        if ((uint32_t)now_us - p->sent_at[slot] > p->timeout_us) {
+            p->pending &= ~(1u << slot);
+            p->expired |= 1u << slot;
+            p->lost++;
+        }
+    }
+}
+
+uint32_t link_probe_percentile(const link_probe_t *p, uint32_t permille)
+{
+    if (p->received == 0) {
+        return 0;
+    }
+    uint32_t rank = (uint32_t)(((uint64_t)p->received * permille + 999) / 1000);
+    rank = rank ? rank : 1;
+    uint32_t seen = 0;
+    for (uint32_t b = 0; b < LINK_PROBE_HIST_BUCKETS; b++) {
+        seen += p->hist[b];
+        if (seen >= rank) {
+            uint32_t upper = hist_upper(b);
+            return upper < p->rtt_max_us ? upper : p->rtt_max_us;
+        }
+    }
+    return p->rtt_max_us;
+}
+
+uint32_t link_probe_loss_permille(const link_probe_t *p)
+{
+    uint32_t settled = p->received + p->lost;
+    return settled ? (uint32_t)((uint64_t)p->lost * 1000 / settled) : 0;
+}
+
+uint32_t link_probe_jitter_us(const link_probe_t *p)
+{
+    return p->jitter_x16 >> 4;
+}
+
+uint32_t link_probe_rto_us(const link_probe_t *p, uint32_t min_us, uint32_t max_us)
+{
+    if (p->received == 0) {
+        return max_us;
+    }
+    uint64_t rto = (uint64_t)p->srtt_us + 4ull * p->rttvar_us;
+    return rto < min_us ? min_us : rto > max_us ? max_us : (uint32_t)rto;
+}
+
+int link_probe_format(const link_probe_t *p, char *buf, size_t size)
+{
+    return snprintf(buf, size, "#PROBE,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n",
+                    (unsigned long)p->sent, (unsigned long)p->received, (unsigned long)p->lost,
+                    (unsigned long)p->late, (unsigned long)p->duplicate,
+                    (unsigned long)link_probe_loss_permille(p), (unsigned long)p->rtt_min_us,
+                    (unsigned long)link_probe_percentile(p, 500), (unsigned long)link_probe_percentile(p, 900),
+                    (unsigned long)link_probe_percentile(p, 990), (unsigned long)p->rtt_max_us,
+                    (unsigned long)p->srtt_us, (unsigned long)link_probe_jitter_us(p),
+                    (unsigned long)link_probe_rto_us(p, 0, UINT32_MAX));
+}
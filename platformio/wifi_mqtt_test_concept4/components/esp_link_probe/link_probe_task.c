@@ -0,0 +1,139 @@
+/*
+ * Link quality probe, node task.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_timer.h"
+#include "lwip/sockets.h"
+#include "link_probe.h"
+
+#if CONFIG_LINK_PROBE_ENABLE
+
+#define LINK_PROBE_TASK_STACK   3072
+#define LINK_PROBE_TASK_PRIO    6       // above the sensor task, answers are timestamped when they arrive
+#define LINK_PROBE_INTERVAL_US  (CONFIG_LINK_PROBE_INTERVAL_MS * 1000LL)
+
+static const char *TAG = "link_probe";
+
+static SemaphoreHandle_t s_lock;
+static link_probe_t s_probe;
+static struct sockaddr_in s_dest;       // sin_port 0 until a gateway is set
+static int s_sock = -1;
+
+static void link_probe_task(void *arg)
+{
+    uint8_t buf[LINK_PROBE_SIZE];
+    int64_t next_send = esp_timer_get_time();
+    for (;;) {
+        int64_t now = esp_timer_get_time();
+        if (now >= next_send) {
+            struct sockaddr_in dest;
+            size_t len = 0;
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            dest = s_dest;
+            if (dest.sin_port != 0) {
+                len = link_probe_make(&s_probe, now, buf, sizeof(buf));
+            }
+            xSemaphoreGive(s_lock);
+            if (len > 0) {
+                sendto(s_sock, buf, len, 0, (struct sockaddr *)&dest, sizeof(dest));
+            }
+            next_send += LINK_PROBE_INTERVAL_US;
+            if (next_send <= now) {
+                next_send = now + LINK_PROBE_INTERVAL_US;   // skip rounds we were late for
+            }
+        }
+
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        link_probe_expire(&s_probe, now);
+        xSemaphoreGive(s_lock);
+
+        int64_t wait = next_send - esp_timer_get_time();
+        if (wait <= 0) {
+            continue;
+        }
+        struct timeval tv = {
+            .tv_sec = wait / 1000000,
+            .tv_usec = wait % 1000000,
+        };
+        setsockopt(s_sock, SOL_SOCKET, SO_RCVTIMEO, &tv, sizeof(tv));
+        int n = recv(s_sock, buf, sizeof(buf), 0);
+        if (n > 0) {
+            int64_t arrived = esp_timer_get_time();
+            xSemaphoreTake(s_lock, portMAX_DELAY);
+            link_probe_reply(&s_probe, buf, n, arrived);
+            xSemaphoreGive(s_lock);
+        }
+    }
+}
+
+esp_err_t link_probe_start(void)
+{
+    if (s_lock) {
+        return ESP_ERR_INVALID_STATE;
+    }
+    s_sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (s_sock < 0) {
+        ESP_LOGE(TAG, "unable to create probe socket");
+        return ESP_FAIL;
+    }
+    s_lock = xSemaphoreCreateMutex();
+    if (s_lock == NULL) {
+        close(s_sock);
+        s_sock = -1;
+        return ESP_ERR_NO_MEM;
+    }
+    link_probe_init(&s_probe, CONFIG_LINK_PROBE_TIMEOUT_MS * 1000);
+    if (xTaskCreate(link_probe_task, "link_probe", LINK_PROBE_TASK_STACK, NULL, LINK_PROBE_TASK_PRIO, NULL) != pdPASS) {
+        vSemaphoreDelete(s_lock);
+        s_lock = NULL;
+        close(s_sock);
+        s_sock = -1;
+        return ESP_ERR_NO_MEM;
+    }
+    return ESP_OK;
+}
+
+void link_probe_set_gateway(const struct sockaddr_in *dest)
+{
+    if (s_lock == NULL || dest == NULL) {
+        return;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    if (dest->sin_addr.s_addr != s_dest.sin_addr.s_addr || dest->sin_port != s_dest.sin_port) {
+        // RTTs of another path would mix into the histogram
+        s_dest = *dest;
+        link_probe_init(&s_probe, CONFIG_LINK_PROBE_TIMEOUT_MS * 1000);
+        ESP_LOGI(TAG, "probing %s:%u", inet_ntoa(dest->sin_addr), ntohs(dest->sin_port));
+    }
+    xSemaphoreGive(s_lock);
+}
+
+int link_probe_report(char *buf, size_t size)
+{
+    if (s_lock == NULL) {
+        return 0;
+    }
+    xSemaphoreTake(s_lock, portMAX_DELAY);
+    int len = link_probe_format(&s_probe, buf, size);
+    xSemaphoreGive(s_lock);
+    return len;
+}
+
+uint32_t link_probe_get_rto_ms(void)
+{
+    uint32_t rto_us = CONFIG_LINK_PROBE_TIMEOUT_MS * 1000;
+    if (s_lock) {
+        xSemaphoreTake(s_lock, portMAX_DELAY);
+        rto_us = link_probe_rto_us(&s_probe, 1000, CONFIG_LINK_PROBE_TIMEOUT_MS * 1000);
+        xSemaphoreGive(s_lock);
+    }
+    return (rto_us + 999) / 1000;
+}
+
+#endif // CONFIG_LINK_PROBE_ENABLE
@@ -0,0 +1,146 @@
+/*
+ * Cycle counting micro-profiler.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdio.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "prof.h"
+
+static const char *TAG = "prof";
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static prof_zone_t *s_zones;
+
+/*
+ * Log-linear bins: values below 4 get a bin each, above that every power of two
+ * is split into 4 equal bins.
+ */
+static inline uint32_t prof_bin(uint32_t v)
+{
+    if (v < 4) {
+        return v;
+    }
+    uint32_t msb = 31 - __builtin_clz(v);
+    return 4 * (msb - 1) + ((v >> (msb - 2)) & 3);
+}
+
+static inline uint32_t prof_bin_upper(uint32_t bin)
+{
+    if (bin < 4) {
+        return bin;
+    }
+    uint32_t msb = bin / 4 + 1;
+    uint64_t next = (uint64_t)(4 + bin % 4 + 1) << (msb - 2);
+    return next > UINT32_MAX ? UINT32_MAX : (uint32_t)(next - 1);
+}
+
+prof_scope_t prof_scope_begin(prof_zone_t *zone)
+{
+    return (prof_scope_t) {
+        .zone = zone,
+        .start = esp_cpu_get_cycle_count(),
+    };
+}
+
+void prof_scope_end(prof_scope_t *scope)
+{
+    // unsigned difference is correct across one wrap of the 32-bit counter
+    prof_record(scope->zone, esp_cpu_get_cycle_count() - scope->start);
+}
+
+void prof_record(prof_zone_t *zone, uint32_t cycles)
+{
+    portENTER_CRITICAL_SAFE(&s_lock);
+    if (!zone->registered) {
+        zone->registered = 1;
+        zone->next = s_zones;
+        s_zones = zone;
+    }
+    zone->count++;
+    zone->total += cycles;
+    if (cycles < zone->min) {
+        zone->min = cycles;
+    }
+    if (cycles > zone->max) {
+        zone->max = cycles;
+    }
+    zone->hist[prof_bin(cycles)]++;
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+void prof_get_stats(const prof_zone_t *zone, prof_stats_t *stats)
+{
+    memset(stats, 0, sizeof(*stats));
+    if (zone->count == 0) {
+        return;
+    }
+    stats->count = zone->count;
+    stats->min = zone->min;
+    stats->max = zone->max;
+    stats->avg = (uint32_t)(zone->total / zone->count);
+
+    // p99 is the upper edge of the bin holding the 99th percentile sample, clamped to the real max
+    uint32_t rank = zone->count - zone->count / 100;
+    uint32_t seen = 0;
+    for (uint32_t bin = 0; bin < PROF_HIST_BINS; bin++) {
+        seen += zone->hist[bin];
+        if (seen >= rank) {
+            uint32_t upper = prof_bin_upper(bin);
+            stats->p99 = upper < zone->max ? upper : zone->max;
+            break;
+        }
+    }
+}
+
+static int prof_format(char *buf, size_t size, const prof_zone_t *zone)
+{
+    prof_stats_t stats;
+    portENTER_CRITICAL(&s_lock);
+    prof_get_stats(zone, &stats);
+    portEXIT_CRITICAL(&s_lock);
+    return snprintf(buf, size, "#PROF,%s,%lu,%lu,%lu,%lu,%lu\n", zone->name,
+                    (unsigned long)stats.count, (unsigned long)stats.min, (unsigned long)stats.avg,
+                    (unsigned long)stats.max, (unsigned long)stats.p99);
+}
+
+size_t prof_export(char *buf, size_t size)
+{
+    size_t out = 0;
+    for (prof_zone_t *zone = s_zones; zone; zone = zone->next) {
+        int n = prof_format(buf + out, size - out, zone);
+        if (n < 0 || (size_t)n >= size - out) {
+            break;
+        }
+        out += n;
+    }
+    return out;
+}
+
+esp_err_t prof_dump(void)
+{
+    char line[PROF_LINE_MAX];
+    ESP_LOGI(TAG, "cpu %d MHz, values in cycles", CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ);
+    for (prof_zone_t *zone = s_zones; zone; zone = zone->next) {
+        if (prof_format(line, sizeof(line), zone) > 0) {
+            fputs(line, stdout);
+        }
+    }
+    return ESP_OK;
+}
+
+void prof_reset(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    for (prof_zone_t *zone = s_zones; zone; zone = zone->next) {
+        zone->count = 0;
+        zone->total = 0;
+        zone->min = UINT32_MAX;
+        zone->max = 0;
+        memset(zone->hist, 0, sizeof(zone->hist));
+    }
+    portEXIT_CRITICAL(&s_lock);
+}
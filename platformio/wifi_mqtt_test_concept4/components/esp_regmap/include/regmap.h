@@ -0,0 +1,169 @@
+/*
+ * Compile-time register maps for I2C sensors.
+ *
+ * A register is a type carrying its address, width in bytes, byte order and access.
+ * A field is a type naming bits of a register. A burst is a set of registers read or
+ * written in one transaction: its first address, length and the offset of every
+ * register in the buffer are constants, so decoding a value out of a burst compiles
+ * to the same loads and shifts as the hand-written version. Nothing here allocates
+ * or has state, the bus is a template parameter.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <cstring>
+#include <type_traits>
+#include <utility>
+#include "esp_err.h"
+
+// Forced even at -Og, the project default, so that a register access costs what the
+// hand-written shifts cost instead of a call per byte.
+#define REGMAP_INLINE __attribute__((always_inline)) inline
+
+namespace regmap {
+
+enum class Endian : uint8_t { kLittle, kBig };
+enum class Access : uint8_t { kRead, kWrite, kReadWrite };
+
+// widest span merged into one read, registers further apart need two bursts
+constexpr size_t kMaxBurst = 32;
+
+template <uint8_t Addr, uint8_t Width, Endian Order = Endian::kLittle, Access Mode = Access::kReadWrite>
+struct Reg {
+    static_assert(Width >= 1 && Width <= 4, "registers are 1 to 4 bytes, split wider ones");
+
+    static constexpr uint8_t kAddr = Addr;
+    static constexpr uint8_t kWidth = Width;
+    static constexpr Endian kOrder = Order;
+    static constexpr bool kReadable = Mode != Access::kWrite;
+    static constexpr bool kWritable = Mode != Access::kRead;
+
+    using Value = std::conditional_t<Width == 1, uint8_t, std::conditional_t<Width == 2, uint16_t, uint32_t>>;
+
+    static REGMAP_INLINE constexpr Value Decode(const uint8_t* bytes) {
+        return static_cast<Value>(DecodeBytes(bytes, std::make_index_sequence<Width>{}));
+    }
+
+    static REGMAP_INLINE constexpr void Encode(const Value value, uint8_t* bytes) {
+        EncodeBytes(static_cast<uint32_t>(value), bytes, std::make_index_sequence<Width>{});
+    }
+
+private:
+    template <size_t I>
+    static constexpr size_t kShift = Order == Endian::kLittle ? 8 * I : 8 * (Width - 1 - I);
+
+    template <size_t... I>
+    static REGMAP_INLINE constexpr uint32_t DecodeBytes(const uint8_t* bytes, std::index_sequence<I...>) {
+        return ((static_cast<uint32_t>(bytes[I]) << kShift<I>) | ...);
+    }
+
+    template <size_t... I>
+    static REGMAP_INLINE constexpr void EncodeBytes(const uint32_t value, uint8_t* bytes, std::index_sequence<I...>) {
+        ((bytes[I] = static_cast<uint8_t>(value >> kShift<I>)), ...);
+    }
+};
+
+// Bits [Lsb, Lsb + Bits) of register R
+template <typename R, unsigned Lsb, unsigned Bits>
+struct Field {
+    static_assert(Bits >= 1 && Lsb + Bits <= 8 * R::kWidth, "field does not fit its register");
+
+    using Reg = R;
+    using Value = typename R::Value;
+    static constexpr Value kMask = static_cast<Value>(((Bits == 32 ? 0u : (1u << Bits)) - 1u) << Lsb);
+
+    static REGMAP_INLINE constexpr Value Get(const Value reg) { return static_cast<Value>((reg & kMask) >> Lsb); }
+    static REGMAP_INLINE constexpr Value Set(const Value reg, const Value value) {
+        return static_cast<Value>((reg & ~kMask) | ((static_cast<uint32_t>(value) << Lsb) & kMask));
+    }
+};
+
+namespace detail {
+
+template <typename R, typename... Rs>
+constexpr bool kContains = (std::is_same_v<R, Rs> || ...);
+
+template <typename... Rs>
+constexpr uint8_t First() {
+    uint8_t first = 0xff;
+    ((first = Rs::kAddr < first ? Rs::kAddr : first), ...);
+    return first;
+}
+
+template <typename... Rs>
+constexpr size_t End() {
+    size_t end = 0;
+    ((end = size_t{Rs::kAddr} + Rs::kWidth > end ? size_t{Rs::kAddr} + Rs::kWidth : end), ...);
+    return end;
+}
+
+}  // namespace detail
+
+// Registers transferred in one transaction. The span runs from the lowest address to
+// the end of the highest register; gaps are read and ignored, registers at the same
+// address (aliases) share their bytes. Writes need a span without gaps or aliases so
+// that no byte the caller did not set goes to the device.
+template <typename... Regs>
+struct Burst {
+    static_assert(sizeof...(Regs) > 0, "empty burst");
+
+    static constexpr uint8_t kFirst = detail::First<Regs...>();
+    static constexpr size_t kSize = detail::End<Regs...>() - kFirst;
+    static constexpr bool kReadable = (Regs::kReadable && ...);
+    static constexpr bool kWritable = (Regs::kWritable && ...) && kSize == (size_t{Regs::kWidth} + ...);
+
+    static_assert(kSize <= kMaxBurst, "registers too far apart for one burst");
+
+    using Buffer = uint8_t[kSize];
+
+    template <typename R>
+    static REGMAP_INLINE constexpr size_t Offset() {
+        static_assert(detail::kContains<R, Regs...>, "register is not part of the burst");
+        return R::kAddr - kFirst;
+    }
+
+    template <typename R>
+    static REGMAP_INLINE constexpr typename R::Value Get(const Buffer& buffer) {
+        return R::Decode(buffer + Offset<R>());
+    }
+
+    template <typename F>
+    static REGMAP_INLINE constexpr typename F::Value GetField(const Buffer& buffer) {
+        return F::Get(Get<typename F::Reg>(buffer));
+    }
+
+    template <typename R>
+    static REGMAP_INLINE constexpr void Put(Buffer& buffer, const typename R::Value value) {
+        R::Encode(value, buffer + Offset<R>());
+    }
+};
+
+// Register pointer devices: write the first address, then read the span.
+template <typename B, typename Bus>
+REGMAP_INLINE esp_err_t Read(Bus& bus, typename B::Buffer& buffer) {
+    static_assert(B::kReadable, "burst has a write-only register");
+    const uint8_t addr = B::kFirst;
+    return bus.TransmitReceive(&addr, 1, buffer, B::kSize);
+}
+
+template <typename B, typename Bus>
+REGMAP_INLINE esp_err_t Write(Bus& bus, const typename B::Buffer& buffer) {
+    static_assert(B::kWritable, "burst has a read-only register, a gap or an alias");
+    uint8_t tx[B::kSize + 1];
+    tx[0] = B::kFirst;
+    std::memcpy(tx + 1, buffer, B::kSize);
+    return bus.Transmit(tx, sizeof(tx));
+}
+
+// Devices without a register pointer (AHT20 and friends) answer a plain read with a
+// fixed frame, addresses are offsets into that frame.
+template <typename B, typename Bus>
+REGMAP_INLINE esp_err_t ReadFrame(Bus& bus, typename B::Buffer& buffer) {
+    static_assert(B::kReadable && B::kFirst == 0, "a frame starts at offset 0");
+    return bus.Receive(buffer, B::kSize);
+}
+
+}  // namespace regmap
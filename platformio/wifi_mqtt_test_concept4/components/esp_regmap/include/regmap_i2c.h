@@ -0,0 +1,28 @@
+/*
+ * ESP-IDF I2C master device as a regmap bus.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include "driver/i2c_master.h"
+#include "regmap.h"
+
+namespace regmap {
+
+struct I2cBus {
+    i2c_master_dev_handle_t dev;
+    int timeout_ms;
+
+    REGMAP_INLINE esp_err_t Transmit(const uint8_t* tx, size_t tx_size) {
+        return i2c_master_transmit(dev, tx, tx_size, timeout_ms);
+    }
+    REGMAP_INLINE esp_err_t Receive(uint8_t* rx, size_t rx_size) {
+        return i2c_master_receive(dev, rx, rx_size, timeout_ms);
+    }
+    REGMAP_INLINE esp_err_t TransmitReceive(const uint8_t* tx, size_t tx_size, uint8_t* rx, size_t rx_size) {
+        return i2c_master_transmit_receive(dev, tx, tx_size, rx, rx_size, timeout_ms);
+    }
+};
+
+}  // namespace regmap
@@ -0,0 +1,268 @@
+/*
+ * FreeRTOS scheduling trace.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <string.h>
+#include <errno.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_cpu.h"
+#include "esp_log.h"
+#include "lwip/sockets.h"
+#include "rtos_trace.h"
+
+/*
+ * Datagram layout, little endian:
+ *
+ *   char magic[4]  RTOS_TRACE_MAGIC
+ *   u8   kind      'N' task names, 'E' events, 'Z' end of dump, 'A' command acknowledged
+ *   u8   reserved
+ *   u16  seq       datagram number within one dump
+ *   u32  count     entries following the header
+ *
+ * 'N' entries are u32 id + char name[CONFIG_FREERTOS_MAX_TASK_NAME_LEN], 'E' entries are
+ * rtos_trace_event_t, 'Z' carries one entry of u32 recorded, u32 dumped, u32 cpu MHz.
+ */
+#define RTOS_TRACE_MASK         (CONFIG_RTOS_TRACE_EVENTS - 1)
+#define RTOS_TRACE_ID(obj)      ((uint32_t)(uintptr_t)(obj) & 0xFFFFFFu)
+#define RTOS_TRACE_DGRAM_MAX    1400
+#define RTOS_TRACE_SERVER_STACK 3072
+#define RTOS_TRACE_SERVER_PRIO  2
+
+_Static_assert((CONFIG_RTOS_TRACE_EVENTS & RTOS_TRACE_MASK) == 0, "CONFIG_RTOS_TRACE_EVENTS must be a power of two");
+
+typedef struct __attribute__((packed)) {
+    char magic[4];
+    uint8_t kind;
+    uint8_t reserved;
+    uint16_t seq;
+    uint32_t count;
+} rtos_trace_dgram_hdr_t;
+
+typedef struct __attribute__((packed)) {
+    uint32_t id;
+    char name[CONFIG_FREERTOS_MAX_TASK_NAME_LEN];
+} rtos_trace_task_entry_t;
+
+typedef struct {
+    uint32_t id;
+    bool deleted;
+    char name[CONFIG_FREERTOS_MAX_TASK_NAME_LEN];
+} rtos_trace_task_t;
+
+static const char *TAG = "rtos_trace";
+
+volatile bool rtos_trace_active;
+
+static portMUX_TYPE s_lock = portMUX_INITIALIZER_UNLOCKED;
+static rtos_trace_event_t s_ring[CONFIG_RTOS_TRACE_EVENTS];
+static uint32_t s_head;     // events recorded since the last clear, free running
+static rtos_trace_task_t s_tasks[CONFIG_RTOS_TRACE_MAX_TASKS];
+static uint8_t s_dgram[RTOS_TRACE_DGRAM_MAX];
+
+void rtos_trace_record(uint32_t type, const void *obj)
+{
+    uint32_t now = esp_cpu_get_cycle_count();
+    portENTER_CRITICAL_SAFE(&s_lock);
+    rtos_trace_event_t *ev = &s_ring[s_head++ & RTOS_TRACE_MASK];
+    ev->timestamp = now;
+    ev->word = (type << 24) | RTOS_TRACE_ID(obj);
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+void rtos_trace_task_created(const void *task, const char *name)
+{
+    uint32_t id = RTOS_TRACE_ID(task);
+    rtos_trace_task_t *slot = NULL;
+
+    portENTER_CRITICAL_SAFE(&s_lock);
+    // a new task may reuse the memory of a deleted one, otherwise take a free or stale slot
+    for (int i = 0; i < CONFIG_RTOS_TRACE_MAX_TASKS; i++) {
+        rtos_trace_task_t *t = &s_tasks[i];
+        if (t->id == id) {
+            slot = t;
+            break;
+        }
+        if (!slot && (t->id == 0 || t->deleted)) {
+            slot = t;
+        }
+    }
+    if (slot) {
+        slot->id = id;
+        slot->deleted = false;
+        strlcpy(slot->name, name, sizeof(slot->name));
+    }
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+void rtos_trace_task_deleted(const void *task)
+{
+    uint32_t id = RTOS_TRACE_ID(task);
+    portENTER_CRITICAL_SAFE(&s_lock);
+    for (int i = 0; i < CONFIG_RTOS_TRACE_MAX_TASKS; i++) {
+        if (s_tasks[i].id == id) {
+            s_tasks[i].deleted = true;
+            break;
+        }
+    }
+    portEXIT_CRITICAL_SAFE(&s_lock);
+}
+
+void rtos_trace_start(void)
+{
+    rtos_trace_active = true;
+}
+
+void rtos_trace_stop(void)
+{
+    rtos_trace_active = false;
+}
+
+void rtos_trace_clear(void)
+{
+    portENTER_CRITICAL(&s_lock);
+    s_head = 0;
+    portEXIT_CRITICAL(&s_lock);
+}
+
+static size_t dgram_begin(char kind, uint16_t seq)
+{
+    rtos_trace_dgram_hdr_t *hdr = (rtos_trace_dgram_hdr_t *)s_dgram;
+    memcpy(hdr->magic, RTOS_TRACE_MAGIC, sizeof(hdr->magic));
+    hdr->kind = (uint8_t)kind;
+    hdr->reserved = 0;
+    hdr->seq = seq;
+    hdr->count = 0;
+    return sizeof(*hdr);
+}
+
+static void dgram_send(int sock, const struct sockaddr_in *to, size_t len, uint32_t count)
+{
+    ((rtos_trace_dgram_hdr_t *)s_dgram)->count = count;
+    // lwIP runs out of pbufs when a whole ring is pushed back to back, back off and retry
+    for (int retry = 0; retry < 10; retry++) {
+        if (sendto(sock, s_dgram, len, 0, (const struct sockaddr *)to, sizeof(*to)) >= 0) {
+            return;
+        }
+        if (errno != ENOMEM) {
+            break;
+        }
+        vTaskDelay(1);
+    }
+    ESP_LOGW(TAG, "dropped dump datagram, errno %d", errno);
+}
+
+static void rtos_trace_dump(int sock, const struct sockaddr_in *to)
+{
+    bool was_active = rtos_trace_active;
+    uint16_t seq = 0;
+    size_t len;
+    uint32_t count;
+
+    rtos_trace_active = false;
+
+    len = dgram_begin('N', seq++);
+    count = 0;
+    for (int i = 0; i < CONFIG_RTOS_TRACE_MAX_TASKS; i++) {
+        if (s_tasks[i].id == 0) {
+            continue;
+        }
+        if (len + sizeof(rtos_trace_task_entry_t) > sizeof(s_dgram)) {
+            dgram_send(sock, to, len, count);
+            len = dgram_begin('N', seq++);
+            count = 0;
+        }
+        rtos_trace_task_entry_t entry = { .id = s_tasks[i].id };
+        memcpy(entry.name, s_tasks[i].name, sizeof(entry.name));
+        memcpy(s_dgram + len, &entry, sizeof(entry));
+        len += sizeof(entry);
+        count++;
+    }
+    dgram_send(sock, to, len, count);
+
+    // recording is paused, the ring is stable while it is streamed
+    uint32_t recorded = s_head;
+    uint32_t first = recorded > CONFIG_RTOS_TRACE_EVENTS ? recorded - CONFIG_RTOS_TRACE_EVENTS : 0;
+    len = dgram_begin('E', seq++);
+    count = 0;
+    for (uint32_t i = first; i != recorded; i++) {
+        if (len + sizeof(rtos_trace_event_t) > sizeof(s_dgram)) {
+            dgram_send(sock, to, len, count);
+            len = dgram_begin('E', seq++);
+            count = 0;
+        }
+        memcpy(s_dgram + len, &s_ring[i & RTOS_TRACE_MASK], sizeof(rtos_trace_event_t));
+        len += sizeof(rtos_trace_event_t);
+        count++;
+    }
+    if (count) {
+        dgram_send(sock, to, len, count);
+    }
+
+    uint32_t summary[3] = { recorded, recorded - first, CONFIG_ESP_DEFAULT_CPU_FREQ_MHZ };
+    len = dgram_begin('Z', seq++);
+    memcpy(s_dgram + len, summary, sizeof(summary));
+    dgram_send(sock, to, len + sizeof(summary), 1);
+
+    rtos_trace_active = was_active;
+    ESP_LOGI(TAG, "dumped %lu of %lu events", (unsigned long)(recorded - first), (unsigned long)recorded);
+}
+
+static void rtos_trace_server_task(void *arg)
+{
+    uint16_t port = (uint16_t)(uintptr_t)arg;
+    struct sockaddr_in addr = {
+        .sin_family = AF_INET,
+        .sin_port = htons(port),
+        .sin_addr.s_addr = htonl(INADDR_ANY),
+    };
+    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+    if (sock < 0 || bind(sock, (struct sockaddr *)&addr, sizeof(addr)) < 0) {
+        ESP_LOGE(TAG, "cannot listen on UDP port %u", port);
+        if (sock >= 0) {
+            close(sock);
+        }
+        vTaskDelete(NULL);
+        return;
+    }
+    ESP_LOGI(TAG, "listening on UDP port %u", port);
+
+    for (;;) {
+        char cmd[16];
+        struct sockaddr_in from;
+        socklen_t from_len = sizeof(from);
+        int n = recvfrom(sock, cmd, sizeof(cmd) - 1, 0, (struct sockaddr *)&from, &from_len);
+        if (n <= 0) {
+            continue;
+        }
+        cmd[n] = '\0';
+        if (strncmp(cmd, "dump", 4) == 0) {
+            rtos_trace_dump(sock, &from);
+            continue;
+        }
+        if (strncmp(cmd, "start", 5) == 0) {
+            rtos_trace_start();
+        } else if (strncmp(cmd, "stop", 4) == 0) {
+            rtos_trace_stop();
+        } else if (strncmp(cmd, "clear", 5) == 0) {
+            rtos_trace_clear();
+        } else {
+            continue;
+        }
+        size_t len = dgram_begin('A', 0);
+        dgram_send(sock, &from, len, rtos_trace_active);
+    }
+}
+
+esp_err_t rtos_trace_server_start(uint16_t port)
+{
+    if (xTaskCreate(rtos_trace_server_task, "rtos_trace", RTOS_TRACE_SERVER_STACK,
+                    (void *)(uintptr_t)port, RTOS_TRACE_SERVER_PRIO, NULL) != pdPASS) {
+        return ESP_ERR_NO_MEM;
+    }
+#if CONFIG_RTOS_TRACE_START_ACTIVE
+    rtos_trace_start();
+#endif
+    return ESP_OK;
+}
@@ -0,0 +1,201 @@
+/*
+ * Tokenized binary logging.
+ *
+ * Call sites store the address of a static descriptor (format string, level, line)
+ * plus the raw arguments in a RAM ring. No text formatting happens on the target:
+ * `tools/tlog_decode.py` resolves the descriptors against the firmware ELF and
+ * renders the messages on the host.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "esp_log.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define TLOG_LEVEL_NONE     0
+#define TLOG_LEVEL_ERROR    1
+#define TLOG_LEVEL_WARN     2
+#define TLOG_LEVEL_INFO     3
+#define TLOG_LEVEL_DEBUG    4
+#define TLOG_LEVEL_VERBOSE  5
+
+#ifndef CONFIG_TLOG_LEVEL
+#define CONFIG_TLOG_LEVEL   TLOG_LEVEL_INFO
+#endif
+
+#define TLOG_MAX_ARGS       8       /*!< Arguments per call site, one 4-bit type code each */
+#define TLOG_FRAME_MAGIC    "TLG1"  /*!< Prefix of every drained frame (UART line or UDP datagram) */
+#define TLOG_FRAME_MAGIC_LEN 4
+
+/**
+ * @brief Smallest buffer tlog_drain() is guaranteed to make progress with (magic + one maximal record)
+ */
+#define TLOG_DRAIN_MIN_SIZE (TLOG_FRAME_MAGIC_LEN + 20 + TLOG_MAX_ARGS * (1 + CONFIG_TLOG_MAX_STR_LEN))
+
+/**
+ * @brief Argument type codes, packed 4 bits per argument into the record signature
+ */
+typedef enum {
+    TLOG_ARG_NONE = 0,
+    TLOG_ARG_I32  = 1,
+    TLOG_ARG_U32  = 2,
+    TLOG_ARG_I64  = 3,
+    TLOG_ARG_U64  = 4,
+    TLOG_ARG_F32  = 5,  /*!< float and double, stored as IEEE754 single precision */
+    TLOG_ARG_STR  = 6,  /*!< copied inline: u8 length + bytes, truncated to CONFIG_TLOG_MAX_STR_LEN */
+    TLOG_ARG_PTR  = 7,
+} tlog_arg_type_t;
+
+/**
+ * @brief Per call site descriptor, lives in flash and is referenced by address from every record
+ */
+typedef struct {
+    const char *fmt;    /*!< printf style format string */
+    uint16_t line;      /*!< source line of the call site */
+    uint8_t level;      /*!< TLOG_LEVEL_x */
+    uint8_t nargs;      /*!< number of arguments */
+} tlog_desc_t;
+
+/**
+ * @brief Append one record to the ring. Use the TLOGx macros instead of calling this directly.
+ *
+ * @note Safe to call from any task. When the ring is full the record is dropped and counted.
+ */
+void tlog_write(const tlog_desc_t *desc, const char *tag, uint32_t sig, ...);
+
+/**
+ * @brief Move committed records out of the ring
+ *
+ * Output starts with TLOG_FRAME_MAGIC and contains whole records only.
+ * Only one task may drain the ring.
+ *
+ * @param buf destination buffer
+ * @param size size of the destination buffer, at least TLOG_DRAIN_MIN_SIZE
+ * @return number of bytes written, 0 if the ring is empty
+ */
+size_t tlog_drain(uint8_t *buf, size_t size);
+
+/**
+ * @brief Drain the ring to the console as base64 lines prefixed with "#TLOG:"
+ *
+ * @return
+ *      - ESP_OK: ring drained
+ *      - ESP_FAIL: encoding the frame failed
+ */
+esp_err_t tlog_flush_console(void);
+
+/**
+ * @brief Number of records dropped because the ring was full
+ */
+uint32_t tlog_get_dropped(void);
+
+/*
+ * Compile time argument signature. Each argument contributes a 4-bit type code,
+ * the arguments themselves are never evaluated by this part.
+ */
+#ifdef __cplusplus
+} // extern "C"
+
+template <typename T> constexpr uint32_t tlog_arg_type(T) { return TLOG_ARG_U32; }
+template <typename T> constexpr uint32_t tlog_arg_type(T *) { return TLOG_ARG_PTR; }
+constexpr uint32_t tlog_arg_type(char *) { return TLOG_ARG_STR; }
+constexpr uint32_t tlog_arg_type(const char *) { return TLOG_ARG_STR; }
+constexpr uint32_t tlog_arg_type(signed char) { return TLOG_ARG_I32; }
+constexpr uint32_t tlog_arg_type(short) { return TLOG_ARG_I32; }
+constexpr uint32_t tlog_arg_type(int) { return TLOG_ARG_I32; }
+constexpr uint32_t tlog_arg_type(long) { return TLOG_ARG_I32; }
+constexpr uint32_t tlog_arg_type(long long) { return TLOG_ARG_I64; }
+constexpr uint32_t tlog_arg_type(unsigned long long) { return TLOG_ARG_U64; }
+constexpr uint32_t tlog_arg_type(float) { return TLOG_ARG_F32; }
+constexpr uint32_t tlog_arg_type(double) { return TLOG_ARG_F32; }
+#define TLOG_ARG_TYPE(x) tlog_arg_type(x)
+
+extern "C" {
+#else
+#define TLOG_ARG_TYPE(x) _Generic((x),                                      \
+        _Bool: TLOG_ARG_U32,                                                \
+        char: TLOG_ARG_I32, signed char: TLOG_ARG_I32,                      \
+        unsigned char: TLOG_ARG_U32,                                        \
+        short: TLOG_ARG_I32, unsigned short: TLOG_ARG_U32,                  \
+        int: TLOG_ARG_I32, unsigned int: TLOG_ARG_U32,                      \
+        long: TLOG_ARG_I32, unsigned long: TLOG_ARG_U32,                    \
+        long long: TLOG_ARG_I64, unsigned long long: TLOG_ARG_U64,          \
+        float: TLOG_ARG_F32, double: TLOG_ARG_F32,                          \
+        char *: TLOG_ARG_STR, const char *: TLOG_ARG_STR,                   \
+        default: TLOG_ARG_PTR)
+#endif
+
+#define TLOG_CAT_(a, b) a##b
+#define TLOG_CAT(a, b) TLOG_CAT_(a, b)
+#define TLOG_NARG_(_0, _1, _2, _3, _4, _5, _6, _7, _8, N, ...) N
+#define TLOG_NARG(...) TLOG_NARG_(_, ##__VA_ARGS__, 8, 7, 6, 5, 4, 3, 2, 1, 0)
+
+#define TLOG_T(x, n) ((uint32_t)TLOG_ARG_TYPE(x) << (4 * (n)))
+#define TLOG_SIG_0() 0u
+#define TLOG_SIG_1(a) TLOG_T(a, 0)
+#define TLOG_SIG_2(a, b) (TLOG_SIG_1(a) | TLOG_T(b, 1))
+#define TLOG_SIG_3(a, b, c) (TLOG_SIG_2(a, b) | TLOG_T(c, 2))
+#define TLOG_SIG_4(a, b, c, d) (TLOG_SIG_3(a, b, c) | TLOG_T(d, 3))
+#define TLOG_SIG_5(a, b, c, d, e) (TLOG_SIG_4(a, b, c, d) | TLOG_T(e, 4))
+#define TLOG_SIG_6(a, b, c, d, e, f) (TLOG_SIG_5(a, b, c, d, e) | TLOG_T(f, 5))
+#define TLOG_SIG_7(a, b, c, d, e, f, g) (TLOG_SIG_6(a, b, c, d, e, f) | TLOG_T(g, 6))
+#define TLOG_SIG_8(a, b, c, d, e, f, g, h) (TLOG_SIG_7(a, b, c, d, e, f, g) | TLOG_T(h, 7))
+#define TLOG_SIG(...) TLOG_CAT(TLOG_SIG_, TLOG_NARG(__VA_ARGS__))(__VA_ARGS__)
+
+#if CONFIG_TLOG_ENABLE
+#define TLOG_AT(level_, tag, format, ...) do {                              \
+        static const tlog_desc_t tlog_desc__ = {                            \
+            .fmt = format,                                                  \
+            .line = __LINE__,                                               \
+            .level = level_,                                                \
+            .nargs = TLOG_NARG(__VA_ARGS__),                                \
+        };                                                                  \
+        tlog_write(&tlog_desc__, tag, TLOG_SIG(__VA_ARGS__), ##__VA_ARGS__); \
+    } while (0)
+#else
+// tokenized logging disabled, keep the messages as regular text logs
+#define TLOG_AT(level_, tag, format, ...) \
+    ESP_LOG_LEVEL_LOCAL((esp_log_level_t)(level_), tag, format, ##__VA_ARGS__)
+#endif
+
+/*
+ * Level gated call sites. Below CONFIG_TLOG_LEVEL they expand to nothing,
+ * so neither the descriptor nor the argument evaluation survives.
+ */
+#if CONFIG_TLOG_LEVEL >= TLOG_LEVEL_ERROR
+#define TLOGE(tag, format, ...) TLOG_AT(TLOG_LEVEL_ERROR, tag, format, ##__VA_ARGS__)
+#else
+#define TLOGE(tag, format, ...) do { } while (0)
+#endif
+#if CONFIG_TLOG_LEVEL >= TLOG_LEVEL_WARN
+#define TLOGW(tag, format, ...) TLOG_AT(TLOG_LEVEL_WARN, tag, format, ##__VA_ARGS__)
+#else
+#define TLOGW(tag, format, ...) do { } while (0)
+#endif
+#if CONFIG_TLOG_LEVEL >= TLOG_LEVEL_INFO
+#define TLOGI(tag, format, ...) TLOG_AT(TLOG_LEVEL_INFO, tag, format, ##__VA_ARGS__)
+#else
+#define TLOGI(tag, format, ...) do { } while (0)
+#endif
+#if CONFIG_TLOG_LEVEL >= TLOG_LEVEL_DEBUG
+#define TLOGD(tag, format, ...) TLOG_AT(TLOG_LEVEL_DEBUG, tag, format, ##__VA_ARGS__)
+#else
+#define TLOGD(tag, format, ...) do { } while (0)
+#endif
+#if CONFIG_TLOG_LEVEL >= TLOG_LEVEL_VERBOSE
+#define TLOGV(tag, format, ...) TLOG_AT(TLOG_LEVEL_VERBOSE, tag, format, ##__VA_ARGS__)
+#else
+#define TLOGV(tag, format, ...) do { } while (0)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,184 @@
+/*
+ * Tokenized binary logging.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <stdarg.h>
+#include <stdio.h>
+#include <string.h>
+#include <stdatomic.h>
+#include "esp_log.h"
+#include "mbedtls/base64.h"
+#include "tlog.h"
+
+/*
+ * Record layout, little endian, every record starts 4-byte aligned:
+ *
+ *   u32 header     TLOG_REC_SYNC << 24 | dropped since previous record << 16 | payload length
+ *   u32 desc       address of the tlog_desc_t
+ *   u32 tag        address of the tag string
+ *   u32 timestamp  milliseconds, same clock as esp_log_timestamp()
+ *   u32 sig        4-bit argument type codes, argument 0 in the low nibble
+ *   ...            arguments: 4 bytes (I32/U32/F32/PTR), 8 bytes (I64/U64), u8 length + bytes (STR)
+ *
+ * The payload length counts everything after the header word, the record is padded to 4 bytes.
+ * A producer publishes the header word last, so a non-zero header means the record is complete.
+ */
+#define TLOG_REC_SYNC       0xA5u
+#define TLOG_REC_FIXED      16      // desc + tag + timestamp + sig
+#define TLOG_REC_MAX        (TLOG_DRAIN_MIN_SIZE - TLOG_FRAME_MAGIC_LEN)
+#define TLOG_RING_MASK      (CONFIG_TLOG_BUFFER_SIZE - 1)
+#define TLOG_ALIGN4(x)      (((x) + 3u) & ~3u)
+
+_Static_assert((CONFIG_TLOG_BUFFER_SIZE & TLOG_RING_MASK) == 0, "CONFIG_TLOG_BUFFER_SIZE must be a power of two");
+
+static const char *TAG = "tlog";
+
+static uint8_t s_ring[CONFIG_TLOG_BUFFER_SIZE] __attribute__((aligned(4)));
+static atomic_uint s_head;      // next byte to reserve, free running
+static atomic_uint s_tail;      // next byte to consume, free running
+static atomic_uint s_dropped;   // total dropped records
+static atomic_uint s_pending_drops; // drops not yet reported in a record header
+
+static inline void put_u32(uint8_t *p, uint32_t v)
+{
+    memcpy(p, &v, sizeof(v));
+}
+
+static inline void ring_copy_in(uint32_t pos, const uint8_t *src, size_t len)
+{
+    for (size_t i = 0; i < len; i++) {
+        s_ring[(pos + i) & TLOG_RING_MASK] = src[i];
+    }
+}
+
+void tlog_write(const tlog_desc_t *desc, const char *tag, uint32_t sig, ...)
+{
+    uint8_t rec[TLOG_REC_MAX];
+    uint8_t *p = rec + 4;
+    va_list ap;
+
+    put_u32(p, (uint32_t)(uintptr_t)desc);
+    put_u32(p + 4, (uint32_t)(uintptr_t)tag);
+    put_u32(p + 8, esp_log_timestamp());
+    put_u32(p + 12, sig);
+    p += TLOG_REC_FIXED;
+
+    va_start(ap, sig);
+    for (uint32_t s = sig; s; s >>= 4) {
+        switch (s & 0xF) {
+        case TLOG_ARG_I32:
+        case TLOG_ARG_U32:
+            put_u32(p, va_arg(ap, uint32_t));
+            p += 4;
+            break;
+        case TLOG_ARG_PTR:
+            put_u32(p, (uint32_t)(uintptr_t)va_arg(ap, void *));
+            p += 4;
+            break;
+        case TLOG_ARG_F32: {
+            float f = (float)va_arg(ap, double);
+            memcpy(p, &f, sizeof(f));
+            p += 4;
+            break;
+        }
+        case TLOG_ARG_I64:
+        case TLOG_ARG_U64: {
+            uint64_t v = va_arg(ap, uint64_t);
+            memcpy(p, &v, sizeof(v));
+            p += 8;
+            break;
+        }
+        case TLOG_ARG_STR: {
+            const char *str = va_arg(ap, const char *);
+            size_t len = str ? strnlen(str, CONFIG_TLOG_MAX_STR_LEN) : 0;
+            *p++ = (uint8_t)len;
+            memcpy(p, str, len);
+            p += len;
+            break;
+        }
+        default:
+            break;
+        }
+    }
+    va_end(ap);
+
+    uint32_t payload = (uint32_t)(p - rec) - 4;
+    uint32_t total = TLOG_ALIGN4(payload + 4);
+
+    // reserve space, lock free for concurrent writers
+    uint32_t head = atomic_load_explicit(&s_head, memory_order_relaxed);
+    do {
+        uint32_t tail = atomic_load_explicit(&s_tail, memory_order_acquire);
+        if (CONFIG_TLOG_BUFFER_SIZE - (head - tail) < total) {
+            atomic_fetch_add_explicit(&s_dropped, 1, memory_order_relaxed);
+            atomic_fetch_add_explicit(&s_pending_drops, 1, memory_order_relaxed);
+            return;
+        }
+    } while (!atomic_compare_exchange_weak_explicit(&s_head, &head, head + total,
+                                                    memory_order_acq_rel, memory_order_relaxed));
+
+    ring_copy_in(head + 4, rec + 4, payload);
+    uint32_t drops = atomic_exchange_explicit(&s_pending_drops, 0, memory_order_relaxed);
+    uint32_t header = (TLOG_REC_SYNC << 24) | ((drops > 0xFF ? 0xFF : drops) << 16) | payload;
+    // header word never wraps because records are 4-byte aligned
+    atomic_store_explicit((atomic_uint *)&s_ring[head & TLOG_RING_MASK], header, memory_order_release);
+}
+
+size_t tlog_drain(uint8_t *buf, size_t size)
+{
+    if (size < TLOG_FRAME_MAGIC_LEN) {
+        return 0;
+    }
+    size_t out = TLOG_FRAME_MAGIC_LEN;
+    uint32_t tail = atomic_load_explicit(&s_tail, memory_order_relaxed);
+    uint32_t head = atomic_load_explicit(&s_head, memory_order_acquire);
+
+    while (tail != head) {
+        atomic_uint *hdr = (atomic_uint *)&s_ring[tail & TLOG_RING_MASK];
+        uint32_t header = atomic_load_explicit(hdr, memory_order_acquire);
+        if (header == 0) {
+            break; // reserved but not yet committed
+        }
+        uint32_t total = TLOG_ALIGN4((header & 0xFFFF) + 4);
+        if (out + total > size) {
+            break;
+        }
+        for (uint32_t i = 0; i < total; i++) {
+            uint32_t pos = (tail + i) & TLOG_RING_MASK;
+            buf[out + i] = s_ring[pos];
+            s_ring[pos] = 0; // a stale non-zero word must never look like a committed header
+        }
+        out += total;
+        tail += total;
+        atomic_store_explicit(&s_tail, tail, memory_order_release);
+    }
+
+    if (out == TLOG_FRAME_MAGIC_LEN) {
+        return 0;
+    }
+    memcpy(buf, TLOG_FRAME_MAGIC, TLOG_FRAME_MAGIC_LEN);
+    return out;
+}
+
+esp_err_t tlog_flush_console(void)
+{
+    static uint8_t frame[TLOG_DRAIN_MIN_SIZE];
+    static unsigned char line[4 * (sizeof(frame) + 2) / 3 + 1];
+    size_t len;
+
+    while ((len = tlog_drain(frame, sizeof(frame))) > 0) {
+        size_t olen = 0;
+        if (mbedtls_base64_encode(line, sizeof(line), &olen, frame, len) != 0) {
+            ESP_LOGE(TAG, "base64 encode failed");
+            return ESP_FAIL;
+        }
+        printf("#TLOG:%.*s\n", (int)olen, line);
+    }
+    return ESP_OK;
+}
+
+uint32_t tlog_get_dropped(void)
+{
+    return atomic_load_explicit(&s_dropped, memory_order_relaxed);
+}
@@ -37,6 +37,8 @@
 
 #include <stdint.h>
 #include <stdbool.h>
+#include <stddef.h>
+#include <string.h>
 #include <esp_mac.h>
 #include "type_utils_version.h"
 
@@ -67,6 +69,8 @@ extern "C" {
 #define BIN32_CHAR_BUFFER_SIZE      (32 + 1)    // 32 bytes + 1 byte for null terminator
 #define BIN64_CHAR_BUFFER_SIZE      (64 + 1)    // 64 bytes + 1 byte for null terminator
 
+#define TYPE_UTILS_HOST_LITTLE_ENDIAN   (__BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__)
+
 
 /*
  * type utilities type definition declarations
@@ -176,6 +180,9 @@ uint64_t get_efuse_mac(void);
 /**
  * @brief Converts `uint8_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `uint8_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `uint8_t` to transform to binary string.
  * @return char* binary string representation.
  */
@@ -184,6 +191,9 @@ const char* uint8_to_binary(const uint8_t value);
 /**
  * @brief Converts `int8_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `int8_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `int8_t` to transform to binary string.
  * @return char* binary string representation.
  */
@@ -192,6 +202,9 @@ const char* int8_to_binary(const int8_t value);
 /**
  * @brief Converts `uint16_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `uint16_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `uint16_t` to transform to binary string.
  * @return char* binary string representation.
  */
@@ -200,6 +213,9 @@ const char* uint16_to_binary(const uint16_t value);
 /**
  * @brief Converts `int16_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `int16_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `int16_t` to transform to binary string.
  * @return char* binary string representation.
  */
@@ -208,6 +224,9 @@ const char* int16_to_binary(const int16_t value);
 /**
  * @brief Converts `uint32_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `uint32_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `uint32_t` to transform to binary string.
  * @return char* binary string representation.
  */
@@ -216,6 +235,9 @@ const char* uint32_to_binary(const uint32_t value);
 /**
  * @brief Converts `int32_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `int32_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `int32_t` to transform to binary string.
  * @return char* binary string representation.
  */
@@ -224,6 +246,9 @@ const char* int32_to_binary(const int32_t value);
 /**
  * @brief Converts `uint64_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `uint64_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `uint64_t` to transform to binary string.
  * @return char* binary string representation.
  */
@@ -232,11 +257,157 @@ const char* uint64_to_binary(const uint64_t value);
 /**
  * @brief Converts `int64_t` type to binary as a string.
  * 
+ * @note Returns a static buffer that the next call overwrites, not safe from several tasks.
+ *       Use `int64_to_binary_r` with a caller supplied buffer instead.
+ * 
  * @param value `int64_t` to transform to binary string.
  * @return char* binary string representation.
  */
 const char* int64_to_binary(const int64_t value);
 
+/**
+ * @brief Converts `uint8_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `uint8_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* uint8_to_binary_r(const uint8_t value, bin8_char_buffer_t buffer);
+
+/**
+ * @brief Converts `int8_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `int8_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* int8_to_binary_r(const int8_t value, bin8_char_buffer_t buffer);
+
+/**
+ * @brief Converts `uint16_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `uint16_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* uint16_to_binary_r(const uint16_t value, bin16_char_buffer_t buffer);
+
+/**
+ * @brief Converts `int16_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `int16_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* int16_to_binary_r(const int16_t value, bin16_char_buffer_t buffer);
+
+/**
+ * @brief Converts `uint32_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `uint32_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* uint32_to_binary_r(const uint32_t value, bin32_char_buffer_t buffer);
+
+/**
+ * @brief Converts `int32_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `int32_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* int32_to_binary_r(const int32_t value, bin32_char_buffer_t buffer);
+
+/**
+ * @brief Converts `uint64_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `uint64_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* uint64_to_binary_r(const uint64_t value, bin64_char_buffer_t buffer);
+
+/**
+ * @brief Converts `int64_t` type to binary as a string in a caller supplied buffer, reentrant.
+ * 
+ * @param value `int64_t` to transform to binary string.
+ * @param buffer Destination of the binary string, null terminated.
+ * @return char* `buffer`.
+ */
+char* int64_to_binary_r(const int64_t value, bin64_char_buffer_t buffer);
+
+/*
+ * Fixed byte order loads and stores. The byte order is known at compile time, a load
+ * is one (unaligned safe) memcpy plus a `__builtin_bswap` when it differs from the host.
+*/
+
+static inline uint16_t bytes_to_uint16_le(const uint8_t* bytes) {
+    uint16_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return TYPE_UTILS_HOST_LITTLE_ENDIAN ? value : __builtin_bswap16(value);
+}
+
+static inline uint16_t bytes_to_uint16_be(const uint8_t* bytes) {
+    uint16_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return TYPE_UTILS_HOST_LITTLE_ENDIAN ? __builtin_bswap16(value) : value;
+}
+
+static inline uint32_t bytes_to_uint32_le(const uint8_t* bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return TYPE_UTILS_HOST_LITTLE_ENDIAN ? value : __builtin_bswap32(value);
+}
+
+static inline uint32_t bytes_to_uint32_be(const uint8_t* bytes) {
+    uint32_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return TYPE_UTILS_HOST_LITTLE_ENDIAN ? __builtin_bswap32(value) : value;
+}
+
+static inline uint64_t bytes_to_uint64_le(const uint8_t* bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return TYPE_UTILS_HOST_LITTLE_ENDIAN ? value : __builtin_bswap64(value);
+}
+
+static inline uint64_t bytes_to_uint64_be(const uint8_t* bytes) {
+    uint64_t value;
+    memcpy(&value, bytes, sizeof(value));
+    return TYPE_UTILS_HOST_LITTLE_ENDIAN ? __builtin_bswap64(value) : value;
+}
+
+static inline void uint16_to_bytes_le(const uint16_t value, uint8_t* bytes) {
+    const uint16_t wire = TYPE_UTILS_HOST_LITTLE_ENDIAN ? value : __builtin_bswap16(value);
+    memcpy(bytes, &wire, sizeof(wire));
+}
+
+static inline void uint16_to_bytes_be(const uint16_t value, uint8_t* bytes) {
+    const uint16_t wire = TYPE_UTILS_HOST_LITTLE_ENDIAN ? __builtin_bswap16(value) : value;
+    memcpy(bytes, &wire, sizeof(wire));
+}
+
+static inline void uint32_to_bytes_le(const uint32_t value, uint8_t* bytes) {
+    const uint32_t wire = TYPE_UTILS_HOST_LITTLE_ENDIAN ? value : __builtin_bswap32(value);
+    memcpy(bytes, &wire, sizeof(wire));
+}
+
+static inline void uint32_to_bytes_be(const uint32_t value, uint8_t* bytes) {
+    const uint32_t wire = TYPE_UTILS_HOST_LITTLE_ENDIAN ? __builtin_bswap32(value) : value;
+    memcpy(bytes, &wire, sizeof(wire));
+}
+
+static inline void uint64_to_bytes_le(const uint64_t value, uint8_t* bytes) {
+    const uint64_t wire = TYPE_UTILS_HOST_LITTLE_ENDIAN ? value : __builtin_bswap64(value);
+    memcpy(bytes, &wire, sizeof(wire));
+}
+
+static inline void uint64_to_bytes_be(const uint64_t value, uint8_t* bytes) {
+    const uint64_t wire = TYPE_UTILS_HOST_LITTLE_ENDIAN ? __builtin_bswap64(value) : value;
+    memcpy(bytes, &wire, sizeof(wire));
+}
+
 /**
  * @brief Converts byte array to `uint16_t` data-type.
  * 
@@ -363,6 +534,106 @@ void float_to_bytes(const float value, uint8_t* bytes, const bool little_endian)
  */
 void double_to_bytes(const double value, uint8_t* bytes, const bool little_endian);
 
+/**
+ * @brief Converts a `uint16_t` array to a byte array, e.g. a block of samples to wire format.
+ * 
+ * @param values `uint16_t` values to convert.
+ * @param bytes Converted values, `count` * 2 bytes.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void uint16_array_to_bytes(const uint16_t* values, uint8_t* bytes, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts an `int16_t` array to a byte array.
+ * 
+ * @param values `int16_t` values to convert.
+ * @param bytes Converted values, `count` * 2 bytes.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void int16_array_to_bytes(const int16_t* values, uint8_t* bytes, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts a `uint32_t` array to a byte array.
+ * 
+ * @param values `uint32_t` values to convert.
+ * @param bytes Converted values, `count` * 4 bytes.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void uint32_array_to_bytes(const uint32_t* values, uint8_t* bytes, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts an `int32_t` array to a byte array.
+ * 
+ * @param values `int32_t` values to convert.
+ * @param bytes Converted values, `count` * 4 bytes.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void int32_array_to_bytes(const int32_t* values, uint8_t* bytes, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts a `float` array to a byte array (IEEE754).
+ * 
+ * @param values `float` values to convert.
+ * @param bytes Converted values, `count` * 4 bytes.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void float_array_to_bytes(const float* values, uint8_t* bytes, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts a byte array to a `uint16_t` array, e.g. a received block of samples.
+ * 
+ * @param bytes Byte array to convert, `count` * 2 bytes.
+ * @param values Converted `uint16_t` values.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void bytes_to_uint16_array(const uint8_t* bytes, uint16_t* values, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts a byte array to an `int16_t` array.
+ * 
+ * @param bytes Byte array to convert, `count` * 2 bytes.
+ * @param values Converted `int16_t` values.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void bytes_to_int16_array(const uint8_t* bytes, int16_t* values, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts a byte array to a `uint32_t` array.
+ * 
+ * @param bytes Byte array to convert, `count` * 4 bytes.
+ * @param values Converted `uint32_t` values.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void bytes_to_uint32_array(const uint8_t* bytes, uint32_t* values, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts a byte array to an `int32_t` array.
+ * 
+ * @param bytes Byte array to convert, `count` * 4 bytes.
+ * @param values Converted `int32_t` values.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void bytes_to_int32_array(const uint8_t* bytes, int32_t* values, const size_t count, const bool little_endian);
+
+/**
+ * @brief Converts a byte array to a `float` array (IEEE754).
+ * 
+ * @param bytes Byte array to convert, `count` * 4 bytes.
+ * @param values Converted `float` values.
+ * @param count Number of values.
+ * @param little_endian Little endian byte order when true, otherwise, big endian byte order when false.
+ */
+void bytes_to_float_array(const uint8_t* bytes, float* values, const size_t count, const bool little_endian);
+
 /**
  * @brief Copies bytes from source byte array to destination byte array.
  * 
@@ -81,309 +81,240 @@ uint64_t get_efuse_mac(void) {
     return chipmacid;
 }
 
-const char* uint8_to_binary(const uint8_t value) {
-    static bin8_char_buffer_t buffer;
-    buffer[8] = '\0';
-    uint8_t n = value;
-
-    for (int i = 7; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
+/* binary digits of every nibble, four characters without terminator */
+static const char nibble_to_binary[16][4] = {
+    {'0','0','0','0'}, {'0','0','0','1'}, {'0','0','1','0'}, {'0','0','1','1'},
+    {'0','1','0','0'}, {'0','1','0','1'}, {'0','1','1','0'}, {'0','1','1','1'},
+    {'1','0','0','0'}, {'1','0','0','1'}, {'1','0','1','0'}, {'1','0','1','1'},
+    {'1','1','0','0'}, {'1','1','0','1'}, {'1','1','1','0'}, {'1','1','1','1'},
+};
+
+/* writes the low `bits` bits of `value` msb first, 32-bit math only for the RV32 targets */
+static inline char* uint32_bits_to_binary(const uint32_t value, char* buffer, const int bits) {
+    char* out = buffer;
+    for (int shift = bits - 4; shift >= 0; shift -= 4) {
+        memcpy(out, nibble_to_binary[(value >> shift) & 0x0f], 4);
+        out += 4;
     }
-
+    *out = '\0';
     return buffer;
 }
 
-const char* int8_to_binary(const int8_t value) {
-    static bin8_char_buffer_t buffer;
-    buffer[8] = '\0';
-    int8_t n = value;
+char* uint8_to_binary_r(const uint8_t value, bin8_char_buffer_t buffer) {
+    return uint32_bits_to_binary(value, buffer, 8);
+}
 
-    for (int i = 7; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
-    }
+char* int8_to_binary_r(const int8_t value, bin8_char_buffer_t buffer) {
+    return uint32_bits_to_binary((uint8_t)value, buffer, 8);
+}
 
-    return buffer;
+char* uint16_to_binary_r(const uint16_t value, bin16_char_buffer_t buffer) {
+    return uint32_bits_to_binary(value, buffer, 16);
 }
 
-const char* uint16_to_binary(const uint16_t value) {
-    static bin16_char_buffer_t buffer;
-    buffer[16] = '\0';
-    uint16_t n = value;
+char* int16_to_binary_r(const int16_t value, bin16_char_buffer_t buffer) {
+    return uint32_bits_to_binary((uint16_t)value, buffer, 16);
+}
 
-    for (int i = 15; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
-    }
+char* uint32_to_binary_r(const uint32_t value, bin32_char_buffer_t buffer) {
+    return uint32_bits_to_binary(value, buffer, 32);
+}
 
+char* int32_to_binary_r(const int32_t value, bin32_char_buffer_t buffer) {
+    return uint32_bits_to_binary((uint32_t)value, buffer, 32);
+}
+
+char* uint64_to_binary_r(const uint64_t value, bin64_char_buffer_t buffer) {
+    uint32_bits_to_binary((uint32_t)(value >> 32), buffer, 32);
+    uint32_bits_to_binary((uint32_t)value, buffer + 32, 32);
     return buffer;
 }
 
-const char* int16_to_binary(const int16_t value) {
-    static bin16_char_buffer_t buffer;
-    buffer[16] = '\0';
-    int16_t n = value;
+char* int64_to_binary_r(const int64_t value, bin64_char_buffer_t buffer) {
+    return uint64_to_binary_r((uint64_t)value, buffer);
+}
 
-    for (int i = 15; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
-    }
+const char* uint8_to_binary(const uint8_t value) {
+    static bin8_char_buffer_t buffer;
+    return uint8_to_binary_r(value, buffer);
+}
 
-    return buffer;
+const char* int8_to_binary(const int8_t value) {
+    static bin8_char_buffer_t buffer;
+    return int8_to_binary_r(value, buffer);
 }
 
-const char* uint32_to_binary(const uint32_t value) {
-    static bin32_char_buffer_t buffer;
-    buffer[32] = '\0';
-    uint32_t n = value;
+const char* uint16_to_binary(const uint16_t value) {
+    static bin16_char_buffer_t buffer;
+    return uint16_to_binary_r(value, buffer);
+}
 
-    for (int i = 31; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
-    }
+const char* int16_to_binary(const int16_t value) {
+    static bin16_char_buffer_t buffer;
+    return int16_to_binary_r(value, buffer);
+}
 
-    return buffer;
+const char* uint32_to_binary(const uint32_t value) {
+    static bin32_char_buffer_t buffer;
+    return uint32_to_binary_r(value, buffer);
 }
 
 const char* int32_to_binary(const int32_t value) {
     static bin32_char_buffer_t buffer;
-    buffer[32] = '\0';
-    int32_t n = value;
-
-    for (int i = 31; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
-    }
-
-    return buffer;
+    return int32_to_binary_r(value, buffer);
 }
 
 const char* uint64_to_binary(const uint64_t value) {
     static bin64_char_buffer_t buffer;
-    buffer[64] = '\0';
-    uint64_t n = value;
-
-    for (int i = 63; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
-    }
-
-    return buffer;
+    return uint64_to_binary_r(value, buffer);
 }
 
 const char* int64_to_binary(const int64_t value) {
     static bin64_char_buffer_t buffer;
-    buffer[64] = '\0';
-    int64_t n = value;
-
-    for (int i = 63; i >= 0; --i) {
-        buffer[i] = '0' + (n & 1); // '0' or '1'
-        n >>= 1; // shift to the next bit
-    }
-
-    return buffer;
+    return int64_to_binary_r(value, buffer);
 }
 
 uint16_t bytes_to_uint16(const uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        return  (uint16_t)(bytes[0] | 
-                ((uint16_t)bytes[1] << 8));
-    } else {
-        return  (uint16_t)(((uint16_t)bytes[0] << 8) | 
-                bytes[1]);
-    }
+    return little_endian ? bytes_to_uint16_le(bytes) : bytes_to_uint16_be(bytes);
 }
 
 uint32_t bytes_to_uint32(const uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        return  (uint32_t)bytes[0] | 
-                ((uint32_t)bytes[1] << 8) | 
-                ((uint32_t)bytes[2] << 16) | 
-                ((uint32_t)bytes[3] << 24);
-    } else {
-        return  ((uint32_t)bytes[0] << 24) | 
-                ((uint32_t)bytes[1] << 16) | 
-                ((uint32_t)bytes[2] << 8) | 
-                (uint32_t)bytes[3];
-    }
+    return little_endian ? bytes_to_uint32_le(bytes) : bytes_to_uint32_be(bytes);
 }
 
 uint64_t bytes_to_uint64(const uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        return  (uint64_t)bytes[0] | 
-                ((uint64_t)bytes[1] << 8) | 
-                ((uint64_t)bytes[2] << 16) | 
-                ((uint64_t)bytes[3] << 24) | 
-                ((uint64_t)bytes[4] << 32) | 
-                ((uint64_t)bytes[5] << 40) | 
-                ((uint64_t)bytes[6] << 48) | 
-                ((uint64_t)bytes[7] << 56);
-    } else {
-        return  ((uint64_t)bytes[0] << 56) | 
-                ((uint64_t)bytes[1] << 48) | 
-                ((uint64_t)bytes[2] << 40) | 
-                ((uint64_t)bytes[3] << 32) | 
-                ((uint64_t)bytes[4] << 24) | 
-                ((uint64_t)bytes[5] << 16) | 
-                ((uint64_t)bytes[6] << 8) | 
-                (uint64_t)bytes[7];
-    }
+    return little_endian ? bytes_to_uint64_le(bytes) : bytes_to_uint64_be(bytes);
 }
 
 int16_t bytes_to_int16(const uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        return  (int16_t)(bytes[0] | 
-                ((int16_t)bytes[1] << 8));
-    } else {
-        return  (int16_t)(((int16_t)bytes[0] << 8) | bytes[1]);
-    }
+    return (int16_t)bytes_to_uint16(bytes, little_endian);
 }
 
 int32_t bytes_to_int32(const uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        return  (int32_t)bytes[0] | 
-                ((int32_t)bytes[1] << 8) | 
-                ((int32_t)bytes[2] << 16) | 
-                ((int32_t)bytes[3] << 24);
-    } else {
-        return  ((int32_t)bytes[0] << 24) | 
-                ((int32_t)bytes[1] << 16) | 
-                ((int32_t)bytes[2] << 8) | 
-                (int32_t)bytes[3];
-    }
+    return (int32_t)bytes_to_uint32(bytes, little_endian);
 }
 
 int64_t bytes_to_int64(const uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        return  (int64_t)bytes[0] | 
-                ((int64_t)bytes[1] << 8) | 
-                ((int64_t)bytes[2] << 16) | 
-                ((int64_t)bytes[3] << 24) | 
-                ((int64_t)bytes[4] << 32) | 
-                ((int64_t)bytes[5] << 40) | 
-                ((int64_t)bytes[6] << 48) | 
-                ((int64_t)bytes[7] << 56);
-    } else {
-        return  ((int64_t)bytes[0] << 56) | 
-                ((int64_t)bytes[1] << 48) | 
-                ((int64_t)bytes[2] << 40) | 
-                ((int64_t)bytes[3] << 32) | 
-                ((int64_t)bytes[4] << 24) | 
-                ((int64_t)bytes[5] << 16) | 
-                ((int64_t)bytes[6] << 8) | 
-                (int64_t)bytes[7];
-    }
+    return (int64_t)bytes_to_uint64(bytes, little_endian);
 }
 
 void uint16_to_bytes(const uint16_t value, uint8_t* bytes, const bool little_endian) {
     if(little_endian == true) {
-        bytes[0] = (uint8_t)(value & 0xff);        // lsb
-        bytes[1] = (uint8_t)((value >> 8) & 0xff); // msb
+        uint16_to_bytes_le(value, bytes);
     } else {
-        bytes[0] = (uint8_t)((value >> 8) & 0xff); // msb
-        bytes[1] = (uint8_t)(value & 0xff);        // lsb
+        uint16_to_bytes_be(value, bytes);
     }
 }
 
 void uint32_to_bytes(const uint32_t value, uint8_t* bytes, const bool little_endian) {
     if(little_endian == true) {
-        bytes[0] = (uint8_t)(value & 0xff);    
-        bytes[1] = (uint8_t)((value >> 8) & 0xff);
-        bytes[2] = (uint8_t)((value >> 16) & 0xff);
-        bytes[3] = (uint8_t)((value >> 24) & 0xff);
+        uint32_to_bytes_le(value, bytes);
     } else {
-        bytes[0] = (uint8_t)((value >> 24) & 0xff);      
-        bytes[1] = (uint8_t)((value >> 16) & 0xff);
-        bytes[2] = (uint8_t)((value >> 8) & 0xff); 
-        bytes[3] = (uint8_t)(value & 0xff);
+        uint32_to_bytes_be(value, bytes);
     }
 }
 
 void uint64_to_bytes(const uint64_t value, uint8_t* bytes, const bool little_endian) {
     if(little_endian == true) {
-        bytes[0] = (uint8_t)(value & 0xff);   
-        bytes[1] = (uint8_t)((value >> 8) & 0xff);
-        bytes[2] = (uint8_t)((value >> 16) & 0xff);
-        bytes[3] = (uint8_t)((value >> 24) & 0xff);
-        bytes[4] = (uint8_t)((value >> 32) & 0xff); 
-        bytes[5] = (uint8_t)((value >> 40) & 0xff); 
-        bytes[6] = (uint8_t)((value >> 48) & 0xff); 
-        bytes[7] = (uint8_t)((value >> 56) & 0xff); 
+        uint64_to_bytes_le(value, bytes);
     } else {
-        bytes[0] = (uint8_t)((value >> 56) & 0xff);
-        bytes[1] = (uint8_t)((value >> 48) & 0xff);
-        bytes[2] = (uint8_t)((value >> 40) & 0xff);
-        bytes[3] = (uint8_t)((value >> 32) & 0xff);
-        bytes[4] = (uint8_t)((value >> 24) & 0xff);      
-        bytes[5] = (uint8_t)((value >> 16) & 0xff);
-        bytes[6] = (uint8_t)((value >> 8) & 0xff); 
-        bytes[7] = (uint8_t)(value & 0xff);
+        uint64_to_bytes_be(value, bytes);
     }
 }
 
 void int16_to_bytes(const int16_t value, uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        bytes[0] = (uint8_t)(value & 0xff);        // lsb
-        bytes[1] = (uint8_t)((value >> 8) & 0xff); // msb
-    } else {
-        bytes[0] = (uint8_t)((value >> 8) & 0xff); // msb
-        bytes[1] = (uint8_t)(value & 0xff);        // lsb
-    }
+    uint16_to_bytes((uint16_t)value, bytes, little_endian);
 }
 
 void int32_to_bytes(const int32_t value, uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        bytes[0] = (uint8_t)(value & 0xff);    
-        bytes[1] = (uint8_t)((value >> 8) & 0xff);
-        bytes[2] = (uint8_t)((value >> 16) & 0xff);
-        bytes[3] = (uint8_t)((value >> 24) & 0xff);
-    } else {
-        bytes[0] = (uint8_t)((value >> 24) & 0xff);      
-        bytes[1] = (uint8_t)((value >> 16) & 0xff);
-        bytes[2] = (uint8_t)((value >> 8) & 0xff); 
-        bytes[3] = (uint8_t)(value & 0xff);
-    }
+    uint32_to_bytes((uint32_t)value, bytes, little_endian);
 }
 
 void int64_to_bytes(const int64_t value, uint8_t* bytes, const bool little_endian) {
-    if(little_endian == true) {
-        bytes[0] = (uint8_t)(value & 0xff);   
-        bytes[1] = (uint8_t)((value >> 8) & 0xff);
-        bytes[2] = (uint8_t)((value >> 16) & 0xff);
-        bytes[3] = (uint8_t)((value >> 24) & 0xff);
-        bytes[4] = (uint8_t)((value >> 32) & 0xff); 
-        bytes[5] = (uint8_t)((value >> 40) & 0xff); 
-        bytes[6] = (uint8_t)((value >> 48) & 0xff); 
-        bytes[7] = (uint8_t)((value >> 56) & 0xff); 
-    } else {
-        bytes[0] = (uint8_t)((value >> 56) & 0xff);
-        bytes[1] = (uint8_t)((value >> 48) & 0xff);
-        bytes[2] = (uint8_t)((value >> 40) & 0xff);
-        bytes[3] = (uint8_t)((value >> 32) & 0xff);
-        bytes[4] = (uint8_t)((value >> 24) & 0xff);      
-        bytes[5] = (uint8_t)((value >> 16) & 0xff);
-        bytes[6] = (uint8_t)((value >> 8) & 0xff); 
-        bytes[7] = (uint8_t)(value & 0xff);
-    }
+    uint64_to_bytes((uint64_t)value, bytes, little_endian);
 }
 
 void float_to_bytes(const float value, uint8_t* bytes, const bool little_endian) {
     const union { uint32_t u32_value; float float32; } tmp = { .float32 = value };
-    if(little_endian == true) {
-        uint32_to_bytes(tmp.u32_value, bytes, true);
-    } else {
-        uint32_to_bytes(tmp.u32_value, bytes, false);
-    }
+    uint32_to_bytes(tmp.u32_value, bytes, little_endian);
 }
 
 void double_to_bytes(const double value, uint8_t* bytes, const bool little_endian) {
     const union { uint64_t u64_value; double double64; } tmp = { .double64 = value };
-    if(little_endian == true) {
-        uint64_to_bytes(tmp.u64_value, bytes, true);
-    } else {
-        uint64_to_bytes(tmp.u64_value, bytes, false);
+    uint64_to_bytes(tmp.u64_value, bytes, little_endian);
+}
+
+/*
+ * Bulk converters. The byte order is decided once per block, a block in host order
+ * is a single memcpy, otherwise a byte reversing loop the compiler can vectorize.
+*/
+
+static void copy_swap16(const void* source, void* destination, const size_t count, const bool swap) {
+    if(swap == false) {
+        memcpy(destination, source, count * 2);
+        return;
+    }
+    const uint8_t* restrict in = (const uint8_t*)source;
+    uint8_t* restrict out = (uint8_t*)destination;
+    for (size_t i = 0; i < count * 2; i += 2) {
+        out[i + 0] = in[i + 1];
+        out[i + 1] = in[i + 0];
+    }
+}
+
+static void copy_swap32(const void* source, void* destination, const size_t count, const bool swap) {
+    if(swap == false) {
+        memcpy(destination, source, count * 4);
+        return;
     }
+    const uint8_t* restrict in = (const uint8_t*)source;
+    uint8_t* restrict out = (uint8_t*)destination;
+    for (size_t i = 0; i < count * 4; i += 4) {
+        out[i + 0] = in[i + 3];
+        out[i + 1] = in[i + 2];
+        out[i + 2] = in[i + 1];
+        out[i + 3] = in[i + 0];
+    }
+}
+
+void uint16_array_to_bytes(const uint16_t* values, uint8_t* bytes, const size_t count, const bool little_endian) {
+    copy_swap16(values, bytes, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void int16_array_to_bytes(const int16_t* values, uint8_t* bytes, const size_t count, const bool little_endian) {
+    copy_swap16(values, bytes, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void uint32_array_to_bytes(const uint32_t* values, uint8_t* bytes, const size_t count, const bool little_endian) {
+    copy_swap32(values, bytes, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void int32_array_to_bytes(const int32_t* values, uint8_t* bytes, const size_t count, const bool little_endian) {
+    copy_swap32(values, bytes, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void float_array_to_bytes(const float* values, uint8_t* bytes, const size_t count, const bool little_endian) {
+    copy_swap32(values, bytes, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void bytes_to_uint16_array(const uint8_t* bytes, uint16_t* values, const size_t count, const bool little_endian) {
+    copy_swap16(bytes, values, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void bytes_to_int16_array(const uint8_t* bytes, int16_t* values, const size_t count, const bool little_endian) {
+    copy_swap16(bytes, values, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void bytes_to_uint32_array(const uint8_t* bytes, uint32_t* values, const size_t count, const bool little_endian) {
+    copy_swap32(bytes, values, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void bytes_to_int32_array(const uint8_t* bytes, int32_t* values, const size_t count, const bool little_endian) {
+    copy_swap32(bytes, values, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
+}
+
+void bytes_to_float_array(const uint8_t* bytes, float* values, const size_t count, const bool little_endian) {
+    copy_swap32(bytes, values, count, little_endian != TYPE_UTILS_HOST_LITTLE_ENDIAN);
 }
 
 void copy_bytes(const uint8_t* source, uint8_t* destination, const size_t size) {
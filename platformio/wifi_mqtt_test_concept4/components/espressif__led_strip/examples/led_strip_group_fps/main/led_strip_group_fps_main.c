@@ -0,0 +1,141 @@
+/*
+ * SPDX-FileCopyrightText: 2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Unlicense OR CC0-1.0
+ */
+#include <stdio.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/task.h"
+#include "esp_timer.h"
+#include "esp_log.h"
+#include "esp_err.h"
+#include "soc/soc_caps.h"
+#include "led_strip.h"
+
+// Data GPIO of every strip, the first ones get an RMT channel, the next one the SPI bus
+static const int s_strip_gpios[] = { 2, 3, 4, 5 };
+#define EXAMPLE_MAX_STRIPS      4
+#define EXAMPLE_LEDS_PER_STRIP  300
+#define EXAMPLE_FRAMES          100
+#define EXAMPLE_FRAME_RATE_HZ   60
+// 10MHz resolution, 1 tick = 0.1us (led strip needs a high resolution)
+#define EXAMPLE_RMT_RES_HZ      (10 * 1000 * 1000)
+
+static const char *TAG = "example";
+
+static uint8_t s_frame[EXAMPLE_LEDS_PER_STRIP * 3];
+
+static led_strip_handle_t new_strip(int index)
+{
+    led_strip_config_t strip_config = {
+        .strip_gpio_num = s_strip_gpios[index],
+        .max_leds = EXAMPLE_LEDS_PER_STRIP,
+        .led_pixel_format = LED_PIXEL_FORMAT_GRB,
+        .led_model = LED_MODEL_WS2812,
+    };
+    led_strip_handle_t strip = NULL;
+    if (index < SOC_RMT_TX_CANDIDATES_PER_GROUP) {
+        led_strip_rmt_config_t rmt_config = {
+            .clk_src = RMT_CLK_SRC_DEFAULT,
+            .resolution_hz = EXAMPLE_RMT_RES_HZ,
+        };
+        ESP_ERROR_CHECK(led_strip_new_rmt_device(&strip_config, &rmt_config, &strip));
+        ESP_LOGI(TAG, "strip %d: RMT, GPIO %d", index, s_strip_gpios[index]);
+    } else {
+        led_strip_spi_config_t spi_config = {
+            .clk_src = SPI_CLK_SRC_DEFAULT,
+            .spi_bus = SPI2_HOST,
+            .flags.with_dma = true,
+        };
+        ESP_ERROR_CHECK(led_strip_new_spi_device(&strip_config, &spi_config, &strip));
+        ESP_LOGI(TAG, "strip %d: SPI, GPIO %d", index, s_strip_gpios[index]);
+    }
+    return strip;
+}
+
+static void draw(led_strip_handle_t *strips, int count, int frame)
+{
+    for (int i = 0; i < EXAMPLE_LEDS_PER_STRIP; i++) {
+        uint8_t v = (uint8_t)(i + frame * 4);
+        s_frame[i * 3] = v >> 3;
+        s_frame[i * 3 + 1] = (uint8_t)(255 - v) >> 3;
+        s_frame[i * 3 + 2] = 4;
+    }
+    for (int s = 0; s < count; s++) {
+        ESP_ERROR_CHECK(led_strip_set_pixels(strips[s], s_frame, EXAMPLE_LEDS_PER_STRIP));
+    }
+}
+
+// one strip after the other with the blocking refresh, how it was done before the group
+static uint32_t measure_sequential(led_strip_handle_t *strips, int count)
+{
+    int64_t start = esp_timer_get_time();
+    for (int f = 0; f < EXAMPLE_FRAMES; f++) {
+        draw(strips, count, f);
+        for (int s = 0; s < count; s++) {
+            ESP_ERROR_CHECK(led_strip_refresh(strips[s]));
+        }
+    }
+    return (uint32_t)((esp_timer_get_time() - start) / EXAMPLE_FRAMES);
+}
+
+static void measure_group(led_strip_handle_t *strips, int count)
+{
+    uint32_t sequential_us = measure_sequential(strips, count);
+
+    led_strip_group_config_t group_config = {
+        .strips = strips,
+        .num_strips = count,
+    };
+    led_strip_group_handle_t group;
+    ESP_ERROR_CHECK(led_strip_new_group(&group_config, &group));
+    for (int f = 0; f < EXAMPLE_FRAMES; f++) {
+        draw(strips, count, f);
+        ESP_ERROR_CHECK(led_strip_group_refresh(group));
+    }
+    led_strip_group_stats_t parallel;
+    ESP_ERROR_CHECK(led_strip_group_get_stats(group, &parallel));
+    ESP_ERROR_CHECK(led_strip_group_del(group));
+
+    // the same strips paced by the frame clock, draw while the previous frame goes out
+    group_config.frame_rate_hz = EXAMPLE_FRAME_RATE_HZ;
+    ESP_ERROR_CHECK(led_strip_new_group(&group_config, &group));
+    for (int f = 0; f < EXAMPLE_FRAMES; f++) {
+        ESP_ERROR_CHECK(led_strip_group_wait_frame(group, -1));
+        draw(strips, count, f);
+        ESP_ERROR_CHECK(led_strip_group_present(group));
+    }
+    ESP_ERROR_CHECK(led_strip_group_wait_frame(group, -1));
+    led_strip_group_stats_t clocked;
+    ESP_ERROR_CHECK(led_strip_group_get_stats(group, &clocked));
+    ESP_ERROR_CHECK(led_strip_group_del(group));
+
+    // one line per strip count, picked up by a grep for #LEDFPS
+    printf("#LEDFPS,%d,%d,%lu,%lu,%lu,%lu,%lu,%lu,%lu\n", count, EXAMPLE_LEDS_PER_STRIP,
+           (unsigned long)sequential_us, (unsigned long)(1000000 / sequential_us),
+           (unsigned long)parallel.avg_frame_us, (unsigned long)parallel.max_frame_us,
+           (unsigned long)parallel.max_skew_us, (unsigned long)parallel.max_fps,
+           (unsigned long)clocked.late_ticks);
+}
+
+void app_main(void)
+{
+    int max_strips = SOC_RMT_TX_CANDIDATES_PER_GROUP + 1;
+    if (max_strips > EXAMPLE_MAX_STRIPS) {
+        max_strips = EXAMPLE_MAX_STRIPS;
+    }
+    led_strip_handle_t strips[EXAMPLE_MAX_STRIPS];
+    for (int i = 0; i < max_strips; i++) {
+        strips[i] = new_strip(i);
+    }
+
+    printf("#LEDFPS,strips,leds,sequential_us,sequential_fps,frame_us,max_frame_us,skew_us,max_fps,late_ticks_at_%d_hz\n",
+           EXAMPLE_FRAME_RATE_HZ);
+    for (int count = 1; count <= max_strips; count++) {
+        measure_group(strips, count);
+    }
+    for (int i = 0; i < max_strips; i++) {
+        led_strip_clear(strips[i]);
+    }
+    ESP_LOGI(TAG, "done");
+}
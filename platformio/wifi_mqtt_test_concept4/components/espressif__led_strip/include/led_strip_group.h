@@ -0,0 +1,155 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+#include "led_strip_types.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LED_STRIP_GROUP_MAX_STRIPS 8
+
+/**
+ * @brief Group of LED strips refreshed together
+ */
+typedef struct led_strip_group_t *led_strip_group_handle_t;
+
+/**
+ * @brief LED strip group configuration
+ */
+typedef struct {
+    const led_strip_handle_t *strips; /*!< Strips of the group, RMT and SPI backends can be mixed */
+    uint32_t num_strips;              /*!< Number of strips, at most LED_STRIP_GROUP_MAX_STRIPS */
+    uint32_t frame_rate_hz;           /*!< Frame clock for `led_strip_group_present`, 0 for none */
+} led_strip_group_config_t;
+
+/**
+ * @brief Frame timing of a group, all times in microseconds
+ */
+typedef struct {
+    uint32_t frames;          /*!< Frames sent */
+    uint32_t late_ticks;      /*!< Frame clock ticks that found the previous frame still going out */
+    uint32_t last_frame_us;   /*!< Start of the first strip to the end of the last one, last frame */
+    uint32_t avg_frame_us;    /*!< Same, average over all frames */
+    uint32_t max_frame_us;    /*!< Same, slowest frame */
+    uint32_t max_skew_us;     /*!< Start of the first strip to the start of the last one, worst frame */
+    uint32_t max_fps;         /*!< Frame rate the strips can sustain, 1000000 / avg_frame_us */
+} led_strip_group_stats_t;
+
+/**
+ * @brief Create a group of strips that are started back to back and run in parallel
+ *
+ * @note The group registers its own done callback on every strip, don't register another one
+ *       while the strip is in a group. Strips are not owned by the group.
+ *
+ * @param config: group configuration
+ * @param ret_group: returned group handle
+ *
+ * @return
+ *      - ESP_OK: Group created
+ *      - ESP_ERR_INVALID_ARG: No strips, too many strips or a NULL strip
+ *      - ESP_ERR_NOT_SUPPORTED: A strip backend has no asynchronous refresh
+ *      - ESP_ERR_NO_MEM: Out of memory
+ */
+esp_err_t led_strip_new_group(const led_strip_group_config_t *config, led_strip_group_handle_t *ret_group);
+
+/**
+ * @brief Start all strips now and wait until every one of them is out
+ *
+ * @param group: LED strip group
+ *
+ * @return
+ *      - ESP_OK: Frame sent on all strips
+ *      - ESP_FAIL: A strip failed to refresh
+ */
+esp_err_t led_strip_group_refresh(led_strip_group_handle_t group);
+
+/**
+ * @brief Start all strips now and return, waits only for a previous frame still going out
+ *
+ * @param group: LED strip group
+ *
+ * @return
+ *      - ESP_OK: Transmission started on all strips
+ *      - ESP_FAIL: A strip failed to refresh
+ */
+esp_err_t led_strip_group_refresh_async(led_strip_group_handle_t group);
+
+/**
+ * @brief Hand the current pixels to the frame clock, the next tick starts all strips
+ *
+ * @note The pixels are copied when the tick starts the frame, wait for the tick with
+ *       `led_strip_group_wait_frame` before drawing the next one.
+ *
+ * @param group: LED strip group
+ *
+ * @return
+ *      - ESP_OK: Frame queued for the next tick
+ *      - ESP_ERR_INVALID_STATE: The group has no frame clock
+ */
+esp_err_t led_strip_group_present(led_strip_group_handle_t group);
+
+/**
+ * @brief Block until the next tick of the frame clock
+ *
+ * @param group: LED strip group
+ * @param timeout_ms: maximum time to wait, -1 for no limit
+ *
+ * @return
+ *      - ESP_OK: A tick passed
+ *      - ESP_ERR_TIMEOUT: No tick within timeout_ms
+ *      - ESP_ERR_INVALID_STATE: The group has no frame clock
+ */
+esp_err_t led_strip_group_wait_frame(led_strip_group_handle_t group, int32_t timeout_ms);
+
+/**
+ * @brief Wait until the current frame is out on every strip
+ *
+ * @param group: LED strip group
+ * @param timeout_ms: maximum time to wait, -1 for no limit, 0 to poll
+ *
+ * @return
+ *      - ESP_OK: No transmission running
+ *      - ESP_ERR_TIMEOUT: A strip is still sending after timeout_ms
+ */
+esp_err_t led_strip_group_wait_done(led_strip_group_handle_t group, int32_t timeout_ms);
+
+/**
+ * @brief Get the frame timing measured so far
+ *
+ * @param group: LED strip group
+ * @param stats: returned statistics
+ *
+ * @return
+ *      - ESP_OK: Statistics copied
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ */
+esp_err_t led_strip_group_get_stats(led_strip_group_handle_t group, led_strip_group_stats_t *stats);
+
+/**
+ * @brief Clear the frame timing statistics
+ *
+ * @param group: LED strip group
+ */
+void led_strip_group_reset_stats(led_strip_group_handle_t group);
+
+/**
+ * @brief Stop the frame clock, wait for the last frame and free the group, the strips stay valid
+ *
+ * @param group: LED strip group
+ *
+ * @return
+ *      - ESP_OK: Group deleted
+ *      - ESP_ERR_INVALID_ARG: Invalid argument
+ */
+esp_err_t led_strip_group_del(led_strip_group_handle_t group);
+
+#ifdef __cplusplus
+}
+#endif
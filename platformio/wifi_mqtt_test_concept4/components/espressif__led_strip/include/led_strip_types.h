@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stdbool.h>
 
 #ifdef __cplusplus
 extern "C" {
@@ -30,11 +31,33 @@ typedef enum {
     LED_MODEL_INVALID /*!< Invalid LED strip model */
 } led_model_t;
 
+/**
+ * @brief Order the color components are sent to the LEDs in
+ */
+typedef enum {
+    LED_COLOR_ORDER_GRB, /*!< G, R, B (W), order of WS2812 and SK6812, the default */
+    LED_COLOR_ORDER_RGB, /*!< R, G, B (W) */
+    LED_COLOR_ORDER_RBG, /*!< R, B, G (W) */
+    LED_COLOR_ORDER_GBR, /*!< G, B, R (W) */
+    LED_COLOR_ORDER_BRG, /*!< B, R, G (W) */
+    LED_COLOR_ORDER_BGR, /*!< B, G, R (W) */
+    LED_COLOR_ORDER_INVALID /*!< Invalid color order */
+} led_color_order_t;
+
 /**
  * @brief LED strip handle
  */
 typedef struct led_strip_t *led_strip_handle_t;
 
+/**
+ * @brief Called from ISR context when a frame started by `led_strip_refresh_async` is out
+ *
+ * @param strip: LED strip that finished
+ * @param user_ctx: user data passed to `led_strip_register_done_callback`
+ * @return whether a high priority task has been woken up by this callback
+ */
+typedef bool (*led_strip_done_cb_t)(led_strip_handle_t strip, void *user_ctx);
+
 /**
  * @brief LED Strip Configuration
  */
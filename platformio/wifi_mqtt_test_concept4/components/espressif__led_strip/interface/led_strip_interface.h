@@ -7,6 +7,7 @@
 
 #include <stdint.h>
 #include "esp_err.h"
+#include "led_strip_types.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -51,6 +52,21 @@ struct led_strip_t {
      */
     esp_err_t (*set_pixel_rgbw)(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
 
+    /**
+     * @brief Set RGB for the first count pixels from packed R, G, B bytes
+     *
+     * @param strip: LED strip
+     * @param rgb: count * 3 bytes, red, green and blue of each pixel
+     * @param count: number of pixels to set
+     *
+     * @return
+     *      - ESP_OK: Set RGB for the pixels successfully
+     *      - ESP_ERR_INVALID_ARG: Set RGB for the pixels failed because count exceeds the strip length
+     *
+     * @note Optional, led_strip_set_pixels() falls back to set_pixel when NULL
+     */
+    esp_err_t (*set_pixels)(led_strip_t *strip, const uint8_t *rgb, uint32_t count);
+
     /**
      * @brief Refresh memory colors to LEDs
      *
@@ -66,6 +82,43 @@ struct led_strip_t {
      */
     esp_err_t (*refresh)(led_strip_t *strip);
 
+    /**
+     * @brief Start sending a snapshot of the memory colors and return without waiting
+     *
+     * @param strip: LED strip
+     *
+     * @return
+     *      - ESP_OK: Transmission started
+     *      - ESP_FAIL: Refresh failed because some other error occurred
+     *
+     * @note Optional, led_strip_refresh_async() falls back to refresh when NULL
+     */
+    esp_err_t (*refresh_async)(led_strip_t *strip);
+
+    /**
+     * @brief Wait until the frame started by refresh_async is out
+     *
+     * @param strip: LED strip
+     * @param timeout_ms: -1 waits forever, 0 only polls
+     *
+     * @return
+     *      - ESP_OK: No transmission running
+     *      - ESP_ERR_TIMEOUT: Still transmitting
+     */
+    esp_err_t (*wait_done)(led_strip_t *strip, int32_t timeout_ms);
+
+    /**
+     * @brief Set the function called from ISR context when a frame is out
+     *
+     * @param strip: LED strip
+     * @param cb: callback, NULL to remove it
+     * @param user_ctx: passed to cb
+     *
+     * @return
+     *      - ESP_OK: Callback set
+     */
+    esp_err_t (*register_done_callback)(led_strip_t *strip, led_strip_done_cb_t cb, void *user_ctx);
+
     /**
      * @brief Clear LED strip (turn off all LEDs)
      *
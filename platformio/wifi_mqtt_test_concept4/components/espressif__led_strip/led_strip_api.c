@@ -3,6 +3,7 @@
  *
  * SPDX-License-Identifier: Apache-2.0
  */
+#include <inttypes.h>
 #include "esp_log.h"
 #include "esp_check.h"
 #include "led_strip.h"
@@ -16,6 +17,18 @@ esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t
     return strip->set_pixel(strip, index, red, green, blue);
 }
 
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, const uint8_t *rgb, uint32_t count)
+{
+    ESP_RETURN_ON_FALSE(strip && (rgb || count == 0), ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->set_pixels) {
+        return strip->set_pixels(strip, rgb, count);
+    }
+    for (uint32_t i = 0; i < count; i++, rgb += 3) {
+        ESP_RETURN_ON_ERROR(strip->set_pixel(strip, i, rgb[0], rgb[1], rgb[2]), TAG, "set pixel %" PRIu32 " failed", i);
+    }
+    return ESP_OK;
+}
+
 esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint16_t hue, uint8_t saturation, uint8_t value)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
@@ -81,6 +94,31 @@ esp_err_t led_strip_refresh(led_strip_handle_t strip)
     return strip->refresh(strip);
 }
 
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->refresh_async) {
+        return strip->refresh_async(strip);
+    }
+    return strip->refresh(strip);
+}
+
+esp_err_t led_strip_wait_done(led_strip_handle_t strip, int32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (strip->wait_done) {
+        return strip->wait_done(strip, timeout_ms);
+    }
+    return ESP_OK;
+}
+
+esp_err_t led_strip_register_done_callback(led_strip_handle_t strip, led_strip_done_cb_t cb, void *user_ctx)
+{
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(strip->register_done_callback, ESP_ERR_NOT_SUPPORTED, TAG, "no asynchronous refresh on this backend");
+    return strip->register_done_callback(strip, cb, user_ctx);
+}
+
 esp_err_t led_strip_clear(led_strip_handle_t strip)
 {
     ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
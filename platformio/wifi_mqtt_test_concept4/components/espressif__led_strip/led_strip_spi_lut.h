@@ -0,0 +1,60 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#pragma once
+
+#include <stdint.h>
+#include <string.h>
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define SPI_BYTES_PER_COLOR_BYTE 3
+#define SPI_BITS_PER_COLOR_BYTE (SPI_BYTES_PER_COLOR_BYTE * 8)
+
+/*
+ * Each color bit is sent as 3 SPI bits, low_level:100, high_level:110, MSB first.
+ * So a color byte occupies 3 bytes of SPI, the table holds them for every byte value.
+ */
+#define LED_STRIP_SPI_B0(d) (0x92 | ((d) & 0x80 ? 0x40 : 0) | ((d) & 0x40 ? 0x08 : 0) | ((d) & 0x20 ? 0x01 : 0))
+#define LED_STRIP_SPI_B1(d) (0x49 | ((d) & 0x10 ? 0x20 : 0) | ((d) & 0x08 ? 0x04 : 0))
+#define LED_STRIP_SPI_B2(d) (0x24 | ((d) & 0x04 ? 0x80 : 0) | ((d) & 0x02 ? 0x10 : 0) | ((d) & 0x01 ? 0x02 : 0))
+#define LED_STRIP_SPI_E1(d) { LED_STRIP_SPI_B0(d), LED_STRIP_SPI_B1(d), LED_STRIP_SPI_B2(d) }
+#define LED_STRIP_SPI_E4(d) LED_STRIP_SPI_E1(d), LED_STRIP_SPI_E1((d) + 1), LED_STRIP_SPI_E1((d) + 2), LED_STRIP_SPI_E1((d) + 3)
+#define LED_STRIP_SPI_E16(d) LED_STRIP_SPI_E4(d), LED_STRIP_SPI_E4((d) + 4), LED_STRIP_SPI_E4((d) + 8), LED_STRIP_SPI_E4((d) + 12)
+#define LED_STRIP_SPI_E64(d) LED_STRIP_SPI_E16(d), LED_STRIP_SPI_E16((d) + 16), LED_STRIP_SPI_E16((d) + 32), LED_STRIP_SPI_E16((d) + 48)
+
+static const uint8_t led_strip_spi_lut[256][SPI_BYTES_PER_COLOR_BYTE] = {
+    LED_STRIP_SPI_E64(0), LED_STRIP_SPI_E64(64), LED_STRIP_SPI_E64(128), LED_STRIP_SPI_E64(192),
+};
+
+// encode one color byte into its 3 SPI bytes, no need to clear buf first
+static inline void led_strip_spi_encode(uint8_t data, uint8_t *buf)
+{
+    memcpy(buf, led_strip_spi_lut[data], SPI_BYTES_PER_COLOR_BYTE);
+}
+
+/*
+ * Encode count pixels of packed RGB input into GRB(W) SPI data, straight into the
+ * transmit buffer. bytes_per_pixel 4 sends white as 0.
+ */
+static inline void led_strip_spi_encode_pixels(uint8_t *buf, const uint8_t *rgb, uint32_t count, uint8_t bytes_per_pixel)
+{
+    for (uint32_t i = 0; i < count; i++, rgb += 3) {
+        led_strip_spi_encode(rgb[1], buf);
+        led_strip_spi_encode(rgb[0], buf + SPI_BYTES_PER_COLOR_BYTE);
+        led_strip_spi_encode(rgb[2], buf + SPI_BYTES_PER_COLOR_BYTE * 2);
+        buf += SPI_BYTES_PER_COLOR_BYTE * 3;
+        if (bytes_per_pixel > 3) {
+            led_strip_spi_encode(0, buf);
+            buf += SPI_BYTES_PER_COLOR_BYTE;
+        }
+    }
+}
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,256 @@
+/*
+ * SPDX-FileCopyrightText: 2022-2023 Espressif Systems (Shanghai) CO LTD
+ *
+ * SPDX-License-Identifier: Apache-2.0
+ */
+#include <stdlib.h>
+#include <string.h>
+#include "freertos/FreeRTOS.h"
+#include "freertos/semphr.h"
+#include "esp_log.h"
+#include "esp_check.h"
+#include "esp_attr.h"
+#include "esp_timer.h"
+#include "led_strip.h"
+#include "led_strip_group.h"
+
+static const char *TAG = "led_strip_group";
+
+typedef struct led_strip_group_t {
+    led_strip_handle_t strips[LED_STRIP_GROUP_MAX_STRIPS];
+    uint32_t num_strips;
+    esp_timer_handle_t frame_timer;
+    SemaphoreHandle_t tick_sem;         // given on every frame clock tick
+    SemaphoreHandle_t done_sem;         // given when the last strip of a frame is out
+    portMUX_TYPE lock;
+    uint32_t pending;                   // strips of the current frame still sending
+    bool presented;                     // frame waiting for the next tick
+    int64_t start_us;
+    uint64_t total_frame_us;
+    led_strip_group_stats_t stats;
+} led_strip_group_t;
+
+// account one strip of the current frame, true for the last one
+static bool IRAM_ATTR led_strip_group_finish_one(led_strip_group_t *group)
+{
+    bool last = false;
+    portENTER_CRITICAL_SAFE(&group->lock);
+    if (group->pending > 0 && --group->pending == 0) {
+        uint32_t frame_us = (uint32_t)(esp_timer_get_time() - group->start_us);
+        group->stats.frames++;
+        group->stats.last_frame_us = frame_us;
+        if (frame_us > group->stats.max_frame_us) {
+            group->stats.max_frame_us = frame_us;
+        }
+        group->total_frame_us += frame_us;
+        last = true;
+    }
+    portEXIT_CRITICAL_SAFE(&group->lock);
+    return last;
+}
+
+static bool IRAM_ATTR led_strip_group_strip_done(led_strip_handle_t strip, void *user_ctx)
+{
+    led_strip_group_t *group = (led_strip_group_t *)user_ctx;
+    BaseType_t woken = pdFALSE;
+    if (led_strip_group_finish_one(group)) {
+        xSemaphoreGiveFromISR(group->done_sem, &woken);
+    }
+    return woken == pdTRUE;
+}
+
+// start every strip back to back, the caller makes sure the previous frame is out
+static esp_err_t led_strip_group_start(led_strip_group_t *group)
+{
+    xSemaphoreTake(group->done_sem, 0);
+    portENTER_CRITICAL(&group->lock);
+    group->pending = group->num_strips;
+    group->start_us = esp_timer_get_time();
+    portEXIT_CRITICAL(&group->lock);
+
+    esp_err_t ret = ESP_OK;
+    for (uint32_t i = 0; i < group->num_strips; i++) {
+        if (led_strip_refresh_async(group->strips[i]) != ESP_OK) {
+            ESP_LOGE(TAG, "refresh strip %lu failed", (unsigned long)i);
+            // no done callback will come for this strip
+            if (led_strip_group_finish_one(group)) {
+                xSemaphoreGive(group->done_sem);
+            }
+            ret = ESP_FAIL;
+        }
+    }
+
+    uint32_t skew_us = (uint32_t)(esp_timer_get_time() - group->start_us);
+    portENTER_CRITICAL(&group->lock);
+    if (skew_us > group->stats.max_skew_us) {
+        group->stats.max_skew_us = skew_us;
+    }
+    portEXIT_CRITICAL(&group->lock);
+    return ret;
+}
+
+static void led_strip_group_tick(void *arg)
+{
+    led_strip_group_t *group = (led_strip_group_t *)arg;
+
+    portENTER_CRITICAL(&group->lock);
+    bool start = group->presented && group->pending == 0;
+    if (group->presented && !start) {
+        group->stats.late_ticks++;
+    }
+    if (start) {
+        group->presented = false;
+    }
+    portEXIT_CRITICAL(&group->lock);
+
+    if (start) {
+        led_strip_group_start(group);
+    }
+    xSemaphoreGive(group->tick_sem);
+}
+
+esp_err_t led_strip_group_wait_done(led_strip_group_handle_t group, int32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    for (;;) {
+        portENTER_CRITICAL(&group->lock);
+        uint32_t pending = group->pending;
+        portEXIT_CRITICAL(&group->lock);
+        if (pending == 0) {
+            return ESP_OK;
+        }
+        // no log on purpose, a timeout is the expected answer while polling
+        if (xSemaphoreTake(group->done_sem, ticks) != pdTRUE) {
+            return ESP_ERR_TIMEOUT;
+        }
+    }
+}
+
+esp_err_t led_strip_group_refresh_async(led_strip_group_handle_t group)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_ERROR(led_strip_group_wait_done(group, -1), TAG, "wait previous frame failed");
+    return led_strip_group_start(group);
+}
+
+esp_err_t led_strip_group_refresh(led_strip_group_handle_t group)
+{
+    ESP_RETURN_ON_ERROR(led_strip_group_refresh_async(group), TAG, "refresh failed");
+    return led_strip_group_wait_done(group, -1);
+}
+
+esp_err_t led_strip_group_present(led_strip_group_handle_t group)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(group->frame_timer, ESP_ERR_INVALID_STATE, TAG, "group has no frame clock");
+    portENTER_CRITICAL(&group->lock);
+    group->presented = true;
+    portEXIT_CRITICAL(&group->lock);
+    return ESP_OK;
+}
+
+esp_err_t led_strip_group_wait_frame(led_strip_group_handle_t group, int32_t timeout_ms)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(group->frame_timer, ESP_ERR_INVALID_STATE, TAG, "group has no frame clock");
+    TickType_t ticks = timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms);
+    return xSemaphoreTake(group->tick_sem, ticks) == pdTRUE ? ESP_OK : ESP_ERR_TIMEOUT;
+}
+
+esp_err_t led_strip_group_get_stats(led_strip_group_handle_t group, led_strip_group_stats_t *stats)
+{
+    ESP_RETURN_ON_FALSE(group && stats, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    portENTER_CRITICAL(&group->lock);
+    *stats = group->stats;
+    uint64_t total = group->total_frame_us;
+    portEXIT_CRITICAL(&group->lock);
+    if (stats->frames) {
+        stats->avg_frame_us = (uint32_t)(total / stats->frames);
+    }
+    stats->max_fps = stats->avg_frame_us ? 1000000 / stats->avg_frame_us : 0;
+    return ESP_OK;
+}
+
+void led_strip_group_reset_stats(led_strip_group_handle_t group)
+{
+    if (group == NULL) {
+        return;
+    }
+    portENTER_CRITICAL(&group->lock);
+    memset(&group->stats, 0, sizeof(group->stats));
+    group->total_frame_us = 0;
+    portEXIT_CRITICAL(&group->lock);
+}
+
+static void led_strip_group_free(led_strip_group_t *group)
+{
+    for (uint32_t i = 0; i < group->num_strips; i++) {
+        led_strip_register_done_callback(group->strips[i], NULL, NULL);
+    }
+    if (group->frame_timer) {
+        esp_timer_delete(group->frame_timer);
+    }
+    if (group->tick_sem) {
+        vSemaphoreDelete(group->tick_sem);
+    }
+    if (group->done_sem) {
+        vSemaphoreDelete(group->done_sem);
+    }
+    free(group);
+}
+
+esp_err_t led_strip_new_group(const led_strip_group_config_t *config, led_strip_group_handle_t *ret_group)
+{
+    led_strip_group_t *group = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(config && ret_group && config->strips && config->num_strips > 0, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->num_strips <= LED_STRIP_GROUP_MAX_STRIPS, ESP_ERR_INVALID_ARG, err, TAG,
+                      "at most %d strips", LED_STRIP_GROUP_MAX_STRIPS);
+    group = calloc(1, sizeof(led_strip_group_t));
+    ESP_GOTO_ON_FALSE(group, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip group");
+    portMUX_INITIALIZE(&group->lock);
+    group->done_sem = xSemaphoreCreateBinary();
+    group->tick_sem = xSemaphoreCreateBinary();
+    ESP_GOTO_ON_FALSE(group->done_sem && group->tick_sem, ESP_ERR_NO_MEM, err, TAG, "no mem for semaphores");
+
+    for (uint32_t i = 0; i < config->num_strips; i++) {
+        ESP_GOTO_ON_FALSE(config->strips[i], ESP_ERR_INVALID_ARG, err, TAG, "strip %lu is NULL", (unsigned long)i);
+        ESP_GOTO_ON_ERROR(led_strip_register_done_callback(config->strips[i], led_strip_group_strip_done, group), err, TAG,
+                          "strip %lu has no asynchronous refresh", (unsigned long)i);
+        group->strips[i] = config->strips[i];
+        group->num_strips = i + 1;
+    }
+
+    if (config->frame_rate_hz) {
+        esp_timer_create_args_t timer_args = {
+            .callback = led_strip_group_tick,
+            .arg = group,
+            .dispatch_method = ESP_TIMER_TASK,
+            .name = "led_frame",
+            .skip_unhandled_events = true,
+        };
+        ESP_GOTO_ON_ERROR(esp_timer_create(&timer_args, &group->frame_timer), err, TAG, "create frame clock failed");
+        ESP_GOTO_ON_ERROR(esp_timer_start_periodic(group->frame_timer, 1000000ULL / config->frame_rate_hz), err, TAG,
+                          "start frame clock failed");
+    }
+
+    *ret_group = group;
+    return ESP_OK;
+err:
+    if (group) {
+        led_strip_group_free(group);
+    }
+    return ret;
+}
+
+esp_err_t led_strip_group_del(led_strip_group_handle_t group)
+{
+    ESP_RETURN_ON_FALSE(group, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    if (group->frame_timer) {
+        esp_timer_stop(group->frame_timer);
+    }
+    ESP_RETURN_ON_ERROR(led_strip_group_wait_done(group, -1), TAG, "wait last frame failed");
+    led_strip_group_free(group);
+    return ESP_OK;
+}
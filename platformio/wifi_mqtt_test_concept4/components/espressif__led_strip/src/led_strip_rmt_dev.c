@@ -8,6 +8,7 @@
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_attr.h"
 #include "driver/rmt_tx.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
@@ -30,9 +31,23 @@ typedef struct {
     rmt_encoder_handle_t strip_encoder;
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
-    uint8_t pixel_buf[];
+    bool static_storage;
+    bool enabled;               // RMT channel enabled, left on by async refreshes
+    bool busy;                  // a transmission of tx_buf may still be running
+    uint8_t *pixel_buf;         // written by set_pixel, never transmitted directly
+    uint8_t *tx_buf;            // snapshot of pixel_buf being transmitted
+    led_strip_done_cb_t done_cb;
+    void *done_ctx;
 } led_strip_rmt_obj;
 
+// layout of led_strip_rmt_static_t: driver object followed by the strip encoder
+typedef struct {
+    led_strip_rmt_obj obj;
+    led_strip_encoder_static_t encoder;
+} led_strip_rmt_static_layout_t;
+
+_Static_assert(sizeof(led_strip_rmt_static_layout_t) <= sizeof(led_strip_rmt_static_t), "led_strip_rmt_static_t too small");
+
 static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -48,6 +63,23 @@ static esp_err_t led_strip_rmt_set_pixel(led_strip_t *strip, uint32_t index, uin
     return ESP_OK;
 }
 
+static esp_err_t led_strip_rmt_set_pixels(led_strip_t *strip, const uint8_t *rgb, uint32_t count)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_FALSE(count <= rmt_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "count out of maximum number of LEDs");
+    uint8_t *buf = rmt_strip->pixel_buf;
+    uint8_t bytes_per_pixel = rmt_strip->bytes_per_pixel;
+    for (uint32_t i = 0; i < count; i++, rgb += 3, buf += bytes_per_pixel) {
+        buf[0] = rgb[1];
+        buf[1] = rgb[0];
+        buf[2] = rgb[2];
+        if (bytes_per_pixel > 3) {
+            buf[3] = 0;
+        }
+    }
+    return ESP_OK;
+}
+
 static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
@@ -62,18 +94,66 @@ static esp_err_t led_strip_rmt_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     return ESP_OK;
 }
 
-static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+static bool IRAM_ATTR led_strip_rmt_trans_done(rmt_channel_handle_t chan, const rmt_tx_done_event_data_t *edata, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = (led_strip_rmt_obj *)user_ctx;
+    if (rmt_strip->done_cb) {
+        return rmt_strip->done_cb(&rmt_strip->base, rmt_strip->done_ctx);
+    }
+    return false;
+}
+
+static esp_err_t led_strip_rmt_wait_done(led_strip_t *strip, int32_t timeout_ms)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    if (!rmt_strip->busy) {
+        return ESP_OK;
+    }
+    // no log on purpose, a timeout is the expected answer while polling
+    esp_err_t ret = rmt_tx_wait_all_done(rmt_strip->rmt_chan, timeout_ms);
+    if (ret == ESP_OK) {
+        rmt_strip->busy = false;
+    }
+    return ret;
+}
+
+static esp_err_t led_strip_rmt_refresh_async(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
     rmt_transmit_config_t tx_conf = {
         .loop_count = 0,
     };
+    size_t len = rmt_strip->strip_len * rmt_strip->bytes_per_pixel;
+
+    // tx_buf may only change once the previous frame is out, usually long done by now
+    ESP_RETURN_ON_ERROR(led_strip_rmt_wait_done(strip, -1), TAG, "wait previous frame failed");
+    memcpy(rmt_strip->tx_buf, rmt_strip->pixel_buf, len);
+    if (!rmt_strip->enabled) {
+        ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
+        rmt_strip->enabled = true;
+    }
+    ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, rmt_strip->tx_buf, len, &tx_conf),
+                        TAG, "transmit pixels by RMT failed");
+    rmt_strip->busy = true;
+    return ESP_OK;
+}
 
-    ESP_RETURN_ON_ERROR(rmt_enable(rmt_strip->rmt_chan), TAG, "enable RMT channel failed");
-    ESP_RETURN_ON_ERROR(rmt_transmit(rmt_strip->rmt_chan, rmt_strip->strip_encoder, rmt_strip->pixel_buf,
-                                     rmt_strip->strip_len * rmt_strip->bytes_per_pixel, &tx_conf), TAG, "transmit pixels by RMT failed");
-    ESP_RETURN_ON_ERROR(rmt_tx_wait_all_done(rmt_strip->rmt_chan, -1), TAG, "flush RMT channel failed");
+static esp_err_t led_strip_rmt_refresh(led_strip_t *strip)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_ERROR(led_strip_rmt_refresh_async(strip), TAG, "refresh failed");
+    ESP_RETURN_ON_ERROR(led_strip_rmt_wait_done(strip, -1), TAG, "wait refresh failed");
     ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+    rmt_strip->enabled = false;
+    return ESP_OK;
+}
+
+static esp_err_t led_strip_rmt_register_done_callback(led_strip_t *strip, led_strip_done_cb_t cb, void *user_ctx)
+{
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_ERROR(led_strip_rmt_wait_done(strip, -1), TAG, "wait refresh failed");
+    rmt_strip->done_cb = cb;
+    rmt_strip->done_ctx = user_ctx;
     return ESP_OK;
 }
 
@@ -88,28 +168,46 @@ static esp_err_t led_strip_rmt_clear(led_strip_t *strip)
 static esp_err_t led_strip_rmt_del(led_strip_t *strip)
 {
     led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    ESP_RETURN_ON_ERROR(led_strip_rmt_wait_done(strip, -1), TAG, "wait refresh failed");
+    if (rmt_strip->enabled) {
+        ESP_RETURN_ON_ERROR(rmt_disable(rmt_strip->rmt_chan), TAG, "disable RMT channel failed");
+        rmt_strip->enabled = false;
+    }
     ESP_RETURN_ON_ERROR(rmt_del_channel(rmt_strip->rmt_chan), TAG, "delete RMT channel failed");
     ESP_RETURN_ON_ERROR(rmt_del_encoder(rmt_strip->strip_encoder), TAG, "delete strip encoder failed");
-    free(rmt_strip);
+    if (!rmt_strip->static_storage) {
+        free(rmt_strip);
+    }
     return ESP_OK;
 }
 
-esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+esp_err_t led_strip_rmt_set_correction(led_strip_handle_t strip, const led_strip_rmt_correction_t *correction)
 {
-    led_strip_rmt_obj *rmt_strip = NULL;
-    esp_err_t ret = ESP_OK;
-    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
-    ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
-    uint8_t bytes_per_pixel = 3;
-    if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
-        bytes_per_pixel = 4;
-    } else if (led_config->led_pixel_format == LED_PIXEL_FORMAT_GRB) {
-        bytes_per_pixel = 3;
-    } else {
-        assert(false);
+    ESP_RETURN_ON_FALSE(strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_strip_rmt_obj *rmt_strip = __containerof(strip, led_strip_rmt_obj, base);
+    // the encoder reads the table while a frame goes out
+    ESP_RETURN_ON_ERROR(led_strip_rmt_wait_done(strip, -1), TAG, "wait refresh failed");
+    return rmt_led_strip_encoder_set_correction(rmt_strip->strip_encoder, correction);
+}
+#endif
+
+static uint8_t led_strip_rmt_bytes_per_pixel(led_pixel_format_t led_pixel_format)
+{
+    if (led_pixel_format == LED_PIXEL_FORMAT_GRBW) {
+        return 4;
+    } else if (led_pixel_format == LED_PIXEL_FORMAT_GRB) {
+        return 3;
     }
-    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + led_config->max_leds * bytes_per_pixel);
-    ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    assert(false);
+    return 3;
+}
+
+// create the RMT channel and strip encoder, encoder_storage selects the static encoder
+static esp_err_t led_strip_rmt_init(led_strip_rmt_obj *rmt_strip, const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                    led_strip_encoder_static_t *encoder_storage)
+{
+    esp_err_t ret = ESP_OK;
     uint32_t resolution = rmt_config->resolution_hz ? rmt_config->resolution_hz : LED_STRIP_RMT_DEFAULT_RESOLUTION;
 
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -132,33 +230,86 @@ esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const l
         .flags.invert_out = led_config->flags.invert_out,
     };
     ESP_GOTO_ON_ERROR(rmt_new_tx_channel(&rmt_chan_config, &rmt_strip->rmt_chan), err, TAG, "create RMT TX channel failed");
+    rmt_tx_event_callbacks_t cbs = {
+        .on_trans_done = led_strip_rmt_trans_done,
+    };
+    ESP_GOTO_ON_ERROR(rmt_tx_register_event_callbacks(rmt_strip->rmt_chan, &cbs, rmt_strip), err, TAG, "register RMT callback failed");
 
     led_strip_encoder_config_t strip_encoder_conf = {
         .resolution = resolution,
-        .led_model = led_config->led_model
+        .led_model = led_config->led_model,
+        .bytes_per_pixel = led_strip_rmt_bytes_per_pixel(led_config->led_pixel_format),
     };
-    ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
-
+    if (encoder_storage) {
+        ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder_static(&strip_encoder_conf, encoder_storage, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
+    } else {
+        ESP_GOTO_ON_ERROR(rmt_new_led_strip_encoder(&strip_encoder_conf, &rmt_strip->strip_encoder), err, TAG, "create LED strip encoder failed");
+    }
 
-    rmt_strip->bytes_per_pixel = bytes_per_pixel;
+    rmt_strip->bytes_per_pixel = led_strip_rmt_bytes_per_pixel(led_config->led_pixel_format);
     rmt_strip->strip_len = led_config->max_leds;
     rmt_strip->base.set_pixel = led_strip_rmt_set_pixel;
     rmt_strip->base.set_pixel_rgbw = led_strip_rmt_set_pixel_rgbw;
+    rmt_strip->base.set_pixels = led_strip_rmt_set_pixels;
     rmt_strip->base.refresh = led_strip_rmt_refresh;
+    rmt_strip->base.refresh_async = led_strip_rmt_refresh_async;
+    rmt_strip->base.wait_done = led_strip_rmt_wait_done;
+    rmt_strip->base.register_done_callback = led_strip_rmt_register_done_callback;
     rmt_strip->base.clear = led_strip_rmt_clear;
     rmt_strip->base.del = led_strip_rmt_del;
+    return ESP_OK;
+err:
+    if (rmt_strip->rmt_chan) {
+        rmt_del_channel(rmt_strip->rmt_chan);
+        rmt_strip->rmt_chan = NULL;
+    }
+    if (rmt_strip->strip_encoder) {
+        rmt_del_encoder(rmt_strip->strip_encoder);
+        rmt_strip->strip_encoder = NULL;
+    }
+    return ret;
+}
+
+esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip)
+{
+    led_strip_rmt_obj *rmt_strip = NULL;
+    esp_err_t ret = ESP_OK;
+    ESP_GOTO_ON_FALSE(led_config && rmt_config && ret_strip, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led_pixel_format");
+    uint8_t bytes_per_pixel = led_strip_rmt_bytes_per_pixel(led_config->led_pixel_format);
+    // pixel and transmit buffers live right behind the driver object
+    rmt_strip = calloc(1, sizeof(led_strip_rmt_obj) + 2 * led_config->max_leds * bytes_per_pixel);
+    ESP_GOTO_ON_FALSE(rmt_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for rmt strip");
+    rmt_strip->pixel_buf = (uint8_t *)(rmt_strip + 1);
+    rmt_strip->tx_buf = rmt_strip->pixel_buf + led_config->max_leds * bytes_per_pixel;
+    ESP_GOTO_ON_ERROR(led_strip_rmt_init(rmt_strip, led_config, rmt_config, NULL), err, TAG, "init rmt strip failed");
 
     *ret_strip = &rmt_strip->base;
     return ESP_OK;
 err:
-    if (rmt_strip) {
-        if (rmt_strip->rmt_chan) {
-            rmt_del_channel(rmt_strip->rmt_chan);
-        }
-        if (rmt_strip->strip_encoder) {
-            rmt_del_encoder(rmt_strip->strip_encoder);
-        }
-        free(rmt_strip);
-    }
+    free(rmt_strip);
     return ret;
 }
+
+esp_err_t led_strip_new_rmt_device_static(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                          led_strip_rmt_static_t *storage, uint8_t *pixel_buf, size_t pixel_buf_size,
+                                          led_strip_handle_t *ret_strip)
+{
+    ESP_RETURN_ON_FALSE(led_config && rmt_config && storage && pixel_buf && ret_strip, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(led_config->led_pixel_format < LED_PIXEL_FORMAT_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid led_pixel_format");
+    uint8_t bytes_per_pixel = led_strip_rmt_bytes_per_pixel(led_config->led_pixel_format);
+    size_t frame_size = led_config->max_leds * bytes_per_pixel;
+    ESP_RETURN_ON_FALSE(pixel_buf_size >= 2 * frame_size, ESP_ERR_INVALID_SIZE, TAG, "pixel buffer too small");
+
+    led_strip_rmt_static_layout_t *layout = (led_strip_rmt_static_layout_t *)storage;
+    led_strip_rmt_obj *rmt_strip = &layout->obj;
+    memset(layout, 0, sizeof(*layout));
+    memset(pixel_buf, 0, 2 * frame_size);
+    rmt_strip->static_storage = true;
+    rmt_strip->pixel_buf = pixel_buf;
+    rmt_strip->tx_buf = pixel_buf + frame_size;
+    ESP_RETURN_ON_ERROR(led_strip_rmt_init(rmt_strip, led_config, rmt_config, &layout->encoder), TAG, "init rmt strip failed");
+
+    *ret_strip = &rmt_strip->base;
+    return ESP_OK;
+}
@@ -4,19 +4,34 @@
  * SPDX-License-Identifier: Apache-2.0
  */
 
+#include <string.h>
+#include <math.h>
 #include "esp_check.h"
 #include "led_strip_rmt_encoder.h"
 
+// pixels go through a simple encoder with the correction table when available
+#define LED_STRIP_ENCODER_CORRECTION (ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0))
+
 static const char *TAG = "led_rmt_encoder";
 
 typedef struct {
     rmt_encoder_t base;
-    rmt_encoder_t *bytes_encoder;
+    rmt_encoder_t *bytes_encoder;   // encodes the pixels, a simple encoder applying lut with LED_STRIP_ENCODER_CORRECTION
     rmt_encoder_t *copy_encoder;
     int state;
     rmt_symbol_word_t reset_code;
+    bool static_storage;
+#if LED_STRIP_ENCODER_CORRECTION
+    rmt_symbol_word_t bit0;
+    rmt_symbol_word_t bit1;
+    uint8_t bytes_per_pixel;
+    uint8_t order[4];               // source byte of each byte sent within a pixel
+    uint8_t lut[256];               // gamma and brightness
+#endif
 } rmt_led_strip_encoder_t;
 
+_Static_assert(sizeof(rmt_led_strip_encoder_t) <= sizeof(led_strip_encoder_static_t), "led_strip_encoder_static_t too small");
+
 static size_t rmt_encode_led_strip(rmt_encoder_t *encoder, rmt_channel_handle_t channel, const void *primary_data, size_t data_size, rmt_encode_state_t *ret_state)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
@@ -53,12 +68,81 @@ out:
     return encoded_symbols;
 }
 
+#if LED_STRIP_ENCODER_CORRECTION
+// pixel buffer is G, R, B (W); position of G, R and B for every led_color_order_t
+static const uint8_t s_color_orders[LED_COLOR_ORDER_INVALID][3] = {
+    [LED_COLOR_ORDER_GRB] = {0, 1, 2},
+    [LED_COLOR_ORDER_RGB] = {1, 0, 2},
+    [LED_COLOR_ORDER_RBG] = {1, 2, 0},
+    [LED_COLOR_ORDER_GBR] = {0, 2, 1},
+    [LED_COLOR_ORDER_BRG] = {2, 1, 0},
+    [LED_COLOR_ORDER_BGR] = {2, 0, 1},
+};
+
+/*
+ * Simple encoder callback: 8 symbols per byte, MSB first, every byte looked up in
+ * the correction table and taken from its color order position. Constant work per
+ * byte, the pixel buffer itself is never touched.
+ */
+static size_t rmt_encode_led_strip_pixels(const void *data, size_t data_size, size_t symbols_written, size_t symbols_free,
+                                          rmt_symbol_word_t *symbols, bool *done, void *arg)
+{
+    rmt_led_strip_encoder_t *led_encoder = (rmt_led_strip_encoder_t *)arg;
+    const uint8_t *pixels = (const uint8_t *)data;
+    uint8_t bytes_per_pixel = led_encoder->bytes_per_pixel;
+    size_t pos = symbols_written / 8;
+    size_t pixel = pos - pos % bytes_per_pixel;
+    uint8_t k = pos - pixel;
+    size_t n = 0;
+    while (pos < data_size && symbols_free - n >= 8) {
+        uint8_t v = led_encoder->lut[pixels[pixel + led_encoder->order[k]]];
+        for (int bit = 7; bit >= 0; bit--) {
+            symbols[n++] = (v >> bit) & 1 ? led_encoder->bit1 : led_encoder->bit0;
+        }
+        pos++;
+        if (++k == bytes_per_pixel) {
+            k = 0;
+            pixel += bytes_per_pixel;
+        }
+    }
+    *done = pos >= data_size;
+    return n;
+}
+
+esp_err_t rmt_led_strip_encoder_set_correction(rmt_encoder_handle_t encoder, const led_strip_rmt_correction_t *correction)
+{
+    ESP_RETURN_ON_FALSE(encoder, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    led_strip_rmt_correction_t none = {
+        .gamma = 1.0f,
+        .brightness = 255,
+        .color_order = LED_COLOR_ORDER_GRB,
+    };
+    if (!correction) {
+        correction = &none;
+    }
+    ESP_RETURN_ON_FALSE(correction->color_order < LED_COLOR_ORDER_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid color order");
+    ESP_RETURN_ON_FALSE(correction->gamma >= 0.0f && correction->gamma <= 5.0f, ESP_ERR_INVALID_ARG, TAG, "gamma out of range");
+    rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
+
+    float gamma = correction->gamma > 0.0f ? correction->gamma : 1.0f;
+    for (int i = 0; i < 256; i++) {
+        float level = gamma == 1.0f ? i / 255.0f : powf(i / 255.0f, gamma);
+        led_encoder->lut[i] = (uint8_t)(level * correction->brightness + 0.5f);
+    }
+    memcpy(led_encoder->order, s_color_orders[correction->color_order], 3);
+    led_encoder->order[3] = 3; // white stays last
+    return ESP_OK;
+}
+#endif
+
 static esp_err_t rmt_del_led_strip_encoder(rmt_encoder_t *encoder)
 {
     rmt_led_strip_encoder_t *led_encoder = __containerof(encoder, rmt_led_strip_encoder_t, base);
     rmt_del_encoder(led_encoder->bytes_encoder);
     rmt_del_encoder(led_encoder->copy_encoder);
-    free(led_encoder);
+    if (!led_encoder->static_storage) {
+        free(led_encoder);
+    }
     return ESP_OK;
 }
 
@@ -71,14 +155,9 @@ static esp_err_t rmt_led_strip_encoder_reset(rmt_encoder_t *encoder)
     return ESP_OK;
 }
 
-esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+static esp_err_t led_strip_encoder_init(rmt_led_strip_encoder_t *led_encoder, const led_strip_encoder_config_t *config)
 {
     esp_err_t ret = ESP_OK;
-    rmt_led_strip_encoder_t *led_encoder = NULL;
-    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
-    ESP_GOTO_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
-    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
-    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
     led_encoder->base.encode = rmt_encode_led_strip;
     led_encoder->base.del = rmt_del_led_strip_encoder;
     led_encoder->base.reset = rmt_led_strip_encoder_reset;
@@ -119,7 +198,20 @@ esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rm
     } else {
         assert(false);
     }
+#if LED_STRIP_ENCODER_CORRECTION
+    led_encoder->bit0 = bytes_encoder_config.bit0;
+    led_encoder->bit1 = bytes_encoder_config.bit1;
+    led_encoder->bytes_per_pixel = config->bytes_per_pixel ? config->bytes_per_pixel : 3;
+    rmt_led_strip_encoder_set_correction(&led_encoder->base, NULL);
+    rmt_simple_encoder_config_t pixel_encoder_config = {
+        .callback = rmt_encode_led_strip_pixels,
+        .arg = led_encoder,
+        .min_chunk_size = 8, // one color byte
+    };
+    ESP_GOTO_ON_ERROR(rmt_new_simple_encoder(&pixel_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create pixel encoder failed");
+#else
     ESP_GOTO_ON_ERROR(rmt_new_bytes_encoder(&bytes_encoder_config, &led_encoder->bytes_encoder), err, TAG, "create bytes encoder failed");
+#endif
     rmt_copy_encoder_config_t copy_encoder_config = {};
     ESP_GOTO_ON_ERROR(rmt_new_copy_encoder(&copy_encoder_config, &led_encoder->copy_encoder), err, TAG, "create copy encoder failed");
 
@@ -130,17 +222,43 @@ esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rm
         .level1 = 0,
         .duration1 = reset_ticks,
     };
-    *ret_encoder = &led_encoder->base;
     return ESP_OK;
 err:
-    if (led_encoder) {
-        if (led_encoder->bytes_encoder) {
-            rmt_del_encoder(led_encoder->bytes_encoder);
-        }
-        if (led_encoder->copy_encoder) {
-            rmt_del_encoder(led_encoder->copy_encoder);
-        }
-        free(led_encoder);
+    if (led_encoder->bytes_encoder) {
+        rmt_del_encoder(led_encoder->bytes_encoder);
+        led_encoder->bytes_encoder = NULL;
+    }
+    if (led_encoder->copy_encoder) {
+        rmt_del_encoder(led_encoder->copy_encoder);
+        led_encoder->copy_encoder = NULL;
     }
     return ret;
 }
+
+esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder)
+{
+    esp_err_t ret = ESP_OK;
+    rmt_led_strip_encoder_t *led_encoder = NULL;
+    ESP_GOTO_ON_FALSE(config && ret_encoder, ESP_ERR_INVALID_ARG, err, TAG, "invalid argument");
+    ESP_GOTO_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, err, TAG, "invalid led model");
+    led_encoder = calloc(1, sizeof(rmt_led_strip_encoder_t));
+    ESP_GOTO_ON_FALSE(led_encoder, ESP_ERR_NO_MEM, err, TAG, "no mem for led strip encoder");
+    ESP_GOTO_ON_ERROR(led_strip_encoder_init(led_encoder, config), err, TAG, "init led strip encoder failed");
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+err:
+    free(led_encoder);
+    return ret;
+}
+
+esp_err_t rmt_new_led_strip_encoder_static(const led_strip_encoder_config_t *config, led_strip_encoder_static_t *storage, rmt_encoder_handle_t *ret_encoder)
+{
+    ESP_RETURN_ON_FALSE(config && storage && ret_encoder, ESP_ERR_INVALID_ARG, TAG, "invalid argument");
+    ESP_RETURN_ON_FALSE(config->led_model < LED_MODEL_INVALID, ESP_ERR_INVALID_ARG, TAG, "invalid led model");
+    rmt_led_strip_encoder_t *led_encoder = (rmt_led_strip_encoder_t *)storage;
+    memset(led_encoder, 0, sizeof(*led_encoder));
+    led_encoder->static_storage = true;
+    ESP_RETURN_ON_ERROR(led_strip_encoder_init(led_encoder, config), TAG, "init led strip encoder failed");
+    *ret_encoder = &led_encoder->base;
+    return ESP_OK;
+}
@@ -6,8 +6,10 @@
 #pragma once
 
 #include <stdint.h>
+#include "esp_idf_version.h"
 #include "driver/rmt_encoder.h"
 #include "led_strip_types.h"
+#include "led_strip_rmt.h"
 
 #ifdef __cplusplus
 extern "C" {
@@ -19,6 +21,7 @@ extern "C" {
 typedef struct {
     uint32_t resolution;   /*!< Encoder resolution, in Hz */
     led_model_t led_model; /*!< LED model */
+    uint8_t bytes_per_pixel; /*!< 3 for GRB, 4 for GRBW, 0 is taken as 3 */
 } led_strip_encoder_config_t;
 
 /**
@@ -33,6 +36,41 @@ typedef struct {
  */
 esp_err_t rmt_new_led_strip_encoder(const led_strip_encoder_config_t *config, rmt_encoder_handle_t *ret_encoder);
 
+/**
+ * @brief Memory for a LED strip encoder created by rmt_new_led_strip_encoder_static()
+ */
+typedef struct {
+    void *reserved[16 + 256 / sizeof(void *)];
+} led_strip_encoder_static_t;
+
+/**
+ * @brief Create RMT encoder for encoding LED strip pixels into RMT symbols, in caller provided memory
+ *
+ * @note The nested bytes and copy encoders are still allocated by the RMT driver.
+ *
+ * @param[in] config Encoder configuration
+ * @param[in] storage Memory for the encoder, must outlive it
+ * @param[out] ret_encoder Returned encoder handle
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_ERR_NO_MEM out of memory when creating the nested encoders
+ *      - ESP_OK if creating encoder successfully
+ */
+esp_err_t rmt_new_led_strip_encoder_static(const led_strip_encoder_config_t *config, led_strip_encoder_static_t *storage, rmt_encoder_handle_t *ret_encoder);
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+/**
+ * @brief Rebuild the correction table of a LED strip encoder, must not run during a transmission
+ *
+ * @param[in] encoder Encoder created by rmt_new_led_strip_encoder() or rmt_new_led_strip_encoder_static()
+ * @param[in] correction Correction to apply, NULL for none
+ * @return
+ *      - ESP_ERR_INVALID_ARG for any invalid arguments
+ *      - ESP_OK if the correction was applied
+ */
+esp_err_t rmt_led_strip_encoder_set_correction(rmt_encoder_handle_t encoder, const led_strip_rmt_correction_t *correction);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
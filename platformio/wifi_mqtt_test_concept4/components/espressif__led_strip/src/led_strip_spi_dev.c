@@ -8,18 +8,18 @@
 #include <sys/cdefs.h>
 #include "esp_log.h"
 #include "esp_check.h"
+#include "esp_attr.h"
+#include "freertos/FreeRTOS.h"
 #include "esp_rom_gpio.h"
 #include "soc/spi_periph.h"
 #include "led_strip.h"
 #include "led_strip_interface.h"
 #include "hal/spi_hal.h"
+#include "led_strip_spi_lut.h"
 
 #define LED_STRIP_SPI_DEFAULT_RESOLUTION (2.5 * 1000 * 1000) // 2.5MHz resolution
 #define LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE 4
 
-#define SPI_BYTES_PER_COLOR_BYTE 3
-#define SPI_BITS_PER_COLOR_BYTE (SPI_BYTES_PER_COLOR_BYTE * 8)
-
 static const char *TAG = "led_strip_spi";
 
 typedef struct {
@@ -28,24 +28,17 @@ typedef struct {
     spi_device_handle_t spi_device;
     uint32_t strip_len;
     uint8_t bytes_per_pixel;
-    uint8_t pixel_buf[];
+    bool busy;                  // trans is queued and its result not collected yet
+    spi_transaction_t trans;
+    led_strip_done_cb_t done_cb;
+    void *done_ctx;
+    uint8_t *tx_buf;            // snapshot of pixel_buf being transmitted
+    uint8_t pixel_buf[];        // followed by tx_buf, both DMA capable
 } led_strip_spi_obj;
 
-// please make sure to zero-initialize the buf before calling this function
-static void __led_strip_spi_bit(uint8_t data, uint8_t *buf)
-{
-    // Each color of 1 bit is represented by 3 bits of SPI, low_level:100 ,high_level:110
-    // So a color byte occupies 3 bytes of SPI.
-    *(buf + 2) |= data & BIT(0) ? BIT(2) | BIT(1) : BIT(2);
-    *(buf + 2) |= data & BIT(1) ? BIT(5) | BIT(4) : BIT(5);
-    *(buf + 2) |= data & BIT(2) ? BIT(7) : 0x00;
-    *(buf + 1) |= BIT(0);
-    *(buf + 1) |= data & BIT(3) ? BIT(3) | BIT(2) : BIT(3);
-    *(buf + 1) |= data & BIT(4) ? BIT(6) | BIT(5) : BIT(6);
-    *(buf + 0) |= data & BIT(5) ? BIT(1) | BIT(0) : BIT(1);
-    *(buf + 0) |= data & BIT(6) ? BIT(4) | BIT(3) : BIT(4);
-    *(buf + 0) |= data & BIT(7) ? BIT(7) | BIT(6) : BIT(7);
-}
+// DMA wants word aligned buffers, tx_buf starts at this offset from pixel_buf
+#define LED_STRIP_SPI_FRAME_STRIDE(max_leds, bytes_per_pixel) \
+    ((((max_leds) * (bytes_per_pixel) * SPI_BYTES_PER_COLOR_BYTE) + 3) & ~3)
 
 static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue)
 {
@@ -53,16 +46,23 @@ static esp_err_t led_strip_spi_set_pixel(led_strip_t *strip, uint32_t index, uin
     ESP_RETURN_ON_FALSE(index < spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "index out of maximum number of LEDs");
     // LED_PIXEL_FORMAT_GRB takes 72bits(9bytes)
     uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
-    __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
-    __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+    led_strip_spi_encode(green, &spi_strip->pixel_buf[start]);
+    led_strip_spi_encode(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
+    led_strip_spi_encode(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
     if (spi_strip->bytes_per_pixel > 3) {
-        __led_strip_spi_bit(0, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
+        led_strip_spi_encode(0, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
     }
     return ESP_OK;
 }
 
+static esp_err_t led_strip_spi_set_pixels(led_strip_t *strip, const uint8_t *rgb, uint32_t count)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_FALSE(count <= spi_strip->strip_len, ESP_ERR_INVALID_ARG, TAG, "count out of maximum number of LEDs");
+    led_strip_spi_encode_pixels(spi_strip->pixel_buf, rgb, count, spi_strip->bytes_per_pixel);
+    return ESP_OK;
+}
+
 static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
@@ -71,26 +71,68 @@ static esp_err_t led_strip_spi_set_pixel_rgbw(led_strip_t *strip, uint32_t index
     // LED_PIXEL_FORMAT_GRBW takes 96bits(12bytes)
     uint32_t start = index * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
     // SK6812 component order is GRBW
-    memset(spi_strip->pixel_buf + start, 0, spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
-    __led_strip_spi_bit(green, &spi_strip->pixel_buf[start]);
-    __led_strip_spi_bit(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
-    __led_strip_spi_bit(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
-    __led_strip_spi_bit(white, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
+    led_strip_spi_encode(green, &spi_strip->pixel_buf[start]);
+    led_strip_spi_encode(red, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE]);
+    led_strip_spi_encode(blue, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 2]);
+    led_strip_spi_encode(white, &spi_strip->pixel_buf[start + SPI_BYTES_PER_COLOR_BYTE * 3]);
 
     return ESP_OK;
 }
 
-static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
+static void IRAM_ATTR led_strip_spi_trans_done(spi_transaction_t *trans)
+{
+    led_strip_spi_obj *spi_strip = (led_strip_spi_obj *)trans->user;
+    if (spi_strip->done_cb && spi_strip->done_cb(&spi_strip->base, spi_strip->done_ctx)) {
+        portYIELD_FROM_ISR();
+    }
+}
+
+static esp_err_t led_strip_spi_wait_done(led_strip_t *strip, int32_t timeout_ms)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
-    spi_transaction_t tx_conf;
-    memset(&tx_conf, 0, sizeof(tx_conf));
+    if (!spi_strip->busy) {
+        return ESP_OK;
+    }
+    spi_transaction_t *done = NULL;
+    // no log on purpose, a timeout is the expected answer while polling
+    esp_err_t ret = spi_device_get_trans_result(spi_strip->spi_device, &done, timeout_ms < 0 ? portMAX_DELAY : pdMS_TO_TICKS(timeout_ms));
+    if (ret == ESP_OK) {
+        spi_strip->busy = false;
+    }
+    return ret;
+}
+
+static esp_err_t led_strip_spi_refresh_async(led_strip_t *strip)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    size_t len = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE;
+
+    // tx_buf may only change once the previous frame is out, usually long done by now
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_done(strip, -1), TAG, "wait previous frame failed");
+    memcpy(spi_strip->tx_buf, spi_strip->pixel_buf, len);
+    memset(&spi_strip->trans, 0, sizeof(spi_strip->trans));
+    spi_strip->trans.length = len * 8;
+    spi_strip->trans.tx_buffer = spi_strip->tx_buf;
+    spi_strip->trans.rx_buffer = NULL;
+    spi_strip->trans.user = spi_strip;
+    ESP_RETURN_ON_ERROR(spi_device_queue_trans(spi_strip->spi_device, &spi_strip->trans, portMAX_DELAY), TAG, "transmit pixels by SPI failed");
+    spi_strip->busy = true;
+    return ESP_OK;
+}
 
-    tx_conf.length = spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BITS_PER_COLOR_BYTE;
-    tx_conf.tx_buffer = spi_strip->pixel_buf;
-    tx_conf.rx_buffer = NULL;
-    ESP_RETURN_ON_ERROR(spi_device_transmit(spi_strip->spi_device, &tx_conf), TAG, "transmit pixels by SPI failed");
+static esp_err_t led_strip_spi_refresh(led_strip_t *strip)
+{
+    ESP_RETURN_ON_ERROR(led_strip_spi_refresh_async(strip), TAG, "refresh failed");
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_done(strip, -1), TAG, "wait refresh failed");
+    return ESP_OK;
+}
 
+static esp_err_t led_strip_spi_register_done_callback(led_strip_t *strip, led_strip_done_cb_t cb, void *user_ctx)
+{
+    led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_done(strip, -1), TAG, "wait refresh failed");
+    spi_strip->done_cb = cb;
+    spi_strip->done_ctx = user_ctx;
     return ESP_OK;
 }
 
@@ -98,10 +140,9 @@ static esp_err_t led_strip_spi_clear(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
     //Write zero to turn off all leds
-    memset(spi_strip->pixel_buf, 0, spi_strip->strip_len * spi_strip->bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE);
     uint8_t *buf = spi_strip->pixel_buf;
     for (int index = 0; index < spi_strip->strip_len * spi_strip->bytes_per_pixel; index++) {
-        __led_strip_spi_bit(0, buf);
+        led_strip_spi_encode(0, buf);
         buf += SPI_BYTES_PER_COLOR_BYTE;
     }
 
@@ -112,6 +153,7 @@ static esp_err_t led_strip_spi_del(led_strip_t *strip)
 {
     led_strip_spi_obj *spi_strip = __containerof(strip, led_strip_spi_obj, base);
 
+    ESP_RETURN_ON_ERROR(led_strip_spi_wait_done(strip, -1), TAG, "wait refresh failed");
     ESP_RETURN_ON_ERROR(spi_bus_remove_device(spi_strip->spi_device), TAG, "delete spi device failed");
     ESP_RETURN_ON_ERROR(spi_bus_free(spi_strip->spi_host), TAG, "free spi bus failed");
 
@@ -138,9 +180,12 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
         // DMA buffer must be placed in internal SRAM
         mem_caps |= MALLOC_CAP_INTERNAL | MALLOC_CAP_DMA;
     }
-    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + led_config->max_leds * bytes_per_pixel * SPI_BYTES_PER_COLOR_BYTE, mem_caps);
+    // pixel buffer and transmit buffer
+    uint32_t frame_stride = LED_STRIP_SPI_FRAME_STRIDE(led_config->max_leds, bytes_per_pixel);
+    spi_strip = heap_caps_calloc(1, sizeof(led_strip_spi_obj) + 2 * frame_stride, mem_caps);
 
     ESP_GOTO_ON_FALSE(spi_strip, ESP_ERR_NO_MEM, err, TAG, "no mem for spi strip");
+    spi_strip->tx_buf = spi_strip->pixel_buf + frame_stride;
 
     spi_strip->spi_host = spi_config->spi_bus;
     // for backward compatibility, if the user does not set the clk_src, use the default value
@@ -174,6 +219,7 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
         //set -1 when CS is not used
         .spics_io_num = -1,
         .queue_size = LED_STRIP_SPI_DEFAULT_TRANS_QUEUE_SIZE,
+        .post_cb = led_strip_spi_trans_done,
     };
 
     ESP_GOTO_ON_ERROR(spi_bus_add_device(spi_strip->spi_host, &spi_dev_cfg, &spi_strip->spi_device), err, TAG, "Failed to add spi device");
@@ -191,7 +237,11 @@ esp_err_t led_strip_new_spi_device(const led_strip_config_t *led_config, const l
     spi_strip->strip_len = led_config->max_leds;
     spi_strip->base.set_pixel = led_strip_spi_set_pixel;
     spi_strip->base.set_pixel_rgbw = led_strip_spi_set_pixel_rgbw;
+    spi_strip->base.set_pixels = led_strip_spi_set_pixels;
     spi_strip->base.refresh = led_strip_spi_refresh;
+    spi_strip->base.refresh_async = led_strip_spi_refresh_async;
+    spi_strip->base.wait_done = led_strip_spi_wait_done;
+    spi_strip->base.register_done_callback = led_strip_spi_register_done_callback;
     spi_strip->base.clear = led_strip_spi_clear;
     spi_strip->base.del = led_strip_spi_del;
 
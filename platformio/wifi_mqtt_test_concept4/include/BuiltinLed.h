@@ -1,18 +1,17 @@
 #ifndef _BUILTIN_LED_H_
 #define _BUILTIN_LED_H_
 
+#include "sdkconfig.h"
 #include "led_strip.h"
-#include "freertos/semphr.h"
-#include "freertos/task.h"
-#include "freertos/event_groups.h"
+#include "LedEffectEngine.h"
 #include <atomic>
 
-#define BLINK_INFINITE -1
-#define BLINK_TASK_STOPPED_BIT BIT0
-#define BLINK_TASK_RUNNING_BIT BIT1
+#define BLINK_INFINITE LED_EFFECT_FOREVER
 
 #define DEFAULT_BRIGHTNESS 16
 
+// Every call only posts a command to the effect engine and returns, the LED is
+// updated on the next frame of the engine timer.
 class BuiltinLed {
 public:
     static BuiltinLed& GetInstance();
@@ -20,14 +19,22 @@ public:
     void BlinkOnce();
     void Blink(int times, int interval_ms);
     void StartContinuousBlink(int interval_ms);
+    void Pulse(int period_ms);
+    void FadeIn(int duration_ms);
+    void FadeOut(int duration_ms);
+    void TransitionTo(uint8_t r, uint8_t g, uint8_t b, int duration_ms);
     void TurnOn();
     void TurnOff();
     void SetColor(uint8_t r, uint8_t g, uint8_t b);
+    // gamma corrected dimming of whatever color is shown, applied by the LED encoder at no cost per refresh
+    void SetBrightness(uint8_t brightness);
     void SetWhite(uint8_t brightness = DEFAULT_BRIGHTNESS) { SetColor(brightness, brightness, brightness); }
     void SetGrey(uint8_t brightness = DEFAULT_BRIGHTNESS) { SetColor(brightness, brightness, brightness); }
     void SetRed(uint8_t brightness = DEFAULT_BRIGHTNESS) { SetColor(brightness, 0, 0); }
     void SetGreen(uint8_t brightness = DEFAULT_BRIGHTNESS) { SetColor(0, brightness, 0); }
     void SetBlue(uint8_t brightness = DEFAULT_BRIGHTNESS) { SetColor(0, 0, brightness); }
+    // commands rejected because the engine queue was full
+    uint32_t DroppedCommands() const { return engine_.dropped(); }
 
 private:
     BuiltinLed();
@@ -35,18 +42,19 @@ private:
     BuiltinLed(const BuiltinLed&) = delete;
     BuiltinLed& operator=(const BuiltinLed&) = delete;
 
-    SemaphoreHandle_t mutex_;
-    EventGroupHandle_t blink_event_group_;
-    TaskHandle_t blink_task_ = nullptr;
+    LedEffectEngine engine_;
     led_strip_handle_t led_strip_ = nullptr;
-    uint8_t r_ = 0, g_ = 0, b_ = 0;
-    int blink_times_ = 0;
-    int blink_interval_ms_ = 0;
-    std::atomic<bool> should_blink_{false};
+    // 0x00RRGGBB, a single word so SetColor() and the effect calls need no lock
+    std::atomic<uint32_t> color_{0};
+
+#if CONFIG_BUILTIN_LED_STATIC_ALLOC
+    // backing storage for the LED strip object, nothing but the frame timer comes from the heap
+    led_strip_rmt_static_t led_strip_storage_;
+    uint8_t led_strip_pixels_[LED_STRIP_RMT_PIXEL_BUF_SIZE(1)];
+#endif
 
     void Configure();
-    void StartBlinkTask(int times, int interval_ms);
-    void StopBlinkInternal();
+    void Post(LedEffect effect, int32_t times, int period_ms);
 };
 
 #endif // _BUILTIN_LED_H_
@@ -0,0 +1,79 @@
+#ifndef _LED_EFFECT_ENGINE_H_
+#define _LED_EFFECT_ENGINE_H_
+
+#include "sdkconfig.h"
+#include "led_strip.h"
+#include "esp_timer.h"
+#include "LedCommandQueue.h"
+#include <atomic>
+
+#define LED_EFFECT_QUEUE_SIZE 8
+#define LED_EFFECT_FOREVER -1
+#define BUILTIN_LED_GAMMA 2.2f
+
+#ifndef CONFIG_BUILTIN_LED_FRAME_MS
+#define CONFIG_BUILTIN_LED_FRAME_MS 20
+#endif
+
+enum class LedEffect : uint8_t {
+    kSolid,         // show the color
+    kBlink,         // color for period_ms, off for period_ms, times cycles then off
+    kPulse,         // triangle wave from off to the color and back every period_ms
+    kFadeIn,        // off to the color over period_ms, then hold
+    kFadeOut,       // shown color to off over period_ms
+    kTransition,    // shown color to the color over period_ms, then hold
+    kBrightness,    // not an effect, updates the encoder brightness and keeps the effect running
+};
+
+struct LedCommand {
+    LedEffect effect;
+    uint8_t r, g, b;
+    uint8_t brightness;
+    int32_t times;
+    uint32_t period_ms;
+};
+
+// Renders one pixel from a periodic esp_timer. Commands are posted from any task
+// through a lock-free queue and picked up on the next frame, the newest one wins.
+// Everything that touches the strip runs in the esp_timer task, so callers never
+// wait for the RMT channel or for each other.
+class LedEffectEngine {
+public:
+    LedEffectEngine() = default;
+    ~LedEffectEngine();
+    LedEffectEngine(const LedEffectEngine&) = delete;
+    LedEffectEngine& operator=(const LedEffectEngine&) = delete;
+
+    esp_err_t Start(led_strip_handle_t strip, uint32_t frame_ms = CONFIG_BUILTIN_LED_FRAME_MS);
+    void Stop();
+
+    // non-blocking, false when the queue is full because the timer task is starved
+    bool Post(const LedCommand& cmd);
+    uint32_t dropped() const { return dropped_.load(std::memory_order_relaxed); }
+
+private:
+    struct Rgb {
+        uint8_t r, g, b;
+        bool operator!=(const Rgb& o) const { return r != o.r || g != o.g || b != o.b; }
+    };
+
+    static void OnFrame(void* arg);
+    void Tick();
+    void Begin(const LedCommand& cmd, int64_t now_us);
+    Rgb Render(uint32_t t_ms);
+    void ApplyBrightness(uint8_t brightness);
+
+    LedCommandQueue<LedCommand, LED_EFFECT_QUEUE_SIZE> queue_;
+    std::atomic<uint32_t> dropped_{0};
+    esp_timer_handle_t timer_ = nullptr;
+    led_strip_handle_t strip_ = nullptr;
+
+    // owned by the esp_timer task
+    LedCommand current_ = {LedEffect::kSolid, 0, 0, 0, 0, 0, 0};
+    Rgb from_ = {0, 0, 0};
+    Rgb shown_ = {0, 0, 0};
+    int64_t start_us_ = 0;
+    bool dirty_ = true;
+};
+
+#endif // _LED_EFFECT_ENGINE_H_
@@ -38,6 +38,7 @@ extern "C" {
 typedef struct aht20_dev_s{
     i2c_master_dev_handle_t     i2c_dev;
     uint16_t                    i2c_timeout;    /*!< i2c operation timeout */
+    bool                        static_storage; /*!< storage provided to aht20_new_sensor_static() */
 } aht20_dev_t;
 
 /**
@@ -71,6 +72,20 @@ typedef struct {
  */
 esp_err_t aht20_new_sensor(const i2c_master_bus_handle_t bus_handle, const i2c_aht20_config_t *i2c_config, aht20_dev_handle_t *out_handle);
 
+/**
+ * @brief Create new AHT20 device handle in caller provided storage.
+ *
+ * @param[in]  bus_handle I2C master bus handle
+ * @param[in]  i2c_conf Config for I2C used by AHT20
+ * @param[in]  storage Device struct backing the handle, must outlive it
+ * @param[out] handle_out New AHT20 device handle, points to storage
+ * @return
+ *          - ESP_OK                  Device handle creation success.
+ *          - ESP_ERR_INVALID_ARG     Invalid device handle or argument.
+ *
+ */
+esp_err_t aht20_new_sensor_static(const i2c_master_bus_handle_t bus_handle, const i2c_aht20_config_t *i2c_config, aht20_dev_t *storage, aht20_dev_handle_t *out_handle);
+
 /**
  * @brief Delete AHT20 device handle.
  *
@@ -0,0 +1,51 @@
+/*
+ * Heap allocation watch.
+ *
+ * Counts heap allocations per task through the ESP-IDF heap hooks once the
+ * application declares boot finished. Strict sections mark code of one task that
+ * must never allocate; the report shows whether it did.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+/**
+ * @brief Boot is done, count every allocation from now on
+ */
+void heap_watch_arm(void);
+
+/**
+ * @brief Start a section of the calling task that must not allocate. Sections do not nest.
+ */
+void heap_watch_strict_begin(void);
+
+/**
+ * @brief End the section started by heap_watch_strict_begin()
+ */
+void heap_watch_strict_end(void);
+
+/**
+ * @brief Allocations made inside strict sections since heap_watch_arm()
+ */
+uint32_t heap_watch_strict_allocs(void);
+
+/**
+ * @brief Print "#HEAP," lines: per task allocations, strict sections and heap state
+ *
+ * @return
+ *      - ESP_OK: report printed
+ *      - ESP_ERR_INVALID_STATE: heap_watch_arm() was not called yet
+ *      - ESP_ERR_NOT_SUPPORTED: CONFIG_HEAP_WATCH_ENABLE is off
+ */
+esp_err_t heap_watch_report(void);
+
+#ifdef __cplusplus
+}
+#endif
@@ -14,6 +14,10 @@
 #include "led_strip_spi.h"
 #endif
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+#include "led_strip_group.h"
+#endif
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -54,6 +58,23 @@ esp_err_t led_strip_set_pixel(led_strip_handle_t strip, uint32_t index, uint32_t
  */
 esp_err_t led_strip_set_pixel_rgbw(led_strip_handle_t strip, uint32_t index, uint32_t red, uint32_t green, uint32_t blue, uint32_t white);
 
+/**
+ * @brief Set RGB for the first count pixels in one call
+ *
+ * @note Encodes straight into the transmit buffer of the backend, much faster than
+ *       calling `led_strip_set_pixel` per pixel on long strips
+ *
+ * @param strip: LED strip
+ * @param rgb: packed colors, count * 3 bytes in the order red, green, blue
+ * @param count: number of pixels to set, starting at index 0
+ *
+ * @return
+ *      - ESP_OK: Set RGB for the pixels successfully
+ *      - ESP_ERR_INVALID_ARG: Set RGB for the pixels failed because of invalid parameters
+ *      - ESP_FAIL: Set RGB for the pixels failed because other error occurred
+ */
+esp_err_t led_strip_set_pixels(led_strip_handle_t strip, const uint8_t *rgb, uint32_t count);
+
 /**
  * @brief Set HSV for a specific pixel
  *
@@ -84,6 +105,48 @@ esp_err_t led_strip_set_pixel_hsv(led_strip_handle_t strip, uint32_t index, uint
  */
 esp_err_t led_strip_refresh(led_strip_handle_t strip);
 
+/**
+ * @brief Start flushing the memory colors to the LEDs and return right away
+ *
+ * @param strip: LED strip
+ *
+ * @return
+ *      - ESP_OK: Transmission started
+ *      - ESP_FAIL: Refresh failed because some other error occurred
+ *
+ * @note:
+ *      The colors are copied into a second buffer, `led_strip_set_pixel` may be called again immediately.
+ *      Only waits when the previous frame is still being sent. Backends without
+ *      asynchronous support refresh synchronously.
+ */
+esp_err_t led_strip_refresh_async(led_strip_handle_t strip);
+
+/**
+ * @brief Wait until the frame started by `led_strip_refresh_async` has been sent
+ *
+ * @param strip: LED strip
+ * @param timeout_ms: maximum time to wait, -1 for no limit, 0 to poll
+ *
+ * @return
+ *      - ESP_OK: No transmission running
+ *      - ESP_ERR_TIMEOUT: Transmission still running after timeout_ms
+ *      - ESP_FAIL: Wait failed because some other error occurred
+ */
+esp_err_t led_strip_wait_done(led_strip_handle_t strip, int32_t timeout_ms);
+
+/**
+ * @brief Get notified when a frame started by `led_strip_refresh_async` has been sent
+ *
+ * @param strip: LED strip
+ * @param cb: called from ISR context, keep it short (e.g. give a semaphore or notify a task), NULL to remove
+ * @param user_ctx: user data passed to cb
+ *
+ * @return
+ *      - ESP_OK: Callback registered
+ *      - ESP_ERR_NOT_SUPPORTED: The backend has no asynchronous refresh
+ */
+esp_err_t led_strip_register_done_callback(led_strip_handle_t strip, led_strip_done_cb_t cb, void *user_ctx);
+
 /**
  * @brief Clear LED strip (turn off all LEDs)
  *
@@ -6,6 +6,7 @@
 #pragma once
 
 #include <stdint.h>
+#include <stddef.h>
 #include "esp_err.h"
 #include "led_strip_types.h"
 #include "esp_idf_version.h"
@@ -48,6 +49,69 @@ typedef struct {
  */
 esp_err_t led_strip_new_rmt_device(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config, led_strip_handle_t *ret_strip);
 
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+/**
+ * @brief Color correction applied by the RMT encoder while it sends the pixels
+ */
+typedef struct {
+    float gamma;                    /*!< Gamma exponent, 1.0 (or 0) is linear, 2.2 - 2.8 give perceptually even dimming */
+    uint8_t brightness;             /*!< Scale applied after gamma, 255 is full brightness */
+    led_color_order_t color_order;  /*!< Order the LEDs expect the components in */
+} led_strip_rmt_correction_t;
+
+/**
+ * @brief Set gamma, brightness and color order of an RMT LED strip
+ *
+ * @note The correction is a 256 entry table the encoder looks every color byte up in,
+ *       so it costs the same per pixel as no correction and needs no pass over the pixel buffer.
+ *       The colors passed to `led_strip_set_pixel` stay uncorrected. Waits for a running refresh.
+ *
+ * @param strip LED strip created by led_strip_new_rmt_device() or led_strip_new_rmt_device_static()
+ * @param correction Correction to apply, NULL restores linear full brightness in GRB order
+ * @return
+ *      - ESP_OK: correction applied from the next refresh on
+ *      - ESP_ERR_INVALID_ARG: invalid gamma or color order
+ */
+esp_err_t led_strip_rmt_set_correction(led_strip_handle_t strip, const led_strip_rmt_correction_t *correction);
+#endif
+
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 0, 0)
+/**
+ * @brief Memory for a LED strip created by led_strip_new_rmt_device_static(), holds the driver object and its encoder
+ */
+typedef struct {
+    void *reserved[48 + 256 / sizeof(void *)];
+} led_strip_rmt_static_t;
+
+/**
+ * @brief Pixel buffer size needed by led_strip_new_rmt_device_static() for any pixel format,
+ *        room for the pixels being set and the frame being transmitted
+ */
+#define LED_STRIP_RMT_PIXEL_BUF_SIZE(max_leds) ((max_leds) * 4 * 2)
+
+/**
+ * @brief Create LED strip based on RMT TX channel without allocating the strip object, pixel buffer or encoder
+ *
+ * @note The RMT channel and the nested RMT encoders are still allocated by the RMT driver.
+ *
+ * @param led_config LED strip configuration
+ * @param rmt_config RMT specific configuration
+ * @param storage Memory for the driver object, must outlive the strip
+ * @param pixel_buf Pixel buffer, must outlive the strip
+ * @param pixel_buf_size Size of pixel_buf, at least 2 * max_leds * bytes per pixel
+ * @param ret_strip Returned LED strip handle
+ * @return
+ *      - ESP_OK: create LED strip handle successfully
+ *      - ESP_ERR_INVALID_ARG: create LED strip handle failed because of invalid argument
+ *      - ESP_ERR_INVALID_SIZE: pixel_buf is too small
+ *      - ESP_ERR_NO_MEM: the RMT driver is out of memory
+ *      - ESP_FAIL: create LED strip handle failed because some other error
+ */
+esp_err_t led_strip_new_rmt_device_static(const led_strip_config_t *led_config, const led_strip_rmt_config_t *rmt_config,
+                                          led_strip_rmt_static_t *storage, uint8_t *pixel_buf, size_t pixel_buf_size,
+                                          led_strip_handle_t *ret_strip);
+#endif
+
 #ifdef __cplusplus
 }
 #endif
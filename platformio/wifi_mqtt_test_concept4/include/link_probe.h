@@ -0,0 +1,163 @@
+/*
+ * Link quality probe between a node and its gateway.
+ *
+ * The node sends timestamped probes, the gateway sends every datagram on the probe
+ * port back unchanged (tools/link_probe.py reflect). Each answer gives a round trip
+ * time that feeds a log-linear histogram, a smoothed RTT and a jitter estimate, probes
+ * without an answer within the timeout count as lost.
+ *
+ * The core (link_probe_init() .. link_probe_format()) is plain C without FreeRTOS or
+ * lwIP, bench/link_probe_loopback.c runs it on a Linux host. link_probe_start() and
+ * the functions after it run it in a task on the node.
+ *
+ * Probe layout, little endian:
+ *
+ *   u32 magic      LINK_PROBE_MAGIC
+ *   u32 seq        probe number, free running
+ *   u64 sent_us    node clock when the probe was sent
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define LINK_PROBE_MAGIC        0x4252504Cu     /*!< "LPRB" */
+#define LINK_PROBE_SIZE         16              /*!< bytes of a probe */
+#define LINK_PROBE_WINDOW       32              /*!< probes that can be outstanding, power of two */
+#define LINK_PROBE_HIST_BUCKETS 64              /*!< 16 us linear below 64 us, then 4 buckets per octave up to 2 s */
+#define LINK_PROBE_LINE_MAX     160             /*!< longest line of link_probe_format() */
+
+/**
+ * @brief What an incoming datagram turned out to be
+ */
+typedef enum {
+    LINK_PROBE_ANSWER = 0,      /*!< first answer to an outstanding probe within the timeout */
+    LINK_PROBE_LATE,            /*!< answer after the timeout, the probe counts as lost */
+    LINK_PROBE_DUPLICATE,       /*!< second answer, or one to a probe outside the window */
+    LINK_PROBE_INVALID,         /*!< not a probe */
+} link_probe_result_t;
+
+/**
+ * @brief State and statistics of one link, all times in microseconds
+ */
+typedef struct {
+    uint32_t timeout_us;        /*!< answers later than this count as lost */
+    uint32_t next_seq;
+    uint32_t pending;           /*!< bit (seq % LINK_PROBE_WINDOW) set while the probe is outstanding */
+    uint32_t expired;           /*!< same bit set once the probe was counted lost without an answer */
+    uint32_t sent_at[LINK_PROBE_WINDOW];    /*!< low 32 bits of the send time per slot */
+
+    uint32_t sent;
+    uint32_t received;          /*!< answers within the timeout */
+    uint32_t lost;              /*!< expired probes, late answers included */
+    uint32_t late;
+    uint32_t duplicate;
+    uint32_t rtt_min_us;
+    uint32_t rtt_max_us;
+    uint32_t rtt_last_us;
+    uint32_t srtt_us;           /*!< smoothed RTT, RFC 6298 */
+    uint32_t rttvar_us;         /*!< RTT variation, RFC 6298 */
+    uint32_t jitter_x16;        /*!< mean |RTT - previous RTT| times 16, gain 1/16 like RFC 3550 */
+    uint32_t hist[LINK_PROBE_HIST_BUCKETS];
+} link_probe_t;
+
+/**
+ * @brief Reset a link, nothing sent yet
+ *
+ * @param timeout_us: answers later than this count as lost
+ */
+void link_probe_init(link_probe_t *p, uint32_t timeout_us);
+
+/**
+ * @brief Build the next probe and count it as sent
+ *
+ * A probe still outstanding in the slot the new one takes is counted as lost.
+ *
+ * @return bytes written, 0 when size < LINK_PROBE_SIZE
+ */
+size_t link_probe_make(link_probe_t *p, int64_t now_us, uint8_t *buf, size_t size);
+
+/**
+ * @brief Account a datagram that came back from the reflector
+ */
+link_probe_result_t link_probe_reply(link_probe_t *p, const uint8_t *buf, size_t len, int64_t now_us);
+
+/**
+ * @brief Count outstanding probes older than the timeout as lost
+ */
+void link_probe_expire(link_probe_t *p, int64_t now_us);
+
+/**
+ * @brief RTT below which the given share of the answers fall, upper edge of its histogram bucket
+ *
+ * @param permille: 500 for the median, 990 for p99
+ */
+uint32_t link_probe_percentile(const link_probe_t *p, uint32_t permille);
+
+/**
+ * @brief Lost probes per thousand of those that were answered or expired
+ */
+uint32_t link_probe_loss_permille(const link_probe_t *p);
+
+/**
+ * @brief Jitter, mean difference between consecutive RTTs
+ */
+uint32_t link_probe_jitter_us(const link_probe_t *p);
+
+/**
+ * @brief Retransmission timeout SRTT + 4 * RTTVAR (RFC 6298), for retries or batching windows
+ *
+ * @return max_us before the first answer, the timeout clamped to [min_us, max_us] after
+ */
+uint32_t link_probe_rto_us(const link_probe_t *p, uint32_t min_us, uint32_t max_us);
+
+/**
+ * @brief One "#PROBE,..." line, read by tools/link_probe.py
+ *
+ * Fields: sent, received, lost, late, duplicate, loss permille, RTT min, p50, p90,
+ * p99, max, SRTT, jitter, RTO, the times in microseconds.
+ *
+ * @return length like snprintf
+ */
+int link_probe_format(const link_probe_t *p, char *buf, size_t size);
+
+struct sockaddr_in;
+
+/**
+ * @brief Start the probe task, it sends every CONFIG_LINK_PROBE_INTERVAL_MS once a gateway is set
+ *
+ * @return
+ *      - ESP_OK: Task running
+ *      - ESP_ERR_INVALID_STATE: Already started
+ *      - ESP_ERR_NO_MEM: No memory for the task or the lock
+ *      - ESP_FAIL: Socket could not be created
+ */
+esp_err_t link_probe_start(void);
+
+/**
+ * @brief Set or change the reflector the probes go to, a new address starts new statistics
+ */
+void link_probe_set_gateway(const struct sockaddr_in *dest);
+
+/**
+ * @brief Format the statistics of the running probe like link_probe_format()
+ *
+ * @return length like snprintf, 0 before link_probe_start()
+ */
+int link_probe_report(char *buf, size_t size);
+
+/**
+ * @brief Current retransmission timeout in milliseconds, see link_probe_rto_us()
+ */
+uint32_t link_probe_get_rto_ms(void);
+
+#ifdef __cplusplus
+}
+#endif
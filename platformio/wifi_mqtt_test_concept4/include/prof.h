@@ -0,0 +1,118 @@
+/*
+ * Cycle counting micro-profiler.
+ *
+ * A zone is a static table of min/avg/max and a log-linear histogram (p99) of the
+ * CPU cycles spent between entering and leaving a scope. With CONFIG_PROF_ENABLE
+ * off every PROF_x macro expands to nothing (PROF_CALL to the bare expression).
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stddef.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define PROF_HIST_BINS      124     /*!< 4 bins per power of two up to 2^32 cycles, <= 25% bin width */
+#define PROF_LINE_MAX       96      /*!< buffer for one "#PROF," line, longer zone names are truncated */
+
+/**
+ * @brief Statistics of one profiling zone. Declare through PROF_SCOPE / PROF_ZONE_DEFINE only.
+ */
+typedef struct prof_zone {
+    const char *name;           /*!< zone name, also the key in the host report */
+    uint32_t count;             /*!< samples since the last reset */
+    uint32_t min;               /*!< fastest sample, cycles */
+    uint32_t max;               /*!< slowest sample, cycles */
+    uint64_t total;             /*!< sum of all samples, cycles */
+    uint32_t hist[PROF_HIST_BINS];
+    struct prof_zone *next;     /*!< registration list, set on the first sample */
+    uint8_t registered;
+} prof_zone_t;
+
+/**
+ * @brief Snapshot of a zone as reported by prof_export()
+ */
+typedef struct {
+    uint32_t count;
+    uint32_t min;
+    uint32_t avg;
+    uint32_t max;
+    uint32_t p99;
+} prof_stats_t;
+
+/**
+ * @brief Add one sample to a zone. Safe from any task.
+ */
+void prof_record(prof_zone_t *zone, uint32_t cycles);
+
+/**
+ * @brief Compute the current statistics of a zone
+ */
+void prof_get_stats(const prof_zone_t *zone, prof_stats_t *stats);
+
+/**
+ * @brief Write one "#PROF,name,count,min,avg,max,p99" line (cycles) per zone
+ *
+ * @param buf destination buffer
+ * @param size size of the destination buffer
+ * @return number of bytes written, zones that do not fit are left out
+ */
+size_t prof_export(char *buf, size_t size);
+
+/**
+ * @brief Print prof_export() output to the console, parsed by tools/prof_report.py
+ */
+esp_err_t prof_dump(void);
+
+/**
+ * @brief Clear the statistics of every registered zone
+ */
+void prof_reset(void);
+
+typedef struct {
+    prof_zone_t *zone;
+    uint32_t start;
+} prof_scope_t;
+
+prof_scope_t prof_scope_begin(prof_zone_t *zone);
+void prof_scope_end(prof_scope_t *scope);
+
+#define PROF_ZONE_INIT(name_) { .name = name_, .min = UINT32_MAX }
+
+#if CONFIG_PROF_ENABLE
+/**
+ * @brief Define a zone shared by several scopes, e.g. in one translation unit
+ */
+#define PROF_ZONE_DEFINE(zone) static prof_zone_t prof_zone_##zone = PROF_ZONE_INIT(#zone)
+
+/**
+ * @brief Measure from here to the end of the enclosing block into a zone defined with PROF_ZONE_DEFINE
+ */
+#define PROF_SCOPE_IN(zone) \
+    prof_scope_t prof_scope_##zone __attribute__((cleanup(prof_scope_end))) = prof_scope_begin(&prof_zone_##zone)
+
+/**
+ * @brief Measure from here to the end of the enclosing block into a zone private to this scope
+ */
+#define PROF_SCOPE(zone) PROF_ZONE_DEFINE(zone); PROF_SCOPE_IN(zone)
+
+/**
+ * @brief Measure one expression, evaluates to the value of the expression
+ */
+#define PROF_CALL(zone, expr) ({ PROF_SCOPE(zone); expr; })
+#else
+#define PROF_ZONE_DEFINE(zone)
+#define PROF_SCOPE_IN(zone) do { } while (0)
+#define PROF_SCOPE(zone) do { } while (0)
+#define PROF_CALL(zone, expr) (expr)
+#endif
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,117 @@
+/*
+ * FreeRTOS scheduling trace.
+ *
+ * Kernel trace hooks (rtos_trace_hooks.h) record context switches, task
+ * notifications, queue operations and ISR markers into a fixed RAM ring that
+ * keeps the most recent CONFIG_RTOS_TRACE_EVENTS events. Recording is switched
+ * on and off at runtime; a small UDP server streams the ring to
+ * tools/rtos_trace.py on request.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <stdint.h>
+#include <stdbool.h>
+#include "esp_err.h"
+#include "sdkconfig.h"
+
+#ifdef __cplusplus
+extern "C" {
+#endif
+
+#define RTOS_TRACE_MAGIC        "RTR1"  /*!< Prefix of every datagram sent by the trace server */
+#define RTOS_TRACE_FROM_ISR     0x80    /*!< Flag or'ed into the event type when recorded from an ISR */
+
+/**
+ * @brief Event types, stored in the top byte of the event word
+ */
+typedef enum {
+    RTOS_TRACE_SWITCH_IN = 1,   /*!< obj = task now running */
+    RTOS_TRACE_TASK_CREATE,     /*!< obj = new task */
+    RTOS_TRACE_TASK_DELETE,     /*!< obj = deleted task */
+    RTOS_TRACE_NOTIFY,          /*!< obj = notified task */
+    RTOS_TRACE_NOTIFY_WAIT,     /*!< obj = waiting task, about to block */
+    RTOS_TRACE_QUEUE_SEND,      /*!< obj = queue, semaphore or mutex */
+    RTOS_TRACE_QUEUE_RECV,
+    RTOS_TRACE_QUEUE_BLOCK_SEND,/*!< queue full, the sender blocks */
+    RTOS_TRACE_QUEUE_BLOCK_RECV,/*!< queue empty, the receiver blocks */
+    RTOS_TRACE_TICK,            /*!< tick interrupt, only with CONFIG_RTOS_TRACE_TICK */
+    RTOS_TRACE_ISR_ENTER,       /*!< obj = ISR id passed to RTOS_TRACE_ISR_ENTER() */
+    RTOS_TRACE_ISR_EXIT,
+} rtos_trace_event_type_t;
+
+/**
+ * @brief One ring entry: cycle counter and type << 24 | low 24 bits of the object address
+ *
+ * Tasks and queues live in internal DRAM, which shares the top address byte,
+ * so the low 24 bits identify an object.
+ */
+typedef struct {
+    uint32_t timestamp;
+    uint32_t word;
+} rtos_trace_event_t;
+
+/**
+ * @brief True while events are recorded. Checked inline by every hook.
+ */
+extern volatile bool rtos_trace_active;
+
+/**
+ * @brief Start recording, the ring keeps what it already holds
+ */
+void rtos_trace_start(void);
+
+/**
+ * @brief Stop recording
+ */
+void rtos_trace_stop(void);
+
+/**
+ * @brief Drop all recorded events
+ */
+void rtos_trace_clear(void);
+
+/**
+ * @brief Start the UDP server that answers the commands of tools/rtos_trace.py
+ *
+ * Commands are plain text datagrams: "start", "stop", "clear" and "dump".
+ * "dump" pauses recording, streams the task table and the ring to the sender and resumes.
+ *
+ * @param port UDP port to listen on
+ * @return
+ *      - ESP_OK: server task created
+ *      - ESP_ERR_NO_MEM: task could not be created
+ */
+esp_err_t rtos_trace_server_start(uint16_t port);
+
+/**
+ * @brief Record an event. Called by the hooks, only when rtos_trace_active is set.
+ */
+void rtos_trace_record(uint32_t type, const void *obj);
+
+/**
+ * @brief Remember a task name for the dump. Called by the task create hook, also while stopped.
+ */
+void rtos_trace_task_created(const void *task, const char *name);
+
+/**
+ * @brief Mark a task slot reusable. Called by the task delete hook, also while stopped.
+ */
+void rtos_trace_task_deleted(const void *task);
+
+#if CONFIG_RTOS_TRACE_ENABLE
+#define RTOS_TRACE_EVENT(type, obj) do { if (rtos_trace_active) { rtos_trace_record((type), (obj)); } } while (0)
+#else
+#define RTOS_TRACE_EVENT(type, obj) do { } while (0)
+#endif
+
+/**
+ * @brief Mark entry and exit of an application ISR, id is any small number chosen by the caller
+ */
+#define RTOS_TRACE_ISR_ENTER(id) RTOS_TRACE_EVENT(RTOS_TRACE_ISR_ENTER | RTOS_TRACE_FROM_ISR, (const void *)(uintptr_t)(id))
+#define RTOS_TRACE_ISR_EXIT(id) RTOS_TRACE_EVENT(RTOS_TRACE_ISR_EXIT | RTOS_TRACE_FROM_ISR, (const void *)(uintptr_t)(id))
+
+#ifdef __cplusplus
+}
+#endif
@@ -0,0 +1,48 @@
+/*
+ * FreeRTOS trace macro definitions for the scheduling trace.
+ *
+ * Force included into every C file by the project CMakeLists.txt so that the
+ * kernel sources see these definitions before FreeRTOS.h supplies its empty
+ * defaults. The macros only expand inside tasks.c and queue.c, which is why they
+ * may refer to kernel locals such as pxNewTCB or xTaskToNotify.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#ifndef __ASSEMBLER__
+#include "sdkconfig.h"
+
+#if CONFIG_RTOS_TRACE_ENABLE
+#include "rtos_trace.h"
+
+#define traceTASK_SWITCHED_IN() RTOS_TRACE_EVENT(RTOS_TRACE_SWITCH_IN, xTaskGetCurrentTaskHandle())
+
+#define traceTASK_CREATE(pxNewTCB) do {                                     \
+        rtos_trace_task_created((pxNewTCB), (pxNewTCB)->pcTaskName);        \
+        RTOS_TRACE_EVENT(RTOS_TRACE_TASK_CREATE, (pxNewTCB));               \
+    } while (0)
+#define traceTASK_DELETE(pxTaskToDelete) do {                               \
+        RTOS_TRACE_EVENT(RTOS_TRACE_TASK_DELETE, (pxTaskToDelete));         \
+        rtos_trace_task_deleted(pxTaskToDelete);                            \
+    } while (0)
+
+#define traceTASK_NOTIFY(...) RTOS_TRACE_EVENT(RTOS_TRACE_NOTIFY, xTaskToNotify)
+#define traceTASK_NOTIFY_FROM_ISR(...) RTOS_TRACE_EVENT(RTOS_TRACE_NOTIFY | RTOS_TRACE_FROM_ISR, xTaskToNotify)
+#define traceTASK_NOTIFY_GIVE_FROM_ISR(...) RTOS_TRACE_EVENT(RTOS_TRACE_NOTIFY | RTOS_TRACE_FROM_ISR, xTaskToNotify)
+#define traceTASK_NOTIFY_TAKE_BLOCK(...) RTOS_TRACE_EVENT(RTOS_TRACE_NOTIFY_WAIT, xTaskGetCurrentTaskHandle())
+#define traceTASK_NOTIFY_WAIT_BLOCK(...) RTOS_TRACE_EVENT(RTOS_TRACE_NOTIFY_WAIT, xTaskGetCurrentTaskHandle())
+
+#define traceQUEUE_SEND(pxQueue) RTOS_TRACE_EVENT(RTOS_TRACE_QUEUE_SEND, (pxQueue))
+#define traceQUEUE_SEND_FROM_ISR(pxQueue) RTOS_TRACE_EVENT(RTOS_TRACE_QUEUE_SEND | RTOS_TRACE_FROM_ISR, (pxQueue))
+#define traceQUEUE_RECEIVE(pxQueue) RTOS_TRACE_EVENT(RTOS_TRACE_QUEUE_RECV, (pxQueue))
+#define traceQUEUE_RECEIVE_FROM_ISR(pxQueue) RTOS_TRACE_EVENT(RTOS_TRACE_QUEUE_RECV | RTOS_TRACE_FROM_ISR, (pxQueue))
+#define traceBLOCKING_ON_QUEUE_SEND(pxQueue) RTOS_TRACE_EVENT(RTOS_TRACE_QUEUE_BLOCK_SEND, (pxQueue))
+#define traceBLOCKING_ON_QUEUE_RECEIVE(pxQueue) RTOS_TRACE_EVENT(RTOS_TRACE_QUEUE_BLOCK_RECV, (pxQueue))
+
+#if CONFIG_RTOS_TRACE_TICK
+#define traceTASK_INCREMENT_TICK(xTickCount) RTOS_TRACE_EVENT(RTOS_TRACE_TICK | RTOS_TRACE_FROM_ISR, NULL)
+#endif
+
+#endif // CONFIG_RTOS_TRACE_ENABLE
+#endif // __ASSEMBLER__
@@ -3,6 +3,7 @@
 #include <stdlib.h>
 #include <time.h>
 #include <sys/param.h>
+#include <math.h>
 #include "freertos/FreeRTOS.h"
 #include "freertos/task.h"
 #include "freertos/event_groups.h"
@@ -21,7 +22,14 @@
 #include "driver/gpio.h"
 #include "lwip/sockets.h"
 #include "esp_netif.h"
-#include <netdb.h> // For gethostbyname
+#include "tlog.h"
+#include "prof.h"
+#include "rtos_trace.h"
+#include "heap_watch.h"
+#include "forecast.h"
+#include "led_color.h"
+#include "gw_discovery.h"
+#include "link_probe.h"
 
 // WiFi configuration
 #define WIFI_SSID "1"
@@ -38,8 +46,21 @@
 #define NUM_PIXELS    1
 
 // UDP configuration
-#define UDP_TARGET_HOST   "team19pi.ddns.net" // Changed from IP to hostname
+#define UDP_TARGET_HOST   "team19pi.ddns.net" // fallback when no gateway answers on the LAN
 #define UDP_TARGET_PORT   8080 // Changed port to 8080
+#define TLOG_UDP_FRAME_SIZE (TLOG_DRAIN_MIN_SIZE > 512 ? TLOG_DRAIN_MIN_SIZE : 512) // one datagram of tokenized log records
+#define PROF_UDP_REPORT_SIZE 512 // one datagram of #PROF lines
+#define SENSOR_TASK_STACK_SIZE 4096
+
+#if CONFIG_NODE_STATIC_ALLOC
+// Driver objects and the sensor task live in .bss, nothing is taken from the heap for them
+static ens160_context_t s_ens160_storage;
+static aht20_dev_t s_aht20_storage;
+static led_strip_rmt_static_t s_strip_storage;
+static uint8_t s_strip_pixels[LED_STRIP_RMT_PIXEL_BUF_SIZE(NUM_PIXELS)];
+static StaticTask_t s_sensor_task_buffer;
+static StackType_t s_sensor_task_stack[SENSOR_TASK_STACK_SIZE];
+#endif
 
 // Event group for WiFi connection
 static EventGroupHandle_t s_wifi_event_group;
@@ -48,6 +69,24 @@ static EventGroupHandle_t s_wifi_event_group;
 
 static const char *TAG = "UDP_SENSOR";
 
+// CAQI 1 (very low) to 5 (very high) sit 64 apart on a gradient that is computed once
+static const led_color_stop_t s_caqi_stops[] = {
+    {   0, {   0, 255,   0 } },
+    {  64, { 255, 255,   0 } },
+    { 128, { 255, 165,   0 } },
+    { 192, { 128,   0, 128 } },
+    { 255, { 255,   0,   0 } },
+};
+static led_color_palette_t s_caqi_palette;
+
+static led_rgb_t caqi_color(uint8_t caqi) {
+    if (caqi < 1 || caqi > 5) {
+        return led_color_rgb(0, 0, 255); // no reading
+    }
+    uint32_t index = (caqi - 1) * 64;
+    return led_color_palette_at(&s_caqi_palette, index > 255 ? 255 : index);
+}
+
 // WiFi event handler
 static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t event_id, void *event_data) {
     if (event_base == WIFI_EVENT && event_id == WIFI_EVENT_STA_START) {
@@ -60,24 +99,149 @@ static void wifi_event_handler(void *arg, esp_event_base_t event_base, int32_t e
     }
 }
 
-// UDP send function
+// UDP send function, one socket for the whole run, the gateway address comes from the discovery cache
+static void udp_send(uint16_t port, const void *payload, size_t len) {
+    static int sock = -1;
+    if (sock < 0) {
+        sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
+        if (sock < 0) {
+            ESP_LOGE(TAG, "Unable to create UDP socket");
+            return;
+        }
+    }
+    struct sockaddr_in dest_addr;
+    if (gw_discovery_get(port, &dest_addr) == GW_PATH_NONE) {
+        ESP_LOGE(TAG, "No gateway on the LAN and DNS lookup failed for %s", UDP_TARGET_HOST);
+        return;
+    }
+    if (PROF_CALL(sendto, sendto(sock, payload, len, 0, (struct sockaddr *)&dest_addr, sizeof(dest_addr))) < 0) {
+        gw_discovery_report_failure();
+    } else {
+        gw_discovery_report_success();
+    }
+}
+
 static void udp_send_sensor_data(const char *payload) {
-    struct sockaddr_in dest_addr = {0};
-    struct hostent *he = gethostbyname(UDP_TARGET_HOST);
-    if (!he || he->h_addr_list == NULL || he->h_addr_list[0] == NULL) {
-        ESP_LOGE(TAG, "DNS lookup failed for %s", UDP_TARGET_HOST);
+    udp_send(UDP_TARGET_PORT, payload, strlen(payload));
+}
+
+// Ship the tokenized log ring, decoded on the host by tools/tlog_decode.py
+static void tlog_ship(void) {
+#if CONFIG_TLOG_DRAIN_UDP
+    static uint8_t frame[TLOG_UDP_FRAME_SIZE];
+    size_t len;
+    while ((len = tlog_drain(frame, sizeof(frame))) > 0) {
+        udp_send(CONFIG_TLOG_UDP_PORT, frame, len);
+    }
+#elif CONFIG_TLOG_DRAIN_UART
+    tlog_flush_console();
+#endif
+}
+
+// Report the profiling zones every CONFIG_PROF_REPORT_INTERVAL loops, read by tools/prof_report.py
+static void prof_ship(void) {
+#if CONFIG_PROF_ENABLE
+    static uint32_t loops;
+    if (++loops < CONFIG_PROF_REPORT_INTERVAL) {
         return;
     }
-    int sock = socket(AF_INET, SOCK_DGRAM, IPPROTO_IP);
-    if (sock < 0) {
-        ESP_LOGE(TAG, "Unable to create UDP socket");
+    loops = 0;
+#if CONFIG_PROF_EXPORT_UDP
+    static char report[PROF_UDP_REPORT_SIZE];
+    size_t len = prof_export(report, sizeof(report));
+    if (len > 0) {
+        udp_send(CONFIG_PROF_UDP_PORT, report, len);
+    }
+#else
+    prof_dump();
+#endif
+#endif
+}
+
+// Report allocations since boot every CONFIG_HEAP_WATCH_REPORT_INTERVAL loops
+static void heap_ship(void) {
+#if CONFIG_HEAP_WATCH_ENABLE
+    static uint32_t loops;
+    if (++loops < CONFIG_HEAP_WATCH_REPORT_INTERVAL) {
         return;
     }
-    dest_addr.sin_addr.s_addr = ((struct in_addr *)he->h_addr_list[0])->s_addr;
-    dest_addr.sin_family = AF_INET;
-    dest_addr.sin_port = htons(UDP_TARGET_PORT);
-    sendto(sock, payload, strlen(payload), 0, (struct sockaddr *)&dest_addr, sizeof(dest_addr));
-    close(sock);
+    loops = 0;
+    heap_watch_report();
+#endif
+}
+
+// Point the link probe at the current gateway and send its #PROBE line every CONFIG_LINK_PROBE_REPORT_INTERVAL loops
+static void probe_ship(void) {
+#if CONFIG_LINK_PROBE_ENABLE
+    struct sockaddr_in dest;
+    if (gw_discovery_get(CONFIG_LINK_PROBE_PORT, &dest) != GW_PATH_NONE) {
+        link_probe_set_gateway(&dest);
+    }
+    static uint32_t loops;
+    if (++loops < CONFIG_LINK_PROBE_REPORT_INTERVAL) {
+        return;
+    }
+    loops = 0;
+    char line[LINK_PROBE_LINE_MAX];
+    int len = link_probe_report(line, sizeof(line));
+    if (len > 0 && len < (int)sizeof(line)) {
+        fputs(line, stdout);
+        udp_send(UDP_TARGET_PORT, line, len);
+    }
+#endif
+}
+
+#if CONFIG_FORECAST_ENABLE
+/*
+ * Quantize the sample to the transmitted 0.01 resolution and decide whether the
+ * gateway can predict it. The gateway runs the same models (tools/forecast.py) on
+ * what it receives, so the models here only see what was sent or predicted.
+ */
+static bool forecast_needs_send(float *temperature, float *humidity, uint32_t *seq_out) {
+    static forecast_t temp_model, hum_model;
+    static uint32_t seq;
+    int32_t temp = lroundf(*temperature * 100.0f);
+    int32_t hum = lroundf(*humidity * 100.0f);
+    *temperature = temp / 100.0f;
+    *humidity = hum / 100.0f;
+
+    bool keyframe = seq % CONFIG_FORECAST_KEYFRAME_INTERVAL == 0;
+    if (seq == 0) {
+        forecast_init(&temp_model, CONFIG_FORECAST_TOL_TEMP);
+        forecast_init(&hum_model, CONFIG_FORECAST_TOL_HUM);
+    }
+    bool send = keyframe || forecast_exceeds(&temp_model, temp) || forecast_exceeds(&hum_model, hum);
+    if (keyframe) {
+        forecast_reset(&temp_model, temp);
+        forecast_reset(&hum_model, hum);
+    } else if (send) {
+        forecast_observe(&temp_model, temp);
+        forecast_observe(&hum_model, hum);
+    } else {
+        forecast_skip(&temp_model);
+        forecast_skip(&hum_model);
+    }
+    *seq_out = seq++;
+    return send;
+}
+#endif
+
+// Log RTT and loss of the LAN path against the DDNS path once at boot, a diagnostic off by default
+static void gateway_compare_paths(void) {
+#if CONFIG_GW_DISCOVERY_COMPARE_PROBES > 0
+    gw_path_stats_t paths[2];
+    ESP_ERROR_CHECK(gw_discovery_compare(CONFIG_GW_DISCOVERY_COMPARE_PROBES, &paths[0], &paths[1]));
+    for (int i = 0; i < 2; i++) {
+        const gw_path_stats_t *p = &paths[i];
+        if (p->sent == 0) {
+            ESP_LOGW(TAG, "Gateway path %s: not found", gw_discovery_path_name(GW_PATH_LAN + i));
+            continue;
+        }
+        ESP_LOGI(TAG, "Gateway path %s: %lu/%lu answered, rtt min %lu avg %lu max %lu us",
+                 gw_discovery_path_name(GW_PATH_LAN + i), (unsigned long)p->received, (unsigned long)p->sent,
+                 (unsigned long)p->rtt_min_us, (unsigned long)p->rtt_avg_us, (unsigned long)p->rtt_max_us);
+    }
+#endif
 }
 
 static void wifi_init_sta(void) {
@@ -145,7 +309,12 @@ static void sensor_udp_task(void *pvParameters) {
         .irq_pin_polarity = ENS160_INT_PIN_POLARITY_ACTIVE_LO
     };
     ens160_handle_t ens160_handle = NULL;
-    if (ens160_init(i2c_bus_handle, &ens160_config, &ens160_handle) != ESP_OK) {
+#if CONFIG_NODE_STATIC_ALLOC
+    esp_err_t ens160_ret = ens160_init_static(i2c_bus_handle, &ens160_config, &s_ens160_storage, &ens160_handle);
+#else
+    esp_err_t ens160_ret = ens160_init(i2c_bus_handle, &ens160_config, &ens160_handle);
+#endif
+    if (ens160_ret != ESP_OK) {
         ESP_LOGE(TAG, "ENS160: Initialization failed");
         vTaskDelete(NULL);
     }
@@ -157,7 +326,12 @@ static void sensor_udp_task(void *pvParameters) {
         },
         .i2c_timeout = 1000,
     };
-    if (aht20_new_sensor(i2c_bus_handle, &aht20_config, &aht20_handle) != ESP_OK) {
+#if CONFIG_NODE_STATIC_ALLOC
+    esp_err_t aht20_ret = aht20_new_sensor_static(i2c_bus_handle, &aht20_config, &s_aht20_storage, &aht20_handle);
+#else
+    esp_err_t aht20_ret = aht20_new_sensor(i2c_bus_handle, &aht20_config, &aht20_handle);
+#endif
+    if (aht20_ret != ESP_OK) {
         ESP_LOGE(TAG, "AHT20: Initialization failed");
         vTaskDelete(NULL);
     }
@@ -166,49 +340,66 @@ static void sensor_udp_task(void *pvParameters) {
     esp_read_mac(mac, ESP_MAC_WIFI_STA);
     char mac_id[3];
     snprintf(mac_id, sizeof(mac_id), "%02X", mac[5]);
+    ESP_ERROR_CHECK(led_color_palette_init(&s_caqi_palette, s_caqi_stops,
+                                           sizeof(s_caqi_stops) / sizeof(s_caqi_stops[0])));
+    // boot is done, from here on the sensor and LED path must not allocate
+    heap_watch_arm();
     for (;;) {
+        heap_watch_strict_begin();
         ens160_air_quality_data_t air_data;
         uint8_t caqi = 0;
-        if (ens160_get_measurement(ens160_handle, &air_data) == ESP_OK) {
+        if (PROF_CALL(ens160_get_measurement, ens160_get_measurement(ens160_handle, &air_data)) == ESP_OK) {
             ens160_aqi_uba_row_t aqi_def = ens160_aqi_index_to_definition(air_data.uba_aqi);
-            ESP_LOGI(TAG, "ENS160: CAQI: %d (%s), TVOC: %u ppb, eCO2: %u ppm", air_data.uba_aqi, aqi_def.rating, air_data.tvoc, air_data.eco2);
+            TLOGI(TAG, "ENS160: CAQI: %d (%s), TVOC: %u ppb, eCO2: %u ppm", air_data.uba_aqi, aqi_def.rating, air_data.tvoc, air_data.eco2);
             caqi = air_data.uba_aqi;
         } else {
-            ESP_LOGI(TAG, "ENS160: Read error");
+            TLOGI(TAG, "ENS160: Read error");
             caqi = 0;
         }
-        uint8_t r = 0, g = 0, b = 0;
-        switch (caqi) {
-            case 1: r = 0; g = 255; b = 0; break;
-            case 2: r = 255; g = 255; b = 0; break;
-            case 3: r = 255; g = 165; b = 0; break;
-            case 4: r = 128; g = 0; b = 128; break;
-            case 5: r = 255; g = 0; b = 0; break;
-            default: r = 0; g = 0; b = 255; break;
-        }
-        led_strip_clear(strip);
-        led_strip_set_pixel(strip, 0, r, g, b);
-        led_strip_refresh(strip);
+        led_rgb_t color = caqi_color(caqi);
+        // the only pixel is overwritten, no clear needed; the refresh returns while the frame is sent
+        led_strip_set_pixel(strip, 0, color.r, color.g, color.b);
+        PROF_CALL(led_strip_refresh_async, led_strip_refresh_async(strip));
         float temperature = 0.0f, humidity = 0.0f;
-        if (aht20_read_float(aht20_handle, &temperature, &humidity) == ESP_OK) {
-            ESP_LOGI(TAG, "AHT20: Temperature: %.2f C, Humidity: %.2f %%", temperature, humidity);
+        if (PROF_CALL(aht20_read_float, aht20_read_float(aht20_handle, &temperature, &humidity)) == ESP_OK) {
+            TLOGI(TAG, "AHT20: Temperature: %.2f C, Humidity: %.2f %%", temperature, humidity);
             if (ens160_set_compensation_factors(ens160_handle, temperature, humidity) != ESP_OK) {
-                ESP_LOGI(TAG, "ENS160: Failed to set compensation factors");
+                TLOGI(TAG, "ENS160: Failed to set compensation factors");
             }
         } else {
-            ESP_LOGI(TAG, "AHT20: Read error");
+            TLOGI(TAG, "AHT20: Read error");
         }
         /*
         UDP packet format before sending:
         temp=<temperature>,hum=<humidity>,id=<last_mac_byte>
         Example: temp=23.45,hum=56.78,id=AB
+        With CONFIG_FORECAST_ENABLE ",seq=<sample number>" is appended and
+        samples the gateway can predict are not sent at all.
         */
         char udp_payload[64];
-        snprintf(udp_payload, sizeof(udp_payload),
+#if CONFIG_FORECAST_ENABLE
+        uint32_t seq;
+        bool send = forecast_needs_send(&temperature, &humidity, &seq);
+        PROF_CALL(snprintf, snprintf(udp_payload, sizeof(udp_payload),
+            "temp=%.2f,hum=%.2f,id=%s,seq=%lu",
+            temperature, humidity, mac_id, (unsigned long)seq));
+#else
+        bool send = true;
+        PROF_CALL(snprintf, snprintf(udp_payload, sizeof(udp_payload),
             "temp=%.2f,hum=%.2f,id=%s",
-            temperature, humidity, mac_id);
-        udp_send_sensor_data(udp_payload);
-        ESP_LOGI(TAG, "UDP sent: %s", udp_payload);
+            temperature, humidity, mac_id));
+#endif
+        heap_watch_strict_end();
+        if (send) {
+            udp_send_sensor_data(udp_payload);
+            TLOGI(TAG, "UDP sent: %s", udp_payload);
+        } else {
+            TLOGI(TAG, "Predicted by gateway: %s", udp_payload);
+        }
+        tlog_ship();
+        prof_ship();
+        heap_ship();
+        probe_ship();
         vTaskDelay(pdMS_TO_TICKS(2000));
     }
 }
@@ -220,6 +411,14 @@ void app_main() {
     srand((unsigned)time(NULL));
     wifi_init_sta();
     ESP_LOGI(TAG, "WiFi initialized");
+    ESP_ERROR_CHECK(gw_discovery_init(UDP_TARGET_HOST));
+    gateway_compare_paths();
+#if CONFIG_LINK_PROBE_ENABLE
+    ESP_ERROR_CHECK(link_probe_start());
+#endif
+#if CONFIG_RTOS_TRACE_ENABLE
+    ESP_ERROR_CHECK(rtos_trace_server_start(CONFIG_RTOS_TRACE_UDP_PORT));
+#endif
     led_strip_handle_t strip;
     led_strip_config_t strip_config = {
         .strip_gpio_num = NEOPIXEL_GPIO,
@@ -234,8 +433,26 @@ void app_main() {
         .mem_block_symbols = 0,
         .flags.with_dma = false,
     };
+#if CONFIG_NODE_STATIC_ALLOC
+    ESP_ERROR_CHECK(led_strip_new_rmt_device_static(&strip_config, &rmt_config, &s_strip_storage,
+                                                    s_strip_pixels, sizeof(s_strip_pixels), &strip));
+#else
     led_strip_new_rmt_device(&strip_config, &rmt_config, &strip);
+#endif
+#if ESP_IDF_VERSION >= ESP_IDF_VERSION_VAL(5, 3, 0)
+    led_strip_rmt_correction_t correction = {
+        .gamma = CONFIG_NODE_LED_GAMMA_X10 / 10.0f,
+        .brightness = CONFIG_NODE_LED_BRIGHTNESS,
+        .color_order = LED_COLOR_ORDER_GRB,
+    };
+    ESP_ERROR_CHECK(led_strip_rmt_set_correction(strip, &correction));
+#endif
     led_strip_clear(strip);
     led_strip_refresh(strip);
-    xTaskCreate(sensor_udp_task, "sensor_udp_task", 4096, (void*)strip, 5, NULL);
+#if CONFIG_NODE_STATIC_ALLOC
+    xTaskCreateStatic(sensor_udp_task, "sensor_udp_task", SENSOR_TASK_STACK_SIZE, (void*)strip, 5,
+                      s_sensor_task_stack, &s_sensor_task_buffer);
+#else
+    xTaskCreate(sensor_udp_task, "sensor_udp_task", SENSOR_TASK_STACK_SIZE, (void*)strip, 5, NULL);
+#endif
 }
\ No newline at end of file
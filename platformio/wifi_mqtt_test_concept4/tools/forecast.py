@@ -0,0 +1,250 @@
+#!/usr/bin/env python3
+"""
+Gateway side forecaster and trace evaluation (components/esp_forecast)
+
+Bit exact port of forecast.c plus the node's send decision, so the gateway can fill
+in the samples a node did not send. The evaluate command replays a recorded trace
+through node and gateway and reports datagrams and bytes saved against the
+reconstruction error, for a range of tolerances.
+
+Record a trace with CONFIG_FORECAST_ENABLE off (every sample sent):
+    python3 udp_server_raspi_example.py | tee trace.log
+
+Usage:
+    python3 tools/forecast.py evaluate trace.log
+    python3 tools/forecast.py evaluate trace.csv --node AB --temp-tol 5,10,15,25 --hum-tol 50
+"""
+import argparse
+import math
+import re
+import sys
+
+ORDER = 2
+Q = 14
+MU_SHIFT = 2
+COEF_MAX = 2 << Q
+COEF_INIT = 1 << (Q - 1)
+INT32_MAX = 2**31 - 1
+
+CHANNELS = ("temp", "hum")
+DEFAULT_TOL = {"temp": 15, "hum": 50}   # CONFIG_FORECAST_TOL_TEMP / _HUM, 0.01 units
+DEFAULT_KEYFRAME = 30                   # CONFIG_FORECAST_KEYFRAME_INTERVAL
+
+
+def _div(num, den):
+    """C division, truncates toward zero."""
+    q = abs(num) // abs(den)
+    return q if (num >= 0) == (den > 0) else -q
+
+
+def _div_round(num, den):
+    return _div(num + den // 2 if num >= 0 else num - den // 2, den)
+
+
+def _clamp(v, limit):
+    return max(-limit, min(limit, v))
+
+
+class Forecast:
+    """One channel, see forecast.h."""
+
+    def __init__(self, tolerance):
+        self.tolerance = tolerance
+        self.reset(0)
+
+    def reset(self, value):
+        self.last = value
+        self.diff = [0] * ORDER
+        self.coef = [COEF_INIT] + [0] * (ORDER - 1)
+
+    def predict(self):
+        acc = sum(c * d for c, d in zip(self.coef, self.diff))
+        return _clamp(self.last + _div_round(acc, 1 << Q), INT32_MAX)
+
+    def exceeds(self, actual):
+        return abs(actual - self.predict()) > self.tolerance
+
+    def _push(self, value):
+        self.diff = [_clamp(value - self.last, INT32_MAX)] + self.diff[:-1]
+        self.last = value
+
+    def observe(self, actual):
+        err = actual - self.predict()
+        energy = 1 + sum(d * d for d in self.diff)
+        self.coef = [_clamp(c + _div_round(err * d * (1 << (Q - MU_SHIFT)), energy), COEF_MAX)
+                     for c, d in zip(self.coef, self.diff)]
+        self._push(actual)
+
+    def skip(self):
+        value = self.predict()
+        self._push(value)
+        return value
+
+
+class Node:
+    """Send decision of the firmware (forecast_needs_send() in src/main.c)."""
+
+    def __init__(self, tolerances, keyframe):
+        self.models = [Forecast(t) for t in tolerances]
+        self.keyframe = keyframe
+        self.seq = 0
+
+    def step(self, values):
+        """Returns the sequence number when the sample is sent, None otherwise."""
+        keyframe = self.seq % self.keyframe == 0
+        send = keyframe or any(m.exceeds(v) for m, v in zip(self.models, values))
+        for m, v in zip(self.models, values):
+            if keyframe:
+                m.reset(v)
+            elif send:
+                m.observe(v)
+            else:
+                m.skip()
+        seq, self.seq = self.seq, self.seq + 1
+        return seq if send else None
+
+
+class Gateway:
+    """Reconstructs the series of one node from the datagrams it sent."""
+
+    def __init__(self, tolerances, keyframe):
+        self.models = [Forecast(t) for t in tolerances]
+        self.keyframe = keyframe
+        self.seq = None
+        self.synced = False
+
+    def receive(self, seq, values):
+        """Returns (seq, values, predicted) for the filled gap and the received sample."""
+        out = []
+        if self.seq is None or seq <= self.seq:
+            # first datagram or the node restarted
+            self.synced = False
+        else:
+            gap = range(self.seq + 1, seq)
+            if any(s % self.keyframe == 0 for s in gap):
+                self.synced = False     # a keyframe was lost, so datagrams are missing
+            for s in gap:
+                if self.synced:
+                    out.append((s, [m.skip() for m in self.models], True))
+                else:
+                    out.append((s, [m.last for m in self.models], True))
+        if seq % self.keyframe == 0:
+            for m, v in zip(self.models, values):
+                m.reset(v)
+            self.synced = True
+        elif self.synced:
+            for m, v in zip(self.models, values):
+                m.observe(v)
+        else:
+            for m, v in zip(self.models, values):
+                m.last = v
+        self.seq = seq
+        out.append((seq, list(values), False))
+        return out
+
+
+_FIELD = re.compile(r"(\w+)=(-?[0-9.]+|\w+)")
+
+
+def parse_payload(text):
+    """Fields of a "temp=23.45,hum=56.78,id=AB[,seq=N]" datagram, values in 0.01 units."""
+    fields = dict(_FIELD.findall(text))
+    if not all(c in fields for c in CHANNELS):
+        return None
+    try:
+        values = [int(round(float(fields[c]) * 100)) for c in CHANNELS]
+    except ValueError:
+        return None
+    seq = int(fields["seq"]) if fields.get("seq", "").isdigit() else None
+    return fields.get("id", ""), values, seq
+
+
+def payload(values, node_id, seq):
+    parts = ",".join(f"{c}={v / 100:.2f}" for c, v in zip(CHANNELS, values))
+    return f"{parts},id={node_id},seq={seq}"
+
+
+def load_trace(path, node):
+    """Samples of one node from a gateway log or a CSV with temp,hum columns."""
+    samples = {}
+    with (sys.stdin if path == "-" else open(path, encoding="utf-8", errors="replace")) as f:
+        lines = f.read().splitlines()
+    if lines and lines[0].replace(" ", "").lower().startswith(("temp,", "time,")):
+        cols = [c.strip().lower() for c in lines[0].split(",")]
+        idx = [cols.index(c) for c in CHANNELS]
+        id_col = cols.index("id") if "id" in cols else None
+        for line in lines[1:]:
+            row = line.split(",")
+            if len(row) < len(cols):
+                continue
+            node_id = row[id_col].strip() if id_col is not None else ""
+            samples.setdefault(node_id, []).append([int(round(float(row[i]) * 100)) for i in idx])
+    else:
+        for line in lines:
+            parsed = parse_payload(line)
+            if parsed:
+                samples.setdefault(parsed[0], []).append(parsed[1])
+    if not samples:
+        sys.exit(f"no samples in {path}")
+    if node is None:
+        node = max(samples, key=lambda k: len(samples[k]))
+    if node not in samples:
+        sys.exit(f"node {node} not in trace, found: {', '.join(sorted(samples))}")
+    return node, samples[node]
+
+
+def evaluate(series, node_id, tolerances, keyframe):
+    node, gateway = Node(tolerances, keyframe), Gateway(tolerances, keyframe)
+    sent = sent_bytes = all_bytes = 0
+    recon = []
+    for values in series:
+        all_bytes += len(payload(values, node_id, 0).rsplit(",seq=", 1)[0])
+        seq = node.step(values)
+        if seq is None:
+            continue
+        sent += 1
+        text = payload(values, node_id, seq)
+        sent_bytes += len(text)
+        _, received, _ = parse_payload(text)
+        recon += [v for _, v, _ in gateway.receive(seq, received)]
+    # samples after the last datagram are filled in when the next one arrives
+    n = len(recon)
+    errors = [[r[c] - s[c] for r, s in zip(recon, series[:n])] for c in range(len(CHANNELS))]
+    return {
+        "samples": len(series), "sent": sent, "bytes": sent_bytes, "baseline_bytes": all_bytes,
+        "rmse": [math.sqrt(sum(e * e for e in ch) / max(n, 1)) / 100 for ch in errors],
+        "max": [max((abs(e) for e in ch), default=0) / 100 for ch in errors],
+    }
+
+
+def cmd_evaluate(args):
+    node_id, series = load_trace(args.trace, args.node)
+    temp_tols = [int(t) for t in args.temp_tol.split(",")]
+    hum_tols = [int(t) for t in args.hum_tol.split(",")]
+    print(f"node {node_id or '?'}: {len(series)} samples, keyframe every {args.keyframe}")
+    print(f"{'temp tol':>8} {'hum tol':>7} {'sent':>6} {'sent %':>6} {'bytes saved':>11} "
+          f"{'temp rmse':>9} {'temp max':>8} {'hum rmse':>8} {'hum max':>7}")
+    for tt in temp_tols:
+        for ht in hum_tols:
+            r = evaluate(series, node_id, (tt, ht), args.keyframe)
+            saved = r["baseline_bytes"] - r["bytes"]
+            print(f"{tt / 100:8.2f} {ht / 100:7.2f} {r['sent']:6d} {r['sent'] * 100.0 / r['samples']:6.1f} "
+                  f"{saved * 100.0 / max(r['baseline_bytes'], 1):10.1f}% "
+                  f"{r['rmse'][0]:9.3f} {r['max'][0]:8.2f} {r['rmse'][1]:8.3f} {r['max'][1]:7.2f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Transmission forecast, gateway side and evaluation")
+    sub = parser.add_subparsers(dest="command", required=True)
+    ev = sub.add_parser("evaluate", help="replay a recorded trace through node and gateway")
+    ev.add_argument("trace", help="gateway log with temp=..,hum=.. lines or CSV with temp,hum columns, '-' for stdin")
+    ev.add_argument("--node", help="node id to evaluate (default: the one with most samples)")
+    ev.add_argument("--temp-tol", default=str(DEFAULT_TOL["temp"]), help="comma separated tolerances in 0.01 C")
+    ev.add_argument("--hum-tol", default=str(DEFAULT_TOL["hum"]), help="comma separated tolerances in 0.01 %%")
+    ev.add_argument("--keyframe", type=int, default=DEFAULT_KEYFRAME, help="CONFIG_FORECAST_KEYFRAME_INTERVAL")
+    args = parser.parse_args()
+    cmd_evaluate(args)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,140 @@
+#!/usr/bin/env python3
+"""
+Gateway side of the LAN-first discovery (components/esp_gw_discovery)
+
+serve answers the "GWDISC? <nonce>" queries nodes broadcast, udp_server_raspi_example.py
+does the same next to its sensor socket. compare times unicast queries to the LAN
+address and to the DDNS name from any host, the same measurement the node logs at boot.
+
+Usage:
+    python3 tools/gw_discovery.py serve
+    python3 tools/gw_discovery.py find
+    python3 tools/gw_discovery.py compare --lan 192.168.1.20 --ddns team19pi.ddns.net --probes 50
+"""
+import argparse
+import os
+import socket
+import statistics
+import sys
+import time
+
+PORT = 8079                 # CONFIG_GW_DISCOVERY_PORT
+TIMEOUT = 0.3               # CONFIG_GW_DISCOVERY_TIMEOUT_MS
+QUERY = b"GWDISC? "
+ANSWER = b"GWDISC! "
+
+
+def open_responder(port=PORT):
+    """Socket for answering queries, bound to all addresses so broadcasts arrive."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", port))
+    return sock
+
+
+def answer(sock):
+    """Read one datagram from a responder socket and answer it if it is a query."""
+    data, addr = sock.recvfrom(64)
+    if data.startswith(QUERY) and len(data) == len(QUERY) + 8:
+        sock.sendto(ANSWER + data[len(QUERY):], addr)
+        return addr
+    return None
+
+
+def query(sock, dest, timeout=TIMEOUT):
+    """One round trip, returns (rtt seconds, answering address) or None."""
+    nonce = os.urandom(4).hex().encode()
+    start = time.perf_counter()
+    sock.sendto(QUERY + nonce, dest)
+    expect = ANSWER + nonce
+    while True:
+        left = timeout - (time.perf_counter() - start)
+        if left <= 0:
+            return None
+        sock.settimeout(left)
+        try:
+            data, addr = sock.recvfrom(64)
+        except socket.timeout:
+            return None
+        if data == expect:   # late answers to earlier queries carry another nonce
+            return time.perf_counter() - start, addr
+
+
+def client_socket():
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_BROADCAST, 1)
+    return sock
+
+
+def probe(sock, host, port, probes, timeout):
+    rtts = []
+    for _ in range(probes):
+        result = query(sock, (host, port), timeout)
+        if result:
+            rtts.append(result[0] * 1e6)
+    return rtts
+
+
+def report(name, host, probes, rtts):
+    loss = 100.0 * (probes - len(rtts)) / probes
+    if not rtts:
+        print(f"{name:5} {host:20} {probes:4} sent, 100.0% loss")
+        return
+    print(f"{name:5} {host:20} {probes:4} sent, {loss:5.1f}% loss, rtt us "
+          f"min {min(rtts):7.0f} avg {statistics.mean(rtts):7.0f} max {max(rtts):7.0f}")
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=PORT)
+    parser.add_argument("--timeout", type=float, default=TIMEOUT, help="seconds to wait for an answer")
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("serve", help="answer discovery queries")
+    find = sub.add_parser("find", help="broadcast a query and print the gateway that answers")
+    find.add_argument("--broadcast", default="255.255.255.255")
+    cmp = sub.add_parser("compare", help="RTT and loss of the LAN and the DDNS path")
+    cmp.add_argument("--lan", help="LAN address, found by broadcast when omitted")
+    cmp.add_argument("--ddns", default="team19pi.ddns.net")
+    cmp.add_argument("--probes", type=int, default=20)
+    args = parser.parse_args()
+
+    if args.cmd == "serve":
+        sock = open_responder(args.port)
+        print(f"Answering discovery queries on port {args.port}...")
+        try:
+            while True:
+                addr = answer(sock)
+                if addr:
+                    print(f"Answered {addr[0]}:{addr[1]}")
+        except KeyboardInterrupt:
+            pass
+        return 0
+
+    sock = client_socket()
+    if args.cmd == "find":
+        result = query(sock, (args.broadcast, args.port), args.timeout)
+        if not result:
+            print("no gateway answered", file=sys.stderr)
+            return 1
+        print(f"{result[1][0]} ({result[0] * 1e6:.0f} us)")
+        return 0
+
+    lan = args.lan
+    if lan is None:
+        result = query(sock, ("255.255.255.255", args.port), args.timeout)
+        lan = result[1][0] if result else None
+    if lan:
+        report("LAN", lan, args.probes, probe(sock, lan, args.port, args.probes, args.timeout))
+    else:
+        print("LAN   no gateway answered the broadcast")
+    try:
+        ddns = socket.gethostbyname(args.ddns)
+    except OSError:
+        print(f"DDNS  {args.ddns} did not resolve")
+        return 0
+    report("DDNS", ddns, args.probes, probe(sock, ddns, args.port, args.probes, args.timeout))
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
@@ -0,0 +1,178 @@
+#!/usr/bin/env python3
+"""
+Gateway side of the link probe (components/esp_link_probe)
+
+reflect sends every datagram on the probe port back unchanged, udp_server_raspi_example.py
+does the same next to its sensor socket. probe is a host prober with the node's
+statistics, to check a reflector or a path without a node. report turns the
+"#PROBE,..." lines nodes send next to their sensor datagrams into a table.
+
+Usage:
+    python3 tools/link_probe.py reflect
+    python3 tools/link_probe.py probe --host 127.0.0.1 --count 200 --interval 0.01
+    python3 udp_server_raspi_example.py | tee gateway.log
+    python3 tools/link_probe.py report gateway.log
+"""
+import argparse
+import socket
+import struct
+import sys
+import time
+
+PORT = 8084                     # CONFIG_LINK_PROBE_PORT
+MAGIC = 0x4252504C              # LINK_PROBE_MAGIC, "LPRB"
+PROBE = struct.Struct("<IIQ")   # magic, seq, sent_us
+FIELDS = ("sent", "received", "lost", "late", "duplicate", "loss_permille",
+          "min", "p50", "p90", "p99", "max", "srtt", "jitter", "rto")
+
+
+def open_reflector(port=PORT):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.setsockopt(socket.SOL_SOCKET, socket.SO_REUSEADDR, 1)
+    sock.bind(("", port))
+    return sock
+
+
+def reflect(sock):
+    """Send one datagram back to where it came from, unchanged."""
+    data, addr = sock.recvfrom(64)
+    sock.sendto(data, addr)
+    return addr
+
+
+def percentile(sorted_rtts, permille):
+    if not sorted_rtts:
+        return 0
+    rank = max(1, (len(sorted_rtts) * permille + 999) // 1000)
+    return sorted_rtts[rank - 1]
+
+
+def probe(host, port, count, interval, timeout):
+    """Probe a reflector and return the fields of a #PROBE line, exact percentiles."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    clock = time.monotonic_ns
+    sent_at = {}
+    rtts, late, duplicate, answered = [], 0, 0, set()
+    srtt = rttvar = jitter = last = None
+    next_send = clock()
+    end = next_send + int((count * interval + timeout) * 1e9)
+    seq = 0
+    while clock() < end:
+        now = clock()
+        if seq < count and now >= next_send:
+            sent_at[seq] = now // 1000
+            sock.sendto(PROBE.pack(MAGIC, seq, now // 1000), (host, port))
+            seq += 1
+            next_send += int(interval * 1e9)
+        wait = ((next_send if seq < count else end) - clock()) / 1e9
+        sock.settimeout(max(wait, 1e-4))
+        try:
+            data = sock.recv(64)
+        except socket.timeout:
+            continue
+        arrived = clock() // 1000
+        if len(data) != PROBE.size:
+            continue
+        magic, s, t = PROBE.unpack(data)
+        if magic != MAGIC or sent_at.get(s) != t:
+            continue
+        if s in answered:
+            duplicate += 1
+            continue
+        answered.add(s)
+        rtt = arrived - t
+        if rtt > timeout * 1e6:
+            late += 1
+            continue
+        if srtt is None:
+            srtt, rttvar, jitter = rtt, rtt / 2, 0.0
+        else:
+            jitter += (abs(rtt - last) - jitter) / 16
+            rttvar = 0.75 * rttvar + 0.25 * abs(srtt - rtt)
+            srtt = 0.875 * srtt + 0.125 * rtt
+        last = rtt
+        rtts.append(rtt)
+    sock.close()
+    rtts.sort()
+    lost = seq - len(rtts)
+    return {
+        "sent": seq, "received": len(rtts), "lost": lost, "late": late, "duplicate": duplicate,
+        "loss_permille": lost * 1000 // seq if seq else 0,
+        "min": rtts[0] if rtts else 0, "p50": percentile(rtts, 500), "p90": percentile(rtts, 900),
+        "p99": percentile(rtts, 990), "max": rtts[-1] if rtts else 0,
+        "srtt": int(srtt or 0), "jitter": int(jitter or 0), "rto": int((srtt or 0) + 4 * (rttvar or 0)),
+    }
+
+
+def parse_line(line):
+    """Fields of a "#PROBE,..." line anywhere in a text line, None otherwise."""
+    idx = line.find("#PROBE,")
+    if idx < 0:
+        return None
+    parts = line[idx + 7:].strip().rstrip("'\"").split(",")
+    if len(parts) != len(FIELDS):
+        return None
+    try:
+        return dict(zip(FIELDS, (int(v) for v in parts)))
+    except ValueError:
+        return None
+
+
+def format_row(stats):
+    return (f"{stats['sent']:6} {stats['received']:6} {stats['loss_permille'] / 10:5.1f}% "
+            f"{stats['late']:5} {stats['duplicate']:5} {stats['min'] / 1000:7.1f} {stats['p50'] / 1000:7.1f} "
+            f"{stats['p90'] / 1000:7.1f} {stats['p99'] / 1000:7.1f} {stats['max'] / 1000:7.1f} "
+            f"{stats['jitter'] / 1000:7.1f} {stats['rto'] / 1000:7.1f}")
+
+
+HEADER = "  sent   recv  loss  late   dup  min ms  p50 ms  p90 ms  p99 ms  max ms  jit ms  rto ms"
+
+
+def main():
+    parser = argparse.ArgumentParser(description=__doc__, formatter_class=argparse.RawDescriptionHelpFormatter)
+    parser.add_argument("--port", type=int, default=PORT)
+    sub = parser.add_subparsers(dest="cmd", required=True)
+    sub.add_parser("reflect", help="send probes back to the node")
+    p = sub.add_parser("probe", help="probe a reflector from this host")
+    p.add_argument("--host", default="127.0.0.1")
+    p.add_argument("--count", type=int, default=100)
+    p.add_argument("--interval", type=float, default=0.1, help="seconds between probes")
+    p.add_argument("--timeout", type=float, default=1.0, help="seconds after which an answer counts as lost")
+    r = sub.add_parser("report", help="table of the #PROBE lines in a log")
+    r.add_argument("log", help="gateway or console log, - for stdin")
+    args = parser.parse_args()
+
+    if args.cmd == "reflect":
+        sock = open_reflector(args.port)
+        print(f"Reflecting probes on port {args.port}...")
+        try:
+            while True:
+                reflect(sock)
+        except KeyboardInterrupt:
+            pass
+        return 0
+
+    if args.cmd == "probe":
+        stats = probe(args.host, args.port, args.count, args.interval, args.timeout)
+        print(HEADER)
+        print(format_row(stats))
+        print("#PROBE," + ",".join(str(stats[f]) for f in FIELDS))
+        return 0 if stats["received"] else 1
+
+    rows = 0
+    with (sys.stdin if args.log == "-" else open(args.log, encoding="utf-8", errors="replace")) as f:
+        for line in f:
+            stats = parse_line(line)
+            if stats:
+                if rows % 20 == 0:
+                    print(HEADER)
+                print(format_row(stats))
+                rows += 1
+    if rows == 0:
+        print("no #PROBE lines found", file=sys.stderr)
+        return 1
+    return 0
+
+
+if __name__ == "__main__":
+    sys.exit(main())
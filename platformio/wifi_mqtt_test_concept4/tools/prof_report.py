@@ -0,0 +1,131 @@
+#!/usr/bin/env python3
+"""
+Host side report for the cycle profiler (components/esp_prof)
+
+Reads the "#PROF,zone,count,min,avg,max,p99" lines the firmware prints or sends
+and renders the latest snapshot of every zone as a table in cycles and microseconds.
+With --baseline the same table gets the change against an earlier capture.
+
+Usage:
+    pio device monitor | tee after.log
+    python3 tools/prof_report.py after.log
+    python3 tools/prof_report.py after.log --baseline before.log --csv > diff.csv
+    python3 tools/prof_report.py --udp 8082
+"""
+import argparse
+import socket
+import sys
+
+FIELDS = ("count", "min", "avg", "max", "p99")
+
+
+def parse_lines(lines, zones=None):
+    """Collect the last reported values per zone from an iterable of text lines."""
+    zones = {} if zones is None else zones
+    for line in lines:
+        idx = line.find("#PROF,")
+        if idx < 0:
+            continue
+        parts = line[idx + 6:].strip().split(",")
+        if len(parts) != 1 + len(FIELDS):
+            continue
+        try:
+            zones[parts[0]] = dict(zip(FIELDS, (int(v) for v in parts[1:])))
+        except ValueError:
+            continue
+    return zones
+
+
+def load(path):
+    if path == "-":
+        return parse_lines(sys.stdin)
+    with open(path, encoding="utf-8", errors="replace") as f:
+        return parse_lines(f)
+
+
+def change(new, old):
+    if not old:
+        return "n/a"
+    return f"{(new - old) * 100.0 / old:+.1f}%"
+
+
+def rows(zones, baseline, mhz):
+    for name in sorted(zones, key=lambda z: zones[z]["avg"] * zones[z]["count"], reverse=True):
+        z = zones[name]
+        row = [name, z["count"]]
+        for field in ("min", "avg", "max", "p99"):
+            row += [z[field], f"{z[field] / mhz:.1f}"]
+        if baseline is not None:
+            old = baseline.get(name)
+            row += [change(z["avg"], old["avg"]) if old else "new",
+                    change(z["p99"], old["p99"]) if old else "new"]
+        yield row
+
+
+def header(with_baseline):
+    cols = ["zone", "count"]
+    for field in ("min", "avg", "max", "p99"):
+        cols += [field, f"{field} us"]
+    if with_baseline:
+        cols += ["avg vs base", "p99 vs base"]
+    return cols
+
+
+def print_table(zones, baseline, mhz, csv):
+    cols = header(baseline is not None)
+    table = [[str(c) for c in r] for r in rows(zones, baseline, mhz)]
+    if csv:
+        print(",".join(cols))
+        for r in table:
+            print(",".join(r))
+        return
+    widths = [max(len(c), *(len(r[i]) for r in table)) if table else len(c) for i, c in enumerate(cols)]
+    print("  ".join(c.ljust(w) if i == 0 else c.rjust(w) for i, (c, w) in enumerate(zip(cols, widths))))
+    for r in table:
+        print("  ".join(c.ljust(w) if i == 0 else c.rjust(w) for i, (c, w) in enumerate(zip(r, widths))))
+    if baseline is not None:
+        for name in sorted(set(baseline) - set(zones)):
+            print(f"{name}: only in baseline")
+
+
+def listen_udp(port, baseline, mhz, csv):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", port))
+    print(f"Listening for profile reports on UDP port {port}...")
+    try:
+        while True:
+            data, addr = sock.recvfrom(2048)
+            zones = parse_lines(data.decode("utf-8", "replace").splitlines())
+            print(f"\n[{addr[0]}]")
+            print_table(zones, baseline, mhz, csv)
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Report cycle profiler zones")
+    parser.add_argument("capture", nargs="?", help="console capture with #PROF lines, '-' for stdin")
+    parser.add_argument("--udp", metavar="PORT", type=int, help="listen for reports on this UDP port")
+    parser.add_argument("--baseline", metavar="FILE", help="earlier capture to compare against")
+    parser.add_argument("--cpu-mhz", type=float, default=160.0, help="CPU clock for the us columns (default 160)")
+    parser.add_argument("--csv", action="store_true", help="print CSV instead of an aligned table")
+    args = parser.parse_args()
+
+    if (args.capture is None) == (args.udp is None):
+        parser.error("give either a capture file or --udp")
+
+    baseline = load(args.baseline) if args.baseline else None
+    if args.udp:
+        listen_udp(args.udp, baseline, args.cpu_mhz, args.csv)
+        return
+    zones = load(args.capture)
+    if not zones:
+        sys.exit("no #PROF lines found")
+    print_table(zones, baseline, args.cpu_mhz, args.csv)
+
+
+if __name__ == "__main__":
+    main()
@@ -0,0 +1,236 @@
+#!/usr/bin/env python3
+"""
+Host side client for the FreeRTOS scheduling trace (components/esp_rtos_trace)
+
+Sends commands to the trace server on the node and renders a dump as per task
+CPU share, event counts and a text timeline.
+
+Usage:
+    python3 tools/rtos_trace.py 192.168.1.50 start
+    python3 tools/rtos_trace.py 192.168.1.50 dump --save run.bin
+    python3 tools/rtos_trace.py --load run.bin --width 120
+"""
+import argparse
+import socket
+import struct
+import sys
+from collections import defaultdict
+
+MAGIC = b"RTR1"
+HDR = struct.Struct("<4sBBHI")
+EVENT = struct.Struct("<II")
+SUMMARY = struct.Struct("<III")
+NAME_LEN = 16   # CONFIG_FREERTOS_MAX_TASK_NAME_LEN
+
+FROM_ISR = 0x80
+SWITCH_IN, TASK_CREATE, TASK_DELETE, NOTIFY, NOTIFY_WAIT, QUEUE_SEND, QUEUE_RECV, \
+    QUEUE_BLOCK_SEND, QUEUE_BLOCK_RECV, TICK, ISR_ENTER, ISR_EXIT = range(1, 13)
+EVENT_NAMES = {
+    SWITCH_IN: "switch", TASK_CREATE: "create", TASK_DELETE: "delete", NOTIFY: "notify",
+    NOTIFY_WAIT: "notify wait", QUEUE_SEND: "queue send", QUEUE_RECV: "queue recv",
+    QUEUE_BLOCK_SEND: "queue full", QUEUE_BLOCK_RECV: "queue empty", TICK: "tick",
+    ISR_ENTER: "isr enter", ISR_EXIT: "isr exit",
+}
+
+
+def request(node, port, command, timeout):
+    """Send one command, return the list of datagrams answering it."""
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.settimeout(timeout)
+    sock.sendto(command.encode(), (node, port))
+    dgrams = []
+    try:
+        while True:
+            data, _ = sock.recvfrom(2048)
+            if data[:4] != MAGIC:
+                continue
+            dgrams.append(data)
+            kind = data[4:5]
+            if kind in (b"A", b"Z"):
+                break
+    except socket.timeout:
+        if not dgrams:
+            sys.exit(f"no answer from {node}:{port}")
+        print(f"warning: dump incomplete, {len(dgrams)} datagrams received", file=sys.stderr)
+    finally:
+        sock.close()
+    return dgrams
+
+
+def save(path, dgrams):
+    with open(path, "wb") as f:
+        for d in dgrams:
+            f.write(struct.pack("<H", len(d)) + d)
+
+
+def load(path):
+    dgrams = []
+    with open(path, "rb") as f:
+        data = f.read()
+    pos = 0
+    while pos + 2 <= len(data):
+        n, = struct.unpack_from("<H", data, pos)
+        dgrams.append(data[pos + 2:pos + 2 + n])
+        pos += 2 + n
+    return dgrams
+
+
+class Trace:
+    def __init__(self, dgrams):
+        self.names = {}
+        self.events = []
+        self.recorded = self.dumped = 0
+        self.mhz = 160
+        last_seq = -1
+        for d in sorted(dgrams, key=lambda d: HDR.unpack_from(d)[3]):
+            _, kind, _, seq, count = HDR.unpack_from(d)
+            if seq != last_seq + 1:
+                print(f"warning: datagram {last_seq + 1} missing", file=sys.stderr)
+            last_seq = seq
+            body = d[HDR.size:]
+            if kind == ord("N"):
+                for i in range(count):
+                    off = i * (4 + NAME_LEN)
+                    tid, = struct.unpack_from("<I", body, off)
+                    self.names[tid] = body[off + 4:off + 4 + NAME_LEN].split(b"\0")[0].decode(errors="replace")
+            elif kind == ord("E"):
+                self.events += [EVENT.unpack_from(body, i * EVENT.size) for i in range(count)]
+            elif kind == ord("Z"):
+                self.recorded, self.dumped, self.mhz = SUMMARY.unpack_from(body)
+        self.events = list(self._unwrap(self.events))
+
+    @staticmethod
+    def _unwrap(events):
+        """Turn the wrapping 32-bit cycle counter into a monotonic 64-bit one."""
+        base, prev = 0, None
+        for ts, word in events:
+            if prev is not None and ts < prev:
+                base += 1 << 32
+            prev = ts
+            yield base + ts, word >> 24, word & 0xFFFFFF
+
+    def name(self, tid):
+        return self.names.get(tid, f"0x{tid:06x}")
+
+    def ms(self, cycles):
+        return cycles / (self.mhz * 1000.0)
+
+    def run_intervals(self):
+        """(task, start, end) for every stretch a task held the CPU."""
+        current, since = None, None
+        for ts, etype, obj in self.events:
+            if etype != SWITCH_IN:
+                continue
+            if current is not None:
+                yield current, since, ts
+            current, since = obj, ts
+        if current is not None and self.events:
+            yield current, since, self.events[-1][0]
+
+    def report(self, width):
+        if not self.events:
+            print("trace is empty, start recording first")
+            return
+        t0, t1 = self.events[0][0], self.events[-1][0]
+        span = max(t1 - t0, 1)
+        lost = self.recorded - self.dumped
+        print(f"{self.dumped} events over {self.ms(span):.1f} ms at {self.mhz} MHz"
+              + (f", {lost} older events overwritten" if lost else ""))
+
+        busy = defaultdict(int)
+        switches = defaultdict(int)
+        longest = defaultdict(int)
+        for task, start, end in self.run_intervals():
+            busy[task] += end - start
+            switches[task] += 1
+            longest[task] = max(longest[task], end - start)
+
+        per_task = defaultdict(lambda: defaultdict(int))
+        per_queue = defaultdict(lambda: defaultdict(int))
+        isr = defaultdict(int)
+        for _, etype, obj in self.events:
+            base = etype & ~FROM_ISR
+            if etype & FROM_ISR:
+                isr[EVENT_NAMES.get(base, str(base))] += 1
+            if base in (QUEUE_SEND, QUEUE_RECV, QUEUE_BLOCK_SEND, QUEUE_BLOCK_RECV):
+                per_queue[obj][base] += 1
+            elif base in (NOTIFY, NOTIFY_WAIT):
+                per_task[obj][base] += 1
+
+        print()
+        print(f"{'task':<16} {'cpu %':>6} {'ms':>9} {'runs':>6} {'longest ms':>10} {'notified':>8} {'waits':>6}")
+        for task in sorted(busy, key=busy.get, reverse=True):
+            print(f"{self.name(task):<16} {busy[task] * 100.0 / span:6.1f} {self.ms(busy[task]):9.2f} "
+                  f"{switches[task]:6d} {self.ms(longest[task]):10.2f} "
+                  f"{per_task[task][NOTIFY]:8d} {per_task[task][NOTIFY_WAIT]:6d}")
+
+        if per_queue:
+            print()
+            print(f"{'queue':<10} {'send':>6} {'recv':>6} {'full':>6} {'empty':>6}")
+            ranked = sorted(per_queue, key=lambda q: sum(per_queue[q].values()), reverse=True)
+            for q in ranked[:10]:
+                c = per_queue[q]
+                print(f"0x{q:06x}   {c[QUEUE_SEND]:6d} {c[QUEUE_RECV]:6d} {c[QUEUE_BLOCK_SEND]:6d} {c[QUEUE_BLOCK_RECV]:6d}")
+
+        if isr:
+            print()
+            print("ISR context: " + ", ".join(f"{k} {v}" for k, v in sorted(isr.items())))
+
+        self.timeline(t0, span, width, busy)
+
+    def timeline(self, t0, span, width, busy):
+        """One row per task, '#' = ran most of the column, '+' = ran part of it."""
+        bucket = span / width
+        rows = defaultdict(lambda: [0.0] * width)
+        for task, start, end in self.run_intervals():
+            pos = start
+            while pos < end:
+                col = min(int((pos - t0) / bucket), width - 1)
+                col_end = min(t0 + (col + 1) * bucket, end)
+                if col_end <= pos:
+                    col_end = end
+                rows[task][col] += col_end - pos
+                pos = col_end
+        isr_row = [" "] * width
+        for ts, etype, _ in self.events:
+            if etype & FROM_ISR:
+                isr_row[min(int((ts - t0) / bucket), width - 1)] = "!"
+
+        print()
+        print(f"timeline, {self.ms(bucket):.3f} ms per column")
+        for task in sorted(rows, key=busy.get, reverse=True):
+            line = "".join("#" if c > bucket / 2 else "+" if c > 0 else "." for c in rows[task])
+            print(f"{self.name(task):<16} |{line}|")
+        if any(c != " " for c in isr_row):
+            print(f"{'(isr)':<16} |{''.join(isr_row)}|")
+
+
+def main():
+    parser = argparse.ArgumentParser(description="FreeRTOS scheduling trace client")
+    parser.add_argument("node", nargs="?", help="IP or host name of the node")
+    parser.add_argument("command", nargs="?", default="dump", choices=("start", "stop", "clear", "dump"))
+    parser.add_argument("--port", type=int, default=8083, help="trace server port (CONFIG_RTOS_TRACE_UDP_PORT)")
+    parser.add_argument("--timeout", type=float, default=3.0, help="seconds to wait for the node")
+    parser.add_argument("--save", metavar="FILE", help="store the raw dump")
+    parser.add_argument("--load", metavar="FILE", help="render a stored dump instead of asking a node")
+    parser.add_argument("--width", type=int, default=100, help="timeline columns")
+    args = parser.parse_args()
+
+    if args.load:
+        Trace(load(args.load)).report(args.width)
+        return
+    if not args.node:
+        parser.error("node is required unless --load is given")
+
+    dgrams = request(args.node, args.port, args.command, args.timeout)
+    if args.command != "dump":
+        _, _, _, _, active = HDR.unpack_from(dgrams[-1])
+        print(f"ok, recording {'on' if active else 'off'}")
+        return
+    if args.save:
+        save(args.save, dgrams)
+    Trace(dgrams).report(args.width)
+
+
+if __name__ == "__main__":
+    main()
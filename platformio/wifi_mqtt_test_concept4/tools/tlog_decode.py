@@ -0,0 +1,200 @@
+#!/usr/bin/env python3
+"""
+Host side decoder for the tokenized log (components/esp_tlog)
+
+The firmware only ships descriptor addresses and raw arguments. This script
+reads the format strings back out of the firmware ELF and prints the messages.
+
+Usage:
+    python3 tools/tlog_decode.py .pio/build/esp32-c3-devkitm-1/firmware.elf --udp 8081
+    pio device monitor | python3 tools/tlog_decode.py firmware.elf --uart -
+    python3 tools/tlog_decode.py firmware.elf --uart captured_monitor.log
+
+Console lines that are not tokenized frames are passed through unchanged.
+"""
+import argparse
+import base64
+import re
+import socket
+import struct
+import sys
+
+FRAME_MAGIC = b"TLG1"
+REC_SYNC = 0xA5
+LEVEL_CHARS = "NEWIDV"
+
+ARG_I32, ARG_U32, ARG_I64, ARG_U64, ARG_F32, ARG_STR, ARG_PTR = range(1, 8)
+
+# printf conversions Python's % operator does not understand
+_LENGTH_MODIFIERS = re.compile(r"%([-+ #0]*\d*(?:\.\d+)?)(?:hh|h|ll|l|j|z|t|L)?([diouxXeEfgGcsp%])")
+
+
+class Elf:
+    """Minimal ELF reader: enough to read strings and words from allocated sections."""
+
+    def __init__(self, path):
+        with open(path, "rb") as f:
+            self.data = f.read()
+        if self.data[:4] != b"\x7fELF":
+            raise ValueError(f"{path} is not an ELF file")
+        self.is64 = self.data[4] == 2
+        self.endian = "<" if self.data[5] == 1 else ">"
+        if self.is64:
+            shoff, = struct.unpack_from(self.endian + "Q", self.data, 0x28)
+            shentsize, shnum = struct.unpack_from(self.endian + "HH", self.data, 0x3A)
+            fmt = "IIQQQQIIQQ"
+        else:
+            shoff, = struct.unpack_from(self.endian + "I", self.data, 0x20)
+            shentsize, shnum = struct.unpack_from(self.endian + "HH", self.data, 0x2E)
+            fmt = "IIIIIIIIII"
+        self.sections = []
+        for i in range(shnum):
+            (_, sh_type, sh_flags, sh_addr, sh_offset, sh_size,
+             _, _, _, _) = struct.unpack_from(self.endian + fmt, self.data, shoff + i * shentsize)
+            # SHF_ALLOC sections with file contents (not SHT_NOBITS)
+            if sh_flags & 0x2 and sh_type != 8 and sh_addr:
+                self.sections.append((sh_addr, sh_size, sh_offset))
+
+    def _offset(self, addr):
+        for start, size, offset in self.sections:
+            if start <= addr < start + size:
+                return offset + addr - start
+        raise KeyError(f"address 0x{addr:08x} is not in the ELF image")
+
+    def ptr_size(self):
+        return 8 if self.is64 else 4
+
+    def read(self, addr, size):
+        off = self._offset(addr)
+        return self.data[off:off + size]
+
+    def read_ptr(self, addr):
+        return struct.unpack(self.endian + ("Q" if self.is64 else "I"), self.read(addr, self.ptr_size()))[0]
+
+    def read_cstr(self, addr):
+        off = self._offset(addr)
+        end = self.data.index(b"\0", off)
+        return self.data[off:end].decode("utf-8", "replace")
+
+
+class Decoder:
+    def __init__(self, elf):
+        self.elf = elf
+        self.desc_cache = {}
+        self.tag_cache = {}
+
+    def descriptor(self, addr):
+        if addr not in self.desc_cache:
+            ps = self.elf.ptr_size()
+            fmt = self.elf.read_cstr(self.elf.read_ptr(addr))
+            line, level, nargs = struct.unpack("<HBB", self.elf.read(addr + ps, 4))
+            pyfmt = _LENGTH_MODIFIERS.sub(lambda m: "0x%08x" if m.group(2) == "p" else f"%{m.group(1)}{m.group(2)}", fmt)
+            self.desc_cache[addr] = (pyfmt, line, level, nargs)
+        return self.desc_cache[addr]
+
+    def tag(self, addr):
+        if addr not in self.tag_cache:
+            self.tag_cache[addr] = self.elf.read_cstr(addr)
+        return self.tag_cache[addr]
+
+    def records(self, frame):
+        """Yield decoded lines from one TLG1 frame."""
+        if frame[:4] != FRAME_MAGIC:
+            raise ValueError("not a tokenized log frame")
+        pos = 4
+        while pos + 4 <= len(frame):
+            header, = struct.unpack_from("<I", frame, pos)
+            if header >> 24 != REC_SYNC:
+                raise ValueError(f"lost sync at offset {pos}")
+            payload = header & 0xFFFF
+            dropped = (header >> 16) & 0xFF
+            body = frame[pos + 4:pos + 4 + payload]
+            pos += 4 + ((payload + 3) & ~3)
+            if dropped:
+                yield f"W (tlog) {dropped} record(s) dropped, ring full"
+            yield self.record(body)
+
+    def record(self, body):
+        desc, tag, ts, sig = struct.unpack_from("<IIII", body, 0)
+        off = 16
+        args = []
+        while sig:
+            t = sig & 0xF
+            sig >>= 4
+            if t == ARG_I32:
+                args.append(struct.unpack_from("<i", body, off)[0]); off += 4
+            elif t in (ARG_U32, ARG_PTR):
+                args.append(struct.unpack_from("<I", body, off)[0]); off += 4
+            elif t == ARG_I64:
+                args.append(struct.unpack_from("<q", body, off)[0]); off += 8
+            elif t == ARG_U64:
+                args.append(struct.unpack_from("<Q", body, off)[0]); off += 8
+            elif t == ARG_F32:
+                args.append(struct.unpack_from("<f", body, off)[0]); off += 4
+            elif t == ARG_STR:
+                n = body[off]
+                args.append(body[off + 1:off + 1 + n].decode("utf-8", "replace")); off += 1 + n
+        try:
+            fmt, line, level, _ = self.descriptor(desc)
+            text = fmt % tuple(args)
+            tag_name = self.tag(tag)
+        except (KeyError, TypeError, ValueError) as e:
+            return f"? ({ts}) <undecodable record desc=0x{desc:08x}: {e}> args={args}"
+        lvl = LEVEL_CHARS[level] if level < len(LEVEL_CHARS) else "?"
+        return f"{lvl} ({ts}) {tag_name}: {text}"
+
+
+def decode_uart(decoder, stream):
+    for line in stream:
+        line = line.rstrip("\r\n")
+        idx = line.find("#TLOG:")
+        if idx < 0:
+            print(line)
+            continue
+        try:
+            for out in decoder.records(base64.b64decode(line[idx + 6:])):
+                print(out)
+        except ValueError as e:
+            print(f"<bad frame: {e}>")
+        sys.stdout.flush()
+
+
+def decode_udp(decoder, port):
+    sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
+    sock.bind(("0.0.0.0", port))
+    print(f"Listening for tokenized log frames on UDP port {port}...")
+    try:
+        while True:
+            data, addr = sock.recvfrom(2048)
+            try:
+                for out in decoder.records(data):
+                    print(f"[{addr[0]}] {out}")
+            except ValueError as e:
+                print(f"[{addr[0]}] <bad frame: {e}>")
+            sys.stdout.flush()
+    except KeyboardInterrupt:
+        pass
+    finally:
+        sock.close()
+
+
+def main():
+    parser = argparse.ArgumentParser(description="Decode tokenized firmware logs")
+    parser.add_argument("elf", help="firmware ELF the frames were produced by")
+    source = parser.add_mutually_exclusive_group(required=True)
+    source.add_argument("--uart", metavar="FILE", help="console capture, '-' for stdin")
+    source.add_argument("--udp", metavar="PORT", type=int, help="listen for frames on this UDP port")
+    args = parser.parse_args()
+
+    decoder = Decoder(Elf(args.elf))
+    if args.udp:
+        decode_udp(decoder, args.udp)
+    elif args.uart == "-":
+        decode_uart(decoder, sys.stdin)
+    else:
+        with open(args.uart, encoding="utf-8", errors="replace") as f:
+            decode_uart(decoder, f)
+
+
+if __name__ == "__main__":
+    main()
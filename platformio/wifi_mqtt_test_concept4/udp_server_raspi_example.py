@@ -9,8 +9,27 @@ Usage:
     python3 udp_server_raspi_example.py
 
 Make sure your firewall allows UDP traffic on the specified port.
+
+Nodes built with CONFIG_FORECAST_ENABLE skip samples the gateway can predict;
+those are filled in with tools/forecast.py and printed as "Predicted" lines.
+
+Discovery queries from nodes (components/esp_gw_discovery) are answered on port
+8079, so nodes on the same LAN send here directly instead of through the DDNS name.
+Link probes (components/esp_link_probe) are reflected on port 8084, the "#PROBE"
+lines nodes send back are read by tools/link_probe.py report.
+
+This script prints and does not publish; raspberry1/gateway is the daemon that
+publishes to the MQTT broker.
 """
+import os
+import select
 import socket
+import sys
+
+sys.path.insert(0, os.path.join(os.path.dirname(os.path.abspath(__file__)), "tools"))
+from forecast import DEFAULT_KEYFRAME, DEFAULT_TOL, Gateway, parse_payload
+import gw_discovery
+import link_probe
 
 # Helper function to get the local WiFi IP address
 def get_local_ip():
@@ -32,12 +51,35 @@ print(f"Listening for UDP packets on {UDP_IP}:{UDP_PORT}...")
 
 sock = socket.socket(socket.AF_INET, socket.SOCK_DGRAM)
 sock.bind((UDP_IP, UDP_PORT))
+discovery = gw_discovery.open_responder()
+probes = link_probe.open_reflector()
+
+gateways = {}  # forecast state per node id
 
 try:
     while True:
+        readable, _, _ = select.select([sock, discovery, probes], [], [])
+        if probes in readable:
+            link_probe.reflect(probes)
+        if discovery in readable:
+            node = gw_discovery.answer(discovery)
+            if node:
+                print(f"Discovery query from {node}")
+        if sock not in readable:
+            continue
         data, addr = sock.recvfrom(1024)  # Buffer size is 1024 bytes
-        print(f"Received from {addr}: {data.decode().strip()}")
+        text = data.decode().strip()
+        print(f"Received from {addr}: {text}")
+        parsed = parse_payload(text)
+        if parsed and parsed[2] is not None:
+            node_id, values, seq = parsed
+            gateway = gateways.setdefault(node_id, Gateway((DEFAULT_TOL["temp"], DEFAULT_TOL["hum"]), DEFAULT_KEYFRAME))
+            for s, (temp, hum), predicted in gateway.receive(seq, values):
+                if predicted:
+                    print(f"Predicted for {node_id} seq {s}: temp {temp / 100:.2f}, hum {hum / 100:.2f}")
 except KeyboardInterrupt:
     print("\nServer stopped by user.")
 finally:
     sock.close()
+    discovery.close()
+    probes.close()
@@ -0,0 +1,498 @@
+/*
+ * Host benchmark of the I/O backends (src/io_backend.h), epoll against io_uring
+ *
+ * Checked first for both over 127.0.0.1: datagrams arrive once, in order and unchanged
+ * in batches and a datagram longer than a slot comes out cut and flagged; a readable
+ * socket is reported; connect with the linked first write and a run of writes from
+ * inside and outside the registered buffer reach a TCP peer byte for byte, short
+ * writes resumed; a write the peer does not take ends with -ETIME after the send
+ * timeout; nothing is reported for a socket after Remove().
+ *
+ * Then the receive path: a sender thread paces node datagrams at 20k to 100k per
+ * second, the receiving thread waits on the backend and parses every datagram, and
+ * its own CPU time (getrusage RUSAGE_THREAD, user + system) and syscalls per datagram
+ * are reported. Last the uplink path: one small write at a time to a TCP peer, each
+ * after the completion of the one before, like QoS 1 publishes, CPU and syscalls per
+ * write. Sender and receiver share the host's cores.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/backend_bench [seconds per run]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_backend.h"
+#include "parser.h"
+#include "udp_socket.h"
+
+using namespace gateway;
+
+namespace {
+
+void Fail(const char* backend, const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %s %ld, expected %ld\n", backend, what, got, expected);
+    std::exit(1);
+}
+
+int64_t MonotonicNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// user + system time of the calling thread
+int64_t ThreadCpuUs()
+{
+    rusage ru;
+    getrusage(RUSAGE_THREAD, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+std::unique_ptr<IoBackend> Make(IoBackend::Kind kind)
+{
+    std::string error;
+    std::unique_ptr<IoBackend> io = IoBackend::Create(kind, &error);
+    if (!io) {
+        std::fprintf(stderr, "%s: %s\n", IoBackendKindName(kind), error.c_str());
+        std::exit(1);
+    }
+    return io;
+}
+
+int Receiver(sockaddr_in* addr)
+{
+    int fd = OpenUdp("127.0.0.1", 0, 4 << 20);
+    socklen_t len = sizeof(*addr);
+    if (fd < 0 || getsockname(fd, reinterpret_cast<sockaddr*>(addr), &len) < 0) {
+        std::perror("receiver");
+        std::exit(1);
+    }
+    return fd;
+}
+
+// listening TCP socket on 127.0.0.1 with a free port
+int Listener(sockaddr_in* addr)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    *addr = {};
+    addr->sin_family = AF_INET;
+    addr->sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(*addr);
+    if (fd < 0 || bind(fd, reinterpret_cast<sockaddr*>(addr), sizeof(*addr)) < 0 || listen(fd, 4) < 0 ||
+        getsockname(fd, reinterpret_cast<sockaddr*>(addr), &len) < 0) {
+        std::perror("listener");
+        std::exit(1);
+    }
+    return fd;
+}
+
+int StreamSocket()
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    int on = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+    return fd;
+}
+
+int Datagram(char* buf, size_t size, uint32_t seq)
+{
+    return std::snprintf(buf, size, "temp=%.2f,hum=%.2f,id=n%u,seq=%u", 20 + (seq % 500) / 100.0,
+                         45 + (seq % 900) / 100.0, seq % 8, seq);
+}
+
+// records everything the backend reports
+struct Recorder : IoHandler {
+    const char* name = "";
+    uint32_t expected = 0;
+    bool saw_big = false;
+    std::vector<int> readable;
+    int connected_fd = -1;
+    int connect_result = 1;
+    int sent_fd = -1;
+    int sent_result = 0;
+    uint32_t events = 0;
+
+    void OnDatagrams(int, const PacketBatch& batch) override
+    {
+        for (const PacketSlot& p : batch) {
+            events++;
+            if (p.truncated()) {
+                // recvmmsg() gives the cut length, io_uring the full one
+                if (p.text().size() != PacketSlot::kData) {
+                    Fail(name, "truncated datagram length", static_cast<long>(p.text().size()), PacketSlot::kData);
+                }
+                saw_big = true;
+                continue;
+            }
+            char want[96];
+            int n = Datagram(want, sizeof(want), expected);
+            if (p.text() != std::string_view(want, n) || p.from.sin_family != AF_INET) {
+                Fail(name, "datagram content at", expected, -1);
+            }
+            expected++;
+        }
+    }
+    void OnReadable(int fd) override
+    {
+        events++;
+        readable.push_back(fd);
+    }
+    void OnConnected(int fd, int result) override
+    {
+        events++;
+        connected_fd = fd;
+        connect_result = result;
+    }
+    void OnSent(int fd, int result) override
+    {
+        events++;
+        sent_fd = fd;
+        sent_result = result;
+    }
+};
+
+// waits until done() or two seconds passed
+template <typename Done>
+void WaitFor(IoBackend& io, Recorder& r, Done done)
+{
+    int64_t deadline = MonotonicNs() + 2000000000LL;
+    while (!done() && MonotonicNs() < deadline) {
+        io.Wait(10, r);
+    }
+}
+
+// one write, resumed after short writes until all of it went out
+void WriteAll(IoBackend& io, Recorder& r, int fd, const uint8_t* buf, size_t len)
+{
+    size_t done = 0;
+    while (done < len) {
+        r.sent_fd = -1;
+        if (!io.Send(fd, buf + done, len - done)) {
+            Fail(r.name, "Send refused at", static_cast<long>(done), -1);
+        }
+        WaitFor(io, r, [&]() { return r.sent_fd == fd; });
+        if (r.sent_fd != fd || r.sent_result <= 0) {
+            Fail(r.name, "write result", r.sent_result, static_cast<long>(len - done));
+        }
+        done += static_cast<size_t>(r.sent_result);
+    }
+}
+
+void Verify(IoBackend::Kind kind)
+{
+    std::unique_ptr<IoBackend> io = Make(kind);
+    Recorder r;
+    r.name = io->name();
+
+    // datagrams in batches
+    constexpr uint32_t kCount = 1000;
+    sockaddr_in addr;
+    int rx = Receiver(&addr);
+    int tx = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    if (!io->AddDatagramSocket(rx, 64)) {
+        Fail(r.name, "AddDatagramSocket errno", errno, 0);
+    }
+    for (uint32_t seq = 0; seq < kCount; seq++) {
+        char buf[96];
+        int n = Datagram(buf, sizeof(buf), seq);
+        sendto(tx, buf, n, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    std::string big(2000, 'x');
+    sendto(tx, big.data(), big.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    WaitFor(*io, r, [&]() { return r.expected == kCount && r.saw_big; });
+    if (r.expected != kCount || !r.saw_big || io->stats().datagrams != kCount + 1 || io->stats().truncated != 1) {
+        Fail(r.name, "datagrams received", r.expected, kCount);
+    }
+
+    // a readable socket
+    sockaddr_in other_addr;
+    int other = Receiver(&other_addr);
+    io->AddReadable(other);
+    sendto(tx, "ping", 4, 0, reinterpret_cast<sockaddr*>(&other_addr), sizeof(other_addr));
+    WaitFor(*io, r, [&]() { return !r.readable.empty(); });
+    if (r.readable.empty() || r.readable[0] != other) {
+        Fail(r.name, "readable fd", r.readable.empty() ? -1 : r.readable[0], other);
+    }
+    char ping[8];
+    recv(other, ping, sizeof(ping), MSG_DONTWAIT);
+
+    // connect with the linked first write, then writes in and outside the registered buffer
+    static uint8_t registered[65536];
+    static uint8_t unregistered[300000];
+    for (size_t i = 0; i < sizeof(registered); i++) {
+        registered[i] = static_cast<uint8_t>(i * 7 + 3);
+    }
+    for (size_t i = 0; i < sizeof(unregistered); i++) {
+        unregistered[i] = static_cast<uint8_t>(i * 13 + 1);
+    }
+    io->RegisterSendBuffer(registered, sizeof(registered));
+    sockaddr_in listen_addr;
+    int listener = Listener(&listen_addr);
+    std::vector<uint8_t> received;
+    std::thread peer([&]() {
+        int c = accept(listener, nullptr, nullptr);
+        uint8_t buf[65536];
+        ssize_t n;
+        while ((n = recv(c, buf, sizeof(buf), 0)) > 0) {
+            received.insert(received.end(), buf, buf + n);
+        }
+        close(c);
+    });
+    std::vector<uint8_t> expected;
+    int fd = StreamSocket();
+    io->Connect(fd, reinterpret_cast<sockaddr*>(&listen_addr), sizeof(listen_addr), registered, 100);
+    expected.insert(expected.end(), registered, registered + 100);
+    r.sent_fd = -1;
+    WaitFor(*io, r, [&]() { return r.sent_fd == fd; });
+    if (r.connected_fd != fd || r.connect_result != 0 || r.sent_result != 100) {
+        Fail(r.name, "connect and first write", r.sent_result, 100);
+    }
+    io->AddReadable(fd);
+    for (uint32_t i = 0; i < 200; i++) {
+        size_t off = (i * 331) % 60000;
+        size_t len = 1 + (i * 97) % 5000;
+        WriteAll(*io, r, fd, registered + off, len);
+        expected.insert(expected.end(), registered + off, registered + off + len);
+    }
+    WriteAll(*io, r, fd, unregistered, sizeof(unregistered));
+    expected.insert(expected.end(), unregistered, unregistered + sizeof(unregistered));
+    uint64_t writes = io->stats().writes;
+    io->Remove(fd);
+    close(fd);
+    peer.join();
+    if (received != expected) {
+        Fail(r.name, "bytes at the TCP peer", static_cast<long>(received.size()), static_cast<long>(expected.size()));
+    }
+
+    // a peer that never reads: the write has to end with -ETIME
+    io->SetSendTimeout(200);
+    fd = StreamSocket();
+    io->Connect(fd, reinterpret_cast<sockaddr*>(&listen_addr), sizeof(listen_addr), nullptr, 0);
+    WaitFor(*io, r, [&]() { return r.connected_fd == fd && r.connect_result == 0; });
+    static uint8_t flood[1 << 22];
+    int result = 0;
+    int64_t start = MonotonicNs();
+    while (result >= 0 && MonotonicNs() - start < 3000000000LL) {
+        r.sent_fd = -1;
+        io->Send(fd, flood, sizeof(flood));
+        WaitFor(*io, r, [&]() { return r.sent_fd == fd; });
+        result = r.sent_fd == fd ? r.sent_result : 0;
+    }
+    if (result != -ETIME) {
+        Fail(r.name, "stalled write result", result, -ETIME);
+    }
+
+    // nothing after Remove(), even with a datagram and a write on their way
+    io->Send(fd, registered, 100);
+    io->Remove(fd);
+    close(fd);
+    io->Remove(rx);
+    sendto(tx, "late", 4, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    uint32_t events = r.events;
+    for (int i = 0; i < 10; i++) {
+        io->Wait(10, r);
+    }
+    if (r.events != events) {
+        Fail(r.name, "events after Remove()", static_cast<long>(r.events - events), 0);
+    }
+    std::printf("%-8s %u datagrams in order, oversize cut and flagged, readable reported, connect + %llu writes "
+                "byte for byte (%llu short), stalled write timed out, silent after Remove()\n",
+                r.name, kCount + 1, static_cast<unsigned long long>(writes),
+                static_cast<unsigned long long>(io->stats().short_writes));
+    close(listener);
+    close(other);
+    close(rx);
+    close(tx);
+}
+
+struct Result {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    double cpu_us = 0;          // per datagram or write
+    double syscalls = 0;
+};
+
+// the gateway's receive loop on a backend, paced sender in a thread
+Result RunReceive(IoBackend::Kind kind, double rate, double seconds, int64_t tick_ns)
+{
+    std::unique_ptr<IoBackend> io = Make(kind);
+    sockaddr_in addr;
+    int rx = Receiver(&addr);
+    int tx = socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0);
+    io->AddDatagramSocket(rx, 64);
+    std::atomic<bool> done{false};
+    uint64_t sent = 0;
+    std::thread sender([&]() {
+        const int64_t interval = static_cast<int64_t>(1e9 / rate);
+        const uint64_t total = static_cast<uint64_t>(rate * seconds);
+        int64_t start = MonotonicNs();
+        while (sent < total) {
+            int64_t due = (MonotonicNs() - start) / interval + 1;
+            for (; sent < total && static_cast<int64_t>(sent) < due; sent++) {
+                char buf[96];
+                int n = Datagram(buf, sizeof(buf), static_cast<uint32_t>(sent));
+                sendto(tx, buf, n, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            }
+            int64_t wait = start + static_cast<int64_t>(sent) * interval - MonotonicNs();
+            wait = tick_ns ? std::max(wait, tick_ns - (MonotonicNs() - start) % tick_ns) : wait;
+            if (wait > 50000) {
+                timespec ts = {0, static_cast<long>(wait)};
+                nanosleep(&ts, nullptr);
+            }
+        }
+        done = true;
+    });
+
+    struct Parse : IoHandler {
+        uint64_t received = 0;
+        uint64_t fields = 0;
+        void OnDatagrams(int, const PacketBatch& batch) override
+        {
+            for (const PacketSlot& p : batch) {
+                Record record;
+                ParseDatagram(p.text(), record);
+                fields += record.num_fields;
+                received++;
+            }
+        }
+        void OnReadable(int) override {}
+        void OnConnected(int, int) override {}
+        void OnSent(int, int) override {}
+    } parse;
+    int64_t cpu = ThreadCpuUs();
+    int64_t idle_end = 0;
+    for (;;) {
+        if (done) {
+            int64_t now = MonotonicNs();
+            idle_end = idle_end ? idle_end : now + 200000000;
+            if (now > idle_end) {
+                break;
+            }
+        }
+        io->Wait(10, parse);
+    }
+    cpu = ThreadCpuUs() - cpu;
+    sender.join();
+    if (parse.fields != 2 * parse.received) {
+        Fail(io->name(), "fields parsed", static_cast<long>(parse.fields), static_cast<long>(2 * parse.received));
+    }
+    close(rx);
+    close(tx);
+    Result r;
+    r.sent = sent;
+    r.received = parse.received;
+    r.cpu_us = parse.received ? static_cast<double>(cpu) / parse.received : 0;
+    r.syscalls = parse.received ? static_cast<double>(io->stats().syscalls) / parse.received : 0;
+    return r;
+}
+
+// one 40 byte write at a time to a TCP peer, the next after the completion
+Result RunWrites(IoBackend::Kind kind, double seconds)
+{
+    std::unique_ptr<IoBackend> io = Make(kind);
+    static uint8_t buf[16384];
+    std::memset(buf, 'p', sizeof(buf));
+    io->RegisterSendBuffer(buf, sizeof(buf));
+    sockaddr_in listen_addr;
+    int listener = Listener(&listen_addr);
+    uint64_t bytes = 0;
+    std::thread peer([&]() {
+        int c = accept(listener, nullptr, nullptr);
+        uint8_t in[65536];
+        ssize_t n;
+        while ((n = recv(c, in, sizeof(in), 0)) > 0) {
+            bytes += static_cast<uint64_t>(n);
+        }
+        close(c);
+    });
+    Recorder r;
+    r.name = io->name();
+    int fd = StreamSocket();
+    io->Connect(fd, reinterpret_cast<sockaddr*>(&listen_addr), sizeof(listen_addr), buf, 40);
+    WaitFor(*io, r, [&]() { return r.sent_fd == fd; });
+    uint64_t syscalls = io->stats().syscalls;
+    uint64_t writes = 0;
+    int64_t cpu = ThreadCpuUs();
+    int64_t end = MonotonicNs() + static_cast<int64_t>(seconds * 1e9);
+    while (MonotonicNs() < end) {
+        for (int i = 0; i < 1000; i++) {
+            r.sent_fd = -1;
+            io->Send(fd, buf + (writes % 256) * 40, 40);
+            while (r.sent_fd != fd) {
+                io->Wait(100, r);
+            }
+            writes++;
+        }
+    }
+    cpu = ThreadCpuUs() - cpu;
+    syscalls = io->stats().syscalls - syscalls;
+    io->Remove(fd);
+    close(fd);
+    peer.join();
+    close(listener);
+    if (bytes != (writes + 1) * 40) {
+        Fail(r.name, "bytes at the peer", static_cast<long>(bytes), static_cast<long>((writes + 1) * 40));
+    }
+    Result res;
+    res.sent = res.received = writes;
+    res.cpu_us = static_cast<double>(cpu) / writes;
+    res.syscalls = static_cast<double>(syscalls) / writes;
+    return res;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    std::signal(SIGPIPE, SIG_IGN);      // like main.cc, a write to a closed peer must not kill us
+    static const IoBackend::Kind kinds[] = { IoBackend::Kind::kEpoll, IoBackend::Kind::kUring };
+    for (IoBackend::Kind kind : kinds) {
+        Verify(kind);
+    }
+    static const double rates[] = { 20000, 50000, 100000 };
+    for (int64_t tick_ns : { 0, 1000000 }) {
+        std::printf("\nreceive, sender %s\n", tick_ns ? "wakes every 1 ms and sends what is due"
+                                                      : "paces every datagram");
+        std::printf("%8s %-9s %9s %8s %12s %10s\n", "pps", "backend", "received", "lost", "cpu us/pkt", "sys/pkt");
+        for (double rate : rates) {
+            for (IoBackend::Kind kind : kinds) {
+                Result r = RunReceive(kind, rate, seconds, tick_ns);
+                std::printf("%8.0f %-9s %9llu %8llu %12.3f %10.3f\n", rate, IoBackendKindName(kind),
+                            static_cast<unsigned long long>(r.received),
+                            static_cast<unsigned long long>(r.sent - r.received), r.cpu_us, r.syscalls);
+            }
+        }
+    }
+    std::printf("\nuplink, one 40 byte write at a time to a TCP peer\n");
+    std::printf("%-9s %10s %12s %10s\n", "backend", "writes", "cpu us/write", "sys/write");
+    for (IoBackend::Kind kind : kinds) {
+        Result r = RunWrites(kind, seconds);
+        std::printf("%-9s %10llu %12.3f %10.3f\n", IoBackendKindName(kind), static_cast<unsigned long long>(r.sent),
+                    r.cpu_us, r.syscalls);
+    }
+    return 0;
+}
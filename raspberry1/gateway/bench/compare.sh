@@ -0,0 +1,74 @@
+#!/bin/sh
+# Python example server vs. iot-gateway, CPU and kernel drops at a range of rates
+#
+# Runs platformio/wifi_mqtt_test_concept4/udp_server_raspi_example.py, the gateway with
+# no broker and the gateway publishing to bench/mqtt_sink at QoS 1, one after the other
+# on CPU 0, drives each with loadgen and prints one row per rate. The Python server
+# binds the address of the default route on the fixed ports 8080, 8079 and 8084, so
+# those have to be free. IO_BACKEND picks the gateway's io_backend, auto by default.
+#
+# Usage, from raspberry1/gateway after building into build/:
+#     bench/compare.sh [build dir] [seconds] [rate ...]
+#     bench/compare.sh build 10 500 1000 2000 5000 10000
+#     IO_BACKEND=epoll bench/compare.sh build 10 5000 10000
+#
+# SPDX-License-Identifier: MIT
+set -eu
+
+BUILD=${1:-build}
+SECONDS_PER_RATE=${2:-10}
+[ $# -ge 2 ] && shift 2 || shift $#
+RATES=${*:-500 1000 2000 5000 10000}
+IO_BACKEND=${IO_BACKEND:-auto}
+
+HERE=$(cd "$(dirname "$0")/.." && pwd)
+PYTHON_SERVER=$HERE/../../platformio/wifi_mqtt_test_concept4/udp_server_raspi_example.py
+SINK_PORT=18830
+CPU=0
+HOST=$(python3 -c 'import socket; s = socket.socket(socket.AF_INET, socket.SOCK_DGRAM); s.connect(("8.8.8.8", 80)); print(s.getsockname()[0])' 2>/dev/null || echo 127.0.0.1)
+
+field() {
+    # value of key=... on the RESULT line
+    sed -n "s/^RESULT.* $1=\([^ ]*\).*/\1/p"
+}
+
+run() {
+    # run <rate> <pid>, prints "cpu_pct ms_per_kpkt drops"
+    out=$("$BUILD/bench/loadgen" --host "$HOST" --port 8080 --rate "$1" --seconds "$SECONDS_PER_RATE" --pid "$2")
+    echo "$(echo "$out" | field cpu_pct) $(echo "$out" | field cpu_ms_per_kpkt) $(echo "$out" | field drops)"
+}
+
+stop() {
+    kill "$1" 2>/dev/null || true
+    wait "$1" 2>/dev/null || true
+}
+
+"$BUILD/bench/mqtt_sink" --port $SINK_PORT >/dev/null 2>&1 &
+SINK=$!
+trap 'stop $SINK' EXIT
+sleep 0.5
+
+echo "target $HOST:8080, CPU $CPU, io_backend $IO_BACKEND, $SECONDS_PER_RATE s per rate, cpu% / ms CPU per 1000 datagrams / kernel drops"
+echo "python: the example server, prints every datagram, publishes nothing"
+echo "gw rx:  iot-gateway with no broker listening, parses and queues like it would publish"
+echo "gw q1:  iot-gateway publishing both measurements to mqtt_sink at QoS 1"
+printf "%7s | %-24s | %-24s | %s\n" "pps" "python" "gw rx" "gw q1"
+for rate in $RATES; do
+    taskset -c $CPU python3 -u "$PYTHON_SERVER" >/dev/null 2>&1 &
+    PID=$!
+    sleep 1
+    py=$(run "$rate" $PID)
+    stop $PID
+
+    row="$py"
+    for broker_port in 1 $SINK_PORT; do
+        taskset -c $CPU "$BUILD/iot-gateway" --listen="$HOST" --broker=127.0.0.1 --broker_port=$broker_port \
+            --io_backend="$IO_BACKEND" --stats_interval_s=0 >/dev/null 2>&1 &
+        PID=$!
+        sleep 1
+        row="$row $(run "$rate" $PID)"
+        stop $PID
+    done
+    set -- $row
+    printf "%7s | %5s%% %7s ms %6s | %5s%% %7s ms %6s | %5s%% %7s ms %6s\n" "$rate" "$@"
+done
@@ -0,0 +1,285 @@
+/*
+ * Host benchmark of the gateway's datagram path
+ *
+ * Checked first:
+ *   - the parser on the node's format, other key orders, unknown keys and #PROBE lines,
+ *   - the forecast fill against a node simulated with the firmware's forecast.c: every
+ *     sample the node skipped has to come out as the value the node reconstructed,
+ *   - the MQTT codec, every packet decodes to what was encoded,
+ *   - Gateway::HandleDatagram() queues one message per measurement and prediction,
+ *     or one per sample with combine_fields.
+ * Then parse and HandleDatagram() are timed per datagram, without sockets.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/gateway_bench
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <netinet/in.h>
+
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <string>
+#include <vector>
+
+#include "forecast.h"
+#include "forecast_fill.h"
+#include "gateway.h"
+#include "log.h"
+#include "mqtt_codec.h"
+#include "parser.h"
+
+using namespace gateway;
+
+namespace {
+
+constexpr int kSamples = 20000;
+constexpr int kRounds = 1000000;
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+double NowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+void VerifyParser()
+{
+    Record r;
+    if (!ParseDatagram("temp=23.45,hum=56.78,id=AB,seq=7\n", r) || r.kind != RecordKind::kSample ||
+        r.node_id != "AB" || !r.has_seq || r.seq != 7 || r.num_fields != 2 || r.Find("temp")->value != 23.45 ||
+        r.Find("hum")->text != "56.78") {
+        Fail("node format", static_cast<long>(r.kind), static_cast<long>(RecordKind::kSample));
+    }
+    // other order, an unknown numeric key kept, an unknown text value skipped
+    if (!ParseDatagram("id=n1,co2=612,fw=v1.2.5,hum=40,temp=-3.5", r) || r.node_id != "n1" || r.has_seq ||
+        r.num_fields != 3 || r.Find("co2")->value != 612 || r.Find("temp")->value != -3.5 || r.Find("fw")) {
+        Fail("key order", r.num_fields, 3);
+    }
+    const char* bad[] = { "", "temp=1", "hum=2,temp=1", "id=AB", "id=AB,temp=x", "id=A B,temp=1", "temp=1,,id=AB",
+                          "id=AB,seq=-1,temp=1", "#PROBE,1,2,3", "#PROBE,1,2,3,4,5,6,7,8,9,10,11,12,13,14,15" };
+    for (const char* text : bad) {
+        if (ParseDatagram(text, r) || r.kind != RecordKind::kInvalid) {
+            std::fprintf(stderr, "MISMATCH: accepted \"%s\"\n", text);
+            std::exit(1);
+        }
+    }
+    if (!ParseDatagram("#PROBE,200,190,10,2,1,50,1800,2500,4100,9000,12000,2700,400,5000\n", r) ||
+        r.kind != RecordKind::kProbe || r.num_fields != 14 || r.Find("rtt_p99")->value != 9000 ||
+        r.fields[13].text != "5000") {
+        Fail("probe line", r.num_fields, 14);
+    }
+    std::printf("parser accepts the node format in any key order and rejects %zu bad datagrams\n",
+                sizeof(bad) / sizeof(bad[0]));
+}
+
+// a slow day curve with noise, in 0.01 units like the node's channels
+void Series(int i, int32_t (&v)[2])
+{
+    v[0] = static_cast<int32_t>(2150 + 300 * std::sin(i / 500.0) + (std::rand() % 9) - 4);
+    v[1] = static_cast<int32_t>(4800 + 900 * std::sin(i / 700.0 + 1) + (std::rand() % 41) - 20);
+}
+
+// forecast_needs_send() of the firmware, tools/forecast.py Node
+bool NodeStep(forecast_t (&models)[2], uint32_t seq, uint32_t keyframe, const int32_t (&v)[2])
+{
+    bool key = seq % keyframe == 0;
+    bool send = key || forecast_exceeds(&models[0], v[0]) || forecast_exceeds(&models[1], v[1]);
+    for (int c = 0; c < 2; c++) {
+        if (key) {
+            forecast_reset(&models[c], v[c]);
+        } else if (send) {
+            forecast_observe(&models[c], v[c]);
+        } else {
+            forecast_skip(&models[c]);
+        }
+    }
+    return send;
+}
+
+void VerifyForecastFill()
+{
+    const uint32_t keyframe = 30;
+    forecast_t node[2];
+    forecast_init(&node[0], 15);
+    forecast_init(&node[1], 50);
+    ForecastFill fill;
+    fill.Init(15, 50, keyframe);
+
+    std::vector<int32_t> reconstructed(kSamples * 2);
+    std::vector<uint8_t> filled(kSamples);
+    uint32_t sent = 0;
+    std::srand(1);
+    for (uint32_t seq = 0; seq < kSamples; seq++) {
+        int32_t v[2];
+        Series(static_cast<int>(seq), v);
+        bool send = NodeStep(node, seq, keyframe, v);
+        reconstructed[seq * 2] = node[0].last;
+        reconstructed[seq * 2 + 1] = node[1].last;
+        if (!send) {
+            continue;
+        }
+        sent++;
+        fill.Receive(seq, v, [&](uint32_t s, const int32_t (&out)[2], bool) {
+            if (out[0] != reconstructed[s * 2] || out[1] != reconstructed[s * 2 + 1]) {
+                Fail("reconstructed value at seq", s, -1);
+            }
+            filled[s] = 1;
+        });
+    }
+    uint32_t covered = 0;
+    for (uint8_t f : filled) {
+        covered += f;
+    }
+    // the tail after the last datagram is unknown until the next one
+    uint32_t tail = kSamples - 1;
+    while (!filled[tail]) {
+        tail--;
+    }
+    if (covered != tail + 1) {
+        Fail("samples filled in", covered, tail + 1);
+    }
+    std::printf("forecast fill: node sent %u of %d samples, the gateway rebuilt all %u bit exact\n",
+                sent, kSamples, covered);
+}
+
+void VerifyCodec()
+{
+    uint8_t buf[512];
+    mqtt::ConnectOptions o;
+    o.client_id = "gateway-pi";
+    o.username = "team19";
+    o.password = "secret";
+    size_t len = mqtt::EncodeConnect(buf, sizeof(buf), o);
+    if (len != 2 + 10 + 2 + 10 + 2 + 6 + 2 + 6 || buf[0] != 0x10 || buf[9] != 0xC2) {
+        Fail("CONNECT length", static_cast<long>(len), 40);
+    }
+    std::string payload(300, 'x');    // two byte remaining length
+    len = mqtt::EncodePublish(buf, sizeof(buf), "iot/pi/AB/airTemperature", payload, 1, 513, true);
+    mqtt::Packet p;
+    size_t used = 0;
+    if (mqtt::DecodePacket(buf, len, p, &used) != mqtt::Decode::kOk || used != len || p.type != mqtt::kPublish ||
+        p.packet_id != 513 || p.topic != "iot/pi/AB/airTemperature" || p.payload != payload || p.flags != 0x0A) {
+        Fail("PUBLISH round trip", static_cast<long>(used), static_cast<long>(len));
+    }
+    for (size_t cut = 0; cut < len; cut++) {
+        if (mqtt::DecodePacket(buf, cut, p, &used) != mqtt::Decode::kIncomplete) {
+            Fail("incomplete PUBLISH", static_cast<long>(cut), static_cast<long>(len));
+        }
+    }
+    len = mqtt::EncodePuback(buf, sizeof(buf), 65535);
+    if (mqtt::DecodePacket(buf, len, p, &used) != mqtt::Decode::kOk || p.type != mqtt::kPuback || p.packet_id != 65535) {
+        Fail("PUBACK round trip", p.packet_id, 65535);
+    }
+    if (mqtt::EncodePublish(buf, 16, "iot/pi/AB/airTemperature", "1", 1, 1, false) != 0) {
+        Fail("PUBLISH past the buffer", 1, 0);
+    }
+    std::printf("MQTT codec round trips CONNECT, PUBLISH and PUBACK\n");
+}
+
+Config BenchConfig()
+{
+    Config c;
+    c.topic_prefix = "iot/pi";
+    c.client_id = "bench";
+    c.queue_size = 1 << 16;
+    c.publish_predicted = true;
+    return c;
+}
+
+std::string Datagram(int32_t temp, int32_t hum, int node, uint32_t seq)
+{
+    char text[96];
+    std::snprintf(text, sizeof(text), "temp=%.2f,hum=%.2f,id=n%d,seq=%u", temp / 100.0, hum / 100.0, node, seq);
+    return text;
+}
+
+void VerifyGateway()
+{
+    for (bool combine : {false, true}) {
+        Config config = BenchConfig();
+        config.combine_fields = combine;
+        Gateway gw(config);
+        sockaddr_in from = {};
+        from.sin_family = AF_INET;
+        from.sin_port = htons(40000);
+        gw.HandleDatagram("#PROBE,1,1,0,0,0,0,1,1,1,1,1,1,0,1", from, 0);
+        gw.HandleDatagram(Datagram(2000, 5000, 1, 0), from, 0);
+        gw.HandleDatagram(Datagram(2001, 5000, 1, 1), from, 1);
+        gw.HandleDatagram(Datagram(2002, 5000, 1, 5), from, 2);     // 2, 3 and 4 predicted
+        gw.HandleDatagram("id=n2,co2=600,temp=21.5", from, 3);      // no seq, published as is
+        gw.HandleDatagram("#PROBE,1,1,0,0,0,0,1,1,1,1,1,1,0,1", from, 4);   // n2 now owns the address
+        gw.HandleDatagram("garbage", from, 5);
+        const GatewayStats& s = gw.stats();
+        // combined, a sample or prediction is one message; probe fields stay apart
+        uint64_t expected = combine ? 3 + 3 + 1 + 14 : 3 * 2 + 3 * 2 + 2 + 14;
+        if (s.samples != 4 || s.predicted != 3 || s.invalid != 1 || s.probes != 2 || s.probes_unknown != 1 ||
+            gw.mqtt().stats().queued != expected || gw.mqtt().stats().dropped != 0 ||
+            gw.mqtt().stats().replaced != 0) {
+            Fail("messages queued", static_cast<long>(gw.mqtt().stats().queued), static_cast<long>(expected));
+        }
+    }
+    std::printf("gateway queues one message per measurement, prediction and probe field, "
+                "one per sample and prediction with combine_fields\n");
+}
+
+void Bench()
+{
+    std::vector<std::string> datagrams;
+    std::srand(2);
+    for (int i = 0; i < 4096; i++) {
+        int32_t v[2];
+        Series(i, v);
+        datagrams.push_back(Datagram(v[0], v[1], i % 8, static_cast<uint32_t>(i / 8)));
+    }
+    Record r;
+    uint64_t fields = 0;
+    double t0 = NowNs();
+    for (int i = 0; i < kRounds; i++) {
+        ParseDatagram(datagrams[i & 4095], r);
+        fields += r.num_fields;
+    }
+    double parse_ns = (NowNs() - t0) / kRounds;
+    if (fields != 2ull * kRounds) {
+        Fail("fields parsed", static_cast<long>(fields), 2L * kRounds);
+    }
+
+    std::printf("ParseDatagram          : %6.1f ns per datagram\n", parse_ns);
+    for (const char* policy : { "drop_oldest", "latest" }) {
+        Config c = BenchConfig();
+        c.queue_size = 1024;    // wraps, like a broker that is away
+        c.queue_policy = policy;
+        Gateway gw(c);
+        sockaddr_in from = {};
+        from.sin_family = AF_INET;
+        t0 = NowNs();
+        for (int i = 0; i < kRounds; i++) {
+            from.sin_port = static_cast<in_port_t>(i & 7);
+            gw.HandleDatagram(datagrams[i & 4095], from, i);
+        }
+        double handle_ns = (NowNs() - t0) / kRounds;
+        std::printf("Gateway::HandleDatagram: %6.1f ns per datagram (parse, node, forecast, 2 messages queued, %s)\n",
+                    handle_ns, policy);
+    }
+}
+
+}  // namespace
+
+int main()
+{
+    LogInit(LogLevel::kWarning);
+    VerifyParser();
+    VerifyForecastFill();
+    VerifyCodec();
+    VerifyGateway();
+    Bench();
+    return 0;
+}
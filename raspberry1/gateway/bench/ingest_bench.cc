@@ -0,0 +1,294 @@
+/*
+ * Host benchmark of the ingest stage (src/udp_ingest.h)
+ *
+ * Checked first over 127.0.0.1: every datagram arrives once, in order and unchanged
+ * through recvmmsg() batches, kernel timestamps are set, and a datagram longer than
+ * a slot comes out cut and flagged.
+ *
+ * Then a sender thread paces node datagrams at 10k to 100k per second while the
+ * receiver runs the gateway's loop shape (poll, drain, parse every datagram) with
+ *   - recvfrom  one recvmsg() per datagram, the loop the gateway had before
+ *   - mmsg      UdpIngest, 64 per recvmmsg()
+ *   - mmsg+spin UdpIngest and 50 us of spinning after the last datagram
+ * and reports syscalls (poll and receives) per datagram and the ingest latency from
+ * the kernel's receive timestamp to the parser, p50 and p99. Once with every datagram
+ * paced, once with the sender waking every 1 ms and sending what is due, the bursts a
+ * WiFi access point delivers. Sender and receiver share the host's cores, on one core
+ * the latency is mostly scheduling.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/ingest_bench [seconds per run]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "parser.h"
+#include "udp_ingest.h"
+#include "udp_socket.h"
+
+using namespace gateway;
+
+namespace {
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+int64_t RealtimeNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// receiving socket on 127.0.0.1 with a free port, *addr set to it
+int Receiver(sockaddr_in* addr)
+{
+    int fd = OpenUdp("127.0.0.1", 0, 4 << 20);
+    socklen_t len = sizeof(*addr);
+    if (fd < 0 || getsockname(fd, reinterpret_cast<sockaddr*>(addr), &len) < 0) {
+        std::perror("receiver");
+        std::exit(1);
+    }
+    return fd;
+}
+
+int Sender()
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0) {
+        std::perror("sender");
+        std::exit(1);
+    }
+    return fd;
+}
+
+int Datagram(char* buf, size_t size, uint32_t seq)
+{
+    return std::snprintf(buf, size, "temp=%.2f,hum=%.2f,id=n%u,seq=%u", 20 + (seq % 500) / 100.0,
+                         45 + (seq % 900) / 100.0, seq % 8, seq);
+}
+
+void Verify()
+{
+    constexpr uint32_t kCount = 1000;
+    sockaddr_in addr;
+    int rx = Receiver(&addr);
+    int tx = Sender();
+    for (uint32_t seq = 0; seq < kCount; seq++) {
+        char buf[96];
+        int n = Datagram(buf, sizeof(buf), seq);
+        sendto(tx, buf, n, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    std::string big(2000, 'x');
+    sendto(tx, big.data(), big.size(), 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+
+    UdpIngest ingest(64, true);
+    ingest.Attach(rx);
+    uint32_t expected = 0;
+    bool saw_big = false;
+    int64_t deadline = MonotonicNs() + 2000000000LL;
+    while ((expected < kCount || !saw_big) && MonotonicNs() < deadline) {
+        PacketBatch batch = ingest.Receive();
+        for (const PacketSlot& p : batch) {
+            if (p.truncated()) {
+                if (p.text().size() != PacketSlot::kData || expected != kCount) {
+                    Fail("truncated datagram length", static_cast<long>(p.text().size()), PacketSlot::kData);
+                }
+                saw_big = true;
+                continue;
+            }
+            char want[96];
+            int n = Datagram(want, sizeof(want), expected);
+            if (p.text() != std::string_view(want, n)) {
+                Fail("datagram content at", expected, -1);
+            }
+            if (p.rx_realtime_ns == 0 || p.from.sin_family != AF_INET) {
+                Fail("timestamp at", expected, -1);
+            }
+            expected++;
+        }
+    }
+    if (expected != kCount || !saw_big) {
+        Fail("datagrams received", expected, kCount);
+    }
+    const IngestStats& s = ingest.stats();
+    if (s.packets != kCount + 1 || s.truncated != 1 || s.max_batch != 64) {
+        Fail("ingest packets", static_cast<long>(s.packets), kCount + 1);
+    }
+    std::printf("%u datagrams in order and unchanged in %llu recvmmsg calls, oversize datagram cut and flagged\n",
+                kCount + 1, static_cast<unsigned long long>(s.calls));
+    close(rx);
+    close(tx);
+}
+
+enum class Mode { kRecvfrom, kMmsg, kMmsgSpin };
+
+struct Result {
+    uint64_t sent;
+    uint64_t received;
+    uint64_t syscalls;
+    double p50_us;
+    double p99_us;
+};
+
+// the receive side of the gateway's poll loop with one of the modes
+Result Run(Mode mode, double rate, double seconds, int64_t tick_ns)
+{
+    sockaddr_in addr;
+    int rx = Receiver(&addr);
+    int tx = Sender();
+    std::atomic<bool> done{false};
+    uint64_t sent = 0;
+    std::thread sender([&]() {
+        const int64_t interval = static_cast<int64_t>(1e9 / rate);
+        const uint64_t total = static_cast<uint64_t>(rate * seconds);
+        int64_t start = MonotonicNs();
+        while (sent < total) {
+            int64_t due = (MonotonicNs() - start) / interval + 1;
+            for (; sent < total && static_cast<int64_t>(sent) < due; sent++) {
+                char buf[96];
+                int n = Datagram(buf, sizeof(buf), static_cast<uint32_t>(sent));
+                sendto(tx, buf, n, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+            }
+            int64_t wait = start + static_cast<int64_t>(sent) * interval - MonotonicNs();
+            wait = tick_ns ? std::max(wait, tick_ns - (MonotonicNs() - start) % tick_ns) : wait;
+            if (wait > 50000) {
+                timespec ts = {0, static_cast<long>(wait)};
+                nanosleep(&ts, nullptr);
+            }
+        }
+        done = true;
+    });
+
+    std::vector<uint32_t> latency_ns;
+    latency_ns.reserve(static_cast<size_t>(rate * seconds));
+    uint64_t syscalls = 0, received = 0, fields = 0;
+    auto handle = [&](std::string_view text, int64_t rx_ns) {
+        Record r;
+        ParseDatagram(text, r);
+        fields += r.num_fields;
+        int64_t lat = RealtimeNs() - rx_ns;
+        latency_ns.push_back(static_cast<uint32_t>(std::clamp<int64_t>(lat, 0, UINT32_MAX)));
+        received++;
+    };
+
+    UdpIngest ingest(mode == Mode::kRecvfrom ? 1 : 64, true);
+    ingest.Attach(rx);
+    int one = 1;
+    setsockopt(rx, SOL_SOCKET, SO_TIMESTAMPNS, &one, sizeof(one));
+    int64_t spin_until = 0;
+    int64_t idle_end = 0;
+    for (;;) {
+        int64_t now = MonotonicNs();
+        if (done) {
+            idle_end = idle_end ? idle_end : now + 200000000;
+            if (now > idle_end) {
+                break;
+            }
+        }
+        pollfd pfd = {rx, POLLIN, 0};
+        int timeout = mode == Mode::kMmsgSpin && now < spin_until ? 0 : 10;
+        syscalls++;
+        if (poll(&pfd, 1, timeout) <= 0) {
+            continue;
+        }
+        if (mode == Mode::kRecvfrom) {
+            // recvmsg() for the timestamp, the same one syscall per datagram as recvfrom()
+            for (;;) {
+                char buf[1500];
+                char control[CMSG_SPACE(sizeof(timespec))];
+                iovec iov = {buf, sizeof(buf)};
+                msghdr h = {};
+                h.msg_iov = &iov;
+                h.msg_iovlen = 1;
+                h.msg_control = control;
+                h.msg_controllen = sizeof(control);
+                syscalls++;
+                ssize_t n = recvmsg(rx, &h, MSG_DONTWAIT);
+                if (n < 0) {
+                    break;
+                }
+                timespec ts = {};
+                cmsghdr* c = CMSG_FIRSTHDR(&h);
+                if (c != nullptr && c->cmsg_type == SCM_TIMESTAMPNS) {
+                    std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                }
+                handle(std::string_view(buf, static_cast<size_t>(n)), ts.tv_sec * 1000000000LL + ts.tv_nsec);
+            }
+        } else {
+            for (;;) {
+                PacketBatch batch = ingest.Receive();
+                for (const PacketSlot& p : batch) {
+                    handle(p.text(), p.rx_realtime_ns);
+                }
+                if (batch.count < ingest.batch()) {
+                    break;
+                }
+            }
+            if (mode == Mode::kMmsgSpin) {
+                spin_until = MonotonicNs() + 50000;
+            }
+        }
+    }
+    sender.join();
+    syscalls += ingest.stats().calls;   // none in recvfrom mode
+    if (fields != 2 * received) {
+        Fail("fields parsed", static_cast<long>(fields), static_cast<long>(2 * received));
+    }
+    close(rx);
+    close(tx);
+    std::sort(latency_ns.begin(), latency_ns.end());
+    auto pct = [&](double p) {
+        return latency_ns.empty() ? 0.0 : latency_ns[static_cast<size_t>(p * (latency_ns.size() - 1))] / 1000.0;
+    };
+    return Result{sent, received, syscalls, pct(0.50), pct(0.99)};
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    Verify();
+    static const double rates[] = { 10000, 20000, 50000, 100000 };
+    static const struct {
+        Mode mode;
+        const char* name;
+    } modes[] = { { Mode::kRecvfrom, "recvfrom" }, { Mode::kMmsg, "mmsg" }, { Mode::kMmsgSpin, "mmsg+spin" } };
+    for (int64_t tick_ns : { 0, 1000000 }) {
+        std::printf("\nsender %s\n", tick_ns ? "wakes every 1 ms and sends what is due, bursts of rate/1000"
+                                             : "paces every datagram");
+        std::printf("%8s %-10s %9s %8s %10s %9s %9s\n", "pps", "mode", "received", "lost", "sys/pkt", "p50 us",
+                    "p99 us");
+        for (double rate : rates) {
+            for (const auto& m : modes) {
+                Result r = Run(m.mode, rate, seconds, tick_ns);
+                std::printf("%8.0f %-10s %9llu %8llu %10.3f %9.1f %9.1f\n", rate, m.name,
+                            static_cast<unsigned long long>(r.received),
+                            static_cast<unsigned long long>(r.sent - r.received),
+                            r.received ? static_cast<double>(r.syscalls) / r.received : 0.0, r.p50_us, r.p99_us);
+            }
+        }
+    }
+    return 0;
+}
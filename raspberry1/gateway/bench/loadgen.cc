@@ -0,0 +1,209 @@
+/*
+ * UDP load generator for the gateway
+ *
+ * Sends node datagrams "temp=..,hum=..,id=nK,seq=N" from a number of simulated nodes at
+ * a fixed rate, each node from its own socket like a real one. With the pid of the
+ * receiving process it reports the CPU time that process used over the run, from
+ * /proc/<pid>/stat, and the datagrams the kernel dropped on the target port, from
+ * /proc/net/udp.
+ *
+ * Usage:
+ *     loadgen [--host 127.0.0.1] [--port 8080] [--rate 1000] [--seconds 10] [--nodes 8] [--pid PID]
+ *
+ * The last line is machine readable for compare.sh:
+ *     RESULT rate=<pps> sent=<n> cpu_pct=<%> cpu_ms_per_kpkt=<ms> drops=<n>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cmath>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <fstream>
+#include <sstream>
+#include <string>
+#include <vector>
+
+namespace {
+
+struct Options {
+    std::string host = "127.0.0.1";
+    uint16_t port = 8080;
+    double rate = 1000;
+    double seconds = 10;
+    int nodes = 8;
+    int pid = 0;
+};
+
+int64_t NowNs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return ts.tv_sec * 1000000000LL + ts.tv_nsec;
+}
+
+// utime + stime of a process in clock ticks, -1 when it is gone
+long long CpuTicks(int pid)
+{
+    std::ifstream in("/proc/" + std::to_string(pid) + "/stat");
+    std::string line;
+    if (!std::getline(in, line)) {
+        return -1;
+    }
+    // the command name may hold spaces, the fields after it are fixed
+    std::istringstream rest(line.substr(line.rfind(')') + 2));
+    std::string field;
+    long long utime = 0, stime = 0;
+    for (int i = 3; rest >> field; i++) {
+        if (i == 14) {
+            utime = std::atoll(field.c_str());
+        } else if (i == 15) {
+            stime = std::atoll(field.c_str());
+            break;
+        }
+    }
+    return utime + stime;
+}
+
+// drops counter of the sockets bound to the port, summed
+long long UdpDrops(uint16_t port)
+{
+    std::ifstream in("/proc/net/udp");
+    std::string line;
+    std::getline(in, line);
+    long long drops = 0;
+    char want[8];
+    std::snprintf(want, sizeof(want), ":%04X", port);
+    while (std::getline(in, line)) {
+        std::istringstream fields(line);
+        std::string sl, local, field;
+        fields >> sl >> local;
+        if (local.size() < 5 || local.compare(local.size() - 5, 5, want) != 0) {
+            continue;
+        }
+        std::string last;
+        while (fields >> field) {
+            last = field;
+        }
+        drops += std::atoll(last.c_str());
+    }
+    return drops;
+}
+
+void Usage(const char* argv0)
+{
+    std::fprintf(stderr, "usage: %s [--host A] [--port P] [--rate PPS] [--seconds S] [--nodes N] [--pid PID]\n",
+                 argv0);
+    std::exit(2);
+}
+
+Options Parse(int argc, char** argv)
+{
+    Options o;
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (i + 1 == argc) {
+            Usage(argv[0]);
+        }
+        const char* v = argv[++i];
+        if (arg == "--host") {
+            o.host = v;
+        } else if (arg == "--port") {
+            o.port = static_cast<uint16_t>(std::atoi(v));
+        } else if (arg == "--rate") {
+            o.rate = std::atof(v);
+        } else if (arg == "--seconds") {
+            o.seconds = std::atof(v);
+        } else if (arg == "--nodes") {
+            o.nodes = std::atoi(v);
+        } else if (arg == "--pid") {
+            o.pid = std::atoi(v);
+        } else {
+            Usage(argv[0]);
+        }
+    }
+    if (o.rate <= 0 || o.seconds <= 0 || o.nodes <= 0) {
+        Usage(argv[0]);
+    }
+    return o;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    Options o = Parse(argc, argv);
+    sockaddr_in dest = {};
+    dest.sin_family = AF_INET;
+    dest.sin_port = htons(o.port);
+    if (inet_pton(AF_INET, o.host.c_str(), &dest.sin_addr) != 1) {
+        Usage(argv[0]);
+    }
+    std::vector<int> socks(o.nodes);
+    for (int& s : socks) {
+        s = socket(AF_INET, SOCK_DGRAM, 0);
+        if (s < 0) {
+            std::perror("socket");
+            return 1;
+        }
+    }
+
+    long long ticks_before = o.pid ? CpuTicks(o.pid) : 0;
+    long long drops_before = UdpDrops(o.port);
+    const int64_t interval_ns = static_cast<int64_t>(1e9 / o.rate);
+    const uint64_t total = static_cast<uint64_t>(o.rate * o.seconds);
+    std::vector<uint32_t> seq(o.nodes, 0);
+    uint64_t sent = 0, failed = 0;
+    int64_t start = NowNs();
+    while (sent < total) {
+        // everything due by now goes out, so the rate holds at any sleep granularity
+        int64_t due = (NowNs() - start) / interval_ns + 1;
+        for (; sent < total && static_cast<int64_t>(sent) < due; sent++) {
+            int node = static_cast<int>(sent % o.nodes);
+            uint32_t s = seq[node]++;
+            char text[96];
+            int n = std::snprintf(text, sizeof(text), "temp=%.2f,hum=%.2f,id=n%d,seq=%u",
+                                  21.5 + 3 * std::sin(s / 300.0), 48.0 + 9 * std::sin(s / 400.0 + 1), node, s);
+            if (sendto(socks[node], text, n, 0, reinterpret_cast<sockaddr*>(&dest), sizeof(dest)) < 0) {
+                failed++;
+            }
+        }
+        int64_t next = start + static_cast<int64_t>(sent) * interval_ns;
+        int64_t wait = next - NowNs();
+        if (wait > 50000) {
+            timespec ts = {static_cast<time_t>(wait / 1000000000), static_cast<long>(wait % 1000000000)};
+            nanosleep(&ts, nullptr);
+        }
+    }
+    double elapsed = (NowNs() - start) / 1e9;
+    // let the receiver finish the backlog before its CPU time is read
+    usleep(200000);
+    long long ticks = o.pid ? CpuTicks(o.pid) - ticks_before : 0;
+    long long drops = UdpDrops(o.port) - drops_before;
+    double cpu_s = static_cast<double>(ticks) / sysconf(_SC_CLK_TCK);
+    double cpu_pct = 100.0 * cpu_s / elapsed;
+    double actual_rate = sent / elapsed;
+    double ms_per_kpkt = sent ? cpu_s * 1000.0 / (sent / 1000.0) : 0;
+
+    std::printf("sent %llu datagrams in %.2f s (%.0f/s) from %d nodes, %llu send errors\n",
+                static_cast<unsigned long long>(sent), elapsed, actual_rate, o.nodes,
+                static_cast<unsigned long long>(failed));
+    if (o.pid) {
+        std::printf("receiver pid %d: %.1f%% CPU, %.2f ms CPU per 1000 datagrams, %lld dropped by the kernel\n",
+                    o.pid, cpu_pct, ms_per_kpkt, drops);
+    }
+    std::printf("RESULT rate=%.0f sent=%llu cpu_pct=%.1f cpu_ms_per_kpkt=%.3f drops=%lld\n", actual_rate,
+                static_cast<unsigned long long>(sent), cpu_pct, ms_per_kpkt, drops);
+    for (int s : socks) {
+        close(s);
+    }
+    return 0;
+}
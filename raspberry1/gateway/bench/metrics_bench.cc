@@ -0,0 +1,628 @@
+/*
+ * Host benchmark of the latency histograms and the metrics endpoint (src/metrics.h)
+ *
+ * Checked first:
+ *   - every value up to 2^20 and a spread of larger ones falls into a bucket that
+ *     holds it, the buckets follow each other without a gap and none is wider than
+ *     1/16 of its values,
+ *   - quantiles of a million samples spread over nine decades are within 1/16 of the
+ *     exact ones, the sum is exact,
+ *   - a reader collecting while the writer records never sees a count go back,
+ *   - the gateway, with and without rx workers, running against a broker stand-in on
+ *     127.0.0.1: GET /metrics has a HELP and TYPE for every family, the counters match
+ *     the datagrams sent, every node has its samples, the histograms count every
+ *     datagram parsed and every message written and acknowledged, their buckets never
+ *     go down and end at _count; another path is 404,
+ *   - a scrape of 50000 nodes, larger than the most a socket's send buffer may hold
+ *     (net.core.wmem_max), read slowly, arrives whole.
+ * Then the cost of a sample: Record() against a locked fetch_add and the clock read a
+ * latency needs, and a scrape of the gateway with 256 nodes.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/metrics_bench
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <cmath>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <future>
+#include <set>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gateway.h"
+#include "log.h"
+#include "metrics.h"
+#include "mqtt_codec.h"
+#include "udp_socket.h"
+
+using namespace gateway;
+
+namespace {
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+double NowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// xorshift64, the same values every run
+uint64_t Next(uint64_t& state)
+{
+    state ^= state << 13;
+    state ^= state >> 7;
+    state ^= state << 17;
+    return state;
+}
+
+void VerifyBuckets()
+{
+    auto check = [](uint64_t v) {
+        uint32_t i = Histogram::Index(v);
+        if (i >= Histogram::kBuckets || Histogram::Lowest(i) > v || Histogram::Highest(i) < v) {
+            Fail("bucket of value", static_cast<long>(v), static_cast<long>(i));
+        }
+    };
+    for (uint64_t v = 0; v < (1u << 20); v++) {
+        check(v);
+    }
+    uint64_t state = 88172645463325252ull;
+    for (int n = 0; n < 1000000; n++) {
+        check(Next(state) >> (24 + n % 40) & Histogram::kMax);
+    }
+    check(Histogram::kMax);
+    for (uint32_t i = 0; i < Histogram::kBuckets; i++) {
+        if (i + 1 < Histogram::kBuckets && Histogram::Highest(i) + 1 != Histogram::Lowest(i + 1)) {
+            Fail("gap after bucket", i, 0);
+        }
+        uint64_t width = Histogram::Highest(i) - Histogram::Lowest(i) + 1;
+        if (Histogram::Lowest(i) >= 16 && width * 16 > Histogram::Lowest(i)) {
+            Fail("width of bucket", static_cast<long>(width), static_cast<long>(Histogram::Lowest(i) / 16));
+        }
+    }
+    std::printf("%u buckets up to %llu, each within 1/16 of its values\n", Histogram::kBuckets,
+                static_cast<unsigned long long>(Histogram::kMax));
+}
+
+void VerifyQuantiles()
+{
+    const uint32_t n = 1000000;
+    std::vector<uint64_t> values(n);
+    uint64_t state = 2463534242ull;
+    uint64_t sum = 0;
+    Histogram h;
+    for (uint64_t& v : values) {
+        // log-uniform from 1 ns to 1 s
+        v = static_cast<uint64_t>(std::exp((Next(state) >> 11) * 0x1.0p-53 * std::log(1e9)));
+        h.Record(v);
+        sum += v;
+    }
+    std::sort(values.begin(), values.end());
+    HistogramCounts counts;
+    h.CollectInto(&counts);
+    if (counts.count != n || counts.sum != sum) {
+        Fail("sum", static_cast<long>(counts.sum), static_cast<long>(sum));
+    }
+    for (double q : {0.0, 0.5, 0.9, 0.99, 0.999, 0.9999, 1.0}) {
+        size_t rank = std::max<size_t>(1, static_cast<size_t>(std::ceil(q * n)));
+        uint64_t exact = values[rank - 1];
+        uint64_t got = counts.Quantile(q);
+        if (got < exact || got - exact > exact / 16) {
+            Fail("quantile", static_cast<long>(got), static_cast<long>(exact));
+        }
+    }
+    if (counts.CountAtOrBelow(Histogram::kMax) != n || counts.CountAtOrBelow(0) != 0) {
+        Fail("count at or below", static_cast<long>(counts.CountAtOrBelow(0)), 0);
+    }
+    std::printf("quantiles of %u samples over nine decades within 1/16, sum exact\n", n);
+}
+
+void VerifyConcurrentRead()
+{
+    Histogram h;
+    const uint64_t n = 20000000;
+    std::thread writer([&] {
+        for (uint64_t i = 0; i < n; i++) {
+            h.Record(i & 0xfffff);
+        }
+    });
+    uint64_t last = 0, reads = 0;
+    for (;;) {
+        HistogramCounts counts;
+        h.CollectInto(&counts);
+        if (counts.count < last) {
+            Fail("count went back", static_cast<long>(counts.count), static_cast<long>(last));
+        }
+        last = counts.count;
+        reads++;
+        if (last == n) {
+            break;
+        }
+    }
+    writer.join();
+    std::printf("%llu reads while the writer recorded, counts never went back\n", static_cast<unsigned long long>(reads));
+}
+
+// CONNACK for CONNECT, PUBACK right away for every QoS 1 PUBLISH
+class Broker {
+public:
+    Broker()
+    {
+        listener_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener_, 4) < 0 ||
+            getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+            std::perror("broker");
+            std::exit(1);
+        }
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { Run(); });
+    }
+
+    ~Broker()
+    {
+        stop_ = true;
+        thread_.join();
+        close(listener_);
+    }
+
+    uint16_t port() const { return port_; }
+
+private:
+    void Run()
+    {
+        int client = -1;
+        std::vector<uint8_t> in(1 << 16);
+        size_t len = 0;
+        while (!stop_) {
+            pollfd fds[2] = { { listener_, POLLIN, 0 }, { client, POLLIN, 0 } };
+            poll(fds, client >= 0 ? 2 : 1, 20);
+            if (fds[0].revents & POLLIN) {
+                if (client >= 0) {
+                    close(client);
+                }
+                client = accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+                len = 0;
+            }
+            if (client < 0 || !(fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            ssize_t n = recv(client, in.data() + len, in.size() - len, MSG_DONTWAIT);
+            if (n < 0 && errno == EAGAIN) {
+                continue;
+            }
+            if (n <= 0) {
+                close(client);
+                client = -1;
+                continue;
+            }
+            len += static_cast<size_t>(n);
+            uint8_t out[1 << 14];
+            size_t out_len = 0;
+            size_t pos = 0;
+            mqtt::Packet p;
+            size_t used = 0;
+            while (out_len + 4 <= sizeof(out) &&
+                   mqtt::DecodePacket(in.data() + pos, len - pos, p, &used) == mqtt::Decode::kOk) {
+                pos += used;
+                if (p.type == mqtt::kConnect) {
+                    const uint8_t connack[] = { mqtt::kConnack << 4, 2, 0, 0 };
+                    std::memcpy(out + out_len, connack, sizeof(connack));
+                    out_len += sizeof(connack);
+                } else if (p.type == mqtt::kPublish && p.packet_id) {
+                    out_len += mqtt::EncodePuback(out + out_len, sizeof(out) - out_len, p.packet_id);
+                } else if (p.type == mqtt::kPingreq) {
+                    out[out_len++] = mqtt::kPingresp << 4;
+                    out[out_len++] = 0;
+                }
+            }
+            std::memmove(in.data(), in.data() + pos, len - pos);
+            len -= pos;
+            if (out_len) {
+                send(client, out, out_len, MSG_NOSIGNAL);
+            }
+        }
+        if (client >= 0) {
+            close(client);
+        }
+    }
+
+    int listener_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+};
+
+// a port nothing listens on right now
+uint16_t FreePort(int type)
+{
+    int fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+// the status code, the body in *body; the answer read after wait_ms
+int HttpGet(uint16_t port, const char* path, std::string* body, int wait_ms = 0)
+{
+    int fd = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (connect(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0) {
+        close(fd);
+        return -1;
+    }
+    std::string request = std::string("GET ") + path + " HTTP/1.1\r\nHost: localhost\r\n\r\n";
+    send(fd, request.data(), request.size(), MSG_NOSIGNAL);
+    usleep(wait_ms * 1000);
+    std::string response;
+    char buf[65536];
+    ssize_t n;
+    while ((n = recv(fd, buf, sizeof(buf), 0)) > 0) {
+        response.append(buf, static_cast<size_t>(n));
+    }
+    close(fd);
+    size_t end = response.find("\r\n\r\n");
+    if (response.compare(0, 9, "HTTP/1.1 ") != 0 || end == std::string::npos) {
+        return -1;
+    }
+    size_t length_at = response.find("Content-Length: ");
+    size_t length = length_at < end ? std::strtoul(response.c_str() + length_at + 16, nullptr, 10) : 0;
+    *body = response.substr(end + 4);
+    if (body->size() != length) {
+        Fail("body bytes", static_cast<long>(body->size()), static_cast<long>(length));
+    }
+    return std::atoi(response.c_str() + 9);
+}
+
+// the value of the sample `series`, name and labels as written; -1 when there is none
+double Value(const std::string& text, const std::string& series)
+{
+    std::string line = "\n" + series + " ";
+    size_t at = text.find(line);
+    return at == std::string::npos ? -1 : std::strtod(text.c_str() + at + line.size(), nullptr);
+}
+
+// every sample belongs to a family declared before it, histogram buckets go up to _count
+void CheckExposition(const std::string& text)
+{
+    std::set<std::string> families, histograms;
+    std::string last_bucket_family;
+    double last_bucket = 0;
+    size_t pos = 0;
+    long lines = 0;
+    while (pos < text.size()) {
+        size_t end = text.find('\n', pos);
+        if (end == std::string::npos) {
+            Fail("unterminated line at byte", static_cast<long>(pos), static_cast<long>(text.size()));
+        }
+        std::string line = text.substr(pos, end - pos);
+        pos = end + 1;
+        lines++;
+        if (line.compare(0, 7, "# HELP ") == 0) {
+            continue;
+        }
+        if (line.compare(0, 7, "# TYPE ") == 0) {
+            size_t space = line.find(' ', 7);
+            std::string name = line.substr(7, space - 7);
+            if (!families.insert(name).second) {
+                Fail("family declared twice, line", lines, 0);
+            }
+            if (line.compare(space + 1, std::string::npos, "histogram") == 0) {
+                histograms.insert(name);
+            }
+            continue;
+        }
+        std::string name = line.substr(0, line.find_first_of("{ "));
+        double value = std::strtod(line.c_str() + line.rfind(' ') + 1, nullptr);
+        std::string family = name;
+        for (const char* suffix : {"_bucket", "_sum", "_count"}) {
+            size_t len = std::strlen(suffix);
+            if (name.size() > len && name.compare(name.size() - len, len, suffix) == 0 &&
+                histograms.count(name.substr(0, name.size() - len))) {
+                family = name.substr(0, name.size() - len);
+                if (std::strcmp(suffix, "_bucket") == 0) {
+                    if (family == last_bucket_family && value < last_bucket) {
+                        Fail("bucket below the one before, line", lines, 0);
+                    }
+                    last_bucket_family = family;
+                    last_bucket = value;
+                } else if (std::strcmp(suffix, "_count") == 0 && value != last_bucket) {
+                    Fail("_count against the +Inf bucket", static_cast<long>(value), static_cast<long>(last_bucket));
+                }
+            }
+        }
+        if (!families.count(family)) {
+            Fail("sample before its family, line", lines, 0);
+        }
+    }
+}
+
+// the gateway on its own thread against the broker stand-in, on free ports
+struct Running {
+    explicit Running(uint32_t rx_workers, uint32_t max_nodes = 256)
+    {
+        config.listen = "127.0.0.1";
+        config.port = FreePort(SOCK_DGRAM);
+        config.discovery_port = config.probe_port = 0;
+        config.metrics_port = FreePort(SOCK_STREAM);
+        config.rx_workers = rx_workers;
+        config.rx_pin = false;
+        config.broker = "127.0.0.1";
+        config.broker_port = broker.port();
+        config.client_id = "metrics_bench";
+        config.topic_prefix = "iot/pi";
+        config.max_nodes = max_nodes;
+        config.queue_size = 1 << 16;
+        config.queue_policy = "drop_oldest";     // every message counts, none replaced
+        config.stats_interval_s = 0;
+        gw.reset(new Gateway(config));
+        // opened where it runs, an io_uring instance belongs to the thread that set it up
+        std::promise<std::string> opened;
+        thread = std::thread([this, &opened] {
+            std::string error;
+            bool ok = gw->Open(&error);
+            opened.set_value(error);
+            if (ok) {
+                gw->Run(&stop, &dump);
+            }
+        });
+        std::string error = opened.get_future().get();
+        if (!error.empty()) {
+            std::fprintf(stderr, "MISMATCH: %s\n", error.c_str());
+            std::exit(1);
+        }
+        sender = OpenUdp("127.0.0.1", 0);
+        to.sin_family = AF_INET;
+        to.sin_port = htons(config.port);
+        to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    }
+
+    ~Running()
+    {
+        stop = 1;
+        thread.join();
+        close(sender);
+    }
+
+    void Send(const char* text)
+    {
+        while (sendto(sender, text, std::strlen(text), 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to)) < 0) {
+            usleep(100);
+        }
+    }
+
+    // polls until the series reaches value, the last scrape in *text
+    bool WaitFor(const std::string& series, double value, std::string* text)
+    {
+        for (int i = 0; i < 500; i++) {
+            if (HttpGet(config.metrics_port, "/metrics", text) == 200 && Value(*text, series) >= value) {
+                return true;
+            }
+            usleep(10000);
+        }
+        return false;
+    }
+
+    Broker broker;
+    Config config;
+    std::unique_ptr<Gateway> gw;
+    volatile std::sig_atomic_t stop = 0;
+    volatile std::sig_atomic_t dump = 0;
+    std::thread thread;
+    int sender = -1;
+    sockaddr_in to = {};
+};
+
+void VerifyEndpoint(uint32_t rx_workers)
+{
+    constexpr uint32_t kNodes = 3;
+    constexpr uint32_t kPerNode = 100;
+    Running run(rx_workers);
+    for (uint32_t seq = 0; seq < kPerNode; seq++) {
+        for (uint32_t node = 0; node < kNodes; node++) {
+            char text[64];
+            std::snprintf(text, sizeof(text), "temp=21.%02u,hum=40.00,id=n%u,seq=%u", seq, node, seq);
+            run.Send(text);
+        }
+        usleep(200);
+    }
+    const double messages = kNodes * kPerNode * 2;
+    std::string text;
+    if (!run.WaitFor("gateway_ingest_to_ack_seconds_count", messages, &text)) {
+        Fail("messages acknowledged", static_cast<long>(Value(text, "gateway_ingest_to_ack_seconds_count")),
+             static_cast<long>(messages));
+    }
+    CheckExposition(text);
+    struct {
+        const char* series;
+        double expected;
+    } checks[] = {
+        {"gateway_datagrams_total", kNodes * kPerNode},
+        {"gateway_samples_total", kNodes * kPerNode},
+        {"gateway_mqtt_acked_total", messages},
+        {"gateway_mqtt_connected", 1},
+        {"gateway_nodes", kNodes},
+        {"gateway_node_samples_total{node=\"n0\"}", kPerNode},
+        {"gateway_node_samples_total{node=\"n2\"}", kPerNode},
+        {"gateway_node_missing_total{node=\"n1\"}", 0},
+        {"gateway_parse_seconds_count", kNodes * kPerNode},
+        {"gateway_ingest_to_publish_seconds_count", messages},
+        {"gateway_ingest_to_ack_seconds_count", messages},
+        {"gateway_ingest_to_ack_seconds_bucket{le=\"+Inf\"}", messages},
+    };
+    for (const auto& c : checks) {
+        if (Value(text, c.series) != c.expected) {
+            std::fprintf(stderr, "%s\n", c.series);
+            Fail("series", static_cast<long>(Value(text, c.series)), static_cast<long>(c.expected));
+        }
+    }
+    if (rx_workers && Value(text, "gateway_rx_datagrams_total{worker=\"0\"}") < 0) {
+        Fail("rx worker series", -1, 0);
+    }
+    std::string body;
+    int status = HttpGet(run.config.metrics_port, "/nothing", &body);
+    if (status != 404) {
+        Fail("status of another path", status, 404);
+    }
+    // the le="0.001" bucket against all: acknowledged within a millisecond
+    double fast = Value(text, "gateway_ingest_to_ack_seconds_bucket{le=\"0.001\"}");
+    std::printf("%s: %zu bytes of exposition, every series as sent, %.0f of %.0f messages acknowledged within 1 ms "
+                "of their datagram\n",
+                rx_workers ? "with 2 rx workers" : "event loop", text.size(), fast, messages);
+}
+
+void VerifyLargeScrape()
+{
+    constexpr uint32_t kNodes = 50000;
+    Running run(0, 1 << 16);
+    std::string text;
+    for (uint32_t node = 0; node < kNodes; node++) {
+        char datagram[64];
+        std::snprintf(datagram, sizeof(datagram), "temp=21.50,hum=40.00,id=node_%05u,seq=1", node);
+        run.Send(datagram);
+        usleep(50);     // slower than the loop takes them, the socket buffer drops nothing
+    }
+    if (!run.WaitFor("gateway_nodes", kNodes, &text)) {
+        Fail("nodes", static_cast<long>(Value(text, "gateway_nodes")), kNodes);
+    }
+    long wmem_max = 0;
+    if (FILE* f = std::fopen("/proc/sys/net/core/wmem_max", "r")) {
+        if (std::fscanf(f, "%ld", &wmem_max) != 1) {
+            wmem_max = 0;
+        }
+        std::fclose(f);
+    }
+    // SO_SNDBUF is doubled for the kernel's bookkeeping, the most it can be
+    if (static_cast<long>(text.size()) <= 2 * wmem_max) {
+        Fail("scrape bytes over the largest send buffer", static_cast<long>(text.size()), 2 * wmem_max);
+    }
+    // the scraper reads only once the socket buffer is long full
+    int status = HttpGet(run.config.metrics_port, "/metrics", &text, 200);
+    if (status != 200) {
+        Fail("status of a large scrape", status, 200);
+    }
+    CheckExposition(text);
+    const char* last = "gateway_node_samples_total{node=\"node_49999\"}";
+    if (Value(text, last) != 1) {
+        Fail("samples of the last node", static_cast<long>(Value(text, last)), 1);
+    }
+    std::printf("scrape with %u nodes: %.1f MB, over twice wmem_max (%ld), read slowly and whole\n", kNodes,
+                text.size() / 1048576.0, wmem_max);
+}
+
+void BenchRecord()
+{
+    constexpr uint32_t kValues = 4096;
+    constexpr uint64_t kRounds = 200000000;
+    std::vector<uint64_t> values(kValues);
+    uint64_t state = 88172645463325252ull;
+    for (uint64_t& v : values) {
+        v = Next(state) >> (34 + Next(state) % 24);    // 10 ns to a few seconds
+    }
+    Histogram h;
+    double t0 = NowNs();
+    for (uint64_t i = 0; i < kRounds; i++) {
+        h.Record(values[i & (kValues - 1)]);
+    }
+    double record_ns = (NowNs() - t0) / kRounds;
+
+    // the same with a locked add, what a histogram shared by several writers pays
+    std::vector<std::atomic<uint64_t>> shared(Histogram::kBuckets);
+    std::atomic<uint64_t> shared_sum{0};
+    t0 = NowNs();
+    for (uint64_t i = 0; i < kRounds; i++) {
+        uint64_t v = values[i & (kValues - 1)];
+        shared[Histogram::Index(std::min(v, Histogram::kMax))].fetch_add(1, std::memory_order_relaxed);
+        shared_sum.fetch_add(v, std::memory_order_relaxed);
+    }
+    double locked_ns = (NowNs() - t0) / kRounds;
+
+    const uint32_t clock_rounds = 20000000;
+    uint64_t sink = 0;
+    t0 = NowNs();
+    for (uint32_t i = 0; i < clock_rounds; i++) {
+        sink ^= static_cast<uint64_t>(MonotonicNs());
+    }
+    double clock_ns = (NowNs() - t0) / clock_rounds;
+    HistogramCounts counts;
+    h.CollectInto(&counts);
+    if (counts.count != kRounds || sink == 0) {
+        Fail("samples", static_cast<long>(counts.count), static_cast<long>(kRounds));
+    }
+    std::printf("\nper sample: Record() %.2f ns, with locked adds %.2f ns; MonotonicNs() %.1f ns\n", record_ns,
+                locked_ns, clock_ns);
+    std::printf("parse time: 2 clock reads per chunk of 16 datagrams and one Record(), %.1f ns per datagram\n",
+                (2 * clock_ns + record_ns) / 16);
+    std::printf("latency: one clock read per write and per read of PUBACKs, one Record() per message\n");
+}
+
+void BenchScrape()
+{
+    constexpr uint32_t kNodes = 256;
+    Running run(0, kNodes);
+    for (uint32_t node = 0; node < kNodes; node++) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "temp=21.50,hum=40.00,id=node_%03u,seq=1", node);
+        run.Send(text);
+    }
+    std::string text;
+    if (!run.WaitFor("gateway_nodes", kNodes, &text)) {
+        Fail("nodes", static_cast<long>(Value(text, "gateway_nodes")), kNodes);
+    }
+    CheckExposition(text);
+    const int rounds = 200;
+    double t0 = NowNs();
+    for (int i = 0; i < rounds; i++) {
+        HttpGet(run.config.metrics_port, "/metrics", &text);
+    }
+    double scrape_us = (NowNs() - t0) / rounds / 1000;
+    std::printf("scrape with %u nodes: %zu bytes, %.0f us from connect to close\n", kNodes, text.size(), scrape_us);
+}
+
+}  // namespace
+
+int main()
+{
+    LogInit(LogLevel::kError);
+    VerifyBuckets();
+    VerifyQuantiles();
+    VerifyConcurrentRead();
+    VerifyEndpoint(0);
+    VerifyEndpoint(2);
+    VerifyLargeScrape();
+    BenchRecord();
+    BenchScrape();
+    return 0;
+}
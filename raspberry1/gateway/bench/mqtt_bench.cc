@@ -0,0 +1,617 @@
+/*
+ * Host benchmark of the MQTT client's QoS 1 window and queue policies (src/mqtt_client.h)
+ *
+ * A broker stand-in on its own thread answers over 127.0.0.1 and can hold every
+ * PUBACK for a while, like a broker behind a WAN link. Checked first, for windows of
+ * 1, 8 and 32:
+ *   - every message arrives once and in order, packet ids stay within the window and
+ *     none comes again before its PUBACK,
+ *   - the broker dropping the connection with messages unacknowledged: they come again
+ *     after the reconnect, in order and with DUP set, and nothing is lost,
+ *   - a window's worth of queued messages goes out in one write,
+ *   - a full queue keeps what its policy says: the newest or the oldest messages, or
+ *     the last value of every topic.
+ * Then samples of two fields, sent as two messages or combined into one, through
+ * windows of 1 to 64 with PUBACKs right away and 2 ms late: samples and messages per
+ * second, writes and broker round trips per sample. Last 50 nodes offer ten times what
+ * a broker with one message in flight takes, for every policy: what it delivered and
+ * dropped, the age of the values at the broker and the nodes whose values at the
+ * broker are all under a second old at the end.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/mqtt_bench [seconds per run]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <deque>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "io_backend.h"
+#include "log.h"
+#include "mqtt_client.h"
+#include "mqtt_codec.h"
+#include "udp_socket.h"
+
+using namespace gateway;
+
+namespace {
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+struct Received {
+    std::string topic;
+    uint64_t value;     // the payload's number
+    int64_t at_us;
+    bool dup;
+};
+
+// Acknowledges QoS 1 PUBLISHes ack_delay_us after they came, checks their packet ids
+// against the window and keeps the payloads in the order they arrived.
+class Broker {
+public:
+    Broker(uint32_t window, int64_t ack_delay_us, uint64_t drop_after, bool log = true)
+        : window_(window), ack_delay_us_(ack_delay_us), drop_after_(drop_after), log_(log)
+    {
+        listener_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener_, 4) < 0 ||
+            getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+            std::perror("broker");
+            std::exit(1);
+        }
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { Run(); });
+    }
+
+    ~Broker()
+    {
+        Stop();
+        close(listener_);
+    }
+
+    void Stop()
+    {
+        stop_ = true;
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    uint16_t port() const { return port_; }
+    // after Stop()
+    const std::vector<Received>& received() const { return received_; }
+    const char* violation() const { return violation_; }
+
+private:
+    void Run()
+    {
+        int client = -1;
+        std::vector<uint8_t> in(1 << 16);
+        size_t len = 0;
+        std::deque<std::pair<int64_t, uint16_t>> acks;     // due time in us, packet id
+        std::vector<uint8_t> outstanding(65536);
+        uint64_t publishes = 0;
+        bool dropped = false;
+        auto drop = [&]() {
+            close(client);
+            client = -1;
+            len = 0;
+            acks.clear();
+            std::fill(outstanding.begin(), outstanding.end(), 0);
+        };
+        while (!stop_) {
+            int64_t wait_us = 20000;
+            if (!acks.empty()) {
+                wait_us = std::max<int64_t>(acks.front().first - MonotonicUs(), 0);
+            }
+            timespec ts = { static_cast<time_t>(wait_us / 1000000), static_cast<long>(wait_us % 1000000 * 1000) };
+            pollfd fds[2] = { { listener_, POLLIN, 0 }, { client, POLLIN, 0 } };
+            ppoll(fds, client >= 0 ? 2 : 1, &ts, nullptr);
+            if (fds[0].revents & POLLIN) {
+                int fd = accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+                if (client >= 0) {
+                    drop();
+                }
+                client = fd;
+            }
+            uint8_t out[1 << 14];
+            size_t out_len = 0;
+            if (client >= 0 && (fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                ssize_t n = recv(client, in.data() + len, in.size() - len, MSG_DONTWAIT);
+                if (n <= 0) {
+                    drop();
+                    continue;
+                }
+                len += static_cast<size_t>(n);
+                size_t pos = 0;
+                mqtt::Packet p;
+                size_t used = 0;
+                while (client >= 0 && mqtt::DecodePacket(in.data() + pos, len - pos, p, &used) == mqtt::Decode::kOk) {
+                    pos += used;
+                    if (p.type == mqtt::kConnect) {
+                        static const uint8_t connack[] = { mqtt::kConnack << 4, 2, 0, 0 };
+                        std::memcpy(out + out_len, connack, sizeof(connack));
+                        out_len += sizeof(connack);
+                    } else if (p.type == mqtt::kPublish) {
+                        if (p.packet_id == 0 || p.packet_id > window_) {
+                            violation_ = "packet id outside the window";
+                        } else if (outstanding[p.packet_id]) {
+                            violation_ = "packet id again before its PUBACK";
+                        }
+                        outstanding[p.packet_id] = 1;
+                        if (log_) {
+                            char text[24] = {};
+                            std::memcpy(text, p.payload.data(), std::min(p.payload.size(), sizeof(text) - 1));
+                            received_.push_back({ std::string(p.topic), std::strtoull(text, nullptr, 10),
+                                                  MonotonicUs(), (p.flags & 8) != 0 });
+                        }
+                        acks.emplace_back(MonotonicUs() + ack_delay_us_, p.packet_id);
+                        if (++publishes == drop_after_ && !dropped) {
+                            dropped = true;
+                            drop();
+                        }
+                    } else if (p.type == mqtt::kPingreq) {
+                        out[out_len++] = mqtt::kPingresp << 4;
+                        out[out_len++] = 0;
+                    } else if (p.type == mqtt::kDisconnect) {
+                        drop();
+                    }
+                }
+                if (client >= 0) {
+                    std::memmove(in.data(), in.data() + pos, len - pos);
+                    len -= pos;
+                }
+            }
+            // every PUBACK that is due in one write, like a broker answering a burst
+            int64_t now = MonotonicUs();
+            while (client >= 0 && !acks.empty() && acks.front().first <= now && out_len + 4 <= sizeof(out)) {
+                outstanding[acks.front().second] = 0;
+                out_len += mqtt::EncodePuback(out + out_len, sizeof(out) - out_len, acks.front().second);
+                acks.pop_front();
+            }
+            if (client >= 0 && out_len) {
+                send(client, out, out_len, MSG_NOSIGNAL);
+            }
+        }
+        if (client >= 0) {
+            close(client);
+        }
+    }
+
+    uint32_t window_;
+    int64_t ack_delay_us_;
+    uint64_t drop_after_;       // closes the first connection after this many PUBLISHes, 0 never
+    bool log_;                  // keeps received(), not for the throughput runs
+    int listener_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::thread thread_;
+    std::vector<Received> received_;
+    const char* violation_ = nullptr;
+};
+
+struct Uplink : IoHandler {
+    explicit Uplink(MqttClient& m) : mqtt(m) {}
+
+    void OnDatagrams(int, const PacketBatch&) override {}
+    void OnReadable(int fd) override
+    {
+        if (fd == mqtt.fd()) {
+            mqtt.OnReadable(MonotonicMs());
+        }
+    }
+    void OnConnected(int fd, int result) override
+    {
+        if (fd == mqtt.fd()) {
+            mqtt.OnConnected(result, MonotonicMs());
+        }
+    }
+    void OnSent(int fd, int result) override
+    {
+        if (fd == mqtt.fd()) {
+            mqtt.OnSent(result, MonotonicMs());
+        }
+    }
+
+    MqttClient& mqtt;
+};
+
+// the client with its own backend, declared in the order they go away
+struct Session {
+    Session(uint16_t port, uint16_t window, QueuePolicy policy = QueuePolicy::kDropOldest,
+            uint32_t queue_size = 1 << 16)
+    {
+        std::string error;
+        io = IoBackend::Create(IoBackend::Kind::kAuto, &error);
+        if (!io) {
+            std::fprintf(stderr, "backend: %s\n", error.c_str());
+            std::exit(1);
+        }
+        MqttOptions o;
+        o.host = "127.0.0.1";
+        o.port = port;
+        o.client_id = "mqtt_bench";
+        o.queue_size = queue_size;
+        o.policy = policy;
+        o.max_inflight = window;
+        mqtt.reset(new MqttClient(o));
+        mqtt->SetIo(io.get());
+        uplink.reset(new Uplink(*mqtt));
+    }
+
+    ~Session() { mqtt->Disconnect(); }
+
+    void Step(int64_t max_wait_ms)
+    {
+        int64_t now = MonotonicMs();
+        io->Wait(static_cast<int>(std::min(mqtt->NextTimeoutMs(now), max_wait_ms)), *uplink);
+        mqtt->Process(MonotonicMs());
+    }
+
+    // runs until every queued message is acknowledged, false after timeout_ms
+    bool Drain(int64_t timeout_ms)
+    {
+        int64_t end = MonotonicMs() + timeout_ms;
+        while (mqtt->pending() > 0 || !mqtt->flushed()) {
+            if (MonotonicMs() > end) {
+                return false;
+            }
+            Step(10);
+        }
+        return true;
+    }
+
+    std::unique_ptr<IoBackend> io;
+    std::unique_ptr<MqttClient> mqtt;
+    std::unique_ptr<Uplink> uplink;
+};
+
+bool PublishValue(MqttClient& mqtt, uint32_t node, uint64_t value)
+{
+    char topic[32];
+    char text[24];
+    int topic_len = std::snprintf(topic, sizeof(topic), "bench/n%u/value", node);
+    int n = std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+    return mqtt.Publish(std::string_view(topic, topic_len), std::string_view(text, n));
+}
+
+void PublishIndexed(MqttClient& mqtt, uint32_t first, uint32_t count)
+{
+    for (uint32_t i = first; i < first + count; i++) {
+        PublishValue(mqtt, 1, i);
+    }
+}
+
+// the broker's log: each index once in order, or again with DUP after a reconnect
+void CheckOrder(const Broker& broker, uint32_t count, bool dups_allowed, const char* what)
+{
+    if (broker.violation()) {
+        std::fprintf(stderr, "MISMATCH: %s: %s\n", what, broker.violation());
+        std::exit(1);
+    }
+    uint32_t next = 0;
+    for (const Received& r : broker.received()) {
+        if (r.value == next) {
+            next++;
+        } else if (!(dups_allowed && r.dup && r.value < next)) {
+            Fail(what, static_cast<long>(r.value), next);
+        }
+    }
+    if (next != count) {
+        Fail(what, next, count);
+    }
+}
+
+void Verify()
+{
+    constexpr uint32_t kMessages = 5000;
+    for (uint16_t window : { 1, 8, 32 }) {
+        {
+            Broker broker(window, 200, 0);
+            Session s(broker.port(), window);
+            PublishIndexed(*s.mqtt, 0, kMessages);
+            if (!s.Drain(20000)) {
+                Fail("messages acknowledged", static_cast<long>(s.mqtt->stats().acked), kMessages);
+            }
+            s.mqtt->Disconnect();
+            broker.Stop();
+            CheckOrder(broker, kMessages, false, "in order");
+            if (broker.received().size() != kMessages || s.mqtt->stats().acked != kMessages) {
+                Fail("received once", static_cast<long>(broker.received().size()), kMessages);
+            }
+        }
+        {
+            // the broker hangs up in the middle, with the PUBACKs of a window pending
+            Broker broker(window, 200, kMessages / 3);
+            Session s(broker.port(), window);
+            PublishIndexed(*s.mqtt, 0, kMessages);
+            if (!s.Drain(30000)) {
+                Fail("acknowledged across a reconnect", static_cast<long>(s.mqtt->stats().acked), kMessages);
+            }
+            s.mqtt->Disconnect();
+            broker.Stop();
+            CheckOrder(broker, kMessages, true, "in order across a reconnect");
+            long dups = 0;
+            for (const Received& r : broker.received()) {
+                dups += r.dup;
+            }
+            const MqttStats& m = s.mqtt->stats();
+            if (m.connects != 2 || m.acked != kMessages || dups == 0 || dups > static_cast<long>(m.resent) ||
+                m.resent > window) {
+                Fail("resent with DUP", dups, static_cast<long>(m.resent));
+            }
+        }
+    }
+    {
+        // queued before the connection: CONNECT, then the whole window in one write
+        constexpr uint16_t kWindow = 64;
+        Broker broker(kWindow, 2000, 0);
+        Session s(broker.port(), kWindow);
+        PublishIndexed(*s.mqtt, 0, kWindow);
+        if (!s.Drain(5000)) {
+            Fail("window acknowledged", static_cast<long>(s.mqtt->stats().acked), kWindow);
+        }
+        if (s.io->stats().writes != 2 || s.mqtt->stats().round_trips > kWindow) {
+            Fail("writes for a window", static_cast<long>(s.io->stats().writes), 2);
+        }
+    }
+    std::printf("windows of 1, 8 and 32: %u messages once and in order, ids within the window, resent in "
+                "order with DUP after the broker hung up; 64 queued messages in one write\n", kMessages);
+}
+
+// A full queue of 64 with 200 more messages, queued before the connection and then
+// delivered: what each policy kept and counted.
+void VerifyPolicies()
+{
+    constexpr uint32_t kQueue = 64;
+    constexpr uint32_t kCount = 200;
+    for (QueuePolicy policy : { QueuePolicy::kDropOldest, QueuePolicy::kDropNewest }) {
+        bool newest = policy == QueuePolicy::kDropNewest;
+        Broker broker(16, 0, 0);
+        Session s(broker.port(), 16, policy, kQueue);
+        uint32_t refused = 0;
+        for (uint32_t i = 0; i < kCount; i++) {
+            refused += !PublishValue(*s.mqtt, 1, i);
+        }
+        const MqttStats& m = s.mqtt->stats();
+        if (s.mqtt->depth() != kQueue || m.max_depth != kQueue || m.dropped != kCount - kQueue ||
+            refused != (newest ? kCount - kQueue : 0)) {
+            Fail(newest ? "drop_newest dropped" : "drop_oldest dropped", static_cast<long>(m.dropped),
+                 kCount - kQueue);
+        }
+        if (!s.Drain(5000)) {
+            Fail("policy queue delivered", static_cast<long>(m.acked), kQueue);
+        }
+        s.mqtt->Disconnect();
+        broker.Stop();
+        // the first 64 or the last 64, in order
+        uint64_t expected = newest ? 0 : kCount - kQueue;
+        for (const Received& r : broker.received()) {
+            if (r.value != expected++) {
+                Fail(newest ? "drop_newest kept" : "drop_oldest kept", static_cast<long>(r.value),
+                     static_cast<long>(expected - 1));
+            }
+        }
+        if (expected != (newest ? kQueue : kCount)) {
+            Fail("policy messages delivered", static_cast<long>(broker.received().size()), kQueue);
+        }
+    }
+    {
+        // 16 nodes, 50 rounds: the queue holds the last round, one message per node
+        constexpr uint32_t kNodes = 16;
+        constexpr uint32_t kRounds = 50;
+        Broker broker(16, 0, 0);
+        Session s(broker.port(), 16, QueuePolicy::kLatest, kQueue);
+        for (uint32_t round = 0; round < kRounds; round++) {
+            for (uint32_t node = 0; node < kNodes; node++) {
+                PublishValue(*s.mqtt, node, round);
+            }
+        }
+        const MqttStats& m = s.mqtt->stats();
+        if (m.dropped != 0 || m.replaced != (kRounds - 1) * kNodes || s.mqtt->depth() != kNodes) {
+            Fail("latest replaced", static_cast<long>(m.replaced), (kRounds - 1) * kNodes);
+        }
+        if (!s.Drain(5000)) {
+            Fail("latest delivered", static_cast<long>(m.acked), kNodes);
+        }
+        s.mqtt->Disconnect();
+        broker.Stop();
+        uint32_t node = 0;
+        for (const Received& r : broker.received()) {
+            if (r.topic != "bench/n" + std::to_string(node++) + "/value" || r.value != kRounds - 1) {
+                Fail("latest kept", static_cast<long>(r.value), kRounds - 1);
+            }
+        }
+        if (node != kNodes) {
+            Fail("latest delivered", node, kNodes);
+        }
+    }
+    {
+        // more nodes than slots: nothing to overwrite, the oldest goes
+        Broker broker(16, 0, 0);
+        Session s(broker.port(), 16, QueuePolicy::kLatest, kQueue);
+        for (uint32_t node = 0; node < kCount; node++) {
+            PublishValue(*s.mqtt, node, 0);
+        }
+        PublishValue(*s.mqtt, kCount - 1, 1);
+        const MqttStats& m = s.mqtt->stats();
+        if (m.dropped != kCount - kQueue || m.replaced != 1 || s.mqtt->depth() != kQueue) {
+            Fail("latest without a match dropped", static_cast<long>(m.dropped), kCount - kQueue);
+        }
+    }
+    std::printf("full queue of %u: drop_oldest keeps the last, drop_newest the first, latest one per topic "
+                "with its last value and the oldest dropped when the topics outnumber the slots\n", kQueue);
+}
+
+struct Result {
+    double samples_per_s;
+    double messages_per_s;
+    double writes_per_sample;
+    double round_trips_per_sample;
+};
+
+Result Run(uint16_t window, int64_t ack_delay_us, bool combined, double seconds)
+{
+    Broker broker(window, ack_delay_us, 0, false);
+    Session s(broker.port(), window);
+    while (!s.mqtt->connected()) {
+        s.Step(10);
+    }
+    const uint32_t per_sample = combined ? 1 : 2;
+    // kept ahead of the window, like a gateway with samples coming in faster than they go out
+    const uint32_t backlog = 2u * window + 64;
+    const MqttStats& m = s.mqtt->stats();
+    uint64_t acked0 = m.acked, writes0 = s.io->stats().writes, round_trips0 = m.round_trips;
+    int64_t start = MonotonicUs();
+    int64_t end = start + static_cast<int64_t>(seconds * 1e6);
+    while (MonotonicUs() < end) {
+        while (s.mqtt->pending() < backlog) {
+            if (combined) {
+                s.mqtt->Publish("iot/pi/n1", "{\"airTemperature\":21.50,\"airHumidity\":45.20}");
+            } else {
+                s.mqtt->Publish("iot/pi/n1/airTemperature", "21.50");
+                s.mqtt->Publish("iot/pi/n1/airHumidity", "45.20");
+            }
+        }
+        s.Step(10);
+    }
+    double elapsed = (MonotonicUs() - start) / 1e6;
+    double messages = static_cast<double>(m.acked - acked0);
+    double samples = messages / per_sample;
+    Result r;
+    r.samples_per_s = samples / elapsed;
+    r.messages_per_s = messages / elapsed;
+    r.writes_per_sample = samples ? (s.io->stats().writes - writes0) / samples : 0;
+    r.round_trips_per_sample = samples ? (m.round_trips - round_trips0) / samples : 0;
+    return r;
+}
+
+struct SlowResult {
+    double offered_per_s;
+    double delivered_per_s;
+    uint64_t dropped;
+    uint64_t replaced;
+    uint32_t max_depth;
+    double age_p50_ms;          // of the values when they reached the broker
+    double age_p99_ms;
+    uint32_t fresh_nodes;       // whose newest value at the broker is under a second old at the end
+};
+
+// Samples of kNodes nodes at 2000 per second, two messages each, into a queue of 1024
+// towards a broker that takes about 450 per second (one in flight, PUBACK 2 ms late).
+SlowResult RunSlowBroker(QueuePolicy policy, double seconds)
+{
+    constexpr uint32_t kNodes = 50;
+    constexpr int64_t kSampleUs = 500;
+    Broker broker(1, 2000, 0);
+    Session s(broker.port(), 1, policy, 1024);
+    while (!s.mqtt->connected()) {
+        s.Step(10);
+    }
+    uint64_t samples = 0;
+    int64_t start = MonotonicUs();
+    int64_t end = start + static_cast<int64_t>(seconds * 1e6);
+    int64_t next = start;
+    for (int64_t now = start; now < end; now = MonotonicUs()) {
+        for (; next <= now; next += kSampleUs, samples++) {
+            // the value is when it was taken, two fields of one node
+            uint32_t node = static_cast<uint32_t>(samples % kNodes);
+            PublishValue(*s.mqtt, 2 * node, static_cast<uint64_t>(next));
+            PublishValue(*s.mqtt, 2 * node + 1, static_cast<uint64_t>(next));
+        }
+        s.Step(1);
+    }
+    s.mqtt->Disconnect();
+    broker.Stop();
+
+    const MqttStats& m = s.mqtt->stats();
+    std::vector<int64_t> ages;
+    std::vector<int64_t> newest(2 * kNodes, 0);
+    for (const Received& r : broker.received()) {
+        ages.push_back(r.at_us - static_cast<int64_t>(r.value));
+        uint32_t topic = static_cast<uint32_t>(std::strtoul(r.topic.c_str() + std::strlen("bench/n"), nullptr, 10));
+        newest[topic] = std::max(newest[topic], static_cast<int64_t>(r.value));
+    }
+    std::sort(ages.begin(), ages.end());
+    SlowResult r = {};
+    r.offered_per_s = 2.0 * samples / seconds;
+    r.delivered_per_s = broker.received().size() / seconds;
+    r.dropped = m.dropped;
+    r.replaced = m.replaced;
+    r.max_depth = m.max_depth;
+    r.age_p50_ms = ages.empty() ? 0 : ages[ages.size() / 2] / 1000.0;
+    r.age_p99_ms = ages.empty() ? 0 : ages[ages.size() * 99 / 100] / 1000.0;
+    for (uint32_t node = 0; node < kNodes; node++) {
+        r.fresh_nodes += end - std::min(newest[2 * node], newest[2 * node + 1]) < 1000000;
+    }
+    return r;
+}
+
+const char* PolicyName(QueuePolicy policy)
+{
+    return policy == QueuePolicy::kLatest        ? "latest"
+           : policy == QueuePolicy::kDropNewest ? "drop_newest"
+                                                : "drop_oldest";
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 1.0;
+    std::signal(SIGPIPE, SIG_IGN);
+    // the broker hanging up on purpose is no warning here
+    LogInit(LogLevel::kError);
+    Verify();
+    VerifyPolicies();
+
+    std::printf("\n%6s %9s %9s %12s %12s %14s %18s\n", "window", "ack ms", "fields", "samples/s", "messages/s",
+                "writes/sample", "round trips/sample");
+    for (int64_t delay_us : { 0, 2000 }) {
+        for (uint16_t window : { 1, 4, 16, 64 }) {
+            for (bool combined : { false, true }) {
+                Result r = Run(window, delay_us, combined, seconds);
+                std::printf("%6u %9.1f %9s %12.0f %12.0f %14.3f %18.3f\n", window, delay_us / 1000.0,
+                            combined ? "combined" : "apart", r.samples_per_s, r.messages_per_s,
+                            r.writes_per_sample, r.round_trips_per_sample);
+            }
+        }
+    }
+
+    std::printf("\nslow broker, 50 nodes offering 4000 messages/s, queue of 1024:\n%12s %11s %11s %9s %9s %9s "
+                "%11s %11s %11s\n", "policy", "offered/s", "delivered/s", "dropped", "replaced", "max depth",
+                "age p50 ms", "age p99 ms", "fresh nodes");
+    for (QueuePolicy policy : { QueuePolicy::kDropOldest, QueuePolicy::kDropNewest, QueuePolicy::kLatest }) {
+        SlowResult r = RunSlowBroker(policy, 3 * seconds);
+        std::printf("%12s %11.0f %11.0f %9llu %9llu %9u %11.1f %11.1f %8u/50\n", PolicyName(policy),
+                    r.offered_per_s, r.delivered_per_s, static_cast<unsigned long long>(r.dropped),
+                    static_cast<unsigned long long>(r.replaced), r.max_depth, r.age_p50_ms, r.age_p99_ms,
+                    r.fresh_nodes);
+    }
+    return 0;
+}
@@ -0,0 +1,171 @@
+/*
+ * Minimal MQTT 3.1.1 broker stand-in for benchmarks
+ *
+ * Accepts any CONNECT, acknowledges QoS 1 PUBLISHes, answers PINGREQ and counts the
+ * messages. Nothing is routed to subscribers. With --print every message is printed as
+ * "topic payload", to check what the gateway publishes.
+ *
+ * Usage:
+ *     mqtt_sink [--port 18830] [--print]
+ *
+ * Runs until SIGINT or SIGTERM, then prints
+ *     RESULT publishes=<n> connects=<n>
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <vector>
+
+#include "mqtt_codec.h"
+
+using namespace gateway;
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+
+void OnSignal(int)
+{
+    g_stop = 1;
+}
+
+struct Client {
+    int fd;
+    std::vector<uint8_t> in;
+    size_t len;
+};
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint16_t port = 18830;
+    bool print = false;
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "--port") == 0 && i + 1 < argc) {
+            port = static_cast<uint16_t>(std::atoi(argv[++i]));
+        } else if (std::strcmp(argv[i], "--print") == 0) {
+            print = true;
+        } else {
+            std::fprintf(stderr, "usage: %s [--port P] [--print]\n", argv[0]);
+            return 2;
+        }
+    }
+    struct sigaction sa = {};
+    sa.sa_handler = OnSignal;
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGTERM, &sa, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    int listener = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+    int on = 1;
+    setsockopt(listener, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on));
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    if (bind(listener, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener, 8) < 0) {
+        std::perror("mqtt_sink");
+        return 1;
+    }
+    std::fprintf(stderr, "MQTT sink on 127.0.0.1:%u\n", port);
+
+    std::vector<Client> clients;
+    uint64_t publishes = 0, connects = 0;
+    while (!g_stop) {
+        std::vector<pollfd> fds;
+        fds.push_back({listener, POLLIN, 0});
+        for (const Client& c : clients) {
+            fds.push_back({c.fd, POLLIN, 0});
+        }
+        if (poll(fds.data(), fds.size(), 200) <= 0) {
+            continue;
+        }
+        if (fds[0].revents & POLLIN) {
+            int fd = accept4(listener, nullptr, nullptr, SOCK_CLOEXEC);
+            if (fd >= 0) {
+                clients.push_back({fd, std::vector<uint8_t>(1 << 16), 0});
+            }
+        }
+        for (size_t i = 1; i < fds.size(); i++) {
+            if (!(fds[i].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            Client& c = clients[i - 1];
+            ssize_t n = recv(c.fd, c.in.data() + c.len, c.in.size() - c.len, 0);
+            if (n <= 0) {
+                close(c.fd);
+                c.fd = -1;
+                continue;
+            }
+            c.len += static_cast<size_t>(n);
+            uint8_t out[1 << 14];
+            size_t out_len = 0;
+            size_t pos = 0;
+            for (;;) {
+                mqtt::Packet p;
+                size_t used = 0;
+                mqtt::Decode d = mqtt::DecodePacket(c.in.data() + pos, c.len - pos, p, &used);
+                if (d != mqtt::Decode::kOk) {
+                    if (d == mqtt::Decode::kMalformed) {
+                        close(c.fd);
+                        c.fd = -1;
+                    }
+                    break;
+                }
+                pos += used;
+                if (out_len + 4 > sizeof(out)) {
+                    send(c.fd, out, out_len, MSG_NOSIGNAL);
+                    out_len = 0;
+                }
+                if (p.type == mqtt::kConnect) {
+                    static const uint8_t connack[] = { mqtt::kConnack << 4, 2, 0, 0 };
+                    std::memcpy(out + out_len, connack, sizeof(connack));
+                    out_len += sizeof(connack);
+                    connects++;
+                } else if (p.type == mqtt::kPublish) {
+                    publishes++;
+                    if (print) {
+                        std::printf("%.*s %.*s\n", static_cast<int>(p.topic.size()), p.topic.data(),
+                                    static_cast<int>(p.payload.size()), p.payload.data());
+                    }
+                    if ((p.flags >> 1 & 3) == 1) {
+                        out_len += mqtt::EncodePuback(out + out_len, sizeof(out) - out_len, p.packet_id);
+                    }
+                } else if (p.type == mqtt::kPingreq) {
+                    out[out_len++] = mqtt::kPingresp << 4;
+                    out[out_len++] = 0;
+                } else if (p.type == mqtt::kDisconnect) {
+                    close(c.fd);
+                    c.fd = -1;
+                    break;
+                }
+            }
+            if (c.fd >= 0 && out_len) {
+                send(c.fd, out, out_len, MSG_NOSIGNAL);
+            }
+            std::memmove(c.in.data(), c.in.data() + pos, c.len - pos);
+            c.len -= pos;
+        }
+        for (size_t i = 0; i < clients.size(); i++) {
+            if (clients[i].fd < 0) {
+                clients.erase(clients.begin() + static_cast<long>(i--));
+            }
+        }
+    }
+    if (print) {
+        std::fflush(stdout);
+    }
+    std::printf("RESULT publishes=%llu connects=%llu\n", static_cast<unsigned long long>(publishes),
+                static_cast<unsigned long long>(connects));
+    return 0;
+}
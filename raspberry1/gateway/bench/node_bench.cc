@@ -0,0 +1,386 @@
+/*
+ * Host benchmark of the node tables: NodeTable (src/node_table.h), the loop's state
+ * per node, and NodeStatsTable (src/node_stats.h), the statistics the rx workers keep
+ *
+ * Checked first: NodeTable against the linear table it replaced, a random mix of
+ * known, new and moving nodes on a small table that keeps evicting, slot for slot;
+ * NodeStatsTable's sequence accounting on a hand made sequence and a full table; then
+ * three threads updating while a fourth reads all the time, every copy it gets has to
+ * be one a writer left, and no sample may go missing, including those of nodes two
+ * writers share.
+ *
+ * Then, for 10 to 1M nodes, ns per lookup of a known node in random order (the linear
+ * table up to 10k), ns per NodeStatsTable update and find, ns per node for a walk over
+ * all of them, and bytes per node of both.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/node_bench [max nodes]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <memory>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "node_stats.h"
+#include "node_table.h"
+
+using namespace gateway;
+
+namespace {
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+double NowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+uint64_t g_rng = 0x9e3779b97f4a7c15ull;
+
+uint32_t Random(uint32_t n)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return static_cast<uint32_t>((g_rng >> 11) % n);
+}
+
+// the node table before the indexes, a linear scan
+namespace reference {
+
+class NodeTable {
+public:
+    explicit NodeTable(uint32_t capacity) : nodes_(capacity) {}
+
+    Node& Get(std::string_view id, const sockaddr_in& from, int64_t now_ms)
+    {
+        Node* slot = nullptr;
+        for (uint32_t i = 0; i < used_; i++) {
+            if (nodes_[i].Id() == id) {
+                slot = &nodes_[i];
+                break;
+            }
+        }
+        if (slot == nullptr) {
+            if (used_ < nodes_.size()) {
+                slot = &nodes_[used_++];
+            } else {
+                slot = &nodes_[0];
+                for (Node& n : nodes_) {
+                    slot = n.last_seen_ms < slot->last_seen_ms ? &n : slot;
+                }
+                evicted_++;
+            }
+            std::memset(slot->id, 0, sizeof(slot->id));
+            std::memcpy(slot->id, id.data(), id.size());
+            slot->id_len = static_cast<uint8_t>(id.size());
+        }
+        slot->addr = from;
+        slot->last_seen_ms = now_ms;
+        return *slot;
+    }
+
+    Node* FindByAddr(const sockaddr_in& from)
+    {
+        for (uint32_t i = 0; i < used_; i++) {
+            if (nodes_[i].addr.sin_addr.s_addr == from.sin_addr.s_addr && nodes_[i].addr.sin_port == from.sin_port) {
+                return &nodes_[i];
+            }
+        }
+        return nullptr;
+    }
+
+    const Node* data() const { return nodes_.data(); }
+    uint32_t size() const { return used_; }
+    uint64_t evicted() const { return evicted_; }
+
+private:
+    std::vector<Node> nodes_;
+    uint32_t used_ = 0;
+    uint64_t evicted_ = 0;
+};
+
+}  // namespace reference
+
+std::string NodeId(uint32_t i)
+{
+    return "node" + std::to_string(i);
+}
+
+sockaddr_in Addr(uint32_t i)
+{
+    sockaddr_in a = {};
+    a.sin_family = AF_INET;
+    a.sin_addr.s_addr = htonl(0x0a000000u | (i >> 8));
+    a.sin_port = htons(static_cast<uint16_t>(40000 + (i & 0xff)));
+    return a;
+}
+
+void VerifyNodeTable()
+{
+    constexpr uint32_t kCapacity = 64;
+    NodeTable table(kCapacity, 25, 50, 30);
+    reference::NodeTable model(kCapacity);
+    // node i sends from address i, one in eight datagrams from a new port
+    std::vector<uint32_t> addr_of(400);
+    for (uint32_t i = 0; i < addr_of.size(); i++) {
+        addr_of[i] = i;
+    }
+    uint32_t next_addr = 400;
+    for (int64_t now = 1; now <= 200000; now++) {
+        uint32_t node = Random(Random(4) == 0 ? 400 : 80);
+        if (Random(8) == 0) {
+            addr_of[node] = next_addr++;
+        }
+        std::string id = NodeId(node);
+        sockaddr_in from = Addr(addr_of[node]);
+        const Node& got = table.Get(id, from, now);
+        const Node& want = model.Get(id, from, now);
+        if (got.Id() != id || want.Id() != id || table.FindByAddr(from) != &got) {
+            Fail("NodeTable::Get, step", static_cast<long>(now), -1);
+        }
+        // who is still in and who was evicted, by the address of a random node or an old one
+        sockaddr_in other = Addr(Random(2) ? addr_of[Random(400)] : Random(next_addr));
+        const Node* a = table.FindByAddr(other);
+        const Node* b = model.FindByAddr(other);
+        if ((a == nullptr) != (b == nullptr) || (a && a->Id() != b->Id())) {
+            Fail("NodeTable::FindByAddr, step", static_cast<long>(now), -1);
+        }
+    }
+    if (table.size() != model.size() || table.evicted() != model.evicted()) {
+        Fail("NodeTable evictions", static_cast<long>(table.evicted()), static_cast<long>(model.evicted()));
+    }
+    std::printf("NodeTable matches the linear table: %llu evictions on %u slots, lookups by id and address\n",
+                static_cast<unsigned long long>(table.evicted()), kCapacity);
+}
+
+Record Sample(const std::string& id, uint32_t seq, double temp, double hum)
+{
+    Record r;
+    r.kind = RecordKind::kSample;
+    r.node_id = id;
+    r.has_seq = true;
+    r.seq = seq;
+    r.num_fields = 2;
+    r.fields[0] = Field{"temp", "", temp};
+    r.fields[1] = Field{"hum", "", hum};
+    return r;
+}
+
+void VerifyNodeStats()
+{
+    NodeStatsTable table(10);
+    std::string id = "n1";
+    NodeStats n;
+    struct Step {
+        uint32_t seq;
+        double temp;
+        uint8_t flags;
+        uint32_t last_seq;
+        uint32_t missing;
+    } steps[] = {
+        {0, 21.5, 0, 0, 0},    {1, 21.5, 0, 1, 0},        {2, 21.5, 0, 2, 0},          {5, 21.5, kNodeGap, 5, 2},
+        {5, 21.5, kNodeLate, 5, 2}, {3, 21.5, kNodeLate, 5, 2}, {6, 90.0, kNodeOutOfRange, 6, 2},
+        {1000, 21.5, kNodeGap, 1000, 995}, {10, 21.5, kNodeRestarted, 10, 995}, {11, 21.5, 0, 11, 995},
+    };
+    int64_t now = 0;
+    uint32_t samples = 0;
+    uint32_t last = 0;
+    for (const Step& s : steps) {
+        // one sequence number every 1000 ms, late and restarted ones come right after
+        now += s.last_seq > last ? (s.last_seq - last) * 1000 : 0;
+        last = s.last_seq;
+        table.Update(Sample(id, s.seq, s.temp, 45.25), now);
+        samples++;
+        if (!table.Find(id, &n) || n.flags != s.flags || n.last_seq != s.last_seq || n.missing != s.missing ||
+            n.samples != samples || n.last_seen_ms != now) {
+            Fail("NodeStatsTable after seq", s.seq, -1);
+        }
+    }
+    if (n.interval_ms != 1000 || n.temp != 2150 || n.hum != 4525 || n.Id() != id) {
+        Fail("NodeStatsTable interval_ms", n.interval_ms, 1000);
+    }
+    for (uint32_t i = 0; i < 12; i++) {
+        table.Update(Sample(NodeId(i), 0, 20, 50), 1);
+    }
+    uint32_t visited = 0;
+    table.ForEach([&](const NodeStats&) { visited++; });
+    if (table.size() != 10 || visited != 10 || table.untracked() != 3 || table.Find(NodeId(11), &n)) {
+        Fail("NodeStatsTable full, untracked", static_cast<long>(table.untracked()), 3);
+    }
+    std::printf("NodeStatsTable counts gaps, late and restarted sequences, ranges and intervals, stops at max_nodes\n");
+}
+
+void VerifyConcurrent()
+{
+    constexpr uint32_t kWriters = 3;
+    constexpr uint32_t kOwn = 1000;         // nodes of one writer
+    constexpr uint32_t kShared = 100;       // nodes all writers update, no sequence numbers
+    constexpr uint32_t kRounds = 100;
+    NodeStatsTable table(kWriters * kOwn + kShared);
+    std::atomic<bool> done{false};
+    std::atomic<uint64_t> copies{0};
+    std::thread reader([&] {
+        uint64_t n = 0;
+        while (!done.load(std::memory_order_relaxed)) {
+            table.ForEach([&](const NodeStats& s) {
+                // a writer of its own node leaves temp = hum = last_seq and samples = last_seq + 1
+                if (s.Id().substr(0, 3) == "own" &&
+                    (s.temp != s.hum || s.temp != static_cast<int32_t>(s.last_seq) || s.samples != s.last_seq + 1)) {
+                    Fail("torn copy of node, samples", s.samples, static_cast<long>(s.last_seq) + 1);
+                }
+                n++;
+            });
+        }
+        copies = n;
+    });
+    std::vector<std::thread> writers;
+    for (uint32_t w = 0; w < kWriters; w++) {
+        writers.emplace_back([&, w] {
+            std::vector<std::string> own, shared;
+            for (uint32_t i = 0; i < kOwn; i++) {
+                own.push_back("own" + std::to_string(w * kOwn + i));
+            }
+            for (uint32_t i = 0; i < kShared; i++) {
+                shared.push_back("shared" + std::to_string(i));
+            }
+            for (uint32_t seq = 0; seq < kRounds; seq++) {
+                for (const std::string& id : own) {
+                    table.Update(Sample(id, seq, seq / 100.0, seq / 100.0), seq);
+                }
+                for (const std::string& id : shared) {
+                    Record r = Sample(id, 0, 20, 50);
+                    r.has_seq = false;
+                    table.Update(r, seq);
+                }
+            }
+        });
+    }
+    for (std::thread& t : writers) {
+        t.join();
+    }
+    done = true;
+    reader.join();
+    uint64_t samples = 0;
+    uint32_t nodes = 0;
+    table.ForEach([&](const NodeStats& s) {
+        samples += s.samples;
+        nodes++;
+    });
+    uint64_t expected = static_cast<uint64_t>(kWriters) * (kOwn + kShared) * kRounds;
+    if (nodes != kWriters * kOwn + kShared || samples != expected || table.untracked() != 0) {
+        Fail("concurrent samples", static_cast<long>(samples), static_cast<long>(expected));
+    }
+    std::printf("NodeStatsTable with %u writers and a reader: %llu samples, none lost, %llu consistent copies read\n",
+                kWriters, static_cast<unsigned long long>(samples), static_cast<unsigned long long>(copies.load()));
+}
+
+void Bench(uint32_t max_nodes)
+{
+    std::printf("\n%9s %12s %12s %12s %12s %12s %10s %10s\n", "nodes", "linear ns", "lookup ns", "update ns",
+                "find ns", "walk ns/node", "table B/n", "stats B/n");
+    for (uint32_t nodes = 10; nodes <= max_nodes; nodes *= 10) {
+        const uint32_t ops = 2000000;
+        std::vector<std::string> ids(nodes);
+        std::vector<uint32_t> seqs(nodes);
+        for (uint32_t i = 0; i < nodes; i++) {
+            ids[i] = NodeId(i);
+        }
+        // random order, the same for every table
+        std::vector<uint32_t> order(ops);
+        for (uint32_t& o : order) {
+            o = Random(nodes);
+        }
+
+        double linear = -1;
+        if (nodes <= 10000) {
+            auto model = std::make_unique<reference::NodeTable>(nodes);
+            for (uint32_t i = 0; i < nodes; i++) {
+                model->Get(ids[i], Addr(i), 0);
+            }
+            uint32_t n = nodes <= 1000 ? ops : ops / 20;
+            double t0 = NowNs();
+            for (uint32_t i = 0; i < n; i++) {
+                model->Get(ids[order[i]], Addr(order[i]), i);
+            }
+            linear = (NowNs() - t0) / n;
+        }
+
+        auto table = std::make_unique<NodeTable>(nodes, 25, 50, 30);
+        for (uint32_t i = 0; i < nodes; i++) {
+            table->Get(ids[i], Addr(i), 0);
+        }
+        double t0 = NowNs();
+        for (uint32_t i = 0; i < ops; i++) {
+            table->Get(ids[order[i]], Addr(order[i]), i);
+        }
+        double lookup = (NowNs() - t0) / ops;
+        if (table->size() != nodes || table->evicted() != 0) {
+            Fail("NodeTable nodes", table->size(), nodes);
+        }
+
+        // one record, as a receive slot holds one datagram's
+        Record r = Sample(ids[0], 0, 21.5, 45.0);
+        auto stats = std::make_unique<NodeStatsTable>(nodes);
+        for (uint32_t i = 0; i < nodes; i++) {
+            r.node_id = ids[i];
+            stats->Update(r, 0);
+        }
+        t0 = NowNs();
+        for (uint32_t i = 0; i < ops; i++) {
+            r.node_id = ids[order[i]];
+            r.seq = ++seqs[order[i]];
+            stats->Update(r, i);
+        }
+        double update = (NowNs() - t0) / ops;
+        NodeStats copy;
+        uint64_t found = 0;
+        t0 = NowNs();
+        for (uint32_t i = 0; i < ops; i++) {
+            found += stats->Find(ids[order[i]], &copy);
+        }
+        double find = (NowNs() - t0) / ops;
+        uint64_t samples = 0;
+        t0 = NowNs();
+        stats->ForEach([&](const NodeStats& s) { samples += s.samples; });
+        double walk = (NowNs() - t0) / nodes;
+        if (found != ops || samples != static_cast<uint64_t>(nodes) + ops || stats->size() != nodes) {
+            Fail("NodeStatsTable samples", static_cast<long>(samples), static_cast<long>(nodes) + ops);
+        }
+
+        char linear_text[16] = "-";
+        if (linear >= 0) {
+            std::snprintf(linear_text, sizeof(linear_text), "%.1f", linear);
+        }
+        std::printf("%9u %12s %12.1f %12.1f %12.1f %12.2f %10.0f %10.0f\n", nodes, linear_text, lookup, update, find,
+                    walk, static_cast<double>(table->bytes()) / nodes, static_cast<double>(stats->bytes()) / nodes);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint32_t max_nodes = argc > 1 ? static_cast<uint32_t>(std::strtoul(argv[1], nullptr, 10)) : 1000000;
+    VerifyNodeTable();
+    VerifyNodeStats();
+    VerifyConcurrent();
+    Bench(max_nodes);
+    return 0;
+}
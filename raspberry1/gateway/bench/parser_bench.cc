@@ -0,0 +1,455 @@
+/*
+ * Host benchmark of the datagram parser (src/parser.h), SIMD delimiter scan against
+ * the scalar find() parser it replaced
+ *
+ * Checked first, a differential fuzz: valid node datagrams in random key order with
+ * unknown keys, the same with bytes flipped, inserted, dropped or cut off, #PROBE lines
+ * mutated the same way, and random bytes, each parsed by ParseDatagram() and by the
+ * scalar reference below. Both have to agree on valid or not and on every field, and
+ * every view has to point into the datagram. Each input ends right at the end of a page
+ * followed by an inaccessible one, so a load past the datagram faults.
+ *
+ * Then ns per record on three sets: the node's own datagrams, longer ones with unknown
+ * keys as newer firmware sends, and #PROBE lines; for the reference, ParseDatagram()
+ * one by one from a small array, and ParseDatagrams() over batches of 64 from slots
+ * 1536 bytes apart like the receive path's PacketSlots.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/parser_bench [fuzz iterations] [seed]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <sys/mman.h>
+#include <unistd.h>
+
+#include <charconv>
+#include <chrono>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <string>
+#include <vector>
+
+#include "parser.h"
+#include "udp_ingest.h"
+
+using namespace gateway;
+
+namespace {
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+double NowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// the parser before the SIMD scan, one find() per delimiter
+namespace reference {
+
+constexpr std::string_view kProbePrefix = "#PROBE,";
+
+bool IsKeyChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool ParseNumber(std::string_view text, double& out)
+{
+    if (text.empty()) {
+        return false;
+    }
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+std::string_view TrimEnd(std::string_view text)
+{
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r' || text.back() == ' ' || text.back() == '\0')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool ParseProbe(std::string_view text, Record& out)
+{
+    text.remove_prefix(kProbePrefix.size());
+    for (const std::string_view& name : kProbeFields) {
+        size_t comma = text.find(',');
+        std::string_view value = text.substr(0, comma);
+        Field& f = out.fields[out.num_fields];
+        if (!ParseNumber(value, f.value)) {
+            return false;
+        }
+        f.key = name;
+        f.text = value;
+        out.num_fields++;
+        text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+    }
+    if (!text.empty()) {
+        return false;
+    }
+    out.kind = RecordKind::kProbe;
+    return true;
+}
+
+bool ParseSample(std::string_view text, Record& out)
+{
+    while (!text.empty()) {
+        size_t comma = text.find(',');
+        std::string_view pair = text.substr(0, comma);
+        text = comma == std::string_view::npos ? std::string_view() : text.substr(comma + 1);
+
+        size_t eq = pair.find('=');
+        if (eq == 0 || eq == std::string_view::npos) {
+            return false;
+        }
+        std::string_view key = pair.substr(0, eq);
+        std::string_view value = pair.substr(eq + 1);
+        for (char c : key) {
+            if (!IsKeyChar(c)) {
+                return false;
+            }
+        }
+        if (key == "id") {
+            if (value.empty() || value.size() >= kNodeIdMax) {
+                return false;
+            }
+            for (char c : value) {
+                if (!IsKeyChar(c)) {
+                    return false;
+                }
+            }
+            out.node_id = value;
+        } else if (key == "seq") {
+            uint32_t seq = 0;
+            auto [end, ec] = std::from_chars(value.data(), value.data() + value.size(), seq);
+            if (ec != std::errc() || end != value.data() + value.size()) {
+                return false;
+            }
+            out.seq = seq;
+            out.has_seq = true;
+        } else {
+            double number;
+            if (!ParseNumber(value, number)) {
+                continue;
+            }
+            if (out.num_fields == kMaxFields) {
+                return false;
+            }
+            out.fields[out.num_fields++] = Field{key, value, number};
+        }
+    }
+    if (out.node_id.empty() || out.num_fields == 0) {
+        return false;
+    }
+    out.kind = RecordKind::kSample;
+    return true;
+}
+
+bool ParseDatagram(std::string_view text, Record& out)
+{
+    out.kind = RecordKind::kInvalid;
+    out.node_id = {};
+    out.has_seq = false;
+    out.seq = 0;
+    out.num_fields = 0;
+    text = TrimEnd(text);
+    bool ok = text.substr(0, kProbePrefix.size()) == kProbePrefix ? ParseProbe(text, out) : ParseSample(text, out);
+    if (!ok) {
+        out.kind = RecordKind::kInvalid;
+    }
+    return ok;
+}
+
+}  // namespace reference
+
+uint64_t g_rng = 0x9e3779b97f4a7c15ull;
+
+uint32_t Random(uint32_t n)
+{
+    g_rng ^= g_rng << 13;
+    g_rng ^= g_rng >> 7;
+    g_rng ^= g_rng << 17;
+    return static_cast<uint32_t>((g_rng >> 11) % n);
+}
+
+std::string Number()
+{
+    static const char* forms[] = { "%.2f", "%.0f", "%g", "%.3e", "%.1f" };
+    char buf[32];
+    double v = (static_cast<int>(Random(200000)) - 100000) / 100.0;
+    int n = std::snprintf(buf, sizeof(buf), forms[Random(5)], v);
+    return std::string(buf, n);
+}
+
+// a node datagram in random key order, sometimes with unknown keys and a trailing newline
+std::string ValidSample()
+{
+    std::vector<std::string> pairs = { "temp=" + Number(), "hum=" + Number(), "id=n" + std::to_string(Random(1000)) };
+    if (Random(2)) {
+        pairs.push_back("seq=" + std::to_string(Random(1u << 31)));
+    }
+    static const char* unknown[] = { "co2", "tvoc", "aqi", "rssi", "fw", "vbat", "p_hpa" };
+    for (uint32_t i = Random(4); i > 0; i--) {
+        const char* key = unknown[Random(7)];
+        pairs.push_back(std::string(key) + "=" + (Random(4) ? Number() : std::string("v1.2.5")));
+    }
+    for (size_t i = pairs.size() - 1; i > 0; i--) {
+        std::swap(pairs[i], pairs[Random(static_cast<uint32_t>(i + 1))]);
+    }
+    std::string s;
+    for (const std::string& p : pairs) {
+        s += (s.empty() ? "" : ",") + p;
+    }
+    return Random(8) == 0 ? s + "\n" : s;
+}
+
+std::string ValidProbe()
+{
+    std::string s = "#PROBE";
+    for (int i = 0; i < 14; i++) {
+        s += "," + std::to_string(Random(100000));
+    }
+    return s;
+}
+
+void Mutate(std::string& s)
+{
+    static const char alphabet[] = ",=,=0123456789.-eEid_qs \n#PROBE\0\xff";
+    for (uint32_t i = 1 + Random(3); i > 0; i--) {
+        uint32_t at = s.empty() ? 0 : Random(static_cast<uint32_t>(s.size()));
+        char c = alphabet[Random(sizeof(alphabet) - 1)];
+        switch (Random(4)) {
+        case 0:
+            if (!s.empty()) {
+                s[at] = c;
+            }
+            break;
+        case 1:
+            s.insert(s.begin() + at, c);
+            break;
+        case 2:
+            if (!s.empty()) {
+                s.erase(at, 1);
+            }
+            break;
+        default:
+            s.resize(at);
+            break;
+        }
+    }
+}
+
+std::string RandomBytes()
+{
+    static const char alphabet[] = "temphumidseq=,0123456789.-#PROBE";
+    std::string s(Random(Random(8) == 0 ? 1500 : 80), '\0');
+    bool any = Random(4) == 0;
+    for (char& c : s) {
+        c = any ? static_cast<char>(Random(256)) : alphabet[Random(sizeof(alphabet) - 1)];
+    }
+    return s;
+}
+
+bool Inside(std::string_view view, std::string_view text)
+{
+    return view.data() >= text.data() && view.data() + view.size() <= text.data() + text.size();
+}
+
+void Compare(std::string_view text, const Record& got, bool got_ok, const Record& want, bool want_ok, uint64_t i)
+{
+    auto fail = [&](const char* what) {
+        std::fprintf(stderr, "MISMATCH: %s at input %llu \"%.*s\"\n", what, static_cast<unsigned long long>(i),
+                     static_cast<int>(text.size()), text.data());
+        std::exit(1);
+    };
+    if (got_ok != want_ok || got.kind != want.kind) {
+        fail("valid");
+    }
+    if (!got_ok) {
+        return;
+    }
+    if (got.node_id != want.node_id || got.has_seq != want.has_seq || got.seq != want.seq ||
+        got.num_fields != want.num_fields) {
+        fail("record");
+    }
+    if (!got.node_id.empty() && !Inside(got.node_id, text)) {
+        fail("id view outside the datagram");
+    }
+    for (uint32_t f = 0; f < got.num_fields; f++) {
+        const Field& a = got.fields[f];
+        const Field& b = want.fields[f];
+        if (a.key != b.key || a.text != b.text || std::memcmp(&a.value, &b.value, sizeof(a.value)) != 0) {
+            fail("field");
+        }
+        if (!Inside(a.text, text) || (got.kind == RecordKind::kSample && !Inside(a.key, text))) {
+            fail("field view outside the datagram");
+        }
+    }
+}
+
+void Fuzz(uint64_t iterations)
+{
+    // two pages, the second inaccessible: every input ends where the first one does
+    long page = sysconf(_SC_PAGESIZE);
+    char* pages = static_cast<char*>(mmap(nullptr, 2 * page, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0));
+    if (pages == MAP_FAILED || mprotect(pages + page, page, PROT_NONE) != 0) {
+        std::perror("guard page");
+        std::exit(1);
+    }
+    uint64_t valid = 0, probes = 0;
+    for (uint64_t i = 0; i < iterations; i++) {
+        std::string s;
+        switch (Random(6)) {
+        case 0:
+        case 1:
+            s = ValidSample();
+            break;
+        case 2:
+            s = ValidSample();
+            Mutate(s);
+            break;
+        case 3:
+            s = ValidProbe();
+            if (Random(2)) {
+                Mutate(s);
+            }
+            break;
+        case 4:
+            s = RandomBytes();
+            break;
+        default:
+            s = ValidSample();
+            s += Random(2) ? "," : ",,";
+            s += Random(2) ? ValidSample() : std::string("=");
+            break;
+        }
+        char* at = pages + page - s.size();
+        std::memcpy(at, s.data(), s.size());
+        std::string_view text(at, s.size());
+        Record got, want;
+        bool got_ok = ParseDatagram(text, got);
+        bool want_ok = reference::ParseDatagram(text, want);
+        Compare(text, got, got_ok, want, want_ok, i);
+        valid += got_ok;
+        probes += got_ok && got.kind == RecordKind::kProbe;
+    }
+    munmap(pages, 2 * page);
+    if (valid == 0 || valid == iterations || probes == 0) {
+        Fail("fuzz mix, valid records", static_cast<long>(valid), -1);
+    }
+    std::printf("fuzz: %llu inputs, %llu valid (%llu #PROBE), parser and reference agree on every one\n",
+                static_cast<unsigned long long>(iterations), static_cast<unsigned long long>(valid),
+                static_cast<unsigned long long>(probes));
+}
+
+struct Timing {
+    double reference_ns;
+    double single_ns;
+    double batch_ns;
+};
+
+Timing Time(const std::vector<std::string>& set)
+{
+    constexpr uint32_t kBatch = 64;
+    const int rounds = 4000000;
+    // the datagrams in receive slots, as the ingest stage leaves them
+    std::vector<PacketSlot> slots(set.size());
+    std::vector<std::string_view> texts(set.size());
+    for (size_t i = 0; i < set.size(); i++) {
+        std::memcpy(slots[i].data, set[i].data(), set[i].size());
+        texts[i] = std::string_view(slots[i].data, set[i].size());
+    }
+    uint32_t mask = static_cast<uint32_t>(set.size() - 1);
+    Timing t;
+    Record r;
+    uint64_t fields = 0;
+    double t0 = NowNs();
+    for (int i = 0; i < rounds; i++) {
+        reference::ParseDatagram(texts[i & mask], r);
+        fields += r.num_fields;
+    }
+    t.reference_ns = (NowNs() - t0) / rounds;
+    uint64_t expected = fields;
+
+    fields = 0;
+    t0 = NowNs();
+    for (int i = 0; i < rounds; i++) {
+        ParseDatagram(texts[i & mask], r);
+        fields += r.num_fields;
+    }
+    t.single_ns = (NowNs() - t0) / rounds;
+    if (fields != expected) {
+        Fail("fields, ParseDatagram", static_cast<long>(fields), static_cast<long>(expected));
+    }
+
+    std::vector<Record> records(kBatch);
+    Record* out[kBatch];
+    for (uint32_t i = 0; i < kBatch; i++) {
+        out[i] = &records[i];
+    }
+    fields = 0;
+    t0 = NowNs();
+    for (int i = 0; i < rounds; i += kBatch) {
+        ParseDatagrams(kBatch, &texts[i & mask], out);
+        for (const Record& rec : records) {
+            fields += rec.num_fields;
+        }
+    }
+    t.batch_ns = (NowNs() - t0) / rounds;
+    if (fields != expected) {
+        Fail("fields, ParseDatagrams", static_cast<long>(fields), static_cast<long>(expected));
+    }
+    return t;
+}
+
+void Bench()
+{
+    // power of two sets, a multiple of the batch
+    constexpr size_t kSet = 4096;
+    std::vector<std::string> node, longer, probe;
+    char buf[256];
+    for (size_t i = 0; i < kSet; i++) {
+        int n = std::snprintf(buf, sizeof(buf), "temp=%.2f,hum=%.2f,id=n%zu,seq=%zu", 20 + (i % 500) / 100.0,
+                              45 + (i % 900) / 100.0, i % 8, i / 8);
+        node.emplace_back(buf, n);
+        n = std::snprintf(buf, sizeof(buf),
+                          "fw=v1.2.5,id=node%zu,rssi=-%zu,temp=%.2f,hum=%.2f,co2=%zu,tvoc=%zu,aqi=%zu,vbat=%.3f,seq=%zu",
+                          i % 8, 40 + i % 50, 20 + (i % 500) / 100.0, 45 + (i % 900) / 100.0, 400 + i % 800, i % 300,
+                          1 + i % 5, 3.3 + (i % 90) / 100.0, i / 8);
+        longer.emplace_back(buf, n);
+        n = std::snprintf(buf, sizeof(buf), "#PROBE,%zu,%zu,%zu,0,0,%zu,1800,2500,4100,9000,12000,2700,400,5000",
+                          200 + i, 190 + i, 10 + i % 7, (10 + i % 7) * 1000 / (200 + i));
+        probe.emplace_back(buf, n);
+    }
+    std::printf("\n%-28s %12s %12s %12s\n", "ns per record", "reference", "single", "batch of 64");
+    struct {
+        const char* name;
+        const std::vector<std::string>* set;
+    } sets[] = { {"node format (~37 bytes)", &node}, {"unknown keys (~115 bytes)", &longer},
+                 {"#PROBE lines (~70 bytes)", &probe} };
+    for (auto& s : sets) {
+        Timing t = Time(*s.set);
+        std::printf("%-28s %12.1f %12.1f %12.1f\n", s.name, t.reference_ns, t.single_ns, t.batch_ns);
+    }
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    uint64_t iterations = argc > 1 ? std::strtoull(argv[1], nullptr, 10) : 1000000;
+    if (argc > 2) {
+        g_rng = std::strtoull(argv[2], nullptr, 10) | 1;
+    }
+    Fuzz(iterations);
+    Bench();
+    return 0;
+}
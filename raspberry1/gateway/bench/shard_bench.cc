@@ -0,0 +1,424 @@
+/*
+ * Host benchmark of the receive workers (src/rx_workers.h) and the node id steering
+ * program (src/reuseport_bpf.h)
+ *
+ * Checked first over 127.0.0.1: with the program attached to a group of 1 to 4
+ * SO_REUSEPORT sockets every datagram with an id lands on the socket
+ * NodeSteeringIndex() names, from whichever source port it comes, and datagrams
+ * without one are spread by the kernel's hash, not all put on socket 0. Then three
+ * steered workers take node datagrams sent from 16 source ports at random: every
+ * node's datagrams come out of one worker, the one its id names, all of them, parsed
+ * and in the order sent; a publisher that sleeps is always woken for new records.
+ *
+ * Then the scaling: sender threads send as fast as they can from many source ports,
+ * 1 to 4 workers (pinned, node steering) receive and parse, the publisher side counts
+ * and checks the per-node order. Reported are the datagrams per second that reach the
+ * publisher, what was lost on the way and the CPU of workers and publisher per
+ * datagram. Senders and workers share the host's cores, the senders pinned to the last
+ * ones so a node's datagrams leave in order. On a Raspberry Pi 4 (four Cortex-A72
+ * cores) run it as it is; on fewer cores workers share them and nothing can scale.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/shard_bench [seconds per run] [senders]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <pthread.h>
+#include <sched.h>
+#include <sys/resource.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <atomic>
+#include <charconv>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <ctime>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "reuseport_bpf.h"
+#include "rx_workers.h"
+#include "udp_socket.h"
+
+using namespace gateway;
+
+namespace {
+
+constexpr uint32_t kSources = 16;       // source ports a sender spreads its datagrams over
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+int64_t CpuUs(int who)
+{
+    rusage ru;
+    getrusage(who, &ru);
+    return (ru.ru_utime.tv_sec + ru.ru_stime.tv_sec) * 1000000LL + ru.ru_utime.tv_usec + ru.ru_stime.tv_usec;
+}
+
+std::vector<int> Cpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    sched_getaffinity(0, sizeof(set), &set);
+    for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+        if (CPU_ISSET(cpu, &set)) {
+            cpus.push_back(cpu);
+        }
+    }
+    return cpus;
+}
+
+void PinToCpu(int cpu)
+{
+    cpu_set_t set;
+    CPU_ZERO(&set);
+    CPU_SET(cpu, &set);
+    pthread_setaffinity_np(pthread_self(), sizeof(set), &set);
+}
+
+sockaddr_in Loopback(uint16_t port)
+{
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(port);
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    return addr;
+}
+
+std::vector<int> Sources()
+{
+    std::vector<int> fds;
+    for (uint32_t i = 0; i < kSources; i++) {
+        fds.push_back(socket(AF_INET, SOCK_DGRAM | SOCK_CLOEXEC, 0));
+    }
+    return fds;
+}
+
+// the node datagram of node `node` with sequence number seq, keys in one of three orders
+int Datagram(char* buf, size_t size, const char* prefix, uint32_t node, uint32_t seq)
+{
+    switch (node % 3) {
+    case 0:
+        return std::snprintf(buf, size, "temp=%.2f,hum=%.2f,id=%s%u,seq=%u", 20 + seq % 500 / 100.0,
+                             45 + seq % 900 / 100.0, prefix, node, seq);
+    case 1:
+        return std::snprintf(buf, size, "id=%s%u,seq=%u,temp=%.2f,hum=%.2f", prefix, node, seq,
+                             20 + seq % 500 / 100.0, 45 + seq % 900 / 100.0);
+    default:
+        return std::snprintf(buf, size, "co2=612,seq=%u,hum=%.2f,id=%s%u,temp=%.2f", seq,
+                             45 + seq % 900 / 100.0, prefix, node, 20 + seq % 500 / 100.0);
+    }
+}
+
+// one datagram to a steered group, then every socket of the group read
+void VerifySteering()
+{
+    for (uint32_t sockets = 1; sockets <= 4; sockets++) {
+        std::vector<int> group;
+        group.push_back(OpenUdp("127.0.0.1", 0, 0, true));
+        sockaddr_in addr;
+        socklen_t len = sizeof(addr);
+        getsockname(group[0], reinterpret_cast<sockaddr*>(&addr), &len);
+        for (uint32_t i = 1; i < sockets; i++) {
+            group.push_back(OpenUdp("127.0.0.1", ntohs(addr.sin_port), 0, true));
+        }
+        if (!AttachNodeSteering(group[0], sockets)) {
+            std::perror("SO_ATTACH_REUSEPORT_CBPF");
+            std::exit(1);
+        }
+        std::vector<int> sources = Sources();
+        std::string far = std::string(kSteerScan, 'x') + ",id=far";
+        uint32_t unsteered_on[4] = {0, 0, 0, 0};
+        uint32_t steered = 0;
+        for (uint32_t i = 0; i < 400; i++) {
+            char buf[256];
+            int n = Datagram(buf, sizeof(buf), "n", i % 50, i);
+            std::string_view d(buf, n);
+            if (i % 8 == 3) {
+                d = "#PROBE,1,1,0,0,0,0,1,1,1,1,1,1,0,1";
+            } else if (i % 8 == 5) {
+                d = i % 16 == 5 ? std::string_view("x") : std::string_view(far);
+            } else if (i % 8 == 7) {
+                d = "pid=1,id=";     // "id=" only as the end of another key, an empty id at the end
+            }
+            int want = NodeSteeringIndex(d, sockets);
+            sendto(sources[(i * 7) % kSources], d.data(), d.size(), 0, reinterpret_cast<sockaddr*>(&addr),
+                   sizeof(addr));
+            int got = -1;
+            for (int tries = 0; got < 0 && tries < 1000; tries++) {
+                for (uint32_t s = 0; s < sockets; s++) {
+                    if (recv(group[s], buf, sizeof(buf), MSG_DONTWAIT) >= 0) {
+                        got = static_cast<int>(s);
+                    }
+                }
+                if (got < 0) {
+                    usleep(10);
+                }
+            }
+            if (got < 0) {
+                Fail("steering: datagram lost", i, 0);
+            }
+            if (want >= 0 && got != want) {
+                Fail("steering: socket of a node datagram", got, want);
+            }
+            steered += want >= 0;
+            unsteered_on[got] += want < 0;
+        }
+        if (sockets == 4 && unsteered_on[1] + unsteered_on[2] + unsteered_on[3] == 0) {
+            Fail("steering: datagrams without an id all on socket", 0, -1);
+        }
+        for (int fd : sources) {
+            close(fd);
+        }
+        for (int fd : group) {
+            close(fd);
+        }
+        std::printf("%u sockets: %u node datagrams on the socket of their id, %u without id on the kernel's hash\n",
+                    sockets, steered, 400 - steered);
+    }
+}
+
+// Publisher side of a run: drains the rings, sleeps on the wakeup fd like the gateway's
+// loop, and checks every node's sequence numbers only ever go up.
+struct Publisher {
+    RxWorkers& rx;
+    std::vector<int64_t> last_seq;      // per node, -1 before its first record
+    std::vector<int> worker_of;
+    uint64_t received = 0;
+    uint64_t reordered = 0;
+    uint64_t missed_wakeups = 0;
+
+    Publisher(RxWorkers& workers, uint32_t nodes) : rx(workers), last_seq(nodes, -1), worker_of(nodes, -1) {}
+
+    void Handle(const RxItem& item)
+    {
+        received++;
+        const Record& r = item.record;
+        // ids are a letter and a number
+        uint32_t node = UINT32_MAX;
+        if (r.node_id.size() >= 2) {
+            std::from_chars(r.node_id.data() + 1, r.node_id.data() + r.node_id.size(), node);
+        }
+        if (r.kind != RecordKind::kSample || !r.has_seq || node >= last_seq.size()) {
+            Fail("record not parsed, datagram", static_cast<long>(received), -1);
+        }
+        if (static_cast<int64_t>(r.seq) <= last_seq[node]) {
+            reordered++;
+        }
+        last_seq[node] = r.seq;
+        if (worker_of[node] >= 0 && worker_of[node] != static_cast<int>(item.worker)) {
+            Fail("node on two workers", static_cast<long>(item.worker), worker_of[node]);
+        }
+        worker_of[node] = static_cast<int>(item.worker);
+    }
+
+    // one round of the loop, waiting up to timeout_ms
+    void Round(int timeout_ms)
+    {
+        if (rx.Sleep()) {
+            pollfd pfd = {rx.wake_fd(), POLLIN, 0};
+            int ready = poll(&pfd, 1, timeout_ms);
+            if (ready > 0) {
+                rx.ClearWake();
+            }
+            rx.Awake();
+            uint32_t n = rx.Drain(256, [this](const RxItem& item) { Handle(item); });
+            missed_wakeups += ready == 0 && n > 0;
+            return;
+        }
+        rx.Drain(256, [this](const RxItem& item) { Handle(item); });
+    }
+};
+
+std::unique_ptr<RxWorkers> StartWorkers(uint32_t workers, bool pin)
+{
+    RxOptions o;
+    o.listen = "127.0.0.1";
+    o.port = 0;
+    o.workers = workers;
+    o.rcvbuf_bytes = 4 << 20;
+    o.pin = pin;
+    o.steer_by_node = true;
+    auto rx = std::make_unique<RxWorkers>(o);
+    std::string error;
+    if (!rx->Open(&error)) {
+        std::fprintf(stderr, "rx workers: %s\n", error.c_str());
+        std::exit(1);
+    }
+    return rx;
+}
+
+void VerifyWorkers()
+{
+    constexpr uint32_t kWorkers = 3;
+    constexpr uint32_t kNodes = 48;
+    constexpr uint32_t kPerNode = 200;
+    std::unique_ptr<RxWorkers> rx = StartWorkers(kWorkers, false);
+    Publisher pub(*rx, kNodes);
+    std::atomic<bool> sent{false};
+    std::thread sender([&] {
+        PinToCpu(Cpus().back());
+        std::vector<int> sources = Sources();
+        sockaddr_in to = Loopback(rx->port());
+        uint32_t rng = 12345;
+        for (uint32_t seq = 0; seq < kPerNode; seq++) {
+            for (uint32_t node = 0; node < kNodes; node++) {
+                char buf[128];
+                int n = Datagram(buf, sizeof(buf), "n", node, seq);
+                rng = rng * 1103515245 + 12345;
+                sendto(sources[(rng >> 16) % kSources], buf, n, 0, reinterpret_cast<sockaddr*>(&to), sizeof(to));
+            }
+            // a pause now and then, so the publisher goes to sleep and has to be woken
+            usleep(seq % 10 == 0 ? 20000 : 200);
+        }
+        for (int fd : sources) {
+            close(fd);
+        }
+        sent = true;
+    });
+    int64_t deadline = MonotonicNs() + 10000000000LL;
+    while (pub.received < kNodes * kPerNode && MonotonicNs() < deadline) {
+        pub.Round(1000);
+    }
+    sender.join();
+    rx->Stop();
+    if (pub.received != kNodes * kPerNode) {
+        Fail("records from the workers", static_cast<long>(pub.received), kNodes * kPerNode);
+    }
+    if (pub.reordered) {
+        Fail("records out of node order", static_cast<long>(pub.reordered), 0);
+    }
+    if (pub.missed_wakeups) {
+        Fail("publisher not woken", static_cast<long>(pub.missed_wakeups), 0);
+    }
+    for (uint32_t node = 0; node < kNodes; node++) {
+        char id[16];
+        std::snprintf(id, sizeof(id), "n%u", node);
+        if (pub.worker_of[node] != NodeSteeringIndex(std::string("id=") + id, kWorkers)) {
+            Fail("worker of node", pub.worker_of[node], node);
+        }
+    }
+    uint64_t stalls = 0;
+    for (uint32_t i = 0; i < kWorkers; i++) {
+        stalls += rx->stats(i).stalls.load();
+    }
+    std::printf("%u workers: %u records from %u nodes over %u source ports, each node on its worker, in order, "
+                "%llu ring stalls\n",
+                kWorkers, kNodes * kPerNode, kNodes, kSources, static_cast<unsigned long long>(stalls));
+}
+
+struct Result {
+    uint64_t sent = 0;
+    uint64_t received = 0;
+    uint64_t stalls = 0;
+    double cpu_us = 0;      // workers and publisher, per received datagram
+};
+
+Result RunScale(uint32_t workers, uint32_t senders, double seconds)
+{
+    constexpr uint32_t kNodesPerSender = 256;
+    constexpr uint32_t kBurst = 32;
+    std::unique_ptr<RxWorkers> rx = StartWorkers(workers, true);
+    Publisher pub(*rx, kNodesPerSender * senders);
+    std::vector<int> cpus = Cpus();
+    std::atomic<bool> stop{false};
+    std::atomic<uint64_t> sent{0};
+    std::atomic<int64_t> sender_cpu{0};
+    std::vector<std::thread> threads;
+    for (uint32_t t = 0; t < senders; t++) {
+        threads.emplace_back([&, t] {
+            PinToCpu(cpus[cpus.size() - 1 - t % cpus.size()]);
+            int64_t cpu0 = CpuUs(RUSAGE_THREAD);
+            std::vector<int> sources = Sources();
+            sockaddr_in to = Loopback(rx->port());
+            std::vector<uint32_t> seq(kNodesPerSender, 0);
+            static thread_local char bufs[kBurst][128];
+            mmsghdr msgs[kBurst];
+            iovec iovs[kBurst];
+            uint32_t node = 0;
+            uint64_t count = 0;
+            for (uint32_t round = 0; !stop.load(std::memory_order_relaxed); round++) {
+                for (uint32_t i = 0; i < kBurst; i++) {
+                    uint32_t id = t * kNodesPerSender + node;
+                    int n = Datagram(bufs[i], sizeof(bufs[i]), "n", id, seq[node]++);
+                    iovs[i] = {bufs[i], static_cast<size_t>(n)};
+                    msgs[i] = {};
+                    msgs[i].msg_hdr.msg_name = &to;
+                    msgs[i].msg_hdr.msg_namelen = sizeof(to);
+                    msgs[i].msg_hdr.msg_iov = &iovs[i];
+                    msgs[i].msg_hdr.msg_iovlen = 1;
+                    node = (node + 1) % kNodesPerSender;
+                }
+                int n = sendmmsg(sources[round % kSources], msgs, kBurst, 0);
+                count += n > 0 ? n : 0;
+            }
+            sent += count;
+            sender_cpu += CpuUs(RUSAGE_THREAD) - cpu0;
+            for (int fd : sources) {
+                close(fd);
+            }
+        });
+    }
+    int64_t cpu0 = CpuUs(RUSAGE_SELF);
+    int64_t end = MonotonicNs() + static_cast<int64_t>(seconds * 1e9);
+    while (MonotonicNs() < end) {
+        pub.Round(10);
+    }
+    stop = true;
+    for (std::thread& t : threads) {
+        t.join();
+    }
+    // what is still in the socket buffers and rings
+    int64_t settle = MonotonicNs() + 200000000LL;
+    while (MonotonicNs() < settle) {
+        pub.Round(10);
+    }
+    rx->Stop();
+    while (rx->Drain(256, [&](const RxItem& item) { pub.Handle(item); }) > 0) {
+    }
+    Result r;
+    r.sent = sent;
+    r.received = pub.received;
+    for (uint32_t i = 0; i < workers; i++) {
+        r.stalls += rx->stats(i).stalls.load();
+    }
+    rx.reset();
+    r.cpu_us = r.received ? static_cast<double>(CpuUs(RUSAGE_SELF) - cpu0 - sender_cpu) / r.received : 0;
+    if (pub.reordered) {
+        Fail("records out of node order", static_cast<long>(pub.reordered), 0);
+    }
+    return r;
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    double seconds = argc > 1 ? std::atof(argv[1]) : 2.0;
+    uint32_t senders = argc > 2 ? static_cast<uint32_t>(std::atoi(argv[2])) : 2;
+    VerifySteering();
+    VerifyWorkers();
+
+    std::printf("\n%zu cpus, %u sender threads from %u source ports each, node steering, workers pinned\n",
+                Cpus().size(), senders, kSources);
+    std::printf("%8s %12s %12s %8s %14s %8s\n", "workers", "sent/s", "received/s", "lost", "cpu us/pkt", "stalls");
+    for (uint32_t workers = 1; workers <= 4; workers++) {
+        Result r = RunScale(workers, senders, seconds);
+        std::printf("%8u %12.0f %12.0f %7.1f%% %14.3f %8llu\n", workers, r.sent / seconds, r.received / seconds,
+                    r.sent ? 100.0 * (r.sent - r.received) / r.sent : 0.0, r.cpu_us,
+                    static_cast<unsigned long long>(r.stalls));
+    }
+    return 0;
+}
@@ -0,0 +1,754 @@
+/*
+ * Host benchmark of the on-disk spool (src/spool.h)
+ *
+ * Checked first, in a fresh directory under /tmp (or the one given):
+ *   - appends and reads interleaved come back in order, and once committed the
+ *     segments are deleted,
+ *   - a process that dies after a sync, with a record half written and more in the
+ *     buffer, leaves every synced message to the next Open() and nothing else,
+ *   - Close() keeps the committed position, the next Open() goes on from there,
+ *   - past max_bytes compaction thins the oldest segments to one message per topic a
+ *     minute, so every topic is covered from the first message on with gaps of a
+ *     minute at most; without compaction the oldest are deleted and what stays is the
+ *     newest, in one piece,
+ *   - the gateway spools every message while it has no broker,
+ *   - against a broker stand-in on 127.0.0.1 it replays the spool, and a spooled
+ *     message too long for the client's queue is counted as refused and committed,
+ *     not left for the next start; stopped while the broker does not acknowledge, it
+ *     leaves the live messages it still had after the replayed ones, each once.
+ * Then appends are timed, the write amplification of every sync policy is measured at
+ * 4 to 4000 messages per second (the bytes synced pages put on the device per byte of
+ * topic and payload, counted by the spool and by the kernel in /proc/self/io), and a
+ * backlog of a million messages is read back after a restart.
+ *
+ * Build and run from raspberry1/gateway:
+ *     cmake -S . -B build && cmake --build build
+ *     build/bench/spool_bench [directory on the disk to measure]
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <arpa/inet.h>
+#include <dirent.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <poll.h>
+#include <sys/socket.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cerrno>
+#include <chrono>
+#include <csignal>
+#include <cstdint>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <map>
+#include <string>
+#include <thread>
+#include <vector>
+
+#include "gateway.h"
+#include "log.h"
+#include "mqtt_codec.h"
+#include "spool.h"
+#include "udp_socket.h"
+
+using namespace gateway;
+
+namespace {
+
+constexpr uint32_t kTopics = 16;
+
+void Fail(const char* what, long got, long expected)
+{
+    std::fprintf(stderr, "MISMATCH: %s %ld, expected %ld\n", what, got, expected);
+    std::exit(1);
+}
+
+double NowNs()
+{
+    return std::chrono::duration<double, std::nano>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// a directory of its own, emptied
+std::string Fresh(const std::string& base, const char* name)
+{
+    std::string dir = base + "/" + name;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* e = readdir(d)) {
+            if (e->d_name[0] != '.') {
+                unlinkat(dirfd(d), e->d_name, 0);
+            }
+        }
+        closedir(d);
+        rmdir(dir.c_str());
+    }
+    return dir;
+}
+
+SpoolOptions Options(const std::string& dir, uint32_t segment_bytes, uint64_t max_bytes)
+{
+    SpoolOptions o;
+    o.dir = dir;
+    o.segment_bytes = segment_bytes;
+    o.max_bytes = max_bytes;
+    return o;
+}
+
+// message i is on node i % kTopics, its payload is i
+bool Append(Spool& spool, uint32_t i, int64_t time_ms)
+{
+    char topic[48];
+    char payload[16];
+    int topic_len = std::snprintf(topic, sizeof(topic), "iot/pi/n%02u/airTemperature", i % kTopics);
+    int payload_len = std::snprintf(payload, sizeof(payload), "%u", i);
+    return spool.Append(time_ms, std::string_view(topic, topic_len), std::string_view(payload, payload_len));
+}
+
+uint32_t Value(const SpoolMessage& m)
+{
+    return static_cast<uint32_t>(std::strtoul(std::string(m.payload).c_str(), nullptr, 10));
+}
+
+void Open(Spool& spool)
+{
+    std::string error;
+    if (!spool.Open(&error)) {
+        std::fprintf(stderr, "MISMATCH: %s\n", error.c_str());
+        std::exit(1);
+    }
+}
+
+uint32_t Files(const std::string& dir)
+{
+    uint32_t n = 0;
+    if (DIR* d = opendir(dir.c_str())) {
+        while (dirent* e = readdir(d)) {
+            n += std::strncmp(e->d_name, "spool-", 6) == 0;
+        }
+        closedir(d);
+    }
+    return n;
+}
+
+void VerifyOrder(const std::string& base)
+{
+    std::string dir = Fresh(base, "order");
+    Spool spool(Options(dir, 64 * 1024, 64 << 20));
+    Open(spool);
+    uint32_t in = 0, out = 0, uncommitted = 0;
+    SpoolMessage m;
+    for (int round = 0; round < 100; round++) {
+        for (int i = 0; i < 300; i++) {
+            Append(spool, in++, round);
+        }
+        spool.Flush(round);
+        for (int i = 0; i < 200 && spool.Next(&m); i++, out++, uncommitted++) {
+            if (Value(m) != out || m.time_ms != out / 300) {
+                Fail("message in order", Value(m), out);
+            }
+        }
+        if (round % 2) {
+            spool.Commit(uncommitted);
+            uncommitted = 0;
+        }
+    }
+    while (spool.Next(&m)) {
+        if (Value(m) != out++) {
+            Fail("message in order", Value(m), out - 1);
+        }
+        uncommitted++;
+    }
+    spool.Commit(uncommitted);
+    if (out != in || spool.backlog() != 0 || spool.segments() != 1 || Files(dir) != 1) {
+        Fail("segments left once all is committed", Files(dir), 1);
+    }
+    std::printf("%u messages read back in order while appended, the segments deleted as they were committed\n", in);
+}
+
+void VerifyRecovery(const std::string& base)
+{
+    std::string dir = Fresh(base, "recovery");
+    SpoolOptions o = Options(dir, 64 * 1024, 64 << 20);
+    o.sync = SpoolSync::kAlways;
+    pid_t pid = fork();
+    if (pid == 0) {
+        Spool spool(o);
+        Open(spool);
+        for (uint32_t i = 0; i < 3000; i++) {
+            Append(spool, i, 0);
+        }
+        spool.Flush(0);
+        for (uint32_t i = 3000; i < 3010; i++) {
+            Append(spool, i, 0);    // still in the buffer
+        }
+        // the start of a record the power took
+        std::string last;
+        if (DIR* d = opendir(dir.c_str())) {
+            while (dirent* e = readdir(d)) {
+                if (std::strncmp(e->d_name, "spool-", 6) == 0) {
+                    last = std::max(last, std::string(e->d_name));
+                }
+            }
+            closedir(d);
+        }
+        int fd = open((dir + "/" + last).c_str(), O_WRONLY | O_APPEND);
+        const char torn[] = "\x5a\x17\x00\x00\x11\x22\x33";
+        if (fd < 0 || write(fd, torn, sizeof(torn) - 1) < 0) {
+            _exit(1);
+        }
+        _exit(0);
+    }
+    int status = 0;
+    waitpid(pid, &status, 0);
+    if (!WIFEXITED(status) || WEXITSTATUS(status) != 0) {
+        Fail("child exit status", status, 0);
+    }
+
+    {
+        Spool spool(o);
+        Open(spool);
+        if (spool.backlog() != 3000) {
+            Fail("messages after the crash", static_cast<long>(spool.backlog()), 3000);
+        }
+        SpoolMessage m;
+        for (uint32_t i = 0; i < 1000; i++) {
+            if (!spool.Next(&m) || Value(m) != i) {
+                Fail("message after the crash", Value(m), i);
+            }
+        }
+        spool.Commit(600);
+        spool.Close();
+    }
+    Spool spool(o);
+    Open(spool);
+    SpoolMessage m;
+    if (spool.backlog() != 2400 || !spool.Next(&m) || Value(m) != 600) {
+        Fail("messages after the cursor", static_cast<long>(spool.backlog()), 2400);
+    }
+    uint32_t next = 601;
+    while (spool.Next(&m)) {
+        if (Value(m) != next++) {
+            Fail("message after the cursor", Value(m), next - 1);
+        }
+    }
+    if (next != 3000) {
+        Fail("last message after the cursor", next, 3000);
+    }
+    std::printf("after a crash the 3000 synced messages are back and the torn record is cut, "
+                "after Close() the 600 committed stay gone\n");
+}
+
+// 16 topics, each every second: 100000 messages, 6250 s of an outage
+void VerifyRetention(const std::string& base, uint32_t compact_ms)
+{
+    std::string dir = Fresh(base, compact_ms ? "compact" : "evict");
+    SpoolOptions o = Options(dir, 64 * 1024, 512 * 1024);
+    o.sync = SpoolSync::kNever;
+    o.compact_ms = compact_ms;
+    Spool spool(o);
+    Open(spool);
+    const uint32_t total = 100000;
+    for (uint32_t i = 0; i < total; i++) {
+        Append(spool, i, static_cast<int64_t>(i / kTopics) * 1000);
+        if (i % kTopics == kTopics - 1) {
+            spool.Flush(i);
+        }
+        if (spool.bytes() > o.max_bytes + o.segment_bytes) {
+            Fail("bytes on disk", static_cast<long>(spool.bytes()), static_cast<long>(o.max_bytes + o.segment_bytes));
+        }
+    }
+    const SpoolStats& s = spool.stats();
+    uint64_t kept = spool.backlog();
+    if (kept + s.compacted + s.evicted != total) {
+        Fail("messages kept, compacted and evicted", static_cast<long>(kept + s.compacted + s.evicted), total);
+    }
+    SpoolMessage m;
+    uint32_t previous = 0;
+    bool first = true;
+    std::vector<int64_t> last(kTopics, -1);
+    int64_t max_gap = 0;
+    while (spool.Next(&m)) {
+        uint32_t v = Value(m);
+        if (!first && v <= previous) {
+            Fail("message in order", v, previous + 1);
+        }
+        if (compact_ms == 0 && !first && v != previous + 1) {
+            Fail("what is left in one piece", v, previous + 1);
+        }
+        if (last[v % kTopics] >= 0) {
+            max_gap = std::max(max_gap, m.time_ms - last[v % kTopics]);
+        }
+        last[v % kTopics] = m.time_ms;
+        previous = v;
+        first = false;
+    }
+    if (previous != total - 1) {
+        Fail("newest message", previous, total - 1);
+    }
+    if (compact_ms) {
+        if (s.evicted != 0 || max_gap > compact_ms || s.compacted == 0) {
+            Fail("gap between the messages of a topic, ms", static_cast<long>(max_gap), compact_ms);
+        }
+        std::printf("compaction: %.1f MB of an outage of %u s in %.2f MB, %llu messages kept of %u, one per topic "
+                    "every %lld s at most\n",
+                    total * 47 / 1048576.0, total / kTopics, spool.bytes() / 1048576.0,
+                    static_cast<unsigned long long>(kept), total, static_cast<long long>(max_gap / 1000));
+    } else {
+        if (s.evicted == 0) {
+            Fail("messages evicted", 0, 1);
+        }
+        std::printf("without compaction: the newest %llu messages kept in one piece, %llu evicted\n",
+                    static_cast<unsigned long long>(kept), static_cast<unsigned long long>(s.evicted));
+    }
+}
+
+void VerifyGateway(const std::string& base)
+{
+    Config c;
+    c.topic_prefix = "iot/pi";
+    c.client_id = "bench";
+    c.port = c.discovery_port = c.probe_port = c.metrics_port = 0;   // no sockets
+    c.io_backend = "epoll";
+    c.broker = "127.0.0.1";
+    c.spool_dir = Fresh(base, "gateway");
+    Gateway gw(c);
+    std::string error;
+    if (!gw.Open(&error)) {
+        std::fprintf(stderr, "MISMATCH: %s\n", error.c_str());
+        std::exit(1);
+    }
+    sockaddr_in from = {};
+    from.sin_family = AF_INET;
+    for (uint32_t seq = 0; seq < 10; seq++) {
+        char text[64];
+        std::snprintf(text, sizeof(text), "temp=21.%02u,hum=40.00,id=n1,seq=%u", seq, seq);
+        gw.HandleDatagram(text, from, seq);
+    }
+    if (gw.spool()->backlog() != 20 || gw.mqtt().pending() != 0) {
+        Fail("messages spooled", static_cast<long>(gw.spool()->backlog()), 20);
+    }
+    std::printf("the gateway spools every message while the broker is away\n");
+}
+
+// CONNACKs and, with acks, PUBACKs on 127.0.0.1; counts the PUBLISHes
+class Broker {
+public:
+    explicit Broker(bool acks) : acks_(acks)
+    {
+        listener_ = socket(AF_INET, SOCK_STREAM | SOCK_CLOEXEC, 0);
+        sockaddr_in addr = {};
+        addr.sin_family = AF_INET;
+        addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+        socklen_t len = sizeof(addr);
+        if (bind(listener_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) < 0 || listen(listener_, 4) < 0 ||
+            getsockname(listener_, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+            std::perror("broker");
+            std::exit(1);
+        }
+        port_ = ntohs(addr.sin_port);
+        thread_ = std::thread([this] { Run(); });
+    }
+
+    ~Broker()
+    {
+        stop_ = true;
+        thread_.join();
+        close(listener_);
+    }
+
+    uint16_t port() const { return port_; }
+    bool connected() const { return connected_; }
+    uint32_t publishes() const { return publishes_; }
+
+private:
+    void Run()
+    {
+        int client = -1;
+        std::vector<uint8_t> in(1 << 16);
+        size_t len = 0;
+        while (!stop_) {
+            pollfd fds[2] = { { listener_, POLLIN, 0 }, { client, POLLIN, 0 } };
+            poll(fds, client >= 0 ? 2 : 1, 20);
+            if (fds[0].revents & POLLIN) {
+                if (client >= 0) {
+                    close(client);
+                }
+                client = accept4(listener_, nullptr, nullptr, SOCK_CLOEXEC);
+                len = 0;
+            }
+            if (client < 0 || !(fds[1].revents & (POLLIN | POLLHUP | POLLERR))) {
+                continue;
+            }
+            ssize_t n = recv(client, in.data() + len, in.size() - len, MSG_DONTWAIT);
+            if (n < 0 && errno == EAGAIN) {
+                continue;
+            }
+            if (n <= 0) {
+                close(client);
+                client = -1;
+                continue;
+            }
+            len += static_cast<size_t>(n);
+            uint8_t out[1 << 14];
+            size_t out_len = 0;
+            size_t pos = 0;
+            mqtt::Packet p;
+            size_t used = 0;
+            while (out_len + 4 <= sizeof(out) &&
+                   mqtt::DecodePacket(in.data() + pos, len - pos, p, &used) == mqtt::Decode::kOk) {
+                pos += used;
+                if (p.type == mqtt::kConnect) {
+                    const uint8_t connack[] = { mqtt::kConnack << 4, 2, 0, 0 };
+                    std::memcpy(out + out_len, connack, sizeof(connack));
+                    out_len += sizeof(connack);
+                    connected_ = true;
+                } else if (p.type == mqtt::kPublish) {
+                    publishes_++;
+                    if (acks_ && p.packet_id) {
+                        out_len += mqtt::EncodePuback(out + out_len, sizeof(out) - out_len, p.packet_id);
+                    }
+                } else if (p.type == mqtt::kPingreq) {
+                    out[out_len++] = mqtt::kPingresp << 4;
+                    out[out_len++] = 0;
+                }
+            }
+            std::memmove(in.data(), in.data() + pos, len - pos);
+            len -= pos;
+            if (out_len) {
+                send(client, out, out_len, MSG_NOSIGNAL);
+            }
+        }
+        if (client >= 0) {
+            close(client);
+        }
+    }
+
+    bool acks_;
+    int listener_ = -1;
+    uint16_t port_ = 0;
+    std::atomic<bool> stop_{false};
+    std::atomic<bool> connected_{false};
+    std::atomic<uint32_t> publishes_{0};
+    std::thread thread_;
+};
+
+uint16_t FreePort(int type)
+{
+    int fd = socket(AF_INET, type | SOCK_CLOEXEC, 0);
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    socklen_t len = sizeof(addr);
+    bind(fd, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+    close(fd);
+    return ntohs(addr.sin_port);
+}
+
+Config GatewayConfig(const std::string& dir, uint16_t broker_port)
+{
+    Config c;
+    c.topic_prefix = "iot/pi";
+    c.client_id = "bench";
+    c.port = c.discovery_port = c.probe_port = c.metrics_port = 0;   // no sockets
+    c.io_backend = "epoll";         // run on another thread than the one that opened it
+    c.broker = "127.0.0.1";
+    c.broker_port = broker_port;
+    c.stats_interval_s = 0;
+    c.spool_dir = dir;
+    return c;
+}
+
+void VerifyReplay(const std::string& base)
+{
+    std::string dir = Fresh(base, "replay_gateway");
+    std::string too_long(MqttClient::kTopicMax + 1, 't');
+    {
+        Spool spool(Options(dir, 1 << 20, 64 << 20));
+        Open(spool);
+        // the last one refused too, nothing comes after it
+        for (uint32_t i = 0; i < 8; i++) {
+            if (i == 3 || i == 7) {
+                spool.Append(0, too_long, "0");
+            } else {
+                Append(spool, i, 0);
+            }
+        }
+        spool.Close();
+    }
+    Broker broker(true);
+    Gateway gw(GatewayConfig(dir, broker.port()));
+    std::string error;
+    if (!gw.Open(&error)) {
+        std::fprintf(stderr, "MISMATCH: %s\n", error.c_str());
+        std::exit(1);
+    }
+    volatile std::sig_atomic_t stop = 0;
+    volatile std::sig_atomic_t dump = 0;
+    std::thread run([&] { gw.Run(&stop, &dump); });
+    for (int i = 0; i < 500 && broker.publishes() < 6; i++) {
+        usleep(10000);
+    }
+    stop = 1;
+    run.join();
+    const SpoolStats& s = gw.spool()->stats();
+    if (broker.publishes() != 6 || s.refused != 2 || s.committed != 8) {
+        Fail("replayed messages committed", static_cast<long>(s.committed), 8);
+    }
+    Spool again(Options(dir, 1 << 20, 64 << 20));
+    Open(again);
+    if (again.backlog() != 0) {
+        Fail("messages left after the replay", static_cast<long>(again.backlog()), 0);
+    }
+    again.Close();
+    std::printf("the gateway replays the spool, messages the client refuses are committed as lost\n");
+}
+
+void VerifyShutdown(const std::string& base)
+{
+    std::string dir = Fresh(base, "shutdown");
+    {
+        Spool spool(Options(dir, 1 << 20, 64 << 20));
+        Open(spool);
+        for (uint32_t i = 0; i < 3; i++) {
+            Append(spool, i, 0);
+        }
+        spool.Close();
+    }
+    Broker broker(false);
+    Config c = GatewayConfig(dir, broker.port());
+    c.listen = "127.0.0.1";
+    c.port = FreePort(SOCK_DGRAM);
+    c.queue_policy = "drop_oldest";     // every message kept, none replaced
+    Gateway gw(c);
+    std::string error;
+    if (!gw.Open(&error)) {
+        std::fprintf(stderr, "MISMATCH: %s\n", error.c_str());
+        std::exit(1);
+    }
+    volatile std::sig_atomic_t stop = 0;
+    volatile std::sig_atomic_t dump = 0;
+    std::thread run([&] { gw.Run(&stop, &dump); });
+    for (int i = 0; i < 500 && broker.publishes() < 3; i++) {
+        usleep(10000);
+    }
+    // 20 live messages: the window fills up with the replayed ones, the rest waits in the queue
+    int fd = OpenUdp("127.0.0.1", 0);
+    sockaddr_in to = {};
+    to.sin_family = AF_INET;
+    to.sin_port = htons(c.port);
+    to.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+    for (uint32_t seq = 0; seq < 10; seq++) {
+        char text[64];
+        int len = std::snprintf(text, sizeof(text), "temp=21.%02u,hum=40.00,id=n1,seq=%u", seq, seq);
+        sendto(fd, text, len, 0, reinterpret_cast<const sockaddr*>(&to), sizeof(to));
+    }
+    close(fd);
+    for (int i = 0; i < 500 && broker.publishes() < c.max_inflight; i++) {
+        usleep(10000);
+    }
+    usleep(200000);
+    stop = 1;
+    run.join();
+    if (broker.publishes() != c.max_inflight) {
+        Fail("messages on the wire", broker.publishes(), c.max_inflight);
+    }
+    Spool again(Options(dir, 1 << 20, 64 << 20));
+    Open(again);
+    SpoolMessage m;
+    uint32_t n = 0, temperatures = 0;
+    while (again.Next(&m)) {
+        if (n < 3 && Value(m) != n) {
+            Fail("replayed message kept", Value(m), n);
+        }
+        if (n >= 3 && m.topic.find("/n1/") == std::string_view::npos) {
+            Fail("live message saved", n, -1);
+        }
+        if (m.topic.find("Temperature") != std::string_view::npos && n >= 3) {
+            char expected[16];
+            std::snprintf(expected, sizeof(expected), "21.%02u", temperatures++);
+            if (m.payload != expected) {
+                Fail("live message in order", n, temperatures - 1);
+            }
+        }
+        n++;
+    }
+    if (n != 23 || temperatures != 10) {
+        Fail("messages in the spool after the stop", n, 23);
+    }
+    again.Close();
+    std::printf("stopped without PUBACKs, the gateway leaves the %u live messages to the spool after the replayed 3\n",
+                n - 3);
+}
+
+void BenchAppend(const std::string& base)
+{
+    std::string dir = Fresh(base, "append");
+    SpoolOptions o = Options(dir, 64 << 20, 1ull << 30);
+    o.sync = SpoolSync::kNever;
+    Spool spool(o);
+    Open(spool);
+    // formatted before, the clock sees Append() only
+    std::vector<std::string> topics, payloads;
+    for (uint32_t i = 0; i < 4096; i++) {
+        char text[48];
+        topics.emplace_back(text, std::snprintf(text, sizeof(text), "iot/pi/n%02u/airTemperature", i % kTopics));
+        payloads.emplace_back(text, std::snprintf(text, sizeof(text), "%u.%02u", 15 + i % 10, i % 100));
+    }
+    const uint32_t n = 4000000;
+    double t0 = NowNs();
+    for (uint32_t i = 0; i < n; i++) {
+        spool.Append(i, topics[i & 4095], payloads[i & 4095]);
+    }
+    spool.Flush(0);
+    double ns = (NowNs() - t0) / n;
+    std::printf("\nSpool::Append: %.1f ns per message, record and CRC-32C, written out 64 KiB at a time\n", ns);
+    spool.Close();
+    Fresh(base, "append");
+}
+
+uint64_t KernelWriteBytes()
+{
+    uint64_t bytes = 0;
+    if (FILE* f = std::fopen("/proc/self/io", "r")) {
+        char line[128];
+        while (std::fgets(line, sizeof(line), f)) {
+            unsigned long long v;
+            if (std::sscanf(line, "write_bytes: %llu", &v) == 1) {
+                bytes = v;
+            }
+        }
+        std::fclose(f);
+    }
+    return bytes;
+}
+
+void BenchPolicies(const std::string& base)
+{
+    struct Policy {
+        const char* name;
+        SpoolSync sync;
+        uint32_t sync_ms;
+    } policies[] = {
+        {"always", SpoolSync::kAlways, 0},
+        {"interval 1 s", SpoolSync::kInterval, 1000},
+        {"interval 10 s", SpoolSync::kInterval, 10000},
+        {"never", SpoolSync::kNever, 0},
+    };
+    std::printf("\n120 s of an outage, a loop round per message or every 10 ms; bytes on the device per byte of topic "
+                "and payload (about 30), counted by the spool and by the kernel\n");
+    std::printf("%-14s %8s %9s %9s %9s %9s %9s\n", "fsync", "msg/s", "syncs", "written", "device", "kernel",
+                "us/msg");
+    for (const Policy& p : policies) {
+        for (uint32_t rate : {4u, 40u, 400u, 4000u}) {
+            std::string dir = Fresh(base, "policy");
+            SpoolOptions o = Options(dir, 1 << 20, 64 << 20);
+            o.sync = p.sync;
+            o.sync_ms = p.sync_ms;
+            Spool spool(o);
+            Open(spool);
+            const int64_t seconds = 120;
+            const int64_t round_us = std::max<int64_t>(1000000 / rate, 10000);
+            const uint32_t per_round = static_cast<uint32_t>(rate * round_us / 1000000);
+            uint64_t kernel0 = KernelWriteBytes();
+            double t0 = NowNs();
+            uint32_t i = 0;
+            for (int64_t us = 0; us < seconds * 1000000; us += round_us) {
+                for (uint32_t k = 0; k < per_round; k++, i++) {
+                    Append(spool, i, us / 1000);
+                }
+                spool.Flush(us / 1000);
+            }
+            spool.Close();
+            double us_per = (NowNs() - t0) / 1000 / i;
+            const SpoolStats& s = spool.stats();
+            double bytes = static_cast<double>(s.message_bytes);
+            std::printf("%-14s %8u %9llu %9.2f %9.2f %9.2f %9.2f\n", p.name, rate,
+                        static_cast<unsigned long long>(s.syncs), s.written_bytes / bytes, s.device_bytes / bytes,
+                        (KernelWriteBytes() - kernel0) / bytes, us_per);
+        }
+    }
+    Fresh(base, "policy");
+}
+
+void BenchReplay(const std::string& base)
+{
+    std::string dir = Fresh(base, "replay");
+    SpoolOptions o = Options(dir, 1 << 20, 256 << 20);
+    const uint32_t n = 1000000;
+    {
+        Spool spool(o);
+        Open(spool);
+        for (uint32_t i = 0; i < n; i++) {
+            Append(spool, i, i);
+        }
+        spool.Close();
+    }
+    double t0 = NowNs();
+    Spool spool(o);
+    Open(spool);
+    double open_ms = (NowNs() - t0) / 1e6;
+    uint64_t bytes = spool.bytes();
+    uint32_t segments = spool.segments();
+    SpoolMessage m;
+    uint32_t next = 0;
+    t0 = NowNs();
+    while (spool.Next(&m)) {
+        if (Value(m) != next++) {
+            Fail("replayed message", Value(m), next - 1);
+        }
+        if (next % 256 == 0) {
+            spool.Commit(256);
+        }
+    }
+    spool.Commit(next % 256);
+    double seconds = (NowNs() - t0) / 1e9;
+    if (next != n || spool.segments() > 1) {
+        Fail("messages replayed", next, n);
+    }
+    std::printf("\nreplay of %u messages (%.1f MB in %u segments, page cache warm): Open() %.0f ms, "
+                "%.2f M messages/s, %.0f MB/s, segments deleted as committed\n",
+                n, bytes / 1048576.0, segments, open_ms, n / seconds / 1e6, bytes / seconds / 1048576.0);
+    spool.Close();
+    Fresh(base, "replay");
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    LogInit(LogLevel::kError);
+    std::string base;
+    if (argc > 1) {
+        base = argv[1];
+    } else {
+        char dir[] = "/tmp/spool_bench.XXXXXX";
+        if (mkdtemp(dir) == nullptr) {
+            std::perror("mkdtemp");
+            return 1;
+        }
+        base = dir;
+    }
+    VerifyOrder(base);
+    VerifyRecovery(base);
+    VerifyRetention(base, 60000);
+    VerifyRetention(base, 0);
+    VerifyGateway(base);
+    VerifyReplay(base);
+    VerifyShutdown(base);
+    for (const char* name : {"order", "recovery", "compact", "evict", "gateway", "replay_gateway", "shutdown"}) {
+        Fresh(base, name);
+    }
+    BenchAppend(base);
+    BenchPolicies(base);
+    BenchReplay(base);
+    if (argc == 1) {
+        rmdir(base.c_str());
+    }
+    return 0;
+}
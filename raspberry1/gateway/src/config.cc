@@ -0,0 +1,247 @@
+/*
+ * Gateway configuration.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "config.h"
+
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdlib>
+#include <fstream>
+#include <limits>
+
+namespace gateway {
+
+namespace {
+
+std::string Trim(const std::string& s)
+{
+    size_t begin = s.find_first_not_of(" \t\r\n");
+    if (begin == std::string::npos) {
+        return "";
+    }
+    size_t end = s.find_last_not_of(" \t\r\n");
+    return s.substr(begin, end - begin + 1);
+}
+
+template <typename T>
+bool ParseUnsigned(const std::string& value, T& out, uint64_t min = 0, uint64_t max = std::numeric_limits<T>::max())
+{
+    char* end = nullptr;
+    errno = 0;
+    unsigned long long v = std::strtoull(value.c_str(), &end, 10);
+    if (errno != 0 || end == value.c_str() || *end != '\0' || value[0] == '-' || v < min || v > max) {
+        return false;
+    }
+    out = static_cast<T>(v);
+    return true;
+}
+
+bool ParseInt(const std::string& value, int32_t& out)
+{
+    char* end = nullptr;
+    errno = 0;
+    long v = std::strtol(value.c_str(), &end, 10);
+    if (errno != 0 || end == value.c_str() || *end != '\0' || v < 0 || v > std::numeric_limits<int32_t>::max()) {
+        return false;
+    }
+    out = static_cast<int32_t>(v);
+    return true;
+}
+
+bool ParseBool(const std::string& value, bool& out)
+{
+    if (value == "1" || value == "true" || value == "yes" || value == "on") {
+        out = true;
+    } else if (value == "0" || value == "false" || value == "no" || value == "off") {
+        out = false;
+    } else {
+        return false;
+    }
+    return true;
+}
+
+std::string HostName()
+{
+    char name[256] = {0};
+    if (gethostname(name, sizeof(name) - 1) != 0 || name[0] == '\0') {
+        return "gateway";
+    }
+    return name;
+}
+
+}  // namespace
+
+bool ConfigSet(Config& c, const std::string& key, const std::string& value, std::string* error)
+{
+    bool ok = true;
+    if (key == "listen") {
+        c.listen = value;
+    } else if (key == "port") {
+        ok = ParseUnsigned(value, c.port, 1);
+    } else if (key == "discovery_port") {
+        ok = ParseUnsigned(value, c.discovery_port);
+    } else if (key == "probe_port") {
+        ok = ParseUnsigned(value, c.probe_port);
+    } else if (key == "rx_batch") {
+        ok = ParseUnsigned(value, c.rx_batch, 1, 256);
+    } else if (key == "busy_poll_us") {
+        ok = ParseUnsigned(value, c.busy_poll_us, 0, 1000000);
+    } else if (key == "io_backend") {
+        ok = value == "auto" || value == "uring" || value == "epoll";
+        c.io_backend = ok ? value : c.io_backend;
+    } else if (key == "rx_workers") {
+        ok = ParseUnsigned(value, c.rx_workers, 0, 64);
+    } else if (key == "rx_pin") {
+        ok = ParseBool(value, c.rx_pin);
+    } else if (key == "rx_steer") {
+        ok = value == "hash" || value == "node";
+        c.rx_steer = ok ? value : c.rx_steer;
+    } else if (key == "broker") {
+        c.broker = value;
+    } else if (key == "broker_port") {
+        ok = ParseUnsigned(value, c.broker_port, 1);
+    } else if (key == "client_id") {
+        c.client_id = value;
+    } else if (key == "username") {
+        c.username = value;
+    } else if (key == "password") {
+        c.password = value;
+    } else if (key == "password_file") {
+        c.password_file = value;
+    } else if (key == "keepalive_s") {
+        ok = ParseUnsigned(value, c.keepalive_s, 5);
+    } else if (key == "qos") {
+        ok = ParseUnsigned(value, c.qos, 0, 1);
+    } else if (key == "max_inflight") {
+        ok = ParseUnsigned(value, c.max_inflight, 1, 65535);
+    } else if (key == "topic_prefix") {
+        c.topic_prefix = value;
+    } else if (key == "node_topics") {
+        ok = ParseBool(value, c.node_topics);
+    } else if (key == "combine_fields") {
+        ok = ParseBool(value, c.combine_fields);
+    } else if (key == "queue_size") {
+        ok = ParseUnsigned(value, c.queue_size, 1, 1u << 20);
+    } else if (key == "queue_policy") {
+        ok = value == "latest" || value == "drop_oldest" || value == "drop_newest" || value == "block";
+        c.queue_policy = ok ? value : c.queue_policy;
+    } else if (key == "rx_queue_policy") {
+        ok = value == "block" || value == "drop_newest";
+        c.rx_queue_policy = ok ? value : c.rx_queue_policy;
+    } else if (key == "spool_dir") {
+        c.spool_dir = value;
+    } else if (key == "spool_fsync") {
+        ok = value == "always" || value == "interval" || value == "never";
+        c.spool_fsync = ok ? value : c.spool_fsync;
+    } else if (key == "spool_fsync_ms") {
+        ok = ParseUnsigned(value, c.spool_fsync_ms, 1, 3600000);
+    } else if (key == "spool_segment_kb") {
+        ok = ParseUnsigned(value, c.spool_segment_kb, 64, 65536);
+    } else if (key == "spool_max_mb") {
+        ok = ParseUnsigned(value, c.spool_max_mb, 1, 1u << 20);
+    } else if (key == "spool_compact_s") {
+        ok = ParseUnsigned(value, c.spool_compact_s, 0, 86400);
+    } else if (key == "spool_replay_rate") {
+        ok = ParseUnsigned(value, c.spool_replay_rate, 1, 1000000);
+    } else if (key == "max_nodes") {
+        ok = ParseUnsigned(value, c.max_nodes, 1, 1u << 20);
+    } else if (key == "forecast_tol_temp") {
+        ok = ParseInt(value, c.forecast_tol_temp);
+    } else if (key == "forecast_tol_hum") {
+        ok = ParseInt(value, c.forecast_tol_hum);
+    } else if (key == "forecast_keyframe") {
+        ok = ParseUnsigned(value, c.forecast_keyframe, 2, 3600);
+    } else if (key == "publish_predicted") {
+        ok = ParseBool(value, c.publish_predicted);
+    } else if (key == "stats_interval_s") {
+        ok = ParseUnsigned(value, c.stats_interval_s);
+    } else if (key == "metrics_listen") {
+        c.metrics_listen = value;
+    } else if (key == "metrics_port") {
+        ok = ParseUnsigned(value, c.metrics_port);
+    } else if (key == "verbose") {
+        ok = ParseBool(value, c.verbose);
+    } else {
+        if (error) {
+            *error = "unknown key '" + key + "'";
+        }
+        return false;
+    }
+    if (!ok && error) {
+        *error = "bad value '" + value + "' for " + key;
+    }
+    return ok;
+}
+
+bool ConfigLoadFile(Config& config, const std::string& path, std::string* error)
+{
+    std::ifstream in(path);
+    if (!in) {
+        if (error) {
+            *error = "cannot open " + path;
+        }
+        return false;
+    }
+    std::string line;
+    for (int number = 1; std::getline(in, line); number++) {
+        line = Trim(line.substr(0, line.find('#')));
+        if (line.empty()) {
+            continue;
+        }
+        size_t eq = line.find('=');
+        std::string message;
+        if (eq == std::string::npos) {
+            message = "expected key = value";
+        } else if (ConfigSet(config, Trim(line.substr(0, eq)), Trim(line.substr(eq + 1)), &message)) {
+            continue;
+        }
+        if (error) {
+            *error = path + ":" + std::to_string(number) + ": " + message;
+        }
+        return false;
+    }
+    return true;
+}
+
+bool ConfigFinish(Config& config, std::string* error)
+{
+    if (config.client_id.empty()) {
+        config.client_id = "gateway-" + HostName();
+    }
+    if (config.topic_prefix.empty()) {
+        config.topic_prefix = "iot/" + HostName();
+    }
+    while (!config.topic_prefix.empty() && config.topic_prefix.back() == '/') {
+        config.topic_prefix.pop_back();
+    }
+    // the event loop cannot leave datagrams it was handed for later, the rx rings can
+    if (config.queue_policy == "block" && config.rx_workers == 0) {
+        if (error) {
+            *error = "queue_policy = block needs rx_workers";
+        }
+        return false;
+    }
+    // retention works a segment at a time
+    if (!config.spool_dir.empty() && config.spool_max_mb * 1024ull < 4ull * config.spool_segment_kb) {
+        if (error) {
+            *error = "spool_max_mb has to hold four segments of spool_segment_kb";
+        }
+        return false;
+    }
+    if (!config.password_file.empty()) {
+        std::ifstream in(config.password_file);
+        if (!in || !std::getline(in, config.password)) {
+            if (error) {
+                *error = "cannot read " + config.password_file;
+            }
+            return false;
+        }
+        config.password = Trim(config.password);
+    }
+    return true;
+}
+
+}  // namespace gateway
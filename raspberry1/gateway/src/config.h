@@ -0,0 +1,73 @@
+/*
+ * Gateway configuration, "key = value" lines from a file with command line overrides.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+
+namespace gateway {
+
+struct Config {
+    // node side
+    std::string listen = "0.0.0.0";
+    uint16_t port = 8080;               // sensor datagrams
+    uint16_t discovery_port = 8079;     // esp_gw_discovery queries, 0 to not answer
+    uint16_t probe_port = 8084;         // esp_link_probe reflector, 0 to not reflect
+    uint32_t rx_batch = 64;             // datagrams per recvmmsg(), 1 for one syscall per datagram
+    uint32_t busy_poll_us = 0;          // spin this long after a datagram instead of sleeping, SO_BUSY_POLL
+    std::string io_backend = "auto";    // auto (io_uring when the kernel can), uring or epoll
+    uint32_t rx_workers = 0;            // receive threads with their own SO_REUSEPORT socket, 0 for none
+    bool rx_pin = true;                 // rx worker i on the i-th CPU
+    std::string rx_steer = "hash";      // hash (source address and port) or node (node id, BPF)
+
+    // broker side
+    std::string broker = "194.177.207.38";
+    uint16_t broker_port = 1883;
+    std::string client_id;              // default gateway-<hostname>
+    std::string username;
+    std::string password;
+    std::string password_file;          // read at start, wins over password
+    uint16_t keepalive_s = 60;
+    uint8_t qos = 1;
+    uint16_t max_inflight = 16;         // QoS 1 messages on the wire without a PUBACK
+    std::string topic_prefix;           // default iot/<hostname>, like raspberry1/project/project.py
+    bool node_topics = true;            // <prefix>/<node id>/<measurement> instead of <prefix>/<measurement>
+    bool combine_fields = false;        // a sample as one JSON message on <prefix>/<node id>
+
+    // bounded memory
+    uint32_t queue_size = 1024;         // outgoing messages while the broker is slow or away
+    std::string queue_policy = "latest";    // full queue: latest (per topic), drop_oldest, drop_newest, block
+    std::string rx_queue_policy = "block";  // full rx ring: block (wait for room) or drop_newest
+    uint32_t max_nodes = 256;
+
+    // on disk, what the broker cannot take; sized for an SD card
+    std::string spool_dir;              // empty for no spool
+    std::string spool_fsync = "interval";   // always (every loop round that wrote), interval or never
+    uint32_t spool_fsync_ms = 1000;
+    uint32_t spool_segment_kb = 1024;
+    uint32_t spool_max_mb = 64;
+    uint32_t spool_compact_s = 60;      // past spool_max_mb one message per topic this far apart, 0 to delete
+    uint32_t spool_replay_rate = 500;   // messages per second from the spool while the broker is back
+
+    // esp_forecast, must match the node's CONFIG_FORECAST_*
+    int32_t forecast_tol_temp = 15;
+    int32_t forecast_tol_hum = 50;
+    uint32_t forecast_keyframe = 30;
+    bool publish_predicted = false;     // publish the samples a node skipped, not only count them
+
+    uint32_t stats_interval_s = 60;
+    std::string metrics_listen = "127.0.0.1";
+    uint16_t metrics_port = 9108;       // Prometheus text format on GET /metrics, 0 for none
+    bool verbose = false;               // log every datagram like udp_server_raspi_example.py
+};
+
+// false with a message in *error for an unknown key or a bad value
+bool ConfigSet(Config& config, const std::string& key, const std::string& value, std::string* error);
+bool ConfigLoadFile(Config& config, const std::string& path, std::string* error);
+// fills in what defaults to the host name and reads password_file
+bool ConfigFinish(Config& config, std::string* error);
+
+}  // namespace gateway
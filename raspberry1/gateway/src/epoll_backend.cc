@@ -0,0 +1,262 @@
+/*
+ * I/O backend on epoll.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "epoll_backend.h"
+
+#include <sys/epoll.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstring>
+
+#include "udp_socket.h"
+
+namespace gateway {
+
+namespace {
+
+constexpr int kMaxEvents = 64;
+constexpr uint32_t kReceiveBudget = 256;    // datagrams per wakeup before the other sockets get a turn
+
+uint64_t Key(int fd, uint32_t generation)
+{
+    return static_cast<uint64_t>(generation) << 32 | static_cast<uint32_t>(fd);
+}
+
+}  // namespace
+
+std::unique_ptr<EpollBackend> EpollBackend::Create(std::string* error)
+{
+    int epfd = epoll_create1(EPOLL_CLOEXEC);
+    if (epfd < 0) {
+        if (error) {
+            *error = std::string("epoll_create1: ") + strerror(errno);
+        }
+        return nullptr;
+    }
+    return std::unique_ptr<EpollBackend>(new EpollBackend(epfd));
+}
+
+EpollBackend::~EpollBackend()
+{
+    close(epfd_);
+}
+
+EpollBackend::FdState& EpollBackend::State(int fd)
+{
+    if (static_cast<size_t>(fd) >= fds_.size()) {
+        fds_.resize(fd + 1);
+    }
+    return fds_[fd];
+}
+
+bool EpollBackend::Update(int fd, FdState& s, uint32_t events)
+{
+    if (events == s.events) {
+        return true;
+    }
+    epoll_event ev = {};
+    ev.events = events;
+    ev.data.u64 = Key(fd, s.generation);
+    int op = s.events == 0 ? EPOLL_CTL_ADD : events == 0 ? EPOLL_CTL_DEL : EPOLL_CTL_MOD;
+    stats_.syscalls++;
+    if (epoll_ctl(epfd_, op, fd, &ev) < 0) {
+        return false;
+    }
+    s.events = events;
+    return true;
+}
+
+bool EpollBackend::AddDatagramSocket(int fd, uint32_t batch)
+{
+    FdState& s = State(fd);
+    s.ingest.reset(new UdpIngest(batch, false));
+    s.ingest->Attach(fd);
+    return Update(fd, s, s.events | EPOLLIN);
+}
+
+bool EpollBackend::AddReadable(int fd)
+{
+    FdState& s = State(fd);
+    s.readable = true;
+    return Update(fd, s, s.events | EPOLLIN);
+}
+
+void EpollBackend::Remove(int fd)
+{
+    FdState& s = State(fd);
+    Update(fd, s, 0);
+    uint32_t generation = s.generation + 1;
+    s = FdState();
+    s.generation = generation;
+    // completions queued for the old socket must not reach the next one with this number
+    for (Completion& c : done_) {
+        c.fd = c.fd == fd ? -1 : c.fd;
+    }
+}
+
+bool EpollBackend::Connect(int fd, const sockaddr* addr, socklen_t addr_len, const uint8_t* first, size_t first_len)
+{
+    FdState& s = State(fd);
+    s.buf = first;
+    s.len = first_len;
+    s.done = 0;
+    stats_.syscalls++;
+    if (connect(fd, addr, addr_len) == 0) {
+        done_.push_back({Done::kConnected, fd, 0});
+        if (s.len) {
+            StartWrite(fd, s);
+        }
+        return true;
+    }
+    if (errno != EINPROGRESS) {
+        done_.push_back({Done::kConnected, fd, -errno});
+        return true;
+    }
+    s.connecting = true;
+    s.started_ms = MonotonicMs();
+    return Update(fd, s, s.events | EPOLLOUT);
+}
+
+bool EpollBackend::Send(int fd, const uint8_t* buf, size_t len)
+{
+    FdState& s = State(fd);
+    if (s.sending || s.connecting) {
+        return false;
+    }
+    s.buf = buf;
+    s.len = len;
+    s.done = 0;
+    StartWrite(fd, s);
+    return true;
+}
+
+void EpollBackend::StartWrite(int fd, FdState& s)
+{
+    s.sending = true;
+    s.started_ms = MonotonicMs();
+    stats_.writes++;
+    ContinueWrite(fd, s);
+}
+
+void EpollBackend::ContinueWrite(int fd, FdState& s)
+{
+    while (s.done < s.len) {
+        stats_.syscalls++;
+        ssize_t n = send(fd, s.buf + s.done, s.len - s.done, MSG_NOSIGNAL | MSG_DONTWAIT);
+        if (n < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                Update(fd, s, s.events | EPOLLOUT);
+                return;
+            }
+            s.sending = false;
+            Update(fd, s, s.events & ~EPOLLOUT);
+            done_.push_back({Done::kSent, fd, -errno});
+            return;
+        }
+        s.done += static_cast<size_t>(n);
+    }
+    s.sending = false;
+    Update(fd, s, s.events & ~EPOLLOUT);
+    done_.push_back({Done::kSent, fd, static_cast<int>(s.len)});
+}
+
+void EpollBackend::Wait(int timeout_ms, IoHandler& handler)
+{
+    int64_t now = MonotonicMs();
+    if (!done_.empty()) {
+        timeout_ms = 0;
+    }
+    if (send_timeout_ms_) {
+        for (const FdState& s : fds_) {
+            if (s.sending || s.connecting) {
+                int64_t left = s.started_ms + send_timeout_ms_ - now;
+                timeout_ms = static_cast<int>(left < timeout_ms ? (left > 0 ? left : 0) : timeout_ms);
+            }
+        }
+    }
+    epoll_event events[kMaxEvents];
+    stats_.waits++;
+    stats_.syscalls++;
+    int n = epoll_wait(epfd_, events, kMaxEvents, timeout_ms);
+    for (int i = 0; i < n; i++) {
+        int fd = static_cast<int>(events[i].data.u64 & 0xFFFFFFFF);
+        uint32_t generation = static_cast<uint32_t>(events[i].data.u64 >> 32);
+        if (static_cast<size_t>(fd) >= fds_.size() || fds_[fd].generation != generation) {
+            continue;   // removed by a handler earlier in this round
+        }
+        uint32_t ev = events[i].events;
+        FdState* s = &fds_[fd];
+        if (s->ingest && (ev & EPOLLIN)) {
+            uint32_t received = 0;
+            while (received < kReceiveBudget) {
+                uint64_t calls = s->ingest->stats().calls;
+                PacketBatch batch = s->ingest->Receive();
+                stats_.syscalls += s->ingest->stats().calls - calls;
+                if (batch.count) {
+                    stats_.datagrams += batch.count;
+                    stats_.batches++;
+                    stats_.max_batch = batch.count > stats_.max_batch ? batch.count : stats_.max_batch;
+                    handler.OnDatagrams(fd, batch);
+                    s = &fds_[fd];
+                }
+                received += batch.count;
+                if (batch.count < s->ingest->batch()) {
+                    break;
+                }
+            }
+            stats_.truncated = 0;
+            for (const FdState& f : fds_) {
+                stats_.truncated += f.ingest ? f.ingest->stats().truncated : 0;
+            }
+        }
+        if ((ev & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && s->connecting) {
+            int err = 0;
+            socklen_t len = sizeof(err);
+            stats_.syscalls++;
+            getsockopt(fd, SOL_SOCKET, SO_ERROR, &err, &len);
+            s->connecting = false;
+            Update(fd, *s, s->events & ~EPOLLOUT);
+            done_.push_back({Done::kConnected, fd, -err});
+            if (err == 0 && s->len) {
+                StartWrite(fd, *s);
+            }
+        } else if ((ev & (EPOLLOUT | EPOLLERR | EPOLLHUP)) && s->sending) {
+            ContinueWrite(fd, *s);
+        }
+        if (s->readable && (ev & (EPOLLIN | EPOLLERR | EPOLLHUP))) {
+            handler.OnReadable(fd);
+        }
+    }
+    if (send_timeout_ms_) {
+        now = MonotonicMs();
+        for (size_t fd = 0; fd < fds_.size(); fd++) {
+            FdState& s = fds_[fd];
+            if ((s.sending || s.connecting) && now - s.started_ms >= send_timeout_ms_) {
+                done_.push_back({s.connecting ? Done::kConnected : Done::kSent, static_cast<int>(fd), -ETIME});
+                s.sending = s.connecting = false;
+                Update(static_cast<int>(fd), s, s.events & ~EPOLLOUT);
+            }
+        }
+    }
+    // handlers may queue more, those go out on the next round
+    dispatching_.swap(done_);
+    for (const Completion& c : dispatching_) {
+        if (c.fd < 0) {
+            continue;
+        }
+        if (c.what == Done::kConnected) {
+            handler.OnConnected(c.fd, c.result);
+        } else {
+            handler.OnSent(c.fd, c.result);
+        }
+    }
+    dispatching_.clear();
+}
+
+}  // namespace gateway
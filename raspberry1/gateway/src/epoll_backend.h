@@ -0,0 +1,64 @@
+/*
+ * I/O backend on epoll, the fallback for kernels without a usable io_uring.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "io_backend.h"
+
+namespace gateway {
+
+class EpollBackend : public IoBackend {
+public:
+    static std::unique_ptr<EpollBackend> Create(std::string* error);
+    ~EpollBackend() override;
+
+    const char* name() const override { return "epoll"; }
+    bool AddDatagramSocket(int fd, uint32_t batch) override;
+    bool AddReadable(int fd) override;
+    void Remove(int fd) override;
+    void RegisterSendBuffer(uint8_t*, size_t) override {}
+    bool Connect(int fd, const sockaddr* addr, socklen_t addr_len, const uint8_t* first, size_t first_len) override;
+    bool Send(int fd, const uint8_t* buf, size_t len) override;
+    void Wait(int timeout_ms, IoHandler& handler) override;
+
+private:
+    enum class Done : uint8_t { kConnected, kSent };
+
+    struct Completion {
+        Done what;
+        int fd;
+        int result;
+    };
+
+    struct FdState {
+        uint32_t generation = 0;
+        uint32_t events = 0;            // registered with epoll, 0 when not
+        bool readable = false;
+        std::unique_ptr<UdpIngest> ingest;
+        bool connecting = false;
+        bool sending = false;
+        const uint8_t* buf = nullptr;   // write in progress, or the first one after connecting
+        size_t len = 0;
+        size_t done = 0;
+        int64_t started_ms = 0;
+    };
+
+    explicit EpollBackend(int epfd) : epfd_(epfd) {}
+    FdState& State(int fd);
+    bool Update(int fd, FdState& s, uint32_t events);
+    void StartWrite(int fd, FdState& s);
+    void ContinueWrite(int fd, FdState& s);
+
+    int epfd_;
+    std::vector<FdState> fds_;
+    std::vector<Completion> done_;
+    std::vector<Completion> dispatching_;
+};
+
+}  // namespace gateway
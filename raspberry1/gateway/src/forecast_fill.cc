@@ -0,0 +1,71 @@
+/*
+ * Fills in the samples a node did not send.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "forecast_fill.h"
+
+namespace gateway {
+
+void ForecastFill::Init(int32_t tol_temp, int32_t tol_hum, uint32_t keyframe)
+{
+    forecast_init(&models_[0], tol_temp);
+    forecast_init(&models_[1], tol_hum);
+    keyframe_ = keyframe;
+    has_seq_ = false;
+    synced_ = false;
+}
+
+// true with the first missing sequence number in *from when there is a gap to fill
+bool ForecastFill::BeginGap(uint32_t seq, uint32_t* from)
+{
+    if (!has_seq_ || seq <= seq_) {
+        // first datagram or the node restarted
+        synced_ = false;
+        return false;
+    }
+    uint32_t first = seq_ + 1;
+    uint32_t gap = seq - first;
+    if (gap == 0) {
+        return false;
+    }
+    // a keyframe in the gap was lost, the models are out of step with the node
+    uint32_t next_keyframe = (first + keyframe_ - 1) / keyframe_ * keyframe_;
+    if (next_keyframe < seq) {
+        synced_ = false;
+    }
+    if (gap > kMaxFill) {
+        skipped_ += gap;
+        synced_ = false;
+        return false;
+    }
+    *from = first;
+    return true;
+}
+
+void ForecastFill::Predict(int32_t (&out)[kChannels])
+{
+    for (int i = 0; i < kChannels; i++) {
+        out[i] = synced_ ? forecast_skip(&models_[i]) : models_[i].last;
+    }
+}
+
+void ForecastFill::Accept(uint32_t seq, const int32_t (&values)[kChannels])
+{
+    for (int i = 0; i < kChannels; i++) {
+        if (seq % keyframe_ == 0) {
+            forecast_reset(&models_[i], values[i]);
+        } else if (synced_) {
+            forecast_observe(&models_[i], values[i]);
+        } else {
+            models_[i].last = values[i];
+        }
+    }
+    if (seq % keyframe_ == 0) {
+        synced_ = true;
+    }
+    seq_ = seq;
+    has_seq_ = true;
+}
+
+}  // namespace gateway
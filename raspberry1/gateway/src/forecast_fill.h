@@ -0,0 +1,60 @@
+/*
+ * Fills in the samples a node with CONFIG_FORECAST_ENABLE did not send.
+ *
+ * Port of Gateway in tools/forecast.py on top of the firmware's forecast.c, so the
+ * prediction here is the one the node made when it decided not to send.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstdint>
+
+#include "forecast.h"
+
+namespace gateway {
+
+class ForecastFill {
+public:
+    static constexpr int kChannels = 2;     // temp, hum in 0.01 units
+
+    void Init(int32_t tol_temp, int32_t tol_hum, uint32_t keyframe);
+
+    // Calls emit(seq, values, predicted) for every sample of the gap before seq, then
+    // for the received sample. Gaps longer than kMaxFill are not filled, only counted.
+    template <typename Emit>
+    void Receive(uint32_t seq, const int32_t (&values)[kChannels], Emit&& emit);
+
+    uint32_t skipped() const { return skipped_; }
+
+    static constexpr uint32_t kMaxFill = 120;
+
+private:
+    bool BeginGap(uint32_t seq, uint32_t* from);
+    void Predict(int32_t (&out)[kChannels]);
+    void Accept(uint32_t seq, const int32_t (&values)[kChannels]);
+
+    forecast_t models_[kChannels];
+    uint32_t keyframe_ = 30;
+    uint32_t seq_ = 0;
+    bool has_seq_ = false;
+    bool synced_ = false;
+    uint32_t skipped_ = 0;     // samples the gap limit left out
+};
+
+template <typename Emit>
+void ForecastFill::Receive(uint32_t seq, const int32_t (&values)[kChannels], Emit&& emit)
+{
+    uint32_t from;
+    if (BeginGap(seq, &from)) {
+        for (uint32_t s = from; s != seq; s++) {
+            int32_t predicted[kChannels];
+            Predict(predicted);
+            emit(s, predicted, true);
+        }
+    }
+    Accept(seq, values);
+    emit(seq, values, false);
+}
+
+}  // namespace gateway
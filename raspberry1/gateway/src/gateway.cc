@@ -0,0 +1,919 @@
+/*
+ * The gateway's event loop.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "gateway.h"
+
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+#include <ctime>
+#include <vector>
+
+#include "log.h"
+#include "responder.h"
+#include "udp_socket.h"
+
+namespace gateway {
+
+namespace {
+
+constexpr int kReceiveBufferBytes = 1 << 20;
+constexpr int64_t kDrainMs = 2000;
+// records taken from each rx worker per loop round, the broker connection is served between
+constexpr uint32_t kWorkerBudget = 256;
+// the loop wakes at least this often while it replays the spool
+constexpr int64_t kReplayTickMs = 10;
+
+// histogram buckets of the scrape, 1-2-5 steps; the recorded ones are finer
+constexpr uint64_t kNsBounds[] = {
+    100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000, 2000000,
+    5000000, 10000000, 20000000, 50000000, 100000000, 200000000, 500000000, 1000000000, 2000000000,
+    5000000000, 10000000000,
+};
+constexpr uint64_t kDepthBounds[] = {
+    0, 1, 2, 5, 10, 20, 50, 100, 200, 500, 1000, 2000, 5000, 10000, 20000, 50000, 100000, 200000, 500000, 1000000,
+};
+
+// topic names of the #PROBE fields, in the order of kProbeFields
+constexpr std::string_view kProbeTopics[] = {
+    "linkSent", "linkReceived", "linkLost", "linkLate", "linkDuplicate", "linkLossPermille", "linkRttMin",
+    "linkRttP50", "linkRttP90", "linkRttP99", "linkRttMax", "linkSrtt", "linkJitter", "linkRto",
+};
+static_assert(sizeof(kProbeTopics) / sizeof(kProbeTopics[0]) == sizeof(kProbeFields) / sizeof(kProbeFields[0]),
+              "one topic per #PROBE field");
+
+std::string_view MeasurementName(std::string_view key)
+{
+    if (key == "temp") {
+        return "airTemperature";
+    }
+    if (key == "hum") {
+        return "airHumidity";
+    }
+    return key;
+}
+
+// <prefix>/<node id>/<measurement>, the node id only with node_topics; a combined
+// message has no measurement and always the node id
+size_t MakeTopic(const Config& c, std::string_view node_id, std::string_view measurement,
+                 char (&topic)[MqttClient::kTopicMax])
+{
+    size_t len = 0;
+    auto put = [&](std::string_view part) {
+        size_t n = std::min(part.size(), sizeof(topic) - len);
+        std::memcpy(topic + len, part.data(), n);
+        len += n;
+    };
+    put(c.topic_prefix);
+    if (c.node_topics || measurement.empty()) {
+        put("/");
+        put(node_id);
+    }
+    if (!measurement.empty()) {
+        put("/");
+        put(measurement);
+    }
+    return len;
+}
+
+QueuePolicy MakeQueuePolicy(const std::string& name)
+{
+    return name == "latest"        ? QueuePolicy::kLatest
+           : name == "drop_newest" ? QueuePolicy::kDropNewest
+           : name == "block"       ? QueuePolicy::kBlock
+                                   : QueuePolicy::kDropOldest;
+}
+
+MqttOptions MakeMqttOptions(const Config& c)
+{
+    MqttOptions o;
+    o.host = c.broker;
+    o.port = c.broker_port;
+    o.client_id = c.client_id;
+    o.username = c.username;
+    o.password = c.password;
+    o.keepalive_s = c.keepalive_s;
+    o.qos = c.qos;
+    o.queue_size = c.queue_size;
+    o.policy = MakeQueuePolicy(c.queue_policy);
+    o.max_inflight = c.max_inflight;
+    return o;
+}
+
+SpoolOptions MakeSpoolOptions(const Config& c)
+{
+    SpoolOptions o;
+    o.dir = c.spool_dir;
+    o.sync = c.spool_fsync == "always"  ? SpoolSync::kAlways
+             : c.spool_fsync == "never" ? SpoolSync::kNever
+                                        : SpoolSync::kInterval;
+    o.sync_ms = c.spool_fsync_ms;
+    o.segment_bytes = c.spool_segment_kb * 1024;
+    o.max_bytes = static_cast<uint64_t>(c.spool_max_mb) << 20;
+    o.compact_ms = c.spool_compact_s * 1000;
+    return o;
+}
+
+MetricsOptions MakeMetricsOptions(const Config& c)
+{
+    MetricsOptions o;
+    o.listen = c.metrics_listen;
+    o.port = c.metrics_port;
+    return o;
+}
+
+int64_t WallMs()
+{
+    timespec ts;
+    clock_gettime(CLOCK_REALTIME, &ts);
+    return static_cast<int64_t>(ts.tv_sec) * 1000 + ts.tv_nsec / 1000000;
+}
+
+RxOptions MakeRxOptions(const Config& c, IoBackend::Kind io, NodeStatsTable* node_stats)
+{
+    RxOptions o;
+    o.listen = c.listen;
+    o.port = c.port;
+    o.workers = c.rx_workers;
+    o.batch = c.rx_batch;
+    o.rcvbuf_bytes = kReceiveBufferBytes;
+    o.busy_poll_us = c.busy_poll_us;
+    o.pin = c.rx_pin;
+    o.steer_by_node = c.rx_steer == "node";
+    o.drop_when_full = c.rx_queue_policy == "drop_newest";
+    o.io = io;
+    o.node_stats = node_stats;
+    return o;
+}
+
+}  // namespace
+
+Gateway::Gateway(const Config& config)
+    : config_(config),
+      nodes_(config.max_nodes, config.forecast_tol_temp, config.forecast_tol_hum, config.forecast_keyframe),
+      node_stats_(config.max_nodes),
+      mqtt_(MakeMqttOptions(config))
+{
+}
+
+Gateway::~Gateway()
+{
+    if (rx_ && io_) {
+        io_->Remove(rx_->wake_fd());
+    }
+    for (int fd : {sensor_fd_, discovery_fd_, probe_fd_}) {
+        if (fd >= 0) {
+            if (io_) {
+                io_->Remove(fd);
+            }
+            close(fd);
+        }
+    }
+}
+
+bool Gateway::Open(std::string* error)
+{
+    struct {
+        int* fd;
+        uint16_t port;
+        int rcvbuf;
+    } sockets[] = {
+        // the rx workers bind their own sensor sockets
+        {&sensor_fd_, config_.rx_workers ? uint16_t(0) : config_.port, kReceiveBufferBytes},
+        {&discovery_fd_, config_.discovery_port, 0},
+        {&probe_fd_, config_.probe_port, 0},
+    };
+    for (auto& s : sockets) {
+        if (s.port == 0) {
+            continue;
+        }
+        *s.fd = OpenUdp(config_.listen, s.port, s.rcvbuf);
+        if (*s.fd < 0) {
+            if (error) {
+                *error = "udp " + config_.listen + ":" + std::to_string(s.port) + ": " + strerror(errno);
+            }
+            return false;
+        }
+    }
+    if (sensor_fd_ >= 0 && config_.busy_poll_us && !SetBusyPoll(sensor_fd_, config_.busy_poll_us)) {
+        GW_LOGW("SO_BUSY_POLL refused (%s), spinning in user space only", strerror(errno));
+    }
+
+    IoBackend::Kind kind = config_.io_backend == "uring"   ? IoBackend::Kind::kUring
+                           : config_.io_backend == "epoll" ? IoBackend::Kind::kEpoll
+                                                           : IoBackend::Kind::kAuto;
+    io_ = IoBackend::Create(kind, error);
+    if (!io_) {
+        return false;
+    }
+    if (sensor_fd_ >= 0 && !io_->AddDatagramSocket(sensor_fd_, config_.rx_batch)) {
+        if (error) {
+            *error = std::string(io_->name()) + " sensor socket: " + strerror(errno);
+        }
+        return false;
+    }
+    for (int fd : {discovery_fd_, probe_fd_}) {
+        if (fd >= 0) {
+            io_->AddReadable(fd);
+        }
+    }
+    if (config_.rx_workers) {
+        rx_ = std::make_unique<RxWorkers>(MakeRxOptions(config_, kind, &node_stats_));
+        if (!rx_->Open(error)) {
+            rx_.reset();
+            return false;
+        }
+        io_->AddReadable(rx_->wake_fd());
+    }
+    if (!config_.spool_dir.empty()) {
+        spool_ = std::make_unique<Spool>(MakeSpoolOptions(config_));
+        if (!spool_->Open(error)) {
+            spool_.reset();
+            return false;
+        }
+    }
+    if (config_.metrics_port) {
+        metrics_ = std::make_unique<MetricsServer>(MakeMetricsOptions(config_),
+                                                   [this](MetricsText& out) { WriteMetrics(out); });
+        if (!metrics_->Open(io_.get(), error)) {
+            metrics_.reset();
+            return false;
+        }
+        GW_LOGI("metrics on http://%s:%u/metrics", config_.metrics_listen.c_str(), metrics_->port());
+    }
+    mqtt_.SetIo(io_.get());
+    GW_LOGI("I/O on %s", io_->name());
+    GW_LOGI("listening on %s:%u (discovery %u, probes %u), publishing to %s:%u under %s",
+            config_.listen.c_str(), config_.port, config_.discovery_port, config_.probe_port,
+            config_.broker.c_str(), config_.broker_port, config_.topic_prefix.c_str());
+    return true;
+}
+
+void Gateway::Publish(std::string_view topic, std::string_view payload)
+{
+    // a spool that cannot write leaves the message to the queue's policy
+    if (spool_ && (!mqtt_.connected() || mqtt_.space() == 0) && spool_->Append(wall_ms_, topic, payload)) {
+        return;
+    }
+    mqtt_.Publish(topic, payload, true, ingest_ns_);
+}
+
+void Gateway::CommitSpool()
+{
+    uint32_t count = 0;
+    while (!replayed_.empty() && static_cast<int32_t>(mqtt_.retired() - replayed_.front()) > 0) {
+        replayed_.pop_front();
+        count++;
+    }
+    if (count > 0) {
+        spool_->Commit(count);
+    }
+}
+
+void Gateway::SaveToSpool()
+{
+    CommitSpool();
+    // Replayed messages come from the spool again with its cursor, the live ones the
+    // client still has are appended after them, in the order it had them.
+    uint64_t saved = 0;
+    mqtt_.ForEachPending([&](uint32_t number, std::string_view topic, std::string_view payload) {
+        while (!replayed_.empty() && static_cast<int32_t>(number - replayed_.front()) > 0) {
+            replayed_.pop_front();
+        }
+        if (!replayed_.empty() && replayed_.front() == number) {
+            return;
+        }
+        saved += spool_->Append(wall_ms_, topic, payload);
+    });
+    if (saved > 0) {
+        GW_LOGI("spool: %llu messages the broker did not acknowledge saved for the next start",
+                static_cast<unsigned long long>(saved));
+    }
+}
+
+void Gateway::ReplaySpool(int64_t now_ms)
+{
+    CommitSpool();
+    if (!mqtt_.connected()) {
+        replay_ms_ = 0;
+        return;
+    }
+    double rate = config_.spool_replay_rate;
+    if (replay_ms_) {
+        replay_credit_ = std::min(replay_credit_ + (now_ms - replay_ms_) * rate / 1000, std::max(1.0, rate / 10));
+    }
+    replay_ms_ = now_ms;
+    // three quarters of the queue stay free for the live messages
+    uint32_t room = std::max(1u, mqtt_.capacity() / 4);
+    SpoolMessage m;
+    while (replay_credit_ >= 1 && mqtt_.depth() < room && spool_->Next(&m)) {
+        replay_credit_--;
+        uint32_t number = mqtt_.pushed();
+        if (mqtt_.Publish(m.topic, m.payload, false)) {
+            replayed_.push_back(number);
+            continue;
+        }
+        // below room only a message too long for a slot, which no later round takes
+        // either: committed with the replayed one before it, counted as lost
+        GW_LOGD("spool: %.*s refused by the client", static_cast<int>(m.topic.size()), m.topic.data());
+        spool_->Refuse();
+        if (replayed_.empty()) {
+            spool_->Commit(1);
+        } else {
+            replayed_.push_back(replayed_.back());
+        }
+    }
+}
+
+void Gateway::PublishValue(std::string_view node_id, std::string_view measurement, std::string_view payload)
+{
+    char topic[MqttClient::kTopicMax];
+    size_t len = MakeTopic(config_, node_id, measurement, topic);
+    Publish(std::string_view(topic, len), payload);
+}
+
+bool Gateway::PublishCombined(std::string_view node_id, uint32_t count, const std::string_view* names,
+                              const std::string_view* values)
+{
+    char payload[MqttClient::kPayloadMax];
+    size_t len = 0;
+    bool fits = true;
+    auto put = [&](std::string_view part) {
+        fits = fits && part.size() <= sizeof(payload) - len;
+        if (fits) {
+            std::memcpy(payload + len, part.data(), part.size());
+            len += part.size();
+        }
+    };
+    for (uint32_t i = 0; i < count; i++) {
+        put(i == 0 ? "{\"" : ",\"");
+        put(names[i]);
+        put("\":");
+        put(values[i]);
+    }
+    put("}");
+    if (!fits) {
+        return false;
+    }
+    char topic[MqttClient::kTopicMax];
+    size_t topic_len = MakeTopic(config_, node_id, {}, topic);
+    Publish(std::string_view(topic, topic_len), std::string_view(payload, len));
+    return true;
+}
+
+void Gateway::PublishSample(std::string_view node_id, uint32_t count, const std::string_view* names,
+                            const std::string_view* values)
+{
+    if (config_.combine_fields && PublishCombined(node_id, count, names, values)) {
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        PublishValue(node_id, names[i], values[i]);
+    }
+}
+
+void Gateway::HandleSample(const Record& record, const sockaddr_in& from, int64_t now_ms)
+{
+    Node& node = nodes_.Get(record.node_id, from, now_ms);
+    if (!rx_) {
+        node_stats_.Update(record, now_ms);
+    }
+    const Field* temp = record.Find("temp");
+    const Field* hum = record.Find("hum");
+    auto publish_fields = [&]() {
+        std::string_view names[kMaxFields];
+        std::string_view values[kMaxFields];
+        for (uint32_t i = 0; i < record.num_fields; i++) {
+            names[i] = MeasurementName(record.fields[i].key);
+            values[i] = record.fields[i].text;
+        }
+        PublishSample(node.Id(), record.num_fields, names, values);
+        node.samples++;
+        stats_.samples++;
+    };
+    if (!record.has_seq || temp == nullptr || hum == nullptr) {
+        publish_fields();
+        return;
+    }
+    const int32_t values[ForecastFill::kChannels] = {
+        static_cast<int32_t>(std::lround(temp->value * 100)),
+        static_cast<int32_t>(std::lround(hum->value * 100)),
+    };
+    node.forecast.Receive(record.seq, values, [&](uint32_t, const int32_t (&v)[ForecastFill::kChannels], bool predicted) {
+        if (!predicted) {
+            publish_fields();
+            return;
+        }
+        node.predicted++;
+        stats_.predicted++;
+        if (config_.publish_predicted) {
+            char text[2][16];
+            const std::string_view names[] = { "airTemperature", "airHumidity" };
+            const std::string_view values[] = {
+                std::string_view(text[0], std::snprintf(text[0], sizeof(text[0]), "%.2f", v[0] / 100.0)),
+                std::string_view(text[1], std::snprintf(text[1], sizeof(text[1]), "%.2f", v[1] / 100.0)),
+            };
+            PublishSample(node.Id(), 2, names, values);
+        }
+    });
+}
+
+void Gateway::HandleProbe(const Record& record, const sockaddr_in& from)
+{
+    stats_.probes++;
+    // the line carries no id, it comes from the socket the node's samples come from
+    Node* node = nodes_.FindByAddr(from);
+    if (node == nullptr) {
+        stats_.probes_unknown++;
+        GW_LOGD("#PROBE from %s before any sample, not published", FormatAddr(from).c_str());
+        return;
+    }
+    for (uint32_t i = 0; i < record.num_fields; i++) {
+        PublishValue(node->Id(), kProbeTopics[i], record.fields[i].text);
+    }
+}
+
+void Gateway::HandleDatagram(std::string_view text, const sockaddr_in& from, int64_t now_ms)
+{
+    Record record;
+    ParseDatagram(text, record);
+    HandleRecord(record, text, from, now_ms);
+}
+
+void Gateway::HandleRecord(const Record& record, std::string_view text, const sockaddr_in& from, int64_t now_ms)
+{
+    stats_.datagrams++;
+    if (config_.verbose) {
+        GW_LOGI("Received from %s: %.*s", FormatAddr(from).c_str(), static_cast<int>(text.size()), text.data());
+    }
+    if (record.kind == RecordKind::kInvalid) {
+        stats_.invalid++;
+        GW_LOGD("invalid datagram from %s", FormatAddr(from).c_str());
+        return;
+    }
+    if (record.kind == RecordKind::kProbe) {
+        HandleProbe(record, from);
+    } else {
+        HandleSample(record, from, now_ms);
+    }
+}
+
+void Gateway::HandleBatch(const PacketBatch& batch, int64_t now_ms)
+{
+    // parsed a chunk at a time, so the parser walks the slots back to back
+    constexpr uint32_t kChunk = 16;
+    std::string_view texts[kChunk];
+    Record records[kChunk];
+    Record* out[kChunk];
+    for (uint32_t i = 0; i < kChunk; i++) {
+        out[i] = &records[i];
+    }
+    for (uint32_t first = 0; first < batch.count; first += kChunk) {
+        uint32_t n = std::min(kChunk, batch.count - first);
+        for (uint32_t i = 0; i < n; i++) {
+            texts[i] = batch.slots[first + i]->text();
+        }
+        int64_t parse_start = MonotonicNs();
+        ParseDatagrams(n, texts, out);
+        parse_ns_.Record(static_cast<uint64_t>(MonotonicNs() - parse_start) / n, n);
+        for (uint32_t i = 0; i < n; i++) {
+            HandleRecord(records[i], texts[i], batch.slots[first + i]->from, now_ms);
+        }
+    }
+}
+
+uint32_t Gateway::WorkerBudget() const
+{
+    if (config_.queue_policy != "block") {
+        return kWorkerBudget;
+    }
+    // room in the publish queue for every record taken, a record is at most kMaxFields
+    // messages (a forecast fill can be more, the queue then pushes out its oldest)
+    return std::min(kWorkerBudget, static_cast<uint32_t>(mqtt_.space() / kMaxFields) / rx_->size());
+}
+
+uint32_t Gateway::DrainWorkers(uint32_t budget)
+{
+    uint32_t drained = rx_->Drain(budget, [this](const RxItem& item) {
+        ingest_ns_ = item.rx_ns;
+        HandleRecord(item.record, item.Text(), item.from, item.now_ms);
+    });
+    ingest_ns_ = 0;
+    return drained;
+}
+
+void Gateway::OnDatagrams(int fd, const PacketBatch& batch)
+{
+    if (fd == sensor_fd_) {
+        ingest_ns_ = MonotonicNs();
+        HandleBatch(batch, ingest_ns_ / 1000000);
+        ingest_ns_ = 0;
+        received_ += batch.count;
+    }
+}
+
+void Gateway::OnReadable(int fd)
+{
+    if (fd == mqtt_.fd()) {
+        mqtt_.OnReadable(MonotonicMs());
+    } else if (fd == discovery_fd_) {
+        stats_.discovery += AnswerDiscovery(discovery_fd_);
+    } else if (fd == probe_fd_) {
+        stats_.reflected += ReflectProbes(probe_fd_);
+    } else if (rx_ && fd == rx_->wake_fd()) {
+        rx_->ClearWake();
+    } else if (metrics_ && metrics_->Owns(fd)) {
+        metrics_->OnReadable(fd, MonotonicMs());
+    }
+}
+
+void Gateway::OnConnected(int fd, int result)
+{
+    if (fd == mqtt_.fd()) {
+        mqtt_.OnConnected(result, MonotonicMs());
+    }
+}
+
+void Gateway::OnSent(int fd, int result)
+{
+    if (fd == mqtt_.fd()) {
+        mqtt_.OnSent(result, MonotonicMs());
+    } else if (metrics_ && metrics_->Owns(fd)) {
+        metrics_->OnSent(fd, result);
+    }
+}
+
+void Gateway::LogStats()
+{
+    const MqttStats& m = mqtt_.stats();
+    GW_LOGI("datagrams %llu invalid %llu samples %llu predicted %llu probes %llu nodes %u evicted %llu | "
+            "published %llu acked %llu dropped %llu pending %u %s connects %llu | discovery %llu reflected %llu",
+            static_cast<unsigned long long>(stats_.datagrams), static_cast<unsigned long long>(stats_.invalid),
+            static_cast<unsigned long long>(stats_.samples), static_cast<unsigned long long>(stats_.predicted),
+            static_cast<unsigned long long>(stats_.probes), nodes_.size(),
+            static_cast<unsigned long long>(nodes_.evicted()), static_cast<unsigned long long>(m.sent),
+            static_cast<unsigned long long>(m.acked), static_cast<unsigned long long>(m.dropped), mqtt_.pending(),
+            mqtt_.connected() ? "connected" : "disconnected", static_cast<unsigned long long>(m.connects),
+            static_cast<unsigned long long>(stats_.discovery), static_cast<unsigned long long>(stats_.reflected));
+    // a round trip is a read that brought PUBACKs, one per message with max_inflight = 1
+    int64_t now = MonotonicMs();
+    double seconds = last_stats_ms_ && now > last_stats_ms_ ? (now - last_stats_ms_) / 1000.0 : 0.0;
+    GW_LOGI("mqtt: %.1f messages/s, %.2f messages and %.3f broker round trips per sample, %llu resent, "
+            "%u in flight at most%s",
+            seconds > 0 ? (m.sent - last_sent_) / seconds : 0.0,
+            stats_.samples ? static_cast<double>(m.sent) / stats_.samples : 0.0,
+            stats_.samples ? static_cast<double>(m.round_trips) / stats_.samples : 0.0,
+            static_cast<unsigned long long>(m.resent), config_.qos ? config_.max_inflight : 0,
+            config_.combine_fields ? ", fields combined" : "");
+    last_stats_ms_ = now;
+    last_sent_ = m.sent;
+    HistogramCounts publish, ack, parse, depth;
+    mqtt_.publish_latency().CollectInto(&publish);
+    mqtt_.ack_latency().CollectInto(&ack);
+    parse_ns_.CollectInto(&parse);
+    for (uint32_t i = 0; rx_ && i < rx_->size(); i++) {
+        rx_->stats(i).parse_ns.CollectInto(&parse);
+    }
+    depth_.CollectInto(&depth);
+    GW_LOGI("latency: ingest to write p50 %.3f p99 %.3f max %.3f ms, to PUBACK p50 %.3f p99 %.3f max %.3f ms | "
+            "parse p50 %llu p99 %llu ns per datagram | publish queue p50 %llu p99 %llu deep",
+            publish.Quantile(0.5) / 1e6, publish.Quantile(0.99) / 1e6, publish.Quantile(1) / 1e6,
+            ack.Quantile(0.5) / 1e6, ack.Quantile(0.99) / 1e6, ack.Quantile(1) / 1e6,
+            static_cast<unsigned long long>(parse.Quantile(0.5)), static_cast<unsigned long long>(parse.Quantile(0.99)),
+            static_cast<unsigned long long>(depth.Quantile(0.5)), static_cast<unsigned long long>(depth.Quantile(0.99)));
+    // the queue of every stage: socket buffers, rx rings, publish queue
+    uint64_t socket_queued = 0, socket_size = 0, socket_drops = 0;
+    auto add_socket = [&](int fd) {
+        SocketBacklog b;
+        if (fd >= 0 && ReadSocketBacklog(fd, &b)) {
+            socket_queued += b.queued_bytes;
+            socket_size += b.buffer_bytes;
+            socket_drops += b.drops;
+        }
+    };
+    add_socket(sensor_fd_);
+    uint32_t ring_depth = 0, ring_capacity = 0;
+    uint64_t ring_dropped = 0;
+    for (uint32_t i = 0; rx_ && i < rx_->size(); i++) {
+        add_socket(rx_->fd(i));
+        ring_depth += rx_->depth(i);
+        ring_capacity += rx_->ring_capacity(i);
+        ring_dropped += rx_->stats(i).dropped.load(std::memory_order_relaxed);
+    }
+    GW_LOGI("queues: sockets %llu of %llu bytes, %llu dropped | rx rings %u of %u, %llu dropped (%s) | "
+            "publish %u of %u, at most %u, %llu dropped, %llu replaced (%s), rx held %llu rounds",
+            static_cast<unsigned long long>(socket_queued), static_cast<unsigned long long>(socket_size),
+            static_cast<unsigned long long>(socket_drops), ring_depth, ring_capacity,
+            static_cast<unsigned long long>(ring_dropped), config_.rx_queue_policy.c_str(), mqtt_.depth(),
+            mqtt_.capacity(), m.max_depth, static_cast<unsigned long long>(m.dropped),
+            static_cast<unsigned long long>(m.replaced), config_.queue_policy.c_str(),
+            static_cast<unsigned long long>(stats_.held));
+    if (spool_) {
+        const SpoolStats& sp = spool_->stats();
+        GW_LOGI("spool: %llu messages waiting in %u segments, %.1f of %u MB | spooled %llu replayed %llu "
+                "committed %llu refused %llu compacted %llu evicted %llu lost %llu failed %llu | %llu syncs, "
+                "per message byte %.2f written and %.2f on the device",
+                static_cast<unsigned long long>(spool_->backlog()), spool_->segments(),
+                spool_->bytes() / 1048576.0, config_.spool_max_mb, static_cast<unsigned long long>(sp.appended),
+                static_cast<unsigned long long>(sp.replayed), static_cast<unsigned long long>(sp.committed),
+                static_cast<unsigned long long>(sp.refused), static_cast<unsigned long long>(sp.compacted),
+                static_cast<unsigned long long>(sp.evicted), static_cast<unsigned long long>(sp.corrupt),
+                static_cast<unsigned long long>(sp.failed), static_cast<unsigned long long>(sp.syncs),
+                sp.message_bytes ? static_cast<double>(sp.written_bytes) / sp.message_bytes : 0.0,
+                sp.message_bytes ? static_cast<double>(sp.device_bytes) / sp.message_bytes : 0.0);
+    }
+    if (io_) {
+        const IoStats& io = io_->stats();
+        GW_LOGI("%s: %llu syscalls (%llu waits) for %llu datagrams (%.3f per datagram), %llu batches, "
+                "largest %u, truncated %llu, writes %llu (%llu short)",
+                io_->name(), static_cast<unsigned long long>(io.syscalls), static_cast<unsigned long long>(io.waits),
+                static_cast<unsigned long long>(io.datagrams),
+                io.datagrams ? static_cast<double>(io.syscalls) / io.datagrams : 0.0,
+                static_cast<unsigned long long>(io.batches), io.max_batch,
+                static_cast<unsigned long long>(io.truncated), static_cast<unsigned long long>(io.writes),
+                static_cast<unsigned long long>(io.short_writes));
+    }
+    for (uint32_t i = 0; rx_ && i < rx_->size(); i++) {
+        const RxWorkerStats& w = rx_->stats(i);
+        uint64_t datagrams = w.datagrams.load(std::memory_order_relaxed);
+        uint64_t syscalls = w.syscalls.load(std::memory_order_relaxed);
+        GW_LOGI("rx worker %u (cpu %d, %s): %llu datagrams in %llu batches, %.3f syscalls per datagram, "
+                "truncated %llu, ring %u deep, stalled %llu, dropped %llu",
+                i, rx_->cpu(i), rx_->backend(i), static_cast<unsigned long long>(datagrams),
+                static_cast<unsigned long long>(w.batches.load(std::memory_order_relaxed)),
+                datagrams ? static_cast<double>(syscalls) / datagrams : 0.0,
+                static_cast<unsigned long long>(w.truncated.load(std::memory_order_relaxed)), rx_->depth(i),
+                static_cast<unsigned long long>(w.stalls.load(std::memory_order_relaxed)),
+                static_cast<unsigned long long>(w.dropped.load(std::memory_order_relaxed)));
+    }
+    // a node is silent after three of its intervals without a sample, a minute before it has one
+    uint32_t flagged[4] = {};
+    uint32_t silent = 0;
+    uint64_t missing = 0;
+    node_stats_.ForEach([&](const NodeStats& n) {
+        for (int bit = 0; bit < 4; bit++) {
+            flagged[bit] += (n.flags >> bit) & 1;
+        }
+        int64_t quiet_ms = n.interval_ms ? 3 * static_cast<int64_t>(n.interval_ms) : 60000;
+        silent += now - n.last_seen_ms > quiet_ms;
+        missing += n.missing;
+        GW_LOGD("node %.*s: %u samples, seq %u, %u missing, every %u ms, temp %.2f hum %.2f, seen %lld ms ago%s%s%s%s",
+                static_cast<int>(n.id_len), n.id, n.samples, n.last_seq, n.missing, n.interval_ms, n.temp / 100.0,
+                n.hum / 100.0, static_cast<long long>(now - n.last_seen_ms), n.flags & kNodeGap ? ", gap" : "",
+                n.flags & kNodeLate ? ", late" : "", n.flags & kNodeRestarted ? ", restarted" : "",
+                n.flags & kNodeOutOfRange ? ", out of range" : "");
+    });
+    GW_LOGI("nodes tracked %u untracked samples %llu, missing seq %llu | last sample: gap %u late %u restarted %u "
+            "out of range %u | silent %u",
+            node_stats_.size(), static_cast<unsigned long long>(node_stats_.untracked()),
+            static_cast<unsigned long long>(missing), flagged[0], flagged[1], flagged[2], flagged[3], silent);
+}
+
+void Gateway::WriteMetrics(MetricsText& out) const
+{
+    auto counter = [&](std::string_view name, std::string_view help, uint64_t value) {
+        out.Family(name, "counter", help);
+        out.Sample(name, {}, value);
+    };
+    auto gauge = [&](std::string_view name, std::string_view help, double value) {
+        out.Family(name, "gauge", help);
+        out.Sample(name, {}, value);
+    };
+    auto histogram = [&](std::string_view name, std::string_view help, const HistogramCounts& counts,
+                         const uint64_t* bounds, size_t num_bounds, double scale) {
+        out.Family(name, "histogram", help);
+        out.HistogramSeries(name, {}, counts, bounds, num_bounds, scale);
+    };
+    constexpr size_t kNsCount = sizeof(kNsBounds) / sizeof(kNsBounds[0]);
+    constexpr size_t kDepthCount = sizeof(kDepthBounds) / sizeof(kDepthBounds[0]);
+
+    counter("gateway_datagrams_total", "Datagrams from the nodes.", stats_.datagrams);
+    counter("gateway_invalid_datagrams_total", "Datagrams neither a sample nor a probe line.", stats_.invalid);
+    counter("gateway_samples_total", "Samples published.", stats_.samples);
+    counter("gateway_predicted_samples_total", "Samples a forecasting node skipped.", stats_.predicted);
+    counter("gateway_probe_lines_total", "#PROBE lines from the nodes.", stats_.probes);
+    counter("gateway_discovery_answers_total", "Discovery queries answered.", stats_.discovery);
+    counter("gateway_probes_reflected_total", "Link probes reflected.", stats_.reflected);
+    counter("gateway_rx_held_rounds_total", "Loop rounds the rx rings waited for room in the publish queue.",
+            stats_.held);
+
+    const MqttStats& m = mqtt_.stats();
+    gauge("gateway_mqtt_connected", "1 while connected to the broker.", mqtt_.connected() ? 1 : 0);
+    counter("gateway_mqtt_connects_total", "Connections the broker accepted.", m.connects);
+    counter("gateway_mqtt_queued_total", "Messages accepted by the publish queue.", m.queued);
+    counter("gateway_mqtt_sent_total", "PUBLISH packets written, resends included.", m.sent);
+    counter("gateway_mqtt_acked_total", "Messages acknowledged, all of them with QoS 0.", m.acked);
+    counter("gateway_mqtt_resent_total", "PUBLISH packets sent again after a reconnect.", m.resent);
+    counter("gateway_mqtt_dropped_total", "Messages the full publish queue pushed out or refused.", m.dropped);
+    counter("gateway_mqtt_replaced_total", "Queued messages a newer one of their topic overwrote.", m.replaced);
+    counter("gateway_mqtt_round_trips_total", "Reads that brought PUBACKs.", m.round_trips);
+    gauge("gateway_publish_queue_messages", "Messages waiting in the publish queue.", mqtt_.depth());
+    gauge("gateway_publish_queue_capacity", "Slots of the publish queue.", mqtt_.capacity());
+    gauge("gateway_mqtt_inflight_messages", "QoS 1 messages waiting for their PUBACK.", mqtt_.pending() - mqtt_.depth());
+
+    HistogramCounts publish, ack, parse, depth;
+    mqtt_.publish_latency().CollectInto(&publish);
+    mqtt_.ack_latency().CollectInto(&ack);
+    parse_ns_.CollectInto(&parse);
+    depth_.CollectInto(&depth);
+    for (uint32_t i = 0; rx_ && i < rx_->size(); i++) {
+        rx_->stats(i).parse_ns.CollectInto(&parse);
+    }
+    histogram("gateway_ingest_to_publish_seconds", "From the datagram's receive to the first write of its message.",
+              publish, kNsBounds, kNsCount, 1e-9);
+    histogram("gateway_ingest_to_ack_seconds", "From the datagram's receive to the PUBACK of its message.", ack,
+              kNsBounds, kNsCount, 1e-9);
+    histogram("gateway_parse_seconds", "Parse time per datagram.", parse, kNsBounds, kNsCount, 1e-9);
+    histogram("gateway_publish_queue_depth", "Messages in the publish queue, every loop round.", depth, kDepthBounds,
+              kDepthCount, 1);
+
+    if (io_) {
+        const IoStats& io = io_->stats();
+        counter("gateway_io_syscalls_total", "Syscalls of the loop's I/O backend, waits included.", io.syscalls);
+        counter("gateway_io_batches_total", "Datagram batches the loop's I/O backend received.", io.batches);
+        counter("gateway_io_truncated_total", "Datagrams longer than a slot.", io.truncated);
+    }
+    if (rx_) {
+        std::vector<std::string> labels;
+        for (uint32_t i = 0; i < rx_->size(); i++) {
+            labels.push_back(MetricsText::Label("worker", std::to_string(i)));
+        }
+        auto per_worker = [&](std::string_view name, std::string_view type, std::string_view help, auto value) {
+            out.Family(name, type, help);
+            for (uint32_t i = 0; i < rx_->size(); i++) {
+                out.Sample(name, labels[i], static_cast<uint64_t>(value(i)));
+            }
+        };
+        per_worker("gateway_rx_datagrams_total", "counter", "Datagrams an rx worker received.",
+                   [&](uint32_t i) { return rx_->stats(i).datagrams.load(std::memory_order_relaxed); });
+        per_worker("gateway_rx_dropped_total", "counter", "Datagrams an rx worker found no room for.",
+                   [&](uint32_t i) { return rx_->stats(i).dropped.load(std::memory_order_relaxed); });
+        per_worker("gateway_rx_stalls_total", "counter", "Batches an rx worker waited for room with.",
+                   [&](uint32_t i) { return rx_->stats(i).stalls.load(std::memory_order_relaxed); });
+        per_worker("gateway_rx_ring_messages", "gauge", "Datagrams waiting in an rx worker's ring.",
+                   [&](uint32_t i) { return rx_->depth(i); });
+    }
+    uint64_t socket_drops = 0;
+    auto add_socket = [&](int fd) {
+        SocketBacklog b;
+        if (fd >= 0 && ReadSocketBacklog(fd, &b)) {
+            socket_drops += b.drops;
+        }
+    };
+    add_socket(sensor_fd_);
+    for (uint32_t i = 0; rx_ && i < rx_->size(); i++) {
+        add_socket(rx_->fd(i));
+    }
+    counter("gateway_socket_drops_total", "Datagrams the kernel dropped for a full sensor socket buffer.",
+            socket_drops);
+
+    if (spool_) {
+        const SpoolStats& sp = spool_->stats();
+        gauge("gateway_spool_messages", "Messages waiting in the spool.", spool_->backlog());
+        gauge("gateway_spool_bytes", "Bytes of the spool's segments.", spool_->bytes());
+        counter("gateway_spool_appended_total", "Messages written to the spool.", sp.appended);
+        counter("gateway_spool_replayed_total", "Messages read back from the spool.", sp.replayed);
+        counter("gateway_spool_committed_total", "Replayed messages the broker took.", sp.committed);
+        counter("gateway_spool_refused_total", "Replayed messages the client refused, dropped from the spool.",
+                sp.refused);
+        counter("gateway_spool_compacted_total", "Messages compaction removed.", sp.compacted);
+        counter("gateway_spool_evicted_total", "Messages deleted with a segment past spool_max_mb.", sp.evicted);
+        counter("gateway_spool_lost_total", "Segment tails lost to a bad record.", sp.corrupt);
+        counter("gateway_spool_failed_total", "Messages the spool could not write.", sp.failed);
+        counter("gateway_spool_syncs_total", "fdatasync() calls of the spool.", sp.syncs);
+        counter("gateway_spool_device_bytes_total", "Bytes the spool's syncs wrote to the device, in pages.",
+                sp.device_bytes);
+    }
+
+    // one pass over the table, every family lists the nodes in the same order
+    std::vector<NodeStats> nodes;
+    node_stats_.ForEach([&](const NodeStats& n) { nodes.push_back(n); });
+    std::vector<std::string> labels;
+    labels.reserve(nodes.size());
+    for (const NodeStats& n : nodes) {
+        labels.push_back(MetricsText::Label("node", n.Id()));
+    }
+    gauge("gateway_nodes", "Nodes tracked.", node_stats_.size());
+    counter("gateway_node_untracked_samples_total", "Samples of nodes the full table had no room for.",
+            node_stats_.untracked());
+    int64_t now = MonotonicMs();
+    auto per_node = [&](std::string_view name, std::string_view type, std::string_view help, auto value) {
+        out.Family(name, type, help);
+        for (size_t i = 0; i < nodes.size(); i++) {
+            out.Sample(name, labels[i], value(nodes[i]));
+        }
+    };
+    per_node("gateway_node_samples_total", "counter", "Samples of a node.",
+             [](const NodeStats& n) { return static_cast<uint64_t>(n.samples); });
+    per_node("gateway_node_missing_total", "counter", "Sequence numbers of a node never received.",
+             [](const NodeStats& n) { return static_cast<uint64_t>(n.missing); });
+    per_node("gateway_node_interval_seconds", "gauge", "Time between a node's sequence numbers, moving average.",
+             [](const NodeStats& n) { return n.interval_ms / 1000.0; });
+    per_node("gateway_node_last_sample_age_seconds", "gauge", "Time since a node's last sample.",
+             [&](const NodeStats& n) { return (now - n.last_seen_ms) / 1000.0; });
+
+    if (metrics_) {
+        counter("gateway_metrics_scrapes_total", "Scrapes answered before this one.", metrics_->stats().requests);
+    }
+}
+
+void Gateway::Run(volatile std::sig_atomic_t* stop, volatile std::sig_atomic_t* dump_stats)
+{
+    int64_t now = MonotonicMs();
+    int64_t next_stats = now + config_.stats_interval_s * 1000LL;
+    // With busy_poll_us the loop spins that long after the last datagram instead of
+    // sleeping; rx workers spin on their own sockets.
+    int64_t spin_until_us = 0;
+    wall_ms_ = WallMs();
+    mqtt_.Process(now);
+
+    while (!*stop) {
+        int64_t timeout = mqtt_.NextTimeoutMs(now);
+        if (config_.stats_interval_s) {
+            timeout = std::min(timeout, std::max<int64_t>(next_stats - now, 0));
+        }
+        timeout = std::min<int64_t>(timeout, 1000);
+        if (spool_ && spool_->backlog() > 0 && mqtt_.connected()) {
+            timeout = std::min(timeout, kReplayTickMs);
+        }
+        if (spin_until_us && MonotonicUs() < spin_until_us) {
+            timeout = 0;
+        }
+        received_ = 0;
+        // held for room in the publish queue, the rings are left to fill and only the
+        // broker's answers wake the loop
+        uint32_t budget = rx_ ? WorkerBudget() : 0;
+        if (rx_ && budget > 0 && !rx_->Sleep()) {
+            timeout = 0;
+        }
+        stats_.held += rx_ && budget == 0;
+        io_->Wait(static_cast<int>(timeout), *this);
+        if (rx_) {
+            rx_->Awake();
+            DrainWorkers(budget);
+        }
+        now = MonotonicMs();
+        if (received_ && config_.busy_poll_us) {
+            spin_until_us = MonotonicUs() + config_.busy_poll_us;
+        }
+        if (spool_) {
+            ReplaySpool(now);
+        }
+        depth_.Record(mqtt_.depth());
+        mqtt_.Process(now);
+        if (spool_) {
+            spool_->Flush(now);
+            wall_ms_ = WallMs();
+        }
+
+        if (metrics_) {
+            metrics_->Expire(now);
+        }
+
+        if (*dump_stats) {
+            *dump_stats = 0;
+            LogStats();
+        }
+        if (config_.stats_interval_s && now >= next_stats) {
+            next_stats = now + config_.stats_interval_s * 1000LL;
+            LogStats();
+        }
+    }
+
+    // nothing new comes in while what is queued goes out
+    if (rx_) {
+        rx_->Stop();
+        while (DrainWorkers(kWorkerBudget) > 0) {
+        }
+    }
+    for (int* fd : {&sensor_fd_, &discovery_fd_, &probe_fd_}) {
+        if (*fd >= 0) {
+            io_->Remove(*fd);
+            close(*fd);
+            *fd = -1;
+        }
+    }
+    if (metrics_) {
+        metrics_->Close();
+    }
+    int64_t drain_end = MonotonicMs() + kDrainMs;
+    while (mqtt_.connected() && (mqtt_.pending() > 0 || !mqtt_.flushed()) && (now = MonotonicMs()) < drain_end) {
+        io_->Wait(static_cast<int>(std::min<int64_t>(drain_end - now, 100)), *this);
+        mqtt_.Process(MonotonicMs());
+    }
+    mqtt_.Disconnect();
+    if (spool_) {
+        SaveToSpool();
+        spool_->Close();
+    }
+    LogStats();
+}
+
+}  // namespace gateway
@@ -0,0 +1,148 @@
+/*
+ * The gateway: node datagrams in, MQTT messages out, in one event loop on an IoBackend.
+ *
+ * Every sample becomes one message per measurement on <prefix>/<node id>/<measurement>
+ * (airTemperature and airHumidity for temp and hum, like raspberry1/project/project.py,
+ * other keys by their name). The "#PROBE" line of a node becomes link* messages under
+ * the node that sent it. Discovery queries and link probes are answered next to it.
+ *
+ * With rx_workers the sensor datagrams are received and parsed by RxWorkers threads
+ * instead, and the loop takes the parsed records from their rings.
+ *
+ * With a spool_dir the messages the broker cannot take, all of them while it is away
+ * and what finds the queue full while it is slow, go to a Spool instead. Once connected
+ * the loop replays them in order at spool_replay_rate into the free quarter of the queue,
+ * so live messages keep going first, and commits them as the client retires them.
+ *
+ * A datagram's receive time goes with its messages into the client, which records how
+ * long they took to be written and acknowledged; the parse time per datagram and the
+ * publish queue's depth every loop round are recorded as well. With metrics_port a
+ * MetricsServer in the loop serves all of it and the statistics, see WriteMetrics().
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <netinet/in.h>
+
+#include <csignal>
+#include <cstdint>
+#include <deque>
+#include <memory>
+#include <string>
+#include <string_view>
+
+#include "config.h"
+#include "io_backend.h"
+#include "metrics.h"
+#include "mqtt_client.h"
+#include "node_stats.h"
+#include "node_table.h"
+#include "parser.h"
+#include "rx_workers.h"
+#include "spool.h"
+
+namespace gateway {
+
+struct GatewayStats {
+    uint64_t datagrams = 0;
+    uint64_t invalid = 0;           // neither a sample nor a probe line
+    uint64_t samples = 0;
+    uint64_t predicted = 0;         // filled in for samples a forecasting node skipped
+    uint64_t probes = 0;            // #PROBE lines
+    uint64_t probes_unknown = 0;    // #PROBE lines from an address no sample came from
+    uint64_t discovery = 0;
+    uint64_t reflected = 0;
+    uint64_t held = 0;              // loop rounds the rx rings waited for room, queue_policy = block
+};
+
+class Gateway : private IoHandler {
+public:
+    explicit Gateway(const Config& config);
+    ~Gateway();
+
+    Gateway(const Gateway&) = delete;
+    Gateway& operator=(const Gateway&) = delete;
+
+    // binds the node side sockets and sets the I/O backend up, false with a message in *error
+    bool Open(std::string* error);
+
+    // Serves until *stop is set, logs the statistics whenever *dump_stats is set and
+    // every stats_interval_s. Pending messages get two seconds to go out at the end.
+    void Run(volatile std::sig_atomic_t* stop, volatile std::sig_atomic_t* dump_stats);
+
+    // datagrams from the nodes, one by one or as a batch from the ingest stage
+    void HandleDatagram(std::string_view text, const sockaddr_in& from, int64_t now_ms);
+    void HandleBatch(const PacketBatch& batch, int64_t now_ms);
+
+    void LogStats();
+    // everything LogStats() has and the histograms, for a scrape
+    void WriteMetrics(MetricsText& out) const;
+
+    const GatewayStats& stats() const { return stats_; }
+    const MqttClient& mqtt() const { return mqtt_; }
+    // nullptr before Open()
+    const IoBackend* io() const { return io_.get(); }
+    // nullptr without rx_workers
+    const RxWorkers* rx() const { return rx_.get(); }
+    // nullptr without spool_dir
+    const Spool* spool() const { return spool_.get(); }
+    // nullptr with metrics_port 0
+    const MetricsServer* metrics() const { return metrics_.get(); }
+    // readable from any thread
+    const NodeStatsTable& node_stats() const { return node_stats_; }
+
+private:
+    void OnDatagrams(int fd, const PacketBatch& batch) override;
+    void OnReadable(int fd) override;
+    void OnConnected(int fd, int result) override;
+    void OnSent(int fd, int result) override;
+
+    // a datagram parsed here or by an rx worker
+    void HandleRecord(const Record& record, std::string_view text, const sockaddr_in& from, int64_t now_ms);
+    // records from the rx workers, up to budget per worker, returns how many
+    uint32_t DrainWorkers(uint32_t budget);
+    // what DrainWorkers() may take this round, 0 while the publish queue holds them off
+    uint32_t WorkerBudget() const;
+    void HandleSample(const Record& record, const sockaddr_in& from, int64_t now_ms);
+    void HandleProbe(const Record& record, const sockaddr_in& from);
+    // to the client, or to the spool while the client cannot take it
+    void Publish(std::string_view topic, std::string_view payload);
+    // hands the client more of the spool's backlog, and CommitSpool() what it retired
+    void ReplaySpool(int64_t now_ms);
+    void CommitSpool();
+    // at the end of Run(): appends what the client has not delivered, replayed ones aside
+    void SaveToSpool();
+    void PublishValue(std::string_view node_id, std::string_view measurement, std::string_view payload);
+    // one message per field, or one for all of them with combine_fields
+    void PublishSample(std::string_view node_id, uint32_t count, const std::string_view* names,
+                       const std::string_view* values);
+    // {"airTemperature":21.50,"airHumidity":45.20}, false when it does not fit a message slot
+    bool PublishCombined(std::string_view node_id, uint32_t count, const std::string_view* names,
+                         const std::string_view* values);
+
+    Config config_;
+    int sensor_fd_ = -1;
+    int discovery_fd_ = -1;
+    int probe_fd_ = -1;
+    NodeTable nodes_;
+    NodeStatsTable node_stats_;         // updated by the rx workers when there are any
+    std::unique_ptr<IoBackend> io_;     // before mqtt_, the client removes its socket on the way out
+    MqttClient mqtt_;
+    std::unique_ptr<RxWorkers> rx_;     // after io_, gone before it; its wakeup fd is in io_
+    std::unique_ptr<Spool> spool_;
+    std::unique_ptr<MetricsServer> metrics_;    // after io_ like rx_
+    std::deque<uint32_t> replayed_;     // client numbers of the spooled messages not yet retired
+    double replay_credit_ = 0;          // messages the replay rate allows now
+    int64_t replay_ms_ = 0;
+    int64_t wall_ms_ = 0;               // the spool's time stamp, once per loop round
+    uint32_t received_ = 0;             // datagrams of the current loop round, from sensor_fd_
+    int64_t ingest_ns_ = 0;             // receive time of the datagram being handled, 0 for none
+    Histogram parse_ns_;                // per datagram parsed in the loop, the rx workers have their own
+    Histogram depth_;                   // the publish queue, every loop round
+    int64_t last_stats_ms_ = 0;         // LogStats() before, for the message rate
+    uint64_t last_sent_ = 0;
+    GatewayStats stats_;
+};
+
+}  // namespace gateway
@@ -0,0 +1,45 @@
+/*
+ * Choice of the I/O backend.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "io_backend.h"
+
+#include "epoll_backend.h"
+#include "log.h"
+#include "uring_backend.h"
+
+namespace gateway {
+
+std::unique_ptr<IoBackend> IoBackend::Create(Kind kind, std::string* error)
+{
+    if (kind != Kind::kEpoll) {
+        std::string why;
+        std::unique_ptr<IoBackend> uring = UringBackend::Create(&why);
+        if (uring) {
+            return uring;
+        }
+        if (kind == Kind::kUring) {
+            if (error) {
+                *error = "io_uring: " + why;
+            }
+            return nullptr;
+        }
+        GW_LOGI("io_uring not usable (%s), using epoll", why.c_str());
+    }
+    return EpollBackend::Create(error);
+}
+
+const char* IoBackendKindName(IoBackend::Kind kind)
+{
+    switch (kind) {
+    case IoBackend::Kind::kEpoll:
+        return "epoll";
+    case IoBackend::Kind::kUring:
+        return "uring";
+    default:
+        return "auto";
+    }
+}
+
+}  // namespace gateway
@@ -0,0 +1,95 @@
+/*
+ * The I/O the gateway's loop waits for, behind epoll or io_uring.
+ *
+ * Datagram sockets deliver batches of PacketSlots, readable sockets a wakeup. Stream
+ * sockets (the MQTT uplink) connect and write through the backend and get the result
+ * as a completion, so io_uring can run them without a syscall per operation:
+ *
+ *   epoll     readiness, recvmmsg() into UdpIngest slots, send() right away and on
+ *             EPOLLOUT for what did not fit
+ *   io_uring  multishot recvmsg into a registered ring of slots, multishot poll for
+ *             the readable sockets, connect linked to the first write, writes from a
+ *             registered buffer each linked to a timeout
+ *
+ * Create(kAuto) takes io_uring when the kernel has everything it needs and falls back
+ * to epoll otherwise (old kernel, io_uring disabled by sysctl or seccomp).
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string>
+
+#include "udp_ingest.h"
+
+namespace gateway {
+
+struct IoStats {
+    uint64_t waits = 0;         // epoll_wait() or io_uring_enter() calls
+    uint64_t syscalls = 0;      // all syscalls of the backend, waits included
+    uint64_t datagrams = 0;
+    uint64_t batches = 0;
+    uint64_t truncated = 0;
+    uint64_t writes = 0;        // Send() calls and connect writes
+    uint64_t short_writes = 0;  // writes that completed with less than asked
+    uint32_t max_batch = 0;
+};
+
+class IoHandler {
+public:
+    virtual void OnDatagrams(int fd, const PacketBatch& batch) = 0;
+    virtual void OnReadable(int fd) = 0;
+    // result of Connect(), 0 or -errno
+    virtual void OnConnected(int fd, int result) = 0;
+    // result of a write, the bytes written or -errno; -ETIME when the send timeout passed
+    virtual void OnSent(int fd, int result) = 0;
+
+protected:
+    ~IoHandler() = default;
+};
+
+class IoBackend {
+public:
+    enum class Kind : uint8_t { kAuto, kEpoll, kUring };
+
+    // nullptr with a message in *error; kAuto only fails when epoll does
+    static std::unique_ptr<IoBackend> Create(Kind kind, std::string* error);
+
+    virtual ~IoBackend() = default;
+    virtual const char* name() const = 0;
+
+    // datagrams from fd arrive in batches of up to `batch`
+    virtual bool AddDatagramSocket(int fd, uint32_t batch) = 0;
+    virtual bool AddReadable(int fd) = 0;
+    // No more events for fd, completions still on their way are dropped. Call before
+    // close(fd); the fd number may come back for the next socket.
+    virtual void Remove(int fd) = 0;
+
+    // the buffer stream writes come from, io_uring registers it once
+    virtual void RegisterSendBuffer(uint8_t* buf, size_t len) = 0;
+    // Connects fd and writes `first` once connected, OnConnected() then OnSent().
+    virtual bool Connect(int fd, const sockaddr* addr, socklen_t addr_len, const uint8_t* first, size_t first_len) = 0;
+    // One write to a connected stream socket at a time, buf untouched until OnSent().
+    virtual bool Send(int fd, const uint8_t* buf, size_t len) = 0;
+    // writes that take longer complete with -ETIME, 0 for no limit
+    void SetSendTimeout(uint32_t ms) { send_timeout_ms_ = ms; }
+
+    // Waits up to timeout_ms for events, 0 to only collect what is ready, and calls the
+    // handler for each.
+    virtual void Wait(int timeout_ms, IoHandler& handler) = 0;
+
+    const IoStats& stats() const { return stats_; }
+
+protected:
+    IoStats stats_;
+    uint32_t send_timeout_ms_ = 0;
+};
+
+const char* IoBackendKindName(IoBackend::Kind kind);
+
+}  // namespace gateway
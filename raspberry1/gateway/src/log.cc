@@ -0,0 +1,55 @@
+/*
+ * Logging to stderr.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "log.h"
+
+#include <cstdarg>
+#include <cstdio>
+#include <cstdlib>
+#include <ctime>
+
+namespace gateway {
+
+static LogLevel s_max_level = LogLevel::kInfo;
+static bool s_journal = false;
+
+void LogInit(LogLevel max_level)
+{
+    s_max_level = max_level;
+    // systemd sets JOURNAL_STREAM when stderr goes to the journal, which keeps its own timestamps
+    s_journal = std::getenv("JOURNAL_STREAM") != nullptr;
+}
+
+bool LogEnabled(LogLevel level)
+{
+    return static_cast<int>(level) <= static_cast<int>(s_max_level);
+}
+
+void Log(LogLevel level, const char* fmt, ...)
+{
+    if (!LogEnabled(level)) {
+        return;
+    }
+    char line[512];
+    int n = 0;
+    if (s_journal) {
+        n = std::snprintf(line, sizeof(line), "<%d>", static_cast<int>(level));
+    } else {
+        std::time_t now = std::time(nullptr);
+        struct tm tm;
+        localtime_r(&now, &tm);
+        n = static_cast<int>(std::strftime(line, sizeof(line), "%Y-%m-%d %H:%M:%S ", &tm));
+    }
+    va_list ap;
+    va_start(ap, fmt);
+    int m = std::vsnprintf(line + n, sizeof(line) - n - 1, fmt, ap);
+    va_end(ap);
+    n = m < 0 ? n : n + m;
+    n = n > static_cast<int>(sizeof(line)) - 2 ? static_cast<int>(sizeof(line)) - 2 : n;
+    line[n++] = '\n';
+    std::fwrite(line, 1, n, stderr);
+}
+
+}  // namespace gateway
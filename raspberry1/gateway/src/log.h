@@ -0,0 +1,26 @@
+/*
+ * Logging to stderr, with syslog priority prefixes when journald reads it.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+namespace gateway {
+
+enum class LogLevel : int { kError = 3, kWarning = 4, kInfo = 6, kDebug = 7 };
+
+void LogInit(LogLevel max_level);
+void Log(LogLevel level, const char* fmt, ...) __attribute__((format(printf, 2, 3)));
+bool LogEnabled(LogLevel level);
+
+}  // namespace gateway
+
+#define GW_LOGE(...) ::gateway::Log(::gateway::LogLevel::kError, __VA_ARGS__)
+#define GW_LOGW(...) ::gateway::Log(::gateway::LogLevel::kWarning, __VA_ARGS__)
+#define GW_LOGI(...) ::gateway::Log(::gateway::LogLevel::kInfo, __VA_ARGS__)
+#define GW_LOGD(...)                                                  \
+    do {                                                              \
+        if (::gateway::LogEnabled(::gateway::LogLevel::kDebug)) {     \
+            ::gateway::Log(::gateway::LogLevel::kDebug, __VA_ARGS__); \
+        }                                                             \
+    } while (0)
@@ -0,0 +1,107 @@
+/*
+ * iot-gateway: receives the sensor nodes' UDP datagrams and publishes them to MQTT.
+ *
+ * Usage:
+ *     iot-gateway [-c gateway.conf] [--key=value ...] [-v]
+ *
+ * Every key of gateway.conf can be given as --key=value and wins over the file.
+ * SIGTERM and SIGINT stop it, SIGUSR1 logs the statistics.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include <csignal>
+#include <cstdio>
+#include <cstring>
+#include <string>
+
+#include "config.h"
+#include "gateway.h"
+#include "log.h"
+
+namespace {
+
+volatile std::sig_atomic_t g_stop = 0;
+volatile std::sig_atomic_t g_dump_stats = 0;
+
+void OnSignal(int sig)
+{
+    if (sig == SIGUSR1) {
+        g_dump_stats = 1;
+    } else {
+        g_stop = 1;
+    }
+}
+
+void Usage(const char* argv0)
+{
+    std::fprintf(stderr,
+                 "usage: %s [-c FILE] [--key=value ...] [-v]\n"
+                 "  -c FILE       configuration file, see gateway.conf\n"
+                 "  --key=value   set a configuration key, e.g. --broker=127.0.0.1 --qos=0\n"
+                 "  -v            debug logging\n",
+                 argv0);
+}
+
+}  // namespace
+
+int main(int argc, char** argv)
+{
+    gateway::Config config;
+    std::string error;
+    bool debug = false;
+
+    // the file first, so the command line wins wherever -c stands
+    for (int i = 1; i < argc; i++) {
+        if (std::strcmp(argv[i], "-c") == 0) {
+            if (i + 1 == argc) {
+                Usage(argv[0]);
+                return 2;
+            }
+            if (!gateway::ConfigLoadFile(config, argv[++i], &error)) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        }
+    }
+    for (int i = 1; i < argc; i++) {
+        std::string arg = argv[i];
+        if (arg == "-c") {
+            i++;
+        } else if (arg == "-v") {
+            debug = true;
+        } else if (arg == "-h" || arg == "--help") {
+            Usage(argv[0]);
+            return 0;
+        } else if (arg.compare(0, 2, "--") == 0 && arg.find('=') != std::string::npos) {
+            size_t eq = arg.find('=');
+            if (!gateway::ConfigSet(config, arg.substr(2, eq - 2), arg.substr(eq + 1), &error)) {
+                std::fprintf(stderr, "%s\n", error.c_str());
+                return 2;
+            }
+        } else {
+            Usage(argv[0]);
+            return 2;
+        }
+    }
+    if (!gateway::ConfigFinish(config, &error)) {
+        std::fprintf(stderr, "%s\n", error.c_str());
+        return 2;
+    }
+    gateway::LogInit(debug ? gateway::LogLevel::kDebug : gateway::LogLevel::kInfo);
+
+    struct sigaction sa = {};
+    sa.sa_handler = OnSignal;
+    sigemptyset(&sa.sa_mask);
+    sigaction(SIGTERM, &sa, nullptr);
+    sigaction(SIGINT, &sa, nullptr);
+    sigaction(SIGUSR1, &sa, nullptr);
+    std::signal(SIGPIPE, SIG_IGN);
+
+    gateway::Gateway gw(config);
+    if (!gw.Open(&error)) {
+        GW_LOGE("%s", error.c_str());
+        return 1;
+    }
+    gw.Run(&g_stop, &g_dump_stats);
+    return 0;
+}
@@ -0,0 +1,378 @@
+/*
+ * Latency histograms and the gateway's metrics endpoint.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "metrics.h"
+
+#include <arpa/inet.h>
+#include <netinet/in.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cmath>
+#include <cstdio>
+#include <cstring>
+
+#include "log.h"
+
+namespace gateway {
+
+namespace {
+
+constexpr int kBacklog = 16;
+constexpr std::string_view kHeaderEnd = "\r\n\r\n";
+
+}  // namespace
+
+void Histogram::CollectInto(HistogramCounts* counts) const
+{
+    for (uint32_t i = 0; i < kBuckets; i++) {
+        uint64_t n = buckets_[i].load(std::memory_order_relaxed);
+        counts->buckets[i] += n;
+        counts->count += n;
+    }
+    counts->sum += sum_.load(std::memory_order_relaxed);
+}
+
+uint64_t HistogramCounts::Quantile(double q) const
+{
+    if (count == 0) {
+        return 0;
+    }
+    // the rank of the sample, 1 for the smallest
+    uint64_t rank = std::max<uint64_t>(1, static_cast<uint64_t>(std::ceil(q * count)));
+    uint64_t seen = 0;
+    for (uint32_t i = 0; i < Histogram::kBuckets; i++) {
+        seen += buckets[i];
+        if (seen >= rank) {
+            return Histogram::Highest(i);
+        }
+    }
+    return Histogram::kMax;
+}
+
+uint64_t HistogramCounts::CountAtOrBelow(uint64_t value) const
+{
+    uint64_t n = 0;
+    for (uint32_t i = 0; i < Histogram::kBuckets && Histogram::Lowest(i) <= value; i++) {
+        n += buckets[i];
+    }
+    return n;
+}
+
+void MetricsText::Family(std::string_view name, std::string_view type, std::string_view help)
+{
+    out_ += "# HELP ";
+    out_ += name;
+    out_ += ' ';
+    out_ += help;
+    out_ += "\n# TYPE ";
+    out_ += name;
+    out_ += ' ';
+    out_ += type;
+    out_ += '\n';
+}
+
+void MetricsText::Line(std::string_view name, std::string_view suffix, std::string_view labels, const char* value)
+{
+    out_ += name;
+    out_ += suffix;
+    if (!labels.empty()) {
+        out_ += '{';
+        out_ += labels;
+        out_ += '}';
+    }
+    out_ += ' ';
+    out_ += value;
+    out_ += '\n';
+}
+
+void MetricsText::Sample(std::string_view name, std::string_view labels, double value)
+{
+    char text[32];
+    std::snprintf(text, sizeof(text), "%.9g", value);
+    Line(name, {}, labels, text);
+}
+
+void MetricsText::Sample(std::string_view name, std::string_view labels, uint64_t value)
+{
+    char text[24];
+    std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(value));
+    Line(name, {}, labels, text);
+}
+
+void MetricsText::HistogramSeries(std::string_view name, std::string_view labels, const HistogramCounts& counts,
+                                  const uint64_t* bounds, size_t num_bounds, double scale)
+{
+    std::string le(labels);
+    le += labels.empty() ? "le=\"" : ",le=\"";
+    size_t le_len = le.size();
+    char text[32];
+    for (size_t i = 0; i <= num_bounds; i++) {
+        le.resize(le_len);
+        if (i < num_bounds) {
+            std::snprintf(text, sizeof(text), "%.9g", bounds[i] * scale);
+            le += text;
+        } else {
+            le += "+Inf";
+        }
+        le += '"';
+        uint64_t n = i < num_bounds ? counts.CountAtOrBelow(bounds[i]) : counts.count;
+        std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(n));
+        Line(name, "_bucket", le, text);
+    }
+    std::snprintf(text, sizeof(text), "%.9g", counts.sum * scale);
+    Line(name, "_sum", labels, text);
+    std::snprintf(text, sizeof(text), "%llu", static_cast<unsigned long long>(counts.count));
+    Line(name, "_count", labels, text);
+}
+
+std::string MetricsText::Label(std::string_view name, std::string_view value)
+{
+    std::string label(name);
+    label += "=\"";
+    for (char c : value) {
+        if (c == '\\' || c == '"') {
+            label += '\\';
+            label += c;
+        } else if (c == '\n') {
+            label += "\\n";
+        } else {
+            label += c;
+        }
+    }
+    label += '"';
+    return label;
+}
+
+MetricsServer::MetricsServer(const MetricsOptions& options, std::function<void(MetricsText&)> render)
+    : options_(options), render_(std::move(render)), connections_(options.max_clients ? options.max_clients : 1)
+{
+}
+
+MetricsServer::~MetricsServer()
+{
+    Close();
+}
+
+bool MetricsServer::Open(IoBackend* io, std::string* error)
+{
+    sockaddr_in addr = {};
+    addr.sin_family = AF_INET;
+    addr.sin_port = htons(options_.port);
+    int on = 1;
+    socklen_t len = sizeof(addr);
+    if (inet_pton(AF_INET, options_.listen.c_str(), &addr.sin_addr) != 1) {
+        errno = EINVAL;
+    } else if ((fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0)) >= 0 &&
+               setsockopt(fd_, SOL_SOCKET, SO_REUSEADDR, &on, sizeof(on)) == 0 &&
+               bind(fd_, reinterpret_cast<sockaddr*>(&addr), sizeof(addr)) == 0 && listen(fd_, kBacklog) == 0 &&
+               getsockname(fd_, reinterpret_cast<sockaddr*>(&addr), &len) == 0) {
+        port_ = ntohs(addr.sin_port);
+        io_ = io;
+        io_->AddReadable(fd_);
+        return true;
+    }
+    if (error) {
+        *error = "metrics tcp " + options_.listen + ":" + std::to_string(options_.port) + ": " + strerror(errno);
+    }
+    if (fd_ >= 0) {
+        close(fd_);
+        fd_ = -1;
+    }
+    return false;
+}
+
+void MetricsServer::Close()
+{
+    for (Connection& c : connections_) {
+        if (c.fd >= 0) {
+            Drop(c);
+        }
+    }
+    if (fd_ >= 0) {
+        io_->Remove(fd_);
+        close(fd_);
+        fd_ = -1;
+    }
+}
+
+bool MetricsServer::Owns(int fd) const
+{
+    if (fd < 0) {
+        return false;
+    }
+    if (fd == fd_) {
+        return true;
+    }
+    for (const Connection& c : connections_) {
+        if (c.fd == fd) {
+            return true;
+        }
+    }
+    return false;
+}
+
+void MetricsServer::OnReadable(int fd, int64_t now_ms)
+{
+    if (fd == fd_) {
+        Accept(now_ms);
+        return;
+    }
+    for (Connection& c : connections_) {
+        if (c.fd == fd) {
+            Read(c);
+            return;
+        }
+    }
+}
+
+void MetricsServer::OnSent(int fd, int result)
+{
+    for (Connection& c : connections_) {
+        if (c.fd != fd || !c.writing) {
+            continue;
+        }
+        c.writing = false;
+        if (result < 0) {
+            GW_LOGD("metrics: %zu of %zu bytes sent, %s", c.sent, c.response.size(),
+                    result == -ETIME ? "timed out" : strerror(-result));
+            stats_.failed++;
+            Drop(c);
+            return;
+        }
+        c.sent += static_cast<size_t>(result);
+        if (c.sent < c.response.size()) {
+            Write(c);
+        } else {
+            Drop(c);
+        }
+        return;
+    }
+}
+
+void MetricsServer::Expire(int64_t now_ms)
+{
+    for (Connection& c : connections_) {
+        if (c.fd >= 0 && now_ms - c.opened_ms > options_.timeout_ms) {
+            stats_.failed++;
+            Drop(c);
+        }
+    }
+}
+
+void MetricsServer::Accept(int64_t now_ms)
+{
+    for (;;) {
+        int fd = accept4(fd_, nullptr, nullptr, SOCK_NONBLOCK | SOCK_CLOEXEC);
+        if (fd < 0) {
+            if (errno == EINTR) {
+                continue;
+            }
+            return;
+        }
+        auto free = std::find_if(connections_.begin(), connections_.end(), [](const Connection& c) {
+            return c.fd < 0;
+        });
+        if (free == connections_.end()) {
+            stats_.rejected++;
+            close(fd);
+            continue;
+        }
+        free->fd = fd;
+        free->opened_ms = now_ms;
+        free->len = 0;
+        free->sent = 0;
+        io_->AddReadable(fd);
+    }
+}
+
+void MetricsServer::Read(Connection& c)
+{
+    for (;;) {
+        // what comes while the answer goes out is read and ignored
+        size_t at = c.writing ? 0 : c.len;
+        ssize_t n = recv(c.fd, c.request + at, sizeof(c.request) - at, MSG_DONTWAIT);
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+            return;
+        }
+        if (n <= 0) {
+            // closed before the request was complete or the answer out
+            stats_.failed++;
+            Drop(c);
+            return;
+        }
+        if (c.writing) {
+            continue;
+        }
+        c.len += static_cast<size_t>(n);
+        if (std::string_view(c.request, c.len).find(kHeaderEnd) != std::string_view::npos) {
+            Respond(c);
+            return;
+        }
+        if (c.len == sizeof(c.request)) {
+            stats_.failed++;
+            Drop(c);
+            return;
+        }
+    }
+}
+
+void MetricsServer::Respond(Connection& c)
+{
+    // "GET /metrics HTTP/1.1", a query string is ignored
+    std::string_view request(c.request, c.len);
+    std::string_view line = request.substr(0, request.find("\r\n"));
+    std::string_view path;
+    if (line.substr(0, 4) == "GET ") {
+        path = line.substr(4, line.find(' ', 4) - 4);
+        path = path.substr(0, path.find('?'));
+    }
+    const char* status = "200 OK";
+    text_.Clear();
+    if (path == "/metrics" || path == "/") {
+        render_(text_);
+        stats_.requests++;
+    } else {
+        status = path.empty() ? "405 Method Not Allowed" : "404 Not Found";
+        stats_.failed++;
+    }
+    const std::string& body = text_.text();
+    char header[160];
+    int header_len = std::snprintf(header, sizeof(header),
+                                   "HTTP/1.1 %s\r\nContent-Type: text/plain; version=0.0.4; charset=utf-8\r\n"
+                                   "Content-Length: %zu\r\nConnection: close\r\n\r\n",
+                                   status, body.size());
+    c.response.assign(header, static_cast<size_t>(header_len));
+    c.response += body;
+    c.sent = 0;
+    Write(c);
+}
+
+void MetricsServer::Write(Connection& c)
+{
+    // the loop goes on while the scraper reads, a large answer goes out in several
+    if (!io_->Send(c.fd, reinterpret_cast<const uint8_t*>(c.response.data()) + c.sent, c.response.size() - c.sent)) {
+        stats_.failed++;
+        Drop(c);
+        return;
+    }
+    c.writing = true;
+}
+
+void MetricsServer::Drop(Connection& c)
+{
+    io_->Remove(c.fd);
+    close(c.fd);
+    c.fd = -1;
+    c.len = 0;
+    c.writing = false;
+}
+
+}  // namespace gateway
@@ -0,0 +1,190 @@
+/*
+ * Latency histograms and the gateway's metrics endpoint.
+ *
+ * A Histogram is log-linear like HdrHistogram: values below 16 have a bucket each, above
+ * every power of two is split into 16 buckets, so a bucket is at most 1/16 of its values
+ * wide and a quantile read from it is that close. Up to 2^40 (18 minutes in
+ * nanoseconds) that is 592 buckets of a counter. One thread records, as a relaxed load
+ * and store of a bucket and of the sum, no locked instruction; any thread may read. A
+ * reader racing a writer sees a sample in the bucket and not yet in the sum at worst.
+ *
+ * The counters are the stats structs the gateway already keeps. MetricsServer answers
+ * GET /metrics on a local TCP port in Prometheus' text format from inside the event
+ * loop, so what the loop owns is read without a race; what the rx workers count is
+ * atomic. A scrape is one request per connection: read the request, render the answer
+ * into the connection's buffer and write it through the IoBackend like the MQTT
+ * client's writes, the rest of a large one as the socket takes it, then close.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdint>
+#include <functional>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io_backend.h"
+
+namespace gateway {
+
+struct HistogramCounts;
+
+class Histogram {
+public:
+    static constexpr uint32_t kSubBits = 4;
+    static constexpr uint32_t kMaxBits = 40;
+    static constexpr uint64_t kMax = (1ull << kMaxBits) - 1;   // larger values count as kMax
+    static constexpr uint32_t kBuckets = (kMaxBits - kSubBits + 1) << kSubBits;
+
+    static constexpr uint32_t Index(uint64_t value)
+    {
+        if (value < (1u << kSubBits)) {
+            return static_cast<uint32_t>(value);
+        }
+        uint32_t exp = 63 - __builtin_clzll(value);
+        return ((exp - kSubBits + 1) << kSubBits) +
+               static_cast<uint32_t>((value >> (exp - kSubBits)) & ((1u << kSubBits) - 1));
+    }
+    // the values of bucket i
+    static constexpr uint64_t Lowest(uint32_t i)
+    {
+        uint32_t block = i >> kSubBits;
+        uint64_t sub = i & ((1u << kSubBits) - 1);
+        return block == 0 ? sub : ((1ull << kSubBits) + sub) << (block - 1);
+    }
+    static constexpr uint64_t Highest(uint32_t i)
+    {
+        uint32_t block = i >> kSubBits;
+        return block == 0 ? Lowest(i) : Lowest(i) + (1ull << (block - 1)) - 1;
+    }
+    Histogram() = default;
+    Histogram(const Histogram&) = delete;
+    Histogram& operator=(const Histogram&) = delete;
+
+    // `count` samples of `value`, from the one thread that records
+    void Record(uint64_t value, uint64_t count = 1)
+    {
+        std::atomic<uint64_t>& bucket = buckets_[Index(value < kMax ? value : kMax)];
+        bucket.store(bucket.load(std::memory_order_relaxed) + count, std::memory_order_relaxed);
+        sum_.store(sum_.load(std::memory_order_relaxed) + value * count, std::memory_order_relaxed);
+    }
+
+    // adds what was recorded so far, from any thread
+    void CollectInto(HistogramCounts* counts) const;
+
+private:
+    std::atomic<uint64_t> buckets_[kBuckets] = {};
+    std::atomic<uint64_t> sum_{0};
+};
+
+static_assert(Histogram::Index(Histogram::kMax) == Histogram::kBuckets - 1, "kMax in the last bucket");
+
+// one or more histograms added up, for reading
+struct HistogramCounts {
+    std::vector<uint64_t> buckets = std::vector<uint64_t>(Histogram::kBuckets);
+    uint64_t count = 0;
+    uint64_t sum = 0;
+
+    // the highest value of the bucket quantile q (0..1) falls into, 0 without samples
+    uint64_t Quantile(double q) const;
+    // samples in the buckets starting at or below value
+    uint64_t CountAtOrBelow(uint64_t value) const;
+};
+
+// Prometheus text format 0.0.4
+class MetricsText {
+public:
+    // the # HELP and # TYPE lines, once before the samples of a family
+    void Family(std::string_view name, std::string_view type, std::string_view help);
+    // name{labels} value, labels as from Label() joined by commas, or empty
+    void Sample(std::string_view name, std::string_view labels, double value);
+    void Sample(std::string_view name, std::string_view labels, uint64_t value);
+    // the _bucket, _sum and _count lines; bounds in the recorded unit, ascending, written
+    // times scale like the sum
+    void HistogramSeries(std::string_view name, std::string_view labels, const HistogramCounts& counts,
+                         const uint64_t* bounds, size_t num_bounds, double scale);
+
+    // name="value" with \, " and newlines escaped
+    static std::string Label(std::string_view name, std::string_view value);
+
+    const std::string& text() const { return out_; }
+    void Clear() { out_.clear(); }
+
+private:
+    void Line(std::string_view name, std::string_view suffix, std::string_view labels, const char* value);
+
+    std::string out_;
+};
+
+struct MetricsOptions {
+    std::string listen = "127.0.0.1";
+    uint16_t port = 9108;               // 0 for a free one, see port()
+    uint32_t max_clients = 4;           // connections beyond are closed right away
+    int64_t timeout_ms = 5000;          // for the request to arrive and the answer to go out
+};
+
+struct MetricsServerStats {
+    uint64_t requests = 0;              // answered with 200
+    uint64_t rejected = 0;              // no free connection slot
+    uint64_t failed = 0;                // bad or incomplete requests, answers not written whole
+};
+
+class MetricsServer {
+public:
+    // render writes the metrics for one scrape
+    MetricsServer(const MetricsOptions& options, std::function<void(MetricsText&)> render);
+    ~MetricsServer();
+
+    MetricsServer(const MetricsServer&) = delete;
+    MetricsServer& operator=(const MetricsServer&) = delete;
+
+    // listens and adds the socket to io, which has to outlive the server; false with a
+    // message in *error
+    bool Open(IoBackend* io, std::string* error);
+    // stops listening and drops the connections
+    void Close();
+
+    // the listening socket or one of its connections
+    bool Owns(int fd) const;
+    void OnReadable(int fd, int64_t now_ms);
+    // the result of a write of the answer, from IoHandler::OnSent()
+    void OnSent(int fd, int result);
+    // drops connections not done within timeout_ms
+    void Expire(int64_t now_ms);
+
+    uint16_t port() const { return port_; }
+    const MetricsServerStats& stats() const { return stats_; }
+
+private:
+    struct Connection {
+        int fd = -1;
+        int64_t opened_ms = 0;
+        size_t len = 0;
+        char request[1024];
+        std::string response;           // kept until the write completes, and for the next one
+        size_t sent = 0;
+        bool writing = false;
+    };
+
+    void Accept(int64_t now_ms);
+    void Read(Connection& c);
+    void Respond(Connection& c);
+    // the next write of the answer, the connection dropped when it cannot start
+    void Write(Connection& c);
+    void Drop(Connection& c);
+
+    MetricsOptions options_;
+    std::function<void(MetricsText&)> render_;
+    IoBackend* io_ = nullptr;
+    int fd_ = -1;
+    uint16_t port_ = 0;
+    std::vector<Connection> connections_;
+    MetricsText text_;                  // reused, a scrape allocates once it has grown
+    MetricsServerStats stats_;
+};
+
+}  // namespace gateway
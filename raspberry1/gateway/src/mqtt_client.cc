@@ -0,0 +1,489 @@
+/*
+ * Non-blocking MQTT 3.1.1 publisher.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "mqtt_client.h"
+
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "log.h"
+#include "mqtt_codec.h"
+#include "udp_socket.h"
+
+namespace gateway {
+
+namespace {
+
+constexpr size_t kOutSize = 16384;        // registered with the backend, a burst of messages goes out in one write
+constexpr size_t kInSize = 4096;
+constexpr int64_t kBackoffMinMs = 1000;
+constexpr int64_t kBackoffMaxMs = 30000;
+constexpr int64_t kConnackTimeoutMs = 10000;
+constexpr uint32_t kSendTimeoutMs = 10000;
+
+// FNV-1a
+uint32_t HashTopic(std::string_view topic)
+{
+    uint32_t hash = 2166136261u;
+    for (char c : topic) {
+        hash = (hash ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return hash;
+}
+
+}  // namespace
+
+MqttClient::MqttClient(const MqttOptions& options)
+    : options_(options), ring_(options.queue_size ? options.queue_size : 1),
+      window_(options.max_inflight ? options.max_inflight : 1), out_(kOutSize), in_(kInSize)
+{
+    if (options_.policy == QueuePolicy::kLatest) {
+        size_t size = 2;
+        while (size < 2 * ring_.size()) {
+            size <<= 1;
+        }
+        latest_.assign(size, 0);
+    }
+}
+
+MqttClient::~MqttClient()
+{
+    if (fd_ >= 0) {
+        if (io_) {
+            io_->Remove(fd_);
+        }
+        close(fd_);
+    }
+}
+
+void MqttClient::SetIo(IoBackend* io)
+{
+    io_ = io;
+    if (io_) {
+        io_->RegisterSendBuffer(out_.data(), out_.size());
+        io_->SetSendTimeout(kSendTimeoutMs);
+    }
+}
+
+bool MqttClient::Publish(std::string_view topic, std::string_view payload, bool replace, int64_t ingest_ns)
+{
+    if (topic.size() > kTopicMax || payload.size() > kPayloadMax) {
+        stats_.dropped++;
+        return false;
+    }
+    uint32_t hash = 0;
+    replace = replace && !latest_.empty();
+    if (replace) {
+        hash = HashTopic(topic);
+        // only once the broker fell behind, a burst of one round (a gap's predictions)
+        // goes out whole
+        if (count_ >= ring_.size() / 4 && Replace(hash, topic, payload, ingest_ns)) {
+            stats_.replaced++;
+            return true;
+        }
+    }
+    if (count_ == ring_.size()) {
+        if (options_.policy == QueuePolicy::kDropNewest) {
+            stats_.dropped++;
+            return false;
+        }
+        // kLatest with more topics than slots, and kBlock: the caller holds its intake, what still comes pushes out the oldest
+        head_ = (head_ + 1) % ring_.size();
+        count_--;
+        retired_++;
+        stats_.dropped++;
+    }
+    Message& m = ring_[(head_ + count_) % ring_.size()];
+    m.ingest_ns = ingest_ns;
+    m.number = pushed_;
+    m.topic_len = static_cast<uint8_t>(topic.size());
+    m.payload_len = static_cast<uint8_t>(payload.size());
+    std::memcpy(m.topic, topic.data(), topic.size());
+    std::memcpy(m.payload, payload.data(), payload.size());
+    if (replace) {
+        latest_[hash & (latest_.size() - 1)] = pushed_;
+    }
+    pushed_++;
+    count_++;
+    stats_.queued++;
+    stats_.max_depth = std::max(stats_.max_depth, count_);
+    return true;
+}
+
+bool MqttClient::Replace(uint32_t hash, std::string_view topic, std::string_view payload, int64_t ingest_ns)
+{
+    // A stale entry, or one of another topic with the same slot, points at a message
+    // gone or of another topic; both only cost the replacement.
+    uint32_t offset = latest_[hash & (latest_.size() - 1)] - (pushed_ - count_);
+    if (offset >= count_) {
+        return false;
+    }
+    Message& m = ring_[(head_ + offset) % ring_.size()];
+    if (std::string_view(m.topic, m.topic_len) != topic) {
+        return false;
+    }
+    // the value waited as long as the newest datagram
+    m.ingest_ns = ingest_ns;
+    m.payload_len = static_cast<uint8_t>(payload.size());
+    std::memcpy(m.payload, payload.data(), payload.size());
+    return true;
+}
+
+int64_t MqttClient::NextTimeoutMs(int64_t now_ms) const
+{
+    int64_t at;
+    switch (state_) {
+    case State::kIdle:
+        at = retry_at_ms_;
+        break;
+    case State::kConnected:
+        at = (ping_outstanding_ ? ping_sent_ms_ : last_tx_ms_) + options_.keepalive_s * 1000LL;
+        break;
+    default:
+        at = last_tx_ms_ + kConnackTimeoutMs;
+        break;
+    }
+    return std::max<int64_t>(at - now_ms, 0);
+}
+
+void MqttClient::StartConnect(int64_t now_ms)
+{
+    addrinfo hints = {};
+    hints.ai_family = AF_INET;
+    hints.ai_socktype = SOCK_STREAM;
+    addrinfo* res = nullptr;
+    std::string port = std::to_string(options_.port);
+    // blocks while the name resolves, only on (re)connects and not at all for an address
+    int rc = getaddrinfo(options_.host.c_str(), port.c_str(), &hints, &res);
+    if (rc != 0) {
+        GW_LOGW("broker %s: %s", options_.host.c_str(), gai_strerror(rc));
+        Close(now_ms, nullptr);
+        return;
+    }
+    fd_ = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+    if (fd_ < 0) {
+        freeaddrinfo(res);
+        Close(now_ms, strerror(errno));
+        return;
+    }
+    int on = 1;
+    setsockopt(fd_, IPPROTO_TCP, TCP_NODELAY, &on, sizeof(on));
+
+    // CONNECT goes out linked to the connect, CONNACK is the first thing to read
+    mqtt::ConnectOptions o;
+    o.client_id = options_.client_id;
+    o.username = options_.username;
+    o.password = options_.password;
+    o.keepalive_s = options_.keepalive_s;
+    out_len_ = mqtt::EncodeConnect(out_.data(), out_.size(), o);
+    out_sent_ = 0;
+    in_len_ = 0;
+    ping_outstanding_ = false;
+    last_tx_ms_ = now_ms;
+    state_ = State::kConnecting;
+    writing_ = io_->Connect(fd_, res->ai_addr, res->ai_addrlen, out_.data(), out_len_);
+    freeaddrinfo(res);
+    if (!writing_) {
+        Close(now_ms, "connect not submitted");
+    }
+}
+
+void MqttClient::OnConnected(int result, int64_t now_ms)
+{
+    if (result < 0) {
+        Close(now_ms, strerror(-result));
+        return;
+    }
+    // not before: an unconnected TCP socket polls as hung up
+    io_->AddReadable(fd_);
+    state_ = State::kWaitConnack;
+}
+
+void MqttClient::OnSent(int result, int64_t now_ms)
+{
+    writing_ = false;
+    if (result < 0) {
+        Close(now_ms, result == -ETIME ? "write timed out" : strerror(-result));
+        return;
+    }
+    out_sent_ += static_cast<size_t>(result);
+    last_tx_ms_ = now_ms;
+    // the rest of a short write, and whatever was encoded meanwhile
+    Flush();
+}
+
+void MqttClient::OnReadable(int64_t now_ms)
+{
+    if (fd_ >= 0) {
+        ReadPackets(now_ms);
+    }
+}
+
+void MqttClient::Close(int64_t now_ms, const char* why)
+{
+    if (why != nullptr) {
+        GW_LOGW("broker %s:%u: %s, retrying in %lld s", options_.host.c_str(), options_.port, why,
+                static_cast<long long>(backoff_ms_ / 1000));
+    }
+    if (fd_ >= 0) {
+        io_->Remove(fd_);
+        close(fd_);
+        fd_ = -1;
+    }
+    writing_ = false;
+    if (state_ == State::kConnected) {
+        stats_.disconnects++;
+    }
+    state_ = State::kIdle;
+    retry_at_ms_ = now_ms + backoff_ms_;
+    backoff_ms_ = std::min(backoff_ms_ * 2, kBackoffMaxMs);
+    out_len_ = out_sent_ = 0;
+    for (uint32_t i = 0; i < window_written_; i++) {
+        window_[(window_head_ + i) % window_.size()].dup = true;
+    }
+    window_written_ = 0;
+}
+
+void MqttClient::Disconnect()
+{
+    // straight to the socket, there is no loop round left for a completion
+    if (fd_ >= 0 && state_ == State::kConnected && !writing_) {
+        uint8_t buf[2];
+        size_t len = mqtt::EncodeDisconnect(buf, sizeof(buf));
+        (void)send(fd_, buf, len, MSG_NOSIGNAL | MSG_DONTWAIT);
+        stats_.disconnects++;
+    }
+    if (fd_ >= 0) {
+        io_->Remove(fd_);
+        close(fd_);
+        fd_ = -1;
+    }
+    writing_ = false;
+    state_ = State::kIdle;
+}
+
+bool MqttClient::Append(size_t len)
+{
+    if (len == 0) {
+        return false;
+    }
+    out_len_ += len;
+    return true;
+}
+
+void MqttClient::RecordLatency(Histogram& latency, int64_t ingest_ns, int64_t* now_ns)
+{
+    if (ingest_ns == 0) {
+        return;
+    }
+    if (*now_ns == 0) {
+        *now_ns = MonotonicNs();
+    }
+    latency.Record(static_cast<uint64_t>(std::max<int64_t>(*now_ns - ingest_ns, 0)));
+}
+
+void MqttClient::FillOutput()
+{
+    int64_t now_ns = 0;     // read once, for the first message that has a time
+    if (out_sent_ == out_len_ && !writing_) {
+        out_sent_ = out_len_ = 0;
+    }
+    if (options_.qos == 0) {
+        while (count_ > 0) {
+            const Message& m = ring_[head_];
+            size_t len = mqtt::EncodePublish(out_.data() + out_len_, out_.size() - out_len_,
+                                             std::string_view(m.topic, m.topic_len),
+                                             std::string_view(m.payload, m.payload_len), 0, 0, false);
+            if (!Append(len)) {
+                break;
+            }
+            RecordLatency(publish_ns_, m.ingest_ns, &now_ns);
+            head_ = (head_ + 1) % ring_.size();
+            count_--;
+            retired_++;
+            stats_.sent++;
+            stats_.acked++;
+        }
+        return;
+    }
+    while (count_ > 0 && window_count_ < window_.size()) {
+        Inflight& e = window_[(window_head_ + window_count_) % window_.size()];
+        e.msg = ring_[head_];
+        e.dup = false;
+        e.acked = false;
+        head_ = (head_ + 1) % ring_.size();
+        count_--;
+        window_count_++;
+    }
+    // in window order, so a reconnect resends in the order the messages were queued
+    while (window_written_ < window_count_) {
+        uint32_t pos = (window_head_ + window_written_) % window_.size();
+        Inflight& e = window_[pos];
+        if (!e.acked) {
+            const Message& m = e.msg;
+            size_t len = mqtt::EncodePublish(out_.data() + out_len_, out_.size() - out_len_,
+                                             std::string_view(m.topic, m.topic_len),
+                                             std::string_view(m.payload, m.payload_len), 1,
+                                             static_cast<uint16_t>(pos + 1), e.dup);
+            if (!Append(len)) {
+                break;
+            }
+            if (!e.dup) {
+                RecordLatency(publish_ns_, m.ingest_ns, &now_ns);
+            }
+            stats_.sent++;
+            stats_.resent += e.dup;
+        }
+        window_written_++;
+    }
+}
+
+bool MqttClient::Acknowledge(uint16_t packet_id, int64_t* now_ns)
+{
+    uint32_t pos = packet_id - 1u;
+    if (pos >= window_.size()) {
+        return false;
+    }
+    uint32_t age = (pos + window_.size() - window_head_) % window_.size();
+    // only what went out on this connection, a PUBACK from before a reconnect is stale
+    if (age >= window_written_ || window_[pos].acked) {
+        return false;
+    }
+    window_[pos].acked = true;
+    stats_.acked++;
+    RecordLatency(ack_ns_, window_[pos].msg.ingest_ns, now_ns);
+    // brokers acknowledge in order, an early one waits for the older ones
+    while (window_count_ > 0 && window_[window_head_].acked) {
+        window_head_ = (window_head_ + 1) % window_.size();
+        window_count_--;
+        window_written_--;
+        retired_++;
+    }
+    return true;
+}
+
+void MqttClient::Flush()
+{
+    if (writing_ || out_sent_ == out_len_) {
+        return;
+    }
+    writing_ = io_->Send(fd_, out_.data() + out_sent_, out_len_ - out_sent_);
+}
+
+bool MqttClient::ReadPackets(int64_t now_ms)
+{
+    for (;;) {
+        ssize_t n = recv(fd_, in_.data() + in_len_, in_.size() - in_len_, MSG_DONTWAIT);
+        if (n == 0) {
+            Close(now_ms, "connection closed");
+            return false;
+        }
+        if (n < 0) {
+            if (errno == EAGAIN || errno == EWOULDBLOCK) {
+                break;
+            }
+            if (errno == EINTR) {
+                continue;
+            }
+            Close(now_ms, strerror(errno));
+            return false;
+        }
+        in_len_ += static_cast<size_t>(n);
+
+        size_t pos = 0;
+        bool acked = false;
+        int64_t now_ns = 0;
+        for (;;) {
+            mqtt::Packet packet;
+            size_t used = 0;
+            mqtt::Decode d = mqtt::DecodePacket(in_.data() + pos, in_len_ - pos, packet, &used);
+            if (d == mqtt::Decode::kIncomplete) {
+                break;
+            }
+            if (d == mqtt::Decode::kMalformed) {
+                Close(now_ms, "malformed packet");
+                return false;
+            }
+            pos += used;
+            switch (packet.type) {
+            case mqtt::kConnack:
+                if (packet.return_code != 0) {
+                    GW_LOGE("broker refused the connection, return code %u", packet.return_code);
+                    Close(now_ms, "connection refused");
+                    return false;
+                }
+                state_ = State::kConnected;
+                backoff_ms_ = kBackoffMinMs;
+                stats_.connects++;
+                GW_LOGI("connected to broker %s:%u as %s", options_.host.c_str(), options_.port,
+                        options_.client_id.c_str());
+                break;
+            case mqtt::kPuback:
+                acked |= Acknowledge(packet.packet_id, &now_ns);
+                break;
+            case mqtt::kPingresp:
+                ping_outstanding_ = false;
+                break;
+            default:
+                break;
+            }
+        }
+        stats_.round_trips += acked;
+        std::memmove(in_.data(), in_.data() + pos, in_len_ - pos);
+        in_len_ -= pos;
+        if (in_len_ == in_.size()) {
+            Close(now_ms, "packet larger than the input buffer");
+            return false;
+        }
+    }
+    return true;
+}
+
+void MqttClient::Process(int64_t now_ms)
+{
+    if (io_ == nullptr) {
+        return;
+    }
+    if (state_ == State::kIdle) {
+        if (now_ms >= retry_at_ms_) {
+            StartConnect(now_ms);
+        }
+        return;
+    }
+    if (state_ == State::kConnecting) {
+        if (now_ms - last_tx_ms_ > kConnackTimeoutMs) {
+            Close(now_ms, "connect timed out");
+        }
+        return;
+    }
+    if (state_ == State::kWaitConnack && now_ms - last_tx_ms_ > kConnackTimeoutMs) {
+        Close(now_ms, "no CONNACK");
+        return;
+    }
+    if (state_ == State::kConnected) {
+        int64_t keepalive_ms = options_.keepalive_s * 1000LL;
+        if (ping_outstanding_ && now_ms - ping_sent_ms_ > keepalive_ms) {
+            Close(now_ms, "keepalive timed out");
+            return;
+        }
+        if (!ping_outstanding_ && now_ms - last_tx_ms_ >= keepalive_ms && out_sent_ == out_len_ && !writing_) {
+            out_sent_ = 0;
+            out_len_ = mqtt::EncodePingreq(out_.data(), out_.size());
+            ping_outstanding_ = true;
+            ping_sent_ms_ = now_ms;
+        }
+        FillOutput();
+    }
+    Flush();
+}
+
+}  // namespace gateway
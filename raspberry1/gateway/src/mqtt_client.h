@@ -0,0 +1,204 @@
+/*
+ * Non-blocking MQTT 3.1.1 publisher for the gateway's event loop.
+ *
+ * Messages wait in a ring of fixed size slots allocated at start. What a full ring does
+ * with one more is the queue policy: push out the oldest or refuse the new one. With
+ * kLatest a message overwrites the one of its topic still queued once the queue is a
+ * quarter full, so while the broker is behind the queue holds the latest value of
+ * every node and measurement, each in the place of the first one that waited; a direct
+ * mapped index by topic hash finds it, and when the queue is full with other topics
+ * the oldest goes. Below the quarter every message is kept. With kBlock the caller
+ * keeps the ring from filling, see space(). Up to max_inflight QoS 1 messages are on the wire without
+ * a PUBACK; a message takes the window slot of one that was acknowledged and with it
+ * its packet id, so ids run 1..max_inflight and the PUBACK finds its slot by the id.
+ * What has no PUBACK is sent again in order with DUP set after a reconnect. The
+ * connection comes back with a backoff of 1 s doubling up to 30 s.
+ *
+ * Connects and writes go through the loop's IoBackend and come back as completions, one
+ * write in flight at a time; everything encoded meanwhile goes out together with the
+ * next write, so a burst of PUBLISHes costs one send. The output buffer is the
+ * backend's registered send buffer. Reads are plain recv() once the backend reports the
+ * socket readable.
+ *
+ * A message may carry the time its datagram came in; publish_latency() then has the
+ * time to its first write, ack_latency() the time to its PUBACK (QoS 0: none).
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstdint>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io_backend.h"
+#include "metrics.h"
+
+namespace gateway {
+
+enum class QueuePolicy : uint8_t { kBlock, kDropOldest, kDropNewest, kLatest };
+
+struct MqttOptions {
+    std::string host;
+    uint16_t port = 1883;
+    std::string client_id;
+    std::string username;
+    std::string password;
+    uint16_t keepalive_s = 60;
+    uint8_t qos = 1;
+    uint32_t queue_size = 1024;
+    QueuePolicy policy = QueuePolicy::kDropOldest;
+    uint16_t max_inflight = 16;     // QoS 1 messages without a PUBACK, 1 waits for each
+};
+
+struct MqttStats {
+    uint64_t queued = 0;        // messages accepted by Publish()
+    uint64_t sent = 0;          // PUBLISH packets written, resends included
+    uint64_t acked = 0;         // PUBACKs for QoS 1, equal to sent for QoS 0
+    uint64_t dropped = 0;       // pushed out of the full queue, refused by it or too long for a slot
+    uint64_t replaced = 0;      // queued messages a newer one of their topic overwrote
+    uint32_t max_depth = 0;     // the most messages the queue held
+    uint64_t resent = 0;
+    uint64_t connects = 0;      // CONNACKs accepted
+    uint64_t disconnects = 0;
+    uint64_t round_trips = 0;   // reads that brought PUBACKs, what the messages waited on
+};
+
+class MqttClient {
+public:
+    static constexpr size_t kTopicMax = 128;
+    static constexpr size_t kPayloadMax = 64;
+
+    explicit MqttClient(const MqttOptions& options);
+    ~MqttClient();
+
+    MqttClient(const MqttClient&) = delete;
+    MqttClient& operator=(const MqttClient&) = delete;
+
+    // false when the message was dropped: a part does not fit its slot, or the queue is
+    // full with kDropNewest. With replace false kLatest neither overwrites the queued
+    // message of the topic nor lets a later one overwrite this one, for the spool's
+    // backlog, older than what is queued. ingest_ns is MonotonicNs() when its datagram
+    // came in, 0 for no latency.
+    bool Publish(std::string_view topic, std::string_view payload, bool replace = true, int64_t ingest_ns = 0);
+
+    // The backend the connection runs on, it has to outlive the client. Without one the
+    // client only queues.
+    void SetIo(IoBackend* io);
+
+    // socket of the connection, -1 while disconnected
+    int fd() const { return fd_; }
+    // completions and readiness of fd() from the backend
+    void OnConnected(int result, int64_t now_ms);
+    void OnSent(int result, int64_t now_ms);
+    void OnReadable(int64_t now_ms);
+    // runs the timers and starts the next write, call after every Wait()
+    void Process(int64_t now_ms);
+    // milliseconds until Process() has a timer to run, for the wait timeout
+    int64_t NextTimeoutMs(int64_t now_ms) const;
+
+    // sends DISCONNECT if connected and closes the socket
+    void Disconnect();
+
+    bool connected() const { return state_ == State::kConnected; }
+    uint32_t pending() const { return count_ + window_count_; }
+    // messages waiting for the connection, and room for more before the policy decides
+    uint32_t depth() const { return count_; }
+    uint32_t space() const { return static_cast<uint32_t>(ring_.size()) - count_; }
+    uint32_t capacity() const { return static_cast<uint32_t>(ring_.size()); }
+    // Messages in the order they were queued: the number the next Publish() gets, and
+    // how many have left, acknowledged, sent with QoS 0 or dropped. A message is done
+    // once retired() - number, as int32_t, is above 0.
+    uint32_t pushed() const { return pushed_; }
+    uint32_t retired() const { return retired_; }
+    // Calls fn(number, topic, payload) for every message not retired, oldest first: the
+    // window without what was acknowledged, then the queue.
+    template <typename Fn>
+    void ForEachPending(Fn&& fn) const
+    {
+        for (uint32_t i = 0; i < window_count_; i++) {
+            const Inflight& e = window_[(window_head_ + i) % window_.size()];
+            if (!e.acked) {
+                fn(e.msg.number, std::string_view(e.msg.topic, e.msg.topic_len),
+                   std::string_view(e.msg.payload, e.msg.payload_len));
+            }
+        }
+        for (uint32_t i = 0; i < count_; i++) {
+            const Message& m = ring_[(head_ + i) % ring_.size()];
+            fn(m.number, std::string_view(m.topic, m.topic_len), std::string_view(m.payload, m.payload_len));
+        }
+    }
+    // nothing encoded is waiting for the socket
+    bool flushed() const { return !writing_ && out_sent_ == out_len_; }
+    const MqttStats& stats() const { return stats_; }
+    // nanoseconds from ingest to the first write and to the PUBACK, recorded by the loop
+    const Histogram& publish_latency() const { return publish_ns_; }
+    const Histogram& ack_latency() const { return ack_ns_; }
+
+private:
+    enum class State : uint8_t { kIdle, kConnecting, kWaitConnack, kConnected };
+
+    struct Message {
+        int64_t ingest_ns;          // 0 when not known
+        uint32_t number;            // pushed() when it was queued
+        uint8_t topic_len;
+        uint8_t payload_len;
+        char topic[kTopicMax];
+        char payload[kPayloadMax];
+    };
+
+    // QoS 1 message with its packet id the window position + 1
+    struct Inflight {
+        Message msg;
+        bool dup;                   // written on an earlier connection
+        bool acked;                 // PUBACK came before the ones of older messages
+    };
+
+    void StartConnect(int64_t now_ms);
+    void Close(int64_t now_ms, const char* why);
+    bool ReadPackets(int64_t now_ms);
+    void Flush();
+    void FillOutput();
+    // from the ingest time to now, once per message
+    void RecordLatency(Histogram& latency, int64_t ingest_ns, int64_t* now_ns);
+    bool Append(size_t len);
+    bool Acknowledge(uint16_t packet_id, int64_t* now_ns);
+    // kLatest: overwrites the queued message of topic, false when there is none
+    bool Replace(uint32_t hash, std::string_view topic, std::string_view payload, int64_t ingest_ns);
+
+    MqttOptions options_;
+    IoBackend* io_ = nullptr;
+    State state_ = State::kIdle;
+    int fd_ = -1;
+    int64_t retry_at_ms_ = 0;
+    int64_t backoff_ms_ = 1000;
+    int64_t last_tx_ms_ = 0;
+    int64_t ping_sent_ms_ = 0;
+    bool ping_outstanding_ = false;
+
+    std::vector<Message> ring_;
+    uint32_t head_ = 0;
+    uint32_t count_ = 0;
+    uint32_t pushed_ = 0;               // messages ever queued, the number of the next one
+    uint32_t retired_ = 0;              // of them gone from the queue and the window
+    std::vector<uint32_t> latest_;      // kLatest: by topic hash, the number of the newest
+
+    std::vector<Inflight> window_;
+    uint32_t window_head_ = 0;      // oldest message without a PUBACK
+    uint32_t window_count_ = 0;
+    uint32_t window_written_ = 0;   // from the head, in the output buffer or on the wire
+
+    std::vector<uint8_t> out_;
+    size_t out_len_ = 0;
+    size_t out_sent_ = 0;           // written and confirmed, the write in flight starts here
+    bool writing_ = false;
+    std::vector<uint8_t> in_;
+    size_t in_len_ = 0;
+
+    MqttStats stats_;
+    Histogram publish_ns_;
+    Histogram ack_ns_;
+};
+
+}  // namespace gateway
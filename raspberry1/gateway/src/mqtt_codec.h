@@ -0,0 +1,62 @@
+/*
+ * MQTT 3.1.1 packets the gateway needs: CONNECT, PUBLISH at QoS 0 and 1, PINGREQ and
+ * DISCONNECT out, CONNACK, PUBACK and PINGRESP in. Encoders write into a caller
+ * buffer and return the length, 0 when it does not fit.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace gateway {
+namespace mqtt {
+
+enum PacketType : uint8_t {
+    kConnect = 1,
+    kConnack = 2,
+    kPublish = 3,
+    kPuback = 4,
+    kSubscribe = 8,
+    kSuback = 9,
+    kPingreq = 12,
+    kPingresp = 13,
+    kDisconnect = 14,
+};
+
+struct ConnectOptions {
+    std::string_view client_id;
+    std::string_view username;      // empty for none
+    std::string_view password;      // only sent with a username
+    uint16_t keepalive_s = 60;
+    bool clean_session = true;
+};
+
+// fixed header plus remaining length never exceeds this
+constexpr size_t kMaxHeader = 5;
+
+size_t EncodeConnect(uint8_t* buf, size_t size, const ConnectOptions& options);
+size_t EncodePublish(uint8_t* buf, size_t size, std::string_view topic, std::string_view payload,
+                     uint8_t qos, uint16_t packet_id, bool dup);
+size_t EncodePuback(uint8_t* buf, size_t size, uint16_t packet_id);
+size_t EncodePingreq(uint8_t* buf, size_t size);
+size_t EncodeDisconnect(uint8_t* buf, size_t size);
+
+struct Packet {
+    PacketType type;
+    uint8_t flags;              // low nibble of the first byte
+    uint16_t packet_id;         // PUBACK, SUBACK, QoS 1 PUBLISH
+    uint8_t return_code;        // CONNACK
+    std::string_view topic;     // PUBLISH
+    std::string_view payload;   // PUBLISH
+};
+
+enum class Decode : uint8_t { kOk, kIncomplete, kMalformed };
+
+// one packet from the start of buf, *used is its length when kOk
+Decode DecodePacket(const uint8_t* buf, size_t len, Packet& out, size_t* used);
+
+}  // namespace mqtt
+}  // namespace gateway
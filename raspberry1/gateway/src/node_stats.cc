@@ -0,0 +1,190 @@
+/*
+ * Compact statistics per node.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "node_stats.h"
+
+#include <sched.h>
+
+#include <algorithm>
+#include <cmath>
+#include <cstring>
+
+#include "node_table.h"
+
+namespace gateway {
+
+namespace {
+
+// sequence numbers at most this far behind the last one are late, further back a restart
+constexpr int32_t kLateWindow = 64;
+
+uint32_t Key(std::string_view id)
+{
+    uint32_t hash = HashNodeId(id);
+    return hash == 1 ? 2 : hash;    // 1 marks a slot being claimed
+}
+
+}  // namespace
+
+NodeStatsTable::NodeStatsTable(uint32_t max_nodes) : max_nodes_(max_nodes)
+{
+    uint32_t size = 2;
+    while (size < 2 * max_nodes) {
+        size <<= 1;
+    }
+    slots_.reset(new Slot[size]);
+    mask_ = size - 1;
+}
+
+NodeStatsTable::Slot* NodeStatsTable::Claim(std::string_view id, uint32_t hash)
+{
+    bool reserved = false;
+    for (uint32_t i = hash & mask_;; i = (i + 1) & mask_) {
+        Slot& s = slots_[i];
+        uint32_t h = s.hash.load(std::memory_order_acquire);
+        if (h == 0) {
+            // the count keeps the table half empty, so the probe always ends
+            if (!reserved) {
+                if (used_.fetch_add(1, std::memory_order_relaxed) >= max_nodes_) {
+                    used_.fetch_sub(1, std::memory_order_relaxed);
+                    untracked_.fetch_add(1, std::memory_order_relaxed);
+                    return nullptr;
+                }
+                reserved = true;
+            }
+            if (s.hash.compare_exchange_strong(h, kClaimed, std::memory_order_acquire)) {
+                std::memcpy(s.id, id.data(), id.size());
+                s.id_len = static_cast<uint8_t>(id.size());
+                s.hash.store(hash, std::memory_order_release);
+                return &s;
+            }
+            // someone else claimed it, maybe for this id
+        }
+        while (h == kClaimed) {
+            sched_yield();
+            h = s.hash.load(std::memory_order_acquire);
+        }
+        if (h == hash && std::string_view(s.id, s.id_len) == id) {
+            if (reserved) {
+                used_.fetch_sub(1, std::memory_order_relaxed);
+            }
+            return &s;
+        }
+    }
+}
+
+const NodeStatsTable::Slot* NodeStatsTable::Lookup(std::string_view id, uint32_t hash) const
+{
+    for (uint32_t i = hash & mask_;; i = (i + 1) & mask_) {
+        const Slot& s = slots_[i];
+        uint32_t h = s.hash.load(std::memory_order_acquire);
+        if (h == 0 || h == kClaimed) {
+            return nullptr;     // one being claimed now has no sample yet
+        }
+        if (h == hash && std::string_view(s.id, s.id_len) == id) {
+            return &s;
+        }
+    }
+}
+
+bool NodeStatsTable::Update(const Record& record, int64_t now_ms)
+{
+    if (record.kind != RecordKind::kSample) {
+        return true;
+    }
+    Slot* s = Claim(record.node_id, Key(record.node_id));
+    if (s == nullptr) {
+        return false;
+    }
+    uint32_t version = s->version.load(std::memory_order_relaxed);
+    while ((version & 1) ||
+           !s->version.compare_exchange_weak(version, version + 1, std::memory_order_acquire,
+                                             std::memory_order_relaxed)) {
+        sched_yield();
+        version = s->version.load(std::memory_order_relaxed);
+    }
+    // the odd count visible before any field, the acquire CAS alone lets them pass it
+    std::atomic_thread_fence(std::memory_order_release);
+
+    uint32_t samples = s->samples.load(std::memory_order_relaxed);
+    int64_t last_seen = s->last_seen_ms.load(std::memory_order_relaxed);
+    uint8_t flags = 0;
+    if (record.has_seq) {
+        uint32_t last = s->last_seq.load(std::memory_order_relaxed);
+        int32_t step = static_cast<int32_t>(record.seq - last);
+        if (samples == 0 || step < -kLateWindow) {
+            flags |= samples == 0 ? 0 : kNodeRestarted;
+            s->last_seq.store(record.seq, std::memory_order_relaxed);
+        } else if (step <= 0) {
+            flags |= kNodeLate;
+        } else {
+            if (step > 1) {
+                flags |= kNodeGap;
+                s->missing.store(s->missing.load(std::memory_order_relaxed) + static_cast<uint32_t>(step - 1),
+                                 std::memory_order_relaxed);
+            }
+            s->last_seq.store(record.seq, std::memory_order_relaxed);
+            // per sequence number, a forecasting node's skips stretch the time between samples
+            int64_t per_step = std::max<int64_t>(now_ms - last_seen, 0) / step;
+            int64_t interval = s->interval_ms.load(std::memory_order_relaxed);
+            interval = interval == 0 ? per_step : interval + (per_step - interval) / 8;
+            s->interval_ms.store(static_cast<uint32_t>(interval), std::memory_order_relaxed);
+        }
+    }
+    const Field* temp = record.Find("temp");
+    const Field* hum = record.Find("hum");
+    if (temp) {
+        flags |= temp->value < -40 || temp->value > 85 ? kNodeOutOfRange : 0;
+        s->temp.store(static_cast<int32_t>(std::lround(temp->value * 100)), std::memory_order_relaxed);
+    }
+    if (hum) {
+        flags |= hum->value < 0 || hum->value > 100 ? kNodeOutOfRange : 0;
+        s->hum.store(static_cast<int32_t>(std::lround(hum->value * 100)), std::memory_order_relaxed);
+    }
+    s->flags.store(flags, std::memory_order_relaxed);
+    s->last_seen_ms.store(now_ms, std::memory_order_relaxed);
+    s->samples.store(samples + 1, std::memory_order_relaxed);
+
+    s->version.store(version + 2, std::memory_order_release);
+    return true;
+}
+
+bool NodeStatsTable::Read(const Slot& slot, NodeStats* out)
+{
+    if (slot.hash.load(std::memory_order_acquire) <= kClaimed) {
+        return false;
+    }
+    for (;;) {
+        uint32_t version = slot.version.load(std::memory_order_acquire);
+        if (version & 1) {
+            sched_yield();
+            continue;
+        }
+        out->flags = slot.flags.load(std::memory_order_relaxed);
+        out->last_seen_ms = slot.last_seen_ms.load(std::memory_order_relaxed);
+        out->samples = slot.samples.load(std::memory_order_relaxed);
+        out->last_seq = slot.last_seq.load(std::memory_order_relaxed);
+        out->missing = slot.missing.load(std::memory_order_relaxed);
+        out->interval_ms = slot.interval_ms.load(std::memory_order_relaxed);
+        out->temp = slot.temp.load(std::memory_order_relaxed);
+        out->hum = slot.hum.load(std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_acquire);
+        if (slot.version.load(std::memory_order_relaxed) == version) {
+            break;
+        }
+    }
+    // written once before the hash was
+    std::memcpy(out->id, slot.id, sizeof(out->id));
+    out->id_len = slot.id_len;
+    return out->samples > 0;
+}
+
+bool NodeStatsTable::Find(std::string_view id, NodeStats* out) const
+{
+    const Slot* s = Lookup(id, Key(id));
+    return s != nullptr && Read(*s, out);
+}
+
+}  // namespace gateway
@@ -0,0 +1,118 @@
+/*
+ * Compact statistics per node, updated by whichever thread receives the node's samples
+ * and read from any other without holding them up.
+ *
+ * An open addressing table with linear probing over cache line sized records,
+ * allocated at start and at most half full. A record is claimed for an id with one
+ * compare-and-swap and kept for good; once max_nodes are in, a new node is only counted
+ * in untracked(). A record carries a sequence count: a writer makes it odd for its
+ * update, a reader copies the record and tries again when the count moved meanwhile.
+ * The writer has a release fence between making the count odd and its first field
+ * store: the acquire CAS alone does not keep another core from seeing a field store
+ * before the odd count (ARM can), and a reader would then take a half written record
+ * under the old even count.
+ * Two writers of one node (hash steering while it changes its port) take turns on the
+ * count; with node steering or a single loop there is one.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+#include "parser.h"
+#include "udp_ingest.h"
+
+namespace gateway {
+
+// what the last sample of a node showed
+enum NodeFlag : uint8_t {
+    kNodeGap = 1 << 0,          // sequence numbers were missing before it
+    kNodeLate = 1 << 1,         // a sequence number at or shortly before the last one
+    kNodeRestarted = 1 << 2,    // sequence far behind the last one, the node rebooted
+    kNodeOutOfRange = 1 << 3,   // temp outside -40..85 or hum outside 0..100
+};
+
+// a consistent copy of a node's record
+struct NodeStats {
+    char id[kNodeIdMax];
+    uint8_t id_len;
+    uint8_t flags;              // NodeFlag of the last sample
+    int64_t last_seen_ms;
+    uint32_t samples;
+    uint32_t last_seq;
+    uint32_t missing;           // sequence numbers never received, forecast skips included
+    uint32_t interval_ms;       // between sequence numbers, moving average
+    int32_t temp;               // last values in 0.01 units
+    int32_t hum;
+
+    std::string_view Id() const { return std::string_view(id, id_len); }
+};
+
+class NodeStatsTable {
+public:
+    explicit NodeStatsTable(uint32_t max_nodes);
+
+    NodeStatsTable(const NodeStatsTable&) = delete;
+    NodeStatsTable& operator=(const NodeStatsTable&) = delete;
+
+    // Counts a sample (other records are ignored), from any thread. False when the
+    // node is new and the table full.
+    bool Update(const Record& record, int64_t now_ms);
+
+    // a copy of the node's record, false when it has none
+    bool Find(std::string_view id, NodeStats* out) const;
+
+    // Calls fn(const NodeStats&) for every node, from any thread; nodes that come in
+    // meanwhile may or may not be visited.
+    template <typename Fn>
+    void ForEach(Fn&& fn) const
+    {
+        NodeStats copy;
+        for (uint32_t i = 0; i <= mask_; i++) {
+            if (Read(slots_[i], &copy)) {
+                fn(copy);
+            }
+        }
+    }
+
+    uint32_t size() const { return used_.load(std::memory_order_relaxed); }
+    // samples of nodes that found the table full
+    uint64_t untracked() const { return untracked_.load(std::memory_order_relaxed); }
+    size_t bytes() const { return (static_cast<size_t>(mask_) + 1) * sizeof(Slot); }
+
+private:
+    struct alignas(kCacheLine) Slot {
+        std::atomic<uint32_t> hash{0};      // 0 free, kClaimed while the id goes in
+        std::atomic<uint32_t> version{0};   // odd while a writer is at it
+        char id[kNodeIdMax] = {};
+        uint8_t id_len = 0;
+        std::atomic<uint8_t> flags{0};
+        std::atomic<int64_t> last_seen_ms{0};
+        std::atomic<uint32_t> samples{0};
+        std::atomic<uint32_t> last_seq{0};
+        std::atomic<uint32_t> missing{0};
+        std::atomic<uint32_t> interval_ms{0};
+        std::atomic<int32_t> temp{0};
+        std::atomic<int32_t> hum{0};
+    };
+    static_assert(sizeof(Slot) == kCacheLine, "one record per cache line");
+
+    static constexpr uint32_t kClaimed = 1;
+
+    // the node's slot, claimed when it has none, nullptr when the table is full
+    Slot* Claim(std::string_view id, uint32_t hash);
+    const Slot* Lookup(std::string_view id, uint32_t hash) const;
+    static bool Read(const Slot& slot, NodeStats* out);
+
+    std::unique_ptr<Slot[]> slots_;
+    uint32_t mask_;
+    uint32_t max_nodes_;
+    alignas(kCacheLine) std::atomic<uint32_t> used_{0};
+    std::atomic<uint64_t> untracked_{0};
+};
+
+}  // namespace gateway
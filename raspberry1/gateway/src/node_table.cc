@@ -0,0 +1,110 @@
+/*
+ * Per node state.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "node_table.h"
+
+#include <cstring>
+
+namespace gateway {
+
+SlotIndex::SlotIndex(uint32_t slots)
+{
+    uint32_t size = 2;
+    while (size < 2 * slots) {
+        size <<= 1;
+    }
+    entries_.assign(size, Entry{0, 0});
+    mask_ = size - 1;
+}
+
+void SlotIndex::Insert(uint32_t hash, uint32_t slot)
+{
+    uint32_t i = hash & mask_;
+    while (entries_[i].slot != 0) {
+        i = (i + 1) & mask_;
+    }
+    entries_[i] = Entry{hash, slot + 1};
+}
+
+void SlotIndex::Erase(uint32_t hash, uint32_t slot)
+{
+    uint32_t i = hash & mask_;
+    while (entries_[i].slot != slot + 1) {
+        if (entries_[i].slot == 0) {
+            return;
+        }
+        i = (i + 1) & mask_;
+    }
+    // moves back every later entry of the run that the hole would cut off from its home
+    for (uint32_t j = (i + 1) & mask_; entries_[j].slot != 0; j = (j + 1) & mask_) {
+        uint32_t home = entries_[j].hash & mask_;
+        if (((j - home) & mask_) >= ((j - i) & mask_)) {
+            entries_[i] = entries_[j];
+            i = j;
+        }
+    }
+    entries_[i] = Entry{0, 0};
+}
+
+NodeTable::NodeTable(uint32_t capacity, int32_t tol_temp, int32_t tol_hum, uint32_t keyframe)
+    : nodes_(capacity), by_id_(capacity), by_addr_(capacity), tol_temp_(tol_temp), tol_hum_(tol_hum),
+      keyframe_(keyframe)
+{
+}
+
+uint32_t NodeTable::HashAddr(const sockaddr_in& addr)
+{
+    uint64_t key = static_cast<uint64_t>(addr.sin_addr.s_addr) << 16 | addr.sin_port;
+    return static_cast<uint32_t>((key * 0x9E3779B97F4A7C15ull) >> 32);
+}
+
+Node& NodeTable::Get(std::string_view id, const sockaddr_in& from, int64_t now_ms)
+{
+    uint32_t hash = HashNodeId(id);
+    int64_t found = by_id_.Find(hash, [&](uint32_t slot) { return nodes_[slot].Id() == id; });
+    Node* slot;
+    if (found >= 0) {
+        slot = &nodes_[found];
+        if (slot->addr.sin_addr.s_addr != from.sin_addr.s_addr || slot->addr.sin_port != from.sin_port) {
+            by_addr_.Erase(HashAddr(slot->addr), static_cast<uint32_t>(found));
+            by_addr_.Insert(HashAddr(from), static_cast<uint32_t>(found));
+        }
+    } else {
+        if (used_ < nodes_.size()) {
+            slot = &nodes_[used_++];
+        } else {
+            slot = &nodes_[0];
+            for (Node& n : nodes_) {
+                slot = n.last_seen_ms < slot->last_seen_ms ? &n : slot;
+            }
+            uint32_t index = static_cast<uint32_t>(slot - nodes_.data());
+            by_id_.Erase(HashNodeId(slot->Id()), index);
+            by_addr_.Erase(HashAddr(slot->addr), index);
+            evicted_++;
+        }
+        uint32_t index = static_cast<uint32_t>(slot - nodes_.data());
+        std::memset(slot->id, 0, sizeof(slot->id));
+        std::memcpy(slot->id, id.data(), id.size());
+        slot->id_len = static_cast<uint8_t>(id.size());
+        slot->samples = 0;
+        slot->predicted = 0;
+        slot->forecast.Init(tol_temp_, tol_hum_, keyframe_);
+        by_id_.Insert(hash, index);
+        by_addr_.Insert(HashAddr(from), index);
+    }
+    slot->addr = from;
+    slot->last_seen_ms = now_ms;
+    return *slot;
+}
+
+Node* NodeTable::FindByAddr(const sockaddr_in& from)
+{
+    int64_t found = by_addr_.Find(HashAddr(from), [&](uint32_t slot) {
+        return nodes_[slot].addr.sin_addr.s_addr == from.sin_addr.s_addr && nodes_[slot].addr.sin_port == from.sin_port;
+    });
+    return found >= 0 ? &nodes_[found] : nullptr;
+}
+
+}  // namespace gateway
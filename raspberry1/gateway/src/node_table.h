@@ -0,0 +1,108 @@
+/*
+ * Per node state, a fixed number of slots allocated at start.
+ *
+ * The slots are found by id and by address through two open addressing indexes, so a
+ * lookup costs the same for ten nodes as for a million. When the table is full the
+ * node that was quiet the longest gives up its slot; finding it walks all slots, which
+ * only a new node on a full table pays.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+#include "forecast_fill.h"
+#include "parser.h"
+
+namespace gateway {
+
+// FNV-1a of a node id, never 0
+inline uint32_t HashNodeId(std::string_view id)
+{
+    uint32_t h = 2166136261u;
+    for (char c : id) {
+        h = (h ^ static_cast<uint8_t>(c)) * 16777619u;
+    }
+    return h ? h : 1;
+}
+
+struct Node {
+    char id[kNodeIdMax];
+    uint8_t id_len;
+    sockaddr_in addr;           // where its last datagram came from, names the sender of #PROBE lines
+    int64_t last_seen_ms;
+    uint64_t samples;
+    uint64_t predicted;
+    ForecastFill forecast;
+
+    std::string_view Id() const { return std::string_view(id, id_len); }
+};
+
+// Slot numbers by hash, linear probing in an array at most half full. The caller
+// tells by the slot whether an entry with its hash is the one it looks for.
+class SlotIndex {
+public:
+    explicit SlotIndex(uint32_t slots);
+
+    // the first slot with this hash that match(slot) accepts, -1 when none
+    template <typename Match>
+    int64_t Find(uint32_t hash, Match&& match) const
+    {
+        for (uint32_t i = hash & mask_;; i = (i + 1) & mask_) {
+            const Entry& e = entries_[i];
+            if (e.slot == 0) {
+                return -1;
+            }
+            if (e.hash == hash && match(e.slot - 1)) {
+                return e.slot - 1;
+            }
+        }
+    }
+    void Insert(uint32_t hash, uint32_t slot);
+    void Erase(uint32_t hash, uint32_t slot);
+
+    size_t bytes() const { return entries_.size() * sizeof(Entry); }
+
+private:
+    struct Entry {
+        uint32_t hash;
+        uint32_t slot;          // slot + 1, 0 for an empty entry
+    };
+
+    std::vector<Entry> entries_;
+    uint32_t mask_;
+};
+
+class NodeTable {
+public:
+    NodeTable(uint32_t capacity, int32_t tol_temp, int32_t tol_hum, uint32_t keyframe);
+
+    // the node's slot, a new or reused one for an unknown id
+    Node& Get(std::string_view id, const sockaddr_in& from, int64_t now_ms);
+    // node whose last datagram came from this address, nullptr when none did
+    Node* FindByAddr(const sockaddr_in& from);
+
+    uint32_t size() const { return used_; }
+    uint64_t evicted() const { return evicted_; }
+    // slots and indexes
+    size_t bytes() const { return nodes_.size() * sizeof(Node) + by_id_.bytes() + by_addr_.bytes(); }
+
+private:
+    static uint32_t HashAddr(const sockaddr_in& addr);
+
+    std::vector<Node> nodes_;
+    SlotIndex by_id_;
+    SlotIndex by_addr_;
+    uint32_t used_ = 0;
+    uint64_t evicted_ = 0;
+    int32_t tol_temp_;
+    int32_t tol_hum_;
+    uint32_t keyframe_;
+};
+
+}  // namespace gateway
@@ -0,0 +1,302 @@
+/*
+ * Datagram formats the nodes send.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "parser.h"
+
+#include <charconv>
+#include <cstring>
+
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#elif defined(__ARM_NEON)
+#include <arm_neon.h>
+#endif
+
+namespace gateway {
+
+const std::string_view kProbeFields[14] = {
+    "sent", "received", "lost", "late", "duplicate", "loss_permille", "rtt_min",
+    "rtt_p50", "rtt_p90", "rtt_p99", "rtt_max", "srtt", "jitter", "rto",
+};
+
+namespace {
+
+constexpr std::string_view kProbePrefix = "#PROBE,";
+constexpr size_t kNone = std::string_view::npos;
+
+/*
+ * Finds the ',' and '=' of a datagram 16 bytes at a time. A block becomes a mask with
+ * 1 << kLaneShift bits per byte: SSE2 has a byte mask (movemask), NEON gets 4 bits per byte by
+ * narrowing the compare result. The last, short block is copied to a zeroed one first,
+ * so no load reads past the datagram.
+ */
+constexpr size_t kBlock = 16;
+#if defined(__SSE2__)
+constexpr unsigned kLaneShift = 0;
+
+uint64_t DelimiterMask(const char* p)
+{
+    __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i*>(p));
+    __m128i d = _mm_or_si128(_mm_cmpeq_epi8(v, _mm_set1_epi8(',')), _mm_cmpeq_epi8(v, _mm_set1_epi8('=')));
+    return static_cast<uint32_t>(_mm_movemask_epi8(d));
+}
+#elif defined(__ARM_NEON)
+constexpr unsigned kLaneShift = 2;
+
+uint64_t DelimiterMask(const char* p)
+{
+    uint8x16_t v = vld1q_u8(reinterpret_cast<const uint8_t*>(p));
+    uint8x16_t d = vorrq_u8(vceqq_u8(v, vdupq_n_u8(',')), vceqq_u8(v, vdupq_n_u8('=')));
+    return vget_lane_u64(vreinterpret_u64_u8(vshrn_n_u16(vreinterpretq_u16_u8(d), 4)), 0);
+}
+#else
+constexpr unsigned kLaneShift = 0;
+
+uint64_t DelimiterMask(const char* p)
+{
+    uint64_t mask = 0;
+    for (size_t i = 0; i < kBlock; i++) {
+        mask |= static_cast<uint64_t>(p[i] == ',' || p[i] == '=') << i;
+    }
+    return mask;
+}
+#endif
+constexpr uint64_t kLaneMask = (uint64_t(1) << (1u << kLaneShift)) - 1;
+
+// the delimiters of a text front to back
+class DelimiterScan {
+public:
+    explicit DelimiterScan(std::string_view text) : text_(text) { Load(0); }
+
+    // position of the next ',' or '=', kNone after the last
+    size_t Next()
+    {
+        while (mask_ == 0) {
+            if (base_ + kBlock >= text_.size()) {
+                return kNone;
+            }
+            Load(base_ + kBlock);
+        }
+        unsigned bit = static_cast<unsigned>(__builtin_ctzll(mask_));
+        unsigned lane = bit >> kLaneShift;
+        mask_ &= ~(kLaneMask << (lane << kLaneShift));
+        return base_ + lane;
+    }
+
+    // position of the next ',', kNone after the last
+    size_t NextComma()
+    {
+        size_t at;
+        while ((at = Next()) != kNone && text_[at] != ',') {
+        }
+        return at;
+    }
+
+private:
+    void Load(size_t base)
+    {
+        base_ = base;
+        if (text_.size() - base >= kBlock) {
+            mask_ = DelimiterMask(text_.data() + base);
+            return;
+        }
+        char tail[kBlock] = {};
+        std::memcpy(tail, text_.data() + base, text_.size() - base);
+        mask_ = DelimiterMask(tail);
+    }
+
+    std::string_view text_;
+    size_t base_ = 0;
+    uint64_t mask_ = 0;
+};
+
+bool IsKeyChar(char c)
+{
+    return (c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_';
+}
+
+bool IsKey(std::string_view text)
+{
+    for (char c : text) {
+        if (!IsKeyChar(c)) {
+            return false;
+        }
+    }
+    return true;
+}
+
+// exact powers of ten, the divisors of the fast path below
+constexpr double kPow10[] = { 1e0, 1e1, 1e2, 1e3, 1e4, 1e5, 1e6, 1e7, 1e8, 1e9, 1e10, 1e11, 1e12, 1e13, 1e14, 1e15 };
+constexpr size_t kFastDigits = 15;
+
+/*
+ * What the nodes send, "-12.34" with at most 15 digits, is digits / 10^n, both exact in
+ * a double, and one IEEE division rounds that correctly: the same bits from_chars gives,
+ * in a few ns instead of about 25. Anything else (exponent, inf, more digits) goes to
+ * from_chars.
+ */
+bool ParseSimpleDecimal(std::string_view text, double& out)
+{
+    size_t i = text[0] == '-' ? 1 : 0;
+    uint64_t digits = 0;
+    size_t count = 0;
+    size_t point = kNone;
+    for (; i < text.size(); i++) {
+        char c = text[i];
+        if (c >= '0' && c <= '9') {
+            digits = digits * 10 + static_cast<uint64_t>(c - '0');
+            count++;
+        } else if (c == '.' && point == kNone && count > 0) {
+            point = count;
+        } else {
+            return false;
+        }
+    }
+    if (count == 0 || count > kFastDigits || point == count) {
+        return false;
+    }
+    double value = static_cast<double>(digits) / kPow10[point == kNone ? 0 : count - point];
+    out = text[0] == '-' ? -value : value;
+    return true;
+}
+
+bool ParseNumber(std::string_view text, double& out)
+{
+    if (text.empty()) {
+        return false;
+    }
+    if (ParseSimpleDecimal(text, out)) {
+        return true;
+    }
+    auto [end, ec] = std::from_chars(text.data(), text.data() + text.size(), out);
+    return ec == std::errc() && end == text.data() + text.size();
+}
+
+std::string_view TrimEnd(std::string_view text)
+{
+    while (!text.empty() && (text.back() == '\n' || text.back() == '\r' || text.back() == ' ' || text.back() == '\0')) {
+        text.remove_suffix(1);
+    }
+    return text;
+}
+
+bool ParseProbe(std::string_view text, Record& out)
+{
+    DelimiterScan scan(text);
+    scan.NextComma();   // the one of the prefix
+    size_t start = kProbePrefix.size();
+    for (const std::string_view& name : kProbeFields) {
+        size_t comma = scan.NextComma();
+        size_t end = comma == kNone ? text.size() : comma;
+        std::string_view value = text.substr(start, end - start);
+        Field& f = out.fields[out.num_fields];
+        if (!ParseNumber(value, f.value)) {
+            return false;
+        }
+        f.key = name;
+        f.text = value;
+        out.num_fields++;
+        start = comma == kNone ? text.size() : comma + 1;
+    }
+    if (start < text.size()) {
+        return false;
+    }
+    out.kind = RecordKind::kProbe;
+    return true;
+}
+
+bool ParseSample(std::string_view text, Record& out)
+{
+    DelimiterScan scan(text);
+    size_t at = scan.Next();
+    for (size_t start = 0; start < text.size();) {
+        // "key=value" up to the next comma, a value may hold more '='
+        if (at == kNone || text[at] == ',' || at == start) {
+            return false;
+        }
+        size_t eq = at;
+        size_t comma = scan.NextComma();
+        size_t end = comma == kNone ? text.size() : comma;
+        std::string_view key = text.substr(start, eq - start);
+        std::string_view value = text.substr(eq + 1, end - eq - 1);
+        start = end + 1;
+        at = comma == kNone ? kNone : scan.Next();
+
+        if (!IsKey(key)) {
+            return false;
+        }
+        if (key == "id") {
+            if (value.empty() || value.size() >= kNodeIdMax || !IsKey(value)) {
+                return false;
+            }
+            out.node_id = value;
+        } else if (key == "seq") {
+            uint32_t seq = 0;
+            auto [end_seq, ec] = std::from_chars(value.data(), value.data() + value.size(), seq);
+            if (ec != std::errc() || end_seq != value.data() + value.size()) {
+                return false;
+            }
+            out.seq = seq;
+            out.has_seq = true;
+        } else {
+            double number;
+            if (!ParseNumber(value, number)) {
+                continue;   // text values of future keys are skipped, not an error
+            }
+            if (out.num_fields == kMaxFields) {
+                return false;
+            }
+            out.fields[out.num_fields++] = Field{key, value, number};
+        }
+    }
+    if (out.node_id.empty() || out.num_fields == 0) {
+        return false;
+    }
+    out.kind = RecordKind::kSample;
+    return true;
+}
+
+}  // namespace
+
+const Field* Record::Find(std::string_view key) const
+{
+    for (uint32_t i = 0; i < num_fields; i++) {
+        if (fields[i].key == key) {
+            return &fields[i];
+        }
+    }
+    return nullptr;
+}
+
+bool ParseDatagram(std::string_view text, Record& out)
+{
+    out.kind = RecordKind::kInvalid;
+    out.node_id = {};
+    out.has_seq = false;
+    out.seq = 0;
+    out.num_fields = 0;
+    text = TrimEnd(text);
+    bool ok = text.substr(0, kProbePrefix.size()) == kProbePrefix ? ParseProbe(text, out) : ParseSample(text, out);
+    if (!ok) {
+        out.kind = RecordKind::kInvalid;
+    }
+    return ok;
+}
+
+uint32_t ParseDatagrams(uint32_t count, const std::string_view* texts, Record* const* out)
+{
+    uint32_t valid = 0;
+    for (uint32_t i = 0; i < count; i++) {
+        // the next datagram and record are in other cache lines, usually other slots
+        if (i + 1 < count) {
+            __builtin_prefetch(texts[i + 1].data());
+            __builtin_prefetch(out[i + 1]);
+        }
+        valid += ParseDatagram(texts[i], *out[i]);
+    }
+    return valid;
+}
+
+}  // namespace gateway
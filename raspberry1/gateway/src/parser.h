@@ -0,0 +1,52 @@
+/*
+ * Datagram formats the nodes send.
+ *
+ *   sample  "temp=23.45,hum=56.78,id=AB[,seq=N]"    key order free, unknown keys kept
+ *   probe   "#PROBE,sent,received,..."              esp_link_probe statistics, no node id
+ *
+ * A record only holds views into the datagram, nothing is copied or allocated. It is
+ * valid as long as the datagram buffer is. The ',' and '=' are found 16 bytes at a time
+ * with SSE2 or NEON where the target has it; plain decimals are converted directly,
+ * anything else by std::from_chars, both to the same bits.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+
+namespace gateway {
+
+constexpr size_t kMaxFields = 16;
+constexpr size_t kNodeIdMax = 16;
+
+enum class RecordKind : uint8_t { kInvalid, kSample, kProbe };
+
+struct Field {
+    std::string_view key;
+    std::string_view text;      // value as sent, published unchanged
+    double value;
+};
+
+struct Record {
+    RecordKind kind = RecordKind::kInvalid;
+    std::string_view node_id;   // empty for probes, the sender's address identifies the node
+    bool has_seq = false;
+    uint32_t seq = 0;
+    uint32_t num_fields = 0;
+    Field fields[kMaxFields];
+
+    const Field* Find(std::string_view key) const;
+};
+
+// false for text that is none of the formats, out.kind is kInvalid then
+bool ParseDatagram(std::string_view text, Record& out);
+// ParseDatagram() of texts[i] into *out[i] for a batch, returns how many were valid
+uint32_t ParseDatagrams(uint32_t count, const std::string_view* texts, Record* const* out);
+
+// names of the #PROBE fields in order, see link_probe_format()
+extern const std::string_view kProbeFields[14];
+
+}  // namespace gateway
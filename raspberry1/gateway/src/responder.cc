@@ -0,0 +1,63 @@
+/*
+ * Discovery answers and probe reflection.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "responder.h"
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstring>
+
+namespace gateway {
+
+namespace {
+
+constexpr char kQuery[] = "GWDISC? ";
+constexpr size_t kQueryLen = sizeof(kQuery) - 1;
+constexpr size_t kNonceLen = 8;
+// one wakeup handles at most this many, a flood must not starve the sensor socket
+constexpr int kMaxPerCall = 64;
+
+}  // namespace
+
+uint32_t AnswerDiscovery(int fd)
+{
+    uint32_t answered = 0;
+    for (int i = 0; i < kMaxPerCall; i++) {
+        char buf[32];
+        sockaddr_in from;
+        socklen_t len = sizeof(from);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &len);
+        if (n < 0) {
+            break;
+        }
+        if (static_cast<size_t>(n) != kQueryLen + kNonceLen || std::memcmp(buf, kQuery, kQueryLen) != 0) {
+            continue;
+        }
+        buf[6] = '!';   // "GWDISC! <nonce>"
+        sendto(fd, buf, n, MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), len);
+        answered++;
+    }
+    return answered;
+}
+
+uint32_t ReflectProbes(int fd)
+{
+    uint32_t reflected = 0;
+    for (int i = 0; i < kMaxPerCall; i++) {
+        char buf[64];
+        sockaddr_in from;
+        socklen_t len = sizeof(from);
+        ssize_t n = recvfrom(fd, buf, sizeof(buf), MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), &len);
+        if (n < 0) {
+            break;
+        }
+        sendto(fd, buf, n, MSG_DONTWAIT, reinterpret_cast<sockaddr*>(&from), len);
+        reflected++;
+    }
+    return reflected;
+}
+
+}  // namespace gateway
@@ -0,0 +1,19 @@
+/*
+ * Answers for the node side helpers: esp_gw_discovery queries and esp_link_probe
+ * probes, the same as tools/gw_discovery.py and tools/link_probe.py.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstdint>
+
+namespace gateway {
+
+// answers every pending "GWDISC? <nonce>" on fd, returns the number answered
+uint32_t AnswerDiscovery(int fd);
+
+// sends every pending datagram on fd back unchanged, returns the number reflected
+uint32_t ReflectProbes(int fd);
+
+}  // namespace gateway
@@ -0,0 +1,131 @@
+/*
+ * Steering of sensor datagrams across an SO_REUSEPORT group by node id.
+ *
+ * Classic BPF has no loops, so the program is unrolled: one block per offset the id
+ * may start at, then one per hashed byte. For a reuseport group the kernel runs it with
+ * the UDP header pulled, offset 0 is the first byte of the payload and the length is
+ * the payload's. A load past the end would end the program with 0, socket 0 for every
+ * short datagram, so every load is checked against the length first. A result not
+ * below the number of sockets makes the kernel fall back to its own hash.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "reuseport_bpf.h"
+
+#include <sys/socket.h>
+
+namespace gateway {
+
+namespace {
+
+constexpr uint32_t kKernelHash = 0xffffffff;
+constexpr uint32_t kHashMul = 31;
+
+// scratch memory words
+constexpr uint32_t kMemHash = 0;
+constexpr uint32_t kMemLeft = 1;
+constexpr uint32_t kMemStart = 2;
+
+sock_filter Stmt(uint16_t code, uint32_t k)
+{
+    return sock_filter{code, 0, 0, k};
+}
+
+sock_filter Jump(uint16_t code, uint32_t k, size_t jt, size_t jf)
+{
+    return sock_filter{code, static_cast<uint8_t>(jt), static_cast<uint8_t>(jf), k};
+}
+
+}  // namespace
+
+std::vector<sock_filter> NodeSteeringProgram(uint32_t sockets)
+{
+    std::vector<sock_filter> p;
+    std::vector<size_t> to_kernel;      // BPF_JA to the kernel hash return, patched at the end
+    std::vector<size_t> to_hash;
+
+    // "id=" at offset i, at the start or after a comma, leaves the id's offset in X
+    for (uint32_t i = 0; i < kSteerScan; i++) {
+        size_t next = p.size() + (i == 0 ? 9 : 11);
+        auto skip_to = [&](size_t target) { return target - p.size() - 1; };
+        p.push_back(Stmt(BPF_LD | BPF_W | BPF_LEN, 0));
+        p.push_back(Jump(BPF_JMP | BPF_JGE | BPF_K, i + 3, 1, 0));
+        to_kernel.push_back(p.size());
+        p.push_back(Stmt(BPF_JMP | BPF_JA, 0));
+        p.push_back(Stmt(BPF_LD | BPF_H | BPF_ABS, i));
+        p.push_back(Jump(BPF_JMP | BPF_JEQ | BPF_K, 'i' << 8 | 'd', 0, skip_to(next)));
+        p.push_back(Stmt(BPF_LD | BPF_B | BPF_ABS, i + 2));
+        p.push_back(Jump(BPF_JMP | BPF_JEQ | BPF_K, '=', 0, skip_to(next)));
+        if (i > 0) {
+            p.push_back(Stmt(BPF_LD | BPF_B | BPF_ABS, i - 1));
+            p.push_back(Jump(BPF_JMP | BPF_JEQ | BPF_K, ',', 0, skip_to(next)));
+        }
+        p.push_back(Stmt(BPF_LDX | BPF_W | BPF_IMM, i + 3));
+        to_hash.push_back(p.size());
+        p.push_back(Stmt(BPF_JMP | BPF_JA, 0));
+    }
+    to_kernel.push_back(p.size());
+    p.push_back(Stmt(BPF_JMP | BPF_JA, 0));
+
+    // hash = hash * 31 + byte up to the next comma, the end or kSteerIdMax bytes; X
+    // indexes the loads, so it is saved while it carries the byte into the sum
+    size_t hash = p.size();
+    size_t done = hash + 6 + kSteerIdMax * 10;
+    auto skip_to = [&](size_t target) { return target - p.size() - 1; };
+    p.push_back(Stmt(BPF_STX, kMemStart));
+    p.push_back(Stmt(BPF_LD | BPF_W | BPF_LEN, 0));
+    p.push_back(Stmt(BPF_ALU | BPF_SUB | BPF_X, 0));
+    p.push_back(Stmt(BPF_ST, kMemLeft));
+    p.push_back(Stmt(BPF_LD | BPF_IMM, 0));
+    p.push_back(Stmt(BPF_ST, kMemHash));
+    for (uint32_t k = 0; k < kSteerIdMax; k++) {
+        p.push_back(Stmt(BPF_LD | BPF_MEM, kMemLeft));
+        p.push_back(Jump(BPF_JMP | BPF_JGT | BPF_K, k, 0, skip_to(done)));
+        p.push_back(Stmt(BPF_LD | BPF_B | BPF_IND, k));
+        p.push_back(Jump(BPF_JMP | BPF_JEQ | BPF_K, ',', skip_to(done), 0));
+        p.push_back(Stmt(BPF_MISC | BPF_TAX, 0));
+        p.push_back(Stmt(BPF_LD | BPF_MEM, kMemHash));
+        p.push_back(Stmt(BPF_ALU | BPF_MUL | BPF_K, kHashMul));
+        p.push_back(Stmt(BPF_ALU | BPF_ADD | BPF_X, 0));
+        p.push_back(Stmt(BPF_ST, kMemHash));
+        p.push_back(Stmt(BPF_LDX | BPF_MEM, kMemStart));
+    }
+    p.push_back(Stmt(BPF_LD | BPF_MEM, kMemHash));
+    p.push_back(Stmt(BPF_ALU | BPF_MOD | BPF_K, sockets));
+    p.push_back(Stmt(BPF_RET | BPF_A, 0));
+    size_t kernel = p.size();
+    p.push_back(Stmt(BPF_RET | BPF_K, kKernelHash));
+
+    for (size_t at : to_kernel) {
+        p[at].k = static_cast<uint32_t>(kernel - at - 1);
+    }
+    for (size_t at : to_hash) {
+        p[at].k = static_cast<uint32_t>(hash - at - 1);
+    }
+    return p;
+}
+
+int NodeSteeringIndex(std::string_view datagram, uint32_t sockets)
+{
+    const std::string_view& d = datagram;
+    for (size_t i = 0; i < kSteerScan && i + 3 <= d.size(); i++) {
+        if (d[i] != 'i' || d[i + 1] != 'd' || d[i + 2] != '=' || (i > 0 && d[i - 1] != ',')) {
+            continue;
+        }
+        uint32_t hash = 0;
+        for (size_t k = i + 3; k < d.size() && k < i + 3 + kSteerIdMax && d[k] != ','; k++) {
+            hash = hash * kHashMul + static_cast<uint8_t>(d[k]);
+        }
+        return static_cast<int>(hash % sockets);
+    }
+    return -1;
+}
+
+bool AttachNodeSteering(int fd, uint32_t sockets)
+{
+    std::vector<sock_filter> program = NodeSteeringProgram(sockets);
+    sock_fprog fprog = {static_cast<unsigned short>(program.size()), program.data()};
+    return setsockopt(fd, SOL_SOCKET, SO_ATTACH_REUSEPORT_CBPF, &fprog, sizeof(fprog)) == 0;
+}
+
+}  // namespace gateway
@@ -0,0 +1,38 @@
+/*
+ * Steering of sensor datagrams across an SO_REUSEPORT group by node id.
+ *
+ * The kernel spreads the datagrams of a reuseport group over its sockets by a hash of
+ * the source address and port, so a node that comes back from a reboot on a new port
+ * may land on another receive worker than before, and its datagrams in flight could be
+ * handled out of order. The classic BPF program here (SO_ATTACH_REUSEPORT_CBPF, no
+ * privileges needed) finds the "id=" key in the payload and picks socket
+ * hash(id) % sockets instead, so every node stays with one worker whatever port it
+ * sends from. Datagrams without an id in the first kSteerScan bytes, "#PROBE" lines
+ * among them, are left to the kernel's hash.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <linux/filter.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <string_view>
+#include <vector>
+
+namespace gateway {
+
+constexpr size_t kSteerScan = 128;      // "id=" has to start within these bytes
+constexpr size_t kSteerIdMax = 16;      // bytes of the id that are hashed
+
+// the program for a group of `sockets` sockets, socket i is the i-th bound to the port
+std::vector<sock_filter> NodeSteeringProgram(uint32_t sockets);
+
+// the socket the program picks for a datagram, -1 where it leaves it to the kernel
+int NodeSteeringIndex(std::string_view datagram, uint32_t sockets);
+
+// attaches the program to the group fd belongs to, false with errno set
+bool AttachNodeSteering(int fd, uint32_t sockets);
+
+}  // namespace gateway
@@ -0,0 +1,341 @@
+/*
+ * Sensor datagrams received and parsed on several cores.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "rx_workers.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <cerrno>
+#include <cstdio>
+#include <cstring>
+#include <future>
+#include <thread>
+
+#include "log.h"
+#include "reuseport_bpf.h"
+#include "udp_socket.h"
+
+namespace gateway {
+
+namespace {
+
+// how often a waiting worker looks at the stop flag
+constexpr int kStopCheckMs = 100;
+// a worker waiting for ring space yields this often, then sleeps between looks
+constexpr uint32_t kStallYields = 64;
+constexpr useconds_t kStallSleepUs = 1000;
+
+// the CPUs the process may run on, in order
+std::vector<int> AllowedCpus()
+{
+    std::vector<int> cpus;
+    cpu_set_t set;
+    if (sched_getaffinity(0, sizeof(set), &set) == 0) {
+        for (int cpu = 0; cpu < CPU_SETSIZE; cpu++) {
+            if (CPU_ISSET(cpu, &set)) {
+                cpus.push_back(cpu);
+            }
+        }
+    }
+    return cpus;
+}
+
+}  // namespace
+
+class RxWorkers::Worker : private IoHandler {
+public:
+    Worker(RxWorkers& owner, uint32_t index, int fd, int cpu, SpscRing<RxItem>& ring)
+        : owner_(owner), index_(index), fd_(fd), cpu_(cpu), ring_(ring)
+    {
+    }
+
+    // returns once the worker's backend is up, false with a message in *error
+    bool Start(std::string* error)
+    {
+        std::future<std::string> started = started_.get_future();
+        thread_ = std::thread([this] { Main(); });
+        std::string message = started.get();
+        if (!message.empty()) {
+            thread_.join();
+            if (error) {
+                *error = message;
+            }
+            return false;
+        }
+        return true;
+    }
+
+    void Join()
+    {
+        if (thread_.joinable()) {
+            thread_.join();
+        }
+    }
+
+    const RxWorkerStats& stats() const { return stats_; }
+    int cpu() const { return cpu_; }
+    const char* backend() const { return backend_; }
+
+private:
+    void Main()
+    {
+        char name[16];
+        std::snprintf(name, sizeof(name), "gw-rx%u", index_);
+        pthread_setname_np(pthread_self(), name);
+        if (cpu_ >= 0) {
+            cpu_set_t set;
+            CPU_ZERO(&set);
+            CPU_SET(cpu_, &set);
+            if (pthread_setaffinity_np(pthread_self(), sizeof(set), &set) != 0) {
+                GW_LOGW("rx worker %u: cannot pin to cpu %d", index_, cpu_);
+                cpu_ = -1;
+            }
+        }
+        // created here, an io_uring instance belongs to the thread that set it up
+        std::string error;
+        io_ = IoBackend::Create(owner_.options_.io, &error);
+        if (io_ && !io_->AddDatagramSocket(fd_, owner_.options_.batch)) {
+            error = std::string(io_->name()) + " sensor socket: " + strerror(errno);
+        }
+        if (!error.empty()) {
+            started_.set_value("rx worker " + std::to_string(index_) + ": " + error);
+            return;
+        }
+        backend_ = io_->name();
+        started_.set_value(std::string());
+
+        const uint32_t busy_poll_us = owner_.options_.busy_poll_us;
+        int64_t spin_until_us = 0;
+        while (!owner_.stop_.load(std::memory_order_relaxed)) {
+            bool spin = spin_until_us && MonotonicUs() < spin_until_us;
+            uint64_t before = io_->stats().datagrams;
+            io_->Wait(spin ? 0 : kStopCheckMs, *this);
+            const IoStats& io = io_->stats();
+            if (busy_poll_us && io.datagrams != before) {
+                spin_until_us = MonotonicUs() + busy_poll_us;
+            }
+            stats_.syscalls.store(io.syscalls, std::memory_order_relaxed);
+            stats_.truncated.store(io.truncated, std::memory_order_relaxed);
+        }
+        io_->Remove(fd_);
+    }
+
+    void OnDatagrams(int, const PacketBatch& batch) override
+    {
+        int64_t now_ns = MonotonicNs();
+        int64_t now = now_ns / 1000000;
+        uint32_t free = ring_.Free();
+        uint32_t filled = 0;
+        bool stalled = false;
+        for (uint32_t i = 0; i < batch.count; i++) {
+            if (filled == free) {
+                Publish(filled);
+                owner_.Wake();
+                filled = 0;
+                uint32_t waits = 0;
+                while ((free = ring_.Free()) == 0) {
+                    if (owner_.options_.drop_when_full || owner_.stop_.load(std::memory_order_relaxed)) {
+                        stats_.dropped.fetch_add(batch.count - i, std::memory_order_relaxed);
+                        stats_.datagrams.fetch_add(batch.count, std::memory_order_relaxed);
+                        stats_.batches.fetch_add(1, std::memory_order_relaxed);
+                        return;
+                    }
+                    // the publisher is behind, the socket buffer holds what comes meanwhile;
+                    // it may be held for as long as the broker is away
+                    stalled = true;
+                    if (++waits < kStallYields) {
+                        sched_yield();
+                    } else {
+                        usleep(kStallSleepUs);
+                    }
+                }
+            }
+            const PacketSlot& packet = *batch.slots[i];
+            RxItem& item = ring_.Producing(filled++);
+            std::string_view text = packet.text();
+            std::memcpy(item.text, text.data(), text.size());
+            item.len = static_cast<uint32_t>(text.size());
+            item.now_ms = now;
+            item.rx_ns = now_ns;
+            item.from = packet.from;
+            item.worker = index_;
+        }
+        Publish(filled);
+        owner_.Wake();
+        stats_.datagrams.fetch_add(batch.count, std::memory_order_relaxed);
+        stats_.batches.fetch_add(1, std::memory_order_relaxed);
+        if (stalled) {
+            stats_.stalls.fetch_add(1, std::memory_order_relaxed);
+        }
+    }
+
+    // parses the first `filled` slots in place and hands them over
+    void Publish(uint32_t filled)
+    {
+        constexpr uint32_t kChunk = 16;
+        std::string_view texts[kChunk];
+        Record* out[kChunk];
+        for (uint32_t first = 0; first < filled; first += kChunk) {
+            uint32_t n = std::min(kChunk, filled - first);
+            for (uint32_t i = 0; i < n; i++) {
+                RxItem& item = ring_.Producing(first + i);
+                texts[i] = item.Text();
+                out[i] = &item.record;
+            }
+            int64_t parse_start = MonotonicNs();
+            ParseDatagrams(n, texts, out);
+            stats_.parse_ns.Record(static_cast<uint64_t>(MonotonicNs() - parse_start) / n, n);
+            if (NodeStatsTable* stats = owner_.options_.node_stats) {
+                for (uint32_t i = 0; i < n; i++) {
+                    stats->Update(*out[i], ring_.Producing(first + i).now_ms);
+                }
+            }
+        }
+        ring_.Publish(filled);
+    }
+
+    // only the sensor socket is registered
+    void OnReadable(int) override {}
+    void OnConnected(int, int) override {}
+    void OnSent(int, int) override {}
+
+    RxWorkers& owner_;
+    uint32_t index_;
+    int fd_;
+    int cpu_;
+    SpscRing<RxItem>& ring_;
+    std::unique_ptr<IoBackend> io_;
+    const char* backend_ = "";
+    std::promise<std::string> started_;
+    std::thread thread_;
+    RxWorkerStats stats_;
+};
+
+RxWorkers::RxWorkers(const RxOptions& options) : options_(options), port_(options.port) {}
+
+RxWorkers::~RxWorkers()
+{
+    Stop();
+    workers_.clear();
+    for (int fd : fds_) {
+        close(fd);
+    }
+    if (wake_fd_ >= 0) {
+        close(wake_fd_);
+    }
+}
+
+bool RxWorkers::Open(std::string* error)
+{
+    auto fail = [&](const std::string& what) {
+        if (error) {
+            *error = what + ": " + strerror(errno);
+        }
+        return false;
+    };
+    wake_fd_ = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (wake_fd_ < 0) {
+        return fail("eventfd");
+    }
+    // socket i of the group is the i-th bound, the steering program counts on that
+    for (uint32_t i = 0; i < options_.workers; i++) {
+        int fd = OpenUdp(options_.listen, port_, options_.rcvbuf_bytes, true);
+        if (fd < 0) {
+            return fail("udp " + options_.listen + ":" + std::to_string(port_) + " (SO_REUSEPORT)");
+        }
+        fds_.push_back(fd);
+        if (port_ == 0) {
+            sockaddr_in addr = {};
+            socklen_t len = sizeof(addr);
+            getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len);
+            port_ = ntohs(addr.sin_port);
+        }
+        if (options_.busy_poll_us && !SetBusyPoll(fd, options_.busy_poll_us) && i == 0) {
+            GW_LOGW("SO_BUSY_POLL refused (%s), spinning in user space only", strerror(errno));
+        }
+    }
+    if (options_.steer_by_node && !AttachNodeSteering(fds_[0], options_.workers)) {
+        return fail("SO_ATTACH_REUSEPORT_CBPF");
+    }
+
+    std::vector<int> cpus = options_.pin ? AllowedCpus() : std::vector<int>();
+    for (uint32_t i = 0; i < options_.workers; i++) {
+        int cpu = cpus.empty() ? -1 : cpus[i % cpus.size()];
+        rings_.push_back(std::make_unique<SpscRing<RxItem>>(options_.ring_size));
+        workers_.push_back(std::make_unique<Worker>(*this, i, fds_[i], cpu, *rings_.back()));
+        if (!workers_.back()->Start(error)) {
+            workers_.pop_back();
+            rings_.pop_back();
+            Stop();
+            return false;
+        }
+    }
+    GW_LOGI("%u rx workers on %s:%u, %s steering, %s", options_.workers, options_.listen.c_str(), port_,
+            options_.steer_by_node ? "node id" : "address hash",
+            cpus.empty() ? "not pinned" : cpus.size() < options_.workers ? "pinned, sharing cores" : "pinned");
+    return true;
+}
+
+void RxWorkers::Stop()
+{
+    stop_.store(true, std::memory_order_relaxed);
+    for (auto& worker : workers_) {
+        worker->Join();
+    }
+}
+
+void RxWorkers::Wake()
+{
+    // pairs with the fence in Sleep(): either the publisher sees the new items before it
+    // sleeps or the worker sees it sleeping and rings
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (sleeping_.load(std::memory_order_relaxed) && sleeping_.exchange(false)) {
+        uint64_t one = 1;
+        // only fails when the counter is full, and then it is readable anyway
+        ssize_t n = write(wake_fd_, &one, sizeof(one));
+        (void)n;
+    }
+}
+
+bool RxWorkers::Sleep()
+{
+    sleeping_.store(true, std::memory_order_relaxed);
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    for (auto& ring : rings_) {
+        if (ring->Available() > 0) {
+            sleeping_.store(false, std::memory_order_relaxed);
+            return false;
+        }
+    }
+    return true;
+}
+
+void RxWorkers::ClearWake()
+{
+    uint64_t count;
+    ssize_t n = read(wake_fd_, &count, sizeof(count));
+    (void)n;
+}
+
+const RxWorkerStats& RxWorkers::stats(uint32_t worker) const
+{
+    return workers_[worker]->stats();
+}
+
+int RxWorkers::cpu(uint32_t worker) const
+{
+    return workers_[worker]->cpu();
+}
+
+const char* RxWorkers::backend(uint32_t worker) const
+{
+    return workers_[worker]->backend();
+}
+
+}  // namespace gateway
@@ -0,0 +1,151 @@
+/*
+ * Sensor datagrams received and parsed on several cores.
+ *
+ * Every worker thread has its own SO_REUSEPORT socket on the sensor port, its own I/O
+ * backend and, when asked, its own core. It receives a batch, copies every datagram
+ * into the next slot of its ring to the publisher, parses it there and publishes the
+ * batch with one store. The ring is the only thing between a worker and the publisher,
+ * which walks the rings in its own event loop, one after the other, and owns the node
+ * table and the MQTT client as before. Besides, the workers count every sample in the
+ * NodeStatsTable, which takes concurrent writers.
+ *
+ * A node's datagrams keep their order as long as they all reach the same socket: the
+ * kernel's hash of the source address and port does that while the node keeps its
+ * port, steer_by_node (reuseport_bpf.h) whatever port it sends from.
+ *
+ * A worker that finds its ring full waits for room, so the socket buffer and then the
+ * kernel's drops take the load, or with drop_when_full drops the rest of its batch.
+ *
+ * The publisher sleeps in its backend; a worker that publishes while it sleeps rings
+ * an eventfd the publisher's backend watches, otherwise no syscall is made.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <netinet/in.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <string_view>
+#include <vector>
+
+#include "io_backend.h"
+#include "metrics.h"
+#include "node_stats.h"
+#include "parser.h"
+#include "spsc_ring.h"
+#include "udp_ingest.h"
+
+namespace gateway {
+
+// one datagram in a ring, parsed in place; never copied, the record points into text
+struct RxItem {
+    int64_t now_ms;
+    int64_t rx_ns;              // MonotonicNs() of the receive, now_ms in ns
+    sockaddr_in from;
+    uint32_t len;
+    uint32_t worker;
+    Record record;              // kind kInvalid when the datagram did not parse
+    char text[PacketSlot::kData];
+
+    std::string_view Text() const { return std::string_view(text, len); }
+};
+
+// written by the worker, read anywhere
+struct RxWorkerStats {
+    std::atomic<uint64_t> datagrams{0};
+    std::atomic<uint64_t> batches{0};
+    std::atomic<uint64_t> syscalls{0};  // of its I/O backend, waits included
+    std::atomic<uint64_t> truncated{0};
+    std::atomic<uint64_t> stalls{0};    // batches that found the ring full and waited
+    std::atomic<uint64_t> dropped{0};   // found the ring full with drop_when_full, or when stopped
+    Histogram parse_ns;                 // per datagram, a chunk's time over its datagrams
+};
+
+struct RxOptions {
+    std::string listen = "0.0.0.0";
+    uint16_t port = 8080;               // 0 for a free one, see port()
+    uint32_t workers = 1;
+    uint32_t batch = 64;
+    int rcvbuf_bytes = 0;
+    uint32_t busy_poll_us = 0;
+    bool pin = true;                    // worker i on the i-th CPU the process may use
+    bool steer_by_node = false;
+    IoBackend::Kind io = IoBackend::Kind::kAuto;
+    uint32_t ring_size = 1024;          // datagrams between a worker and the publisher
+    bool drop_when_full = false;        // drop what finds the ring full instead of waiting for room
+    NodeStatsTable* node_stats = nullptr;   // updated by the workers with every sample
+};
+
+class RxWorkers {
+public:
+    explicit RxWorkers(const RxOptions& options);
+    // stops the workers and closes the sockets
+    ~RxWorkers();
+
+    RxWorkers(const RxWorkers&) = delete;
+    RxWorkers& operator=(const RxWorkers&) = delete;
+
+    // binds the sockets and starts the workers, false with a message in *error
+    bool Open(std::string* error);
+    // Joins the workers. What they handed over stays in the rings for Drain().
+    void Stop();
+
+    // publisher side, all from one thread
+
+    // Calls handle(const RxItem&) for up to `budget` items of each worker, in the
+    // order the worker received them, and returns how many there were.
+    template <typename Handle>
+    uint32_t Drain(uint32_t budget, Handle&& handle)
+    {
+        uint32_t total = 0;
+        for (auto& ring : rings_) {
+            uint32_t n = std::min(ring->Available(), budget);
+            for (uint32_t i = 0; i < n; i++) {
+                handle(ring->Consuming(i));
+            }
+            ring->Release(n);
+            total += n;
+        }
+        return total;
+    }
+
+    // Before the publisher waits: false when items are pending and it must not sleep,
+    // true when the next worker to publish rings wake_fd().
+    bool Sleep();
+    // after the wait, whatever woke it
+    void Awake() { sleeping_.store(false, std::memory_order_relaxed); }
+    // readable when a worker rang, ClearWake() when it was
+    int wake_fd() const { return wake_fd_; }
+    void ClearWake();
+
+    uint16_t port() const { return port_; }
+    uint32_t size() const { return static_cast<uint32_t>(workers_.size()); }
+    const RxWorkerStats& stats(uint32_t worker) const;
+    int cpu(uint32_t worker) const;         // -1 when not pinned
+    const char* backend(uint32_t worker) const;
+    uint32_t depth(uint32_t worker) const { return rings_[worker]->Depth(); }
+    uint32_t ring_capacity(uint32_t worker) const { return rings_[worker]->capacity(); }
+    // the worker's socket, for its receive backlog
+    int fd(uint32_t worker) const { return fds_[worker]; }
+
+private:
+    class Worker;
+
+    void Wake();
+
+    RxOptions options_;
+    uint16_t port_;
+    int wake_fd_ = -1;
+    std::vector<int> fds_;
+    std::vector<std::unique_ptr<SpscRing<RxItem>>> rings_;
+    std::vector<std::unique_ptr<Worker>> workers_;
+    std::atomic<bool> stop_{false};
+    alignas(kCacheLine) std::atomic<bool> sleeping_{false};
+};
+
+}  // namespace gateway
@@ -0,0 +1,615 @@
+/*
+ * On-disk spool of undelivered messages.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "spool.h"
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstddef>
+#include <cinttypes>
+#include <cstdio>
+#include <cstdlib>
+#include <cstring>
+#include <unordered_map>
+
+#include "log.h"
+
+namespace gateway {
+
+namespace {
+
+// segment header: magic, version, flags
+constexpr char kMagic[8] = {'G', 'W', 'S', 'P', 'O', 'O', 'L', '1'};
+constexpr uint32_t kVersion = 1;
+constexpr uint32_t kFlagCompacted = 1;
+constexpr size_t kHeaderBytes = 16;
+// record: CRC-32C of the rest, wall clock ms, topic length, payload length, topic, payload
+constexpr size_t kRecordHeader = 14;
+constexpr size_t kFieldMax = 255;
+constexpr size_t kOutBytes = 64 * 1024;
+constexpr size_t kInBytes = 64 * 1024;
+constexpr uint64_t kPage = 4096;
+
+struct Crc32cTable {
+    uint32_t v[256];
+    constexpr Crc32cTable() : v()
+    {
+        for (uint32_t i = 0; i < 256; i++) {
+            uint32_t c = i;
+            for (int k = 0; k < 8; k++) {
+                c = c & 1 ? (c >> 1) ^ 0x82F63B78u : c >> 1;
+            }
+            v[i] = c;
+        }
+    }
+};
+constexpr Crc32cTable kCrc;
+
+uint32_t Crc32c(const uint8_t* p, size_t n)
+{
+    uint32_t c = ~0u;
+    while (n--) {
+        c = kCrc.v[(c ^ *p++) & 0xFF] ^ (c >> 8);
+    }
+    return ~c;
+}
+
+void PutHeader(uint8_t* p, uint32_t flags)
+{
+    std::memcpy(p, kMagic, sizeof(kMagic));
+    std::memcpy(p + 8, &kVersion, 4);
+    std::memcpy(p + 12, &flags, 4);
+}
+
+// false for a file that is not a segment
+bool GetHeader(const uint8_t* p, size_t len, uint32_t* flags)
+{
+    uint32_t version = 0;
+    if (len < kHeaderBytes || std::memcmp(p, kMagic, sizeof(kMagic)) != 0) {
+        return false;
+    }
+    std::memcpy(&version, p + 8, 4);
+    std::memcpy(flags, p + 12, 4);
+    return version == kVersion;
+}
+
+size_t PutRecord(uint8_t* p, int64_t time_ms, std::string_view topic, std::string_view payload)
+{
+    size_t len = kRecordHeader + topic.size() + payload.size();
+    std::memcpy(p + 4, &time_ms, 8);
+    p[12] = static_cast<uint8_t>(topic.size());
+    p[13] = static_cast<uint8_t>(payload.size());
+    std::memcpy(p + kRecordHeader, topic.data(), topic.size());
+    std::memcpy(p + kRecordHeader + topic.size(), payload.data(), payload.size());
+    uint32_t crc = Crc32c(p + 4, len - 4);
+    std::memcpy(p, &crc, 4);
+    return len;
+}
+
+enum class Check : uint8_t { kOk, kShort, kBad };
+
+Check CheckRecord(const uint8_t* p, size_t avail, size_t* len)
+{
+    if (avail < kRecordHeader) {
+        return Check::kShort;
+    }
+    *len = kRecordHeader + p[12] + p[13];
+    if (avail < *len) {
+        return Check::kShort;
+    }
+    uint32_t crc;
+    std::memcpy(&crc, p, 4);
+    return crc == Crc32c(p + 4, *len - 4) ? Check::kOk : Check::kBad;
+}
+
+SpoolMessage GetRecord(const uint8_t* p)
+{
+    SpoolMessage m;
+    std::memcpy(&m.time_ms, p + 4, 8);
+    const char* text = reinterpret_cast<const char*>(p + kRecordHeader);
+    m.topic = std::string_view(text, p[12]);
+    m.payload = std::string_view(text + p[12], p[13]);
+    return m;
+}
+
+// pages a write of [from, to) puts on the device
+uint64_t PageBytes(uint64_t from, uint64_t to)
+{
+    return to > from ? (to + kPage - 1) / kPage * kPage - from / kPage * kPage : 0;
+}
+
+bool ReadFile(const std::string& path, std::vector<uint8_t>& data)
+{
+    int fd = open(path.c_str(), O_RDONLY | O_CLOEXEC);
+    struct stat st;
+    if (fd < 0 || fstat(fd, &st) != 0) {
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    data.resize(static_cast<size_t>(st.st_size));
+    size_t done = 0;
+    while (done < data.size()) {
+        ssize_t n = pread(fd, data.data() + done, data.size() - done, static_cast<off_t>(done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            break;
+        }
+        done += static_cast<size_t>(n);
+    }
+    close(fd);
+    data.resize(done);
+    return true;
+}
+
+bool WriteAll(int fd, const uint8_t* p, size_t len, uint64_t offset)
+{
+    size_t done = 0;
+    while (done < len) {
+        ssize_t n = pwrite(fd, p + done, len - done, static_cast<off_t>(offset + done));
+        if (n < 0 && errno == EINTR) {
+            continue;
+        }
+        if (n <= 0) {
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+    return true;
+}
+
+void SyncDir(const std::string& dir)
+{
+    int fd = open(dir.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if (fd >= 0) {
+        fsync(fd);
+        close(fd);
+    }
+}
+
+}  // namespace
+
+Spool::Spool(const SpoolOptions& options) : options_(options), out_(kOutBytes), in_(kInBytes)
+{
+}
+
+Spool::~Spool()
+{
+    Close();
+}
+
+std::string Spool::Path(uint64_t number) const
+{
+    char name[32];
+    std::snprintf(name, sizeof(name), "/spool-%016" PRIx64 ".log", number);
+    return options_.dir + name;
+}
+
+bool Spool::Fail(const char* what)
+{
+    if (!failed_) {
+        GW_LOGE("spool %s: %s failed: %s, messages are no longer spooled", options_.dir.c_str(), what,
+                strerror(errno));
+    }
+    failed_ = true;
+    return false;
+}
+
+bool Spool::Open(std::string* error)
+{
+    if (mkdir(options_.dir.c_str(), 0750) != 0 && errno != EEXIST) {
+        if (error) {
+            *error = "spool " + options_.dir + ": " + strerror(errno);
+        }
+        return false;
+    }
+    DIR* dir = opendir(options_.dir.c_str());
+    if (dir == nullptr) {
+        if (error) {
+            *error = "spool " + options_.dir + ": " + strerror(errno);
+        }
+        return false;
+    }
+    std::vector<uint64_t> numbers;
+    while (dirent* e = readdir(dir)) {
+        const char* name = e->d_name;
+        size_t len = std::strlen(name);
+        if (len < 6 || std::strncmp(name, "spool-", 6) != 0) {
+            continue;
+        }
+        char* end = nullptr;
+        uint64_t number = std::strtoull(name + 6, &end, 16);
+        if (end == name + 22 && std::strcmp(end, ".log") == 0) {
+            numbers.push_back(number);
+        } else if (len > 4 && std::strcmp(name + len - 4, ".tmp") == 0) {
+            // a compaction the process did not finish, the segment is still there
+            unlinkat(dirfd(dir), name, 0);
+        }
+    }
+    closedir(dir);
+    std::sort(numbers.begin(), numbers.end());
+
+    // the position Close() left in the first segment, good for this Open() only
+    uint64_t cursor_number = 0;
+    uint32_t cursor_count = 0;
+    std::string cursor = options_.dir + "/cursor";
+    if (FILE* f = std::fopen(cursor.c_str(), "r")) {
+        if (std::fscanf(f, "%" SCNx64 " %" SCNu32, &cursor_number, &cursor_count) != 2) {
+            cursor_number = 0;
+        }
+        std::fclose(f);
+        unlink(cursor.c_str());
+    }
+
+    for (uint64_t number : numbers) {
+        Segment s = {number, 0, 0};
+        // the cursor counts for the first segment only, Next() starts there
+        if (!Recover(s, segments_.empty() && number == cursor_number ? cursor_count : 0) ||
+            s.committed == s.messages) {
+            unlink(Path(number).c_str());
+            continue;
+        }
+        unread_ += s.messages - s.handed;
+        bytes_ += s.bytes;
+        segments_.push_back(s);
+    }
+    if (segments_.empty() || segments_.front().handed == 0) {
+        ResetReader();
+    }
+    next_number_ = numbers.empty() ? 1 : numbers.back() + 1;
+    open_ = true;
+    if (!segments_.empty()) {
+        GW_LOGI("spool %s: %" PRIu64 " messages in %zu segments from before", options_.dir.c_str(), unread_,
+                segments_.size());
+    }
+    return true;
+}
+
+bool Spool::Recover(Segment& s, uint32_t skip)
+{
+    std::string path = Path(s.number);
+    std::vector<uint8_t> data;
+    uint32_t flags = 0;
+    if (!ReadFile(path, data) || !GetHeader(data.data(), data.size(), &flags)) {
+        GW_LOGW("spool %s: not a segment, deleted", path.c_str());
+        return false;
+    }
+    s.compacted = flags & kFlagCompacted;
+    size_t pos = kHeaderBytes;
+    size_t len = 0;
+    while (CheckRecord(data.data() + pos, data.size() - pos, &len) == Check::kOk) {
+        if (skip > 0 && s.messages == skip) {
+            read_offset_ = pos;     // Next() goes on from here
+        }
+        s.messages++;
+        pos += len;
+    }
+    if (pos < data.size()) {
+        GW_LOGW("spool %s: cut at byte %zu of %zu, the rest was not written whole", path.c_str(), pos, data.size());
+        if (truncate(path.c_str(), static_cast<off_t>(pos)) != 0) {
+            return false;
+        }
+    }
+    s.bytes = pos;
+    s.handed = s.committed = std::min(skip, s.messages);
+    return true;
+}
+
+bool Spool::StartSegment()
+{
+    uint64_t number = next_number_++;
+    write_fd_ = open(Path(number).c_str(), O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC, 0640);
+    if (write_fd_ < 0) {
+        return Fail("creating a segment");
+    }
+    PutHeader(out_.data(), 0);
+    out_len_ = kHeaderBytes;
+    written_ = synced_ = 0;
+    sync_at_ms_ = 0;
+    dir_dirty_ = true;
+    segments_.push_back(Segment{number, kHeaderBytes, 0});
+    bytes_ += kHeaderBytes;
+    return true;
+}
+
+bool Spool::Append(int64_t time_ms, std::string_view topic, std::string_view payload)
+{
+    if (!open_ || failed_ || topic.size() > kFieldMax || payload.size() > kFieldMax) {
+        stats_.failed++;
+        return false;
+    }
+    size_t len = kRecordHeader + topic.size() + payload.size();
+    if (write_fd_ >= 0 && segments_.back().bytes + len > options_.segment_bytes) {
+        Roll();
+    }
+    if ((write_fd_ < 0 && !StartSegment()) || (out_len_ + len > out_.size() && !WriteOut())) {
+        stats_.failed++;
+        return false;
+    }
+    out_len_ += PutRecord(out_.data() + out_len_, time_ms, topic, payload);
+    Segment& s = segments_.back();
+    s.bytes += len;
+    s.messages++;
+    bytes_ += len;
+    unread_++;
+    stats_.appended++;
+    stats_.message_bytes += topic.size() + payload.size();
+    return true;
+}
+
+bool Spool::WriteOut()
+{
+    if (out_len_ == 0) {
+        return true;
+    }
+    if (!WriteAll(write_fd_, out_.data(), out_len_, written_)) {
+        return Fail("write");
+    }
+    stats_.written_bytes += out_len_;
+    written_ += out_len_;
+    out_len_ = 0;
+    return true;
+}
+
+void Spool::Sync()
+{
+    if (write_fd_ >= 0 && synced_ < written_) {
+        if (options_.sync != SpoolSync::kNever && fdatasync(write_fd_) != 0) {
+            Fail("fdatasync");
+        }
+        // with kNever the kernel writes the pages back, counted once when the segment closes
+        stats_.syncs += options_.sync != SpoolSync::kNever;
+        stats_.device_bytes += PageBytes(synced_, written_);
+        synced_ = written_;
+    }
+    if (dir_dirty_ && options_.sync != SpoolSync::kNever) {
+        SyncDir(options_.dir);
+        dir_dirty_ = false;
+    }
+}
+
+void Spool::Flush(int64_t now_ms)
+{
+    if (write_fd_ < 0 || !WriteOut() || options_.sync == SpoolSync::kNever) {
+        return;
+    }
+    if (synced_ == written_ && !dir_dirty_) {
+        return;
+    }
+    // kInterval: nothing waits longer than sync_ms for its sync
+    if (sync_at_ms_ == 0) {
+        sync_at_ms_ = now_ms + (options_.sync == SpoolSync::kAlways ? 0 : options_.sync_ms);
+    }
+    if (now_ms >= sync_at_ms_) {
+        Sync();
+        sync_at_ms_ = 0;
+    }
+}
+
+void Spool::Roll()
+{
+    if (WriteOut()) {
+        Sync();
+    }
+    close(write_fd_);
+    write_fd_ = -1;
+    Trim();
+    Retain();
+}
+
+void Spool::Close()
+{
+    if (!open_) {
+        return;
+    }
+    if (write_fd_ >= 0) {
+        Roll();
+    }
+    if (!segments_.empty() && segments_.front().committed > 0) {
+        std::string cursor = options_.dir + "/cursor";
+        if (FILE* f = std::fopen((cursor + ".tmp").c_str(), "w")) {
+            std::fprintf(f, "%" PRIx64 " %" PRIu32 "\n", segments_.front().number, segments_.front().committed);
+            std::fflush(f);
+            fdatasync(fileno(f));
+            std::fclose(f);
+            std::rename((cursor + ".tmp").c_str(), cursor.c_str());
+            dir_dirty_ = true;
+        }
+    }
+    if (dir_dirty_ && options_.sync != SpoolSync::kNever) {
+        SyncDir(options_.dir);
+    }
+    ResetReader();
+    open_ = false;
+}
+
+void Spool::ResetReader()
+{
+    if (read_fd_ >= 0) {
+        close(read_fd_);
+        read_fd_ = -1;
+    }
+    read_offset_ = kHeaderBytes;
+    in_pos_ = in_len_ = 0;
+}
+
+bool Spool::Next(SpoolMessage* message)
+{
+    while (read_index_ < segments_.size()) {
+        Segment& s = segments_[read_index_];
+        bool writing = write_fd_ >= 0 && read_index_ + 1 == segments_.size();
+        if (s.handed == s.messages) {
+            if (writing) {
+                return false;
+            }
+            read_index_++;
+            ResetReader();
+            continue;
+        }
+        size_t len = 0;
+        Check check = CheckRecord(in_.data() + in_pos_, in_len_ - in_pos_, &len);
+        if (check == Check::kShort) {
+            if (writing && !WriteOut()) {
+                return false;
+            }
+            if (read_fd_ < 0) {
+                read_fd_ = open(Path(s.number).c_str(), O_RDONLY | O_CLOEXEC);
+            }
+            read_offset_ += in_pos_;
+            ssize_t n = read_fd_ < 0 ? -1 : pread(read_fd_, in_.data(), in_.size(), static_cast<off_t>(read_offset_));
+            in_pos_ = 0;
+            in_len_ = n > 0 ? static_cast<size_t>(n) : 0;
+            check = CheckRecord(in_.data(), in_len_, &len);
+        }
+        if (check != Check::kOk) {
+            uint32_t lost = s.messages - s.handed;
+            GW_LOGW("spool %s: bad record at byte %" PRIu64 ", %u messages lost", Path(s.number).c_str(),
+                    read_offset_ + in_pos_, lost);
+            stats_.corrupt += lost;
+            unread_ -= lost;
+            s.messages = s.handed;
+            if (writing) {
+                Roll();     // what comes next goes to a segment of its own
+            }
+            continue;
+        }
+        *message = GetRecord(in_.data() + in_pos_);
+        in_pos_ += len;
+        s.handed++;
+        unread_--;
+        stats_.replayed++;
+        return true;
+    }
+    return false;
+}
+
+void Spool::Commit(uint32_t count)
+{
+    for (size_t i = 0; count > 0 && i < segments_.size(); i++) {
+        Segment& s = segments_[i];
+        uint32_t n = std::min(count, s.handed - s.committed);
+        s.committed += n;
+        count -= n;
+        stats_.committed += n;
+    }
+    Trim();
+}
+
+void Spool::Trim()
+{
+    // not the segment being written, more is committed from it later
+    while (!segments_.empty() && segments_.front().committed == segments_.front().messages &&
+           (segments_.size() > 1 || write_fd_ < 0)) {
+        Remove(0);
+    }
+}
+
+void Spool::Remove(size_t index)
+{
+    const Segment& s = segments_[index];
+    unlink(Path(s.number).c_str());
+    dir_dirty_ = true;
+    unread_ -= s.messages - s.handed;
+    bytes_ -= s.bytes;
+    segments_.erase(segments_.begin() + static_cast<std::ptrdiff_t>(index));
+    if (read_index_ > index) {
+        read_index_--;
+    } else if (read_index_ == index) {
+        ResetReader();      // on the start of the next one, Next() had nothing from it yet
+    }
+}
+
+void Spool::Retain()
+{
+    while (bytes_ > options_.max_bytes) {
+        // what Next() has touched stays, and the segment being written
+        size_t first = 0;
+        while (first < segments_.size() && segments_[first].handed > 0) {
+            first++;
+        }
+        size_t end = segments_.size() - (write_fd_ >= 0 ? 1 : 0);
+        if (first >= end) {
+            break;
+        }
+        size_t i = first;
+        while (options_.compact_ms && i < end && segments_[i].compacted) {
+            i++;
+        }
+        if (options_.compact_ms && i < end && Compact(i)) {
+            continue;
+        }
+        GW_LOGW("spool over %" PRIu64 " MB, segment %" PRIx64 " deleted with %u messages", options_.max_bytes >> 20,
+                segments_[first].number, segments_[first].messages);
+        stats_.evicted += segments_[first].messages;
+        Remove(first);
+    }
+}
+
+bool Spool::Compact(size_t index)
+{
+    Segment& s = segments_[index];
+    std::string path = Path(s.number);
+    std::vector<uint8_t> data;
+    uint32_t flags = 0;
+    if (!ReadFile(path, data) || !GetHeader(data.data(), data.size(), &flags)) {
+        return false;
+    }
+    std::vector<uint8_t> out(kHeaderBytes);
+    PutHeader(out.data(), flags | kFlagCompacted);
+    std::unordered_map<std::string, int64_t> kept;     // by topic, the time of the last message kept
+    uint32_t messages = 0;
+    size_t len = 0;
+    for (size_t pos = kHeaderBytes; CheckRecord(data.data() + pos, data.size() - pos, &len) == Check::kOk;
+         pos += len) {
+        SpoolMessage m = GetRecord(data.data() + pos);
+        auto it = kept.find(std::string(m.topic));
+        if (it != kept.end() && m.time_ms - it->second < options_.compact_ms) {
+            continue;
+        }
+        kept[std::string(m.topic)] = m.time_ms;
+        out.insert(out.end(), data.begin() + static_cast<std::ptrdiff_t>(pos),
+                   data.begin() + static_cast<std::ptrdiff_t>(pos + len));
+        messages++;
+    }
+    // written aside and renamed over, a crash leaves the old segment or the new one
+    std::string tmp = path + ".tmp";
+    int fd = open(tmp.c_str(), O_WRONLY | O_CREAT | O_TRUNC | O_CLOEXEC, 0640);
+    if (fd < 0 || !WriteAll(fd, out.data(), out.size(), 0) || fdatasync(fd) != 0 ||
+        rename(tmp.c_str(), path.c_str()) != 0) {
+        GW_LOGW("spool %s: compaction failed: %s", path.c_str(), strerror(errno));
+        if (fd >= 0) {
+            close(fd);
+        }
+        unlink(tmp.c_str());
+        return false;
+    }
+    close(fd);
+    dir_dirty_ = true;
+    stats_.written_bytes += out.size();
+    stats_.device_bytes += PageBytes(0, out.size());
+    stats_.syncs++;
+    stats_.compacted += s.messages - messages;
+    GW_LOGI("spool over %" PRIu64 " MB, segment %" PRIx64 " compacted from %u to %u messages",
+            options_.max_bytes >> 20, s.number, s.messages, messages);
+    unread_ -= s.messages - messages;
+    bytes_ -= s.bytes - out.size();
+    s.bytes = out.size();
+    s.messages = messages;
+    s.compacted = true;
+    if (read_index_ == index) {
+        ResetReader();
+    }
+    return true;
+}
+
+}  // namespace gateway
@@ -0,0 +1,149 @@
+/*
+ * On-disk spool of the messages the broker cannot take, replayed in order once it can.
+ *
+ * Messages are appended to segment files spool-<number>.log in the spool directory, a
+ * CRC-checked record each, through a buffer written out once per loop round. When the
+ * data is made durable is the sync policy: fdatasync() after every round that wrote
+ * (kAlways), every sync_ms (kInterval), or when the kernel gets to it (kNever). A
+ * segment is synced and closed when full and a new one starts, nothing is ever
+ * rewritten in place.
+ *
+ * Next() hands the messages out oldest first, Commit() is told when the broker has
+ * them, and a segment whose messages are all committed is deleted. Close() keeps the
+ * position in the first segment in a cursor file; after a crash what was handed out
+ * but not committed comes again (at least once, like QoS 1). Open() reads every
+ * segment back and cuts one at its first bad record, the torn end of a write the
+ * power took.
+ *
+ * The directory holds at most max_bytes. Past it the oldest segment not yet touched by
+ * Next() is compacted, rewritten with one message per topic every compact_ms, so a
+ * long outage thins out instead of being cut off; once everything is compacted the
+ * oldest segments are deleted.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <cstdint>
+#include <deque>
+#include <string>
+#include <string_view>
+#include <vector>
+
+namespace gateway {
+
+enum class SpoolSync : uint8_t { kAlways, kInterval, kNever };
+
+struct SpoolOptions {
+    std::string dir;
+    SpoolSync sync = SpoolSync::kInterval;
+    uint32_t sync_ms = 1000;
+    uint32_t segment_bytes = 1 << 20;
+    uint64_t max_bytes = 64ull << 20;
+    uint32_t compact_ms = 60000;        // one message per topic this far apart, 0 to delete instead
+};
+
+struct SpoolStats {
+    uint64_t appended = 0;          // messages
+    uint64_t message_bytes = 0;     // their topics and payloads, what the spool is for
+    uint64_t written_bytes = 0;     // to the files: record headers, segment headers, compaction
+    uint64_t device_bytes = 0;      // 4 KiB pages each sync wrote, a partly filled one again every time
+    uint64_t syncs = 0;
+    uint64_t replayed = 0;          // handed out by Next()
+    uint64_t committed = 0;
+    uint64_t refused = 0;           // handed out, not taken by the client, committed as lost
+    uint64_t compacted = 0;         // messages compaction removed
+    uint64_t evicted = 0;           // messages deleted with their segment past max_bytes
+    uint64_t corrupt = 0;           // messages lost to a bad record
+    uint64_t failed = 0;            // appends refused after a write error
+};
+
+// a message from Next(), topic and payload valid until the next call
+struct SpoolMessage {
+    int64_t time_ms;                // wall clock when it was appended
+    std::string_view topic;
+    std::string_view payload;
+};
+
+class Spool {
+public:
+    explicit Spool(const SpoolOptions& options);
+    ~Spool();
+
+    Spool(const Spool&) = delete;
+    Spool& operator=(const Spool&) = delete;
+
+    // creates the directory if needed and reads what a previous run left, false with a
+    // message in *error
+    bool Open(std::string* error);
+    // writes out, syncs and leaves the cursor for the next Open()
+    void Close();
+
+    // false when the spool cannot write, the message is not kept
+    bool Append(int64_t time_ms, std::string_view topic, std::string_view payload);
+    // writes the buffer out and syncs when the policy says so, once per loop round
+    void Flush(int64_t now_ms);
+
+    // the oldest message not handed out yet, false when there is none
+    bool Next(SpoolMessage* message);
+    // the oldest count messages handed out are with the broker
+    void Commit(uint32_t count);
+    // one handed out the client will never take, committed in its turn all the same
+    void Refuse() { stats_.refused++; }
+
+    // messages not handed out yet
+    uint64_t backlog() const { return unread_; }
+    uint64_t bytes() const { return bytes_; }
+    uint32_t segments() const { return static_cast<uint32_t>(segments_.size()); }
+    const SpoolStats& stats() const { return stats_; }
+
+private:
+    struct Segment {
+        uint64_t number;
+        uint64_t bytes;             // the file with what is still in the write buffer
+        uint32_t messages;
+        uint32_t handed = 0;        // by Next(), committed or not
+        uint32_t committed = 0;
+        bool compacted = false;
+    };
+
+    std::string Path(uint64_t number) const;
+    bool Recover(Segment& segment, uint32_t skip);
+    bool StartSegment();
+    bool WriteOut();
+    void Sync();
+    void Roll();
+    void Retain();
+    bool Compact(size_t index);
+    void Remove(size_t index);
+    void Trim();
+    void ResetReader();
+    bool Fail(const char* what);
+
+    SpoolOptions options_;
+    bool open_ = false;
+    bool failed_ = false;
+    std::deque<Segment> segments_;      // oldest first, the last one is written
+    uint64_t next_number_ = 1;
+    uint64_t unread_ = 0;
+    uint64_t bytes_ = 0;
+
+    int write_fd_ = -1;                 // the last segment, -1 until the first Append()
+    std::vector<uint8_t> out_;
+    size_t out_len_ = 0;
+    uint64_t written_ = 0;              // file offset out_ starts at
+    uint64_t synced_ = 0;               // file offset up to which it is durable
+    bool dir_dirty_ = false;            // a segment was created or deleted since the last sync
+    int64_t sync_at_ms_ = 0;
+
+    size_t read_index_ = 0;             // segment Next() reads
+    int read_fd_ = -1;
+    uint64_t read_offset_ = 0;          // file offset of in_[0]
+    std::vector<uint8_t> in_;
+    size_t in_pos_ = 0;
+    size_t in_len_ = 0;
+
+    SpoolStats stats_;
+};
+
+}  // namespace gateway
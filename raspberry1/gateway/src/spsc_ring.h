@@ -0,0 +1,101 @@
+/*
+ * Single producer, single consumer ring, lock-free, allocated once.
+ *
+ * The producer fills slots in place and publishes a run of them with one store, the
+ * consumer handles them in place and releases the run. Each side keeps its index on its
+ * own cache line next to a copy of the other side's, so the shared lines only move when
+ * the copy runs out.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <memory>
+
+#include "udp_ingest.h"
+
+namespace gateway {
+
+template <typename T>
+class SpscRing {
+public:
+    // capacity is rounded up to a power of two
+    explicit SpscRing(uint32_t capacity)
+    {
+        size_ = 1;
+        while (size_ < capacity) {
+            size_ <<= 1;
+        }
+        mask_ = size_ - 1;
+        slots_.reset(new T[size_]);
+    }
+
+    SpscRing(const SpscRing&) = delete;
+    SpscRing& operator=(const SpscRing&) = delete;
+
+    uint32_t capacity() const { return size_; }
+
+    // producer: slots free to fill, Producing(0) .. Producing(Free() - 1)
+    uint32_t Free()
+    {
+        uint32_t free = size_ - (producer_.head - producer_.tail_cache);
+        if (free == 0) {
+            producer_.tail_cache = tail_.load(std::memory_order_acquire);
+            free = size_ - (producer_.head - producer_.tail_cache);
+        }
+        return free;
+    }
+    T& Producing(uint32_t i) { return slots_[(producer_.head + i) & mask_]; }
+    // hands the next n filled slots to the consumer
+    void Publish(uint32_t n)
+    {
+        producer_.head += n;
+        head_.store(producer_.head, std::memory_order_release);
+    }
+
+    // consumer: slots ready to handle, Consuming(0) .. Consuming(Available() - 1)
+    uint32_t Available()
+    {
+        uint32_t available = consumer_.head_cache - consumer_.tail;
+        if (available == 0) {
+            consumer_.head_cache = head_.load(std::memory_order_acquire);
+            available = consumer_.head_cache - consumer_.tail;
+        }
+        return available;
+    }
+    const T& Consuming(uint32_t i) const { return slots_[(consumer_.tail + i) & mask_]; }
+    // gives the next n handled slots back to the producer
+    void Release(uint32_t n)
+    {
+        consumer_.tail += n;
+        tail_.store(consumer_.tail, std::memory_order_release);
+    }
+
+    // any side, a snapshot for statistics
+    uint32_t Depth() const
+    {
+        return head_.load(std::memory_order_relaxed) - tail_.load(std::memory_order_relaxed);
+    }
+
+private:
+    struct alignas(kCacheLine) Producer {
+        uint32_t head = 0;
+        uint32_t tail_cache = 0;
+    };
+    struct alignas(kCacheLine) Consumer {
+        uint32_t tail = 0;
+        uint32_t head_cache = 0;
+    };
+
+    alignas(kCacheLine) std::atomic<uint32_t> head_{0};
+    alignas(kCacheLine) std::atomic<uint32_t> tail_{0};
+    Producer producer_;
+    Consumer consumer_;
+    uint32_t size_;
+    uint32_t mask_;
+    std::unique_ptr<T[]> slots_;
+};
+
+}  // namespace gateway
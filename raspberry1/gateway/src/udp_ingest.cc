@@ -0,0 +1,88 @@
+/*
+ * Batched UDP receive.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "udp_ingest.h"
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+#include <ctime>
+
+namespace gateway {
+
+UdpIngest::UdpIngest(uint32_t batch, bool timestamps)
+    : batch_(std::clamp<uint32_t>(batch, 1, kMaxBatch)),
+      timestamps_(timestamps),
+      slots_(new PacketSlot[batch_]),
+      batch_slots_(new const PacketSlot*[batch_]),
+      msgs_(new mmsghdr[batch_]),
+      iovs_(new iovec[batch_]),
+      controls_(timestamps ? new Control[batch_] : nullptr)
+{
+    // the headers point into the slots once, Receive() only resets what the kernel changes
+    for (uint32_t i = 0; i < batch_; i++) {
+        batch_slots_[i] = &slots_[i];
+        iovs_[i] = {slots_[i].data, PacketSlot::kData};
+        msghdr& h = msgs_[i].msg_hdr;
+        std::memset(&h, 0, sizeof(h));
+        h.msg_name = &slots_[i].from;
+        h.msg_iov = &iovs_[i];
+        h.msg_iovlen = 1;
+    }
+}
+
+void UdpIngest::Attach(int fd)
+{
+    fd_ = fd;
+    if (timestamps_) {
+        int on = 1;
+        setsockopt(fd, SOL_SOCKET, SO_TIMESTAMPNS, &on, sizeof(on));
+    }
+}
+
+PacketBatch UdpIngest::Receive()
+{
+    for (uint32_t i = 0; i < batch_; i++) {
+        msghdr& h = msgs_[i].msg_hdr;
+        h.msg_namelen = sizeof(sockaddr_in);
+        if (timestamps_) {
+            h.msg_control = controls_[i].buf;
+            h.msg_controllen = sizeof(controls_[i].buf);
+        }
+    }
+    stats_.calls++;
+    int n;
+    do {
+        n = recvmmsg(fd_, msgs_.get(), batch_, MSG_DONTWAIT, nullptr);
+    } while (n < 0 && errno == EINTR);
+    if (n <= 0) {
+        stats_.empty++;
+        return PacketBatch{batch_slots_.get(), 0};
+    }
+    for (int i = 0; i < n; i++) {
+        PacketSlot& slot = slots_[i];
+        const msghdr& h = msgs_[i].msg_hdr;
+        slot.name_len = h.msg_namelen;
+        slot.control_len = 0;
+        slot.len = msgs_[i].msg_len;
+        slot.flags = static_cast<uint32_t>(h.msg_flags);
+        stats_.truncated += slot.truncated();
+        slot.rx_realtime_ns = 0;
+        if (timestamps_) {
+            for (cmsghdr* c = CMSG_FIRSTHDR(&h); c != nullptr; c = CMSG_NXTHDR(const_cast<msghdr*>(&h), c)) {
+                if (c->cmsg_level == SOL_SOCKET && c->cmsg_type == SCM_TIMESTAMPNS) {
+                    timespec ts;
+                    std::memcpy(&ts, CMSG_DATA(c), sizeof(ts));
+                    slot.rx_realtime_ns = ts.tv_sec * 1000000000LL + ts.tv_nsec;
+                }
+            }
+        }
+    }
+    stats_.packets += static_cast<uint64_t>(n);
+    stats_.max_batch = std::max(stats_.max_batch, static_cast<uint32_t>(n));
+    return PacketBatch{batch_slots_.get(), static_cast<uint32_t>(n)};
+}
+
+}  // namespace gateway
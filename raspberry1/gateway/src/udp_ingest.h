@@ -0,0 +1,105 @@
+/*
+ * Batched UDP receive: one recvmmsg() fills up to a batch of packet slots.
+ *
+ * The slots are allocated once, each starts on a cache line with its metadata in the
+ * first line, and the handler walks a batch front to back.
+ * A batch stays valid until the next Receive(). Optionally the kernel's receive time
+ * of every datagram comes with it (SO_TIMESTAMPNS), to measure the ingest latency.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <netinet/in.h>
+#include <sys/socket.h>
+
+#include <cstddef>
+#include <cstdint>
+#include <memory>
+#include <string_view>
+
+namespace gateway {
+
+constexpr size_t kCacheLine = 64;
+
+struct alignas(kCacheLine) PacketSlot {
+    // The first 32 bytes are laid out like io_uring_recvmsg_out and the source address,
+    // what io_uring's multishot recvmsg writes in front of the payload, so the io_uring
+    // backend receives straight into slots too.
+    uint32_t name_len;
+    uint32_t control_len;
+    uint32_t len;               // bytes received; io_uring gives the full length of a cut datagram
+    uint32_t flags;             // MSG_TRUNC when the datagram was cut short of len
+    sockaddr_in from;
+    char data[1496];            // any datagram of a 1500 byte MTU, the slot is 24 cache lines
+    int64_t rx_realtime_ns;     // kernel receive time, 0 without timestamps; past what the kernel writes
+
+    static constexpr size_t kData = sizeof(data);
+    static constexpr size_t kHeader = 32;
+    bool truncated() const { return (flags & MSG_TRUNC) != 0 || len > kData; }
+    std::string_view text() const { return std::string_view(data, len < kData ? len : kData); }
+};
+static_assert(sizeof(PacketSlot) % kCacheLine == 0, "slots start on cache lines");
+static_assert(offsetof(PacketSlot, data) == PacketSlot::kHeader, "header of io_uring multishot recvmsg");
+
+// datagrams received together, valid until the receiver's next call
+struct PacketBatch {
+    struct Iterator {
+        const PacketSlot* const* at;
+        const PacketSlot& operator*() const { return **at; }
+        Iterator& operator++()
+        {
+            ++at;
+            return *this;
+        }
+        bool operator!=(const Iterator& other) const { return at != other.at; }
+    };
+
+    const PacketSlot* const* slots;
+    uint32_t count;
+
+    Iterator begin() const { return Iterator{slots}; }
+    Iterator end() const { return Iterator{slots + count}; }
+};
+
+struct IngestStats {
+    uint64_t calls = 0;         // recvmmsg() calls, the ones that found nothing included
+    uint64_t empty = 0;         // calls that found nothing
+    uint64_t packets = 0;
+    uint64_t truncated = 0;
+    uint32_t max_batch = 0;
+};
+
+class UdpIngest {
+public:
+    static constexpr uint32_t kMaxBatch = 256;
+
+    // batch is clamped to [1, kMaxBatch]
+    UdpIngest(uint32_t batch, bool timestamps);
+
+    // receives from fd from now on
+    void Attach(int fd);
+
+    // one non-blocking recvmmsg(), an empty batch when nothing is pending
+    PacketBatch Receive();
+
+    uint32_t batch() const { return batch_; }
+    const IngestStats& stats() const { return stats_; }
+
+private:
+    struct Control {
+        alignas(cmsghdr) char buf[CMSG_SPACE(sizeof(timespec))];
+    };
+
+    uint32_t batch_;
+    bool timestamps_;
+    int fd_ = -1;
+    std::unique_ptr<PacketSlot[]> slots_;
+    std::unique_ptr<const PacketSlot*[]> batch_slots_;
+    std::unique_ptr<mmsghdr[]> msgs_;
+    std::unique_ptr<iovec[]> iovs_;
+    std::unique_ptr<Control[]> controls_;
+    IngestStats stats_;
+};
+
+}  // namespace gateway
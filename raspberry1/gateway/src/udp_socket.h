@@ -0,0 +1,41 @@
+/*
+ * UDP socket helpers.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <netinet/in.h>
+
+#include <cstdint>
+#include <string>
+
+namespace gateway {
+
+// Non-blocking socket bound to address:port, -1 with errno set on failure. With
+// reuse_port it joins the SO_REUSEPORT group of the port, the kernel spreads the
+// datagrams over the group's sockets.
+int OpenUdp(const std::string& address, uint16_t port, int rcvbuf_bytes = 0, bool reuse_port = false);
+
+// Asks the kernel to busy poll the device queue for fd's receives (SO_BUSY_POLL, raising
+// it needs CAP_NET_ADMIN), false when refused; the socket works without it.
+bool SetBusyPoll(int fd, uint32_t us);
+
+// what waits in a socket's receive buffer and what the kernel dropped when it was full
+struct SocketBacklog {
+    uint32_t queued_bytes;
+    uint32_t buffer_bytes;      // SO_RCVBUF as the kernel counts it
+    uint32_t drops;
+};
+
+// from SO_MEMINFO (Linux 4.6), false when the kernel does not have it
+bool ReadSocketBacklog(int fd, SocketBacklog* out);
+
+// "a.b.c.d:port" for logs
+std::string FormatAddr(const sockaddr_in& addr);
+
+int64_t MonotonicMs();
+int64_t MonotonicUs();
+int64_t MonotonicNs();
+
+}  // namespace gateway
@@ -0,0 +1,619 @@
+/*
+ * I/O backend on io_uring.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#include "uring_backend.h"
+
+#include <arpa/inet.h>
+#include <poll.h>
+#include <sys/mman.h>
+#include <sys/syscall.h>
+#include <sys/uio.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cerrno>
+#include <cstring>
+
+#include "log.h"
+#include "udp_socket.h"
+
+namespace gateway {
+
+namespace {
+
+constexpr unsigned kSqEntries = 256;
+constexpr unsigned kCqEntries = 4096;       // multishot receives post one entry per datagram
+constexpr uint32_t kSlots = 256;            // provided buffers per datagram socket, power of two
+constexpr uint32_t kSlotBytes = offsetof(PacketSlot, rx_realtime_ns);
+constexpr uint32_t kMaxGroups = 255;
+constexpr uint8_t kNoGroup = 0xFF;
+
+// op, provided buffer group, generation and fd of a request
+uint64_t UserData(uint8_t op, uint8_t group, uint32_t generation, int fd)
+{
+    return static_cast<uint64_t>(op) << 56 | static_cast<uint64_t>(group) << 48 |
+           static_cast<uint64_t>(generation & 0xFFFF) << 32 | static_cast<uint32_t>(fd);
+}
+
+uint8_t UdOp(uint64_t ud) { return static_cast<uint8_t>(ud >> 56); }
+uint8_t UdGroup(uint64_t ud) { return static_cast<uint8_t>(ud >> 48); }
+uint32_t UdGeneration(uint64_t ud) { return static_cast<uint32_t>(ud >> 32) & 0xFFFF; }
+int UdFd(uint64_t ud) { return static_cast<int>(static_cast<uint32_t>(ud)); }
+
+int Setup(unsigned entries, io_uring_params* p)
+{
+    return static_cast<int>(syscall(__NR_io_uring_setup, entries, p));
+}
+
+int Register(int ring_fd, unsigned opcode, const void* arg, unsigned nr_args)
+{
+    return static_cast<int>(syscall(__NR_io_uring_register, ring_fd, opcode, arg, nr_args));
+}
+
+}  // namespace
+
+std::unique_ptr<UringBackend> UringBackend::Create(std::string* error)
+{
+    std::string why;
+    for (bool buffer_ring : {true, false}) {
+        // the check runs on a ring of its own, so the real one starts clean
+        std::unique_ptr<UringBackend> check(new UringBackend(buffer_ring));
+        if (!check->Init(error)) {
+            return nullptr;
+        }
+        if (!check->SelfTest(&why)) {
+            // without a working buffer ring the buffers can still be handed over by request
+            GW_LOGD("io_uring with%s buffer ring: %s", buffer_ring ? "" : "out", why.c_str());
+            continue;
+        }
+        check.reset();
+        std::unique_ptr<UringBackend> backend(new UringBackend(buffer_ring));
+        if (!backend->Init(error)) {
+            return nullptr;
+        }
+        if (!buffer_ring) {
+            GW_LOGI("io_uring: buffer ring not usable, providing receive buffers by request");
+        }
+        return backend;
+    }
+    if (error) {
+        *error = why;
+    }
+    return nullptr;
+}
+
+bool UringBackend::Init(std::string* error)
+{
+    auto fail = [&](const char* what, int err) {
+        if (error) {
+            *error = std::string(what) + ": " + strerror(err);
+        }
+        return false;
+    };
+    io_uring_params p = {};
+    p.flags = IORING_SETUP_CQSIZE | IORING_SETUP_SUBMIT_ALL | IORING_SETUP_COOP_TASKRUN |
+              IORING_SETUP_TASKRUN_FLAG | IORING_SETUP_SINGLE_ISSUER;
+    p.cq_entries = kCqEntries;
+    ring_fd_ = Setup(kSqEntries, &p);
+    if (ring_fd_ < 0 && errno == EINVAL) {
+        // kernels before 6.0 know only some of the flags, none of them is needed
+        p = {};
+        p.flags = IORING_SETUP_CQSIZE;
+        p.cq_entries = kCqEntries;
+        ring_fd_ = Setup(kSqEntries, &p);
+    }
+    if (ring_fd_ < 0) {
+        return fail("io_uring_setup", errno);
+    }
+    features_ = p.features;
+    if (!(features_ & IORING_FEAT_SINGLE_MMAP) || !(features_ & IORING_FEAT_EXT_ARG)) {
+        return fail("io_uring features", ENOSYS);
+    }
+
+    constexpr unsigned kProbeOps = 256;
+    std::unique_ptr<uint8_t[]> probe_mem(new uint8_t[sizeof(io_uring_probe) + kProbeOps * sizeof(io_uring_probe_op)]());
+    auto* probe = reinterpret_cast<io_uring_probe*>(probe_mem.get());
+    if (Register(ring_fd_, IORING_REGISTER_PROBE, probe, kProbeOps) < 0) {
+        return fail("IORING_REGISTER_PROBE", errno);
+    }
+    for (uint8_t op : {IORING_OP_RECVMSG, IORING_OP_POLL_ADD, IORING_OP_CONNECT, IORING_OP_WRITE_FIXED,
+                       IORING_OP_SEND, IORING_OP_LINK_TIMEOUT, IORING_OP_ASYNC_CANCEL}) {
+        if (op > probe->last_op || !(probe->ops[op].flags & IO_URING_OP_SUPPORTED)) {
+            return fail("io_uring opcode missing", EOPNOTSUPP);
+        }
+    }
+
+    sq_map_len_ = std::max<size_t>(p.sq_off.array + p.sq_entries * sizeof(unsigned),
+                                   p.cq_off.cqes + p.cq_entries * sizeof(io_uring_cqe));
+    sq_map_ = mmap(nullptr, sq_map_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_,
+                   IORING_OFF_SQ_RING);
+    if (sq_map_ == MAP_FAILED) {
+        sq_map_ = nullptr;
+        return fail("mmap io_uring rings", errno);
+    }
+    sqes_len_ = p.sq_entries * sizeof(io_uring_sqe);
+    void* sqes = mmap(nullptr, sqes_len_, PROT_READ | PROT_WRITE, MAP_SHARED | MAP_POPULATE, ring_fd_, IORING_OFF_SQES);
+    if (sqes == MAP_FAILED) {
+        return fail("mmap io_uring sqes", errno);
+    }
+    sqes_ = static_cast<io_uring_sqe*>(sqes);
+
+    auto* sq = static_cast<uint8_t*>(sq_map_);
+    sq_head_ = reinterpret_cast<unsigned*>(sq + p.sq_off.head);
+    sq_tail_ = reinterpret_cast<unsigned*>(sq + p.sq_off.tail);
+    sq_flags_ = reinterpret_cast<unsigned*>(sq + p.sq_off.flags);
+    sq_mask_ = *reinterpret_cast<unsigned*>(sq + p.sq_off.ring_mask);
+    sq_entries_ = p.sq_entries;
+    sq_local_tail_ = *sq_tail_;
+    // the SQEs are used in ring order, the index array never changes
+    auto* array = reinterpret_cast<unsigned*>(sq + p.sq_off.array);
+    for (unsigned i = 0; i < sq_entries_; i++) {
+        array[i] = i;
+    }
+    cq_head_ = reinterpret_cast<unsigned*>(sq + p.cq_off.head);
+    cq_tail_ = reinterpret_cast<unsigned*>(sq + p.cq_off.tail);
+    cq_mask_ = *reinterpret_cast<unsigned*>(sq + p.cq_off.ring_mask);
+    cqes_ = reinterpret_cast<io_uring_cqe*>(sq + p.cq_off.cqes);
+    pending_.reset(new const PacketSlot*[UdpIngest::kMaxBatch]);
+    return true;
+}
+
+bool UringBackend::SelfTest(std::string* error)
+{
+    // multishot recvmsg (6.0) and provided buffer rings (5.19) have no probe bit, so a
+    // datagram to ourselves has to come through
+    int fd = OpenUdp("127.0.0.1", 0);
+    sockaddr_in addr = {};
+    socklen_t len = sizeof(addr);
+    if (fd < 0 || getsockname(fd, reinterpret_cast<sockaddr*>(&addr), &len) < 0) {
+        if (error) {
+            *error = std::string("self test socket: ") + strerror(errno);
+        }
+        if (fd >= 0) {
+            close(fd);
+        }
+        return false;
+    }
+    if (!AddDatagramSocket(fd, 4)) {
+        if (error) {
+            *error = std::string("IORING_REGISTER_PBUF_RING: ") + strerror(errno);
+        }
+        close(fd);
+        return false;
+    }
+    static const char kText[] = "io_uring self test";
+    for (int i = 0; i < 2; i++) {
+        sendto(fd, kText, sizeof(kText) - 1, 0, reinterpret_cast<sockaddr*>(&addr), sizeof(addr));
+    }
+    struct Counter : IoHandler {
+        uint32_t good = 0;
+        void OnDatagrams(int, const PacketBatch& batch) override
+        {
+            for (const PacketSlot& p : batch) {
+                good += p.text() == kText;
+            }
+        }
+        void OnReadable(int) override {}
+        void OnConnected(int, int) override {}
+        void OnSent(int, int) override {}
+    } counter;
+    for (int i = 0; i < 20 && counter.good < 2 && recv_error_ == 0; i++) {
+        Wait(10, counter);
+    }
+    Remove(fd);
+    close(fd);
+    if (counter.good == 2) {
+        return true;
+    }
+    if (error) {
+        *error = std::string("multishot recvmsg: ") + (recv_error_ ? strerror(recv_error_) : "no datagrams");
+    }
+    return false;
+}
+
+UringBackend::~UringBackend()
+{
+    if (ring_fd_ >= 0) {
+        close(ring_fd_);
+    }
+    if (sqes_) {
+        munmap(sqes_, sqes_len_);
+    }
+    if (sq_map_) {
+        munmap(sq_map_, sq_map_len_);
+    }
+    for (auto& g : groups_) {
+        if (g->ring) {
+            munmap(g->ring, kSlots * sizeof(io_uring_buf));
+        }
+    }
+}
+
+UringBackend::FdState& UringBackend::State(int fd)
+{
+    if (static_cast<size_t>(fd) >= fds_.size()) {
+        fds_.resize(fd + 1);
+    }
+    return fds_[fd];
+}
+
+void UringBackend::Reserve(unsigned n)
+{
+    // linked requests must go to the kernel in one submission
+    if (sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE) + n > sq_entries_) {
+        Enter(sq_local_tail_ - *sq_head_, 0, 0, nullptr);
+    }
+}
+
+io_uring_sqe* UringBackend::Sqe(uint8_t op, uint8_t group, int fd)
+{
+    io_uring_sqe* sqe = &sqes_[sq_local_tail_++ & sq_mask_];
+    std::memset(sqe, 0, sizeof(*sqe));
+    sqe->fd = fd;
+    uint32_t generation = static_cast<size_t>(fd) < fds_.size() ? fds_[fd].generation : 0;
+    sqe->user_data = UserData(op, group, generation, fd);
+    return sqe;
+}
+
+int UringBackend::Enter(unsigned submit, unsigned wait, unsigned flags, const void* arg)
+{
+    __atomic_store_n(sq_tail_, sq_local_tail_, __ATOMIC_RELEASE);
+    stats_.syscalls++;
+    if (flags & IORING_ENTER_GETEVENTS) {
+        stats_.waits++;
+    }
+    int rc = static_cast<int>(syscall(__NR_io_uring_enter, ring_fd_, submit, wait, flags, arg,
+                                      arg ? sizeof(io_uring_getevents_arg) : 0));
+    return rc < 0 ? -errno : rc;
+}
+
+void UringBackend::ArmRecv(int fd, int group)
+{
+    Reserve(1);
+    io_uring_sqe* sqe = Sqe(kRecv, static_cast<uint8_t>(group), fd);
+    sqe->opcode = IORING_OP_RECVMSG;
+    sqe->addr = reinterpret_cast<uint64_t>(&groups_[group]->msg);
+    sqe->len = 1;
+    sqe->ioprio = IORING_RECV_MULTISHOT;
+    sqe->flags = IOSQE_BUFFER_SELECT;
+    sqe->buf_group = groups_[group]->bgid;
+}
+
+void UringBackend::ArmPoll(int fd)
+{
+    Reserve(1);
+    io_uring_sqe* sqe = Sqe(kPoll, kNoGroup, fd);
+    sqe->opcode = IORING_OP_POLL_ADD;
+    sqe->poll32_events = POLLIN;
+    sqe->len = IORING_POLL_ADD_MULTI;
+}
+
+void UringBackend::PrepareWrite(int fd, const uint8_t* buf, size_t len)
+{
+    FdState& s = fds_[fd];
+    io_uring_sqe* sqe = Sqe(kWrite, kNoGroup, fd);
+    sqe->addr = reinterpret_cast<uint64_t>(buf);
+    sqe->len = static_cast<uint32_t>(len);
+    if (send_buf_ && buf >= send_buf_ && buf + len <= send_buf_ + send_len_) {
+        // the pages are pinned at registration, no lookup per write
+        sqe->opcode = IORING_OP_WRITE_FIXED;
+        sqe->buf_index = 0;
+    } else {
+        sqe->opcode = IORING_OP_SEND;
+        sqe->msg_flags = MSG_NOSIGNAL;
+    }
+    if (send_timeout_ms_) {
+        sqe->flags |= IOSQE_IO_LINK;
+        s.timeout.tv_sec = send_timeout_ms_ / 1000;
+        s.timeout.tv_nsec = (send_timeout_ms_ % 1000) * 1000000LL;
+        io_uring_sqe* t = Sqe(kLinkTimeout, kNoGroup, fd);
+        t->opcode = IORING_OP_LINK_TIMEOUT;
+        t->fd = -1;
+        t->addr = reinterpret_cast<uint64_t>(&s.timeout);
+        t->len = 1;
+    }
+    s.writing = true;
+    s.write_len = len;
+    stats_.writes++;
+}
+
+bool UringBackend::AddDatagramSocket(int fd, uint32_t batch)
+{
+    if (groups_.size() >= kMaxGroups) {
+        errno = ENOSPC;
+        return false;
+    }
+    std::unique_ptr<Group> g(new Group());
+    g->fd = fd;
+    g->bgid = static_cast<uint16_t>(groups_.size());
+    g->batch = std::clamp<uint32_t>(batch, 1, UdpIngest::kMaxBatch);
+    g->slots.reset(new PacketSlot[kSlots]);
+    if (buffer_ring_) {
+        void* ring = mmap(nullptr, kSlots * sizeof(io_uring_buf), PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS,
+                          -1, 0);
+        if (ring == MAP_FAILED) {
+            return false;
+        }
+        std::memset(ring, 0, kSlots * sizeof(io_uring_buf));
+        io_uring_buf_reg reg = {};
+        reg.ring_addr = reinterpret_cast<uint64_t>(ring);
+        reg.ring_entries = kSlots;
+        reg.bgid = g->bgid;
+        stats_.syscalls++;
+        if (Register(ring_fd_, IORING_REGISTER_PBUF_RING, &reg, 1) < 0) {
+            int err = errno;
+            munmap(ring, kSlots * sizeof(io_uring_buf));
+            errno = err;
+            return false;
+        }
+        g->ring = static_cast<io_uring_buf_ring*>(ring);
+        for (uint32_t i = 0; i < kSlots; i++) {
+            io_uring_buf& b = g->ring->bufs[i];
+            b.addr = reinterpret_cast<uint64_t>(&g->slots[i]);
+            b.len = kSlotBytes;
+            b.bid = static_cast<uint16_t>(i);
+        }
+        g->tail = static_cast<uint16_t>(kSlots);
+        __atomic_store_n(&g->ring->tail, g->tail, __ATOMIC_RELEASE);
+    } else {
+        Provide(*g, 0, kSlots);
+    }
+    // no iovec: the payload goes into the rest of the buffer after header and address
+    g->msg.msg_namelen = sizeof(sockaddr_in);
+    g->msg.msg_controllen = 0;
+    g->msg.msg_iovlen = 0;
+
+    int group = static_cast<int>(groups_.size());
+    groups_.push_back(std::move(g));
+    State(fd).group = group;
+    ArmRecv(fd, group);
+    return true;
+}
+
+bool UringBackend::AddReadable(int fd)
+{
+    State(fd).readable = true;
+    ArmPoll(fd);
+    return true;
+}
+
+void UringBackend::Remove(int fd)
+{
+    FdState& s = State(fd);
+    if (s.group >= 0) {
+        groups_[s.group]->fd = -1;
+        groups_[s.group]->rearm = false;
+    }
+    uint32_t generation = s.generation + 1;
+    s = FdState();
+    s.generation = generation;
+    Reserve(1);
+    io_uring_sqe* sqe = Sqe(kCancel, kNoGroup, fd);
+    sqe->opcode = IORING_OP_ASYNC_CANCEL;
+    sqe->cancel_flags = IORING_ASYNC_CANCEL_FD | IORING_ASYNC_CANCEL_ALL;
+    // the cancel finds the requests by the open file, it has to go in before close(fd)
+    Enter(sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE), 0, 0, nullptr);
+}
+
+void UringBackend::RegisterSendBuffer(uint8_t* buf, size_t len)
+{
+    if (send_buf_) {
+        Register(ring_fd_, IORING_UNREGISTER_BUFFERS, nullptr, 0);
+        send_buf_ = nullptr;
+        send_len_ = 0;
+    }
+    iovec iov = {buf, len};
+    stats_.syscalls++;
+    if (Register(ring_fd_, IORING_REGISTER_BUFFERS, &iov, 1) < 0) {
+        GW_LOGW("io_uring: send buffer not registered (%s), plain sends", strerror(errno));
+        return;
+    }
+    send_buf_ = buf;
+    send_len_ = len;
+}
+
+bool UringBackend::Connect(int fd, const sockaddr* addr, socklen_t addr_len, const uint8_t* first, size_t first_len)
+{
+    FdState& s = State(fd);
+    if (addr_len > sizeof(s.addr)) {
+        return false;
+    }
+    std::memcpy(&s.addr, addr, addr_len);
+    s.addr_len = addr_len;
+    Reserve(3);
+    io_uring_sqe* sqe = Sqe(kConnect, kNoGroup, fd);
+    sqe->opcode = IORING_OP_CONNECT;
+    sqe->addr = reinterpret_cast<uint64_t>(&s.addr);
+    sqe->off = addr_len;
+    if (first_len) {
+        // a failed connect cancels the write, nothing goes out on a dead socket
+        sqe->flags = IOSQE_IO_LINK;
+        PrepareWrite(fd, first, first_len);
+    }
+    return true;
+}
+
+bool UringBackend::Send(int fd, const uint8_t* buf, size_t len)
+{
+    if (State(fd).writing) {
+        return false;
+    }
+    Reserve(2);
+    PrepareWrite(fd, buf, len);
+    return true;
+}
+
+void UringBackend::Provide(const Group& g, uint32_t first, uint32_t count)
+{
+    Reserve(1);
+    io_uring_sqe* sqe = Sqe(kProvide, static_cast<uint8_t>(g.bgid), 0);
+    sqe->opcode = IORING_OP_PROVIDE_BUFFERS;
+    sqe->fd = static_cast<int>(count);
+    sqe->addr = reinterpret_cast<uint64_t>(&g.slots[first]);
+    sqe->len = sizeof(PacketSlot);     // the stride, so the kernel may fill rx_realtime_ns too
+    sqe->off = first;
+    sqe->buf_group = g.bgid;
+}
+
+void UringBackend::ReturnBuffers(Group& g, const PacketSlot* const* slots, uint32_t count)
+{
+    if (!g.ring) {
+        // one request per run of neighbouring slots, a batch usually is one run
+        uint32_t i = 0;
+        while (i < count) {
+            uint32_t first = static_cast<uint32_t>(slots[i] - g.slots.get());
+            uint32_t n = 1;
+            while (i + n < count && slots[i + n] == slots[i] + n) {
+                n++;
+            }
+            Provide(g, first, n);
+            i += n;
+        }
+        return;
+    }
+    for (uint32_t i = 0; i < count; i++) {
+        // addr, len and bid only, resv of the first entry is the ring's tail
+        io_uring_buf& b = g.ring->bufs[g.tail & (kSlots - 1)];
+        b.addr = reinterpret_cast<uint64_t>(slots[i]);
+        b.len = kSlotBytes;
+        b.bid = static_cast<uint16_t>(slots[i] - g.slots.get());
+        g.tail++;
+    }
+    __atomic_store_n(&g.ring->tail, g.tail, __ATOMIC_RELEASE);
+}
+
+void UringBackend::Flush(IoHandler& handler)
+{
+    if (pending_count_ == 0) {
+        return;
+    }
+    Group& g = *groups_[pending_group_];
+    PacketBatch batch{pending_.get(), pending_count_};
+    if (g.fd >= 0) {
+        stats_.datagrams += batch.count;
+        stats_.batches++;
+        stats_.max_batch = std::max(stats_.max_batch, batch.count);
+        handler.OnDatagrams(g.fd, batch);
+    }
+    ReturnBuffers(g, pending_.get(), pending_count_);
+    pending_count_ = 0;
+}
+
+void UringBackend::Reap(IoHandler& handler)
+{
+    unsigned head = *cq_head_;
+    for (;;) {
+        unsigned tail = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE);
+        if (head == tail) {
+            break;
+        }
+        for (; head != tail; head++) {
+            const io_uring_cqe cqe = cqes_[head & cq_mask_];
+            __atomic_store_n(cq_head_, head + 1, __ATOMIC_RELEASE);
+            uint8_t op = UdOp(cqe.user_data);
+            int fd = UdFd(cqe.user_data);
+            if (op == kProvide && cqe.res < 0) {
+                GW_LOGW("io_uring provide buffers: %s", strerror(-cqe.res));
+            }
+            if (op == kLinkTimeout || op == kCancel || op == kProvide || static_cast<size_t>(fd) >= fds_.size()) {
+                continue;
+            }
+            bool current = (fds_[fd].generation & 0xFFFF) == UdGeneration(cqe.user_data);
+            bool more = (cqe.flags & IORING_CQE_F_MORE) != 0;
+            switch (op) {
+            case kRecv: {
+                int group = UdGroup(cqe.user_data);
+                Group& g = *groups_[group];
+                if (cqe.res >= 0 && (cqe.flags & IORING_CQE_F_BUFFER)) {
+                    PacketSlot* slot = &g.slots[cqe.flags >> IORING_CQE_BUFFER_SHIFT];
+                    if (!current) {
+                        const PacketSlot* one = slot;
+                        ReturnBuffers(g, &one, 1);
+                        break;
+                    }
+                    slot->rx_realtime_ns = 0;
+                    stats_.truncated += slot->truncated();
+                    if (pending_count_ && pending_group_ != group) {
+                        Flush(handler);
+                    }
+                    pending_group_ = group;
+                    pending_[pending_count_++] = slot;
+                    if (pending_count_ == g.batch) {
+                        Flush(handler);
+                    }
+                } else if (cqe.res < 0 && cqe.res != -ENOBUFS && cqe.res != -ECANCELED && current) {
+                    recv_error_ = -cqe.res;
+                    GW_LOGW("io_uring recvmsg on fd %d: %s", fd, strerror(-cqe.res));
+                }
+                // ENOBUFS ends the multishot, it is armed again once the slots are back
+                if (!more && current && g.fd >= 0) {
+                    g.rearm = true;
+                }
+                break;
+            }
+            case kPoll:
+                if (current && cqe.res > 0) {
+                    handler.OnReadable(fd);
+                }
+                if (!more && (fds_[fd].generation & 0xFFFF) == UdGeneration(cqe.user_data) && fds_[fd].readable) {
+                    ArmPoll(fd);
+                }
+                break;
+            case kConnect:
+                if (current) {
+                    if (cqe.res < 0) {
+                        fds_[fd].writing = false;     // the linked write comes back canceled
+                    }
+                    handler.OnConnected(fd, cqe.res);
+                }
+                break;
+            case kWrite:
+                if (current && fds_[fd].writing) {
+                    FdState& s = fds_[fd];
+                    s.writing = false;
+                    // canceled by the linked timeout
+                    int result = cqe.res == -ECANCELED ? -ETIME : cqe.res;
+                    if (result >= 0 && static_cast<size_t>(result) < s.write_len) {
+                        stats_.short_writes++;
+                    }
+                    handler.OnSent(fd, result);
+                }
+                break;
+            }
+        }
+    }
+    Flush(handler);
+    for (size_t i = 0; i < groups_.size(); i++) {
+        if (groups_[i]->rearm) {
+            groups_[i]->rearm = false;
+            ArmRecv(groups_[i]->fd, static_cast<int>(i));
+        }
+    }
+}
+
+void UringBackend::Wait(int timeout_ms, IoHandler& handler)
+{
+    unsigned submit = sq_local_tail_ - __atomic_load_n(sq_head_, __ATOMIC_ACQUIRE);
+    bool ready = __atomic_load_n(cq_tail_, __ATOMIC_ACQUIRE) != *cq_head_;
+    if (ready || timeout_ms == 0) {
+        // with cooperative task running, finished receives may wait for a kernel entry
+        bool taskrun = (__atomic_load_n(sq_flags_, __ATOMIC_RELAXED) & IORING_SQ_TASKRUN) != 0;
+        if (submit || (!ready && taskrun)) {
+            Enter(submit, 0, IORING_ENTER_GETEVENTS, nullptr);
+        }
+    } else {
+        __kernel_timespec ts = {};
+        io_uring_getevents_arg arg = {};
+        if (timeout_ms > 0) {
+            ts.tv_sec = timeout_ms / 1000;
+            ts.tv_nsec = (timeout_ms % 1000) * 1000000LL;
+            arg.ts = reinterpret_cast<uint64_t>(&ts);
+        }
+        Enter(submit, 1, IORING_ENTER_GETEVENTS | IORING_ENTER_EXT_ARG, &arg);
+    }
+    Reap(handler);
+}
+
+}  // namespace gateway
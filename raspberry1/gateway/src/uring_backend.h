@@ -0,0 +1,124 @@
+/*
+ * I/O backend on io_uring, with the raw syscalls and <linux/io_uring.h>.
+ *
+ * Every datagram socket gets a multishot recvmsg that takes its buffers from a ring of
+ * PacketSlots registered with the kernel (provided buffer ring), so one armed request
+ * keeps receiving and a burst of datagrams costs one io_uring_enter() for the lot. Where
+ * the buffer ring does not work the slots go back with IORING_OP_PROVIDE_BUFFERS
+ * requests instead, one per run of slots, submitted with the next wait.
+ * Readable sockets get a multishot poll. Stream writes come from the registered send
+ * buffer (WRITE_FIXED), linked to a timeout, and Connect() links the first write to the
+ * connect so the MQTT CONNECT goes out without another round through the loop.
+ *
+ * user_data carries the operation, the fd and its generation; Remove() bumps the
+ * generation and cancels everything on the fd, completions still on their way are
+ * recognised by the old generation and dropped.
+ *
+ * SPDX-License-Identifier: MIT
+ */
+#pragma once
+
+#include <linux/io_uring.h>
+
+#include <memory>
+#include <string>
+#include <vector>
+
+#include "io_backend.h"
+
+namespace gateway {
+
+class UringBackend : public IoBackend {
+public:
+    // Sets the ring up and checks that multishot recvmsg with a provided buffer ring
+    // works end to end (Linux 6.0 and later), nullptr with the reason in *error.
+    static std::unique_ptr<UringBackend> Create(std::string* error);
+    ~UringBackend() override;
+
+    const char* name() const override { return "io_uring"; }
+    bool AddDatagramSocket(int fd, uint32_t batch) override;
+    bool AddReadable(int fd) override;
+    void Remove(int fd) override;
+    void RegisterSendBuffer(uint8_t* buf, size_t len) override;
+    bool Connect(int fd, const sockaddr* addr, socklen_t addr_len, const uint8_t* first, size_t first_len) override;
+    bool Send(int fd, const uint8_t* buf, size_t len) override;
+    void Wait(int timeout_ms, IoHandler& handler) override;
+
+private:
+    enum Op : uint8_t { kRecv = 1, kPoll, kConnect, kWrite, kLinkTimeout, kCancel, kProvide };
+
+    // provided buffers of one datagram socket, in a ring or handed over by request
+    struct Group {
+        int fd = -1;
+        uint16_t bgid = 0;
+        uint32_t batch = 0;
+        io_uring_buf_ring* ring = nullptr;     // nullptr without buffer ring
+        uint16_t tail = 0;
+        std::unique_ptr<PacketSlot[]> slots;
+        msghdr msg = {};            // template of the multishot recvmsg, read by the kernel while armed
+        bool rearm = false;
+    };
+
+    struct FdState {
+        uint32_t generation = 0;
+        int group = -1;
+        bool readable = false;
+        bool writing = false;
+        size_t write_len = 0;
+        sockaddr_storage addr = {};
+        socklen_t addr_len = 0;
+        __kernel_timespec timeout = {};
+    };
+
+    explicit UringBackend(bool buffer_ring) : buffer_ring_(buffer_ring) {}
+    bool Init(std::string* error);
+    bool SelfTest(std::string* error);
+
+    FdState& State(int fd);
+    // room for n more SQEs, submitting what is queued when the ring is short of it
+    void Reserve(unsigned n);
+    io_uring_sqe* Sqe(uint8_t op, uint8_t group, int fd);
+    void ArmRecv(int fd, int group);
+    void ArmPoll(int fd);
+    void PrepareWrite(int fd, const uint8_t* buf, size_t len);
+    // slots [first, first + count) back to the kernel with IORING_OP_PROVIDE_BUFFERS
+    void Provide(const Group& g, uint32_t first, uint32_t count);
+    void ReturnBuffers(Group& g, const PacketSlot* const* slots, uint32_t count);
+    void Flush(IoHandler& handler);
+    int Enter(unsigned submit, unsigned wait, unsigned flags, const void* arg);
+    void Reap(IoHandler& handler);
+
+    bool buffer_ring_;
+    int ring_fd_ = -1;
+    uint32_t features_ = 0;
+    void* sq_map_ = nullptr;
+    size_t sq_map_len_ = 0;
+    void* cq_map_ = nullptr;
+    size_t cq_map_len_ = 0;
+    io_uring_sqe* sqes_ = nullptr;
+    size_t sqes_len_ = 0;
+
+    unsigned* sq_head_ = nullptr;
+    unsigned* sq_tail_ = nullptr;
+    unsigned* sq_flags_ = nullptr;
+    unsigned sq_mask_ = 0;
+    unsigned sq_entries_ = 0;
+    unsigned sq_local_tail_ = 0;
+    unsigned* cq_head_ = nullptr;
+    unsigned* cq_tail_ = nullptr;
+    unsigned cq_mask_ = 0;
+    io_uring_cqe* cqes_ = nullptr;
+
+    uint8_t* send_buf_ = nullptr;
+    size_t send_len_ = 0;
+
+    std::vector<FdState> fds_;
+    std::vector<std::unique_ptr<Group>> groups_;
+    // datagrams of one socket collected from the CQ, handed over together
+    std::unique_ptr<const PacketSlot*[]> pending_;
+    uint32_t pending_count_ = 0;
+    int pending_group_ = -1;
+    int recv_error_ = 0;        // last receive error, for the self test
+};
+
+}  // namespace gateway